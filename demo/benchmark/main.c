@@ -0,0 +1,912 @@
+/**************************************************************************
+*
+* Copyright (C) 2026 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+
+/* command line tool that times the encoders and decoders of the library */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include "config.h"
+#include "bacdef.h"
+#include "bacdcode.h"
+#include "bacapp.h"
+#include "bacstr.h"
+#include "datetime.h"
+#include "npdu.h"
+#include "rp.h"
+#include "rpm.h"
+#include "wp.h"
+#include "wpm.h"
+#include "cov.h"
+#include "iam.h"
+#include "version.h"
+#include "filename.h"
+
+/** @file benchmark/main.c  Time the codecs in the BACnet library. */
+
+/* each batch of iterations runs at least this long when calibrating */
+#define BENCH_BATCH_NS 20000000.0
+#define BENCH_REPEAT_DEFAULT 5
+#define BENCH_REPEAT_MAX 31
+#define BENCH_CASES_MAX 80
+
+/* one operation; returns the number of octets encoded, decoded,
+   or printed, or a negative value if the codec failed */
+typedef int (
+    *bench_function) (
+    void *context);
+
+typedef struct bench_case {
+    char name[32];
+    bench_function run;
+    void *context;
+} BENCH_CASE;
+
+static BENCH_CASE Bench_Case[BENCH_CASES_MAX];
+static unsigned Bench_Case_Count;
+/* keeps results alive so the calls are not optimized away */
+static volatile int Bench_Sink;
+static uint8_t Bench_Buffer[MAX_APDU];
+static char Bench_Text[256];
+
+#if BENCH_COUNT_ALLOCS
+/* the library is linked with --wrap so that its heap use is counted */
+static unsigned long Alloc_Count;
+
+void *__real_malloc(
+    size_t size);
+void *__real_calloc(
+    size_t nmemb,
+    size_t size);
+void *__real_realloc(
+    void *ptr,
+    size_t size);
+void *__wrap_malloc(
+    size_t size);
+void *__wrap_calloc(
+    size_t nmemb,
+    size_t size);
+void *__wrap_realloc(
+    void *ptr,
+    size_t size);
+
+void *__wrap_malloc(
+    size_t size)
+{
+    Alloc_Count++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(
+    size_t nmemb,
+    size_t size)
+{
+    Alloc_Count++;
+    return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(
+    void *ptr,
+    size_t size)
+{
+    Alloc_Count++;
+    return __real_realloc(ptr, size);
+}
+#endif
+
+static double bench_time_ns(
+    void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER count;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&count);
+
+    return ((double) count.QuadPart * 1.0e9) / (double) frequency.QuadPart;
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((double) now.tv_sec * 1.0e9) + (double) now.tv_nsec;
+#endif
+}
+
+static void bench_add(
+    const char *prefix,
+    const char *suffix,
+    bench_function run,
+    void *context)
+{
+    BENCH_CASE *bench;
+
+    if (Bench_Case_Count < BENCH_CASES_MAX) {
+        bench = &Bench_Case[Bench_Case_Count];
+        if (suffix) {
+            snprintf(bench->name, sizeof(bench->name), "%s-%s", prefix,
+                suffix);
+        } else {
+            snprintf(bench->name, sizeof(bench->name), "%s", prefix);
+        }
+        bench->run = run;
+        bench->context = context;
+        Bench_Case_Count++;
+    }
+}
+
+/* application tagged values */
+struct app_case {
+    const char *name;
+    BACNET_APPLICATION_DATA_VALUE value;
+    uint8_t apdu[64];
+    int apdu_len;
+};
+
+static struct app_case App_Case[] = {
+    {"null", {0}},
+    {"boolean", {0}},
+    {"unsigned", {0}},
+    {"signed", {0}},
+    {"real", {0}},
+    {"double", {0}},
+    {"octet-string", {0}},
+    {"character-string", {0}},
+    {"bit-string", {0}},
+    {"enumerated", {0}},
+    {"date", {0}},
+    {"time", {0}},
+    {"object-id", {0}}
+};
+
+static void app_case_init(
+    void)
+{
+    BACNET_APPLICATION_DATA_VALUE *value;
+    static uint8_t octets[] = {
+        0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+        0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF
+    };
+    unsigned i;
+
+    for (i = 0; i < sizeof(App_Case) / sizeof(App_Case[0]); i++) {
+        value = &App_Case[i].value;
+        value->tag = (uint8_t) i;
+        switch (value->tag) {
+            case BACNET_APPLICATION_TAG_BOOLEAN:
+                value->type.Boolean = true;
+                break;
+            case BACNET_APPLICATION_TAG_UNSIGNED_INT:
+                value->type.Unsigned_Int = 1234567;
+                break;
+            case BACNET_APPLICATION_TAG_SIGNED_INT:
+                value->type.Signed_Int = -12345;
+                break;
+            case BACNET_APPLICATION_TAG_REAL:
+                value->type.Real = 72.5F;
+                break;
+            case BACNET_APPLICATION_TAG_DOUBLE:
+                value->type.Double = 3.14159265358979;
+                break;
+            case BACNET_APPLICATION_TAG_OCTET_STRING:
+                octetstring_init(&value->type.Octet_String, octets,
+                    sizeof(octets));
+                break;
+            case BACNET_APPLICATION_TAG_CHARACTER_STRING:
+                characterstring_init_ansi(&value->type.Character_String,
+                    "Supply Air Temperature");
+                break;
+            case BACNET_APPLICATION_TAG_BIT_STRING:
+                bitstring_init(&value->type.Bit_String);
+                bitstring_set_bit(&value->type.Bit_String, 0, true);
+                bitstring_set_bit(&value->type.Bit_String, 1, false);
+                bitstring_set_bit(&value->type.Bit_String, 2, true);
+                bitstring_set_bit(&value->type.Bit_String, 3, false);
+                break;
+            case BACNET_APPLICATION_TAG_ENUMERATED:
+                value->type.Enumerated = PROP_PRESENT_VALUE;
+                break;
+            case BACNET_APPLICATION_TAG_DATE:
+                datetime_set_date(&value->type.Date, 2016, 10, 19);
+                break;
+            case BACNET_APPLICATION_TAG_TIME:
+                datetime_set_time(&value->type.Time, 12, 34, 56, 78);
+                break;
+            case BACNET_APPLICATION_TAG_OBJECT_ID:
+                value->type.Object_Id.type = OBJECT_ANALOG_INPUT;
+                value->type.Object_Id.instance = 1234;
+                break;
+            default:
+                break;
+        }
+        App_Case[i].apdu_len =
+            bacapp_encode_application_data(App_Case[i].apdu, value);
+    }
+}
+
+static int bench_app_encode(
+    void *context)
+{
+    struct app_case *app = context;
+
+    return bacapp_encode_application_data(Bench_Buffer, &app->value);
+}
+
+static int bench_app_decode(
+    void *context)
+{
+    struct app_case *app = context;
+    BACNET_APPLICATION_DATA_VALUE value;
+
+    return bacapp_decode_application_data(app->apdu, app->apdu_len, &value);
+}
+
+static int bench_app_print(
+    void *context)
+{
+    struct app_case *app = context;
+    BACNET_OBJECT_PROPERTY_VALUE object_value;
+
+    object_value.object_type = OBJECT_ANALOG_VALUE;
+    object_value.object_instance = 1;
+    object_value.object_property = PROP_PRESENT_VALUE;
+    object_value.array_index = BACNET_ARRAY_ALL;
+    object_value.value = &app->value;
+
+    return bacapp_snprintf_value(Bench_Text, sizeof(Bench_Text),
+        &object_value);
+}
+
+/* tag header primitives */
+static uint8_t Tag_Encoded[8];
+static int Tag_Encoded_Len;
+
+static int bench_tag_encode(
+    void *context)
+{
+    (void) context;
+    return encode_context_unsigned(Bench_Buffer, 3, 0x123456);
+}
+
+static int bench_tag_decode(
+    void *context)
+{
+    uint32_t value = 0;
+
+    (void) context;
+    return decode_context_unsigned_safe(Tag_Encoded, Tag_Encoded_Len, 3,
+        &value);
+}
+
+/* network layer, routed in both directions */
+static BACNET_ADDRESS Npdu_Dest;
+static BACNET_ADDRESS Npdu_Src;
+static BACNET_NPDU_DATA Npdu_Data;
+static uint8_t Npdu_Encoded[MAX_NPDU];
+static int Npdu_Encoded_Len;
+
+static int bench_npdu_encode(
+    void *context)
+{
+    (void) context;
+    return npdu_encode_pdu(Bench_Buffer, &Npdu_Dest, &Npdu_Src, &Npdu_Data);
+}
+
+static int bench_npdu_decode(
+    void *context)
+{
+    BACNET_ADDRESS dest;
+    BACNET_ADDRESS src;
+    BACNET_NPDU_DATA npdu_data;
+
+    (void) context;
+    return npdu_decode(Npdu_Encoded, &dest, &src, &npdu_data);
+}
+
+/* ReadProperty request and ack */
+static BACNET_READ_PROPERTY_DATA Rp_Data;
+static uint8_t Rp_Request[MAX_APDU];
+static int Rp_Request_Len;
+static uint8_t Rp_Ack[MAX_APDU];
+static int Rp_Ack_Len;
+
+static int bench_rp_encode(
+    void *context)
+{
+    (void) context;
+    return rp_encode_apdu(Bench_Buffer, 1, &Rp_Data);
+}
+
+static int bench_rp_decode(
+    void *context)
+{
+    BACNET_READ_PROPERTY_DATA rpdata;
+
+    (void) context;
+    /* skip the 4 octet confirmed request header */
+    return rp_decode_service_request(&Rp_Request[4], Rp_Request_Len - 4,
+        &rpdata);
+}
+
+static int bench_rp_ack_encode(
+    void *context)
+{
+    (void) context;
+    return rp_ack_encode_apdu(Bench_Buffer, 1, &Rp_Data);
+}
+
+static int bench_rp_ack_decode(
+    void *context)
+{
+    BACNET_READ_PROPERTY_DATA rpdata;
+
+    (void) context;
+    /* skip the 3 octet complex ack header */
+    return rp_ack_decode_service_request(&Rp_Ack[3], Rp_Ack_Len - 3,
+        &rpdata);
+}
+
+/* ReadPropertyMultiple: two objects with three properties each */
+static BACNET_READ_ACCESS_DATA Rpm_Data[2];
+static BACNET_PROPERTY_REFERENCE Rpm_Property[2][3];
+static uint8_t Rpm_Request[MAX_APDU];
+static int Rpm_Request_Len;
+static uint8_t Rpm_Ack[MAX_APDU];
+static int Rpm_Ack_Len;
+
+static int bench_rpm_encode(
+    void *context)
+{
+    (void) context;
+    return rpm_encode_apdu(Bench_Buffer, sizeof(Bench_Buffer), 1,
+        &Rpm_Data[0]);
+}
+
+static int bench_rpm_decode(
+    void *context)
+{
+    BACNET_RPM_DATA rpmdata;
+    uint8_t *apdu = &Rpm_Request[4];
+    unsigned apdu_len = Rpm_Request_Len - 4;
+    unsigned len = 0;
+    int decode_len = 0;
+
+    (void) context;
+    while (len < apdu_len) {
+        decode_len = rpm_decode_object_id(&apdu[len], apdu_len - len,
+            &rpmdata);
+        if (decode_len <= 0) {
+            return BACNET_STATUS_ERROR;
+        }
+        len += decode_len;
+        for (;;) {
+            decode_len =
+                rpm_decode_object_property(&apdu[len], apdu_len - len,
+                &rpmdata);
+            if (decode_len <= 0) {
+                return BACNET_STATUS_ERROR;
+            }
+            len += decode_len;
+            if (decode_is_closing_tag_number(&apdu[len], 1)) {
+                len++;
+                break;
+            }
+        }
+    }
+
+    return (int) len;
+}
+
+static int bench_rpm_ack_encode(
+    void *context)
+{
+    BACNET_READ_ACCESS_DATA *rpm_object;
+    BACNET_PROPERTY_REFERENCE *rpm_property;
+    BACNET_RPM_DATA rpmdata;
+    int apdu_len = 0;
+    int len = 0;
+
+    (void) context;
+    apdu_len = rpm_ack_encode_apdu_init(Bench_Buffer, 1);
+    for (rpm_object = &Rpm_Data[0]; rpm_object;
+        rpm_object = rpm_object->next) {
+        rpmdata.object_type = rpm_object->object_type;
+        rpmdata.object_instance = rpm_object->object_instance;
+        apdu_len +=
+            rpm_ack_encode_apdu_object_begin(&Bench_Buffer[apdu_len],
+            &rpmdata);
+        for (rpm_property = rpm_object->listOfProperties; rpm_property;
+            rpm_property = rpm_property->next) {
+            apdu_len +=
+                rpm_ack_encode_apdu_object_property(&Bench_Buffer[apdu_len],
+                rpm_property->propertyIdentifier,
+                rpm_property->propertyArrayIndex);
+            /* value encoded in place, as the server does */
+            len =
+                bacapp_encode_application_data(&Bench_Buffer[apdu_len + 1],
+                &App_Case[BACNET_APPLICATION_TAG_REAL].value);
+            apdu_len +=
+                rpm_ack_encode_apdu_object_property_value(&Bench_Buffer
+                [apdu_len], &Bench_Buffer[apdu_len + 1], len);
+        }
+        apdu_len += rpm_ack_encode_apdu_object_end(&Bench_Buffer[apdu_len]);
+    }
+
+    return apdu_len;
+}
+
+static bool rpm_ack_count_value(
+    void *context,
+    BACNET_APPLICATION_DATA_VIEW * value)
+{
+    (void) value;
+    (*(unsigned *) context)++;
+
+    return true;
+}
+
+static int bench_rpm_ack_decode(
+    void *context)
+{
+    BACNET_RPM_ACK_VISITOR visitor = { 0 };
+    unsigned count = 0;
+    int len = 0;
+
+    (void) context;
+    visitor.on_value = rpm_ack_count_value;
+    visitor.context = &count;
+    len = rpm_ack_decode_visit(&Rpm_Ack[3], Rpm_Ack_Len - 3, &visitor);
+    if (count != 6) {
+        return BACNET_STATUS_ERROR;
+    }
+
+    return len;
+}
+
+/* WritePropertyMultiple: two objects with two values each */
+static BACNET_WRITE_ACCESS_DATA Wpm_Data[2];
+static BACNET_PROPERTY_VALUE Wpm_Value[2][2];
+static uint8_t Wpm_Request[MAX_APDU];
+static int Wpm_Request_Len;
+
+static int bench_wpm_encode(
+    void *context)
+{
+    (void) context;
+    return wpm_encode_apdu(Bench_Buffer, sizeof(Bench_Buffer), 1,
+        &Wpm_Data[0]);
+}
+
+static int bench_wpm_decode(
+    void *context)
+{
+    static BACNET_WRITE_PROPERTY_DATA wp_data;
+    uint8_t *apdu = &Wpm_Request[4];
+    unsigned apdu_len = Wpm_Request_Len - 4;
+    unsigned len = 0;
+    int decode_len = 0;
+
+    (void) context;
+    while (len < apdu_len) {
+        decode_len = wpm_decode_object_id(&apdu[len], apdu_len - len,
+            &wp_data);
+        if (decode_len <= 0) {
+            return BACNET_STATUS_ERROR;
+        }
+        len += decode_len;
+        if (!decode_is_opening_tag_number(&apdu[len], 1)) {
+            return BACNET_STATUS_ERROR;
+        }
+        len++;
+        do {
+            decode_len =
+                wpm_decode_object_property(&apdu[len], apdu_len - len,
+                &wp_data);
+            if (decode_len <= 0) {
+                return BACNET_STATUS_ERROR;
+            }
+            len += decode_len;
+        } while (!decode_is_closing_tag_number(&apdu[len], 1));
+        len++;
+    }
+
+    return (int) len;
+}
+
+/* ConfirmedCOVNotification with present-value and status-flags */
+static BACNET_COV_DATA Cov_Data;
+static BACNET_PROPERTY_VALUE Cov_Value[2];
+static BACNET_COV_DATA Cov_Decoded;
+static BACNET_PROPERTY_VALUE Cov_Decoded_Value[2];
+static uint8_t Cov_Request[MAX_APDU];
+static int Cov_Request_Len;
+
+static int bench_cov_encode(
+    void *context)
+{
+    (void) context;
+    return ccov_notify_encode_apdu(Bench_Buffer, sizeof(Bench_Buffer), 1,
+        &Cov_Data);
+}
+
+static int bench_cov_decode(
+    void *context)
+{
+    (void) context;
+    return cov_notify_decode_service_request(&Cov_Request[4],
+        Cov_Request_Len - 4, &Cov_Decoded);
+}
+
+/* I-Am */
+static uint8_t Iam_Request[MAX_APDU];
+static int Iam_Request_Len;
+
+static int bench_iam_encode(
+    void *context)
+{
+    (void) context;
+    return iam_encode_apdu(Bench_Buffer, 4194302, MAX_APDU,
+        SEGMENTATION_NONE, 260);
+}
+
+static int bench_iam_decode(
+    void *context)
+{
+    uint32_t device_id = 0;
+    unsigned max_apdu = 0;
+    int segmentation = 0;
+    uint16_t vendor_id = 0;
+
+    (void) context;
+    if (Iam_Request_Len <= 2) {
+        return BACNET_STATUS_ERROR;
+    }
+    /* skip the 2 octet unconfirmed request header */
+    return iam_decode_service_request(&Iam_Request[2], &device_id,
+        &max_apdu, &segmentation, &vendor_id);
+}
+
+static void service_data_init(
+    void)
+{
+    static const BACNET_PROPERTY_ID rpm_property[3] = {
+        PROP_PRESENT_VALUE, PROP_STATUS_FLAGS, PROP_OBJECT_NAME
+    };
+    unsigned i, j;
+
+    Tag_Encoded_Len = encode_context_unsigned(Tag_Encoded, 3, 0x123456);
+
+    Npdu_Dest.net = 100;
+    Npdu_Dest.len = 1;
+    Npdu_Dest.adr[0] = 0x7F;
+    Npdu_Src.net = 200;
+    Npdu_Src.len = 6;
+    for (i = 0; i < 6; i++) {
+        Npdu_Src.adr[i] = (uint8_t) (0xC0 + i);
+    }
+    npdu_encode_npdu_data(&Npdu_Data, true, MESSAGE_PRIORITY_NORMAL);
+    Npdu_Encoded_Len =
+        npdu_encode_pdu(Npdu_Encoded, &Npdu_Dest, &Npdu_Src, &Npdu_Data);
+
+    Rp_Data.object_type = OBJECT_ANALOG_INPUT;
+    Rp_Data.object_instance = 1;
+    Rp_Data.object_property = PROP_PRESENT_VALUE;
+    Rp_Data.array_index = BACNET_ARRAY_ALL;
+    Rp_Data.application_data =
+        App_Case[BACNET_APPLICATION_TAG_REAL].apdu;
+    Rp_Data.application_data_len =
+        App_Case[BACNET_APPLICATION_TAG_REAL].apdu_len;
+    Rp_Request_Len = rp_encode_apdu(Rp_Request, 1, &Rp_Data);
+    Rp_Ack_Len = rp_ack_encode_apdu(Rp_Ack, 1, &Rp_Data);
+
+    for (i = 0; i < 2; i++) {
+        Rpm_Data[i].object_type = OBJECT_ANALOG_INPUT;
+        Rpm_Data[i].object_instance = i + 1;
+        Rpm_Data[i].listOfProperties = &Rpm_Property[i][0];
+        Rpm_Data[i].next = (i == 0) ? &Rpm_Data[1] : NULL;
+        for (j = 0; j < 3; j++) {
+            Rpm_Property[i][j].propertyIdentifier = rpm_property[j];
+            Rpm_Property[i][j].propertyArrayIndex = BACNET_ARRAY_ALL;
+            Rpm_Property[i][j].next =
+                (j < 2) ? &Rpm_Property[i][j + 1] : NULL;
+        }
+    }
+    Rpm_Request_Len =
+        rpm_encode_apdu(Rpm_Request, sizeof(Rpm_Request), 1, &Rpm_Data[0]);
+    Rpm_Ack_Len = bench_rpm_ack_encode(NULL);
+    memcpy(Rpm_Ack, Bench_Buffer, Rpm_Ack_Len);
+
+    for (i = 0; i < 2; i++) {
+        Wpm_Data[i].object_type = OBJECT_ANALOG_VALUE;
+        Wpm_Data[i].object_instance = i + 1;
+        Wpm_Data[i].listOfProperties = &Wpm_Value[i][0];
+        Wpm_Data[i].next = (i == 0) ? &Wpm_Data[1] : NULL;
+        Wpm_Value[i][0].propertyIdentifier = PROP_PRESENT_VALUE;
+        Wpm_Value[i][0].propertyArrayIndex = BACNET_ARRAY_ALL;
+        Wpm_Value[i][0].value = App_Case[BACNET_APPLICATION_TAG_REAL].value;
+        Wpm_Value[i][0].priority = 8;
+        Wpm_Value[i][0].next = &Wpm_Value[i][1];
+        Wpm_Value[i][1].propertyIdentifier = PROP_DESCRIPTION;
+        Wpm_Value[i][1].propertyArrayIndex = BACNET_ARRAY_ALL;
+        Wpm_Value[i][1].value =
+            App_Case[BACNET_APPLICATION_TAG_CHARACTER_STRING].value;
+        Wpm_Value[i][1].priority = BACNET_NO_PRIORITY;
+        Wpm_Value[i][1].next = NULL;
+    }
+    Wpm_Request_Len =
+        wpm_encode_apdu(Wpm_Request, sizeof(Wpm_Request), 1, &Wpm_Data[0]);
+
+    Cov_Data.subscriberProcessIdentifier = 1;
+    Cov_Data.initiatingDeviceIdentifier = 1234;
+    Cov_Data.monitoredObjectIdentifier.type = OBJECT_ANALOG_INPUT;
+    Cov_Data.monitoredObjectIdentifier.instance = 1;
+    Cov_Data.timeRemaining = 300;
+    cov_data_value_list_link(&Cov_Data, Cov_Value, 2);
+    Cov_Value[0].propertyIdentifier = PROP_PRESENT_VALUE;
+    Cov_Value[0].propertyArrayIndex = BACNET_ARRAY_ALL;
+    Cov_Value[0].value = App_Case[BACNET_APPLICATION_TAG_REAL].value;
+    Cov_Value[0].priority = BACNET_NO_PRIORITY;
+    Cov_Value[1].propertyIdentifier = PROP_STATUS_FLAGS;
+    Cov_Value[1].propertyArrayIndex = BACNET_ARRAY_ALL;
+    Cov_Value[1].value = App_Case[BACNET_APPLICATION_TAG_BIT_STRING].value;
+    Cov_Value[1].priority = BACNET_NO_PRIORITY;
+    Cov_Request_Len =
+        ccov_notify_encode_apdu(Cov_Request, sizeof(Cov_Request), 1,
+        &Cov_Data);
+    cov_data_value_list_link(&Cov_Decoded, Cov_Decoded_Value, 2);
+
+    Iam_Request_Len =
+        iam_encode_apdu(Iam_Request, 4194302, MAX_APDU, SEGMENTATION_NONE,
+        260);
+}
+
+static void bench_case_init(
+    void)
+{
+    unsigned i;
+
+    for (i = 0; i < sizeof(App_Case) / sizeof(App_Case[0]); i++) {
+        bench_add("encode", App_Case[i].name, bench_app_encode,
+            &App_Case[i]);
+        bench_add("decode", App_Case[i].name, bench_app_decode,
+            &App_Case[i]);
+    }
+    bench_add("encode", "context-tag", bench_tag_encode, NULL);
+    bench_add("decode", "context-tag", bench_tag_decode, NULL);
+    bench_add("npdu-encode", NULL, bench_npdu_encode, NULL);
+    bench_add("npdu-decode", NULL, bench_npdu_decode, NULL);
+    bench_add("rp-encode", NULL, bench_rp_encode, NULL);
+    bench_add("rp-decode", NULL, bench_rp_decode, NULL);
+    bench_add("rp-ack-encode", NULL, bench_rp_ack_encode, NULL);
+    bench_add("rp-ack-decode", NULL, bench_rp_ack_decode, NULL);
+    bench_add("rpm-encode", NULL, bench_rpm_encode, NULL);
+    bench_add("rpm-decode", NULL, bench_rpm_decode, NULL);
+    bench_add("rpm-ack-encode", NULL, bench_rpm_ack_encode, NULL);
+    bench_add("rpm-ack-decode", NULL, bench_rpm_ack_decode, NULL);
+    bench_add("wpm-encode", NULL, bench_wpm_encode, NULL);
+    bench_add("wpm-decode", NULL, bench_wpm_decode, NULL);
+    bench_add("cov-encode", NULL, bench_cov_encode, NULL);
+    bench_add("cov-decode", NULL, bench_cov_decode, NULL);
+    bench_add("iam-encode", NULL, bench_iam_encode, NULL);
+    bench_add("iam-decode", NULL, bench_iam_decode, NULL);
+    for (i = 0; i < sizeof(App_Case) / sizeof(App_Case[0]); i++) {
+        bench_add("print", App_Case[i].name, bench_app_print, &App_Case[i]);
+    }
+}
+
+static double bench_batch(
+    BENCH_CASE * bench,
+    unsigned long iterations)
+{
+    unsigned long i;
+    double start;
+    int len = 0;
+
+    start = bench_time_ns();
+    for (i = 0; i < iterations; i++) {
+        len = bench->run(bench->context);
+    }
+    Bench_Sink = len;
+
+    return bench_time_ns() - start;
+}
+
+static void bench_run(
+    BENCH_CASE * bench,
+    unsigned long iterations,
+    unsigned repeat)
+{
+    double elapsed[BENCH_REPEAT_MAX];
+    double swap;
+    unsigned long allocs = 0;
+    int len = 0;
+    unsigned i, j;
+
+    len = bench->run(bench->context);
+    if (len <= 0) {
+        printf("%-28s FAILED (%d)\n", bench->name, len);
+        return;
+    }
+    if (iterations == 0) {
+        /* calibrate so that a batch is long enough to time */
+        iterations = 1000;
+        while ((bench_batch(bench, iterations) < BENCH_BATCH_NS) &&
+            (iterations < 100000000UL)) {
+            iterations *= 2;
+        }
+    }
+#if BENCH_COUNT_ALLOCS
+    allocs = Alloc_Count;
+#endif
+    for (i = 0; i < repeat; i++) {
+        elapsed[i] = bench_batch(bench, iterations);
+    }
+#if BENCH_COUNT_ALLOCS
+    allocs = Alloc_Count - allocs;
+#endif
+    /* sort the batches: report the fastest and the median */
+    for (i = 1; i < repeat; i++) {
+        for (j = i; (j > 0) && (elapsed[j - 1] > elapsed[j]); j--) {
+            swap = elapsed[j];
+            elapsed[j] = elapsed[j - 1];
+            elapsed[j - 1] = swap;
+        }
+    }
+    printf("%-28s %10lu %10.1f %10.1f %9d", bench->name, iterations,
+        elapsed[0] / iterations, elapsed[repeat / 2] / iterations, len);
+#if BENCH_COUNT_ALLOCS
+    printf(" %9.2f\n", (double) allocs / ((double) iterations * repeat));
+#else
+    (void) allocs;
+    printf(" %9s\n", "-");
+#endif
+}
+
+static void print_usage(
+    char *filename)
+{
+    printf("Usage: %s [--iterations N][--repeat N][--list]\n", filename);
+    printf("       [benchmark-name-filter ...]\n");
+    printf("       [--version][--help]\n");
+}
+
+static void print_help(
+    char *filename)
+{
+    printf("Time the encoders and decoders of the BACnet library.\n"
+        "Each benchmark runs in batches; the report gives ns per\n"
+        "operation for the fastest and the median batch, the octets\n"
+        "encoded, decoded or printed by one operation, and the heap\n"
+        "allocations made by the library per operation.\n" "\n");
+    printf("--iterations N\n"
+        "Run N operations per batch instead of calibrating each\n"
+        "benchmark. Use a fixed count when comparing runs.\n" "\n"
+        "--repeat N\n" "Number of timed batches, 1 to %d. Defaults to %d.\n"
+        "\n" "--list\n" "List the benchmarks without running them.\n" "\n"
+        "benchmark-name-filter:\n"
+        "Only run benchmarks whose name contains one of the filters.\n"
+        "\n", BENCH_REPEAT_MAX, BENCH_REPEAT_DEFAULT);
+    printf("Run all the ReadPropertyMultiple benchmarks:\n" "%s rpm\n",
+        filename);
+}
+
+static bool bench_selected(
+    const char *name,
+    int argc,
+    char *argv[],
+    int filter_argi)
+{
+    int argi;
+    bool filtered = false;
+
+    for (argi = filter_argi; argi < argc; argi++) {
+        if (argv[argi] == NULL) {
+            continue;
+        }
+        filtered = true;
+        if (strstr(name, argv[argi])) {
+            return true;
+        }
+    }
+
+    return !filtered;
+}
+
+int main(
+    int argc,
+    char *argv[])
+{
+    unsigned long iterations = 0;
+    unsigned repeat = BENCH_REPEAT_DEFAULT;
+    bool list = false;
+    char *filename = NULL;
+    int argi = 0;
+    unsigned i;
+
+    filename = filename_remove_path(argv[0]);
+    for (argi = 1; argi < argc; argi++) {
+        if (strcmp(argv[argi], "--help") == 0) {
+            print_usage(filename);
+            print_help(filename);
+            return 0;
+        }
+        if (strcmp(argv[argi], "--version") == 0) {
+            printf("%s %s\n", filename, BACNET_VERSION_TEXT);
+            printf("Copyright (C) 2026 by Steve Karg and others.\n"
+                "This is free software; see the source for copying conditions.\n"
+                "There is NO warranty; not even for MERCHANTABILITY or\n"
+                "FITNESS FOR A PARTICULAR PURPOSE.\n");
+            return 0;
+        }
+        if (strcmp(argv[argi], "--iterations") == 0) {
+            argv[argi] = NULL;
+            if (++argi < argc) {
+                iterations = strtoul(argv[argi], NULL, 0);
+                argv[argi] = NULL;
+            }
+        } else if (strcmp(argv[argi], "--repeat") == 0) {
+            argv[argi] = NULL;
+            if (++argi < argc) {
+                repeat = (unsigned) strtoul(argv[argi], NULL, 0);
+                argv[argi] = NULL;
+            }
+            if ((repeat < 1) || (repeat > BENCH_REPEAT_MAX)) {
+                print_usage(filename);
+                return 1;
+            }
+        } else if (strcmp(argv[argi], "--list") == 0) {
+            argv[argi] = NULL;
+            list = true;
+        }
+    }
+    app_case_init();
+    service_data_init();
+    bench_case_init();
+    if (!list) {
+        printf("%-28s %10s %10s %10s %9s %9s\n", "benchmark", "iterations",
+            "ns/op", "median", "bytes/op", "allocs/op");
+    }
+    for (i = 0; i < Bench_Case_Count; i++) {
+        if (!bench_selected(Bench_Case[i].name, argc, argv, 1)) {
+            continue;
+        }
+        if (list) {
+            printf("%s\n", Bench_Case[i].name);
+        } else {
+            bench_run(&Bench_Case[i], iterations, repeat);
+        }
+        fflush(stdout);
+    }
+
+    return 0;
+}
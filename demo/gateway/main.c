@@ -54,6 +54,7 @@
 #include "lc.h"
 #include "debug.h"
 #include "version.h"
+#include "timer.h"
 /* include the device object */
 #include "device.h"
 #ifdef BACNET_TEST_VMAC
@@ -79,6 +80,11 @@ int DNET_list[2] = {
     VIRTUAL_DNET, -1    /* Need -1 terminator */
 };
 
+/** Number of remote Devices behind the gateway */
+static int Routed_Devices = MAX_NUM_DEVICES - 1;
+/* true when the I-Ams of the Devices are paced */
+static bool I_Am_Paced;
+
 
 
 /** Initialize the Device Objects and each of the child Object instances.
@@ -99,7 +105,7 @@ static void Devices_Init(
         strlen(DEV_DESCR_GATEWAY));
 
     /* Now initialize the remote Device objects. */
-    for (i = 1; i < MAX_NUM_DEVICES; i++) {
+    for (i = 1; i < Routed_Devices + 1; i++) {
 #ifdef _MSC_VER
         _snprintf(nameText, MAX_DEV_NAME_LEN, "%s %d", DEV_NAME_BASE, i + 1);
         _snprintf(descText, MAX_DEV_DESC_LEN, "%s %d", DEV_DESCR_REMOTE, i);
@@ -173,7 +179,9 @@ static void Init_Service_Handlers(
  * the remote devices get
  * - For BIP, the IP address reversed, and 4th byte equal to index.
  * (Eg, 11.22.33.44 for the gateway becomes 44.33.22.01 for the first remote
- * device.) This is sure to be unique! The port number stays the same.
+ * device.) With more than 255 remote devices, the 3rd byte holds the
+ * high byte of the index.  This is sure to be unique! The port number
+ * stays the same.
  * - For MS/TP, [Steve inserts a good idea here]
  */
 static void Initialize_Device_Addresses(
@@ -182,64 +190,102 @@ static void Initialize_Device_Addresses(
     int i = 0;  /* First entry is Gateway Device */
     uint32_t virtual_mac = 0;
     DEVICE_OBJECT_DATA *pDev = NULL;
+    BACNET_ADDRESS address;
     /* Setup info for the main gateway device first */
     pDev = Get_Routed_Device_Object(i);
+    memset(&address, 0, sizeof(address));
 #if defined(BACDL_BIP)
     uint16_t myPort;
     struct in_addr *netPtr;     /* Lets us cast to this type */
-    uint8_t *gatewayMac = NULL;
+    uint8_t gatewayMac[6];
     uint32_t myAddr = bip_get_addr();
-    gatewayMac = pDev->bacDevAddr.mac;  /* Keep pointer to the main MAC */
-    memcpy(pDev->bacDevAddr.mac, &myAddr, 4);
+    memcpy(address.mac, &myAddr, 4);
     myPort = bip_get_port();
-    memcpy(&pDev->bacDevAddr.mac[4], &myPort, 2);
-    pDev->bacDevAddr.mac_len = 6;
+    memcpy(&address.mac[4], &myPort, 2);
+    address.mac_len = 6;
+    memcpy(gatewayMac, address.mac, 6); /* Keep the main MAC */
 #elif defined(BACDL_MSTP)
-    pDev->bacDevAddr.mac_len = 1;
-    pDev->bacDevAddr.mac[0] = dlmstp_mac_address();
+    address.mac_len = 1;
+    address.mac[0] = dlmstp_mac_address();
 #else
 #error "No support for this Data Link Layer type "
 #endif
+    Routed_Device_Set_Address(&address);
     /* broadcast an I-Am on startup */
     Send_I_Am(&Handler_Transmit_Buffer[0]);
 
-    for (i = 1; i < MAX_NUM_DEVICES; i++) {
+    for (i = 1; i < Routed_Devices + 1; i++) {
         pDev = Get_Routed_Device_Object(i);
         if (pDev == NULL)
             continue;
+        memset(&address, 0, sizeof(address));
 #if defined(BACDL_BIP)
         virtual_mac = i;
-        netPtr = (struct in_addr *) pDev->bacDevAddr.mac;
-#if (MAX_NUM_DEVICES > 0xFFFFFF)
-        pDev->bacDevAddr.mac[0] = ((virtual_mac & 0xff000000) >> 24);
-#else
-        pDev->bacDevAddr.mac[0] = gatewayMac[3];
-#endif
-#if (MAX_NUM_DEVICES > 0xFFFF)
-        pDev->bacDevAddr.mac[1] = ((virtual_mac & 0xff0000) >> 16);
-#else
-        pDev->bacDevAddr.mac[1] = gatewayMac[2];
-#endif
-#if (MAX_NUM_DEVICES > 0xFF)
-        pDev->bacDevAddr.mac[2] = ((virtual_mac & 0xff00) >> 8);
-#else
-        pDev->bacDevAddr.mac[2] = gatewayMac[1];
-#endif
-        pDev->bacDevAddr.mac[3] = (virtual_mac & 0xff);
-        memcpy(&pDev->bacDevAddr.mac[4], &myPort, 2);
-        pDev->bacDevAddr.mac_len = 6;
-        pDev->bacDevAddr.net = VIRTUAL_DNET;
-        memcpy(&pDev->bacDevAddr.adr[0], &pDev->bacDevAddr.mac[0], 6);
-        pDev->bacDevAddr.len = 6;
+        netPtr = (struct in_addr *) address.mac;
+        address.mac[0] = gatewayMac[3];
+        address.mac[1] = gatewayMac[2];
+        if (Routed_Devices > 0xFF) {
+            address.mac[2] = ((virtual_mac & 0xff00) >> 8);
+        } else {
+            address.mac[2] = gatewayMac[1];
+        }
+        address.mac[3] = (virtual_mac & 0xff);
+        memcpy(&address.mac[4], &myPort, 2);
+        address.mac_len = 6;
+        address.net = VIRTUAL_DNET;
+        memcpy(&address.adr[0], &address.mac[0], 6);
+        address.len = 6;
+        Routed_Device_Set_Address(&address);
         printf(" - Routed device [%d] ID %u at %s \n", i,
             pDev->bacObj.Object_Instance_Number, inet_ntoa(*netPtr));
 #elif defined(BACDL_MSTP)
         /* Todo: set MS/TP net and port #s */
-        pDev->bacDevAddr.mac_len = 2;
+        address.mac_len = 2;
+        Routed_Device_Set_Address(&address);
 #endif
         /* broadcast an I-Am for each routed Device now */
-        Send_I_Am(&Handler_Transmit_Buffer[0]);
+        if (I_Am_Paced) {
+            Send_I_Am_Paced(Device_Object_Instance_Number(), NULL);
+        } else {
+            Send_I_Am(&Handler_Transmit_Buffer[0]);
+        }
+
+    }
+}
 
+/** Pace the I-Ams of the gateway and its routed Devices when
+ * BACNET_IAM_RATE is set, see bin/readme.txt.
+ */
+static void Init_I_Am_Pacing(
+    void)
+{
+    char *pEnv = NULL;
+    unsigned rate = 0;
+    unsigned jitter = 0;
+    unsigned window = 1000;
+
+    pEnv = getenv("BACNET_IAM_RATE");
+    if (pEnv) {
+        rate = (unsigned) strtol(pEnv, NULL, 0);
+    }
+    if (rate == 0) {
+        return;
+    }
+    pEnv = getenv("BACNET_IAM_JITTER");
+    if (pEnv) {
+        jitter = (unsigned) strtol(pEnv, NULL, 0);
+    }
+    pEnv = getenv("BACNET_IAM_WINDOW");
+    if (pEnv) {
+        window = (unsigned) strtol(pEnv, NULL, 0);
+    }
+    /* room for every Device to answer a few requesters at once */
+    I_Am_Paced =
+        Send_I_Am_Pace_Init(rate, jitter, window,
+        4 * ((unsigned) Routed_Devices + 1));
+    if (I_Am_Paced) {
+        printf("Sending at most %u I-Am per second.\n", rate);
+        atexit(Send_I_Am_Pace_Cleanup);
     }
 }
 
@@ -268,7 +314,10 @@ int main(
     time_t current_seconds = 0;
     uint32_t elapsed_seconds = 0;
     uint32_t elapsed_milliseconds = 0;
+    uint32_t last_milliseconds = 0;
+    uint32_t current_milliseconds = 0;
     uint32_t first_object_instance = FIRST_DEVICE_NUMBER;
+    char *pEnv = NULL;
 #ifdef BACNET_TEST_VMAC
     /* Router data */
     BACNET_DEVICE_PROFILE *device;
@@ -289,10 +338,19 @@ int main(
     printf("BACnet Router Demo\n" "BACnet Stack Version %s\n"
         "BACnet Device ID: %u\n" "Max APDU: %d\n", BACnet_Version,
         first_object_instance, MAX_APDU);
+    pEnv = getenv("BACNET_GATEWAY_DEVICES");
+    if (pEnv) {
+        Routed_Devices = strtol(pEnv, NULL, 0);
+        if ((Routed_Devices < 0) || (Routed_Devices >= 0xFFFF)) {
+            printf("Error: Invalid number of devices %s \n", pEnv);
+            exit(1);
+        }
+    }
     Init_Service_Handlers(first_object_instance);
     dlenv_init();
     atexit(datalink_cleanup);
     Devices_Init(first_object_instance);
+    Init_I_Am_Pacing();
     Initialize_Device_Addresses();
 
 #ifdef BACNET_TEST_VMAC
@@ -302,6 +360,7 @@ int main(
 #endif
     /* configure the timeout values */
     last_seconds = time(NULL);
+    last_milliseconds = timeGetTime();
 
     /* broadcast an I-am-router-to-network on startup */
     printf("Remote Network DNET Number %d \n", DNET_list[0]);
@@ -312,6 +371,11 @@ int main(
         /* input */
         current_seconds = time(NULL);
 
+        /* wake up in time for the next paced I-Am */
+        timeout = Send_I_Am_Pace_Next();
+        if ((timeout == 0) || (timeout > 1000)) {
+            timeout = 1000;
+        }
         /* returns 0 bytes on timeout */
         pdu_len = datalink_receive(&src, &Rx_Buf[0], MAX_MPDU, timeout);
 
@@ -319,6 +383,18 @@ int main(
         if (pdu_len) {
             routing_npdu_handler(&src, DNET_list, &Rx_Buf[0], pdu_len);
         }
+        /* the timers and COV work on the objects of the gateway Device */
+        Get_Routed_Device_Object(0);
+        /* paced I-Am responses */
+        current_milliseconds = timeGetTime();
+        elapsed_milliseconds = current_milliseconds - last_milliseconds;
+        if (elapsed_milliseconds) {
+            last_milliseconds = current_milliseconds;
+            if (elapsed_milliseconds > UINT16_MAX) {
+                elapsed_milliseconds = UINT16_MAX;
+            }
+            Send_I_Am_Pace_Timer((uint16_t) elapsed_milliseconds);
+        }
         /* at least one second has passed */
         elapsed_seconds = current_seconds - last_seconds;
         if (elapsed_seconds) {
@@ -401,6 +401,9 @@ void dlenv_maintenance_timer(
  *   - BACNET_BIP6_PORT - UDP/IP port number (0..65534) used for BACnet/IPv6
  *     communications.  Default is 47808 (0xBAC0).
  *   - BACNET_BIP6_BROADCAST - FF05::BAC0 or FF02::BAC0 or ...
+ * - BACDL_ETHERNET: (BACnet Ethernet, Linux)
+ *   - BACNET_ETHERNET_RING - size in kilobytes of the receive ring
+ *     shared with the kernel; if not set, the socket is read instead.
  */
 void dlenv_init(
     void)
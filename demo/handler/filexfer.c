@@ -0,0 +1,1034 @@
+/**************************************************************************
+*
+* Copyright (C) 2026 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "config.h"
+#include "bacdef.h"
+#include "bacstr.h"
+#include "bactext.h"
+#include "address.h"
+#include "tsm.h"
+#include "apdu.h"
+#include "arf.h"
+#include "awf.h"
+/* some demo stuff needed */
+#include "handlers.h"
+#include "client.h"
+#include "filexfer.h"
+
+/** @file filexfer.c  Windowed AtomicReadFile/AtomicWriteFile stream
+ * transfers.
+ *
+ * The file is moved in chunks sized to the peer's Max APDU, and up to
+ * 'window' chunks are outstanding at once.  Acks may complete in any
+ * order; each one is matched to its chunk by invoke ID and lands at its
+ * own offset in the local file.  A chunk that the TSM gives up on is sent
+ * again, and a chunk that the peer aborts as too big is split in two.
+ * Only one transfer runs at a time.
+ */
+
+/* a chunk is outstanding when it has an invoke ID, else it is queued */
+typedef struct file_transfer_chunk {
+    bool used;
+    uint8_t invoke_id;
+    uint8_t retries;
+    uint32_t start;
+    uint32_t count;
+} FILE_TRANSFER_CHUNK;
+
+/* room for the window plus the remainders of short reads and splits */
+#define FILE_TRANSFER_CHUNK_MAX (FILE_TRANSFER_WINDOW_MAX * 2)
+/* we don't split chunks smaller than this */
+#define FILE_TRANSFER_CHUNK_MIN 16
+
+static FILE_TRANSFER_CHUNK Chunks[FILE_TRANSFER_CHUNK_MAX];
+static FILE_TRANSFER_STATUS Status = FILE_TRANSFER_IDLE;
+static bool Writing;
+static uint32_t Device_ID;
+static uint32_t File_Instance;
+static BACNET_ADDRESS Target_Address;
+static FILE *Local_File;
+static unsigned Window = FILE_TRANSFER_WINDOW_DEFAULT;
+/* next octet that has not been put into a chunk */
+static uint32_t Next_Position;
+/* size of the local file, or the remote end of file once it is known */
+static uint32_t End_Position;
+static bool End_Known;
+static bool Started;
+/* writes at position 0 truncate, so nothing else goes until it is acked */
+static bool First_Acked;
+static uint32_t Octets_Done;
+/* configuration */
+static unsigned Chunk_Size_Fixed;
+static unsigned Chunk_Size_Limit;
+static bool Pad_Enable;
+static uint8_t Pad_Value;
+static file_transfer_progress_function Progress_Function;
+static void *Progress_Context;
+
+static unsigned file_transfer_chunk_size(
+    void)
+{
+    BACNET_ADDRESS dest;
+    unsigned max_apdu = 0;
+    unsigned octets = 0;
+
+    if (Chunk_Size_Fixed) {
+        octets = Chunk_Size_Fixed;
+    } else {
+        /* use the current binding - the peer may have answered
+           another Who-Is since we started */
+        (void) address_get_by_device(Device_ID, &max_apdu, &dest);
+        if ((max_apdu == 0) || (max_apdu > MAX_APDU)) {
+            max_apdu = MAX_APDU;
+        }
+        /* Typical sizes are 50, 128, 206, 480, 1024, and 1476 octets.
+           Remove the overhead of the APDU, which varies with the size.
+           note: we could fail if there is a bottle neck (router)
+           and smaller MPDU in betweeen - the abort splits the chunk. */
+        if (max_apdu <= 50) {
+            octets = max_apdu - 20;
+        } else if (max_apdu <= 480) {
+            octets = max_apdu - 32;
+        } else if (max_apdu <= 1476) {
+            octets = max_apdu - 64;
+        } else {
+            octets = max_apdu / 2;
+        }
+    }
+    if (Chunk_Size_Limit && (octets > Chunk_Size_Limit)) {
+        octets = Chunk_Size_Limit;
+    }
+    if (Writing && (octets > MAX_OCTET_STRING_BYTES)) {
+        octets = MAX_OCTET_STRING_BYTES;
+    }
+
+    return octets;
+}
+
+static FILE_TRANSFER_CHUNK *file_transfer_chunk_alloc(
+    void)
+{
+    unsigned i = 0;
+
+    for (i = 0; i < FILE_TRANSFER_CHUNK_MAX; i++) {
+        if (!Chunks[i].used) {
+            memset(&Chunks[i], 0, sizeof(Chunks[i]));
+            Chunks[i].used = true;
+            return &Chunks[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void file_transfer_progress(
+    void)
+{
+    if (Progress_Function) {
+        Progress_Function(Octets_Done, End_Known ? End_Position : 0,
+            Progress_Context);
+    }
+}
+
+/* the remote file ends at this position: forget queued chunks past it.
+   Outstanding ones are left to complete, normally with no data. */
+static void file_transfer_end_set(
+    uint32_t position)
+{
+    unsigned i = 0;
+
+    if (!End_Known || (position < End_Position)) {
+        End_Position = position;
+        End_Known = true;
+    }
+    for (i = 0; i < FILE_TRANSFER_CHUNK_MAX; i++) {
+        if (Chunks[i].used && (Chunks[i].invoke_id == 0) &&
+            (Chunks[i].start >= End_Position)) {
+            Chunks[i].used = false;
+        }
+    }
+}
+
+/* split a chunk the peer could not handle, and send smaller from now on */
+static bool file_transfer_chunk_split(
+    FILE_TRANSFER_CHUNK * pChunk)
+{
+    FILE_TRANSFER_CHUNK *pTail = NULL;
+    uint32_t half = pChunk->count / 2;
+
+    if (half < FILE_TRANSFER_CHUNK_MIN) {
+        return false;
+    }
+    pTail = file_transfer_chunk_alloc();
+    if (!pTail) {
+        return false;
+    }
+    pTail->start = pChunk->start + half;
+    pTail->count = pChunk->count - half;
+    pChunk->count = half;
+    pChunk->invoke_id = 0;
+    Chunk_Size_Limit = half;
+
+    return true;
+}
+
+static void file_transfer_complete(
+    BACNET_TSM_REPLY * reply,
+    void *context);
+
+/* returns false if the chunk could not be sent yet */
+static bool file_transfer_chunk_send(
+    FILE_TRANSFER_CHUNK * pChunk)
+{
+    static BACNET_OCTET_STRING fileData;
+    uint8_t invoke_id = 0;
+    size_t len = 0;
+    unsigned pad_len = 0;
+
+    if (Writing) {
+        if (fseek(Local_File, (long) pChunk->start, SEEK_SET) == 0) {
+            len =
+                fread(octetstring_value(&fileData), 1, pChunk->count,
+                Local_File);
+        }
+        if (len != pChunk->count) {
+#if PRINT_ENABLED
+            fprintf(stderr, "Unable to read %u bytes at %u!\n",
+                (unsigned) pChunk->count, (unsigned) pChunk->start);
+#endif
+            Status = FILE_TRANSFER_FAILED;
+            return false;
+        }
+        if (Pad_Enable && ((pChunk->start + len) >= End_Position)) {
+            /* fill the last chunk out to a whole one */
+            pad_len = file_transfer_chunk_size();
+            if (pad_len > len) {
+                memset(octetstring_value(&fileData) + len, (int) Pad_Value,
+                    pad_len - len);
+                len = pad_len;
+            }
+        }
+        octetstring_truncate(&fileData, len);
+        invoke_id =
+            Send_Atomic_Write_File_Stream(Device_ID, File_Instance,
+            (int) pChunk->start, &fileData);
+    } else {
+        invoke_id =
+            Send_Atomic_Read_File_Stream(Device_ID, File_Instance,
+            (int) pChunk->start, pChunk->count);
+    }
+    if (invoke_id == 0) {
+        /* out of invoke IDs is temporary, anything else is not */
+        if (tsm_transaction_available()) {
+#if PRINT_ENABLED
+            fprintf(stderr, "Unable to send the request at %u!\n",
+                (unsigned) pChunk->start);
+#endif
+            Status = FILE_TRANSFER_FAILED;
+        }
+        return false;
+    }
+    if (!tsm_set_completion(invoke_id, file_transfer_complete, pChunk)) {
+        /* the request is not waiting on a reply: send it again later */
+        tsm_free_invoke_id(invoke_id);
+        return false;
+    }
+    pChunk->invoke_id = invoke_id;
+
+    return true;
+}
+
+static bool file_transfer_start(
+    uint32_t device_id,
+    uint32_t file_instance,
+    FILE * pFile,
+    unsigned window,
+    bool writing)
+{
+    unsigned max_apdu = 0;
+    long size = 0;
+
+    if ((Status == FILE_TRANSFER_BUSY) || !pFile) {
+        return false;
+    }
+    if (!address_get_by_device(device_id, &max_apdu, &Target_Address)) {
+        return false;
+    }
+    if (writing) {
+        if (fseek(pFile, 0, SEEK_END) == 0) {
+            size = ftell(pFile);
+        }
+        if (size < 0) {
+            return false;
+        }
+    }
+    memset(Chunks, 0, sizeof(Chunks));
+    Writing = writing;
+    Device_ID = device_id;
+    File_Instance = file_instance;
+    Local_File = pFile;
+    if (window == 0) {
+        window = FILE_TRANSFER_WINDOW_DEFAULT;
+    }
+    if (window > FILE_TRANSFER_WINDOW_MAX) {
+        window = FILE_TRANSFER_WINDOW_MAX;
+    }
+    if (window > MAX_TSM_TRANSACTIONS) {
+        window = MAX_TSM_TRANSACTIONS;
+    }
+    Window = window;
+    Next_Position = 0;
+    End_Position = (uint32_t) size;
+    End_Known = writing;
+    Started = false;
+    First_Acked = false;
+    Octets_Done = 0;
+    Chunk_Size_Limit = 0;
+    Status = FILE_TRANSFER_BUSY;
+
+    return true;
+}
+
+/** Start reading a remote File object into a local file.
+ * The device must already be bound in the address cache.
+ * @param device_id [in] device instance holding the File object
+ * @param file_instance [in] File object instance
+ * @param pFile [in] local file opened for writing
+ * @param window [in] requests kept in flight, or 0 for the default
+ * @return true if the transfer was started
+ */
+bool File_Transfer_Read_Start(
+    uint32_t device_id,
+    uint32_t file_instance,
+    FILE * pFile,
+    unsigned window)
+{
+    return file_transfer_start(device_id, file_instance, pFile, window,
+        false);
+}
+
+/** Start writing a local file to a remote File object.
+ * The device must already be bound in the address cache.
+ * @param device_id [in] device instance holding the File object
+ * @param file_instance [in] File object instance
+ * @param pFile [in] local file opened for reading
+ * @param window [in] requests kept in flight, or 0 for the default
+ * @return true if the transfer was started
+ */
+bool File_Transfer_Write_Start(
+    uint32_t device_id,
+    uint32_t file_instance,
+    FILE * pFile,
+    unsigned window)
+{
+    return file_transfer_start(device_id, file_instance, pFile, window,
+        true);
+}
+
+/** Keep the transfer moving: resend chunks that timed out or came back
+ * short, and fill the window with new requests.  Call it from the main loop after the
+ * received PDUs and the TSM timer have been processed.
+ * @return the status of the transfer
+ */
+FILE_TRANSFER_STATUS File_Transfer_Task(
+    void)
+{
+    FILE_TRANSFER_CHUNK *pChunk = NULL;
+    unsigned outstanding = 0;
+    unsigned octets = 0;
+    unsigned i = 0;
+    bool pending = false;
+
+    if (Status != FILE_TRANSFER_BUSY) {
+        return Status;
+    }
+    for (i = 0; i < FILE_TRANSFER_CHUNK_MAX; i++) {
+        if (Chunks[i].used && Chunks[i].invoke_id) {
+            outstanding++;
+        }
+    }
+    /* chunks to resend, and the remainders of short reads and splits */
+    for (i = 0; (i < FILE_TRANSFER_CHUNK_MAX) && (outstanding < Window);
+        i++) {
+        pChunk = &Chunks[i];
+        if (!pChunk->used || pChunk->invoke_id) {
+            continue;
+        }
+        if (Writing && !First_Acked && (pChunk->start != 0)) {
+            continue;
+        }
+        if (!file_transfer_chunk_send(pChunk)) {
+            break;
+        }
+        outstanding++;
+    }
+    /* new chunks */
+    while ((Status == FILE_TRANSFER_BUSY) && (outstanding < Window)) {
+        if (Writing) {
+            if (Started && (!First_Acked || (Next_Position >= End_Position))) {
+                break;
+            }
+        } else if (End_Known && (Next_Position >= End_Position)) {
+            break;
+        }
+        pChunk = file_transfer_chunk_alloc();
+        if (!pChunk) {
+            break;
+        }
+        octets = file_transfer_chunk_size();
+        if (Writing && ((End_Position - Next_Position) < octets)) {
+            octets = End_Position - Next_Position;
+        }
+        pChunk->start = Next_Position;
+        pChunk->count = octets;
+        Next_Position += octets;
+        Started = true;
+        if (!file_transfer_chunk_send(pChunk)) {
+            break;
+        }
+        outstanding++;
+    }
+    if (Status == FILE_TRANSFER_BUSY) {
+        for (i = 0; i < FILE_TRANSFER_CHUNK_MAX; i++) {
+            if (Chunks[i].used) {
+                pending = true;
+                break;
+            }
+        }
+        if (!pending && Started && End_Known &&
+            (Next_Position >= End_Position)) {
+            Status = FILE_TRANSFER_DONE;
+        }
+    }
+
+    return Status;
+}
+
+FILE_TRANSFER_STATUS File_Transfer_Status(
+    void)
+{
+    return Status;
+}
+
+uint32_t File_Transfer_Octets(
+    void)
+{
+    return Octets_Done;
+}
+
+void File_Transfer_Progress_Set(
+    file_transfer_progress_function pFunction,
+    void *context)
+{
+    Progress_Function = pFunction;
+    Progress_Context = context;
+}
+
+/* 0 sizes chunks from the peer's Max APDU */
+void File_Transfer_Chunk_Size_Set(
+    unsigned octets)
+{
+    Chunk_Size_Fixed = octets;
+}
+
+/* pad the last chunk written out to a whole chunk */
+void File_Transfer_Pad_Set(
+    bool enable,
+    uint8_t value)
+{
+    Pad_Enable = enable;
+    Pad_Value = value;
+}
+
+static void file_transfer_read_ack(
+    FILE_TRANSFER_CHUNK * pChunk,
+    BACNET_TSM_REPLY * reply)
+{
+    BACNET_ATOMIC_READ_FILE_DATA data;
+    uint32_t octets = 0;
+    int len = 0;
+
+    len =
+        arf_ack_decode_service_request(reply->service_data,
+        reply->service_data_len, &data);
+    if ((len <= 0) || (data.access != FILE_STREAM_ACCESS) ||
+        (data.type.stream.fileStartPosition != (int32_t) pChunk->start)) {
+#if PRINT_ENABLED
+        fprintf(stderr, "Decode error! %d bytes decoded.\n", len);
+#endif
+        Status = FILE_TRANSFER_FAILED;
+        return;
+    }
+    octets = octetstring_length(&data.fileData[0]);
+    if (octets > pChunk->count) {
+        octets = pChunk->count;
+    }
+    if (octets) {
+        if ((fseek(Local_File, (long) pChunk->start, SEEK_SET) != 0) ||
+            (fwrite(octetstring_value(&data.fileData[0]), 1, octets,
+                    Local_File) != octets)) {
+#if PRINT_ENABLED
+            fprintf(stderr, "Unable to write %u bytes at %u!\n",
+                (unsigned) octets, (unsigned) pChunk->start);
+#endif
+            Status = FILE_TRANSFER_FAILED;
+            return;
+        }
+    }
+    Octets_Done += octets;
+    if (data.endOfFile) {
+        pChunk->used = false;
+        file_transfer_end_set(pChunk->start + octets);
+    } else if (octets == 0) {
+#if PRINT_ENABLED
+        fprintf(stderr, "Received 0 byte octet string!\n");
+#endif
+        Status = FILE_TRANSFER_FAILED;
+        return;
+    } else if (octets < pChunk->count) {
+        /* the peer sent less than we asked: queue the rest */
+        pChunk->start += octets;
+        pChunk->count -= octets;
+        pChunk->retries = 0;
+    } else {
+        pChunk->used = false;
+    }
+    file_transfer_progress();
+}
+
+static void file_transfer_write_ack(
+    FILE_TRANSFER_CHUNK * pChunk,
+    BACNET_TSM_REPLY * reply)
+{
+    BACNET_ATOMIC_WRITE_FILE_DATA data;
+    int len = 0;
+
+    len =
+        awf_ack_decode_service_request(reply->service_data,
+        reply->service_data_len, &data);
+    if (len <= 0) {
+#if PRINT_ENABLED
+        fprintf(stderr, "Decode error! %d bytes decoded.\n", len);
+#endif
+        Status = FILE_TRANSFER_FAILED;
+        return;
+    }
+    if (pChunk->start == 0) {
+        First_Acked = true;
+    }
+    Octets_Done += pChunk->count;
+    pChunk->used = false;
+    file_transfer_progress();
+}
+
+static void file_transfer_error(
+    FILE_TRANSFER_CHUNK * pChunk,
+    BACNET_ERROR_CLASS error_class,
+    BACNET_ERROR_CODE error_code)
+{
+    if (!Writing && (error_class == ERROR_CLASS_SERVICES) &&
+        (error_code == ERROR_CODE_INVALID_FILE_START_POSITION)) {
+        /* we read past the end of the file */
+        pChunk->used = false;
+        file_transfer_end_set(pChunk->start);
+        file_transfer_progress();
+        return;
+    }
+#if PRINT_ENABLED
+    fprintf(stderr, "\rBACnet Error: %s: %s\n",
+        bactext_error_class_name((int) error_class),
+        bactext_error_code_name((int) error_code));
+#endif
+    Status = FILE_TRANSFER_FAILED;
+}
+
+static void file_transfer_abort(
+    FILE_TRANSFER_CHUNK * pChunk,
+    uint8_t abort_reason)
+{
+    if (((abort_reason == ABORT_REASON_SEGMENTATION_NOT_SUPPORTED) ||
+            (abort_reason == ABORT_REASON_BUFFER_OVERFLOW)) &&
+        file_transfer_chunk_split(pChunk)) {
+        return;
+    }
+#if PRINT_ENABLED
+    fprintf(stderr, "\rBACnet Abort: %s\n",
+        bactext_abort_reason_name((int) abort_reason));
+#endif
+    Status = FILE_TRANSFER_FAILED;
+}
+
+/* the TSM gave up on the chunk: File_Transfer_Task() sends it again */
+static void file_transfer_timeout(
+    FILE_TRANSFER_CHUNK * pChunk)
+{
+    if (End_Known && (pChunk->start >= End_Position)) {
+        pChunk->used = false;
+    } else if (++pChunk->retries > FILE_TRANSFER_RETRIES) {
+#if PRINT_ENABLED
+        fprintf(stderr, "\rError: TSM Timeout!\n");
+#endif
+        Status = FILE_TRANSFER_FAILED;
+    }
+}
+
+/* the TSM hands us the reply to each chunk, matched by invoke ID and
+   peer address, so the application keeps its own ACK, error, abort and
+   reject handlers for everything else */
+static void file_transfer_complete(
+    BACNET_TSM_REPLY * reply,
+    void *context)
+{
+    FILE_TRANSFER_CHUNK *pChunk = (FILE_TRANSFER_CHUNK *) context;
+
+    if ((Status != FILE_TRANSFER_BUSY) || !pChunk->used ||
+        (pChunk->invoke_id != reply->invoke_id)) {
+        /* the reply to a transfer that has already ended */
+        return;
+    }
+    /* the invoke ID has been freed, so the chunk is no longer outstanding */
+    pChunk->invoke_id = 0;
+    switch (reply->result) {
+        case TSM_RESULT_ACK:
+            if (Writing) {
+                file_transfer_write_ack(pChunk, reply);
+            } else {
+                file_transfer_read_ack(pChunk, reply);
+            }
+            break;
+        case TSM_RESULT_ERROR:
+            file_transfer_error(pChunk, reply->error_class,
+                reply->error_code);
+            break;
+        case TSM_RESULT_ABORT:
+            file_transfer_abort(pChunk, reply->reason);
+            break;
+        case TSM_RESULT_TIMEOUT:
+            file_transfer_timeout(pChunk);
+            break;
+        case TSM_RESULT_REJECT:
+#if PRINT_ENABLED
+            fprintf(stderr, "\rBACnet Reject: %s\n",
+                bactext_reject_reason_name((int) reply->reason));
+#endif
+            Status = FILE_TRANSFER_FAILED;
+            break;
+        default:
+            Status = FILE_TRANSFER_FAILED;
+            break;
+    }
+}
+
+/** Forget any earlier transfer.
+ * The replies to the requests of a transfer come back by way of the TSM,
+ * so no service handlers are registered and those of the application
+ * are left alone.
+ */
+void File_Transfer_Init(
+    void)
+{
+    memset(Chunks, 0, sizeof(Chunks));
+    Status = FILE_TRANSFER_IDLE;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include "ctest.h"
+
+/* the requests the transfer has sent, by invoke ID */
+typedef struct test_request {
+    uint32_t start;
+    uint32_t count;
+    tsm_completion_function completion;
+    void *context;
+} TEST_REQUEST;
+
+static TEST_REQUEST Test_Requests[256];
+static uint8_t Test_Invoke_ID;
+
+bool address_get_by_device(
+    uint32_t device_id,
+    unsigned *max_apdu,
+    BACNET_ADDRESS * src)
+{
+    (void) device_id;
+    *max_apdu = 480;
+    memset(src, 0, sizeof(*src));
+    src->mac_len = 1;
+    src->mac[0] = 1;
+
+    return true;
+}
+
+static uint8_t testSend(
+    int fileStartPosition,
+    unsigned count)
+{
+    Test_Invoke_ID++;
+    memset(&Test_Requests[Test_Invoke_ID], 0, sizeof(TEST_REQUEST));
+    Test_Requests[Test_Invoke_ID].start = (uint32_t) fileStartPosition;
+    Test_Requests[Test_Invoke_ID].count = count;
+
+    return Test_Invoke_ID;
+}
+
+uint8_t Send_Atomic_Read_File_Stream(
+    uint32_t device_id,
+    uint32_t file_instance,
+    int fileStartPosition,
+    unsigned requestedOctetCount)
+{
+    (void) device_id;
+    (void) file_instance;
+
+    return testSend(fileStartPosition, requestedOctetCount);
+}
+
+uint8_t Send_Atomic_Write_File_Stream(
+    uint32_t device_id,
+    uint32_t file_instance,
+    int fileStartPosition,
+    BACNET_OCTET_STRING * fileData)
+{
+    (void) device_id;
+    (void) file_instance;
+
+    return testSend(fileStartPosition, octetstring_length(fileData));
+}
+
+bool tsm_transaction_available(
+    void)
+{
+    return true;
+}
+
+bool tsm_set_completion(
+    uint8_t invokeID,
+    tsm_completion_function pFunction,
+    void *context)
+{
+    Test_Requests[invokeID].completion = pFunction;
+    Test_Requests[invokeID].context = context;
+
+    return true;
+}
+
+void tsm_free_invoke_id(
+    uint8_t invokeID)
+{
+    (void) invokeID;
+}
+
+/* hand a reply to the completion function, as tsm_complete() does */
+static void testReply(
+    uint8_t invoke_id,
+    BACNET_TSM_REPLY * reply)
+{
+    reply->invoke_id = invoke_id;
+    Test_Requests[invoke_id].completion(reply,
+        Test_Requests[invoke_id].context);
+}
+
+static void testReplyResult(
+    uint8_t invoke_id,
+    BACNET_TSM_RESULT result,
+    uint8_t reason)
+{
+    BACNET_TSM_REPLY reply;
+
+    memset(&reply, 0, sizeof(reply));
+    reply.result = result;
+    reply.reason = reason;
+    testReply(invoke_id, &reply);
+}
+
+static void testReplyError(
+    uint8_t invoke_id,
+    BACNET_ERROR_CLASS error_class,
+    BACNET_ERROR_CODE error_code)
+{
+    BACNET_TSM_REPLY reply;
+
+    memset(&reply, 0, sizeof(reply));
+    reply.result = TSM_RESULT_ERROR;
+    reply.error_class = error_class;
+    reply.error_code = error_code;
+    testReply(invoke_id, &reply);
+}
+
+/* read ACK holding 'count' octets of the pattern at the request's start */
+static void testReadAck(
+    uint8_t invoke_id,
+    uint32_t count,
+    bool end_of_file)
+{
+    BACNET_ATOMIC_READ_FILE_DATA data;
+    BACNET_TSM_REPLY reply;
+    uint8_t apdu[MAX_APDU];
+    uint8_t *octets = NULL;
+    uint32_t i = 0;
+    int len = 0;
+
+    memset(&data, 0, sizeof(data));
+    data.access = FILE_STREAM_ACCESS;
+    data.type.stream.fileStartPosition =
+        (int32_t) Test_Requests[invoke_id].start;
+    data.endOfFile = end_of_file;
+    octets = octetstring_value(&data.fileData[0]);
+    for (i = 0; i < count; i++) {
+        octets[i] = (uint8_t) (Test_Requests[invoke_id].start + i);
+    }
+    octetstring_truncate(&data.fileData[0], count);
+    len = arf_ack_encode_apdu(apdu, invoke_id, &data);
+    memset(&reply, 0, sizeof(reply));
+    reply.result = TSM_RESULT_ACK;
+    reply.service_choice = SERVICE_CONFIRMED_ATOMIC_READ_FILE;
+    /* skip the complex ACK header */
+    reply.service_data = &apdu[3];
+    reply.service_data_len = (uint16_t) (len - 3);
+    testReply(invoke_id, &reply);
+}
+
+static void testWriteAck(
+    uint8_t invoke_id)
+{
+    BACNET_ATOMIC_WRITE_FILE_DATA data;
+    BACNET_TSM_REPLY reply;
+    uint8_t apdu[MAX_APDU];
+    int len = 0;
+
+    memset(&data, 0, sizeof(data));
+    data.access = FILE_STREAM_ACCESS;
+    data.type.stream.fileStartPosition =
+        (int32_t) Test_Requests[invoke_id].start;
+    len = awf_ack_encode_apdu(apdu, invoke_id, &data);
+    memset(&reply, 0, sizeof(reply));
+    reply.result = TSM_RESULT_ACK;
+    reply.service_choice = SERVICE_CONFIRMED_ATOMIC_WRITE_FILE;
+    reply.service_data = &apdu[3];
+    reply.service_data_len = (uint16_t) (len - 3);
+    testReply(invoke_id, &reply);
+}
+
+static void testStart(
+    void)
+{
+    File_Transfer_Init();
+    File_Transfer_Chunk_Size_Set(100);
+    Test_Invoke_ID = 0;
+}
+
+void testFileTransferReadWindow(
+    Test * pTest)
+{
+    FILE *pFile = NULL;
+    uint8_t buffer[400];
+    uint32_t i = 0;
+
+    testStart();
+    pFile = tmpfile();
+    ct_test(pTest, pFile != NULL);
+    ct_test(pTest, File_Transfer_Read_Start(1234, 1, pFile, 4));
+    /* the window fills with requests for consecutive chunks */
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_BUSY);
+    ct_test(pTest, Test_Invoke_ID == 4);
+    for (i = 1; i <= 4; i++) {
+        ct_test(pTest, Test_Requests[i].start == (i - 1) * 100);
+        ct_test(pTest, Test_Requests[i].count == 100);
+    }
+    /* nothing more goes while the window is full */
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_BUSY);
+    ct_test(pTest, Test_Invoke_ID == 4);
+    /* an ACK out of order makes room for the next chunk */
+    testReadAck(2, 100, false);
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_BUSY);
+    ct_test(pTest, Test_Invoke_ID == 5);
+    ct_test(pTest, Test_Requests[5].start == 400);
+    /* a chunk the TSM gave up on is sent again */
+    testReplyResult(1, TSM_RESULT_TIMEOUT, 0);
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_BUSY);
+    ct_test(pTest, Test_Invoke_ID == 6);
+    ct_test(pTest, Test_Requests[6].start == 0);
+    ct_test(pTest, Test_Requests[6].count == 100);
+    /* a short read queues the rest of the chunk */
+    testReadAck(6, 40, false);
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_BUSY);
+    ct_test(pTest, Test_Invoke_ID == 7);
+    ct_test(pTest, Test_Requests[7].start == 40);
+    ct_test(pTest, Test_Requests[7].count == 60);
+    /* a chunk too big for the path is split in two */
+    testReplyResult(3, TSM_RESULT_ABORT,
+        ABORT_REASON_SEGMENTATION_NOT_SUPPORTED);
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_BUSY);
+    ct_test(pTest, Test_Invoke_ID == 8);
+    ct_test(pTest, Test_Requests[8].start == 200);
+    ct_test(pTest, Test_Requests[8].count == 50);
+    /* the end of the file stops new chunks */
+    testReadAck(4, 100, true);
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_BUSY);
+    ct_test(pTest, Test_Invoke_ID == 9);
+    ct_test(pTest, Test_Requests[9].start == 250);
+    ct_test(pTest, Test_Requests[9].count == 50);
+    /* and the chunk past the end is dropped */
+    testReplyError(5, ERROR_CLASS_SERVICES,
+        ERROR_CODE_INVALID_FILE_START_POSITION);
+    testReadAck(7, 60, false);
+    testReadAck(8, 50, false);
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_BUSY);
+    testReadAck(9, 50, false);
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_DONE);
+    ct_test(pTest, Test_Invoke_ID == 9);
+    ct_test(pTest, File_Transfer_Octets() == 400);
+    /* every octet landed at its own offset */
+    ct_test(pTest, fseek(pFile, 0, SEEK_END) == 0);
+    ct_test(pTest, ftell(pFile) == 400);
+    rewind(pFile);
+    ct_test(pTest, fread(buffer, 1, sizeof(buffer), pFile) == 400);
+    for (i = 0; i < 400; i++) {
+        ct_test(pTest, buffer[i] == (uint8_t) i);
+    }
+    fclose(pFile);
+}
+
+void testFileTransferRetries(
+    Test * pTest)
+{
+    FILE *pFile = NULL;
+    uint8_t invoke_id = 0;
+    uint8_t last_id = 0;
+    unsigned i = 0;
+
+    testStart();
+    pFile = tmpfile();
+    ct_test(pTest, pFile != NULL);
+    ct_test(pTest, File_Transfer_Read_Start(1234, 1, pFile, 2));
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_BUSY);
+    ct_test(pTest, Test_Invoke_ID == 2);
+    invoke_id = 1;
+    for (i = 0; i < FILE_TRANSFER_RETRIES; i++) {
+        last_id = Test_Invoke_ID;
+        testReplyResult(invoke_id, TSM_RESULT_TIMEOUT, 0);
+        ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_BUSY);
+        ct_test(pTest, Test_Invoke_ID == last_id + 1);
+        ct_test(pTest, Test_Requests[Test_Invoke_ID].start == 0);
+        /* a late reply to the old request is not taken */
+        testReadAck(invoke_id, 100, false);
+        ct_test(pTest, File_Transfer_Octets() == 0);
+        invoke_id = Test_Invoke_ID;
+    }
+    /* the chunk has run out of retries */
+    testReplyResult(invoke_id, TSM_RESULT_TIMEOUT, 0);
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_FAILED);
+    /* replies to a failed transfer are ignored */
+    testReadAck(2, 100, false);
+    ct_test(pTest, File_Transfer_Octets() == 0);
+    fclose(pFile);
+}
+
+void testFileTransferReject(
+    Test * pTest)
+{
+    FILE *pFile = NULL;
+
+    testStart();
+    pFile = tmpfile();
+    ct_test(pTest, pFile != NULL);
+    ct_test(pTest, File_Transfer_Read_Start(1234, 1, pFile, 2));
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_BUSY);
+    testReplyResult(2, TSM_RESULT_REJECT, REJECT_REASON_OTHER);
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_FAILED);
+    /* an abort we can't fix fails it too */
+    ct_test(pTest, File_Transfer_Read_Start(1234, 1, pFile, 2));
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_BUSY);
+    testReplyResult(Test_Invoke_ID, TSM_RESULT_ABORT, ABORT_REASON_OTHER);
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_FAILED);
+    fclose(pFile);
+}
+
+void testFileTransferWrite(
+    Test * pTest)
+{
+    FILE *pFile = NULL;
+    uint8_t buffer[250];
+
+    testStart();
+    pFile = tmpfile();
+    ct_test(pTest, pFile != NULL);
+    memset(buffer, 0x55, sizeof(buffer));
+    ct_test(pTest, fwrite(buffer, 1, sizeof(buffer), pFile) == 250);
+    ct_test(pTest, File_Transfer_Write_Start(1234, 1, pFile, 4));
+    /* the first chunk truncates the file, so it goes alone */
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_BUSY);
+    ct_test(pTest, Test_Invoke_ID == 1);
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_BUSY);
+    ct_test(pTest, Test_Invoke_ID == 1);
+    testWriteAck(1);
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_BUSY);
+    ct_test(pTest, Test_Invoke_ID == 3);
+    ct_test(pTest, Test_Requests[2].start == 100);
+    ct_test(pTest, Test_Requests[2].count == 100);
+    ct_test(pTest, Test_Requests[3].start == 200);
+    ct_test(pTest, Test_Requests[3].count == 50);
+    testWriteAck(3);
+    testReplyResult(2, TSM_RESULT_TIMEOUT, 0);
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_BUSY);
+    ct_test(pTest, Test_Invoke_ID == 4);
+    ct_test(pTest, Test_Requests[4].start == 100);
+    testWriteAck(4);
+    ct_test(pTest, File_Transfer_Task() == FILE_TRANSFER_DONE);
+    ct_test(pTest, File_Transfer_Octets() == 250);
+    fclose(pFile);
+}
+
+#ifdef TEST_FILE_TRANSFER
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet File Transfer", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testFileTransferReadWindow);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testFileTransferRetries);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testFileTransferReject);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testFileTransferWrite);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif
+#endif
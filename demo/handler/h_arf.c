@@ -169,12 +169,7 @@ void handler_atomic_read_file(
 #endif
             }
         } else if (data.access == FILE_RECORD_ACCESS) {
-            if (data.type.record.fileStartRecord >=
-                BACNET_READ_FILE_RECORD_COUNT) {
-                error_class = ERROR_CLASS_SERVICES;
-                error_code = ERROR_CODE_INVALID_FILE_START_POSITION;
-                error = true;
-            } else if (bacfile_read_stream_data(&data)) {
+            if (bacfile_read_record_data(&data)) {
 #if PRINT_ENABLED
                 fprintf(stderr, "ARF: fileStartRecord %d, %u RecordCount.\n",
                     data.type.record.fileStartRecord,
@@ -184,9 +179,9 @@ void handler_atomic_read_file(
                     arf_ack_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
                     service_data->invoke_id, &data);
             } else {
+                error_class = ERROR_CLASS_SERVICES;
+                error_code = ERROR_CODE_INVALID_FILE_START_POSITION;
                 error = true;
-                error_class = ERROR_CLASS_OBJECT;
-                error_code = ERROR_CODE_FILE_ACCESS_DENIED;
             }
         } else {
             error = true;
@@ -35,6 +35,7 @@
 #include <stdio.h>      /* for standard i/o, like printing */
 #include <stdint.h>     /* for standard integer types uint8_t etc. */
 #include <stdbool.h>    /* for the standard bool type. */
+#include <stdlib.h>     /* for calloc */
 #include <string.h>    /* for memcpy */
 #include "bacdcode.h"
 #include "bip6.h"
@@ -62,35 +63,297 @@ static uint16_t BVLC6_Buffer_Len;
 #define MAX_BBMD6_ENTRIES 128
 #endif
 static BACNET_IP6_BROADCAST_DISTRIBUTION_TABLE_ENTRY BBMD_Table[MAX_BBMD6_ENTRIES];
-/* Foreign Device Table */
+/* Foreign Device Table - entries are allocated as devices register */
 #ifndef MAX_FD6_ENTRIES
-#define MAX_FD6_ENTRIES 128
+#define MAX_FD6_ENTRIES 4096
 #endif
-static BACNET_IP6_FOREIGN_DEVICE_TABLE_ENTRY FD_Table[MAX_FD6_ENTRIES];
+/* slots in the timer wheel that purges the FDT - a power of two */
+#ifndef FD6_WHEEL_SLOTS
+#define FD6_WHEEL_SLOTS 64
+#endif
+struct bbmd6_fdt_entry {
+    BACNET_IP6_FOREIGN_DEVICE_TABLE_ENTRY fdt;
+    /* FD6_Clock second at which the entry is purged */
+    uint32_t expires;
+    /* next entry in the same hash bucket */
+    struct bbmd6_fdt_entry *hash_next;
+    /* neighbours in the same timer wheel slot */
+    struct bbmd6_fdt_entry *wheel_next;
+    struct bbmd6_fdt_entry *wheel_prev;
+};
+/* FDT entries hashed by B/IPv6 address; the number of buckets is a
+   power of two, and grows with the number of entries */
+static struct bbmd6_fdt_entry **FD6_Hash;
+static unsigned FD6_Hash_Size;
+static unsigned FD6_Count;
+/* entries, by the second at which they expire modulo FD6_WHEEL_SLOTS */
+static struct bbmd6_fdt_entry *FD6_Wheel[FD6_WHEEL_SLOTS];
+/* seconds counted by bvlc6_maintenance_timer() */
+static uint32_t FD6_Clock;
+/* Forwarded-NPDU destinations in the FDT, other than us,
+   worked out again only when the FDT or our address changes */
+static BACNET_IP6_ADDRESS *FD6_Fanout;
+static unsigned FD6_Fanout_Size;
+static unsigned FD6_Fanout_Count;
+static bool FD6_Fanout_Valid;
+static BACNET_IP6_ADDRESS FD6_Fanout_Self;
+
+/* where bbmd6_send_forward_npdu() sends a Forwarded-NPDU */
+#define BBMD6_FORWARD_LOCAL 0x01        /* our local multicast address */
+#define BBMD6_FORWARD_BDT 0x02  /* each peer BBMD in the BDT */
+#define BBMD6_FORWARD_FDT 0x04  /* each foreign device in the FDT */
 #endif
 
 #if defined(BACDL_BIP6) && BBMD6_ENABLED
+/**
+ * Hashes a B/IPv6 address for the FDT
+ *
+ * @param addr - B/IPv6 address
+ *
+ * @return hash value, to be masked down to the number of buckets
+ */
+static unsigned bbmd6_fdt_hash(
+    BACNET_IP6_ADDRESS *addr)
+{
+    uint32_t hash = 2166136261UL;
+    unsigned i = 0;
+
+    for (i = 0; i < IP6_ADDRESS_MAX; i++) {
+        hash ^= addr->address[i];
+        hash *= 16777619UL;
+    }
+    hash ^= addr->port;
+    hash *= 16777619UL;
+
+    return (unsigned) hash;
+}
+
+/**
+ * Finds a foreign device in the FDT
+ *
+ * @param addr - B/IPv6 address of the foreign device
+ *
+ * @return the FDT entry, or NULL if not found
+ */
+static struct bbmd6_fdt_entry *bbmd6_fdt_find(
+    BACNET_IP6_ADDRESS *addr)
+{
+    struct bbmd6_fdt_entry *entry = NULL;
+
+    if (FD6_Hash) {
+        entry = FD6_Hash[bbmd6_fdt_hash(addr) & (FD6_Hash_Size - 1)];
+        while (entry) {
+            if (!bvlc6_address_different(&entry->fdt.bip6_address, addr)) {
+                break;
+            }
+            entry = entry->hash_next;
+        }
+    }
+
+    return entry;
+}
+
+static void bbmd6_fdt_wheel_insert(
+    struct bbmd6_fdt_entry *entry)
+{
+    struct bbmd6_fdt_entry **slot =
+        &FD6_Wheel[entry->expires % FD6_WHEEL_SLOTS];
+
+    entry->wheel_prev = NULL;
+    entry->wheel_next = *slot;
+    if (*slot) {
+        (*slot)->wheel_prev = entry;
+    }
+    *slot = entry;
+}
+
+static void bbmd6_fdt_wheel_remove(
+    struct bbmd6_fdt_entry *entry)
+{
+    if (entry->wheel_prev) {
+        entry->wheel_prev->wheel_next = entry->wheel_next;
+    } else {
+        FD6_Wheel[entry->expires % FD6_WHEEL_SLOTS] = entry->wheel_next;
+    }
+    if (entry->wheel_next) {
+        entry->wheel_next->wheel_prev = entry->wheel_prev;
+    }
+}
+
+/**
+ * Adds a foreign device to the FDT, or restarts its timer
+ *
+ * @param addr - B/IPv6 address of the foreign device
+ * @param ttl_seconds - Time-to-Live of the registration
+ *
+ * @return true if the foreign device is registered
+ */
+static bool bbmd6_fdt_register(
+    BACNET_IP6_ADDRESS *addr,
+    uint16_t ttl_seconds)
+{
+    struct bbmd6_fdt_entry *entry = NULL;
+    struct bbmd6_fdt_entry **hash = NULL;
+    struct bbmd6_fdt_entry *next = NULL;
+    unsigned size = 0;
+    unsigned bucket = 0;
+    unsigned i = 0;
+    uint32_t seconds = 0;
+
+    entry = bbmd6_fdt_find(addr);
+    if (entry) {
+        bbmd6_fdt_wheel_remove(entry);
+    } else {
+        if (FD6_Count >= MAX_FD6_ENTRIES) {
+            return false;
+        }
+        if (FD6_Count >= FD6_Hash_Size) {
+            /* double the buckets, and rehash */
+            size = FD6_Hash_Size ? FD6_Hash_Size * 2 : 64;
+            hash = calloc(size, sizeof(struct bbmd6_fdt_entry *));
+            if (hash) {
+                for (i = 0; i < FD6_Hash_Size; i++) {
+                    while (FD6_Hash[i]) {
+                        next = FD6_Hash[i]->hash_next;
+                        bucket =
+                            bbmd6_fdt_hash(&FD6_Hash[i]->fdt.bip6_address) &
+                            (size - 1);
+                        FD6_Hash[i]->hash_next = hash[bucket];
+                        hash[bucket] = FD6_Hash[i];
+                        FD6_Hash[i] = next;
+                    }
+                }
+                free(FD6_Hash);
+                FD6_Hash = hash;
+                FD6_Hash_Size = size;
+            } else if (!FD6_Hash) {
+                return false;
+            }
+        }
+        entry = calloc(1, sizeof(struct bbmd6_fdt_entry));
+        if (!entry) {
+            return false;
+        }
+        entry->fdt.valid = true;
+        bvlc6_address_copy(&entry->fdt.bip6_address, addr);
+        bucket = bbmd6_fdt_hash(addr) & (FD6_Hash_Size - 1);
+        entry->hash_next = FD6_Hash[bucket];
+        FD6_Hash[bucket] = entry;
+        FD6_Count++;
+        FD6_Fanout_Valid = false;
+    }
+    /* The number of seconds remaining shall be initialized to the
+       2-octet Time-to-Live value supplied at the time of registration
+       plus 30 seconds, with a maximum of 65535. */
+    seconds = (uint32_t) ttl_seconds + 30;
+    if (seconds > 65535) {
+        seconds = 65535;
+    }
+    entry->fdt.ttl_seconds = ttl_seconds;
+    entry->fdt.ttl_seconds_remaining = (uint16_t) seconds;
+    entry->expires = FD6_Clock + seconds;
+    bbmd6_fdt_wheel_insert(entry);
+
+    return true;
+}
+
+/**
+ * Removes a foreign device from the FDT
+ *
+ * @param entry - the FDT entry, which is freed
+ */
+static void bbmd6_fdt_remove(
+    struct bbmd6_fdt_entry *entry)
+{
+    struct bbmd6_fdt_entry **link = NULL;
+
+    bbmd6_fdt_wheel_remove(entry);
+    link = &FD6_Hash[bbmd6_fdt_hash(&entry->fdt.bip6_address) &
+        (FD6_Hash_Size - 1)];
+    while (*link != entry) {
+        link = &(*link)->hash_next;
+    }
+    *link = entry->hash_next;
+    free(entry);
+    FD6_Count--;
+    FD6_Fanout_Valid = false;
+}
+
+/**
+ * Works out the Forwarded-NPDU destinations in the FDT again,
+ * if the FDT or our address changed since the last time.
+ */
+static void bbmd6_fdt_fanout_update(
+    void)
+{
+    BACNET_IP6_ADDRESS my_addr = {{0}};
+    BACNET_IP6_ADDRESS *fanout = NULL;
+    struct bbmd6_fdt_entry *entry = NULL;
+    unsigned i = 0;
+
+    bip6_get_addr(&my_addr);
+    if (bvlc6_address_different(&my_addr, &FD6_Fanout_Self)) {
+        bvlc6_address_copy(&FD6_Fanout_Self, &my_addr);
+        FD6_Fanout_Valid = false;
+    }
+    if (FD6_Fanout_Valid) {
+        return;
+    }
+    FD6_Fanout_Count = 0;
+    if (FD6_Fanout_Size < FD6_Count) {
+        fanout = realloc(FD6_Fanout, FD6_Count * sizeof(BACNET_IP6_ADDRESS));
+        if (!fanout) {
+            /* try again next time */
+            return;
+        }
+        FD6_Fanout = fanout;
+        FD6_Fanout_Size = FD6_Count;
+    }
+    for (i = 0; i < FD6_Hash_Size; i++) {
+        for (entry = FD6_Hash[i]; entry; entry = entry->hash_next) {
+            if (bvlc6_address_different(&my_addr,
+                    &entry->fdt.bip6_address)) {
+                bvlc6_address_copy(&FD6_Fanout[FD6_Fanout_Count],
+                    &entry->fdt.bip6_address);
+                FD6_Fanout_Count++;
+            }
+        }
+    }
+    FD6_Fanout_Valid = true;
+}
+
 /** A timer function that is called about once a second.
+ *
+ * Each call only looks at the timer wheel slots for the seconds that
+ * have passed, so the cost does not grow with the size of the FDT.
  *
  * @param seconds - number of elapsed seconds since the last call
  */
-void bbmd6_maintenance_timer(
+void bvlc6_maintenance_timer(
     time_t seconds)
 {
-    unsigned i = 0;
+    struct bbmd6_fdt_entry *entry = NULL;
+    struct bbmd6_fdt_entry *next = NULL;
 
-    for (i = 0; i < MAX_FD_ENTRIES; i++) {
-        if (FD_Table[i].valid) {
-            if (FD_Table[i].seconds_remaining) {
-                if (FD_Table[i].seconds_remaining < seconds) {
-                    FD_Table[i].seconds_remaining = 0;
-                } else {
-                    FD_Table[i].seconds_remaining -= seconds;
-                }
-                if (FD_Table[i].seconds_remaining == 0) {
-                    FD_Table[i].valid = false;
-                }
+    if (seconds <= 0) {
+        return;
+    }
+    /* one turn of the wheel visits every slot */
+    if (seconds > FD6_WHEEL_SLOTS) {
+        FD6_Clock += (uint32_t) (seconds - FD6_WHEEL_SLOTS);
+        seconds = FD6_WHEEL_SLOTS;
+    }
+    while (seconds > 0) {
+        FD6_Clock++;
+        seconds--;
+        entry = FD6_Wheel[FD6_Clock % FD6_WHEEL_SLOTS];
+        while (entry) {
+            next = entry->wheel_next;
+            /* entries due on a later turn of the wheel stay put */
+            if (entry->expires <= FD6_Clock) {
+                bbmd6_fdt_remove(entry);
             }
+            entry = next;
         }
     }
 }
@@ -315,102 +578,57 @@ int bip6_send_pdu(
 
 #if defined(BACDL_BIP6) && BBMD6_ENABLED
 /**
- * The send function for Broacast Distribution Table
+ * Sends a Forwarded-NPDU to the local multicast address, the peer BBMDs
+ * in the BDT, and the foreign devices, as asked for.  The message is
+ * encoded once, and the same bytes are sent to every destination.
  *
- * @param addr - Points to a #BACNET_IP6_ADDRESS structure containing the
- *  source IPv6 address.
- * @param vmac_src - Source-Virtual-Address
- * @param npdu - the bytes of NPDU+APDU data to send
- * @param npdu_len - the number of bytes of NPDU+APDU data to send
- */
-static void bbmd6_send_pdu_bdt(
-    uint8_t * mtu,
-    unsigned int mtu_len)
-{
-    BACNET_IP6_ADDRESS my_addr = {{0}};
-    unsigned i = 0;     /* loop counter */
-
-    if (mtu) {
-        bip6_get_addr(&my_addr);
-        for (i = 0; i < MAX_BBMD_ENTRIES; i++) {
-            if (BBMD_Table[i].valid) {
-                if (bvlc6_address_different(&my_addr,
-                    &BBMD_Table[i].bip6_address)) {
-                    bip6_send_mpdu(&BBMD_Table[i].bip6_address, mtu, mtu_len);
-                }
-            }
-        }
-    }
-}
-
-/**
- * The send function for Broacast Distribution Table
- *
- * @param addr - Points to a #BACNET_IP6_ADDRESS structure containing the
- *  source IPv6 address.
- * @param vmac_src - Source-Virtual-Address
- * @param npdu - the bytes of NPDU+APDU data to send
- * @param npdu_len - the number of bytes of NPDU+APDU data to send
- */
-static void bbmd6_send_pdu_fdt(
-    uint8_t * mtu,
-    unsigned int mtu_len)
-{
-    BACNET_IP6_ADDRESS my_addr = {{0}};
-    unsigned i = 0;     /* loop counter */
-
-    if (mtu) {
-        bip6_get_addr(&my_addr);
-        for (i = 0; i < MAX_FD_ENTRIES; i++) {
-            if (FD_Table[i].valid) {
-                if (bvlc6_address_different(&my_addr,
-                    &FD_Table[i].bip6_address)) {
-                    bip6_send_mpdu(&FD_Table[i].bip6_address, mtu, mtu_len);
-                }
-            }
-        }
-    }
-}
-
-/**
- * The Forward NPDU send function for Broacast Distribution Table
- *
- * @param addr - Points to a #BACNET_IP6_ADDRESS structure containing the
- *  source IPv6 address.
+ * @param address - B/IPv6 address of the originating node, which is
+ *  sent in the message and is not sent to
  * @param vmac_src - Source-Virtual-Address
  * @param npdu - the bytes of NPDU+APDU data to send
  * @param npdu_len - the number of bytes of NPDU+APDU data to send
+ * @param destinations - BBMD6_FORWARD_LOCAL, BBMD6_FORWARD_BDT and
+ *  BBMD6_FORWARD_FDT, or'ed together
  */
 static void bbmd6_send_forward_npdu(
     BACNET_IP6_ADDRESS *address,
     uint32_t vmac_src,
     uint8_t * npdu,
-    unsigned int npdu_len)
+    uint16_t npdu_len,
+    unsigned destinations)
 {
-    uint8_t mtu[MAX_MPDU] = { 0 };
-    uint16_t mtu_len = 0;
+    BACNET_IP6_ADDRESS bvlc_dest = {{0}};
     unsigned i = 0;     /* loop counter */
 
-    for (i = 0; i < MAX_BBMD_ENTRIES; i++) {
-        if (BBMD_Table[i].valid) {
-            if (bbmd6_address_match_self(&BBMD_Table[i].bip6_address)) {
-                /* don't forward to our selves */
-            } else {
-                bip6_send_mpdu(&BBMD_Table[i].bip6_address, mtu, mtu_len);
+    BVLC6_Buffer_Len = bvlc6_encode_forwarded_npdu(
+        &BVLC6_Buffer[0], sizeof(BVLC6_Buffer),
+        vmac_src, address, npdu, npdu_len);
+    if (BVLC6_Buffer_Len == 0) {
+        return;
+    }
+    if (destinations & BBMD6_FORWARD_LOCAL) {
+        bip6_get_broadcast_addr(&bvlc_dest);
+        bip6_send_mpdu(&bvlc_dest, &BVLC6_Buffer[0], BVLC6_Buffer_Len);
+    }
+    if (destinations & BBMD6_FORWARD_BDT) {
+        for (i = 0; i < MAX_BBMD6_ENTRIES; i++) {
+            if (BBMD_Table[i].valid &&
+                !bbmd6_address_match_self(&BBMD_Table[i].bip6_address)) {
+                bip6_send_mpdu(&BBMD_Table[i].bip6_address,
+                    &BVLC6_Buffer[0], BVLC6_Buffer_Len);
             }
         }
     }
-    for (i = 0; i < MAX_FD_ENTRIES; i++) {
-        if (FD_Table[i].valid) {
-            if (bbmd6_address_match_self(&FD_Table[i].bip6_address)) {
-                /* don't forward to our selves */
-            } else {
-                bip6_send_mpdu(&FD_Table[i].bip6_address, mtu, mtu_len);
+    if (destinations & BBMD6_FORWARD_FDT) {
+        bbmd6_fdt_fanout_update();
+        for (i = 0; i < FD6_Fanout_Count; i++) {
+            if (bvlc6_address_different(&FD6_Fanout[i], address)) {
+                bip6_send_mpdu(&FD6_Fanout[i],
+                    &BVLC6_Buffer[0], BVLC6_Buffer_Len);
             }
         }
     }
 }
-
 #endif
 
 /**
@@ -802,7 +1020,6 @@ static int handler_bbmd6_for_non_bbmd(
 }
 
 #if defined(BACDL_BIP6) && BBMD6_ENABLED
-#warning FIXME: Needs ported to IPv6
 /**
  * Use this handler when you are a BBMD.
  * Sets the BVLC6_Function_Code in case it is needed later.
@@ -821,10 +1038,11 @@ static int handler_bbmd6_for_bbmd(
     uint16_t mtu_len)
 {
     uint16_t result_code = BVLC6_RESULT_SUCCESSFUL_COMPLETION;
-    uint32_t vmac_me = 0;
     uint32_t vmac_src = 0;
     uint32_t vmac_dst = 0;
-    uint32_t vmac_target = 0;
+    uint16_t ttl_seconds = 0;
+    BACNET_IP6_FOREIGN_DEVICE_TABLE_ENTRY fdt_entry = { 0 };
+    struct bbmd6_fdt_entry *entry = NULL;
     uint8_t message_type = 0;
     uint16_t message_length = 0;
     int header_len = 0;
@@ -859,16 +1077,57 @@ static int handler_bbmd6_for_bbmd(
                 }
                 break;
             case BVLC6_REGISTER_FOREIGN_DEVICE:
-                result_code = BVLC6_RESULT_REGISTER_FOREIGN_DEVICE_NAK;
+                debug_printf("BIP6: Received Register-Foreign-Device.\n");
+                function_len = bvlc6_decode_register_foreign_device(
+                    pdu, pdu_len, &vmac_src, &ttl_seconds);
+                if (function_len && bbmd6_fdt_register(addr, ttl_seconds)) {
+                    bbmd6_add_vmac(vmac_src, addr);
+                    result_code = BVLC6_RESULT_SUCCESSFUL_COMPLETION;
+                } else {
+                    result_code = BVLC6_RESULT_REGISTER_FOREIGN_DEVICE_NAK;
+                }
                 send_result = true;
                 break;
             case BVLC6_DELETE_FOREIGN_DEVICE:
-                result_code = BVLC6_RESULT_DELETE_FOREIGN_DEVICE_NAK;
+                debug_printf("BIP6: Received Delete-Foreign-Device.\n");
+                function_len = bvlc6_decode_delete_foreign_device(
+                    pdu, pdu_len, &vmac_src, &fdt_entry);
+                entry = NULL;
+                if (function_len) {
+                    entry = bbmd6_fdt_find(&fdt_entry.bip6_address);
+                }
+                if (entry) {
+                    bbmd6_fdt_remove(entry);
+                    result_code = BVLC6_RESULT_SUCCESSFUL_COMPLETION;
+                } else {
+                    result_code = BVLC6_RESULT_DELETE_FOREIGN_DEVICE_NAK;
+                }
                 send_result = true;
                 break;
             case BVLC6_DISTRIBUTE_BROADCAST_TO_NETWORK:
-                result_code = BVLC6_RESULT_DISTRIBUTE_BROADCAST_TO_NETWORK_NAK;
-                send_result = true;
+                debug_printf(
+                    "BIP6: Received Distribute-Broadcast-To-Network.\n");
+                function_len = bvlc6_decode_distribute_broadcast_to_network(
+                    pdu, pdu_len, &vmac_src, NULL, 0, &npdu_len);
+                if (function_len && bbmd6_fdt_find(addr)) {
+                    offset = header_len + (function_len - npdu_len);
+                    npdu = &mtu[offset];
+                    /*  Upon receipt of a BVLL Distribute-Broadcast-To-Network
+                        message from a registered foreign device, the
+                        receiving BBMD shall transmit a BVLL Forwarded-NPDU
+                        message on its local multicast domain, to each
+                        entry in its BDT, and to each foreign device in
+                        its FDT except the originating node. */
+                    bbmd6_send_forward_npdu(addr, vmac_src, npdu, npdu_len,
+                        BBMD6_FORWARD_LOCAL | BBMD6_FORWARD_BDT |
+                        BBMD6_FORWARD_FDT);
+                    bbmd6_add_vmac(vmac_src, addr);
+                    bvlc6_vmac_address_set(src, vmac_src);
+                } else {
+                    result_code =
+                        BVLC6_RESULT_DISTRIBUTE_BROADCAST_TO_NETWORK_NAK;
+                    send_result = true;
+                }
                 break;
             case BVLC6_ORIGINAL_UNICAST_NPDU:
                 /* This message is used to send directed NPDUs to
@@ -911,12 +1170,8 @@ static int handler_bbmd6_for_bbmd(
                         the constructed BVLL Forwarded-NPDU message shall
                         be unicast to each foreign device currently in
                         the BBMD's FDT */
-                    BVLC6_Buffer_Len = bvlc6_encode_forwarded_npdu(
-                        &BVLC6_Buffer[0], sizeof(BVLC6_Buffer),
-                        vmac_src, addr,
-                        npdu, npdu_len);
-                    bbmd6_send_pdu_bdt(&BVLC6_Buffer[0], BVLC6_Buffer_Len);
-                    bbmd6_send_pdu_fdt(&BVLC6_Buffer[0], BVLC6_Buffer_Len);
+                    bbmd6_send_forward_npdu(addr, vmac_src, npdu, npdu_len,
+                        BBMD6_FORWARD_BDT | BBMD6_FORWARD_FDT);
                     if (!bbmd6_address_match_self(addr)) {
                         /* The Virtual MAC address table shall be updated
                            using the respective parameter values of the
@@ -928,6 +1183,11 @@ static int handler_bbmd6_for_bbmd(
                 break;
             case BVLC6_FORWARDED_NPDU:
                 debug_printf("BIP6: Received Forwarded-NPDU.\n");
+                if (bbmd6_address_match_self(addr)) {
+                    /* our own multicast, which we must not send again */
+                    debug_printf("BIP6: Forwarded-NPDU is me!\n");
+                    break;
+                }
                 function_len = bvlc6_decode_forwarded_npdu(
                     pdu, pdu_len,
                     &vmac_src, &fwd_address,
@@ -940,12 +1200,6 @@ static int handler_bbmd6_for_bbmd(
                         a BBMD shall construct a BVLL Forwarded-NPDU and
                         transmit it via multicast to B/IPv6 devices in the
                         local multicast domain. */
-                    BVLC6_Buffer_Len = bvlc6_encode_forwarded_npdu(
-                        &BVLC6_Buffer[0], sizeof(BVLC6_Buffer),
-                        vmac_src, addr,
-                        npdu, npdu_len);
-                    bip6_get_broadcast_addr(&bvlc_dest);
-                    bip6_send_mpdu(&bvlc_dest, &BVLC6_Buffer[0], BVLC6_Buffer_Len);
                     /*  In addition, the constructed BVLL Forwarded-NPDU
                         message shall be unicast to each foreign device in
                         the BBMD's FDT. If the BBMD is unable to transmit
@@ -953,8 +1207,10 @@ static int handler_bbmd6_for_bbmd(
                         from a BBMD which is in the receiving BBMD's BDT,
                         no BVLC-Result shall be returned and the message
                         shall be discarded. */
-                    bbmd6_send_pdu_fdt(&BVLC6_Buffer[0], BVLC6_Buffer_Len);
-                    if (!bbmd6_address_match_self(addr)) {
+                    bbmd6_send_forward_npdu(&fwd_address, vmac_src,
+                        npdu, npdu_len,
+                        BBMD6_FORWARD_LOCAL | BBMD6_FORWARD_FDT);
+                    {
                         /* The Virtual MAC address table shall be updated
                            using the respective parameter values of the
                            incoming messages. */
@@ -1078,11 +1334,12 @@ void bvlc6_init(void)
 #include <string.h>
 #include "ctest.h"
 static uint32_t Device_ID = 0;
-static uint32_t Test_Device_ID = 12345;
 static BACNET_IP6_ADDRESS BIP6_Addr;
-static BACNET_IP6_ADDRESS Test_BIP6_Addr;
 static BACNET_IP6_ADDRESS BIP6_Broadcast_Addr;
-static uint8_t BIP6_MTU_Buffer[MAX_MPDU];
+/* number of MPDUs passed to bip6_send_mpdu(), and the last one */
+static unsigned BIP6_Send_Count;
+static uint8_t BIP6_Send_Buffer[MAX_MPDU];
+static uint16_t BIP6_Send_Len;
 
 /* network stub functions */
 /**
@@ -1120,7 +1377,11 @@ int bip6_send_mpdu(
     uint8_t * mtu,
     uint16_t mtu_len)
 {
-    return 0;
+    BIP6_Send_Count++;
+    memcpy(BIP6_Send_Buffer, mtu, mtu_len);
+    BIP6_Send_Len = mtu_len;
+
+    return mtu_len;
 }
 
 /** Return the Object Instance number for our (single) Device Object.
@@ -1196,6 +1457,111 @@ static void test_BBMD_Result(
     }
 }
 
+#if BBMD6_ENABLED
+/* the result code of the last BVLC-Result that was sent */
+static uint16_t test_sent_result_code(
+    void)
+{
+    uint8_t message_type = 0;
+    uint16_t message_length = 0;
+    uint32_t vmac = 0;
+    uint16_t result_code = 0xFFFF;
+
+    if ((bvlc6_decode_header(BIP6_Send_Buffer, BIP6_Send_Len,
+                &message_type, &message_length) == 4) &&
+        (message_type == BVLC6_RESULT)) {
+        (void) bvlc6_decode_result(&BIP6_Send_Buffer[4],
+            BIP6_Send_Len - 4, &vmac, &result_code);
+    }
+
+    return result_code;
+}
+
+static void test_BBMD_Foreign_Device(
+    Test * pTest)
+{
+    BACNET_IP6_ADDRESS fd_addr[100];
+    BACNET_IP6_FOREIGN_DEVICE_TABLE_ENTRY fdt_entry = { 0 };
+    BACNET_ADDRESS src;
+    uint8_t npdu[4] = { 0x01, 0x20, 0xFF, 0xFF };
+    uint8_t mtu[MAX_MPDU] = { 0 };
+    uint16_t mtu_len = 0;
+    unsigned i = 0;
+    int result = 0;
+
+    bvlc6_init();
+    bvlc6_address_set(&BIP6_Addr, 0xFD00, 0, 0, 0, 0, 0, 0, 1);
+    BIP6_Addr.port = 0xBAC0;
+    bvlc6_address_set(&BIP6_Broadcast_Addr,
+        BIP6_MULTICAST_SITE_LOCAL, 0, 0, 0, 0, 0, 0,
+        BIP6_MULTICAST_GROUP_ID);
+    BIP6_Broadcast_Addr.port = 0xBAC0;
+    for (i = 0; i < 100; i++) {
+        bvlc6_address_set(&fd_addr[i], 0xFD00, 0, 0, 0, 0, 0,
+            (uint16_t) (i >> 8), (uint16_t) (0x100 + i));
+        fd_addr[i].port = 0xBAC0;
+        mtu_len = bvlc6_encode_register_foreign_device(&mtu[0],
+            sizeof(mtu), 1000 + i, 60);
+        BIP6_Send_Count = 0;
+        result = handler_bbmd6_for_bbmd(&fd_addr[i], &src, &mtu[0],
+            mtu_len);
+        ct_test(pTest, result == 0);
+        ct_test(pTest, BIP6_Send_Count == 1);
+        ct_test(pTest, test_sent_result_code() ==
+            BVLC6_RESULT_SUCCESSFUL_COMPLETION);
+    }
+    /* registering again only restarts the timer */
+    mtu_len = bvlc6_encode_register_foreign_device(&mtu[0],
+        sizeof(mtu), 1000, 60);
+    result = handler_bbmd6_for_bbmd(&fd_addr[0], &src, &mtu[0], mtu_len);
+    ct_test(pTest, test_sent_result_code() ==
+        BVLC6_RESULT_SUCCESSFUL_COMPLETION);
+    /* a broadcast from one foreign device goes to the local multicast
+       domain and to every other foreign device */
+    mtu_len = bvlc6_encode_distribute_broadcast_to_network(&mtu[0],
+        sizeof(mtu), 1000, &npdu[0], sizeof(npdu));
+    BIP6_Send_Count = 0;
+    result = handler_bbmd6_for_bbmd(&fd_addr[0], &src, &mtu[0], mtu_len);
+    ct_test(pTest, result > 0);
+    ct_test(pTest, BIP6_Send_Count == 100);
+    ct_test(pTest, memcmp(&mtu[result], &npdu[0], sizeof(npdu)) == 0);
+    /* a device that is not registered is refused */
+    BIP6_Send_Count = 0;
+    result = handler_bbmd6_for_bbmd(&BIP6_Broadcast_Addr, &src, &mtu[0],
+        mtu_len);
+    ct_test(pTest, result == 0);
+    ct_test(pTest, BIP6_Send_Count == 1);
+    ct_test(pTest, test_sent_result_code() ==
+        BVLC6_RESULT_DISTRIBUTE_BROADCAST_TO_NETWORK_NAK);
+    /* delete one foreign device */
+    bvlc6_address_copy(&fdt_entry.bip6_address, &fd_addr[99]);
+    mtu_len = bvlc6_encode_delete_foreign_device(&mtu[0],
+        sizeof(mtu), 1000, &fdt_entry);
+    result = handler_bbmd6_for_bbmd(&fd_addr[0], &src, &mtu[0], mtu_len);
+    ct_test(pTest, test_sent_result_code() ==
+        BVLC6_RESULT_SUCCESSFUL_COMPLETION);
+    result = handler_bbmd6_for_bbmd(&fd_addr[0], &src, &mtu[0], mtu_len);
+    ct_test(pTest, test_sent_result_code() ==
+        BVLC6_RESULT_DELETE_FOREIGN_DEVICE_NAK);
+    mtu_len = bvlc6_encode_distribute_broadcast_to_network(&mtu[0],
+        sizeof(mtu), 1001, &npdu[0], sizeof(npdu));
+    BIP6_Send_Count = 0;
+    result = handler_bbmd6_for_bbmd(&fd_addr[1], &src, &mtu[0], mtu_len);
+    ct_test(pTest, result > 0);
+    ct_test(pTest, BIP6_Send_Count == 99);
+    /* registrations expire 30 seconds after their time-to-live */
+    bvlc6_maintenance_timer(89);
+    BIP6_Send_Count = 0;
+    result = handler_bbmd6_for_bbmd(&fd_addr[1], &src, &mtu[0], mtu_len);
+    ct_test(pTest, result > 0);
+    bvlc6_maintenance_timer(1);
+    result = handler_bbmd6_for_bbmd(&fd_addr[1], &src, &mtu[0], mtu_len);
+    ct_test(pTest, result == 0);
+    ct_test(pTest, test_sent_result_code() ==
+        BVLC6_RESULT_DISTRIBUTE_BROADCAST_TO_NETWORK_NAK);
+}
+#endif
+
 static void test_BBMD6(
     Test * pTest)
 {
@@ -1204,6 +1570,10 @@ static void test_BBMD6(
     /* individual tests */
     rc = ct_addTestFunction(pTest, test_BBMD_Result);
     assert(rc);
+#if BBMD6_ENABLED
+    rc = ct_addTestFunction(pTest, test_BBMD_Foreign_Device);
+    assert(rc);
+#endif
 }
 
 #ifdef TEST_BBMD6
@@ -45,11 +45,28 @@
 
 /** @file h_ccov.c  Handles Confirmed COV Notifications. */
 
+/* application callback for the decoded notifications */
+static cov_notification_function CCOV_Notification_Function;
+
+/** Set the function to be called with each decoded Confirmed COV Notification,
+ * e.g. to feed the values into a COV Trend Log.
+ * @ingroup DSCOV
+ *
+ * @param pFunction [in] function to call, or NULL for none
+ */
+void handler_ccov_notification_set(
+    cov_notification_function pFunction)
+{
+    CCOV_Notification_Function = pFunction;
+}
+
 /*  */
 /** Handler for an Confirmed COV Notification.
  * @ingroup DSCOV
  * Decodes the received list of Properties to update,
  * and print them out with the subscription information.
+ * The decoded data is then passed to any function set with
+ * handler_ccov_notification_set().
  * @note Nothing is specified in BACnet about what to do with the
  *       information received from Confirmed COV Notifications.
  *
@@ -139,6 +156,9 @@ void handler_ccov_notification(
 #endif
         goto CCOV_ABORT;
     } else {
+        if (CCOV_Notification_Function) {
+            CCOV_Notification_Function(src, &cov_data);
+        }
         len =
             encode_simple_ack(&Handler_Transmit_Buffer[pdu_len],
             service_data->invoke_id, SERVICE_CONFIRMED_COV_NOTIFICATION);
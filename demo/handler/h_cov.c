@@ -478,10 +478,6 @@ static bool cov_send_request(
         return status;
     }
     datalink_get_my_address(&my_address);
-    npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], dest, &my_address,
-        &npdu_data);
     /* load the COV data structure for outgoing message */
     cov_data.subscriberProcessIdentifier =
         cov_subscription->subscriberProcessIdentifier;
@@ -492,6 +488,14 @@ static bool cov_send_request(
         cov_subscription->monitoredObjectIdentifier.instance;
     cov_data.timeRemaining = cov_subscription->lifetime;
     cov_data.listOfValues = value_list;
+    if (bacnet_address_same(dest, &my_address)) {
+        /* subscribed to by one of our own objects - hand it over */
+        return handler_ucov_notification_local(&my_address, &cov_data);
+    }
+    npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu_len =
+        npdu_encode_pdu(&Handler_Transmit_Buffer[0], dest, &my_address,
+        &npdu_data);
     if (cov_subscription->flag.issueConfirmedNotifications) {
         npdu_data.data_expecting_reply = true;
         invoke_id = tsm_next_free_invokeID();
@@ -785,6 +789,29 @@ static bool cov_subscribe(
     return status;
 }
 
+/** Subscribe to COV on one of our own objects from within this device,
+ * for example by a Trend Log with a local source.
+ * @ingroup DSCOV
+ * The subscription is held in the same list as those from other devices,
+ * but its notifications are always unconfirmed and are passed straight to
+ * handler_ucov_notification_local() instead of being sent on the network.
+ *
+ * @param cov_data [in,out] The subscription (or cancellation); the error
+ *                          class and code are filled in on failure.
+ * @return true if the subscription was accepted.
+ */
+bool handler_cov_subscribe_local(
+    BACNET_SUBSCRIBE_COV_DATA * cov_data)
+{
+    BACNET_ADDRESS my_address;
+
+    datalink_get_my_address(&my_address);
+    cov_data->issueConfirmedNotifications = false;
+
+    return cov_subscribe(&my_address, cov_data, &cov_data->error_class,
+        &cov_data->error_code);
+}
+
 /** Handler for a COV Subscribe Service request.
  * @ingroup DSCOV
  * This handler will be invoked by apdu_handler() if it has been enabled
@@ -39,6 +39,7 @@
 #include "client.h"
 #include "bactext.h"
 #include "debug.h"
+#include "whois.h"
 
 #if PRINT_ENABLED
 #include <stdio.h>
@@ -200,6 +201,8 @@ static void routed_apdu_handler(
 {
     int cursor = 0;     /* Starting hint */
     bool bGotOne = false;
+    int32_t low_limit = 0;
+    int32_t high_limit = 0;
 
     if (!Routed_Device_Is_Valid_Network(dest->net, DNET_list)) {
         /* We don't know how to reach this one.
@@ -225,6 +228,22 @@ static void routed_apdu_handler(
         return;
     }
 
+    /* A broadcast Who-Is for one Device instance only needs to reach
+     * that Device, instead of every routed Device in turn. */
+    if ((dest->len == 0) && (dest->net != 0) && (apdu_len > 2) &&
+        (apdu[0] == PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST) &&
+        (apdu[1] == SERVICE_UNCONFIRMED_WHO_IS) &&
+        (whois_decode_service_request(&apdu[2], apdu_len - 2, &low_limit,
+                &high_limit) > 0) && (low_limit == high_limit)) {
+        /* The gateway itself is not on the virtual network */
+        if ((dest->net == BACNET_BROADCAST_NETWORK) ||
+            !Routed_Device_Is_Gateway_Instance((uint32_t) low_limit)) {
+            if (Routed_Device_Instance_Lookup(low_limit))
+                apdu_handler(src, apdu, apdu_len);
+        }
+        return;
+    }
+
     while (Routed_Device_GetNext(dest, DNET_list, &cursor)) {
         apdu_handler(src, apdu, apdu_len);
         bGotOne = true;
@@ -119,10 +119,11 @@ void handler_read_property(
     apdu_len =
         rp_ack_encode_apdu_init(&Handler_Transmit_Buffer[npdu_len],
         service_data->invoke_id, &rpdata);
-    /* configure our storage */
+    /* configure our storage, keeping room for the closing tag */
     rpdata.application_data = &Handler_Transmit_Buffer[npdu_len + apdu_len];
     rpdata.application_data_len =
-        sizeof(Handler_Transmit_Buffer) - (npdu_len + apdu_len);
+        sizeof(Handler_Transmit_Buffer) - (npdu_len + apdu_len +
+        rp_ack_encode_apdu_object_property_end(NULL));
     len = Device_Read_Property(&rpdata);
     if (len >= 0) {
         apdu_len += len;
@@ -46,7 +46,10 @@
 
 /** @file h_rpm.c  Handles Read Property Multiple requests. */
 
-static uint8_t Temp_Buf[MAX_APDU] = { 0 };
+/* property values are read here first: the object read_property
+   functions do not all honor application_data_len, so they are not
+   given the tail of the transmit buffer */
+static BACNET_THREAD_LOCAL uint8_t Temp_Buf[MAX_APDU] = { 0 };
 
 static BACNET_PROPERTY_ID RPM_Object_Property(
     struct special_property_list_t *pPropertyList,
@@ -110,19 +113,20 @@ static int RPM_Encode_Property(
     BACNET_RPM_DATA * rpmdata)
 {
     int len = 0;
-    size_t copy_len = 0;
     int apdu_len = 0;
     BACNET_READ_PROPERTY_DATA rpdata;
 
+    /* size the property reference, then encode it in place */
     len =
-        rpm_ack_encode_apdu_object_property(&Temp_Buf[0],
-        rpmdata->object_property, rpmdata->array_index);
-    copy_len = memcopy(&apdu[0], &Temp_Buf[0], offset, len, max_apdu);
-    if (copy_len == 0) {
+        rpm_ack_encode_apdu_object_property(NULL, rpmdata->object_property,
+        rpmdata->array_index);
+    if (!memcopylen(offset, max_apdu, len)) {
         rpmdata->error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
         return BACNET_STATUS_ABORT;
     }
-    apdu_len += len;
+    apdu_len +=
+        rpm_ack_encode_apdu_object_property(&apdu[offset],
+        rpmdata->object_property, rpmdata->array_index);
     len = 0;
     rpdata.error_class = ERROR_CLASS_OBJECT;
     rpdata.error_code = ERROR_CODE_UNKNOWN_OBJECT;
@@ -141,16 +145,17 @@ static int RPM_Encode_Property(
         }
         /* error was returned - encode that for the response */
         len =
-            rpm_ack_encode_apdu_object_property_error(&Temp_Buf[0],
+            rpm_ack_encode_apdu_object_property_error(NULL,
             rpdata.error_class, rpdata.error_code);
-        copy_len =
-            memcopy(&apdu[0], &Temp_Buf[0], offset + apdu_len, len, max_apdu);
-
-        if (copy_len == 0) {
+        if (!memcopylen(offset + apdu_len, max_apdu, len)) {
             rpmdata->error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
             return BACNET_STATUS_ABORT;
         }
-    } else if ((offset + apdu_len + 1 + len + 1) < max_apdu) {
+        len =
+            rpm_ack_encode_apdu_object_property_error(&apdu[offset +
+                apdu_len], rpdata.error_class, rpdata.error_code);
+    } else if (memcopylen(offset + apdu_len, max_apdu,
+            rpm_ack_encode_apdu_object_property_value(NULL, NULL, len))) {
         /* enough room to fit the property value and tags */
         len =
             rpm_ack_encode_apdu_object_property_value(&apdu[offset + apdu_len],
@@ -191,7 +196,6 @@ void handler_read_property_multiple(
     BACNET_CONFIRMED_SERVICE_DATA * service_data)
 {
     int len = 0;
-    uint16_t copy_len = 0;
     uint16_t decode_len = 0;
     int pdu_len = 0;
     BACNET_NPDU_DATA npdu_data;
@@ -247,11 +251,8 @@ void handler_read_property_multiple(
         }
 
         /* Stick this object id into the reply - if it will fit */
-        len = rpm_ack_encode_apdu_object_begin(&Temp_Buf[0], &rpmdata);
-        copy_len =
-            memcopy(&Handler_Transmit_Buffer[npdu_len], &Temp_Buf[0], apdu_len,
-            len, MAX_APDU);
-        if (copy_len == 0) {
+        len = rpm_ack_encode_apdu_object_begin(NULL, &rpmdata);
+        if (!memcopylen(apdu_len, MAX_APDU, len)) {
 #if PRINT_ENABLED
             fprintf(stderr, "RPM: Response too big!\r\n");
 #endif
@@ -259,8 +260,9 @@ void handler_read_property_multiple(
             error = BACNET_STATUS_ABORT;
             goto RPM_FAILURE;
         }
-
-        apdu_len += copy_len;
+        apdu_len +=
+            rpm_ack_encode_apdu_object_begin(&Handler_Transmit_Buffer[npdu_len
+                + apdu_len], &rpmdata);
         /* do each property of this object of the RPM request */
         for (;;) {
             /* Fetch a property */
@@ -289,12 +291,13 @@ void handler_read_property_multiple(
                     /*  No array index options for this special property.
                        Encode error for this object property response */
                     len =
-                        rpm_ack_encode_apdu_object_property(&Temp_Buf[0],
+                        rpm_ack_encode_apdu_object_property(NULL,
                         rpmdata.object_property, rpmdata.array_index);
-                    copy_len =
-                        memcopy(&Handler_Transmit_Buffer[npdu_len],
-                        &Temp_Buf[0], apdu_len, len, MAX_APDU);
-                    if (copy_len == 0) {
+                    len +=
+                        rpm_ack_encode_apdu_object_property_error(NULL,
+                        ERROR_CLASS_PROPERTY,
+                        ERROR_CODE_PROPERTY_IS_NOT_AN_ARRAY);
+                    if (!memcopylen(apdu_len, MAX_APDU, len)) {
 #if PRINT_ENABLED
                         fprintf(stderr,
                             "RPM: Too full to encode property!\r\n");
@@ -304,24 +307,15 @@ void handler_read_property_multiple(
                         error = BACNET_STATUS_ABORT;
                         goto RPM_FAILURE;
                     }
-                    apdu_len += len;
-                    len =
-                        rpm_ack_encode_apdu_object_property_error(&Temp_Buf[0],
+                    apdu_len +=
+                        rpm_ack_encode_apdu_object_property
+                        (&Handler_Transmit_Buffer[npdu_len + apdu_len],
+                        rpmdata.object_property, rpmdata.array_index);
+                    apdu_len +=
+                        rpm_ack_encode_apdu_object_property_error
+                        (&Handler_Transmit_Buffer[npdu_len + apdu_len],
                         ERROR_CLASS_PROPERTY,
                         ERROR_CODE_PROPERTY_IS_NOT_AN_ARRAY);
-                    copy_len =
-                        memcopy(&Handler_Transmit_Buffer[npdu_len],
-                        &Temp_Buf[0], apdu_len, len, MAX_APDU);
-                    if (copy_len == 0) {
-#if PRINT_ENABLED
-                        fprintf(stderr, "RPM: Too full to encode error!\r\n");
-#endif
-                        rpmdata.error_code =
-                            ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
-                        error = BACNET_STATUS_ABORT;
-                        goto RPM_FAILURE;
-                    }
-                    apdu_len += len;
                 } else {
                     special_object_property = rpmdata.object_property;
                     Device_Objects_Property_List(rpmdata.object_type,
@@ -377,11 +371,8 @@ void handler_read_property_multiple(
             if (decode_is_closing_tag_number(&service_request[decode_len], 1)) {
                 /* Reached end of property list so cap the result list */
                 decode_len++;
-                len = rpm_ack_encode_apdu_object_end(&Temp_Buf[0]);
-                copy_len =
-                    memcopy(&Handler_Transmit_Buffer[npdu_len], &Temp_Buf[0],
-                    apdu_len, len, MAX_APDU);
-                if (copy_len == 0) {
+                len = rpm_ack_encode_apdu_object_end(NULL);
+                if (!memcopylen(apdu_len, MAX_APDU, len)) {
 #if PRINT_ENABLED
                     fprintf(stderr, "RPM: Too full to encode object end!\r\n");
 #endif
@@ -390,7 +381,9 @@ void handler_read_property_multiple(
                     error = BACNET_STATUS_ABORT;
                     goto RPM_FAILURE;
                 } else {
-                    apdu_len += copy_len;
+                    apdu_len +=
+                        rpm_ack_encode_apdu_object_end(&Handler_Transmit_Buffer
+                        [npdu_len + apdu_len]);
                 }
                 break;  /* finished with this property list */
             }
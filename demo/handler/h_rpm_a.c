@@ -200,6 +200,151 @@ int rpm_ack_decode_service_request(
     return decoded_len;
 }
 
+/* state of rpm_ack_decode_service_request_view() between callbacks */
+struct rpm_view_builder {
+    ARENA *arena;
+    BACNET_READ_ACCESS_VIEW **object_tail;
+    BACNET_READ_ACCESS_VIEW *rpm_object;
+    BACNET_PROPERTY_VIEW **property_tail;
+    BACNET_PROPERTY_VIEW *rpm_property;
+    BACNET_APPLICATION_DATA_VIEW **value_tail;
+};
+
+static bool rpm_view_object(
+    void *context,
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    struct rpm_view_builder *builder = context;
+    BACNET_READ_ACCESS_VIEW *rpm_object;
+
+    rpm_object = Arena_Alloc(builder->arena, sizeof(BACNET_READ_ACCESS_VIEW));
+    if (!rpm_object) {
+        return false;
+    }
+    rpm_object->object_type = object_type;
+    rpm_object->object_instance = object_instance;
+    *builder->object_tail = rpm_object;
+    builder->object_tail = &rpm_object->next;
+    builder->rpm_object = rpm_object;
+    builder->property_tail = &rpm_object->listOfProperties;
+
+    return true;
+}
+
+static bool rpm_view_property(
+    void *context,
+    BACNET_PROPERTY_ID object_property,
+    uint32_t array_index)
+{
+    struct rpm_view_builder *builder = context;
+    BACNET_PROPERTY_VIEW *rpm_property;
+
+    rpm_property = Arena_Alloc(builder->arena, sizeof(BACNET_PROPERTY_VIEW));
+    if (!rpm_property) {
+        return false;
+    }
+    rpm_property->propertyIdentifier = object_property;
+    rpm_property->propertyArrayIndex = array_index;
+    /* an empty list still gets a value, with no contents,
+       to tell it from an error */
+    rpm_property->value =
+        Arena_Alloc(builder->arena, sizeof(BACNET_APPLICATION_DATA_VIEW));
+    if (!rpm_property->value) {
+        return false;
+    }
+    rpm_property->value->tag = MAX_BACNET_APPLICATION_TAG;
+    *builder->property_tail = rpm_property;
+    builder->property_tail = &rpm_property->next;
+    builder->rpm_property = rpm_property;
+    builder->value_tail = NULL;
+
+    return true;
+}
+
+static bool rpm_view_value(
+    void *context,
+    BACNET_APPLICATION_DATA_VIEW * value)
+{
+    struct rpm_view_builder *builder = context;
+    BACNET_APPLICATION_DATA_VIEW *copy;
+
+    if (builder->value_tail) {
+        copy =
+            Arena_Alloc(builder->arena, sizeof(BACNET_APPLICATION_DATA_VIEW));
+        if (!copy) {
+            return false;
+        }
+        *builder->value_tail = copy;
+    } else {
+        /* first value replaces the empty list placeholder */
+        copy = builder->rpm_property->value;
+    }
+    *copy = *value;
+    copy->next = NULL;
+    builder->value_tail = &copy->next;
+
+    return true;
+}
+
+static bool rpm_view_error(
+    void *context,
+    BACNET_ERROR_CLASS error_class,
+    BACNET_ERROR_CODE error_code)
+{
+    struct rpm_view_builder *builder = context;
+
+    builder->rpm_property->value = NULL;
+    builder->rpm_property->error.error_class = error_class;
+    builder->rpm_property->error.error_code = error_code;
+
+    return true;
+}
+
+/** Decode the received RPM data into linked lists taken from an arena.
+ * @ingroup DSRPM
+ * The values are views that refer back into apdu for their string
+ * contents, so apdu must be kept until the views are no longer needed.
+ * Nothing is freed individually: reset the arena when done.
+ * Callers that do not need the lists can use rpm_ack_decode_visit().
+ *
+ * @param apdu [in] The received apdu data.
+ * @param apdu_len [in] Total length of the apdu.
+ * @param arena [in] Where the list nodes are allocated from.
+ * @param read_access_view [out] Set to the head of the linked list.
+ * @return The number of bytes decoded, or -1 on error
+ */
+int rpm_ack_decode_service_request_view(
+    uint8_t * apdu,
+    int apdu_len,
+    ARENA * arena,
+    BACNET_READ_ACCESS_VIEW ** read_access_view)
+{
+    struct rpm_view_builder builder = { 0 };
+    BACNET_RPM_ACK_VISITOR visitor = { 0 };
+    int len = 0;
+
+    assert(read_access_view != NULL);
+    *read_access_view = NULL;
+    if (apdu_len <= 0) {
+        return BACNET_STATUS_ERROR;
+    }
+    builder.arena = arena;
+    builder.object_tail = read_access_view;
+    visitor.on_object = rpm_view_object;
+    visitor.on_property = rpm_view_property;
+    visitor.on_value = rpm_view_value;
+    visitor.on_error = rpm_view_error;
+    visitor.context = &builder;
+    len = rpm_ack_decode_visit(apdu, (unsigned) apdu_len, &visitor);
+    if (len < 0) {
+        /* malformed, or out of memory */
+        len = BACNET_STATUS_ERROR;
+    }
+
+    return len;
+}
+
 /* for debugging... */
 void rpm_ack_print_data(
     BACNET_READ_ACCESS_DATA * rpm_data)
@@ -283,10 +428,108 @@ void rpm_ack_print_data(
     }
 }
 
+/* for debugging... */
+void rpm_ack_print_view(
+    BACNET_READ_ACCESS_VIEW * rpm_data)
+{
+    BACNET_OBJECT_PROPERTY_VALUE object_value;  /* for bacapp printing */
+    BACNET_APPLICATION_DATA_VALUE decoded_value;
+    BACNET_PROPERTY_VIEW *listOfProperties;
+    BACNET_APPLICATION_DATA_VIEW *value;
+    bool array_value = false;
+    uint32_t i = 0;
+
+    if (rpm_data) {
+#if PRINT_ENABLED
+        fprintf(stdout, "%s #%lu\r\n",
+            bactext_object_type_name(rpm_data->object_type),
+            (unsigned long) rpm_data->object_instance);
+        fprintf(stdout, "{\r\n");
+#endif
+        listOfProperties = rpm_data->listOfProperties;
+        while (listOfProperties) {
+#if PRINT_ENABLED
+            if (listOfProperties->propertyIdentifier < 512) {
+                fprintf(stdout, "    %s: ",
+                    bactext_property_name(listOfProperties->
+                        propertyIdentifier));
+            } else {
+                fprintf(stdout, "    proprietary %u: ",
+                    (unsigned) listOfProperties->propertyIdentifier);
+            }
+            if (listOfProperties->propertyArrayIndex != BACNET_ARRAY_ALL) {
+                fprintf(stdout, "[%d]", listOfProperties->propertyArrayIndex);
+            }
+#endif
+            value = listOfProperties->value;
+            if (value) {
+#if PRINT_ENABLED
+                if (value->next) {
+                    fprintf(stdout, "{");
+                    array_value = true;
+                } else {
+                    array_value = false;
+                }
+#endif
+                object_value.object_type = rpm_data->object_type;
+                object_value.object_instance = rpm_data->object_instance;
+                object_value.object_property =
+                    listOfProperties->propertyIdentifier;
+                object_value.array_index =
+                    listOfProperties->propertyArrayIndex;
+                object_value.value = &decoded_value;
+                while (value) {
+                    /* only one value is ever copied out of the views */
+                    if (bacapp_view_to_value(value,
+                            listOfProperties->propertyIdentifier,
+                            &decoded_value)) {
+                        bacapp_print_value(stdout, &object_value);
+                    } else {
+#if PRINT_ENABLED
+                        /* constructed or unknown data: show the octets */
+                        fprintf(stdout, "{");
+                        for (i = 0; i < value->data_len; i++) {
+                            fprintf(stdout, "%02X", value->data[i]);
+                        }
+                        fprintf(stdout, "}");
+#endif
+                    }
+#if PRINT_ENABLED
+                    if (value->next) {
+                        fprintf(stdout, ",\r\n        ");
+                    } else {
+                        if (array_value) {
+                            fprintf(stdout, "}\r\n");
+                        } else {
+                            fprintf(stdout, "\r\n");
+                        }
+                    }
+#endif
+                    value = value->next;
+                }
+            } else {
+#if PRINT_ENABLED
+                /* AccessError */
+                fprintf(stdout, "BACnet Error: %s: %s\r\n",
+                    bactext_error_class_name((int) listOfProperties->
+                        error.error_class),
+                    bactext_error_code_name((int) listOfProperties->
+                        error.error_code));
+#endif
+            }
+            listOfProperties = listOfProperties->next;
+        }
+#if PRINT_ENABLED
+        fprintf(stdout, "}\r\n");
+#endif
+    }
+    (void) i;
+}
+
 /** Handler for a ReadPropertyMultiple ACK.
  * @ingroup DSRPM
  * For each read property, print out the ACK'd data for debugging,
- * and free the request data items from linked property list.
+ * decoding into views allocated from an arena that is reset each time.
  *
  * @param service_request [in] The contents of the service request.
  * @param service_len [in] The length of the service_request.
@@ -300,65 +543,29 @@ void handler_read_property_multiple_ack(
     BACNET_ADDRESS * src,
     BACNET_CONFIRMED_SERVICE_ACK_DATA * service_data)
 {
+    /* the decoded lists live here, and are dropped at the next ACK */
+    static ARENA rpm_arena;
     int len = 0;
-    BACNET_READ_ACCESS_DATA *rpm_data;
-    BACNET_READ_ACCESS_DATA *old_rpm_data;
-    BACNET_PROPERTY_REFERENCE *rpm_property;
-    BACNET_PROPERTY_REFERENCE *old_rpm_property;
-    BACNET_APPLICATION_DATA_VALUE *value;
-    BACNET_APPLICATION_DATA_VALUE *old_value;
+    BACNET_READ_ACCESS_VIEW *rpm_data = NULL;
 
     (void) src;
     (void) service_data;        /* we could use these... */
 
-    rpm_data = calloc(1, sizeof(BACNET_READ_ACCESS_DATA));
-    if (rpm_data) {
-        len =
-            rpm_ack_decode_service_request(service_request, service_len,
-            rpm_data);
-    }
+    Arena_Reset(&rpm_arena);
+    len =
+        rpm_ack_decode_service_request_view(service_request, service_len,
+        &rpm_arena, &rpm_data);
 #if 1
     fprintf(stderr, "Received Read-Property-Multiple Ack!\n");
 #endif
     if (len > 0) {
         while (rpm_data) {
-            rpm_ack_print_data(rpm_data);
-            rpm_property = rpm_data->listOfProperties;
-            while (rpm_property) {
-                value = rpm_property->value;
-                while (value) {
-                    old_value = value;
-                    value = value->next;
-                    free(old_value);
-                }
-                old_rpm_property = rpm_property;
-                rpm_property = rpm_property->next;
-                free(old_rpm_property);
-            }
-            old_rpm_data = rpm_data;
+            rpm_ack_print_view(rpm_data);
             rpm_data = rpm_data->next;
-            free(old_rpm_data);
         }
     } else {
 #if 1
-        fprintf(stderr, "RPM Ack Malformed! Freeing memory...\n");
+        fprintf(stderr, "RPM Ack Malformed!\n");
 #endif
-        while (rpm_data) {
-            rpm_property = rpm_data->listOfProperties;
-            while (rpm_property) {
-                value = rpm_property->value;
-                while (value) {
-                    old_value = value;
-                    value = value->next;
-                    free(old_value);
-                }
-                old_rpm_property = rpm_property;
-                rpm_property = rpm_property->next;
-                free(old_rpm_property);
-            }
-            old_rpm_data = rpm_data;
-            rpm_data = rpm_data->next;
-            free(old_rpm_data);
-        }
     }
 }
@@ -43,60 +43,45 @@
 /** @file h_rr_a.c  Handles Read Range Acknowledgments. */
 
 /* for debugging... */
-static void PrintReadRangeData(
-    BACNET_READ_RANGE_DATA * data)
+static bool PrintReadRangeValue(
+    void *context,
+    BACNET_APPLICATION_DATA_VIEW * value)
 {
+    BACNET_READ_RANGE_DATA *data = context;
     BACNET_OBJECT_PROPERTY_VALUE object_value;  /* for bacapp printing */
-    BACNET_APPLICATION_DATA_VALUE value;        /* for decode value data */
-    int len = 0;
-    uint8_t *application_data;
-    int application_data_len;
-    bool first_value = true;
-    bool print_brace = false;
+    BACNET_APPLICATION_DATA_VALUE decoded_value;
+    uint32_t i = 0;
 
-    if (data) {
-        application_data = data->application_data;
-        application_data_len = data->application_data_len;
-        /* FIXME: what if application_data_len is bigger than 255? */
-        /* value? need to loop until all of the len is gone... */
-        for (;;) {
-            len =
-                bacapp_decode_application_data(application_data,
-                (uint8_t) application_data_len, &value);
-            if (first_value && (len < application_data_len)) {
-                first_value = false;
 #if PRINT_ENABLED
-                fprintf(stdout, "{");
+    if (value->apdu == data->application_data) {
+        fprintf(stdout, "{");
+    } else {
+        fprintf(stdout, ",");
+    }
 #endif
-                print_brace = true;
-            }
-            object_value.object_type = data->object_type;
-            object_value.object_instance = data->object_instance;
-            object_value.object_property = data->object_property;
-            object_value.array_index = data->array_index;
-            object_value.value = &value;
-            bacapp_print_value(stdout, &object_value);
-            if (len > 0) {
-                if (len < application_data_len) {
-                    application_data += len;
-                    application_data_len -= len;
-                    /* there's more! */
+    if (bacapp_view_to_value(value, data->object_property, &decoded_value)) {
+        object_value.object_type = data->object_type;
+        object_value.object_instance = data->object_instance;
+        object_value.object_property = data->object_property;
+        object_value.array_index = data->array_index;
+        object_value.value = &decoded_value;
+        bacapp_print_value(stdout, &object_value);
+    } else {
 #if PRINT_ENABLED
-                    fprintf(stdout, ",");
-#endif
-                } else {
-                    break;
-                }
-            } else {
-                break;
-            }
+        /* constructed data, such as a log record: show the octets */
+        if (value->context_specific) {
+            fprintf(stdout, "[%u]", (unsigned) value->context_tag);
         }
-#if PRINT_ENABLED
-        if (print_brace)
-            fprintf(stdout, "}");
-        fprintf(stdout, "\r\n");
+        fprintf(stdout, "{");
+        for (i = 0; i < value->data_len; i++) {
+            fprintf(stdout, "%02X", value->data[i]);
+        }
+        fprintf(stdout, "}");
 #endif
     }
+    (void) i;
+
+    return true;
 }
 
 void handler_read_range_ack(
@@ -107,15 +92,28 @@ void handler_read_range_ack(
 {
     int len = 0;
     BACNET_READ_RANGE_DATA data;
+    BACNET_READ_RANGE_ACK_VISITOR visitor = { 0 };
 
     (void) src;
     (void) service_data;        /* we could use these... */
-    len = rr_ack_decode_service_request(service_request, service_len, &data);
 
 #if PRINT_ENABLED
     fprintf(stderr, "Received ReadRange Ack!\n");
 #endif
-
-    if (len > 0)
-        PrintReadRangeData(&data);
+    /* print each item as it is decoded */
+    visitor.on_value = PrintReadRangeValue;
+    visitor.context = &data;
+    len = rr_ack_decode_visit(service_request, service_len, &visitor, &data);
+#if PRINT_ENABLED
+    if (len > 0) {
+        if (data.application_data_len) {
+            fprintf(stdout, "}");
+        }
+        fprintf(stdout, "\r\n");
+    } else {
+        fprintf(stderr, "ReadRange Ack Malformed!\n");
+    }
+#else
+    (void) len;
+#endif
 }
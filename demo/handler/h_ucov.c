@@ -45,17 +45,55 @@
 
 /** @file h_ucov.c  Handles Unconfirmed COV Notifications. */
 
+/* application callback for the decoded notifications */
+static cov_notification_function UCOV_Notification_Function;
+
+/** Set the function to be called with each decoded Unconfirmed COV Notification,
+ * e.g. to feed the values into a COV Trend Log.
+ * @ingroup DSCOV
+ *
+ * @param pFunction [in] function to call, or NULL for none
+ */
+void handler_ucov_notification_set(
+    cov_notification_function pFunction)
+{
+    UCOV_Notification_Function = pFunction;
+}
+
+/** Pass a notification from this device to itself, for a subscription
+ * made with handler_cov_subscribe_local(), to the function set with
+ * handler_ucov_notification_set(). Nothing is encoded or decoded.
+ * @ingroup DSCOV
+ *
+ * @param src [in] BACNET_ADDRESS of this device
+ * @param cov_data [in] The notification
+ * @return true if there was a function to pass it to
+ */
+bool handler_ucov_notification_local(
+    BACNET_ADDRESS * src,
+    BACNET_COV_DATA * cov_data)
+{
+    if (!UCOV_Notification_Function) {
+        return false;
+    }
+    UCOV_Notification_Function(src, cov_data);
+
+    return true;
+}
+
 /*  */
 /** Handler for an Unconfirmed COV Notification.
  * @ingroup DSCOV
  * Decodes the received list of Properties to update,
  * and print them out with the subscription information.
+ * The decoded data is then passed to any function set with
+ * handler_ucov_notification_set().
  * @note Nothing is specified in BACnet about what to do with the
  *       information received from Unconfirmed COV Notifications.
  *
  * @param service_request [in] The contents of the service request.
  * @param service_len [in] The length of the service_request.
- * @param src [in] BACNET_ADDRESS of the source of the message (unused)
+ * @param src [in] BACNET_ADDRESS of the source of the message
  */
 void handler_ucov_notification(
     uint8_t * service_request,
@@ -67,8 +105,6 @@ void handler_ucov_notification(
     BACNET_PROPERTY_VALUE *pProperty_value = NULL;
     int len = 0;
 
-    /* src not needed for this application */
-    src = src;
     /* create linked list to store data if more
        than one property value is expected */
     bacapp_property_value_list_init(&property_value[0], MAX_COV_PROPERTIES);
@@ -110,4 +146,7 @@ void handler_ucov_notification(
         fprintf(stderr, "UCOV: Unable to decode service request!\n");
     }
 #endif
+    if ((len > 0) && UCOV_Notification_Function) {
+        UCOV_Notification_Function(src, &cov_data);
+    }
 }
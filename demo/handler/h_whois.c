@@ -41,6 +41,32 @@
 
 /** @file h_whois.c  Handles Who-Is requests. */
 
+/* sends, or queues, each I-Am that answers a Who-Is */
+static who_is_responder Who_Is_Responder;
+
+/** Hands the I-Ams that answer Who-Is to a function that paces them,
+ * such as Send_I_Am_Paced(), instead of sending each one at once.
+ * @param responder [in] the function, or NULL to send at once again
+ */
+void handler_who_is_set_responder(
+    who_is_responder responder)
+{
+    Who_Is_Responder = responder;
+}
+
+/* Answer for the current Device, to dest or broadcast when dest is NULL */
+static void who_is_respond(
+    BACNET_ADDRESS * dest)
+{
+    if (Who_Is_Responder) {
+        Who_Is_Responder(Device_Object_Instance_Number(), dest);
+    } else if (dest) {
+        Send_I_Am_Unicast(&Handler_Transmit_Buffer[0], dest);
+    } else {
+        Send_I_Am(&Handler_Transmit_Buffer[0]);
+    }
+}
+
 /** Handler for Who-Is requests, with broadcast I-Am response.
  * @ingroup DMDDB
  * @param service_request [in] The received message to be handled.
@@ -61,12 +87,12 @@ void handler_who_is(
         whois_decode_service_request(service_request, service_len, &low_limit,
         &high_limit);
     if (len == 0) {
-        Send_I_Am(&Handler_Transmit_Buffer[0]);
+        who_is_respond(NULL);
     } else if (len != BACNET_STATUS_ERROR) {
         /* is my device id within the limits? */
         if ((Device_Object_Instance_Number() >= (uint32_t) low_limit) &&
                 (Device_Object_Instance_Number() <= (uint32_t) high_limit)) {
-            Send_I_Am(&Handler_Transmit_Buffer[0]);
+            who_is_respond(NULL);
         }
     }
 
@@ -94,12 +120,12 @@ void handler_who_is_unicast(
         &high_limit);
     /* If no limits, then always respond */
     if (len == 0) {
-        Send_I_Am_Unicast(&Handler_Transmit_Buffer[0], src);
+        who_is_respond(src);
     } else if (len != BACNET_STATUS_ERROR) {
         /* is my device id within the limits? */
         if ((Device_Object_Instance_Number() >= (uint32_t) low_limit) &&
                 (Device_Object_Instance_Number() <= (uint32_t) high_limit)) {
-            Send_I_Am_Unicast(&Handler_Transmit_Buffer[0], src);
+            who_is_respond(src);
         }
     }
 
@@ -143,6 +169,13 @@ static void check_who_is_for_routing(
         /* Invalid; just leave */
         return;
     }
+    /* A Who-Is for one Device goes straight to it */
+    if ((len > 0) && (low_limit == high_limit)) {
+        if (Routed_Device_Instance_Lookup(low_limit)) {
+            who_is_respond(is_unicast ? src : NULL);
+        }
+        return;
+    }
     /* Go through all devices, starting with the root gateway Device */
     memset(&bcast_net, 0, sizeof(BACNET_ADDRESS));
     bcast_net.net = BACNET_BROADCAST_NETWORK;   /* That's all we have to set */
@@ -152,10 +185,7 @@ static void check_who_is_for_routing(
         /* If len == 0, no limits and always respond */
         if ((len == 0) || ((dev_instance >= low_limit) &&
                 (dev_instance <= high_limit))) {
-            if (is_unicast)
-                Send_I_Am_Unicast(&Handler_Transmit_Buffer[0], src);
-            else
-                Send_I_Am(&Handler_Transmit_Buffer[0]);
+            who_is_respond(is_unicast ? src : NULL);
         }
     }
 
@@ -0,0 +1,609 @@
+/**************************************************************************
+*
+* Copyright (C) 2026 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "bacdef.h"
+#include "bacaddr.h"
+#include "device.h"
+#include "txbuf.h"
+/* some demo stuff needed */
+#include "handlers.h"
+#include "client.h"
+
+/** @file s_iam_pace.c  Send the I-Ams that answer Who-Is at a steady rate.
+ *
+ * A gateway with many routed Devices answers a global Who-Is with one
+ * I-Am per Device.  Sent back to back, they swamp slow networks like
+ * MS/TP and every BBMD that forwards them.  Once Send_I_Am_Pace_Init()
+ * is called, the Who-Is handlers queue each I-Am here instead, and
+ * Send_I_Am_Pace_Timer() sends them no faster than the configured rate,
+ * taking turns between destinations so that one requester doesn't
+ * hold up the others.  An I-Am that is already queued, or that went
+ * to the same destination within the window, is not sent again, so a
+ * Who-Is repeated by a client or forwarded twice costs nothing.
+ */
+
+/* destinations that can have I-Ams queued at once */
+#ifndef IAM_PACE_DESTINATIONS
+#define IAM_PACE_DESTINATIONS 8
+#endif
+
+#define IAM_PACE_NONE (-1)
+
+struct iam_pace_entry {
+    uint32_t device_id;
+    /* when it was sent, for the window */
+    uint32_t time;
+    uint8_t dest;
+    bool queued;
+    /* destination queue, sent list or free list */
+    int32_t next;
+    /* entries with the same hash */
+    int32_t hash_next;
+};
+
+struct iam_pace_dest {
+    BACNET_ADDRESS address;
+    bool broadcast;
+    /* entries that are queued for, or were sent to, here */
+    unsigned refs;
+    int32_t head;
+    int32_t tail;
+};
+
+static struct iam_pace_entry *Entry_List;
+static unsigned Entry_Size;
+static int32_t Free_Head = IAM_PACE_NONE;
+static int32_t *Hash_List;
+static unsigned Hash_Size;
+/* sent entries, oldest first, waiting for the window to pass */
+static int32_t Sent_Head = IAM_PACE_NONE;
+static int32_t Sent_Tail = IAM_PACE_NONE;
+static struct iam_pace_dest Dest_List[IAM_PACE_DESTINATIONS];
+static unsigned Dest_Next;
+static unsigned Queued_Count;
+/* milliseconds, as counted by Send_I_Am_Pace_Timer() */
+static uint32_t Pace_Clock;
+/* microseconds until the next I-Am may be sent */
+static int32_t Pace_Wait;
+static uint32_t Pace_Interval;
+static unsigned Pace_Jitter;
+static uint32_t Pace_Window;
+
+static unsigned iam_pace_hash(
+    uint32_t device_id,
+    unsigned dest)
+{
+    uint32_t hash = 2166136261UL;
+    unsigned i = 0;
+
+    for (i = 0; i < 4; i++) {
+        hash ^= (device_id & 0xFF);
+        hash *= 16777619UL;
+        device_id >>= 8;
+    }
+    hash ^= dest;
+    hash *= 16777619UL;
+
+    return hash & (Hash_Size - 1);
+}
+
+static int32_t iam_pace_find(
+    uint32_t device_id,
+    unsigned dest)
+{
+    int32_t index = Hash_List[iam_pace_hash(device_id, dest)];
+
+    while (index != IAM_PACE_NONE) {
+        if ((Entry_List[index].device_id == device_id) &&
+            (Entry_List[index].dest == dest)) {
+            break;
+        }
+        index = Entry_List[index].hash_next;
+    }
+
+    return index;
+}
+
+static void iam_pace_free(
+    int32_t index)
+{
+    struct iam_pace_entry *entry = &Entry_List[index];
+    int32_t *link = &Hash_List[iam_pace_hash(entry->device_id, entry->dest)];
+
+    while (*link != index) {
+        link = &Entry_List[*link].hash_next;
+    }
+    *link = entry->hash_next;
+    Dest_List[entry->dest].refs--;
+    entry->next = Free_Head;
+    Free_Head = index;
+}
+
+/* the window has passed for the oldest sent entries */
+static void iam_pace_expire(
+    void)
+{
+    int32_t index = 0;
+
+    while (Sent_Head != IAM_PACE_NONE) {
+        index = Sent_Head;
+        if ((uint32_t) (Pace_Clock - Entry_List[index].time) < Pace_Window) {
+            break;
+        }
+        Sent_Head = Entry_List[index].next;
+        if (Sent_Head == IAM_PACE_NONE) {
+            Sent_Tail = IAM_PACE_NONE;
+        }
+        iam_pace_free(index);
+    }
+}
+
+static void iam_pace_send(
+    int32_t index)
+{
+    struct iam_pace_entry *entry = &Entry_List[index];
+    struct iam_pace_dest *dest = &Dest_List[entry->dest];
+    bool found = false;
+#if defined(BAC_ROUTING)
+    uint32_t current = Device_Object_Instance_Number();
+
+    /* the Device might have gone while its I-Am waited */
+    found = Routed_Device_Instance_Lookup(entry->device_id);
+#else
+    found = (entry->device_id == Device_Object_Instance_Number());
+#endif
+    if (found) {
+        if (dest->broadcast) {
+            Send_I_Am(&Handler_Transmit_Buffer[0]);
+        } else {
+            Send_I_Am_Unicast(&Handler_Transmit_Buffer[0], &dest->address);
+        }
+    }
+#if defined(BAC_ROUTING)
+    (void) Routed_Device_Instance_Lookup(current);
+#endif
+    Pace_Wait += (int32_t) Pace_Interval;
+    if (Pace_Jitter) {
+        Pace_Wait += (int32_t) (rand() % (Pace_Jitter + 1)) * 1000;
+    }
+    /* remember it for the window */
+    entry->queued = false;
+    if (Pace_Window == 0) {
+        iam_pace_free(index);
+        return;
+    }
+    entry->time = Pace_Clock;
+    entry->next = IAM_PACE_NONE;
+    if (Sent_Tail == IAM_PACE_NONE) {
+        Sent_Head = index;
+    } else {
+        Entry_List[Sent_Tail].next = index;
+    }
+    Sent_Tail = index;
+}
+
+/* sends the next I-Am, taking turns between the destinations */
+static void iam_pace_send_next(
+    void)
+{
+    struct iam_pace_dest *dest = NULL;
+    int32_t index = 0;
+    unsigned i = 0;
+
+    for (i = 0; i < IAM_PACE_DESTINATIONS; i++) {
+        dest = &Dest_List[Dest_Next];
+        Dest_Next = (Dest_Next + 1) % IAM_PACE_DESTINATIONS;
+        if (dest->head != IAM_PACE_NONE) {
+            index = dest->head;
+            dest->head = Entry_List[index].next;
+            if (dest->head == IAM_PACE_NONE) {
+                dest->tail = IAM_PACE_NONE;
+            }
+            Queued_Count--;
+            iam_pace_send(index);
+            break;
+        }
+    }
+}
+
+/* the slot for a destination, or a free one for a new destination */
+static int iam_pace_dest(
+    BACNET_ADDRESS * address)
+{
+    int free_slot = -1;
+    unsigned i = 0;
+
+    for (i = 0; i < IAM_PACE_DESTINATIONS; i++) {
+        if (Dest_List[i].refs == 0) {
+            if (free_slot < 0) {
+                free_slot = (int) i;
+            }
+        } else if (address) {
+            if (!Dest_List[i].broadcast &&
+                bacnet_address_same(&Dest_List[i].address, address)) {
+                return (int) i;
+            }
+        } else if (Dest_List[i].broadcast) {
+            return (int) i;
+        }
+    }
+    if (free_slot >= 0) {
+        if (address) {
+            bacnet_address_copy(&Dest_List[free_slot].address, address);
+            Dest_List[free_slot].broadcast = false;
+        } else {
+            memset(&Dest_List[free_slot].address, 0, sizeof(BACNET_ADDRESS));
+            Dest_List[free_slot].broadcast = true;
+        }
+        Dest_List[free_slot].head = IAM_PACE_NONE;
+        Dest_List[free_slot].tail = IAM_PACE_NONE;
+    }
+
+    return free_slot;
+}
+
+/** Queue the I-Am of a Device, or send it now if nothing is waiting
+ * and the rate allows it.  The Who-Is handlers call this once
+ * Send_I_Am_Pace_Init() has installed it.
+ *
+ * @param device_id [in] Device Instance that was asked for
+ * @param dest [in] where the I-Am goes, or NULL to broadcast it
+ */
+void Send_I_Am_Paced(
+    uint32_t device_id,
+    BACNET_ADDRESS * dest)
+{
+    struct iam_pace_entry *entry = NULL;
+    int32_t index = 0;
+    unsigned hash = 0;
+    int slot = 0;
+
+    if (!Entry_List) {
+        return;
+    }
+    slot = iam_pace_dest(dest);
+    if (slot < 0) {
+        /* too many requesters at once; they can ask again */
+        return;
+    }
+    if (iam_pace_find(device_id, (unsigned) slot) != IAM_PACE_NONE) {
+        /* queued already, or sent within the window */
+        return;
+    }
+    if (Free_Head == IAM_PACE_NONE) {
+        return;
+    }
+    index = Free_Head;
+    entry = &Entry_List[index];
+    Free_Head = entry->next;
+    entry->device_id = device_id;
+    entry->dest = (uint8_t) slot;
+    entry->queued = true;
+    entry->next = IAM_PACE_NONE;
+    hash = iam_pace_hash(device_id, (unsigned) slot);
+    entry->hash_next = Hash_List[hash];
+    Hash_List[hash] = index;
+    Dest_List[slot].refs++;
+    if ((Queued_Count == 0) && (Pace_Wait <= 0)) {
+        Pace_Wait = 0;
+        iam_pace_send(index);
+        return;
+    }
+    if (Dest_List[slot].tail == IAM_PACE_NONE) {
+        Dest_List[slot].head = index;
+    } else {
+        Entry_List[Dest_List[slot].tail].next = index;
+    }
+    Dest_List[slot].tail = index;
+    Queued_Count++;
+}
+
+/** Sends the queued I-Ams that are due, and forgets the sent ones
+ * once the window has passed.
+ *
+ * @param milliseconds [in] time since the last call
+ */
+void Send_I_Am_Pace_Timer(
+    uint16_t milliseconds)
+{
+    if (!Entry_List) {
+        return;
+    }
+    Pace_Clock += milliseconds;
+    Pace_Wait -= (int32_t) milliseconds * 1000;
+    iam_pace_expire();
+    while ((Queued_Count > 0) && (Pace_Wait <= 0)) {
+        iam_pace_send_next();
+    }
+    if ((Queued_Count == 0) && (Pace_Wait < 0)) {
+        /* an idle spell doesn't save up a burst */
+        Pace_Wait = 0;
+    }
+}
+
+/** Lets a main loop sleep until Send_I_Am_Pace_Timer() has work to do.
+ *
+ * @return milliseconds until the next I-Am or the end of a window,
+ *   or zero when nothing is waiting
+ */
+uint16_t Send_I_Am_Pace_Next(
+    void)
+{
+    uint32_t milliseconds = 0;
+
+    if (!Entry_List) {
+        return 0;
+    }
+    if (Queued_Count > 0) {
+        if (Pace_Wait <= 0) {
+            return 1;
+        }
+        milliseconds = ((uint32_t) Pace_Wait + 999) / 1000;
+    } else if (Sent_Head != IAM_PACE_NONE) {
+        milliseconds =
+            Pace_Window - (uint32_t) (Pace_Clock -
+            Entry_List[Sent_Head].time);
+        if (milliseconds == 0) {
+            milliseconds = 1;
+        }
+    }
+    if (milliseconds > UINT16_MAX) {
+        milliseconds = UINT16_MAX;
+    }
+
+    return (uint16_t) milliseconds;
+}
+
+/** @return number of I-Ams waiting to be sent */
+unsigned Send_I_Am_Pace_Queued(
+    void)
+{
+    return Queued_Count;
+}
+
+/** Stops pacing: the Who-Is handlers send each I-Am at once again,
+ * and anything still queued is dropped.
+ */
+void Send_I_Am_Pace_Cleanup(
+    void)
+{
+    handler_who_is_set_responder(NULL);
+    free(Entry_List);
+    free(Hash_List);
+    Entry_List = NULL;
+    Hash_List = NULL;
+    Entry_Size = 0;
+    Hash_Size = 0;
+    Free_Head = IAM_PACE_NONE;
+    Sent_Head = IAM_PACE_NONE;
+    Sent_Tail = IAM_PACE_NONE;
+    memset(Dest_List, 0, sizeof(Dest_List));
+    Dest_Next = 0;
+    Queued_Count = 0;
+    Pace_Wait = 0;
+}
+
+/** Paces the I-Ams that answer Who-Is from now on.
+ * The application calls Send_I_Am_Pace_Timer() from its main loop.
+ *
+ * @param rate [in] most I-Ams sent per second, 1 or more
+ * @param jitter [in] up to this many milliseconds are added at random
+ *   between I-Ams, so that gateways don't answer in step
+ * @param window [in] milliseconds in which a Who-Is is not answered
+ *   again for the same Device and destination, or zero
+ * @param queue_size [in] I-Ams that can be queued or remembered for
+ *   the window; more are dropped
+ * @return true if the I-Ams are paced
+ */
+bool Send_I_Am_Pace_Init(
+    unsigned rate,
+    unsigned jitter,
+    unsigned window,
+    unsigned queue_size)
+{
+    unsigned i = 0;
+
+    Send_I_Am_Pace_Cleanup();
+    if ((rate == 0) || (queue_size == 0) || (queue_size > INT32_MAX / 2)) {
+        return false;
+    }
+    Hash_Size = 1;
+    while (Hash_Size < queue_size) {
+        Hash_Size <<= 1;
+    }
+    Entry_List = calloc(queue_size, sizeof(struct iam_pace_entry));
+    Hash_List = malloc(Hash_Size * sizeof(int32_t));
+    if (!Entry_List || !Hash_List) {
+        Send_I_Am_Pace_Cleanup();
+        return false;
+    }
+    Entry_Size = queue_size;
+    for (i = 0; i < Entry_Size; i++) {
+        Entry_List[i].next = (int32_t) i + 1;
+    }
+    Entry_List[Entry_Size - 1].next = IAM_PACE_NONE;
+    Free_Head = 0;
+    for (i = 0; i < Hash_Size; i++) {
+        Hash_List[i] = IAM_PACE_NONE;
+    }
+    for (i = 0; i < IAM_PACE_DESTINATIONS; i++) {
+        Dest_List[i].head = IAM_PACE_NONE;
+        Dest_List[i].tail = IAM_PACE_NONE;
+    }
+    Pace_Interval = 1000000UL / rate;
+    Pace_Jitter = jitter;
+    Pace_Window = window;
+    handler_who_is_set_responder(Send_I_Am_Paced);
+
+    return true;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include "ctest.h"
+
+uint8_t Handler_Transmit_Buffer[MAX_PDU];
+static uint32_t Test_Device_ID = 1234;
+static unsigned Test_Broadcast_Count;
+static unsigned Test_Unicast_Count;
+static BACNET_ADDRESS Test_Unicast_Address;
+static who_is_responder Test_Responder;
+
+uint32_t Device_Object_Instance_Number(
+    void)
+{
+    return Test_Device_ID;
+}
+
+void Send_I_Am(
+    uint8_t * buffer)
+{
+    (void) buffer;
+    Test_Broadcast_Count++;
+}
+
+void Send_I_Am_Unicast(
+    uint8_t * buffer,
+    BACNET_ADDRESS * src)
+{
+    (void) buffer;
+    bacnet_address_copy(&Test_Unicast_Address, src);
+    Test_Unicast_Count++;
+}
+
+void handler_who_is_set_responder(
+    who_is_responder responder)
+{
+    Test_Responder = responder;
+}
+
+static void test_address(
+    BACNET_ADDRESS * address,
+    uint8_t mac)
+{
+    memset(address, 0, sizeof(BACNET_ADDRESS));
+    address->mac_len = 1;
+    address->mac[0] = mac;
+}
+
+void testIAmPace(
+    Test * pTest)
+{
+    BACNET_ADDRESS address[3];
+    unsigned i = 0;
+
+    for (i = 0; i < 3; i++) {
+        test_address(&address[i], (uint8_t) (i + 1));
+    }
+    ct_test(pTest, !Send_I_Am_Pace_Init(0, 0, 0, 16));
+    ct_test(pTest, Test_Responder == NULL);
+    /* 10 per second, remembered for one second */
+    ct_test(pTest, Send_I_Am_Pace_Init(10, 0, 1000, 16));
+    ct_test(pTest, Test_Responder == Send_I_Am_Paced);
+    ct_test(pTest, Send_I_Am_Pace_Next() == 0);
+    /* the first goes at once */
+    Send_I_Am_Paced(Test_Device_ID, NULL);
+    ct_test(pTest, Test_Broadcast_Count == 1);
+    ct_test(pTest, Send_I_Am_Pace_Queued() == 0);
+    /* a repeat within the window is not sent */
+    Send_I_Am_Paced(Test_Device_ID, NULL);
+    ct_test(pTest, Send_I_Am_Pace_Queued() == 0);
+    /* other destinations wait their turn */
+    for (i = 0; i < 3; i++) {
+        Send_I_Am_Paced(Test_Device_ID, &address[i]);
+        Send_I_Am_Paced(Test_Device_ID, &address[i]);
+    }
+    ct_test(pTest, Send_I_Am_Pace_Queued() == 3);
+    ct_test(pTest, Send_I_Am_Pace_Next() == 100);
+    Send_I_Am_Pace_Timer(99);
+    ct_test(pTest, Test_Unicast_Count == 0);
+    Send_I_Am_Pace_Timer(1);
+    ct_test(pTest, Test_Unicast_Count == 1);
+    ct_test(pTest, bacnet_address_same(&Test_Unicast_Address, &address[0]));
+    /* a late timer catches up, but no faster than the rate */
+    Send_I_Am_Pace_Timer(250);
+    ct_test(pTest, Test_Unicast_Count == 3);
+    ct_test(pTest, bacnet_address_same(&Test_Unicast_Address, &address[2]));
+    ct_test(pTest, Send_I_Am_Pace_Queued() == 0);
+    /* the window passes for the broadcast first */
+    ct_test(pTest, Send_I_Am_Pace_Next() == 650);
+    Send_I_Am_Pace_Timer(650);
+    Send_I_Am_Paced(Test_Device_ID, NULL);
+    ct_test(pTest, Test_Broadcast_Count == 2);
+    /* the window is still open for the last unicast */
+    Send_I_Am_Paced(Test_Device_ID, &address[2]);
+    ct_test(pTest, Send_I_Am_Pace_Queued() == 0);
+    ct_test(pTest, Test_Unicast_Count == 3);
+    /* I-Ams for another Device are not ours to send */
+    Send_I_Am_Pace_Timer(1000);
+    Send_I_Am_Paced(Test_Device_ID + 1, NULL);
+    ct_test(pTest, Test_Broadcast_Count == 2);
+    /* without a window, only queued I-Ams are merged */
+    ct_test(pTest, Send_I_Am_Pace_Init(1000, 0, 0, 4));
+    Send_I_Am_Paced(Test_Device_ID, NULL);
+    ct_test(pTest, Test_Broadcast_Count == 3);
+    Send_I_Am_Paced(Test_Device_ID, NULL);
+    Send_I_Am_Paced(Test_Device_ID, NULL);
+    ct_test(pTest, Send_I_Am_Pace_Queued() == 1);
+    Send_I_Am_Pace_Timer(1);
+    ct_test(pTest, Test_Broadcast_Count == 4);
+    ct_test(pTest, Send_I_Am_Pace_Next() == 0);
+    /* a full queue drops the rest */
+    for (i = 0; i < 8; i++) {
+        Send_I_Am_Paced(Test_Device_ID + i, NULL);
+    }
+    ct_test(pTest, Send_I_Am_Pace_Queued() == 4);
+    Send_I_Am_Pace_Cleanup();
+    ct_test(pTest, Test_Responder == NULL);
+    Send_I_Am_Paced(Test_Device_ID, NULL);
+    ct_test(pTest, Test_Broadcast_Count == 4);
+}
+
+#ifdef TEST_IAM_PACE
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet I-Am Pacing", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testIAmPace);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif
+#endif
@@ -0,0 +1,711 @@
+/**************************************************************************
+*
+* Copyright (C) 2026 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+
+/* command line tool that keeps a BACnet device busy with confirmed
+   requests and reports the throughput and latency it measured */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define PRINT_ENABLED 1
+
+#include "config.h"
+#include "bacdef.h"
+#include "bactext.h"
+#include "bacerror.h"
+#include "iam.h"
+#include "tsm.h"
+#include "address.h"
+#include "npdu.h"
+#include "apdu.h"
+#include "device.h"
+#include "datalink.h"
+#include "whois.h"
+#include "rpm.h"
+#include "cov.h"
+#include "version.h"
+/* some demo stuff needed */
+#include "filename.h"
+#include "handlers.h"
+#include "client.h"
+#include "txbuf.h"
+#include "dlenv.h"
+
+/** @file loadgen/main.c  Load a BACnet device and measure its latency. */
+
+#define LOAD_DURATION_DEFAULT 10
+#define LOAD_CONCURRENCY_DEFAULT 8
+#define LOAD_OBJECTS_DEFAULT 4
+/* latency histogram: exact below 16us, then 16 buckets per power of two,
+   which keeps each bucket within about 6% of the values inside it */
+#define LOAD_HISTOGRAM_SUB_BITS 4
+#define LOAD_HISTOGRAM_SUB (1 << LOAD_HISTOGRAM_SUB_BITS)
+#define LOAD_HISTOGRAM_SIZE ((32 - LOAD_HISTOGRAM_SUB_BITS + 1) * \
+    LOAD_HISTOGRAM_SUB)
+
+typedef enum {
+    LOAD_RP = 0,
+    LOAD_RPM = 1,
+    LOAD_WP = 2,
+    LOAD_COV = 3,
+    LOAD_SERVICE_MAX = 4
+} LOAD_SERVICE;
+
+typedef struct load_stats {
+    unsigned long sent;
+    unsigned long done;
+    unsigned long errors;
+    unsigned long timeouts;
+    unsigned long max_us;
+    unsigned long histogram[LOAD_HISTOGRAM_SIZE];
+} LOAD_STATS;
+
+/* one slot per invoke ID, given to the TSM as the completion context */
+typedef struct load_request {
+    LOAD_SERVICE service;
+    double sent_ns;
+} LOAD_REQUEST;
+
+static const char *Load_Service_Name[LOAD_SERVICE_MAX] = {
+    "rp", "rpm", "wp", "cov"
+};
+
+/* buffer used for receive */
+static uint8_t Rx_Buf[MAX_MPDU] = { 0 };
+/* buffer used to build ReadPropertyMultiple requests */
+static uint8_t Request_Buf[MAX_APDU] = { 0 };
+
+/* converted command line arguments */
+static uint32_t Target_Device_Object_Instance = BACNET_MAX_INSTANCE;
+static BACNET_OBJECT_TYPE Target_Object_Type = OBJECT_ANALOG_VALUE;
+static uint32_t Target_Object_Count = LOAD_OBJECTS_DEFAULT;
+static BACNET_PROPERTY_ID Target_Object_Property = PROP_PRESENT_VALUE;
+static uint8_t Target_Priority = BACNET_MAX_PRIORITY;
+static unsigned Load_Weight[LOAD_SERVICE_MAX] = { 70, 10, 10, 10 };
+static unsigned Load_Concurrency = LOAD_CONCURRENCY_DEFAULT;
+static unsigned long Load_Duration = LOAD_DURATION_DEFAULT;
+static unsigned long Load_Requests = 0;
+
+static BACNET_ADDRESS Target_Address;
+static LOAD_REQUEST Load_Request[256];
+static unsigned Load_Active = 0;
+static LOAD_STATS Load_Stats[LOAD_SERVICE_MAX];
+static LOAD_STATS Load_Total;
+static uint32_t Load_Next_Instance = 0;
+static unsigned long Load_Sequence = 0;
+
+static double load_now_ns(
+    void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER count;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&count);
+
+    return ((double) count.QuadPart * 1.0e9) / (double) frequency.QuadPart;
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((double) now.tv_sec * 1.0e9) + (double) now.tv_nsec;
+#endif
+}
+
+static unsigned load_histogram_index(
+    unsigned long value)
+{
+    unsigned msb = 0;
+
+    if (value < LOAD_HISTOGRAM_SUB) {
+        return (unsigned) value;
+    }
+    if (value > 0xFFFFFFFFUL) {
+        value = 0xFFFFFFFFUL;
+    }
+    while ((value >> (msb + 1)) != 0) {
+        msb++;
+    }
+
+    return ((msb - LOAD_HISTOGRAM_SUB_BITS + 1) * LOAD_HISTOGRAM_SUB) +
+        ((value >> (msb - LOAD_HISTOGRAM_SUB_BITS)) &
+        (LOAD_HISTOGRAM_SUB - 1));
+}
+
+/* largest value that falls into the bucket */
+static unsigned long load_histogram_value(
+    unsigned index)
+{
+    unsigned shift = 0;
+    unsigned long sub = 0;
+
+    if (index < LOAD_HISTOGRAM_SUB) {
+        return index;
+    }
+    shift = (index / LOAD_HISTOGRAM_SUB) - 1;
+    sub = index % LOAD_HISTOGRAM_SUB;
+
+    return ((LOAD_HISTOGRAM_SUB + sub + 1) << shift) - 1;
+}
+
+static unsigned long load_percentile(
+    LOAD_STATS * stats,
+    double fraction)
+{
+    unsigned long rank = 0;
+    unsigned long count = 0;
+    unsigned i = 0;
+
+    if (stats->done == 0) {
+        return 0;
+    }
+    rank = (unsigned long) (fraction * (double) stats->done);
+    if (rank >= stats->done) {
+        rank = stats->done - 1;
+    }
+    for (i = 0; i < LOAD_HISTOGRAM_SIZE; i++) {
+        count += stats->histogram[i];
+        if (count > rank) {
+            break;
+        }
+    }
+    if (load_histogram_value(i) > stats->max_us) {
+        return stats->max_us;
+    }
+
+    return load_histogram_value(i);
+}
+
+static void load_stats_done(
+    LOAD_STATS * stats,
+    unsigned long latency_us,
+    bool error)
+{
+    stats->done++;
+    if (error) {
+        stats->errors++;
+    }
+    if (latency_us > stats->max_us) {
+        stats->max_us = latency_us;
+    }
+    stats->histogram[load_histogram_index(latency_us)]++;
+}
+
+/* the TSM completes each request here: with its reply, or a timeout
+   once the retries are used up */
+static void load_complete(
+    BACNET_TSM_REPLY * reply,
+    void *context)
+{
+    LOAD_REQUEST *request = (LOAD_REQUEST *) context;
+    unsigned long latency_us = 0;
+    bool error = false;
+
+    Load_Active--;
+    if (reply->result == TSM_RESULT_TIMEOUT) {
+        Load_Stats[request->service].timeouts++;
+        Load_Total.timeouts++;
+        return;
+    }
+    if ((reply->result != TSM_RESULT_ACK) &&
+        (reply->result != TSM_RESULT_SIMPLE_ACK)) {
+        error = true;
+    }
+    latency_us = (unsigned long) ((load_now_ns() - request->sent_ns) / 1000.0);
+    load_stats_done(&Load_Stats[request->service], latency_us, error);
+    load_stats_done(&Load_Total, latency_us, error);
+}
+
+static void Init_Service_Handlers(
+    void)
+{
+    Device_Init(NULL);
+    /* we need to handle who-is
+       to support dynamic device binding to us */
+    apdu_set_unconfirmed_handler(SERVICE_UNCONFIRMED_WHO_IS, handler_who_is);
+    /* handle i-am to support binding to other devices */
+    apdu_set_unconfirmed_handler(SERVICE_UNCONFIRMED_I_AM, handler_i_am_bind);
+    /* set the handler for all the services we don't implement
+       It is required to send the proper reject message... */
+    apdu_set_unrecognized_service_handler_handler
+        (handler_unrecognized_service);
+    /* we must implement read property - it's required! */
+    apdu_set_confirmed_handler(SERVICE_CONFIRMED_READ_PROPERTY,
+        handler_read_property);
+    /* the replies to our requests go to load_complete() by way of
+       the TSM, so no ACK or error handlers are needed */
+}
+
+static LOAD_SERVICE load_next_service(
+    void)
+{
+    unsigned total = 0;
+    unsigned pick = 0;
+    unsigned i = 0;
+
+    for (i = 0; i < LOAD_SERVICE_MAX; i++) {
+        total += Load_Weight[i];
+    }
+    pick = (unsigned) (rand() % total);
+    for (i = 0; i < LOAD_SERVICE_MAX; i++) {
+        if (pick < Load_Weight[i]) {
+            break;
+        }
+        pick -= Load_Weight[i];
+    }
+
+    return (LOAD_SERVICE) i;
+}
+
+/* a value that the object type will accept for its present-value */
+static void load_write_value(
+    BACNET_APPLICATION_DATA_VALUE * value)
+{
+    memset(value, 0, sizeof(*value));
+    switch (Target_Object_Type) {
+        case OBJECT_BINARY_INPUT:
+        case OBJECT_BINARY_OUTPUT:
+        case OBJECT_BINARY_VALUE:
+            value->tag = BACNET_APPLICATION_TAG_ENUMERATED;
+            value->type.Enumerated = Load_Sequence & 1;
+            break;
+        case OBJECT_MULTI_STATE_INPUT:
+        case OBJECT_MULTI_STATE_OUTPUT:
+        case OBJECT_MULTI_STATE_VALUE:
+            value->tag = BACNET_APPLICATION_TAG_UNSIGNED_INT;
+            value->type.Unsigned_Int = 1 + (Load_Sequence & 1);
+            break;
+        default:
+            value->tag = BACNET_APPLICATION_TAG_REAL;
+            value->type.Real = (float) (Load_Sequence % 100);
+            break;
+    }
+}
+
+static uint8_t load_send(
+    LOAD_SERVICE service,
+    uint32_t object_instance)
+{
+    BACNET_READ_ACCESS_DATA rpm_object;
+    BACNET_PROPERTY_REFERENCE rpm_property[3];
+    BACNET_APPLICATION_DATA_VALUE value;
+    BACNET_SUBSCRIBE_COV_DATA cov_data;
+    uint8_t invoke_id = 0;
+
+    switch (service) {
+        case LOAD_RP:
+            invoke_id =
+                Send_Read_Property_Request(Target_Device_Object_Instance,
+                Target_Object_Type, object_instance, Target_Object_Property,
+                BACNET_ARRAY_ALL);
+            break;
+        case LOAD_RPM:
+            memset(&rpm_property, 0, sizeof(rpm_property));
+            rpm_property[0].propertyIdentifier = Target_Object_Property;
+            rpm_property[0].propertyArrayIndex = BACNET_ARRAY_ALL;
+            rpm_property[0].next = &rpm_property[1];
+            rpm_property[1].propertyIdentifier = PROP_STATUS_FLAGS;
+            rpm_property[1].propertyArrayIndex = BACNET_ARRAY_ALL;
+            rpm_property[1].next = &rpm_property[2];
+            rpm_property[2].propertyIdentifier = PROP_OBJECT_NAME;
+            rpm_property[2].propertyArrayIndex = BACNET_ARRAY_ALL;
+            rpm_property[2].next = NULL;
+            rpm_object.object_type = Target_Object_Type;
+            rpm_object.object_instance = object_instance;
+            rpm_object.listOfProperties = &rpm_property[0];
+            rpm_object.next = NULL;
+            invoke_id =
+                Send_Read_Property_Multiple_Request(&Request_Buf[0],
+                sizeof(Request_Buf), Target_Device_Object_Instance,
+                &rpm_object);
+            break;
+        case LOAD_WP:
+            load_write_value(&value);
+            invoke_id =
+                Send_Write_Property_Request(Target_Device_Object_Instance,
+                Target_Object_Type, object_instance, Target_Object_Property,
+                &value, Target_Priority, BACNET_ARRAY_ALL);
+            break;
+        case LOAD_COV:
+            memset(&cov_data, 0, sizeof(cov_data));
+            /* the same process identifier refreshes the subscription
+               rather than filling the device with new ones */
+            cov_data.subscriberProcessIdentifier = 1;
+            cov_data.monitoredObjectIdentifier.type = Target_Object_Type;
+            cov_data.monitoredObjectIdentifier.instance = object_instance;
+            cov_data.cancellationRequest = false;
+            cov_data.issueConfirmedNotifications = false;
+            cov_data.lifetime = 60;
+            invoke_id =
+                Send_COV_Subscribe(Target_Device_Object_Instance, &cov_data);
+            break;
+        default:
+            break;
+    }
+
+    return invoke_id;
+}
+
+/* keep the window full; returns the number of requests sent */
+static unsigned load_fill(
+    void)
+{
+    LOAD_SERVICE service = LOAD_RP;
+    uint8_t invoke_id = 0;
+    unsigned count = 0;
+
+    while (Load_Active < Load_Concurrency) {
+        if (Load_Requests && (Load_Total.sent >= Load_Requests)) {
+            break;
+        }
+        service = load_next_service();
+        invoke_id = load_send(service, Load_Next_Instance);
+        if (invoke_id == 0) {
+            /* no transaction available - wait for a reply */
+            break;
+        }
+        Load_Request[invoke_id].service = service;
+        Load_Request[invoke_id].sent_ns = load_now_ns();
+        if (!tsm_set_completion(invoke_id, load_complete,
+                &Load_Request[invoke_id])) {
+            tsm_free_invoke_id(invoke_id);
+            break;
+        }
+        Load_Active++;
+        Load_Stats[service].sent++;
+        Load_Total.sent++;
+        Load_Sequence++;
+        Load_Next_Instance++;
+        if (Load_Next_Instance >= Target_Object_Count) {
+            Load_Next_Instance = 0;
+        }
+        count++;
+    }
+
+    return count;
+}
+
+static void load_print_row(
+    const char *name,
+    LOAD_STATS * stats)
+{
+    printf("%-8s %10lu %10lu %8lu %8lu %8lu %8lu %8lu %8lu\n", name,
+        stats->sent, stats->done, stats->errors, stats->timeouts,
+        load_percentile(stats, 0.50), load_percentile(stats, 0.99),
+        load_percentile(stats, 0.999), stats->max_us);
+}
+
+static void load_report(
+    double seconds)
+{
+    unsigned i = 0;
+
+    printf("%-8s %10s %10s %8s %8s %8s %8s %8s %8s\n", "service", "sent",
+        "done", "errors", "timeouts", "p50(us)", "p99(us)", "p999(us)",
+        "max(us)");
+    for (i = 0; i < LOAD_SERVICE_MAX; i++) {
+        if (Load_Stats[i].sent) {
+            load_print_row(Load_Service_Name[i], &Load_Stats[i]);
+        }
+    }
+    load_print_row("total", &Load_Total);
+    if (seconds > 0.0) {
+        printf("%lu replies in %.3f seconds: %.1f requests/sec\n",
+            Load_Total.done, seconds, (double) Load_Total.done / seconds);
+    }
+}
+
+static bool load_mix_parse(
+    char *text)
+{
+    unsigned weight[LOAD_SERVICE_MAX] = { 0 };
+    unsigned total = 0;
+    unsigned i = 0;
+    char *end = text;
+
+    for (i = 0; i < LOAD_SERVICE_MAX; i++) {
+        weight[i] = (unsigned) strtoul(text, &end, 0);
+        total += weight[i];
+        if (*end == 0) {
+            break;
+        }
+        if (*end != ',') {
+            return false;
+        }
+        text = end + 1;
+    }
+    if ((total == 0) || (*end != 0)) {
+        return false;
+    }
+    memcpy(Load_Weight, weight, sizeof(Load_Weight));
+
+    return true;
+}
+
+static void print_usage(char *filename)
+{
+    printf("Usage: %s device-instance [--duration S][--requests N]\n",
+        filename);
+    printf("       [--concurrency N][--mix RP,RPM,WP,COV]\n");
+    printf("       [--object-type T][--objects N][--property P]\n");
+    printf("       [--priority P][--mac A]\n");
+    printf("       [--version][--help]\n");
+}
+
+static void print_help(char *filename)
+{
+    printf("Send a mix of confirmed requests to a BACnet device,\n"
+        "keeping a fixed number of them outstanding, and report\n"
+        "the requests per second and p50/p99/p999 latency of\n"
+        "the replies.\n");
+    printf("--duration S\n"
+        "Seconds to keep sending requests. Default is %u.\n"
+        "\n"
+        "--requests N\n"
+        "Stop after sending N requests instead of after a duration.\n"
+        "\n"
+        "--concurrency N\n"
+        "Number of requests kept outstanding at once (1..%u).\n"
+        "Default is %u.\n"
+        "\n"
+        "--mix RP,RPM,WP,COV\n"
+        "Relative weights of ReadProperty, ReadPropertyMultiple,\n"
+        "WriteProperty and SubscribeCOV requests. Default is 70,10,10,10.\n"
+        "\n", LOAD_DURATION_DEFAULT, (unsigned) MAX_TSM_TRANSACTIONS,
+        LOAD_CONCURRENCY_DEFAULT);
+    printf("--object-type T\n"
+        "Object type used by every request. Default is 2 (Analog Value).\n"
+        "\n"
+        "--objects N\n"
+        "Requests cycle through object instances 0 to N-1. Default is %u.\n"
+        "\n"
+        "--property P\n"
+        "Property that is read and written. Default is 85 (Present Value).\n"
+        "\n"
+        "--priority P\n"
+        "Priority of the WriteProperty requests. Default is 16.\n"
+        "\n"
+        "--mac A\n"
+        "Optional BACnet mac address of the device, for example\n"
+        "127.0.0.1:47808, instead of binding with Who-Is.\n"
+        "\n", LOAD_OBJECTS_DEFAULT);
+    printf("device-instance:\n"
+        "BACnet Device Object Instance number that you are\n"
+        "trying to load.\n"
+        "\nExample:\n"
+        "Load Device 1234 for 30 seconds with 32 outstanding requests:\n"
+        "%s 1234 --duration 30 --concurrency 32\n", filename);
+}
+
+int main(
+    int argc,
+    char *argv[])
+{
+    BACNET_ADDRESS src = {
+        0
+    };  /* address where message came from */
+    BACNET_MAC_ADDRESS mac = { 0 };
+    BACNET_ADDRESS dest = { 0 };
+    uint16_t pdu_len = 0;
+    unsigned max_apdu = 0;
+    bool found = false;
+    bool sending = true;
+    double start_ns = 0.0;
+    double stop_ns = 0.0;
+    double last_ns = 0.0;
+    double now_ns = 0.0;
+    double elapsed_ms = 0.0;
+    double bind_ms = 0.0;
+    int argi = 0;
+    unsigned target_args = 0;
+    char *filename = NULL;
+
+    filename = filename_remove_path(argv[0]);
+    for (argi = 1; argi < argc; argi++) {
+        if (strcmp(argv[argi], "--help") == 0) {
+            print_usage(filename);
+            print_help(filename);
+            return 0;
+        }
+        if (strcmp(argv[argi], "--version") == 0) {
+            printf("%s %s\n", filename, BACNET_VERSION_TEXT);
+            printf("Copyright (C) 2026 by Steve Karg and others.\n"
+                "This is free software; see the source for copying conditions.\n"
+                "There is NO warranty; not even for MERCHANTABILITY or\n"
+                "FITNESS FOR A PARTICULAR PURPOSE.\n");
+            return 0;
+        }
+        if (strcmp(argv[argi], "--duration") == 0) {
+            if (++argi < argc) {
+                Load_Duration = strtoul(argv[argi], NULL, 0);
+            }
+        } else if (strcmp(argv[argi], "--requests") == 0) {
+            if (++argi < argc) {
+                Load_Requests = strtoul(argv[argi], NULL, 0);
+            }
+        } else if (strcmp(argv[argi], "--concurrency") == 0) {
+            if (++argi < argc) {
+                Load_Concurrency = (unsigned) strtoul(argv[argi], NULL, 0);
+            }
+        } else if (strcmp(argv[argi], "--mix") == 0) {
+            if ((++argi >= argc) || !load_mix_parse(argv[argi])) {
+                fprintf(stderr, "--mix needs four weights like 70,10,10,10\n");
+                return 1;
+            }
+        } else if (strcmp(argv[argi], "--object-type") == 0) {
+            if (++argi < argc) {
+                Target_Object_Type = strtol(argv[argi], NULL, 0);
+            }
+        } else if (strcmp(argv[argi], "--objects") == 0) {
+            if (++argi < argc) {
+                Target_Object_Count = strtoul(argv[argi], NULL, 0);
+            }
+        } else if (strcmp(argv[argi], "--property") == 0) {
+            if (++argi < argc) {
+                Target_Object_Property = strtol(argv[argi], NULL, 0);
+            }
+        } else if (strcmp(argv[argi], "--priority") == 0) {
+            if (++argi < argc) {
+                Target_Priority = (uint8_t) strtoul(argv[argi], NULL, 0);
+            }
+        } else if (strcmp(argv[argi], "--mac") == 0) {
+            if (++argi < argc) {
+                if (!address_mac_from_ascii(&mac, argv[argi])) {
+                    mac.len = 0;
+                }
+            }
+        } else if (target_args == 0) {
+            Target_Device_Object_Instance = strtol(argv[argi], NULL, 0);
+            target_args++;
+        } else {
+            print_usage(filename);
+            return 1;
+        }
+    }
+    if (target_args < 1) {
+        print_usage(filename);
+        return 0;
+    }
+    if (Target_Device_Object_Instance > BACNET_MAX_INSTANCE) {
+        fprintf(stderr, "device-instance=%u - it must be less than %u\n",
+            Target_Device_Object_Instance, BACNET_MAX_INSTANCE);
+        return 1;
+    }
+    if ((Load_Concurrency < 1) || (Load_Concurrency > MAX_TSM_TRANSACTIONS)) {
+        fprintf(stderr, "concurrency=%u - it must be 1 to %u\n",
+            Load_Concurrency, (unsigned) MAX_TSM_TRANSACTIONS);
+        return 1;
+    }
+    if (Target_Object_Count < 1) {
+        Target_Object_Count = 1;
+    }
+    if ((Load_Duration == 0) && (Load_Requests == 0)) {
+        Load_Duration = LOAD_DURATION_DEFAULT;
+    }
+    address_init();
+    if (mac.len) {
+        memcpy(&dest.mac[0], &mac.adr[0], mac.len);
+        dest.mac_len = mac.len;
+        dest.len = 0;
+        dest.net = 0;
+        address_add(Target_Device_Object_Instance, MAX_APDU, &dest);
+    }
+    /* setup my info */
+    Device_Set_Object_Instance_Number(BACNET_MAX_INSTANCE);
+    Init_Service_Handlers();
+    dlenv_init();
+    atexit(datalink_cleanup);
+    srand(1);
+    /* try to bind with the device */
+    found =
+        address_bind_request(Target_Device_Object_Instance, &max_apdu,
+        &Target_Address);
+    if (!found) {
+        Send_WhoIs(Target_Device_Object_Instance,
+            Target_Device_Object_Instance);
+    }
+    last_ns = load_now_ns();
+    while (!found) {
+        pdu_len = datalink_receive(&src, &Rx_Buf[0], MAX_MPDU, 100);
+        if (pdu_len) {
+            npdu_handler(&src, &Rx_Buf[0], pdu_len);
+        }
+        found =
+            address_bind_request(Target_Device_Object_Instance, &max_apdu,
+            &Target_Address);
+        bind_ms = (load_now_ns() - last_ns) / 1.0e6;
+        if (!found && (bind_ms > (double) apdu_timeout())) {
+            fprintf(stderr, "\rError: APDU Timeout!\n");
+            return 1;
+        }
+    }
+    start_ns = load_now_ns();
+    last_ns = start_ns;
+    for (;;) {
+        now_ns = load_now_ns();
+        /* the TSM counts whole milliseconds */
+        elapsed_ms += (now_ns - last_ns) / 1.0e6;
+        last_ns = now_ns;
+        if (elapsed_ms >= 1.0) {
+            tsm_timer_milliseconds((uint16_t) elapsed_ms);
+            elapsed_ms -= (double) ((uint16_t) elapsed_ms);
+        }
+        if (sending) {
+            if (Load_Requests) {
+                if (Load_Total.sent >= Load_Requests) {
+                    sending = false;
+                }
+            } else if ((now_ns - start_ns) >= ((double) Load_Duration * 1.0e9)) {
+                sending = false;
+            }
+        }
+        if (sending) {
+            load_fill();
+        } else if (Load_Active == 0) {
+            break;
+        }
+        /* block briefly only when there is nothing else to do */
+        pdu_len =
+            datalink_receive(&src, &Rx_Buf[0], MAX_MPDU,
+            (Load_Active >= Load_Concurrency) || !sending ? 1 : 0);
+        if (pdu_len) {
+            npdu_handler(&src, &Rx_Buf[0], pdu_len);
+        }
+    }
+    stop_ns = load_now_ns();
+    load_report((stop_ns - start_ns) / 1.0e9);
+
+    return Load_Total.done ? 0 : 1;
+}
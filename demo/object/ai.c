@@ -47,7 +47,14 @@
 #endif
 
 
+#if defined(BAC_ROUTING)
+/* each routed Device has Analog Inputs of its own; these are the gateway's */
+static ANALOG_INPUT_DESCR AI_Descr_Gateway[MAX_ANALOG_INPUTS];
+#define AI_Descr ((ANALOG_INPUT_DESCR *) Routed_Device_Object_Data( \
+    AI_Descr_Gateway, sizeof(AI_Descr_Gateway), Analog_Input_Init))
+#else
 ANALOG_INPUT_DESCR AI_Descr[MAX_ANALOG_INPUTS];
+#endif
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Properties_Required[] = {
@@ -225,6 +232,23 @@ static void Analog_Input_COV_Detect(unsigned int index,
     }
 }
 
+#if defined(INTRINSIC_REPORTING)
+/* have the intrinsic reporting of the object evaluated, if it has any
+   limits enabled; otherwise there is nothing to evaluate */
+static void Analog_Input_Reporting_Schedule(
+    uint32_t object_instance,
+    uint32_t seconds)
+{
+    unsigned index = 0;
+
+    index = Analog_Input_Instance_To_Index(object_instance);
+    if ((index < MAX_ANALOG_INPUTS) && AI_Descr[index].Limit_Enable) {
+        Device_Reporting_Schedule(OBJECT_ANALOG_INPUT, object_instance,
+            seconds);
+    }
+}
+#endif
+
 void Analog_Input_Present_Value_Set(
     uint32_t object_instance,
     float value)
@@ -234,6 +258,11 @@ void Analog_Input_Present_Value_Set(
     index = Analog_Input_Instance_To_Index(object_instance);
     if (index < MAX_ANALOG_INPUTS) {
         Analog_Input_COV_Detect(index, value);
+#if defined(INTRINSIC_REPORTING)
+        if (AI_Descr[index].Present_Value != value) {
+            Analog_Input_Reporting_Schedule(object_instance, 0);
+        }
+#endif
         AI_Descr[index].Present_Value = value;
     }
 }
@@ -242,7 +271,7 @@ bool Analog_Input_Object_Name(
     uint32_t object_instance,
     BACNET_CHARACTER_STRING * object_name)
 {
-    static char text_string[32] = "";   /* okay for single thread */
+    static BACNET_THREAD_LOCAL char text_string[32] = "";
     unsigned int index;
     bool status = false;
 
@@ -749,6 +778,7 @@ bool Analog_Input_Write_Property(
             if (status) {
                 CurrentAI->Time_Delay = value.type.Unsigned_Int;
                 CurrentAI->Remaining_Time_Delay = CurrentAI->Time_Delay;
+                CurrentAI->Time_Delay_Active = false;
             }
             break;
 
@@ -869,10 +899,46 @@ bool Analog_Input_Write_Property(
             break;
     }
 
+#if defined(INTRINSIC_REPORTING)
+    if (status) {
+        Analog_Input_Reporting_Schedule(wp_data->object_instance, 0);
+    }
+#endif
     return status;
 }
 
 
+#if defined(INTRINSIC_REPORTING)
+/* The event condition holds: count Remaining_Time_Delay down on the
+   reporting clock and have the object evaluated again when it runs out.
+   Returns true once the condition has held for Time_Delay. */
+static bool Analog_Input_Time_Delay_Expired(
+    ANALOG_INPUT_DESCR * CurrentAI,
+    uint32_t object_instance)
+{
+    uint32_t now = Device_Reporting_Seconds();
+    uint32_t elapsed = 0;
+
+    if (CurrentAI->Time_Delay_Active) {
+        elapsed = now - CurrentAI->Time_Delay_Last;
+    } else {
+        CurrentAI->Time_Delay_Active = true;
+        CurrentAI->Remaining_Time_Delay = CurrentAI->Time_Delay;
+    }
+    CurrentAI->Time_Delay_Last = now;
+    if (elapsed >= CurrentAI->Remaining_Time_Delay) {
+        CurrentAI->Remaining_Time_Delay = CurrentAI->Time_Delay;
+        CurrentAI->Time_Delay_Active = false;
+        return true;
+    }
+    CurrentAI->Remaining_Time_Delay -= elapsed;
+    Device_Reporting_Schedule(OBJECT_ANALOG_INPUT, object_instance,
+        CurrentAI->Remaining_Time_Delay);
+
+    return false;
+}
+#endif
+
 void Analog_Input_Intrinsic_Reporting(
     uint32_t object_instance)
 {
@@ -933,10 +999,8 @@ void Analog_Input_Intrinsic_Reporting(
                         EVENT_HIGH_LIMIT_ENABLE) &&
                     ((CurrentAI->Event_Enable & EVENT_ENABLE_TO_OFFNORMAL) ==
                         EVENT_ENABLE_TO_OFFNORMAL)) {
-                    if (!CurrentAI->Remaining_Time_Delay)
+                    if (Analog_Input_Time_Delay_Expired(CurrentAI, object_instance))
                         CurrentAI->Event_State = EVENT_STATE_HIGH_LIMIT;
-                    else
-                        CurrentAI->Remaining_Time_Delay--;
                     break;
                 }
 
@@ -950,14 +1014,13 @@ void Analog_Input_Intrinsic_Reporting(
                         EVENT_LOW_LIMIT_ENABLE) &&
                     ((CurrentAI->Event_Enable & EVENT_ENABLE_TO_OFFNORMAL) ==
                         EVENT_ENABLE_TO_OFFNORMAL)) {
-                    if (!CurrentAI->Remaining_Time_Delay)
+                    if (Analog_Input_Time_Delay_Expired(CurrentAI, object_instance))
                         CurrentAI->Event_State = EVENT_STATE_LOW_LIMIT;
-                    else
-                        CurrentAI->Remaining_Time_Delay--;
                     break;
                 }
                 /* value of the object is still in the same event state */
                 CurrentAI->Remaining_Time_Delay = CurrentAI->Time_Delay;
+                CurrentAI->Time_Delay_Active = false;
                 break;
 
             case EVENT_STATE_HIGH_LIMIT:
@@ -972,14 +1035,13 @@ void Analog_Input_Intrinsic_Reporting(
                         EVENT_HIGH_LIMIT_ENABLE) &&
                     ((CurrentAI->Event_Enable & EVENT_ENABLE_TO_NORMAL) ==
                         EVENT_ENABLE_TO_NORMAL)) {
-                    if (!CurrentAI->Remaining_Time_Delay)
+                    if (Analog_Input_Time_Delay_Expired(CurrentAI, object_instance))
                         CurrentAI->Event_State = EVENT_STATE_NORMAL;
-                    else
-                        CurrentAI->Remaining_Time_Delay--;
                     break;
                 }
                 /* value of the object is still in the same event state */
                 CurrentAI->Remaining_Time_Delay = CurrentAI->Time_Delay;
+                CurrentAI->Time_Delay_Active = false;
                 break;
 
             case EVENT_STATE_LOW_LIMIT:
@@ -995,14 +1057,13 @@ void Analog_Input_Intrinsic_Reporting(
                         EVENT_LOW_LIMIT_ENABLE) &&
                     ((CurrentAI->Event_Enable & EVENT_ENABLE_TO_NORMAL) ==
                         EVENT_ENABLE_TO_NORMAL)) {
-                    if (!CurrentAI->Remaining_Time_Delay)
+                    if (Analog_Input_Time_Delay_Expired(CurrentAI, object_instance))
                         CurrentAI->Event_State = EVENT_STATE_NORMAL;
-                    else
-                        CurrentAI->Remaining_Time_Delay--;
                     break;
                 }
                 /* value of the object is still in the same event state */
                 CurrentAI->Remaining_Time_Delay = CurrentAI->Time_Delay;
+                CurrentAI->Time_Delay_Active = false;
                 break;
 
             default:
@@ -1341,6 +1402,8 @@ int Analog_Input_Alarm_Ack(
             return -2;
     }
     CurrentAI->Ack_notify_data.bSendAckNotify = true;
+    Analog_Input_Reporting_Schedule(
+        alarmack_data->eventObjectIdentifier.instance, 0);
     CurrentAI->Ack_notify_data.EventState = alarmack_data->eventStateAcked;
 
     return 1;
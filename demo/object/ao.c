@@ -36,6 +36,9 @@
 #include "wp.h"
 #include "ao.h"
 #include "handlers.h"
+#if defined(BAC_ROUTING)
+#include "device.h"
+#endif
 
 #ifndef MAX_ANALOG_OUTPUTS
 #define MAX_ANALOG_OUTPUTS 4
@@ -51,6 +54,21 @@
 /* Here is our Priority Array.  They are supposed to be Real, but */
 /* we don't have that kind of memory, so we will use a single byte */
 /* and load a Real for returning the value when asked. */
+#if defined(BAC_ROUTING)
+/* each routed Device has Analog Outputs of its own; these are the gateway's */
+static uint8_t
+    Analog_Output_Level_Gateway[MAX_ANALOG_OUTPUTS][BACNET_MAX_PRIORITY];
+static bool Out_Of_Service_Gateway[MAX_ANALOG_OUTPUTS];
+static bool Analog_Output_Initialized_Gateway = false;
+#define Analog_Output_Level ((uint8_t (*)[BACNET_MAX_PRIORITY]) \
+    Routed_Device_Object_Data(Analog_Output_Level_Gateway, \
+    sizeof(Analog_Output_Level_Gateway), Analog_Output_Init))
+#define Out_Of_Service ((bool *) Routed_Device_Object_Data( \
+    Out_Of_Service_Gateway, sizeof(Out_Of_Service_Gateway), \
+    Analog_Output_Init))
+#define Analog_Output_Initialized (*(bool *) Routed_Device_Object_Data( \
+    &Analog_Output_Initialized_Gateway, sizeof(bool), Analog_Output_Init))
+#else
 static uint8_t Analog_Output_Level[MAX_ANALOG_OUTPUTS][BACNET_MAX_PRIORITY];
 /* Writable out-of-service allows others to play with our Present Value */
 /* without changing the physical output */
@@ -58,6 +76,7 @@ static bool Out_Of_Service[MAX_ANALOG_OUTPUTS];
 
 /* we need to have our arrays initialized before answering any calls */
 static bool Analog_Output_Initialized = false;
+#endif
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Properties_Required[] = {
@@ -256,7 +275,7 @@ bool Analog_Output_Object_Name(
     uint32_t object_instance,
     BACNET_CHARACTER_STRING * object_name)
 {
-    static char text_string[32] = "";   /* okay for single thread */
+    static BACNET_THREAD_LOCAL char text_string[32] = "";
     bool status = false;
 
     if (object_instance < MAX_ANALOG_OUTPUTS) {
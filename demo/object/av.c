@@ -46,7 +46,14 @@
 #define MAX_ANALOG_VALUES 4
 #endif
 
+#if defined(BAC_ROUTING)
+/* each routed Device has Analog Values of its own; these are the gateway's */
+static ANALOG_VALUE_DESCR AV_Descr_Gateway[MAX_ANALOG_VALUES];
+#define AV_Descr ((ANALOG_VALUE_DESCR *) Routed_Device_Object_Data( \
+    AV_Descr_Gateway, sizeof(AV_Descr_Gateway), Analog_Value_Init))
+#else
 ANALOG_VALUE_DESCR AV_Descr[MAX_ANALOG_VALUES];
+#endif
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Analog_Value_Properties_Required[] = {
@@ -211,6 +218,23 @@ static void Analog_Value_COV_Detect(unsigned int index,
  *
  * @return  true if values are within range and present-value is set.
  */
+#if defined(INTRINSIC_REPORTING)
+/* have the intrinsic reporting of the object evaluated, if it has any
+   limits enabled; otherwise there is nothing to evaluate */
+static void Analog_Value_Reporting_Schedule(
+    uint32_t object_instance,
+    uint32_t seconds)
+{
+    unsigned index = 0;
+
+    index = Analog_Value_Instance_To_Index(object_instance);
+    if ((index < MAX_ANALOG_VALUES) && AV_Descr[index].Limit_Enable) {
+        Device_Reporting_Schedule(OBJECT_ANALOG_VALUE, object_instance,
+            seconds);
+    }
+}
+#endif
+
 bool Analog_Value_Present_Value_Set(
     uint32_t object_instance,
     float value,
@@ -222,6 +246,11 @@ bool Analog_Value_Present_Value_Set(
     index = Analog_Value_Instance_To_Index(object_instance);
     if (index < MAX_ANALOG_VALUES) {
         Analog_Value_COV_Detect(index, value);
+#if defined(INTRINSIC_REPORTING)
+        if (AV_Descr[index].Present_Value != value) {
+            Analog_Value_Reporting_Schedule(object_instance, 0);
+        }
+#endif
         AV_Descr[index].Present_Value = value;
         status = true;
     }
@@ -247,7 +276,7 @@ bool Analog_Value_Object_Name(
     uint32_t object_instance,
     BACNET_CHARACTER_STRING * object_name)
 {
-    static char text_string[32] = "";   /* okay for single thread */
+    static BACNET_THREAD_LOCAL char text_string[32] = "";
     bool status = false;
 
     if (object_instance < MAX_ANALOG_VALUES) {
@@ -746,6 +775,7 @@ bool Analog_Value_Write_Property(
             if (status) {
                 CurrentAV->Time_Delay = value.type.Unsigned_Int;
                 CurrentAV->Remaining_Time_Delay = CurrentAV->Time_Delay;
+                CurrentAV->Time_Delay_Active = false;
             }
             break;
 
@@ -864,10 +894,46 @@ bool Analog_Value_Write_Property(
             break;
     }
 
+#if defined(INTRINSIC_REPORTING)
+    if (status) {
+        Analog_Value_Reporting_Schedule(wp_data->object_instance, 0);
+    }
+#endif
     return status;
 }
 
 
+#if defined(INTRINSIC_REPORTING)
+/* The event condition holds: count Remaining_Time_Delay down on the
+   reporting clock and have the object evaluated again when it runs out.
+   Returns true once the condition has held for Time_Delay. */
+static bool Analog_Value_Time_Delay_Expired(
+    ANALOG_VALUE_DESCR * CurrentAV,
+    uint32_t object_instance)
+{
+    uint32_t now = Device_Reporting_Seconds();
+    uint32_t elapsed = 0;
+
+    if (CurrentAV->Time_Delay_Active) {
+        elapsed = now - CurrentAV->Time_Delay_Last;
+    } else {
+        CurrentAV->Time_Delay_Active = true;
+        CurrentAV->Remaining_Time_Delay = CurrentAV->Time_Delay;
+    }
+    CurrentAV->Time_Delay_Last = now;
+    if (elapsed >= CurrentAV->Remaining_Time_Delay) {
+        CurrentAV->Remaining_Time_Delay = CurrentAV->Time_Delay;
+        CurrentAV->Time_Delay_Active = false;
+        return true;
+    }
+    CurrentAV->Remaining_Time_Delay -= elapsed;
+    Device_Reporting_Schedule(OBJECT_ANALOG_VALUE, object_instance,
+        CurrentAV->Remaining_Time_Delay);
+
+    return false;
+}
+#endif
+
 void Analog_Value_Intrinsic_Reporting(
     uint32_t object_instance)
 {
@@ -928,10 +994,8 @@ void Analog_Value_Intrinsic_Reporting(
                         EVENT_HIGH_LIMIT_ENABLE) &&
                     ((CurrentAV->Event_Enable & EVENT_ENABLE_TO_OFFNORMAL) ==
                         EVENT_ENABLE_TO_OFFNORMAL)) {
-                    if (!CurrentAV->Remaining_Time_Delay)
+                    if (Analog_Value_Time_Delay_Expired(CurrentAV, object_instance))
                         CurrentAV->Event_State = EVENT_STATE_HIGH_LIMIT;
-                    else
-                        CurrentAV->Remaining_Time_Delay--;
                     break;
                 }
 
@@ -945,14 +1009,13 @@ void Analog_Value_Intrinsic_Reporting(
                         EVENT_LOW_LIMIT_ENABLE) &&
                     ((CurrentAV->Event_Enable & EVENT_ENABLE_TO_OFFNORMAL) ==
                         EVENT_ENABLE_TO_OFFNORMAL)) {
-                    if (!CurrentAV->Remaining_Time_Delay)
+                    if (Analog_Value_Time_Delay_Expired(CurrentAV, object_instance))
                         CurrentAV->Event_State = EVENT_STATE_LOW_LIMIT;
-                    else
-                        CurrentAV->Remaining_Time_Delay--;
                     break;
                 }
                 /* value of the object is still in the same event state */
                 CurrentAV->Remaining_Time_Delay = CurrentAV->Time_Delay;
+                CurrentAV->Time_Delay_Active = false;
                 break;
 
             case EVENT_STATE_HIGH_LIMIT:
@@ -967,14 +1030,13 @@ void Analog_Value_Intrinsic_Reporting(
                         EVENT_HIGH_LIMIT_ENABLE) &&
                     ((CurrentAV->Event_Enable & EVENT_ENABLE_TO_NORMAL) ==
                         EVENT_ENABLE_TO_NORMAL)) {
-                    if (!CurrentAV->Remaining_Time_Delay)
+                    if (Analog_Value_Time_Delay_Expired(CurrentAV, object_instance))
                         CurrentAV->Event_State = EVENT_STATE_NORMAL;
-                    else
-                        CurrentAV->Remaining_Time_Delay--;
                     break;
                 }
                 /* value of the object is still in the same event state */
                 CurrentAV->Remaining_Time_Delay = CurrentAV->Time_Delay;
+                CurrentAV->Time_Delay_Active = false;
                 break;
 
             case EVENT_STATE_LOW_LIMIT:
@@ -990,14 +1052,13 @@ void Analog_Value_Intrinsic_Reporting(
                         EVENT_LOW_LIMIT_ENABLE) &&
                     ((CurrentAV->Event_Enable & EVENT_ENABLE_TO_NORMAL) ==
                         EVENT_ENABLE_TO_NORMAL)) {
-                    if (!CurrentAV->Remaining_Time_Delay)
+                    if (Analog_Value_Time_Delay_Expired(CurrentAV, object_instance))
                         CurrentAV->Event_State = EVENT_STATE_NORMAL;
-                    else
-                        CurrentAV->Remaining_Time_Delay--;
                     break;
                 }
                 /* value of the object is still in the same event state */
                 CurrentAV->Remaining_Time_Delay = CurrentAV->Time_Delay;
+                CurrentAV->Time_Delay_Active = false;
                 break;
 
             default:
@@ -1337,6 +1398,8 @@ int Analog_Value_Alarm_Ack(
 
     /* Need to send AckNotification. */
     CurrentAV->Ack_notify_data.bSendAckNotify = true;
+    Analog_Value_Reporting_Schedule(
+        alarmack_data->eventObjectIdentifier.instance, 0);
     CurrentAV->Ack_notify_data.EventState = alarmack_data->eventStateAcked;
 
     /* Return OK */
@@ -64,6 +64,9 @@ extern "C" {
         BACNET_DATE_TIME Event_Time_Stamps[MAX_BACNET_EVENT_TRANSITION];
         /* time to generate event notification */
         uint32_t Remaining_Time_Delay;
+        /* reporting clock when Remaining_Time_Delay was last counted down */
+        uint32_t Time_Delay_Last;
+        bool Time_Delay_Active;
         /* AckNotification informations */
         ACK_NOTIFICATION Ack_notify_data;
 #endif
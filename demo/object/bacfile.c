@@ -44,6 +44,16 @@
 #include "handlers.h"
 #include "bacfile.h"
 
+#if !defined(BACFILE_POSIX_IO) && (defined(__unix__) || defined(__APPLE__))
+#define BACFILE_POSIX_IO 1
+#endif
+
+#if BACFILE_POSIX_IO
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 typedef struct {
     uint32_t instance;
     char *filename;
@@ -98,22 +108,32 @@ void BACfile_Property_Lists(
     return;
 }
 
-static char *bacfile_name(
+static int bacfile_index(
     uint32_t instance)
 {
-    uint32_t index = 0;
-    char *filename = NULL;
+    int index = 0;
 
     /* linear search for file instance match */
     while (BACnet_File_Listing[index].filename) {
         if (BACnet_File_Listing[index].instance == instance) {
-            filename = BACnet_File_Listing[index].filename;
-            break;
+            return index;
         }
         index++;
     }
 
-    return filename;
+    return -1;
+}
+
+static char *bacfile_name(
+    uint32_t instance)
+{
+    int index = bacfile_index(instance);
+
+    if (index < 0) {
+        return NULL;
+    }
+
+    return BACnet_File_Listing[index].filename;
 }
 
 bool bacfile_object_name(
@@ -168,36 +188,401 @@ uint32_t bacfile_index_to_instance(
     return instance;
 }
 
-static long fsize(
-    FILE * pFile)
+/*
+ * File access.
+ *
+ * Rather than open and close the file for every AtomicReadFile or
+ * AtomicWriteFile request (a transfer of a few MB in MAX_APDU sized
+ * pieces would otherwise do thousands of opens) each File object keeps
+ * its file open once it has been used, up to BACFILE_OPEN_MAX files at a
+ * time with the least recently used closed to make room. Reads and writes
+ * are positioned (pread/pwrite where available) so no seek state is
+ * shared between requests, and the file size is tracked as we write
+ * rather than being worked out on each File_Size read.
+ *
+ * For record access a record is a line of text, as the record write code
+ * has always assumed. The offset of each record is indexed the first time
+ * record access is used and the index is extended as records are appended,
+ * so record N is found without rescanning the file. Writes anywhere other
+ * than the end of the file drop the index to be rebuilt when next needed.
+ *
+ * The file may also be changed, or replaced, by something other than us.
+ * Where stat() is available each use compares the file with what was seen
+ * after the last open or write (device, inode, size and modification time)
+ * and a file that differs is opened again, so the size and the record index
+ * are worked out afresh.
+ */
+
+#ifndef BACFILE_OPEN_MAX
+#define BACFILE_OPEN_MAX 4
+#endif
+
+typedef struct {
+    FILE *pFile;        /* NULL if not open */
+    bool writable;      /* opened for update */
+    long size;  /* current size of the file */
+    unsigned long last_used;    /* for picking which to close */
+    /* record (line) start offsets */
+    long *record_offset;
+    uint32_t record_count;
+    uint32_t record_capacity;
+    bool record_valid;  /* index matches the file */
+    bool record_pending;        /* next octet appended starts a record */
+#if BACFILE_POSIX_IO
+    struct stat file_stat;      /* the file as we last left it */
+#endif
+} BACFILE_HANDLE;
+
+static BACFILE_HANDLE BACnet_File_Handle[sizeof(BACnet_File_Listing) /
+    sizeof(BACnet_File_Listing[0])];
+static unsigned long BACnet_File_Use_Count;
+
+static void bacfile_handle_close(
+    BACFILE_HANDLE * pHandle)
 {
-    long size = 0;
-    long origin = 0;
+    if (pHandle->pFile) {
+        fclose(pHandle->pFile);
+    }
+    free(pHandle->record_offset);
+    memset(pHandle, 0, sizeof(BACFILE_HANDLE));
+}
 
-    if (pFile) {
-        origin = ftell(pFile);
-        fseek(pFile, 0L, SEEK_END);
-        size = ftell(pFile);
-        fseek(pFile, origin, SEEK_SET);
+#if BACFILE_POSIX_IO
+#if defined(__APPLE__)
+#define BACFILE_MTIME_NSEC(st) ((st).st_mtimespec.tv_nsec)
+#else
+#define BACFILE_MTIME_NSEC(st) ((st).st_mtim.tv_nsec)
+#endif
+
+/* Note the file as it is now, after opening or writing it */
+static void bacfile_handle_stat(
+    BACFILE_HANDLE * pHandle)
+{
+    if (fstat(fileno(pHandle->pFile), &pHandle->file_stat) != 0) {
+        memset(&pHandle->file_stat, 0, sizeof(pHandle->file_stat));
+    }
+}
+
+/* Is the open file still the one at the file name, as we left it? */
+static bool bacfile_handle_current(
+    BACFILE_HANDLE * pHandle,
+    const char *filename)
+{
+    struct stat file_stat;
+
+    if (stat(filename, &file_stat) != 0) {
+        return false;
+    }
+
+    return (file_stat.st_dev == pHandle->file_stat.st_dev) &&
+        (file_stat.st_ino == pHandle->file_stat.st_ino) &&
+        (file_stat.st_size == pHandle->file_stat.st_size) &&
+        (file_stat.st_mtime == pHandle->file_stat.st_mtime) &&
+        (BACFILE_MTIME_NSEC(file_stat) ==
+        BACFILE_MTIME_NSEC(pHandle->file_stat));
+}
+#endif
+
+/* Open (or find the open) file for an instance, for update if writing is
+   needed. Returns NULL if the file can't be opened that way. */
+static BACFILE_HANDLE *bacfile_handle(
+    uint32_t instance,
+    bool write)
+{
+    BACFILE_HANDLE *pHandle = NULL;
+    BACFILE_HANDLE *pOldest = NULL;
+    unsigned open_count = 0;
+    int index = 0;
+    unsigned i = 0;
+
+    index = bacfile_index(instance);
+    if (index < 0) {
+        return NULL;
+    }
+    pHandle = &BACnet_File_Handle[index];
+    if (pHandle->pFile && write && !pHandle->writable) {
+        /* need to upgrade a read only handle */
+        bacfile_handle_close(pHandle);
+    }
+#if BACFILE_POSIX_IO
+    if (pHandle->pFile &&
+        !bacfile_handle_current(pHandle,
+            BACnet_File_Listing[index].filename)) {
+        /* changed behind our back: the size and index are stale */
+        bacfile_handle_close(pHandle);
+    }
+#endif
+    if (!pHandle->pFile) {
+        /* make room if we have too many open */
+        for (i = 0; i < bacfile_count(); i++) {
+            if (BACnet_File_Handle[i].pFile) {
+                open_count++;
+                if (!pOldest ||
+                    (BACnet_File_Handle[i].last_used < pOldest->last_used)) {
+                    pOldest = &BACnet_File_Handle[i];
+                }
+            }
+        }
+        if (pOldest && (open_count >= BACFILE_OPEN_MAX)) {
+            bacfile_handle_close(pOldest);
+        }
+        pHandle->writable = true;
+        pHandle->pFile = fopen(BACnet_File_Listing[index].filename, "rb+");
+        if (!pHandle->pFile && write) {
+            pHandle->pFile = fopen(BACnet_File_Listing[index].filename, "wb+");
+        }
+        if (!pHandle->pFile && !write) {
+            pHandle->writable = false;
+            pHandle->pFile = fopen(BACnet_File_Listing[index].filename, "rb");
+        }
+        if (!pHandle->pFile) {
+            return NULL;
+        }
+        fseek(pHandle->pFile, 0L, SEEK_END);
+        pHandle->size = ftell(pHandle->pFile);
+        if (pHandle->size < 0) {
+            pHandle->size = 0;
+        }
+#if BACFILE_POSIX_IO
+        bacfile_handle_stat(pHandle);
+#endif
+    }
+    pHandle->last_used = ++BACnet_File_Use_Count;
+
+    return pHandle;
+}
+
+static size_t bacfile_pread(
+    BACFILE_HANDLE * pHandle,
+    void *buffer,
+    size_t length,
+    long offset)
+{
+#if BACFILE_POSIX_IO
+    ssize_t len = pread(fileno(pHandle->pFile), buffer, length, offset);
+
+    return (len > 0) ? (size_t) len : 0;
+#else
+    if (fseek(pHandle->pFile, offset, SEEK_SET) != 0) {
+        return 0;
+    }
+    return fread(buffer, 1, length, pHandle->pFile);
+#endif
+}
+
+static bool bacfile_pwrite(
+    BACFILE_HANDLE * pHandle,
+    const void *buffer,
+    size_t length,
+    long offset)
+{
+#if BACFILE_POSIX_IO
+    return pwrite(fileno(pHandle->pFile), buffer, length,
+        offset) == (ssize_t) length;
+#else
+    if (fseek(pHandle->pFile, offset, SEEK_SET) != 0) {
+        return false;
+    }
+    if (fwrite(buffer, length, 1, pHandle->pFile) != 1) {
+        return false;
+    }
+    return fflush(pHandle->pFile) == 0;
+#endif
+}
+
+/* Add any records starting in a piece of data just added at the end */
+static bool bacfile_record_index_extend(
+    BACFILE_HANDLE * pHandle,
+    const uint8_t * data,
+    size_t length,
+    long offset)
+{
+    long *record_offset = NULL;
+    size_t i = 0;
+
+    for (i = 0; i < length; i++) {
+        if (pHandle->record_pending) {
+            if (pHandle->record_count == pHandle->record_capacity) {
+                record_offset =
+                    realloc(pHandle->record_offset,
+                    (pHandle->record_capacity + 64) * sizeof(long));
+                if (!record_offset) {
+                    pHandle->record_valid = false;
+                    return false;
+                }
+                pHandle->record_offset = record_offset;
+                pHandle->record_capacity += 64;
+            }
+            pHandle->record_offset[pHandle->record_count++] =
+                offset + (long) i;
+        }
+        pHandle->record_pending = (data[i] == '\n');
+    }
+
+    return true;
+}
+
+/* Make sure the record index is up to date */
+static bool bacfile_record_index(
+    BACFILE_HANDLE * pHandle)
+{
+    uint8_t buffer[1024];
+    size_t len = 0;
+    long offset = 0;
+
+    if (pHandle->record_valid) {
+        return true;
+    }
+    pHandle->record_count = 0;
+    pHandle->record_pending = true;
+    pHandle->record_valid = true;
+    while (offset < pHandle->size) {
+        len = bacfile_pread(pHandle, buffer, sizeof(buffer), offset);
+        if (len == 0) {
+            break;
+        }
+        if (!bacfile_record_index_extend(pHandle, buffer, len, offset)) {
+            return false;
+        }
+        offset += (long) len;
+    }
+
+    return true;
+}
+
+/* Write data at an offset keeping the size and record index up to date */
+static bool bacfile_write_at(
+    BACFILE_HANDLE * pHandle,
+    const uint8_t * data,
+    size_t length,
+    long offset)
+{
+    if (!bacfile_pwrite(pHandle, data, length, offset)) {
+        return false;
+    }
+    if (pHandle->record_valid) {
+        if (offset == pHandle->size) {
+            bacfile_record_index_extend(pHandle, data, length, offset);
+        } else {
+            pHandle->record_valid = false;
+        }
+    }
+    if ((offset + (long) length) > pHandle->size) {
+        pHandle->size = offset + (long) length;
+    }
+#if BACFILE_POSIX_IO
+    bacfile_handle_stat(pHandle);
+#endif
+
+    return true;
+}
+
+/* Start the file again from empty */
+static bool bacfile_truncate(
+    BACFILE_HANDLE * pHandle,
+    uint32_t instance)
+{
+#if BACFILE_POSIX_IO
+    (void) instance;
+    fflush(pHandle->pFile);
+    if (ftruncate(fileno(pHandle->pFile), 0) != 0) {
+        return false;
+    }
+#else
+    pHandle->pFile = freopen(bacfile_name(instance), "wb+", pHandle->pFile);
+    if (!pHandle->pFile) {
+        bacfile_handle_close(pHandle);
+        return false;
+    }
+#endif
+    pHandle->size = 0;
+    pHandle->record_count = 0;
+    pHandle->record_pending = true;
+#if BACFILE_POSIX_IO
+    bacfile_handle_stat(pHandle);
+#endif
+
+    return true;
+}
+
+/* Write a run of records. Record 0 starts the file over, -1 appends
+   and anything else overwrites from the start of that record on. */
+static bool bacfile_write_records(
+    uint32_t instance,
+    int32_t start_record,
+    BACNET_OCTET_STRING * records,
+    uint32_t record_count)
+{
+    BACFILE_HANDLE *pHandle = NULL;
+    long offset = 0;
+    uint32_t i = 0;
+
+    pHandle = bacfile_handle(instance, true);
+    if (!pHandle) {
+        return false;
     }
-    return (size);
+    if (start_record == 0) {
+        if (!bacfile_truncate(pHandle, instance)) {
+            return false;
+        }
+    } else if (start_record == -1) {
+        offset = pHandle->size;
+    } else if (start_record > 0) {
+        if (!bacfile_record_index(pHandle)) {
+            return false;
+        }
+        if ((uint32_t) start_record < pHandle->record_count) {
+            offset = pHandle->record_offset[start_record];
+        } else {
+            offset = pHandle->size;
+        }
+    } else {
+        return false;
+    }
+    for (i = 0; i < record_count; i++) {
+        if (!bacfile_write_at(pHandle, octetstring_value(&records[i]),
+                octetstring_length(&records[i]), offset)) {
+            return false;
+        }
+        offset += (long) octetstring_length(&records[i]);
+    }
+
+    return true;
 }
 
+/* The size is read from the file system and not from the open handles,
+   since worker threads read it with only the read lock of the objects. */
 unsigned bacfile_file_size(
     uint32_t object_instance)
 {
-    char *pFilename = NULL;
+#if BACFILE_POSIX_IO
+    struct stat file_stat;
+#else
     FILE *pFile = NULL;
+    long file_position = 0;
+#endif
     unsigned file_size = 0;
+    int index = 0;
 
-    pFilename = bacfile_name(object_instance);
-    if (pFilename) {
-        pFile = fopen(pFilename, "rb");
-        if (pFile) {
-            file_size = fsize(pFile);
-            fclose(pFile);
+    index = bacfile_index(object_instance);
+    if (index < 0) {
+        return 0;
+    }
+#if BACFILE_POSIX_IO
+    if (stat(BACnet_File_Listing[index].filename, &file_stat) == 0) {
+        file_size = (unsigned) file_stat.st_size;
+    }
+#else
+    pFile = fopen(BACnet_File_Listing[index].filename, "rb");
+    if (pFile) {
+        fseek(pFile, 0L, SEEK_END);
+        file_position = ftell(pFile);
+        if (file_position > 0) {
+            file_size = (unsigned) file_position;
         }
+        fclose(pFile);
     }
+#endif
 
     return file_size;
 }
@@ -444,30 +829,30 @@ uint32_t bacfile_instance_from_tsm(
 bool bacfile_read_stream_data(
     BACNET_ATOMIC_READ_FILE_DATA * data)
 {
-    char *pFilename = NULL;
+    BACFILE_HANDLE *pHandle = NULL;
     bool found = false;
-    FILE *pFile = NULL;
     size_t len = 0;
+    size_t requested = 0;
 
-    pFilename = bacfile_name(data->object_instance);
-    if (pFilename) {
+    if (bacfile_name(data->object_instance)) {
         found = true;
-        pFile = fopen(pFilename, "rb");
-        if (pFile) {
-            (void) fseek(pFile, data->type.stream.fileStartPosition, SEEK_SET);
-            len =
-                fread(octetstring_value(&data->fileData[0]), 1,
-                data->type.stream.requestedOctetCount, pFile);
-            if (len < data->type.stream.requestedOctetCount)
-                data->endOfFile = true;
-            else
-                data->endOfFile = false;
-            octetstring_truncate(&data->fileData[0], len);
-            fclose(pFile);
-        } else {
-            octetstring_truncate(&data->fileData[0], 0);
-            data->endOfFile = true;
+        pHandle = bacfile_handle(data->object_instance, false);
+    }
+    if (pHandle && (data->type.stream.fileStartPosition >= 0)) {
+        requested = data->type.stream.requestedOctetCount;
+        if (requested > octetstring_capacity(&data->fileData[0])) {
+            requested = octetstring_capacity(&data->fileData[0]);
         }
+        len =
+            bacfile_pread(pHandle, octetstring_value(&data->fileData[0]),
+            requested, data->type.stream.fileStartPosition);
+        /* end of file if this includes the last octet */
+        if ((data->type.stream.fileStartPosition + (long) len) >=
+            pHandle->size)
+            data->endOfFile = true;
+        else
+            data->endOfFile = false;
+        octetstring_truncate(&data->fileData[0], len);
     } else {
         octetstring_truncate(&data->fileData[0], 0);
         data->endOfFile = true;
@@ -479,88 +864,83 @@ bool bacfile_read_stream_data(
 bool bacfile_write_stream_data(
     BACNET_ATOMIC_WRITE_FILE_DATA * data)
 {
-    char *pFilename = NULL;
-    bool found = false;
-    FILE *pFile = NULL;
+    BACFILE_HANDLE *pHandle = NULL;
+    long offset = 0;
 
-    pFilename = bacfile_name(data->object_instance);
-    if (pFilename) {
-        found = true;
-        if (data->type.stream.fileStartPosition == 0) {
-            /* open the file as a clean slate when starting at 0 */
-            pFile = fopen(pFilename, "wb");
-        } else if (data->type.stream.fileStartPosition == -1) {
-            /* If 'File Start Position' parameter has the special
-               value -1, then the write operation shall be treated
-               as an append to the current end of file. */
-            pFile = fopen(pFilename, "ab+");
-        } else {
-            /* open for update */
-            pFile = fopen(pFilename, "rb+");
-        }
-        if (pFile) {
-            if (data->type.stream.fileStartPosition != -1) {
-                (void) fseek(pFile, data->type.stream.fileStartPosition,
-                    SEEK_SET);
-            }
-            if (fwrite(octetstring_value(&data->fileData[0]),
-                    octetstring_length(&data->fileData[0]), 1, pFile) != 1) {
-                /* do something if it fails? */
-            }
-            fclose(pFile);
+    pHandle = bacfile_handle(data->object_instance, true);
+    if (!pHandle) {
+        return false;
+    }
+    if (data->type.stream.fileStartPosition == 0) {
+        /* a clean slate when starting at 0 */
+        if (!bacfile_truncate(pHandle, data->object_instance)) {
+            return false;
         }
+    } else if (data->type.stream.fileStartPosition == -1) {
+        /* If 'File Start Position' parameter has the special
+           value -1, then the write operation shall be treated
+           as an append to the current end of file. */
+        offset = pHandle->size;
+    } else if (data->type.stream.fileStartPosition > 0) {
+        offset = data->type.stream.fileStartPosition;
+    } else {
+        return false;
     }
 
-    return found;
+    return bacfile_write_at(pHandle, octetstring_value(&data->fileData[0]),
+        octetstring_length(&data->fileData[0]), offset);
 }
 
-bool bacfile_write_record_data(
-    BACNET_ATOMIC_WRITE_FILE_DATA * data)
+bool bacfile_read_record_data(
+    BACNET_ATOMIC_READ_FILE_DATA * data)
 {
-    char *pFilename = NULL;
-    bool found = false;
-    FILE *pFile = NULL;
+    BACFILE_HANDLE *pHandle = NULL;
+    uint32_t record = 0;
     uint32_t i = 0;
-    char dummy_data[FILE_RECORD_SIZE];
-    char *pData = NULL;
+    long start = 0;
+    long end = 0;
+    size_t len = 0;
 
-    pFilename = bacfile_name(data->object_instance);
-    if (pFilename) {
-        found = true;
-        if (data->type.record.fileStartRecord == 0) {
-            /* open the file as a clean slate when starting at 0 */
-            pFile = fopen(pFilename, "wb");
-        } else if (data->type.record.fileStartRecord == -1) {
-            /* If 'File Start Record' parameter has the special
-               value -1, then the write operation shall be treated
-               as an append to the current end of file. */
-            pFile = fopen(pFilename, "ab+");
+    pHandle = bacfile_handle(data->object_instance, false);
+    if (!pHandle || !bacfile_record_index(pHandle)) {
+        return false;
+    }
+    if ((data->type.record.fileStartRecord < 0) ||
+        ((uint32_t) data->type.record.fileStartRecord >
+            pHandle->record_count)) {
+        return false;
+    }
+    record = (uint32_t) data->type.record.fileStartRecord;
+    for (i = 0; (i < data->type.record.RecordCount) &&
+        (i < BACNET_READ_FILE_RECORD_COUNT) &&
+        (record < pHandle->record_count); i++, record++) {
+        start = pHandle->record_offset[record];
+        if ((record + 1) < pHandle->record_count) {
+            end = pHandle->record_offset[record + 1];
         } else {
-            /* open for update */
-            pFile = fopen(pFilename, "rb+");
+            end = pHandle->size;
         }
-        if (pFile) {
-            if ((data->type.record.fileStartRecord != -1) &&
-                (data->type.record.fileStartRecord > 0)) {
-                for (i = 0; i < (uint32_t)data->type.record.fileStartRecord; i++) {
-                    pData = fgets(&dummy_data[0], sizeof(dummy_data), pFile);
-                    if ((pData == NULL) || feof(pFile)) {
-                        break;
-                    }
-                }
-            }
-            for (i = 0; i < data->type.record.returnedRecordCount; i++) {
-                if (fwrite(octetstring_value(&data->fileData[i]),
-                        octetstring_length(&data->fileData[i]), 1,
-                        pFile) != 1) {
-                    /* do something if it fails? */
-                }
-            }
-            fclose(pFile);
+        len = (size_t) (end - start);
+        if (len > octetstring_capacity(&data->fileData[i])) {
+            len = octetstring_capacity(&data->fileData[i]);
         }
+        len =
+            bacfile_pread(pHandle, octetstring_value(&data->fileData[i]), len,
+            start);
+        octetstring_truncate(&data->fileData[i], len);
     }
+    data->type.record.RecordCount = i;
+    data->endOfFile = (record >= pHandle->record_count);
 
-    return found;
+    return true;
+}
+
+bool bacfile_write_record_data(
+    BACNET_ATOMIC_WRITE_FILE_DATA * data)
+{
+    return bacfile_write_records(data->object_instance,
+        data->type.record.fileStartRecord, &data->fileData[0],
+        data->type.record.returnedRecordCount);
 }
 
 bool bacfile_read_ack_stream_data(
@@ -568,23 +948,19 @@ bool bacfile_read_ack_stream_data(
     BACNET_ATOMIC_READ_FILE_DATA * data)
 {
     bool found = false;
-    FILE *pFile = NULL;
-    char *pFilename = NULL;
+    BACFILE_HANDLE *pHandle = NULL;
 
-    pFilename = bacfile_name(instance);
-    if (pFilename) {
+    if (bacfile_name(instance)) {
         found = true;
-        pFile = fopen(pFilename, "rb");
-        if (pFile) {
-            (void) fseek(pFile, data->type.stream.fileStartPosition, SEEK_SET);
-            if (fwrite(octetstring_value(&data->fileData[0]),
-                    octetstring_length(&data->fileData[0]), 1, pFile) != 1) {
+        pHandle = bacfile_handle(instance, true);
+        if (!pHandle || (data->type.stream.fileStartPosition < 0) ||
+            !bacfile_write_at(pHandle, octetstring_value(&data->fileData[0]),
+                octetstring_length(&data->fileData[0]),
+                data->type.stream.fileStartPosition)) {
 #if PRINT_ENABLED
-                fprintf(stderr, "Failed to write to %s (%lu)!\n", pFilename,
-                    (unsigned long) instance);
+            fprintf(stderr, "Failed to write to %s (%lu)!\n",
+                bacfile_name(instance), (unsigned long) instance);
 #endif
-            }
-            fclose(pFile);
         }
     }
 
@@ -596,36 +972,15 @@ bool bacfile_read_ack_record_data(
     BACNET_ATOMIC_READ_FILE_DATA * data)
 {
     bool found = false;
-    FILE *pFile = NULL;
-    char *pFilename = NULL;
-    uint32_t i = 0;
-    char dummy_data[MAX_OCTET_STRING_BYTES] = { 0 };
-    char *pData = NULL;
 
-    pFilename = bacfile_name(instance);
-    if (pFilename) {
+    if (bacfile_name(instance)) {
         found = true;
-        pFile = fopen(pFilename, "rb");
-        if (pFile) {
-            if (data->type.record.fileStartRecord > 0) {
-                for (i = 0; i < (uint32_t)data->type.record.fileStartRecord; i++) {
-                    pData = fgets(&dummy_data[0], sizeof(dummy_data), pFile);
-                    if ((pData == NULL) || feof(pFile)) {
-                        break;
-                    }
-                }
-            }
-            for (i = 0; i < data->type.record.RecordCount; i++) {
-                if (fwrite(octetstring_value(&data->fileData[i]),
-                        octetstring_length(&data->fileData[i]), 1,
-                        pFile) != 1) {
+        if (!bacfile_write_records(instance, data->type.record.fileStartRecord,
+                &data->fileData[0], data->type.record.RecordCount)) {
 #if PRINT_ENABLED
-                    fprintf(stderr, "Failed to write to %s (%lu)!\n",
-                        pFilename, (unsigned long) instance);
+            fprintf(stderr, "Failed to write to %s (%lu)!\n",
+                bacfile_name(instance), (unsigned long) instance);
 #endif
-                }
-            }
-            fclose(pFile);
         }
     }
 
@@ -635,4 +990,213 @@ bool bacfile_read_ack_record_data(
 void bacfile_init(
     void)
 {
+    unsigned i = 0;
+
+    /* let go of anything we had open so we see the files afresh */
+    for (i = 0; i < bacfile_count(); i++) {
+        bacfile_handle_close(&BACnet_File_Handle[i]);
+    }
+}
+
+#ifdef TEST
+#include <assert.h>
+#include "ctest.h"
+
+bool WPValidateArgType(
+    BACNET_APPLICATION_DATA_VALUE * pValue,
+    uint8_t ucExpectedTag,
+    BACNET_ERROR_CLASS * pErrorClass,
+    BACNET_ERROR_CODE * pErrorCode)
+{
+    bool bResult = true;
+
+    if (pValue->tag != ucExpectedTag) {
+        bResult = false;
+        *pErrorClass = ERROR_CLASS_PROPERTY;
+        *pErrorCode = ERROR_CODE_INVALID_DATA_TYPE;
+    }
+
+    return (bResult);
+}
+
+static bool testWriteRecord(
+    uint32_t instance,
+    int32_t start_record,
+    const char *record)
+{
+    BACNET_ATOMIC_WRITE_FILE_DATA data;
+
+    memset(&data, 0, sizeof(data));
+    data.object_type = OBJECT_FILE;
+    data.object_instance = instance;
+    data.access = FILE_RECORD_ACCESS;
+    data.type.record.fileStartRecord = start_record;
+    data.type.record.returnedRecordCount = 1;
+    octetstring_init(&data.fileData[0], (uint8_t *) record, strlen(record));
+
+    return bacfile_write_record_data(&data);
+}
+
+/* read one record as a string, or "" past the end */
+static bool testReadRecord(
+    uint32_t instance,
+    int32_t start_record,
+    char *record,
+    size_t record_size)
+{
+    BACNET_ATOMIC_READ_FILE_DATA data;
+    size_t len = 0;
+
+    memset(&data, 0, sizeof(data));
+    data.object_type = OBJECT_FILE;
+    data.object_instance = instance;
+    data.access = FILE_RECORD_ACCESS;
+    data.type.record.fileStartRecord = start_record;
+    data.type.record.RecordCount = 1;
+    octetstring_init(&data.fileData[0], NULL, 0);
+    record[0] = 0;
+    if (!bacfile_read_record_data(&data)) {
+        return false;
+    }
+    if (data.type.record.RecordCount) {
+        len = octetstring_length(&data.fileData[0]);
+        if (len >= record_size) {
+            len = record_size - 1;
+        }
+        memcpy(record, octetstring_value(&data.fileData[0]), len);
+        record[len] = 0;
+    }
+
+    return true;
+}
+
+static void testWriteFile(
+    const char *filename,
+    const char *contents)
+{
+    FILE *pFile = NULL;
+
+    pFile = fopen(filename, "wb");
+    assert(pFile);
+    fputs(contents, pFile);
+    fclose(pFile);
+}
+
+void testBACfileRecords(
+    Test * pTest)
+{
+    char record[32];
+
+    bacfile_init();
+    remove(bacfile_name(0));
+    ct_test(pTest, testWriteRecord(0, 0, "a\n"));
+    ct_test(pTest, testWriteRecord(0, -1, "bb\n"));
+    ct_test(pTest, testWriteRecord(0, -1, "ccc\n"));
+    ct_test(pTest, bacfile_file_size(0) == 9);
+    ct_test(pTest, testReadRecord(0, 1, record, sizeof(record)));
+    ct_test(pTest, strcmp(record, "bb\n") == 0);
+    /* appending extends the index */
+    ct_test(pTest, testWriteRecord(0, -1, "dddd\n"));
+    ct_test(pTest, BACnet_File_Handle[0].record_valid);
+    ct_test(pTest, BACnet_File_Handle[0].record_count == 4);
+    ct_test(pTest, testReadRecord(0, 3, record, sizeof(record)));
+    ct_test(pTest, strcmp(record, "dddd\n") == 0);
+    ct_test(pTest, testReadRecord(0, 4, record, sizeof(record)));
+    ct_test(pTest, record[0] == 0);
+    ct_test(pTest, !testReadRecord(0, 5, record, sizeof(record)));
+    /* overwriting from a record on rebuilds the index */
+    ct_test(pTest, testWriteRecord(0, 1, "X\n"));
+    ct_test(pTest, !BACnet_File_Handle[0].record_valid);
+    ct_test(pTest, testReadRecord(0, 1, record, sizeof(record)));
+    ct_test(pTest, strcmp(record, "X\n") == 0);
+    ct_test(pTest, testReadRecord(0, 2, record, sizeof(record)));
+    ct_test(pTest, strcmp(record, "\n") == 0);
+    ct_test(pTest, testReadRecord(0, 3, record, sizeof(record)));
+    ct_test(pTest, strcmp(record, "ccc\n") == 0);
+
+    /* changed by someone else: a different size */
+    testWriteFile(bacfile_name(0), "one\ntwo\n");
+    ct_test(pTest, bacfile_file_size(0) == 8);
+    ct_test(pTest, testReadRecord(0, 1, record, sizeof(record)));
+    ct_test(pTest, strcmp(record, "two\n") == 0);
+    ct_test(pTest, testReadRecord(0, 2, record, sizeof(record)));
+    ct_test(pTest, record[0] == 0);
+    /* the same size, with the records in different places */
+    testWriteFile(bacfile_name(0), "o\nnetwo\n");
+    ct_test(pTest, testReadRecord(0, 1, record, sizeof(record)));
+    ct_test(pTest, strcmp(record, "netwo\n") == 0);
+    /* replaced by another file */
+    testWriteFile("temp_new.txt", "first\nsecond\nthird\n");
+    ct_test(pTest, rename("temp_new.txt", bacfile_name(0)) == 0);
+    ct_test(pTest, testReadRecord(0, 2, record, sizeof(record)));
+    ct_test(pTest, strcmp(record, "third\n") == 0);
+    ct_test(pTest, testWriteRecord(0, -1, "fourth\n"));
+    ct_test(pTest, testReadRecord(0, 3, record, sizeof(record)));
+    ct_test(pTest, strcmp(record, "fourth\n") == 0);
+
+    bacfile_init();
+    remove(bacfile_name(0));
+}
+
+void testBACfileOpenMax(
+    Test * pTest)
+{
+    char record[32];
+    uint32_t instance = 0;
+    unsigned open_count = 0;
+
+    bacfile_init();
+    for (instance = 0; instance < bacfile_count(); instance++) {
+        remove(bacfile_name(instance));
+        ct_test(pTest, testWriteRecord(instance, 0, bacfile_name(instance)));
+    }
+    for (instance = 0; instance < bacfile_count(); instance++) {
+        if (BACnet_File_Handle[instance].pFile) {
+            open_count++;
+        }
+    }
+    ct_test(pTest, open_count == BACFILE_OPEN_MAX);
+    /* the least recently used file is the one closed */
+    ct_test(pTest, BACnet_File_Handle[0].pFile == NULL);
+    ct_test(pTest, testReadRecord(1, 0, record, sizeof(record)));
+    ct_test(pTest, testReadRecord(0, 0, record, sizeof(record)));
+    ct_test(pTest, strcmp(record, bacfile_name(0)) == 0);
+    ct_test(pTest, BACnet_File_Handle[0].pFile != NULL);
+    ct_test(pTest, BACnet_File_Handle[1].pFile != NULL);
+    ct_test(pTest, BACnet_File_Handle[2].pFile == NULL);
+    /* and is opened again, as it was, when next used */
+    ct_test(pTest, testReadRecord(2, 0, record, sizeof(record)));
+    ct_test(pTest, strcmp(record, bacfile_name(2)) == 0);
+    ct_test(pTest, BACnet_File_Handle[1].pFile == NULL);
+    ct_test(pTest, testReadRecord(1, 0, record, sizeof(record)));
+    ct_test(pTest, strcmp(record, bacfile_name(1)) == 0);
+
+    bacfile_init();
+    for (instance = 0; instance < bacfile_count(); instance++) {
+        remove(bacfile_name(instance));
+    }
+}
+
+#ifdef TEST_BACFILE
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet File", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testBACfileRecords);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testBACfileOpenMax);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
 }
+#endif /* TEST_BACFILE */
+#endif /* TEST */
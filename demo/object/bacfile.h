@@ -102,6 +102,14 @@ extern "C" {
     bool bacfile_write_property(
         BACNET_WRITE_PROPERTY_DATA * wp_data);
 
+#ifdef TEST
+#include "ctest.h"
+    void testBACfileRecords(
+        Test * pTest);
+    void testBACfileOpenMax(
+        Test * pTest);
+#endif
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -38,11 +38,35 @@
 #include "config.h"     /* the custom stuff */
 #include "bi.h"
 #include "handlers.h"
+#if defined(BAC_ROUTING)
+#include "device.h"
+#endif
 
 #ifndef MAX_BINARY_INPUTS
 #define MAX_BINARY_INPUTS 5
 #endif
 
+#if defined(BAC_ROUTING)
+/* each routed Device has Binary Inputs of its own; these are the gateway's */
+static BACNET_BINARY_PV Present_Value_Gateway[MAX_BINARY_INPUTS];
+static bool Out_Of_Service_Gateway[MAX_BINARY_INPUTS];
+static bool Change_Of_Value_Gateway[MAX_BINARY_INPUTS];
+static BACNET_POLARITY Polarity_Gateway[MAX_BINARY_INPUTS];
+static bool Binary_Input_Initialized_Gateway = false;
+#define Present_Value ((BACNET_BINARY_PV *) Routed_Device_Object_Data( \
+    Present_Value_Gateway, sizeof(Present_Value_Gateway), \
+    Binary_Input_Init))
+#define Out_Of_Service ((bool *) Routed_Device_Object_Data( \
+    Out_Of_Service_Gateway, sizeof(Out_Of_Service_Gateway), \
+    Binary_Input_Init))
+#define Change_Of_Value ((bool *) Routed_Device_Object_Data( \
+    Change_Of_Value_Gateway, sizeof(Change_Of_Value_Gateway), \
+    Binary_Input_Init))
+#define Polarity ((BACNET_POLARITY *) Routed_Device_Object_Data( \
+    Polarity_Gateway, sizeof(Polarity_Gateway), Binary_Input_Init))
+#define Binary_Input_Initialized (*(bool *) Routed_Device_Object_Data( \
+    &Binary_Input_Initialized_Gateway, sizeof(bool), Binary_Input_Init))
+#else
 /* stores the current value */
 static BACNET_BINARY_PV Present_Value[MAX_BINARY_INPUTS];
 /* out of service decouples physical input from Present_Value */
@@ -51,6 +75,9 @@ static bool Out_Of_Service[MAX_BINARY_INPUTS];
 static bool Change_Of_Value[MAX_BINARY_INPUTS];
 /* Polarity of Input */
 static BACNET_POLARITY Polarity[MAX_BINARY_INPUTS];
+/* we need to have our arrays initialized before answering any calls */
+static bool Binary_Input_Initialized = false;
+#endif
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Binary_Input_Properties_Required[] = {
@@ -125,11 +152,10 @@ uint32_t Binary_Input_Index_To_Instance(
 void Binary_Input_Init(
     void)
 {
-    static bool initialized = false;
     unsigned i;
 
-    if (!initialized) {
-        initialized = true;
+    if (!Binary_Input_Initialized) {
+        Binary_Input_Initialized = true;
 
         /* initialize all the values */
         for (i = 0; i < MAX_BINARY_INPUTS; i++) {
@@ -317,7 +343,7 @@ bool Binary_Input_Object_Name(
     uint32_t object_instance,
     BACNET_CHARACTER_STRING * object_name)
 {
-    static char text_string[32] = "";   /* okay for single thread */
+    static BACNET_THREAD_LOCAL char text_string[32] = "";
     bool status = false;
     unsigned index = 0;
 
@@ -37,6 +37,9 @@
 #include "wp.h"
 #include "bo.h"
 #include "handlers.h"
+#if defined(BAC_ROUTING)
+#include "device.h"
+#endif
 
 #ifndef MAX_BINARY_OUTPUTS
 #define MAX_BINARY_OUTPUTS 4
@@ -46,11 +49,29 @@
 /* the Relinquish Default value */
 #define RELINQUISH_DEFAULT BINARY_INACTIVE
 /* Here is our Priority Array.*/
+#if defined(BAC_ROUTING)
+/* each routed Device has Binary Outputs of its own; these are the gateway's */
+static BACNET_BINARY_PV
+    Binary_Output_Level_Gateway[MAX_BINARY_OUTPUTS][BACNET_MAX_PRIORITY];
+static bool Out_Of_Service_Gateway[MAX_BINARY_OUTPUTS];
+static bool Binary_Output_Initialized_Gateway = false;
+#define Binary_Output_Level ((BACNET_BINARY_PV (*)[BACNET_MAX_PRIORITY]) \
+    Routed_Device_Object_Data(Binary_Output_Level_Gateway, \
+    sizeof(Binary_Output_Level_Gateway), Binary_Output_Init))
+#define Out_Of_Service ((bool *) Routed_Device_Object_Data( \
+    Out_Of_Service_Gateway, sizeof(Out_Of_Service_Gateway), \
+    Binary_Output_Init))
+#define Binary_Output_Initialized (*(bool *) Routed_Device_Object_Data( \
+    &Binary_Output_Initialized_Gateway, sizeof(bool), Binary_Output_Init))
+#else
 static BACNET_BINARY_PV
     Binary_Output_Level[MAX_BINARY_OUTPUTS][BACNET_MAX_PRIORITY];
 /* Writable out-of-service allows others to play with our Present Value */
 /* without changing the physical output */
 static bool Out_Of_Service[MAX_BINARY_OUTPUTS];
+/* we need to have our arrays initialized before answering any calls */
+static bool Binary_Output_Initialized = false;
+#endif
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Binary_Output_Properties_Required[] = {
@@ -97,10 +118,9 @@ void Binary_Output_Init(
     void)
 {
     unsigned i, j;
-    static bool initialized = false;
 
-    if (!initialized) {
-        initialized = true;
+    if (!Binary_Output_Initialized) {
+        Binary_Output_Initialized = true;
 
         /* initialize all the analog output priority arrays to NULL */
         for (i = 0; i < MAX_BINARY_OUTPUTS; i++) {
@@ -195,7 +215,7 @@ bool Binary_Output_Object_Name(
     uint32_t object_instance,
     BACNET_CHARACTER_STRING * object_name)
 {
-    static char text_string[32] = "";   /* okay for single thread */
+    static BACNET_THREAD_LOCAL char text_string[32] = "";
     bool status = false;
 
     if (object_instance < MAX_BINARY_OUTPUTS) {
@@ -37,6 +37,9 @@
 #include "rp.h"
 #include "bv.h"
 #include "handlers.h"
+#if defined(BAC_ROUTING)
+#include "device.h"
+#endif
 
 #ifndef MAX_BINARY_VALUES
 #define MAX_BINARY_VALUES 10
@@ -46,11 +49,29 @@
 /* the Relinquish Default value */
 #define RELINQUISH_DEFAULT BINARY_INACTIVE
 /* Here is our Priority Array.*/
+#if defined(BAC_ROUTING)
+/* each routed Device has Binary Values of its own; these are the gateway's */
+static BACNET_BINARY_PV
+    Binary_Value_Level_Gateway[MAX_BINARY_VALUES][BACNET_MAX_PRIORITY];
+static bool Out_Of_Service_Gateway[MAX_BINARY_VALUES];
+static bool Binary_Value_Initialized_Gateway = false;
+#define Binary_Value_Level ((BACNET_BINARY_PV (*)[BACNET_MAX_PRIORITY]) \
+    Routed_Device_Object_Data(Binary_Value_Level_Gateway, \
+    sizeof(Binary_Value_Level_Gateway), Binary_Value_Init))
+#define Out_Of_Service ((bool *) Routed_Device_Object_Data( \
+    Out_Of_Service_Gateway, sizeof(Out_Of_Service_Gateway), \
+    Binary_Value_Init))
+#define Binary_Value_Initialized (*(bool *) Routed_Device_Object_Data( \
+    &Binary_Value_Initialized_Gateway, sizeof(bool), Binary_Value_Init))
+#else
 static BACNET_BINARY_PV
     Binary_Value_Level[MAX_BINARY_VALUES][BACNET_MAX_PRIORITY];
 /* Writable out-of-service allows others to play with our Present Value */
 /* without changing the physical output */
 static bool Out_Of_Service[MAX_BINARY_VALUES];
+/* we need to have our arrays initialized before answering any calls */
+static bool Binary_Value_Initialized = false;
+#endif
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Binary_Value_Properties_Required[] = {
@@ -94,10 +115,9 @@ void Binary_Value_Init(
     void)
 {
     unsigned i, j;
-    static bool initialized = false;
 
-    if (!initialized) {
-        initialized = true;
+    if (!Binary_Value_Initialized) {
+        Binary_Value_Initialized = true;
 
         /* initialize all the analog output priority arrays to NULL */
         for (i = 0; i < MAX_BINARY_VALUES; i++) {
@@ -178,7 +198,7 @@ bool Binary_Value_Object_Name(
     uint32_t object_instance,
     BACNET_CHARACTER_STRING * object_name)
 {
-    static char text_string[32] = "";   /* okay for single thread */
+    static BACNET_THREAD_LOCAL char text_string[32] = "";
     bool status = false;
 
     if (object_instance < MAX_BINARY_VALUES) {
@@ -28,6 +28,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>     /* for memmove */
 #include <time.h>       /* for timezone, localtime */
 #include "bacdef.h"
@@ -79,6 +80,9 @@
 #if defined(BAC_UCI)
 #include "ucix.h"
 #endif /* defined(BAC_UCI) */
+#if defined(BACNET_WORKER_POOL)
+#include <pthread.h>
+#endif
 
 
 #if defined(__BORLANDC__) || defined(_WIN32)
@@ -486,6 +490,38 @@ static object_functions_t My_Object_Table[] = {
         NULL /* Intrinsic Reporting */ }
 };
 
+#ifdef BAC_ROUTING
+/* The object types that keep objects of their own for each routed Device,
+   see Routed_Device_Object_Data(); the routed Devices have these only. */
+static const BACNET_OBJECT_TYPE Routed_Object_Types[] = {
+    OBJECT_DEVICE,
+    OBJECT_ANALOG_INPUT,
+    OBJECT_ANALOG_OUTPUT,
+    OBJECT_ANALOG_VALUE,
+    OBJECT_BINARY_INPUT,
+    OBJECT_BINARY_OUTPUT,
+    OBJECT_BINARY_VALUE
+};
+static object_functions_t Routed_Object_Table[sizeof(Routed_Object_Types) /
+    sizeof(Routed_Object_Types[0]) + 1];
+#endif
+
+/** The objects of the Device that the current request is for.
+ * @return The Object_Table, or that of the current routed Device.
+ */
+static struct object_functions *Device_Object_Table(
+    void)
+{
+#ifdef BAC_ROUTING
+    struct object_functions *pTable = Routed_Device_Object_Table();
+
+    if (pTable) {
+        return pTable;
+    }
+#endif
+    return Object_Table;
+}
+
 /** Glue function to let the Device object, when called by a handler,
  * lookup which Object type needs to be invoked.
  * @ingroup ObjHelpers
@@ -498,7 +534,7 @@ static struct object_functions *Device_Objects_Find_Functions(
 {
     struct object_functions *pObject = NULL;
 
-    pObject = Object_Table;
+    pObject = Device_Object_Table();
     while (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) {
         /* handle each object type */
         if (pObject->Object_Type == Object_Type) {
@@ -510,6 +546,172 @@ static struct object_functions *Device_Objects_Find_Functions(
     return (NULL);
 }
 
+#if defined(BACNET_WORKER_POOL)
+/* Requests can be handled by several worker threads at once, so each
+   object type has a read/write lock around calls to its functions.
+   Reading the Device object updates the local time, so it is always
+   locked for writing.  An object function may call back into the
+   Device object for another object, such as a Channel writing to its
+   members, so each thread keeps the locks it holds with their mode:
+   - a lock that is held already is not taken again, unless a read
+     lock would have to become a write lock, which is refused;
+   - locks are waited for in the order of the object table only; a lock
+     earlier in the table than one that is held is only tried, and
+     refused if it is busy, so two threads never wait for each other. */
+#ifndef DEVICE_OBJECT_LOCKS
+#define DEVICE_OBJECT_LOCKS 64
+#endif
+/* most locks that one thread holds at once */
+#ifndef DEVICE_OBJECT_LOCK_DEPTH
+#define DEVICE_OBJECT_LOCK_DEPTH 8
+#endif
+typedef struct object_lock_held {
+    unsigned index;
+    bool write;
+    unsigned depth;
+} OBJECT_LOCK_HELD;
+static pthread_rwlock_t Object_Lock[DEVICE_OBJECT_LOCKS];
+static pthread_once_t Object_Lock_Once = PTHREAD_ONCE_INIT;
+static BACNET_THREAD_LOCAL OBJECT_LOCK_HELD
+    Object_Lock_Held[DEVICE_OBJECT_LOCK_DEPTH];
+static BACNET_THREAD_LOCAL unsigned Object_Lock_Held_Count;
+
+static void Device_Object_Lock_Init(
+    void)
+{
+    unsigned i = 0;
+
+    for (i = 0; i < DEVICE_OBJECT_LOCKS; i++) {
+        pthread_rwlock_init(&Object_Lock[i], NULL);
+    }
+}
+
+/** Lock the objects of a type for this thread.
+ * @param pObject [in] functions of the object type in the object table
+ * @param write [in] true to change the objects, false to read them
+ * @return true if the objects are locked and Device_Object_Unlock() has
+ *  to be called, false if the lock was refused.
+ */
+static bool Device_Object_Lock(
+    struct object_functions *pObject,
+    bool write)
+{
+    OBJECT_LOCK_HELD *held = NULL;
+    pthread_rwlock_t *lock = NULL;
+    unsigned index = 0;
+    bool after_held = true;
+    unsigned i = 0;
+    int rc = 0;
+
+    pthread_once(&Object_Lock_Once, Device_Object_Lock_Init);
+    index =
+        (unsigned) (pObject - Device_Object_Table()) % DEVICE_OBJECT_LOCKS;
+    if (pObject->Object_Type == OBJECT_DEVICE) {
+        write = true;
+    }
+    for (i = 0; i < Object_Lock_Held_Count; i++) {
+        held = &Object_Lock_Held[i];
+        if (held->index == index) {
+            if (write && !held->write) {
+                /* the lock might be shared with another reader */
+                return false;
+            }
+            held->depth++;
+            return true;
+        }
+        if (held->index > index) {
+            after_held = false;
+        }
+    }
+    if (Object_Lock_Held_Count >= DEVICE_OBJECT_LOCK_DEPTH) {
+        return false;
+    }
+    lock = &Object_Lock[index];
+    if (after_held) {
+        rc = write ? pthread_rwlock_wrlock(lock) :
+            pthread_rwlock_rdlock(lock);
+    } else {
+        rc = write ? pthread_rwlock_trywrlock(lock) :
+            pthread_rwlock_tryrdlock(lock);
+    }
+    if (rc != 0) {
+        return false;
+    }
+    held = &Object_Lock_Held[Object_Lock_Held_Count++];
+    held->index = index;
+    held->write = write;
+    held->depth = 1;
+
+    return true;
+}
+
+static void Device_Object_Unlock(
+    struct object_functions *pObject)
+{
+    unsigned index = 0;
+    unsigned i = 0;
+
+    index =
+        (unsigned) (pObject - Device_Object_Table()) % DEVICE_OBJECT_LOCKS;
+    for (i = Object_Lock_Held_Count; i > 0; i--) {
+        if (Object_Lock_Held[i - 1].index == index) {
+            if (--Object_Lock_Held[i - 1].depth == 0) {
+                pthread_rwlock_unlock(&Object_Lock[index]);
+                Object_Lock_Held_Count--;
+                Object_Lock_Held[i - 1] =
+                    Object_Lock_Held[Object_Lock_Held_Count];
+            }
+            break;
+        }
+    }
+}
+
+#define DEVICE_OBJECT_READ_LOCK(p) Device_Object_Lock((p), false)
+#define DEVICE_OBJECT_WRITE_LOCK(p) Device_Object_Lock((p), true)
+#define DEVICE_OBJECT_UNLOCK(p) Device_Object_Unlock(p)
+#else
+#define DEVICE_OBJECT_READ_LOCK(p) (true)
+#define DEVICE_OBJECT_WRITE_LOCK(p) (true)
+#define DEVICE_OBJECT_UNLOCK(p)
+#endif
+
+/** Lock the objects of a type around code outside of the object
+ * functions that uses them, such as their timers, while worker threads
+ * may read objects.  Does nothing unless BACNET_WORKER_POOL is defined.
+ * @param object_type [in] type of the objects
+ * @param write [in] true if the code changes the objects
+ * @return true if the objects may be used, and Device_Objects_Unlock()
+ *  has to be called after; false if the lock was refused.
+ */
+bool Device_Objects_Lock(
+    BACNET_OBJECT_TYPE object_type,
+    bool write)
+{
+    struct object_functions *pObject = NULL;
+
+    pObject = Device_Objects_Find_Functions(object_type);
+    if (pObject == NULL) {
+        /* there are none to lock */
+        return true;
+    }
+    if (write) {
+        return DEVICE_OBJECT_WRITE_LOCK(pObject);
+    }
+
+    return DEVICE_OBJECT_READ_LOCK(pObject);
+}
+
+void Device_Objects_Unlock(
+    BACNET_OBJECT_TYPE object_type)
+{
+    struct object_functions *pObject = NULL;
+
+    pObject = Device_Objects_Find_Functions(object_type);
+    if (pObject != NULL) {
+        DEVICE_OBJECT_UNLOCK(pObject);
+    }
+}
+
 /** Try to find a rr_info_function helper function for the requested object type.
  * @ingroup ObjIntf
  *
@@ -1080,7 +1282,7 @@ unsigned Device_Object_List_Count(
     struct object_functions *pObject = NULL;
 
     /* initialize the default return values */
-    pObject = Object_Table;
+    pObject = Device_Object_Table();
     while (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) {
         if (pObject->Object_Count) {
             count += pObject->Object_Count();
@@ -1118,7 +1320,7 @@ bool Device_Object_List_Identifier(
     }
     object_index = array_index - 1;
     /* initialize the default return values */
-    pObject = Object_Table;
+    pObject = Device_Object_Table();
     while (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) {
         if (pObject->Object_Count) {
             object_index -= count;
@@ -1516,7 +1718,7 @@ int Device_Read_Property_Local(
             }
             /* set the object types with objects to supported */
 
-            pObject = Object_Table;
+            pObject = Device_Object_Table();
             while (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) {
                 if ((pObject->Object_Count) && (pObject->Object_Count() > 0)) {
                     bitstring_set_bit(&bit_string, pObject->Object_Type, true);
@@ -1673,6 +1875,10 @@ int Device_Read_Property(
     rpdata->error_code = ERROR_CODE_UNKNOWN_OBJECT;
     pObject = Device_Objects_Find_Functions(rpdata->object_type);
     if (pObject != NULL) {
+        if (!DEVICE_OBJECT_READ_LOCK(pObject)) {
+            rpdata->error_code = ERROR_CODE_BUSY;
+            return BACNET_STATUS_ERROR;
+        }
         if (pObject->Object_Valid_Instance &&
             pObject->Object_Valid_Instance(rpdata->object_instance)) {
             if (pObject->Object_Read_Property) {
@@ -1694,6 +1900,7 @@ int Device_Read_Property(
                 }
             }
         }
+        DEVICE_OBJECT_UNLOCK(pObject);
     }
 
     return apdu_len;
@@ -2000,6 +2207,10 @@ bool Device_Write_Property(
     wp_data->error_code = ERROR_CODE_UNKNOWN_OBJECT;
     pObject = Device_Objects_Find_Functions(wp_data->object_type);
     if (pObject != NULL) {
+        if (!DEVICE_OBJECT_WRITE_LOCK(pObject)) {
+            wp_data->error_code = ERROR_CODE_BUSY;
+            return false;
+        }
         if (pObject->Object_Valid_Instance &&
             pObject->Object_Valid_Instance(wp_data->object_instance)) {
             if (pObject->Object_Write_Property) {
@@ -2020,6 +2231,7 @@ bool Device_Write_Property(
             wp_data->error_class = ERROR_CLASS_OBJECT;
             wp_data->error_code = ERROR_CODE_UNKNOWN_OBJECT;
         }
+        DEVICE_OBJECT_UNLOCK(pObject);
     } else {
         wp_data->error_class = ERROR_CLASS_OBJECT;
         wp_data->error_code = ERROR_CODE_UNKNOWN_OBJECT;
@@ -2046,6 +2258,9 @@ bool Device_Encode_Value_List(
 
     pObject = Device_Objects_Find_Functions(object_type);
     if (pObject != NULL) {
+        if (!DEVICE_OBJECT_READ_LOCK(pObject)) {
+            return false;
+        }
         if (pObject->Object_Valid_Instance &&
             pObject->Object_Valid_Instance(object_instance)) {
             if (pObject->Object_Value_List) {
@@ -2053,6 +2268,7 @@ bool Device_Encode_Value_List(
                     pObject->Object_Value_List(object_instance, value_list);
             }
         }
+        DEVICE_OBJECT_UNLOCK(pObject);
     }
 
     return (status);
@@ -2073,12 +2289,16 @@ bool Device_COV(
 
     pObject = Device_Objects_Find_Functions(object_type);
     if (pObject != NULL) {
+        if (!DEVICE_OBJECT_READ_LOCK(pObject)) {
+            return false;
+        }
         if (pObject->Object_Valid_Instance &&
             pObject->Object_Valid_Instance(object_instance)) {
             if (pObject->Object_COV) {
                 status = pObject->Object_COV(object_instance);
             }
         }
+        DEVICE_OBJECT_UNLOCK(pObject);
     }
 
     return (status);
@@ -2097,39 +2317,226 @@ void Device_COV_Clear(
 
     pObject = Device_Objects_Find_Functions(object_type);
     if (pObject != NULL) {
+        if (!DEVICE_OBJECT_WRITE_LOCK(pObject)) {
+            return;
+        }
         if (pObject->Object_Valid_Instance &&
             pObject->Object_Valid_Instance(object_instance)) {
             if (pObject->Object_COV_Clear) {
                 pObject->Object_COV_Clear(object_instance);
             }
         }
+        DEVICE_OBJECT_UNLOCK(pObject);
     }
 }
 
 #if defined(INTRINSIC_REPORTING)
-void Device_local_reporting(
+/* Objects waiting for their intrinsic reporting to be evaluated.
+   Objects with event reporting enabled schedule themselves when
+   something that affects their event state changes, and for when a
+   Time_Delay that is counting down runs out, so idle objects cost
+   nothing.  An object is on the list once at most, and the list grows
+   from MAX_REPORTING_EVENTS entries as needed. */
+#ifndef MAX_REPORTING_EVENTS
+#define MAX_REPORTING_EVENTS 64
+#endif
+typedef struct reporting_event {
+    BACNET_OBJECT_TYPE object_type;
+    uint32_t object_instance;
+    uint32_t due;
+} REPORTING_EVENT;
+static REPORTING_EVENT *Reporting_Events;
+static unsigned Reporting_Event_Size;
+static unsigned Reporting_Event_Count;
+/* the due events, taken off the list by Device_local_reporting() */
+static REPORTING_EVENT *Reporting_Due;
+static unsigned Reporting_Due_Size;
+static uint32_t Reporting_Seconds;
+static uint32_t Reporting_Next_Due;
+/* evaluate every object: at startup, and if the list could not grow */
+static bool Reporting_Sweep = true;
+#if defined(BACNET_WORKER_POOL)
+/* objects of different types are scheduled from several workers */
+static pthread_mutex_t Reporting_Mutex = PTHREAD_MUTEX_INITIALIZER;
+#define REPORTING_LOCK() pthread_mutex_lock(&Reporting_Mutex)
+#define REPORTING_UNLOCK() pthread_mutex_unlock(&Reporting_Mutex)
+#else
+#define REPORTING_LOCK()
+#define REPORTING_UNLOCK()
+#endif
+
+/* make room for at least one more event on a list */
+static bool Device_Reporting_Grow(
+    REPORTING_EVENT ** events,
+    unsigned *size)
+{
+    REPORTING_EVENT *list = NULL;
+    unsigned new_size = 0;
+
+    new_size = (*size == 0) ? MAX_REPORTING_EVENTS : (*size * 2);
+    list = realloc(*events, new_size * sizeof(REPORTING_EVENT));
+    if (!list) {
+        return false;
+    }
+    *events = list;
+    *size = new_size;
+
+    return true;
+}
+
+static void Device_Reporting_Evaluate(
+    struct object_functions *pObject,
+    uint32_t object_instance)
+{
+    /* the evaluation changes the object, which a worker may be reading */
+    if (!DEVICE_OBJECT_WRITE_LOCK(pObject)) {
+        return;
+    }
+    if (pObject->Object_Valid_Instance &&
+        pObject->Object_Valid_Instance(object_instance)) {
+        if (pObject->Object_Intrinsic_Reporting) {
+            pObject->Object_Intrinsic_Reporting(object_instance);
+        }
+    }
+    DEVICE_OBJECT_UNLOCK(pObject);
+}
+
+/** Schedule the intrinsic reporting of an object to be evaluated.
+ * Objects call this when their value, limits, or acknowledgment state
+ * changes, and for when their Time_Delay runs out, if their event
+ * reporting is enabled.
+ * @param [in] The object type.
+ * @param [in] The object instance.
+ * @param [in] Seconds from now; 0 evaluates on the next task call.
+ */
+void Device_Reporting_Schedule(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    uint32_t seconds)
+{
+    uint32_t due = 0;
+    unsigned i = 0;
+
+    REPORTING_LOCK();
+    due = Reporting_Seconds + seconds;
+    for (i = 0; i < Reporting_Event_Count; i++) {
+        if ((Reporting_Events[i].object_type == object_type) &&
+            (Reporting_Events[i].object_instance == object_instance)) {
+            if (due < Reporting_Events[i].due) {
+                Reporting_Events[i].due = due;
+            }
+            break;
+        }
+    }
+    if (i == Reporting_Event_Count) {
+        if ((Reporting_Event_Count < Reporting_Event_Size) ||
+            Device_Reporting_Grow(&Reporting_Events,
+                &Reporting_Event_Size)) {
+            Reporting_Events[i].object_type = object_type;
+            Reporting_Events[i].object_instance = object_instance;
+            Reporting_Events[i].due = due;
+            Reporting_Event_Count++;
+        } else {
+            /* out of memory: the next pass evaluates every object */
+            Reporting_Sweep = true;
+        }
+    }
+    if ((Reporting_Event_Count == 1) || (due < Reporting_Next_Due)) {
+        Reporting_Next_Due = due;
+    }
+    REPORTING_UNLOCK();
+}
+
+/** Advance the clock of the reporting schedule.
+ * @param [in] The number of seconds elapsed since the last call.
+ */
+void Device_Reporting_Timer(
+    uint16_t elapsed_seconds)
+{
+    REPORTING_LOCK();
+    Reporting_Seconds += elapsed_seconds;
+    REPORTING_UNLOCK();
+}
+
+/** The clock of the reporting schedule, used to count down Time_Delay.
+ * @return seconds since the device started.
+ */
+uint32_t Device_Reporting_Seconds(
     void)
 {
-    struct object_functions *pObject;
-    uint32_t objects_count;
-    uint32_t object_instance;
-    int object_type;
-    uint32_t idx;
+    uint32_t seconds = 0;
 
-    objects_count = Device_Object_List_Count();
+    REPORTING_LOCK();
+    seconds = Reporting_Seconds;
+    REPORTING_UNLOCK();
 
-    /* loop for all objects */
-    for (idx = 1; idx <= objects_count; idx++) {
-        Device_Object_List_Identifier(idx, &object_type, &object_instance);
+    return seconds;
+}
 
-        pObject = Device_Objects_Find_Functions(object_type);
-        if (pObject != NULL) {
-            if (pObject->Object_Valid_Instance &&
-                pObject->Object_Valid_Instance(object_instance)) {
-                if (pObject->Object_Intrinsic_Reporting) {
-                    pObject->Object_Intrinsic_Reporting(object_instance);
+/** Evaluate the intrinsic reporting of the objects that are due.
+ * Cheap when nothing is due, so call it from the main loop.
+ */
+void Device_local_reporting(
+    void)
+{
+    struct object_functions *pObject;
+    unsigned due_count = 0;
+    unsigned i = 0;
+    uint32_t count = 0;
+    uint32_t index = 0;
+    bool pending = false;
+    bool sweep = false;
+
+    REPORTING_LOCK();
+    sweep = Reporting_Sweep;
+    Reporting_Sweep = false;
+    REPORTING_UNLOCK();
+    if (sweep) {
+        pObject = Object_Table;
+        while (pObject && (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE)) {
+            if (pObject->Object_Intrinsic_Reporting &&
+                pObject->Object_Count && pObject->Object_Index_To_Instance) {
+                count = pObject->Object_Count();
+                for (index = 0; index < count; index++) {
+                    Device_Reporting_Evaluate(pObject,
+                        pObject->Object_Index_To_Instance(index));
                 }
             }
+            pObject++;
+        }
+    }
+    REPORTING_LOCK();
+    if ((Reporting_Event_Count == 0) ||
+        (Reporting_Next_Due > Reporting_Seconds)) {
+        REPORTING_UNLOCK();
+        return;
+    }
+    /* take the due events off the list first,
+       since the objects may schedule themselves again */
+    i = 0;
+    while (i < Reporting_Event_Count) {
+        if ((Reporting_Events[i].due <= Reporting_Seconds) &&
+            ((due_count < Reporting_Due_Size) ||
+                Device_Reporting_Grow(&Reporting_Due,
+                    &Reporting_Due_Size))) {
+            Reporting_Due[due_count++] = Reporting_Events[i];
+            Reporting_Event_Count--;
+            Reporting_Events[i] = Reporting_Events[Reporting_Event_Count];
+        } else {
+            /* not due yet, or left for the next pass */
+            if (!pending || (Reporting_Events[i].due < Reporting_Next_Due)) {
+                Reporting_Next_Due = Reporting_Events[i].due;
+            }
+            pending = true;
+            i++;
+        }
+    }
+    REPORTING_UNLOCK();
+    for (i = 0; i < due_count; i++) {
+        pObject = Device_Objects_Find_Functions(Reporting_Due[i].object_type);
+        if (pObject != NULL) {
+            Device_Reporting_Evaluate(pObject,
+                Reporting_Due[i].object_instance);
         }
     }
 }
@@ -2198,6 +2605,10 @@ void Device_Init(
         }
         pObject++;
     }
+#if defined(INTRINSIC_REPORTING)
+    Reporting_Event_Count = 0;
+    Reporting_Sweep = true;
+#endif
 }
 
 bool DeviceGetRRInfo(
@@ -2260,6 +2671,9 @@ void Routing_Device_Init(
     uint32_t first_object_instance)
 {
     struct object_functions *pDevObject = NULL;
+    struct object_functions *pObject = NULL;
+    unsigned count = 0;
+    unsigned i = 0;
 
     /* Initialize with our preset strings */
     Add_Routed_Device(first_object_instance, &My_Object_Name, Description);
@@ -2272,6 +2686,22 @@ void Routing_Device_Init(
     pDevObject->Object_Name = Routed_Device_Name;
     pDevObject->Object_Read_Property = Routed_Device_Read_Property_Local;
     pDevObject->Object_Write_Property = Routed_Device_Write_Property_Local;
+
+    /* The routed Devices added from now on have their own objects of the
+       types that keep objects for each Device, and no others. */
+    pObject = Object_Table;
+    while (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) {
+        for (i = 0; i < sizeof(Routed_Object_Types) /
+            sizeof(Routed_Object_Types[0]); i++) {
+            if (pObject->Object_Type == Routed_Object_Types[i]) {
+                Routed_Object_Table[count++] = *pObject;
+                break;
+            }
+        }
+        pObject++;
+    }
+    Routed_Object_Table[count].Object_Type = MAX_BACNET_OBJECT_TYPE;
+    Routed_Device_Set_Object_Table(&Routed_Object_Table[0]);
 }
 
 #endif /* BAC_ROUTING */
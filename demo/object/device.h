@@ -214,6 +214,12 @@ typedef struct devObj_s {
 
     /** The upcounter that shows if the Device ID or object structure has changed. */
     uint32_t Database_Revision;
+
+    /** The objects of this Device; NULL for the gateway Device's Object_Table. */
+    object_functions_t *Object_Table;
+
+    /** The data of this Device's own objects, see Routed_Device_Object_Data(). */
+    struct routed_object_data *Object_Data;
 } DEVICE_OBJECT_DATA;
 
 
@@ -268,6 +274,11 @@ extern "C" {
     void Device_COV_Clear(
         BACNET_OBJECT_TYPE object_type,
         uint32_t object_instance);
+    bool Device_Objects_Lock(
+        BACNET_OBJECT_TYPE object_type,
+        bool write);
+    void Device_Objects_Unlock(
+        BACNET_OBJECT_TYPE object_type);
 
     uint32_t Device_Object_Instance_Number(
         void);
@@ -381,6 +392,14 @@ extern "C" {
 #if defined(INTRINSIC_REPORTING)
     void Device_local_reporting(
         void);
+    void Device_Reporting_Schedule(
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t object_instance,
+        uint32_t seconds);
+    void Device_Reporting_Timer(
+        uint16_t elapsed_seconds);
+    uint32_t Device_Reporting_Seconds(
+        void);
 #endif
 
 /* Prototypes for Routing functionality in the Device Object.
@@ -398,6 +417,8 @@ extern "C" {
         int idx);
     BACNET_ADDRESS *Get_Routed_Device_Address(
         int idx);
+    bool Routed_Device_Set_Address(
+        BACNET_ADDRESS * address);
 
     void routed_get_my_address(
         BACNET_ADDRESS * my_address);
@@ -406,6 +427,10 @@ extern "C" {
         int idx,
         uint8_t address_len,
         uint8_t * mac_adress);
+    bool Routed_Device_Instance_Lookup(
+        uint32_t object_instance);
+    bool Routed_Device_Is_Gateway_Instance(
+        uint32_t object_instance);
     bool Routed_Device_GetNext(
         BACNET_ADDRESS * dest,
         int *DNET_list,
@@ -434,6 +459,14 @@ extern "C" {
         size_t length);
     void Routed_Device_Inc_Database_Revision(
         void);
+    object_functions_t *Routed_Device_Object_Table(
+        void);
+    void Routed_Device_Set_Object_Table(
+        object_functions_t * object_table);
+    void *Routed_Device_Object_Data(
+        void *gateway_data,
+        size_t size,
+        object_init_function object_init);
     int Routed_Device_Service_Approval(
         BACNET_CONFIRMED_SERVICE service,
         int service_argument,
@@ -27,10 +27,12 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>     /* for calloc */
 #include <string.h>     /* for memmove */
 #include <time.h>       /* for timezone, localtime */
 #include "bacdef.h"
 #include "bacdcode.h"
+#include "bacint.h"
 #include "bacenum.h"
 #include "bacapp.h"
 #include "config.h"     /* the custom stuff */
@@ -93,10 +95,16 @@ bool Routed_Device_Write_Property_Local(
  * and extending the regular Device Object functionality.
  ****************************************************************************/
 
-/** Model the gateway as the main Device, with (two) remote
- * Devices that are reached via its routing capabilities.
+/** Model the gateway as the main Device, with remote Devices that are
+ * reached via its routing capabilities.
+ * The table starts with room for MAX_NUM_DEVICES and grows as Devices
+ * are added; a Device keeps its index for good, but a pointer into the
+ * table is only good until the next Device is added.
  */
-DEVICE_OBJECT_DATA Devices[MAX_NUM_DEVICES];
+static DEVICE_OBJECT_DATA Devices_Initial[MAX_NUM_DEVICES];
+static DEVICE_OBJECT_DATA *Devices = Devices_Initial;
+/** Number of entries that Devices[] has room for */
+static uint16_t Devices_Size = MAX_NUM_DEVICES;
 /** Keep track of the number of managed devices, including the gateway */
 uint16_t Num_Managed_Devices = 0;
 /** Which Device entry are we currently managing.
@@ -105,6 +113,210 @@ uint16_t Num_Managed_Devices = 0;
  * request is addressing.  Should default to 0, the main gateway Device.
  */
 uint16_t iCurrent_Device_Idx = 0;
+/** The objects of the Devices added from now on; NULL gives a Device the
+ * gateway Device's Object_Table.  Set with Routed_Device_Set_Object_Table().
+ */
+static object_functions_t *Routed_Object_Table = NULL;
+
+/* The data of the objects that a routed Device keeps for itself, such as
+ * its Analog Inputs, in a list for each Device.  An object module tells
+ * one kind of data from another by its own copy, which the gateway uses.
+ */
+struct routed_object_data {
+    void *gateway_data;
+    void *data;
+    struct routed_object_data *next;
+};
+
+/* Each Device is also kept in a hash of its MAC address and a hash of
+ * its instance number, so that a message for any one of thousands of
+ * routed Devices finds it without looking at the others.  The hash
+ * chains are linked through the Device index; -1 ends a chain.
+ */
+struct routed_device_link {
+    int mac_next;
+    int instance_next;
+    bool mac_indexed;
+    uint32_t mac_hash;
+};
+static struct routed_device_link Links_Initial[MAX_NUM_DEVICES];
+static struct routed_device_link *Device_Links = Links_Initial;
+static int *MAC_Hash = NULL;
+static int *Instance_Hash = NULL;
+/* number of buckets in each hash, a power of two */
+static unsigned Hash_Size = 0;
+
+static uint32_t routed_hash(
+    const uint8_t * data,
+    unsigned len)
+{
+    uint32_t hash = 2166136261UL;
+    unsigned i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 16777619UL;
+    }
+
+    return hash;
+}
+
+static uint32_t routed_instance_hash(
+    uint32_t instance)
+{
+    uint8_t key[4];
+
+    encode_unsigned32(key, instance);
+    return routed_hash(key, sizeof(key));
+}
+
+static void routed_mac_hash_add(
+    int idx)
+{
+    DEVICE_OBJECT_DATA *pDev = &Devices[idx];
+    struct routed_device_link *link = &Device_Links[idx];
+    unsigned bucket;
+
+    link->mac_hash =
+        routed_hash(pDev->bacDevAddr.mac, pDev->bacDevAddr.mac_len);
+    bucket = link->mac_hash & (Hash_Size - 1);
+    link->mac_next = MAC_Hash[bucket];
+    MAC_Hash[bucket] = idx;
+    link->mac_indexed = true;
+}
+
+static void routed_mac_hash_remove(
+    int idx)
+{
+    struct routed_device_link *link = &Device_Links[idx];
+    int *next;
+
+    if (!link->mac_indexed)
+        return;
+    next = &MAC_Hash[link->mac_hash & (Hash_Size - 1)];
+    while (*next != -1) {
+        if (*next == idx) {
+            *next = link->mac_next;
+            break;
+        }
+        next = &Device_Links[*next].mac_next;
+    }
+    link->mac_indexed = false;
+}
+
+static void routed_instance_hash_add(
+    int idx)
+{
+    unsigned bucket;
+
+    if (Hash_Size == 0)
+        return;
+    bucket =
+        routed_instance_hash(Devices[idx].bacObj.Object_Instance_Number) &
+        (Hash_Size - 1);
+    Device_Links[idx].instance_next = Instance_Hash[bucket];
+    Instance_Hash[bucket] = idx;
+}
+
+static void routed_instance_hash_remove(
+    int idx)
+{
+    int *next;
+
+    if (Hash_Size == 0)
+        return;
+    next =
+        &Instance_Hash[routed_instance_hash(Devices[idx].
+            bacObj.Object_Instance_Number) & (Hash_Size - 1)];
+    while (*next != -1) {
+        if (*next == idx) {
+            *next = Device_Links[idx].instance_next;
+            break;
+        }
+        next = &Device_Links[*next].instance_next;
+    }
+}
+
+/** Makes the hashes big enough for all the entries of Devices[],
+ * and puts every Device back into them.
+ * @return True if the hashes could be allocated.
+ */
+static bool routed_hash_resize(
+    void)
+{
+    unsigned size = 16;
+    int *mac_hash = NULL;
+    int *instance_hash = NULL;
+    unsigned i;
+
+    while (size < Devices_Size) {
+        size *= 2;
+    }
+    if (size == Hash_Size)
+        return true;
+    mac_hash = malloc(size * sizeof(int));
+    instance_hash = malloc(size * sizeof(int));
+    if (!mac_hash || !instance_hash) {
+        free(mac_hash);
+        free(instance_hash);
+        return false;
+    }
+    free(MAC_Hash);
+    free(Instance_Hash);
+    MAC_Hash = mac_hash;
+    Instance_Hash = instance_hash;
+    Hash_Size = size;
+    for (i = 0; i < size; i++) {
+        MAC_Hash[i] = -1;
+        Instance_Hash[i] = -1;
+    }
+    for (i = 0; i < Num_Managed_Devices; i++) {
+        if (Device_Links[i].mac_indexed)
+            routed_mac_hash_add(i);
+        routed_instance_hash_add(i);
+    }
+
+    return true;
+}
+
+/** Makes room in Devices[] for one more Device.
+ * @return True if there is room.
+ */
+static bool routed_device_grow(
+    void)
+{
+    DEVICE_OBJECT_DATA *devices = NULL;
+    struct routed_device_link *links = NULL;
+    unsigned size;
+
+    if (Num_Managed_Devices < Devices_Size)
+        return routed_hash_resize();
+    /* index 0xFFFF is the "no room" return of Add_Routed_Device() */
+    if (Devices_Size >= 0xFFFF)
+        return false;
+    size = Devices_Size ? Devices_Size * 2 : 4;
+    if (size > 0xFFFF)
+        size = 0xFFFF;
+    devices = calloc(size, sizeof(DEVICE_OBJECT_DATA));
+    links = calloc(size, sizeof(struct routed_device_link));
+    if (!devices || !links) {
+        free(devices);
+        free(links);
+        return false;
+    }
+    memcpy(devices, Devices, Devices_Size * sizeof(DEVICE_OBJECT_DATA));
+    memcpy(links, Device_Links,
+        Devices_Size * sizeof(struct routed_device_link));
+    if (Devices != Devices_Initial)
+        free(Devices);
+    if (Device_Links != Links_Initial)
+        free(Device_Links);
+    Devices = devices;
+    Device_Links = links;
+    Devices_Size = size;
+
+    return routed_hash_resize();
+}
 
 /* void Routing_Device_Init(uint32_t first_object_instance) is
  * found in device.c
@@ -124,12 +336,16 @@ uint16_t Add_Routed_Device(
     const char *sDescription)
 {
     int i = Num_Managed_Devices;
-    if (i < MAX_NUM_DEVICES) {
+    if (routed_device_grow()) {
         DEVICE_OBJECT_DATA *pDev = &Devices[i];
         Num_Managed_Devices++;
         iCurrent_Device_Idx = i;
+        memset(pDev, 0, sizeof(DEVICE_OBJECT_DATA));
+        pDev->Object_Table = Routed_Object_Table;
+        Device_Links[i].mac_indexed = false;
         pDev->bacObj.mObject_Type = OBJECT_DEVICE;
         pDev->bacObj.Object_Instance_Number = Object_Instance;
+        routed_instance_hash_add(i);
         if (sObject_Name != NULL)
             Routed_Device_Set_Object_Name(sObject_Name->encoding,
                 sObject_Name->value, sObject_Name->length);
@@ -155,13 +371,14 @@ uint16_t Add_Routed_Device(
  *                 If valid idx, will set iCurrent_Device_Idx with the idx
  * @return Pointer to the requested Device Object data, or NULL if the idx
  *         is for an invalid row entry (eg, after the last good Device).
+ *         Set its address with Routed_Device_Set_Address().
  */
 DEVICE_OBJECT_DATA *Get_Routed_Device_Object(
     int idx)
 {
     if (idx == -1)
         return &Devices[iCurrent_Device_Idx];
-    else if ((idx >= 0) && (idx < MAX_NUM_DEVICES)) {
+    else if ((idx >= 0) && (idx < Num_Managed_Devices)) {
         iCurrent_Device_Idx = idx;
         return &Devices[idx];
     } else
@@ -182,13 +399,32 @@ BACNET_ADDRESS *Get_Routed_Device_Address(
 {
     if (idx == -1)
         return &Devices[iCurrent_Device_Idx].bacDevAddr;
-    else if ((idx >= 0) && (idx < MAX_NUM_DEVICES)) {
+    else if ((idx >= 0) && (idx < Num_Managed_Devices)) {
         iCurrent_Device_Idx = idx;
         return &Devices[idx].bacDevAddr;
     } else
         return NULL;
 }
 
+/** Set the BACnet address of the current Device, and index its MAC
+ * address so that messages for it are found quickly.
+ * @param address [in] The new address of the Device.
+ * @return True if the address was set.
+ */
+bool Routed_Device_Set_Address(
+    BACNET_ADDRESS * address)
+{
+    if ((address == NULL) || (iCurrent_Device_Idx >= Num_Managed_Devices))
+        return false;
+    routed_mac_hash_remove(iCurrent_Device_Idx);
+    memcpy(&Devices[iCurrent_Device_Idx].bacDevAddr, address,
+        sizeof(BACNET_ADDRESS));
+    if (address->mac_len > 0)
+        routed_mac_hash_add(iCurrent_Device_Idx);
+
+    return true;
+}
+
 
 
 /** Get the currently active BACnet address.
@@ -231,34 +467,104 @@ bool Routed_Device_Address_Lookup(
     uint8_t * mac_adress)
 {
     bool result = false;
-    DEVICE_OBJECT_DATA *pDev = &Devices[idx];
-    int i;
 
-    if ((idx >= 0) && (idx < MAX_NUM_DEVICES)) {
+    if ((idx >= 0) && (idx < Num_Managed_Devices)) {
         if (address_len == 0) {
             /* Automatic match */
             iCurrent_Device_Idx = idx;
             result = true;
-        } else if (mac_adress != NULL) {
-            for (i = 0; i < address_len; i++) {
-                if (pDev->bacDevAddr.mac[i] != mac_adress[i])
-                    break;
-            }
-            if (i == address_len) {     /* Success! */
-                iCurrent_Device_Idx = idx;
-                result = true;
-            }
+        } else if ((mac_adress != NULL) &&
+            (memcmp(Devices[idx].bacDevAddr.mac, mac_adress,
+                    address_len) == 0)) {
+            /* Success! */
+            iCurrent_Device_Idx = idx;
+            result = true;
         }
     }
     return result;
 }
 
+/** Find the Device with the given MAC address, from the hash of the
+ * addresses set with Routed_Device_Set_Address().
+ * @param address_len [in] Length of the mac_adress[] field.
+ * @param mac_adress [in] The desired MAC address of a Device.
+ * @param first [in] Lowest index that may match.
+ * @return The lowest matching index, or -1 if none matches.
+ */
+static int routed_mac_lookup(
+    uint8_t address_len,
+    uint8_t * mac_adress,
+    int first)
+{
+    int idx;
+    int found = -1;
+
+    if (Hash_Size == 0)
+        return -1;
+    idx = MAC_Hash[routed_hash(mac_adress, address_len) & (Hash_Size - 1)];
+    while (idx != -1) {
+        /* a chain holds other addresses too, but only a few */
+        if ((idx >= first) && ((found == -1) || (idx < found)) &&
+            (Devices[idx].bacDevAddr.mac_len == address_len) &&
+            (memcmp(Devices[idx].bacDevAddr.mac, mac_adress,
+                    address_len) == 0)) {
+            found = idx;
+        }
+        idx = Device_Links[idx].mac_next;
+    }
+
+    return found;
+}
+
+/** See if a Device instance is that of the main gateway Device.
+ * Unlike the lookups, this leaves iCurrent_Device_Idx alone.
+ *
+ * @param object_instance [in] Instance number of the Device object.
+ * @return True if the gateway Device has that instance number.
+ */
+bool Routed_Device_Is_Gateway_Instance(
+    uint32_t object_instance)
+{
+    return (Num_Managed_Devices > 0) &&
+        (Devices[0].bacObj.Object_Instance_Number == object_instance);
+}
+
+/** Find the Gateway or Routed Device with the given Device instance.
+ * Has the desirable side-effect of setting iCurrent_Device_Idx to
+ * that Device if it is found.
+ *
+ * @param object_instance [in] Instance number of the Device object.
+ * @return True if a Device has that instance number.
+ */
+bool Routed_Device_Instance_Lookup(
+    uint32_t object_instance)
+{
+    int idx;
+
+    if (Hash_Size == 0)
+        return false;
+    idx =
+        Instance_Hash[routed_instance_hash(object_instance) & (Hash_Size -
+            1)];
+    while (idx != -1) {
+        if (Devices[idx].bacObj.Object_Instance_Number == object_instance) {
+            iCurrent_Device_Idx = idx;
+            return true;
+        }
+        idx = Device_Links[idx].instance_next;
+    }
+
+    return false;
+}
+
 
 /** Find the next Gateway or Routed Device at the given MAC address,
  * starting the search at the "cursor".
  * Has the desirable side-effect of setting internal iCurrent_Device_Idx
  * if a match is found, for use in the subsequent routing handling
  * functions.
+ * A broadcast walks through the Devices one by one; a message to one
+ * routed Device finds it in the hash of MAC addresses.
  *
  * @param dest [in] The BACNET_ADDRESS of the message's destination.
  * 		   If the Length of the mac_adress[] field is 0, then this is a MAC
@@ -292,7 +598,7 @@ bool Routed_Device_GetNext(
     /* First, see if the index is out of range.
      * Eg, last call to GetNext may have been the last successful one.
      */
-    if ((idx < 0) || (idx >= MAX_NUM_DEVICES))
+    if ((idx < 0) || (idx >= Num_Managed_Devices))
         idx = -1;
 
     /* Next, see if it's a BACnet broadcast.
@@ -321,17 +627,20 @@ bool Routed_Device_GetNext(
     else if (dest->net == dnet) {
         if (idx == 0)   /* Step over this case (starting point) */
             idx = 1;
-        while (idx < MAX_NUM_DEVICES) {
-            bSuccess =
-                Routed_Device_Address_Lookup(idx++, dest->len, dest->adr);
-            if (bSuccess)
-                break;  /* We don't need to keep looking */
+        if (dest->len == 0) {
+            bSuccess = Routed_Device_Address_Lookup(idx++, 0, NULL);
+        } else {
+            idx = routed_mac_lookup(dest->len, dest->adr, idx);
+            if (idx != -1) {
+                iCurrent_Device_Idx = idx++;
+                bSuccess = true;
+            }
         }
     }
 
     if (!bSuccess)
         *cursor = -1;
-    else if (idx == MAX_NUM_DEVICES)    /* No more to GetNext */
+    else if (idx >= Num_Managed_Devices)        /* No more to GetNext */
         *cursor = -1;
     else
         *cursor = idx;
@@ -545,7 +854,9 @@ bool Routed_Device_Set_Object_Instance_Number(
 
     if (object_id <= BACNET_MAX_INSTANCE) {
         /* Make the change and update the database revision */
+        routed_instance_hash_remove(iCurrent_Device_Idx);
         Devices[iCurrent_Device_Idx].bacObj.Object_Instance_Number = object_id;
+        routed_instance_hash_add(iCurrent_Device_Idx);
         Routed_Device_Inc_Database_Revision();
     } else
         status = false;
@@ -607,6 +918,74 @@ void Routed_Device_Inc_Database_Revision(
     pDev->Database_Revision++;
 }
 
+/** Get the objects of the current Device.
+ * @return The Device's object table, or NULL if it has the objects of
+ *         the gateway Device.
+ */
+object_functions_t *Routed_Device_Object_Table(
+    void)
+{
+    if (iCurrent_Device_Idx >= Num_Managed_Devices)
+        return NULL;
+
+    return Devices[iCurrent_Device_Idx].Object_Table;
+}
+
+/** Set the objects that the Devices added from now on will have.
+ * Routing_Device_Init() sets the object types that keep objects of their
+ * own for each Device, after the gateway Device has been added.
+ * @param object_table [in] Table of object functions, ending with
+ *         MAX_BACNET_OBJECT_TYPE, or NULL for the gateway's objects.
+ */
+void Routed_Device_Set_Object_Table(
+    object_functions_t * object_table)
+{
+    Routed_Object_Table = object_table;
+}
+
+/** Get the current Device's copy of some object data, so that each routed
+ * Device has objects of its own, such as its own Analog Input 1.
+ * The gateway Device uses the object module's data.  The first call for
+ * any other Device allocates zeroed data and calls object_init, which
+ * finds the new data through this function, to initialize it.
+ * @param gateway_data [in] The object module's data.
+ * @param size [in] Size of the data, in bytes.
+ * @param object_init [in] Initializes the object data of the current Device.
+ * @return The current Device's object data, or the gateway's if there
+ *         is no memory for a copy.
+ */
+void *Routed_Device_Object_Data(
+    void *gateway_data,
+    size_t size,
+    object_init_function object_init)
+{
+    DEVICE_OBJECT_DATA *pDev = NULL;
+    struct routed_object_data *pData = NULL;
+
+    if ((iCurrent_Device_Idx == 0) ||
+        (iCurrent_Device_Idx >= Num_Managed_Devices))
+        return gateway_data;
+    pDev = &Devices[iCurrent_Device_Idx];
+    for (pData = pDev->Object_Data; pData != NULL; pData = pData->next) {
+        if (pData->gateway_data == gateway_data)
+            return pData->data;
+    }
+    pData = calloc(1, sizeof(struct routed_object_data));
+    if (pData)
+        pData->data = calloc(1, size);
+    if (!pData || !pData->data) {
+        free(pData);
+        return gateway_data;
+    }
+    pData->gateway_data = gateway_data;
+    pData->next = pDev->Object_Data;
+    pDev->Object_Data = pData;
+    if (object_init)
+        object_init();
+
+    return pData->data;
+}
+
 
 /** Check to see if the current Device supports this service.
  * Presently checks for RD and DCC and only allows them if the current
@@ -657,3 +1036,249 @@ int Routed_Device_Service_Approval(
     }
     return len;
 }
+
+#ifdef TEST
+#include <assert.h>
+#include "ctest.h"
+
+#ifdef TEST_GW_DEVICE
+/* the rest of the Device object is not needed here */
+int Device_Read_Property_Local(
+    BACNET_READ_PROPERTY_DATA * rpdata)
+{
+    (void) rpdata;
+    return BACNET_STATUS_ERROR;
+}
+
+bool Device_Write_Property_Local(
+    BACNET_WRITE_PROPERTY_DATA * wp_data)
+{
+    (void) wp_data;
+    return false;
+}
+
+bool WPValidateArgType(
+    BACNET_APPLICATION_DATA_VALUE * pValue,
+    uint8_t ucExpectedTag,
+    BACNET_ERROR_CLASS * pErrorClass,
+    BACNET_ERROR_CODE * pErrorCode)
+{
+    (void) pErrorClass;
+    (void) pErrorCode;
+    return (pValue->tag == ucExpectedTag);
+}
+
+bool WPValidateString(
+    BACNET_APPLICATION_DATA_VALUE * pValue,
+    int iMaxLen,
+    bool bEmptyAllowed,
+    BACNET_ERROR_CLASS * pErrorClass,
+    BACNET_ERROR_CODE * pErrorCode)
+{
+    (void) pValue;
+    (void) iMaxLen;
+    (void) bEmptyAllowed;
+    (void) pErrorClass;
+    (void) pErrorCode;
+    return false;
+}
+#endif
+
+#define TEST_ROUTED_DEVICES 2000
+#define TEST_DNET 2709
+
+static void test_routed_address(
+    int idx,
+    BACNET_ADDRESS * address)
+{
+    memset(address, 0, sizeof(BACNET_ADDRESS));
+    address->mac_len = 6;
+    address->mac[0] = 10;
+    address->mac[1] = (uint8_t) (idx >> 8);
+    address->mac[2] = (uint8_t) idx;
+    address->mac[4] = 0xBA;
+    address->mac[5] = 0xC0;
+    if (idx > 0) {
+        address->net = TEST_DNET;
+        memcpy(address->adr, address->mac, 6);
+        address->len = 6;
+    }
+}
+
+void testRouted_Device_Table(
+    Test * pTest)
+{
+    BACNET_ADDRESS address;
+    BACNET_ADDRESS dest;
+    int DNET_list[2] = { TEST_DNET, -1 };
+    int cursor = 0;
+    int count = 0;
+    int i;
+
+    /* the table grows well past its initial size */
+    for (i = 0; i <= TEST_ROUTED_DEVICES; i++) {
+        ct_test(pTest, Add_Routed_Device(1000 + i, NULL, NULL) == i);
+        test_routed_address(i, &address);
+        ct_test(pTest, Routed_Device_Set_Address(&address));
+    }
+    ct_test(pTest, Num_Managed_Devices == TEST_ROUTED_DEVICES + 1);
+
+    /* every Device is found by its instance number */
+    for (i = 0; i <= TEST_ROUTED_DEVICES; i++) {
+        ct_test(pTest, Routed_Device_Instance_Lookup(1000 + i));
+        ct_test(pTest, iCurrent_Device_Idx == i);
+        ct_test(pTest, Routed_Device_Object_Instance_Number() == 1000 + i);
+    }
+    ct_test(pTest, !Routed_Device_Instance_Lookup(999));
+    ct_test(pTest, !Routed_Device_Instance_Lookup(1001 + TEST_ROUTED_DEVICES));
+    /* the gateway is known without changing the current Device */
+    ct_test(pTest, Routed_Device_Is_Gateway_Instance(1000));
+    ct_test(pTest, !Routed_Device_Is_Gateway_Instance(1001));
+    ct_test(pTest, iCurrent_Device_Idx == TEST_ROUTED_DEVICES);
+
+    /* and a message to a routed Device by its MAC address */
+    for (i = 1; i <= TEST_ROUTED_DEVICES; i += 97) {
+        test_routed_address(i, &dest);
+        cursor = 0;
+        ct_test(pTest, Routed_Device_GetNext(&dest, DNET_list, &cursor));
+        ct_test(pTest, iCurrent_Device_Idx == i);
+        ct_test(pTest, !Routed_Device_GetNext(&dest, DNET_list, &cursor));
+    }
+    /* the gateway is not on the virtual network */
+    test_routed_address(0, &dest);
+    dest.net = TEST_DNET;
+    memcpy(dest.adr, dest.mac, 6);
+    dest.len = 6;
+    cursor = 0;
+    ct_test(pTest, !Routed_Device_GetNext(&dest, DNET_list, &cursor));
+    /* a local message is for the gateway */
+    dest.net = 0;
+    cursor = 0;
+    ct_test(pTest, Routed_Device_GetNext(&dest, DNET_list, &cursor));
+    ct_test(pTest, iCurrent_Device_Idx == 0);
+
+    /* a broadcast reaches every Device once */
+    memset(&dest, 0, sizeof(dest));
+    dest.net = BACNET_BROADCAST_NETWORK;
+    cursor = 0;
+    while (Routed_Device_GetNext(&dest, DNET_list, &cursor)) {
+        ct_test(pTest, iCurrent_Device_Idx == count);
+        count++;
+        if (cursor < 0)
+            break;
+    }
+    ct_test(pTest, count == TEST_ROUTED_DEVICES + 1);
+    /* a broadcast on the virtual network reaches the routed Devices */
+    dest.net = TEST_DNET;
+    cursor = 0;
+    count = 0;
+    while (Routed_Device_GetNext(&dest, DNET_list, &cursor)) {
+        count++;
+        if (cursor < 0)
+            break;
+    }
+    ct_test(pTest, count == TEST_ROUTED_DEVICES);
+
+    /* changes are found at once */
+    ct_test(pTest, Get_Routed_Device_Object(5) != NULL);
+    ct_test(pTest, Routed_Device_Set_Object_Instance_Number(99999));
+    ct_test(pTest, !Routed_Device_Instance_Lookup(1005));
+    ct_test(pTest, Routed_Device_Instance_Lookup(99999));
+    ct_test(pTest, iCurrent_Device_Idx == 5);
+    test_routed_address(TEST_ROUTED_DEVICES + 7, &address);
+    ct_test(pTest, Routed_Device_Set_Address(&address));
+    test_routed_address(5, &dest);
+    cursor = 0;
+    ct_test(pTest, !Routed_Device_GetNext(&dest, DNET_list, &cursor));
+    cursor = 0;
+    ct_test(pTest, Routed_Device_GetNext(&address, DNET_list, &cursor));
+    ct_test(pTest, iCurrent_Device_Idx == 5);
+    ct_test(pTest, Get_Routed_Device_Object(TEST_ROUTED_DEVICES + 1) == NULL);
+
+    return;
+}
+
+/* an object module that keeps its values for each Device */
+static void Test_Object_Init(
+    void);
+static int Test_Object_Value_Gateway[4];
+#define Test_Object_Value ((int *) Routed_Device_Object_Data( \
+    Test_Object_Value_Gateway, sizeof(Test_Object_Value_Gateway), \
+    Test_Object_Init))
+static unsigned Test_Object_Inits;
+
+static void Test_Object_Init(
+    void)
+{
+    unsigned i;
+
+    Test_Object_Inits++;
+    for (i = 0; i < 4; i++) {
+        Test_Object_Value[i] = 1;
+    }
+}
+
+void testRouted_Device_Objects(
+    Test * pTest)
+{
+    object_functions_t object_table[2];
+
+    /* the Devices of testRouted_Device_Table() are still there */
+    ct_test(pTest, Get_Routed_Device_Object(0) != NULL);
+    Test_Object_Init();
+    Test_Object_Value[1] = 100;
+    ct_test(pTest, Test_Object_Value == Test_Object_Value_Gateway);
+    /* each routed Device has objects of its own */
+    ct_test(pTest, Get_Routed_Device_Object(1) != NULL);
+    ct_test(pTest, Test_Object_Value[1] == 1);
+    ct_test(pTest, Test_Object_Inits == 2);
+    Test_Object_Value[1] = 101;
+    ct_test(pTest, Get_Routed_Device_Object(2) != NULL);
+    ct_test(pTest, Test_Object_Value[1] == 1);
+    Test_Object_Value[1] = 102;
+    ct_test(pTest, Test_Object_Inits == 3);
+    ct_test(pTest, Get_Routed_Device_Object(1) != NULL);
+    ct_test(pTest, Test_Object_Value[1] == 101);
+    ct_test(pTest, Get_Routed_Device_Object(0) != NULL);
+    ct_test(pTest, Test_Object_Value[1] == 100);
+    ct_test(pTest, Test_Object_Inits == 3);
+
+    /* Devices added from now on get the object table that is set */
+    ct_test(pTest, Routed_Device_Object_Table() == NULL);
+    memset(object_table, 0, sizeof(object_table));
+    object_table[0].Object_Type = OBJECT_DEVICE;
+    object_table[1].Object_Type = MAX_BACNET_OBJECT_TYPE;
+    Routed_Device_Set_Object_Table(object_table);
+    ct_test(pTest, Add_Routed_Device(5000, NULL, NULL) ==
+        TEST_ROUTED_DEVICES + 1);
+    ct_test(pTest, Routed_Device_Object_Table() == object_table);
+    ct_test(pTest, Get_Routed_Device_Object(1) != NULL);
+    ct_test(pTest, Routed_Device_Object_Table() == NULL);
+    Routed_Device_Set_Object_Table(NULL);
+
+    return;
+}
+
+#ifdef TEST_GW_DEVICE
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet Gateway Devices", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testRouted_Device_Table);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testRouted_Device_Objects);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_GW_DEVICE */
+#endif /* TEST */
@@ -0,0 +1,51 @@
+#Makefile to build test case
+CC      = gcc
+SRC_DIR = ../../src
+TEST_DIR = ../../test
+PORTS_DIR = ../../ports/linux
+INCLUDES = -I../../include -I$(TEST_DIR) -I$(PORTS_DIR) -I.
+DEFINES = -DBIG_ENDIAN=0
+DEFINES += -DTEST -DBACDL_TEST
+DEFINES += -DBACAPP_ALL
+DEFINES += -DMAX_TSM_TRANSACTIONS=0
+DEFINES += -DTEST_GW_DEVICE -DBAC_ROUTING
+DEFINES += -DBACNET_PROPERTY_LISTS=1
+
+CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g
+
+SRCS = gw_device.c \
+	$(SRC_DIR)/bacdcode.c \
+	$(SRC_DIR)/bacint.c \
+	$(SRC_DIR)/bacstr.c \
+	$(SRC_DIR)/bacreal.c \
+	$(SRC_DIR)/datetime.c \
+	$(SRC_DIR)/bacapp.c \
+	$(SRC_DIR)/bacdevobjpropref.c \
+	$(SRC_DIR)/bactext.c \
+	$(SRC_DIR)/indtext.c \
+	$(SRC_DIR)/proplist.c \
+	$(SRC_DIR)/lighting.c \
+	$(SRC_DIR)/reject.c \
+	$(SRC_DIR)/bacaddr.c \
+	$(TEST_DIR)/ctest.c
+
+TARGET = gw_device
+
+all: ${TARGET}
+
+OBJS = ${SRCS:.c=.o}
+
+${TARGET}: ${OBJS}
+	${CC} -o $@ ${OBJS}
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+
+clean:
+	rm -rf core ${TARGET} $(OBJS)
+
+include: .depend
@@ -24,7 +24,10 @@
 *********************************************************************/
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>     /* for memmove */
 #include "bacdef.h"
 #include "bacdcode.h"
@@ -39,19 +42,165 @@
 #include "datalink.h"
 #include "address.h"
 #include "bacdevobjpropref.h"
+#include "bacaddr.h"
+#include "tsm.h"
+#include "client.h"
 #include "trendlog.h"
 #if defined(BACFILE)
 #include "bacfile.h"    /* object list dependency */
 #endif
 
+/* Use memory-mapped files for the log buffers where the OS supports them */
+#if !defined(TL_MMAP_STORAGE) && (defined(__unix__) || defined(__APPLE__))
+#define TL_MMAP_STORAGE 1
+#endif
+
+#if TL_MMAP_STORAGE
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 /* number of demo objects */
 #ifndef MAX_TREND_LOGS
 #define MAX_TREND_LOGS 8
 #endif
 
-TL_DATA_REC Logs[MAX_TREND_LOGS][TL_MAX_ENTRIES];
 static TL_LOG_INFO LogInfo[MAX_TREND_LOGS];
 
+/* Requests we may have outstanding to a remote source */
+#define TL_REQ_NONE         0
+#define TL_REQ_READ         1
+#define TL_REQ_SUBSCRIBE    2
+#define TL_REQ_CANCEL       3
+
+/* Our COV subscriber process identifiers are this plus the log index */
+#define TL_COV_PROCESS_ID_BASE  0x544C0000UL
+/* Extra lifetime on a COV subscription beyond the resubscription interval */
+#define TL_COV_LIFETIME_GRACE   60
+/* How long to wait before trying again after a failed subscription */
+#define TL_COV_RETRY_SECONDS    60
+
+static void TL_COV_Subscribe(
+    int iLog,
+    bool bCancel);
+static void TL_Forget_Request(
+    int iLog);
+static void TL_Read_Complete(
+    BACNET_TSM_REPLY * reply,
+    void *context);
+
+/*
+ * Trend Log buffer storage.
+ *
+ * Records are held packed rather than as TL_DATA_REC structures. Each log
+ * owns a ring of fixed size blocks and each block holds a run of variable
+ * length records laid out as:
+ *
+ *   octet   - record type in b0-b3, status flags in b4-b7
+ *   varint  - timestamp less (previous timestamp + log interval), zig-zag
+ *             encoded and shifted up one with b0 set if status is present
+ *   datum   - by type: REAL and DELTA as 4 raw octets, BOOLEAN and log
+ *             status as 1 octet, ENUMERATED and UNSIGNED as a varint,
+ *             SIGNED as a zig-zag varint, BIT STRING as the length octet
+ *             plus the octets used, ERROR as two varints and NULL as nothing
+ *
+ * so a REAL polled on time costs 6 octets rather than sizeof(TL_DATA_REC).
+ * The block header carries the full timestamp and sequence number of its
+ * first record and the interval its deltas are against, so a record is
+ * found with a binary search over the blocks and a short decode within
+ * one. Sequential reads carry on from where the last one stopped.
+ *
+ * The ring is sized for ulBufferSize records at TL_PACKED_RECORD_MAX
+ * octets each, so Record_Count reaches Buffer_Size before a whole block has
+ * to be recycled and from then on the oldest record is pushed out for each
+ * new one. A change of interval starts a new block part way through one, so
+ * if the interval keeps changing the oldest block can still go early;
+ * TL_Is_Full() takes that into account for Stop_When_Full.
+ *
+ * When a storage path has been configured with Trend_Log_Storage_Path_Set()
+ * the ring is a memory-mapped file laid out as:
+ *
+ *   TL_FILE_HEADER    - identity plus two metadata slots
+ *   block[n]          - the ring of packed record blocks
+ *
+ * Records are written into the map first and the ring position and counts
+ * are then committed into the older of the two metadata slots with a
+ * bumped generation and a checksum. A crash part way through a commit
+ * therefore leaves the previous slot intact, and on restart the newest
+ * valid slot tells us where to carry on without having to read the
+ * history back into RAM.
+ *
+ * Without a storage path (or on platforms without mmap) the ring is
+ * simply allocated from the heap and is lost on restart.
+ */
+
+#define TL_BLOCK_SIZE           256     /* Octets per block, header included */
+#define TL_PACKED_RECORD_MAX    12      /* Largest a packed record can be */
+#define TL_MAX_TIME_DELTA       0x1FFFFFFFL     /* Beyond this start a new block */
+
+typedef struct tl_block_header {
+    time_t tFirst;      /* Timestamp of the first record */
+    uint32_t ulFirstSeq;        /* Sequence number of the first record */
+    uint32_t ulInterval;        /* Log interval the time deltas are against */
+    uint16_t usCount;   /* Records packed into the block */
+    uint16_t usUsed;    /* Octets of packed records */
+    uint16_t usSkip;    /* Records at the front already pushed out */
+} TL_BLOCK_HEADER;
+
+#define TL_BLOCK_DATA_SIZE  (TL_BLOCK_SIZE - sizeof(TL_BLOCK_HEADER))
+
+#define TL_FILE_MAGIC   0x544C4F47UL    /* "TLOG" */
+#define TL_FILE_VERSION 2
+
+typedef struct tl_file_meta {
+    uint32_t ulGeneration;      /* Bumped on every commit, newest valid wins */
+    uint32_t ulHead;    /* Block holding the oldest record */
+    uint32_t ulTail;    /* Block records are being added to */
+    uint32_t ulHeadSkip;        /* Records pushed out of the head block */
+    uint32_t ulTailCount;       /* Records in the tail block */
+    uint32_t ulTailUsed;        /* Octets used in the tail block */
+    uint32_t ulRecordCount;     /* Records currently in the buffer */
+    uint32_t ulTotalRecordCount;        /* Records ever inserted */
+    uint32_t ulChecksum;        /* Over the preceeding fields */
+} TL_FILE_META;
+
+typedef struct tl_file_header {
+    uint32_t ulMagic;
+    uint16_t usVersion;
+    uint16_t usBlockSize;       /* TL_BLOCK_SIZE when file was made */
+    uint32_t ulBlockCount;      /* Number of blocks following the header */
+    uint32_t ulBufferSize;      /* Number of records the log holds */
+    uint32_t ulInstance;        /* Trend Log instance owning the file */
+    TL_FILE_META Meta[2];
+} TL_FILE_HEADER;
+
+/* Keep the blocks aligned no matter how the header is packed */
+#define TL_FILE_HEADER_SIZE \
+    ((sizeof(TL_FILE_HEADER) + TL_BLOCK_SIZE - 1) / \
+    TL_BLOCK_SIZE * TL_BLOCK_SIZE)
+
+typedef struct tl_store {
+    uint8_t *pBlocks;   /* Start of the ring of blocks */
+    uint32_t ulBlockCount;      /* Blocks in the ring */
+    uint32_t ulHead;    /* Block holding the oldest record */
+    uint32_t ulTail;    /* Block records are being added to */
+    time_t tTailLast;   /* Timestamp of the newest record */
+    TL_FILE_HEADER *pHeader;    /* NULL if heap backed */
+    size_t MapSize;     /* Size of the mapping if file backed */
+    int iSlot;  /* Metadata slot holding the last commit */
+    /* Where the last read got to so the next one can carry on */
+    bool bReadValid;
+    uint32_t ulReadBlock;
+    uint16_t usReadRecord;      /* Next record in the block */
+    uint16_t usReadOffset;      /* and where it starts */
+    time_t tReadPrev;   /* Timestamp of the record before it */
+} TL_STORE;
+
+static TL_STORE Log_Store[MAX_TREND_LOGS];
+static char Storage_Path[256];
+
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Trend_Log_Properties_Required[] = {
     PROP_OBJECT_IDENTIFIER,
@@ -75,10 +224,8 @@ static const int Trend_Log_Properties_Optional[] = {
     PROP_STOP_TIME,
     PROP_LOG_DEVICE_OBJECT_PROPERTY,
     PROP_LOG_INTERVAL,
-
-/* Required if COV logging supported
     PROP_COV_RESUBSCRIPTION_INTERVAL,
-    PROP_CLIENT_COV_INCREMENT, */
+    PROP_CLIENT_COV_INCREMENT,
 
 /* Required if intrinsic reporting supported
     PROP_NOTIFICATION_THRESHOLD,
@@ -160,271 +307,1013 @@ unsigned Trend_Log_Instance_To_Index(
     return index;
 }
 
-/*
- * Things to do when starting up the stack for Trend Logs.
- * Should be called whenever we reset the device or power it up
- */
-void Trend_Log_Init(
-    void)
+static TL_BLOCK_HEADER *TL_Block(
+    TL_STORE * pStore,
+    uint32_t ulBlock)
 {
-    static bool initialized = false;
-    int iLog;
-    int iEntry;
-    struct tm TempTime;
-    time_t tClock;
-
-    if (!initialized) {
-        initialized = true;
+    return (TL_BLOCK_HEADER *) & pStore->pBlocks[(size_t) ulBlock *
+        TL_BLOCK_SIZE];
+}
 
-        /* initialize all the values */
+static uint8_t *TL_Block_Data(
+    TL_BLOCK_HEADER * pBlock)
+{
+    return (uint8_t *) pBlock + sizeof(TL_BLOCK_HEADER);
+}
 
-        for (iLog = 0; iLog < MAX_TREND_LOGS; iLog++) {
-            /*
-             * Do we need to do anything here?
-             * Trend logs are usually assumed to survive over resets
-             * and are frequently implemented using Battery Backed RAM
-             * If they are implemented using Flash or SD cards or some
-             * such mechanism there may be some RAM based setup needed
-             * for log management purposes.
-             * We probably need to look at inserting LOG_INTERRUPTED
-             * entries into any active logs if the power down or reset
-             * may have caused us to miss readings.
-             */
+/*****************************************************************************
+ * Packed record encoding helpers                                            *
+ *****************************************************************************/
 
-            /* We will just fill the logs with some entries for testing
-             * purposes.
-             */
-            TempTime.tm_year = 109;
-            TempTime.tm_mon = iLog + 1; /* Different month for each log */
-            TempTime.tm_mday = 1;
-            TempTime.tm_hour = 0;
-            TempTime.tm_min = 0;
-            TempTime.tm_sec = 0;
-            tClock = mktime(&TempTime);
+static int TL_Varint_Encode(
+    uint8_t * pBuf,
+    uint32_t ulValue)
+{
+    int iLen = 0;
 
-            for (iEntry = 0; iEntry < TL_MAX_ENTRIES; iEntry++) {
-                Logs[iLog][iEntry].tTimeStamp = tClock;
-                Logs[iLog][iEntry].ucRecType = TL_TYPE_REAL;
-                Logs[iLog][iEntry].Datum.fReal =
-                    (float) (iEntry + (iLog * TL_MAX_ENTRIES));
-                /* Put status flags with every second log */
-                if ((iLog & 1) == 0)
-                    Logs[iLog][iEntry].ucStatus = 128;
-                else
-                    Logs[iLog][iEntry].ucStatus = 0;
-                tClock += 900;  /* advance 15 minutes */
-            }
+    while (ulValue >= 0x80) {
+        pBuf[iLen++] = (uint8_t) (ulValue | 0x80);
+        ulValue >>= 7;
+    }
+    pBuf[iLen++] = (uint8_t) ulValue;
 
-            LogInfo[iLog].tLastDataTime = tClock - 900;
-            LogInfo[iLog].bAlignIntervals = true;
-            LogInfo[iLog].bEnable = true;
-            LogInfo[iLog].bStopWhenFull = false;
-            LogInfo[iLog].bTrigger = false;
-            LogInfo[iLog].LoggingType = LOGGING_TYPE_POLLED;
-            LogInfo[iLog].Source.arrayIndex = 0;
-            LogInfo[iLog].ucTimeFlags = 0;
-            LogInfo[iLog].ulIntervalOffset = 0;
-            LogInfo[iLog].iIndex = 0;
-            LogInfo[iLog].ulLogInterval = 900;
-            LogInfo[iLog].ulRecordCount = TL_MAX_ENTRIES;
-            LogInfo[iLog].ulTotalRecordCount = 10000;
+    return iLen;
+}
 
-            LogInfo[iLog].Source.deviceIdentifier.instance =
-                Device_Object_Instance_Number();
-            LogInfo[iLog].Source.deviceIdentifier.type = OBJECT_DEVICE;
-            LogInfo[iLog].Source.objectIdentifier.instance = iLog;
-            LogInfo[iLog].Source.objectIdentifier.type = OBJECT_ANALOG_INPUT;
-            LogInfo[iLog].Source.arrayIndex = BACNET_ARRAY_ALL;
-            LogInfo[iLog].Source.propertyIdentifier = PROP_PRESENT_VALUE;
+static int TL_Varint_Decode(
+    const uint8_t * pBuf,
+    uint32_t * pulValue)
+{
+    int iLen = 0;
+    int iShift = 0;
+    uint32_t ulValue = 0;
 
-            datetime_set_values(&LogInfo[iLog].StartTime, 2009, 1, 1, 0, 0, 0,
-                0);
-            LogInfo[iLog].tStartTime =
-                TL_BAC_Time_To_Local(&LogInfo[iLog].StartTime);
-            datetime_set_values(&LogInfo[iLog].StopTime, 2020, 12, 22, 23, 59,
-                59, 99);
-            LogInfo[iLog].tStopTime =
-                TL_BAC_Time_To_Local(&LogInfo[iLog].StopTime);
-        }
-    }
+    do {
+        ulValue |= (uint32_t) (pBuf[iLen] & 0x7F) << iShift;
+        iShift += 7;
+    } while ((pBuf[iLen++] & 0x80) && (iShift < 35));
+    *pulValue = ulValue;
 
-    return;
+    return iLen;
 }
 
-
-/*
- * Note: we use the instance number here and build the name based
- * on the assumption that there is a 1 to 1 correspondance. If there
- * is not we need to convert to index before proceeding.
- */
-bool Trend_Log_Object_Name(
-    uint32_t object_instance,
-    BACNET_CHARACTER_STRING * object_name)
+static uint32_t TL_Zigzag_Encode(
+    int32_t lValue)
 {
-    static char text_string[32] = "";   /* okay for single thread */
-    bool status = false;
-
-    if (object_instance < MAX_TREND_LOGS) {
-        sprintf(text_string, "Trend Log %u", object_instance);
-        status = characterstring_init_ansi(object_name, text_string);
-    }
+    return ((uint32_t) lValue << 1) ^ (uint32_t) (lValue >> 31);
+}
 
-    return status;
+static int32_t TL_Zigzag_Decode(
+    uint32_t ulValue)
+{
+    return (int32_t) (ulValue >> 1) ^ -(int32_t) (ulValue & 1);
 }
 
+/*****************************************************************************
+ * Pack a record given the timestamp of the one before it. Returns the       *
+ * packed length or 0 if the time step is too big to pack.                   *
+ *****************************************************************************/
 
-/* return the length of the apdu encoded or BACNET_STATUS_ERROR for error or
-   BACNET_STATUS_ABORT for abort message */
-int Trend_Log_Read_Property(
-    BACNET_READ_PROPERTY_DATA * rpdata)
+static int TL_Pack_Record(
+    uint8_t * pBuf,
+    const TL_DATA_REC * pRec,
+    time_t tPrev,
+    uint32_t ulInterval)
 {
-    int apdu_len = 0;   /* return value */
-    int len = 0;        /* apdu len intermediate value */
-    BACNET_BIT_STRING bit_string;
-    BACNET_CHARACTER_STRING char_string;
-    TL_LOG_INFO *CurrentLog;
-    uint8_t *apdu = NULL;
+    long lDelta;
+    uint8_t ucBits;
+    int iLen = 0;
 
-    if ((rpdata == NULL) || (rpdata->application_data == NULL) ||
-        (rpdata->application_data_len == 0)) {
+    lDelta = (long) (pRec->tTimeStamp - (tPrev + (time_t) ulInterval));
+    if ((lDelta > TL_MAX_TIME_DELTA) || (lDelta < -TL_MAX_TIME_DELTA)) {
         return 0;
     }
-    apdu = rpdata->application_data;
-    CurrentLog = &LogInfo[Trend_Log_Instance_To_Index(rpdata->object_instance)];        /* Pin down which log to look at */
-    switch (rpdata->object_property) {
-        case PROP_OBJECT_IDENTIFIER:
-            apdu_len =
-                encode_application_object_id(&apdu[0], OBJECT_TRENDLOG,
-                rpdata->object_instance);
+    pBuf[iLen++] = (pRec->ucRecType & 0x0F) | ((pRec->ucStatus & 0x0F) << 4);
+    iLen +=
+        TL_Varint_Encode(&pBuf[iLen],
+        (TL_Zigzag_Encode((int32_t) lDelta) << 1) |
+        ((pRec->ucStatus & 128) ? 1 : 0));
+    switch (pRec->ucRecType) {
+        case TL_TYPE_STATUS:
+            pBuf[iLen++] = pRec->Datum.ucLogStatus;
             break;
-
-        case PROP_DESCRIPTION:
-        case PROP_OBJECT_NAME:
-            Trend_Log_Object_Name(rpdata->object_instance, &char_string);
-            apdu_len =
-                encode_application_character_string(&apdu[0], &char_string);
+        case TL_TYPE_BOOL:
+            pBuf[iLen++] = pRec->Datum.ucBoolean;
             break;
-
-        case PROP_OBJECT_TYPE:
-            apdu_len =
-                encode_application_enumerated(&apdu[0], OBJECT_TRENDLOG);
+        case TL_TYPE_REAL:
+            memcpy(&pBuf[iLen], &pRec->Datum.fReal, 4);
+            iLen += 4;
             break;
-
-        case PROP_ENABLE:
-            apdu_len =
-                encode_application_boolean(&apdu[0], CurrentLog->bEnable);
+        case TL_TYPE_DELTA:
+            memcpy(&pBuf[iLen], &pRec->Datum.fTime, 4);
+            iLen += 4;
             break;
-
-        case PROP_STOP_WHEN_FULL:
-            apdu_len =
-                encode_application_boolean(&apdu[0],
-                CurrentLog->bStopWhenFull);
+        case TL_TYPE_ENUM:
+            iLen += TL_Varint_Encode(&pBuf[iLen], pRec->Datum.ulEnum);
             break;
-
-        case PROP_BUFFER_SIZE:
-            apdu_len = encode_application_unsigned(&apdu[0], TL_MAX_ENTRIES);
+        case TL_TYPE_UNSIGN:
+            iLen += TL_Varint_Encode(&pBuf[iLen], pRec->Datum.ulUValue);
             break;
-
-        case PROP_LOG_BUFFER:
-            /* You can only read the buffer via the ReadRange service */
-            rpdata->error_class = ERROR_CLASS_PROPERTY;
-            rpdata->error_code = ERROR_CODE_READ_ACCESS_DENIED;
-            apdu_len = BACNET_STATUS_ERROR;
+        case TL_TYPE_SIGN:
+            iLen +=
+                TL_Varint_Encode(&pBuf[iLen],
+                TL_Zigzag_Encode(pRec->Datum.lSValue));
             break;
-
-        case PROP_RECORD_COUNT:
-            apdu_len +=
-                encode_application_unsigned(&apdu[0],
-                CurrentLog->ulRecordCount);
+        case TL_TYPE_BITS:
+            ucBits = (pRec->Datum.Bits.ucLen >> 4) & 0x0F;
+            if (ucBits > 4) {
+                ucBits = 4;
+            }
+            pBuf[iLen++] = (ucBits << 4) | (pRec->Datum.Bits.ucLen & 0x0F);
+            memcpy(&pBuf[iLen], pRec->Datum.Bits.ucStore, ucBits);
+            iLen += ucBits;
             break;
-
-        case PROP_TOTAL_RECORD_COUNT:
-            apdu_len +=
-                encode_application_unsigned(&apdu[0],
-                CurrentLog->ulTotalRecordCount);
+        case TL_TYPE_ERROR:
+            iLen += TL_Varint_Encode(&pBuf[iLen], pRec->Datum.Error.usClass);
+            iLen += TL_Varint_Encode(&pBuf[iLen], pRec->Datum.Error.usCode);
             break;
-
-        case PROP_EVENT_STATE:
-            /* note: see the details in the standard on how to use this */
-            apdu_len =
-                encode_application_enumerated(&apdu[0], EVENT_STATE_NORMAL);
+        default:
+            /* NULL and ANY have no datum */
             break;
+    }
 
-        case PROP_LOGGING_TYPE:
-            apdu_len =
-                encode_application_enumerated(&apdu[0],
-                CurrentLog->LoggingType);
-            break;
+    return iLen;
+}
 
-        case PROP_STATUS_FLAGS:
-            /* note: see the details in the standard on how to use these */
-            bitstring_init(&bit_string);
-            bitstring_set_bit(&bit_string, STATUS_FLAG_IN_ALARM, false);
-            bitstring_set_bit(&bit_string, STATUS_FLAG_FAULT, false);
-            bitstring_set_bit(&bit_string, STATUS_FLAG_OVERRIDDEN, false);
-            bitstring_set_bit(&bit_string, STATUS_FLAG_OUT_OF_SERVICE, false);
-            apdu_len = encode_application_bitstring(&apdu[0], &bit_string);
-            break;
+static int TL_Unpack_Record(
+    const uint8_t * pBuf,
+    TL_DATA_REC * pRec,
+    time_t tPrev,
+    uint32_t ulInterval)
+{
+    uint32_t ulValue;
+    uint8_t ucBits;
+    int iLen = 0;
 
-        case PROP_START_TIME:
-            len =
-                encode_application_date(&apdu[0], &CurrentLog->StartTime.date);
-            apdu_len = len;
-            len =
-                encode_application_time(&apdu[apdu_len],
-                &CurrentLog->StartTime.time);
-            apdu_len += len;
+    memset(pRec, 0, sizeof(TL_DATA_REC));
+    pRec->ucRecType = pBuf[iLen] & 0x0F;
+    pRec->ucStatus = (pBuf[iLen++] >> 4) & 0x0F;
+    iLen += TL_Varint_Decode(&pBuf[iLen], &ulValue);
+    if (ulValue & 1) {
+        pRec->ucStatus |= 128;
+    }
+    pRec->tTimeStamp =
+        tPrev + (time_t) ulInterval + TL_Zigzag_Decode(ulValue >> 1);
+    switch (pRec->ucRecType) {
+        case TL_TYPE_STATUS:
+            pRec->Datum.ucLogStatus = pBuf[iLen++];
             break;
-
-        case PROP_STOP_TIME:
-            len =
-                encode_application_date(&apdu[0], &CurrentLog->StopTime.date);
-            apdu_len = len;
-            len =
-                encode_application_time(&apdu[apdu_len],
-                &CurrentLog->StopTime.time);
-            apdu_len += len;
+        case TL_TYPE_BOOL:
+            pRec->Datum.ucBoolean = pBuf[iLen++];
             break;
-
-        case PROP_LOG_DEVICE_OBJECT_PROPERTY:
-            /*
-             * BACnetDeviceObjectPropertyReference ::= SEQUENCE {
-             *     objectIdentifier   [0] BACnetObjectIdentifier,
-             *     propertyIdentifier [1] BACnetPropertyIdentifier,
-             *     propertyArrayIndex [2] Unsigned OPTIONAL, -- used only with array datatype
-             *                                               -- if omitted with an array then
-             *                                               -- the entire array is referenced
-             *     deviceIdentifier   [3] BACnetObjectIdentifier OPTIONAL
-             * }
-             */
-            apdu_len +=
-                bacapp_encode_device_obj_property_ref(&apdu[0],
-                &CurrentLog->Source);
+        case TL_TYPE_REAL:
+            memcpy(&pRec->Datum.fReal, &pBuf[iLen], 4);
+            iLen += 4;
             break;
-
-        case PROP_LOG_INTERVAL:
-            /* We only log to 1 sec accuracy so must multiply by 100 before passing it on */
-            apdu_len +=
-                encode_application_unsigned(&apdu[0],
-                CurrentLog->ulLogInterval * 100);
+        case TL_TYPE_DELTA:
+            memcpy(&pRec->Datum.fTime, &pBuf[iLen], 4);
+            iLen += 4;
             break;
-
-        case PROP_ALIGN_INTERVALS:
-            apdu_len =
-                encode_application_boolean(&apdu[0],
-                CurrentLog->bAlignIntervals);
+        case TL_TYPE_ENUM:
+            iLen += TL_Varint_Decode(&pBuf[iLen], &pRec->Datum.ulEnum);
             break;
-
-        case PROP_INTERVAL_OFFSET:
-            /* We only log to 1 sec accuracy so must multiply by 100 before passing it on */
-            apdu_len +=
-                encode_application_unsigned(&apdu[0],
-                CurrentLog->ulIntervalOffset * 100);
+        case TL_TYPE_UNSIGN:
+            iLen += TL_Varint_Decode(&pBuf[iLen], &pRec->Datum.ulUValue);
             break;
-
-        case PROP_TRIGGER:
-            apdu_len =
-                encode_application_boolean(&apdu[0], CurrentLog->bTrigger);
+        case TL_TYPE_SIGN:
+            iLen += TL_Varint_Decode(&pBuf[iLen], &ulValue);
+            pRec->Datum.lSValue = TL_Zigzag_Decode(ulValue);
+            break;
+        case TL_TYPE_BITS:
+            pRec->Datum.Bits.ucLen = pBuf[iLen++];
+            ucBits = (pRec->Datum.Bits.ucLen >> 4) & 0x0F;
+            memcpy(pRec->Datum.Bits.ucStore, &pBuf[iLen], ucBits);
+            iLen += ucBits;
+            break;
+        case TL_TYPE_ERROR:
+            iLen += TL_Varint_Decode(&pBuf[iLen], &ulValue);
+            pRec->Datum.Error.usClass = (uint16_t) ulValue;
+            iLen += TL_Varint_Decode(&pBuf[iLen], &ulValue);
+            pRec->Datum.Error.usCode = (uint16_t) ulValue;
+            break;
+        default:
+            break;
+    }
+
+    return iLen;
+}
+
+/*****************************************************************************
+ * Simple Fletcher style sum which is plenty to spot a torn metadata write   *
+ *****************************************************************************/
+
+static uint32_t TL_Meta_Checksum(
+    const TL_FILE_META * pMeta)
+{
+    const uint8_t *pData = (const uint8_t *) pMeta;
+    uint32_t ulSum1 = 0xFFFF;
+    uint32_t ulSum2 = 0xFFFF;
+    size_t i;
+
+    for (i = 0; i < offsetof(TL_FILE_META, ulChecksum); i++) {
+        ulSum1 = (ulSum1 + pData[i]) % 65535;
+        ulSum2 = (ulSum2 + ulSum1) % 65535;
+    }
+
+    return (ulSum2 << 16) | ulSum1;
+}
+
+static bool TL_Meta_Valid(
+    const TL_FILE_HEADER * pHeader,
+    int iSlot)
+{
+    const TL_FILE_META *pMeta = &pHeader->Meta[iSlot];
+
+    return (pMeta->ulChecksum == TL_Meta_Checksum(pMeta)) &&
+        (pMeta->ulHead < pHeader->ulBlockCount) &&
+        (pMeta->ulTail < pHeader->ulBlockCount) &&
+        (pMeta->ulTailUsed <= TL_BLOCK_DATA_SIZE) &&
+        (pMeta->ulRecordCount <= pHeader->ulBufferSize);
+}
+
+/*****************************************************************************
+ * Record the ring position and counts for a file backed log. The slot not   *
+ * holding the last commit is overwritten so one is always valid.            *
+ *****************************************************************************/
+
+static void TL_Storage_Commit(
+    int iLog)
+{
+    TL_STORE *pStore = &Log_Store[iLog];
+    TL_LOG_INFO *CurrentLog = &LogInfo[iLog];
+    TL_FILE_META *pMeta;
+    TL_BLOCK_HEADER *pTail;
+    uint32_t ulGeneration;
+
+    if (pStore->pHeader == NULL) {
+        return;
+    }
+    pTail = TL_Block(pStore, pStore->ulTail);
+    ulGeneration = pStore->pHeader->Meta[pStore->iSlot].ulGeneration + 1;
+    pStore->iSlot ^= 1;
+    pMeta = &pStore->pHeader->Meta[pStore->iSlot];
+    pMeta->ulGeneration = ulGeneration;
+    pMeta->ulHead = pStore->ulHead;
+    pMeta->ulTail = pStore->ulTail;
+    pMeta->ulHeadSkip = TL_Block(pStore, pStore->ulHead)->usSkip;
+    pMeta->ulTailCount = pTail->usCount;
+    pMeta->ulTailUsed = pTail->usUsed;
+    pMeta->ulRecordCount = CurrentLog->ulRecordCount;
+    pMeta->ulTotalRecordCount = CurrentLog->ulTotalRecordCount;
+    pMeta->ulChecksum = TL_Meta_Checksum(pMeta);
+#if TL_MMAP_STORAGE
+    /* Start write back of the header page, we don't wait for it */
+    msync(pStore->pHeader, TL_FILE_HEADER_SIZE, MS_ASYNC);
+#endif
+}
+
+/*****************************************************************************
+ * Empty the ring. The total record count (and so the sequence numbers)     *
+ * carries on from where it was.                                             *
+ *****************************************************************************/
+
+static void TL_Storage_Purge(
+    int iLog)
+{
+    TL_STORE *pStore = &Log_Store[iLog];
+
+    LogInfo[iLog].ulRecordCount = 0;
+    pStore->bReadValid = false;
+    if (pStore->pBlocks == NULL) {
+        return;
+    }
+    pStore->ulHead = 0;
+    pStore->ulTail = 0;
+    memset(TL_Block(pStore, 0), 0, sizeof(TL_BLOCK_HEADER));
+    TL_Storage_Commit(iLog);
+}
+
+static void TL_Storage_Close(
+    int iLog)
+{
+    TL_STORE *pStore = &Log_Store[iLog];
+
+    if (pStore->pHeader != NULL) {
+#if TL_MMAP_STORAGE
+        msync(pStore->pHeader, pStore->MapSize, MS_SYNC);
+        munmap(pStore->pHeader, pStore->MapSize);
+#endif
+    } else {
+        free(pStore->pBlocks);
+    }
+    memset(pStore, 0, sizeof(TL_STORE));
+}
+
+/* Blocks needed for a log of ulBufferSize records packed as badly as they
+ * can be, plus one so that a part used head block doesn't eat into the
+ * capacity */
+static uint32_t TL_Storage_Blocks(
+    uint32_t ulBufferSize)
+{
+    const uint32_t ulPerBlock = TL_BLOCK_DATA_SIZE / TL_PACKED_RECORD_MAX;
+    uint32_t ulBlocks;
+
+    ulBlocks = ((ulBufferSize + ulPerBlock - 1) / ulPerBlock) + 1;
+
+    return (ulBlocks < 2) ? 2 : ulBlocks;
+}
+
+#if TL_MMAP_STORAGE
+/*****************************************************************************
+ * Map the buffer file for a log. If bResume is true and the file holds a    *
+ * log we made earlier then its size and history are adopted, otherwise the *
+ * file is (re)created empty with room for ulBufferSize records.             *
+ *****************************************************************************/
+
+static bool TL_Storage_Map(
+    int iLog,
+    uint32_t ulBufferSize,
+    bool bResume)
+{
+    TL_STORE *pStore = &Log_Store[iLog];
+    TL_LOG_INFO *CurrentLog = &LogInfo[iLog];
+    TL_FILE_HEADER Header;
+    TL_FILE_META *pMeta = NULL;
+    TL_BLOCK_HEADER *pBlock;
+    TL_DATA_REC TempRec;
+    char FileName[sizeof(Storage_Path) + 16];
+    struct stat FileStat;
+    uint32_t ulInstance;
+    uint32_t ulBlockCount;
+    uint16_t usRecord;
+    int iOffset;
+    size_t MapSize;
+    void *pMap;
+    int fd;
+
+    ulInstance = Trend_Log_Index_To_Instance(iLog);
+    snprintf(FileName, sizeof(FileName), "%s/tl%u.dat", Storage_Path,
+        (unsigned) ulInstance);
+    fd = open(FileName, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (bResume && (fstat(fd, &FileStat) == 0) &&
+        (pread(fd, &Header, sizeof(Header), 0) == sizeof(Header)) &&
+        (Header.ulMagic == TL_FILE_MAGIC) &&
+        (Header.usVersion == TL_FILE_VERSION) &&
+        (Header.usBlockSize == TL_BLOCK_SIZE) &&
+        (Header.ulInstance == ulInstance) && (Header.ulBufferSize != 0) &&
+        (Header.ulBlockCount >= 2) &&
+        ((size_t) FileStat.st_size ==
+            TL_FILE_HEADER_SIZE +
+            (size_t) Header.ulBlockCount * TL_BLOCK_SIZE)) {
+        ulBufferSize = Header.ulBufferSize;
+        ulBlockCount = Header.ulBlockCount;
+    } else {
+        bResume = false;
+        ulBlockCount = TL_Storage_Blocks(ulBufferSize);
+    }
+    MapSize = TL_FILE_HEADER_SIZE + (size_t) ulBlockCount * TL_BLOCK_SIZE;
+    /* Truncating to zero first gives us a clean (sparse) file */
+    if (!bResume && ((ftruncate(fd, 0) != 0) ||
+            (ftruncate(fd, (off_t) MapSize) != 0))) {
+        close(fd);
+        return false;
+    }
+    pMap =
+        mmap(NULL, MapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);  /* the mapping keeps its own reference */
+    if (pMap == MAP_FAILED) {
+        return false;
+    }
+
+    pStore->pHeader = (TL_FILE_HEADER *) pMap;
+    pStore->pBlocks = (uint8_t *) pMap + TL_FILE_HEADER_SIZE;
+    pStore->ulBlockCount = ulBlockCount;
+    pStore->MapSize = MapSize;
+    CurrentLog->ulBufferSize = ulBufferSize;
+    if (bResume) {
+        /* Pick up from the newest slot that survived */
+        if (TL_Meta_Valid(pStore->pHeader, 0) &&
+            TL_Meta_Valid(pStore->pHeader, 1)) {
+            pStore->iSlot = ((int32_t) (pStore->pHeader->Meta[1].ulGeneration -
+                    pStore->pHeader->Meta[0].ulGeneration) > 0) ? 1 : 0;
+            pMeta = &pStore->pHeader->Meta[pStore->iSlot];
+        } else if (TL_Meta_Valid(pStore->pHeader, 0)) {
+            pStore->iSlot = 0;
+            pMeta = &pStore->pHeader->Meta[0];
+        } else if (TL_Meta_Valid(pStore->pHeader, 1)) {
+            pStore->iSlot = 1;
+            pMeta = &pStore->pHeader->Meta[1];
+        }
+    }
+    if (pMeta != NULL) {
+        /* The committed view of the head and tail blocks wins over
+         * whatever made it into the blocks themselves */
+        pStore->ulHead = pMeta->ulHead;
+        pStore->ulTail = pMeta->ulTail;
+        pBlock = TL_Block(pStore, pStore->ulTail);
+        pBlock->usCount = (uint16_t) pMeta->ulTailCount;
+        pBlock->usUsed = (uint16_t) pMeta->ulTailUsed;
+        TL_Block(pStore, pStore->ulHead)->usSkip =
+            (uint16_t) pMeta->ulHeadSkip;
+        CurrentLog->ulRecordCount = pMeta->ulRecordCount;
+        CurrentLog->ulTotalRecordCount = pMeta->ulTotalRecordCount;
+        /* Find the newest timestamp to carry on the time deltas from */
+        pStore->tTailLast = pBlock->tFirst - (time_t) pBlock->ulInterval;
+        iOffset = 0;
+        for (usRecord = 0; usRecord < pBlock->usCount; usRecord++) {
+            iOffset +=
+                TL_Unpack_Record(&TL_Block_Data(pBlock)[iOffset], &TempRec,
+                pStore->tTailLast, pBlock->ulInterval);
+            pStore->tTailLast = TempRec.tTimeStamp;
+        }
+    } else {
+        memset(pStore->pHeader, 0, TL_FILE_HEADER_SIZE);
+        pStore->pHeader->ulMagic = TL_FILE_MAGIC;
+        pStore->pHeader->usVersion = TL_FILE_VERSION;
+        pStore->pHeader->usBlockSize = TL_BLOCK_SIZE;
+        pStore->pHeader->ulBlockCount = ulBlockCount;
+        pStore->pHeader->ulBufferSize = ulBufferSize;
+        pStore->pHeader->ulInstance = ulInstance;
+        pStore->iSlot = 1;
+        TL_Storage_Commit(iLog);
+    }
+
+    return true;
+}
+#endif
+
+/*****************************************************************************
+ * Set up the record buffer for a log, file backed if a storage path is set  *
+ * and heap backed otherwise. Any previous buffer for the log is released.   *
+ *****************************************************************************/
+
+static bool TL_Storage_Open(
+    int iLog,
+    uint32_t ulBufferSize,
+    bool bResume)
+{
+    TL_STORE *pStore = &Log_Store[iLog];
+    TL_LOG_INFO *CurrentLog = &LogInfo[iLog];
+    uint32_t ulBlockCount;
+
+    TL_Storage_Close(iLog);
+    CurrentLog->ulRecordCount = 0;
+    CurrentLog->ulTotalRecordCount = 0;
+    CurrentLog->ulBufferSize = 0;
+    if (ulBufferSize == 0) {
+        return false;
+    }
+#if TL_MMAP_STORAGE
+    if ((Storage_Path[0] != 0) &&
+        TL_Storage_Map(iLog, ulBufferSize, bResume)) {
+        return true;
+    }
+#else
+    (void) bResume;
+#endif
+    ulBlockCount = TL_Storage_Blocks(ulBufferSize);
+    pStore->pBlocks = (uint8_t *) calloc(ulBlockCount, TL_BLOCK_SIZE);
+    if (pStore->pBlocks == NULL) {
+        return false;
+    }
+    pStore->ulBlockCount = ulBlockCount;
+    CurrentLog->ulBufferSize = ulBufferSize;
+
+    return true;
+}
+
+/*****************************************************************************
+ * Fetch a record using its 0 based position counting from the oldest.      *
+ * Returns false (and a NULL record) if there is no such record.             *
+ *****************************************************************************/
+
+static bool TL_Fetch_Record(
+    int iLog,
+    uint32_t ulEntry,
+    TL_DATA_REC * pRec)
+{
+    TL_STORE *pStore = &Log_Store[iLog];
+    TL_BLOCK_HEADER *pBlock;
+    uint32_t ulBase;
+    uint32_t ulTarget;
+    uint32_t ulLow;
+    uint32_t ulHigh;
+    uint32_t ulMid;
+    uint32_t ulBlock;
+    uint16_t usRecord;
+
+    if ((pStore->pBlocks == NULL) ||
+        (ulEntry >= LogInfo[iLog].ulRecordCount)) {
+        memset(pRec, 0, sizeof(TL_DATA_REC));
+        pRec->ucRecType = TL_TYPE_NULL;
+        return false;
+    }
+    /* Work in sequence numbers relative to the head block so the search
+     * is immune to them wrapping */
+    pBlock = TL_Block(pStore, pStore->ulHead);
+    ulBase = pBlock->ulFirstSeq;
+    ulTarget = pBlock->usSkip + ulEntry;
+    ulLow = 0;
+    ulHigh =
+        (pStore->ulTail + pStore->ulBlockCount -
+        pStore->ulHead) % pStore->ulBlockCount;
+    while (ulLow < ulHigh) {
+        ulMid = (ulLow + ulHigh + 1) / 2;
+        pBlock =
+            TL_Block(pStore, (pStore->ulHead + ulMid) % pStore->ulBlockCount);
+        if ((pBlock->ulFirstSeq - ulBase) <= ulTarget) {
+            ulLow = ulMid;
+        } else {
+            ulHigh = ulMid - 1;
+        }
+    }
+    ulBlock = (pStore->ulHead + ulLow) % pStore->ulBlockCount;
+    pBlock = TL_Block(pStore, ulBlock);
+    usRecord = (uint16_t) (ulTarget - (pBlock->ulFirstSeq - ulBase));
+
+    /* Carry on from the last read if we can, otherwise start the block */
+    if (!pStore->bReadValid || (pStore->ulReadBlock != ulBlock) ||
+        (pStore->usReadRecord > usRecord)) {
+        pStore->bReadValid = true;
+        pStore->ulReadBlock = ulBlock;
+        pStore->usReadRecord = 0;
+        pStore->usReadOffset = 0;
+        pStore->tReadPrev = pBlock->tFirst - (time_t) pBlock->ulInterval;
+    }
+    do {
+        pStore->usReadOffset +=
+            TL_Unpack_Record(&TL_Block_Data(pBlock)[pStore->usReadOffset],
+            pRec, pStore->tReadPrev, pBlock->ulInterval);
+        pStore->tReadPrev = pRec->tTimeStamp;
+    } while ((pStore->usReadRecord++ < usRecord) &&
+        (pStore->usReadRecord < pBlock->usCount));
+
+    return true;
+}
+
+/*****************************************************************************
+ * Push the oldest record out of the log                                     *
+ *****************************************************************************/
+
+static void TL_Drop_Oldest(
+    int iLog)
+{
+    TL_STORE *pStore = &Log_Store[iLog];
+    TL_BLOCK_HEADER *pHead = TL_Block(pStore, pStore->ulHead);
+
+    pHead->usSkip++;
+    if ((pHead->usSkip >= pHead->usCount) &&
+        (pStore->ulHead != pStore->ulTail)) {
+        pStore->ulHead = (pStore->ulHead + 1) % pStore->ulBlockCount;
+    }
+    LogInfo[iLog].ulRecordCount--;
+}
+
+/*****************************************************************************
+ * A log is full once it holds Buffer_Size records, or when the next record  *
+ * could need a fresh block and the only one left is the head block, which   *
+ * would push out a block's worth of records rather than just the oldest.    *
+ *****************************************************************************/
+
+static bool TL_Is_Full(
+    int iLog)
+{
+    TL_STORE *pStore = &Log_Store[iLog];
+    TL_LOG_INFO *CurrentLog = &LogInfo[iLog];
+    TL_BLOCK_HEADER *pTail;
+
+    if (pStore->pBlocks == NULL) {
+        return false;
+    }
+    if (CurrentLog->ulRecordCount >= CurrentLog->ulBufferSize) {
+        return true;
+    }
+    pTail = TL_Block(pStore, pStore->ulTail);
+    if ((pTail->usCount == 0) ||
+        (((pStore->ulTail + 1) % pStore->ulBlockCount) != pStore->ulHead)) {
+        return false;
+    }
+
+    return (pTail->ulInterval != CurrentLog->ulLogInterval) ||
+        ((size_t) (pTail->usUsed + TL_PACKED_RECORD_MAX) >
+        TL_BLOCK_DATA_SIZE);
+}
+
+/*****************************************************************************
+ * Add a record at the insertion point, pushing out the oldest if full       *
+ *****************************************************************************/
+
+static void TL_Insert_Rec(
+    int iLog,
+    TL_DATA_REC * pRec)
+{
+    TL_STORE *pStore = &Log_Store[iLog];
+    TL_LOG_INFO *CurrentLog = &LogInfo[iLog];
+    TL_BLOCK_HEADER *pBlock;
+    TL_BLOCK_HEADER *pHead;
+    uint8_t Packed[TL_PACKED_RECORD_MAX];
+    uint32_t ulNext;
+    int iLen = 0;
+
+    if (pStore->pBlocks == NULL) {
+        return;
+    }
+    pBlock = TL_Block(pStore, pStore->ulTail);
+    if ((pBlock->usCount != 0) &&
+        (pBlock->ulInterval == CurrentLog->ulLogInterval)) {
+        iLen =
+            TL_Pack_Record(Packed, pRec, pStore->tTailLast,
+            pBlock->ulInterval);
+        if ((size_t) (pBlock->usUsed + iLen) > TL_BLOCK_DATA_SIZE) {
+            iLen = 0;
+        }
+    }
+    if (iLen == 0) {
+        /* Need a fresh block, pushing out the oldest if the ring is full */
+        if (pBlock->usCount != 0) {
+            ulNext = (pStore->ulTail + 1) % pStore->ulBlockCount;
+            if (ulNext == pStore->ulHead) {
+                pHead = TL_Block(pStore, pStore->ulHead);
+                CurrentLog->ulRecordCount -= pHead->usCount - pHead->usSkip;
+                pStore->ulHead = (pStore->ulHead + 1) % pStore->ulBlockCount;
+            }
+            pStore->ulTail = ulNext;
+            pBlock = TL_Block(pStore, ulNext);
+            if (pStore->ulReadBlock == ulNext) {
+                pStore->bReadValid = false;
+            }
+        }
+        memset(pBlock, 0, sizeof(TL_BLOCK_HEADER));
+        pBlock->tFirst = pRec->tTimeStamp;
+        pBlock->ulFirstSeq = CurrentLog->ulTotalRecordCount + 1;
+        pBlock->ulInterval = CurrentLog->ulLogInterval;
+        iLen =
+            TL_Pack_Record(Packed, pRec,
+            pRec->tTimeStamp - (time_t) pBlock->ulInterval,
+            pBlock->ulInterval);
+    }
+    memcpy(&TL_Block_Data(pBlock)[pBlock->usUsed], Packed, iLen);
+    pBlock->usUsed += (uint16_t) iLen;
+    pBlock->usCount++;
+    pStore->tTailLast = pRec->tTimeStamp;
+
+    CurrentLog->ulTotalRecordCount++;
+    CurrentLog->ulRecordCount++;
+    if (CurrentLog->ulRecordCount > CurrentLog->ulBufferSize)
+        TL_Drop_Oldest(iLog);
+
+    TL_Storage_Commit(iLog);
+}
+
+/*
+ * Set the directory used for the memory-mapped log buffer files. Must be
+ * called before Trend_Log_Init() to take effect; NULL or an empty string
+ * keeps the buffers in RAM.
+ */
+void Trend_Log_Storage_Path_Set(
+    const char *path)
+{
+    Storage_Path[0] = 0;
+    if (path) {
+        strncpy(Storage_Path, path, sizeof(Storage_Path) - 1);
+        Storage_Path[sizeof(Storage_Path) - 1] = 0;
+    }
+}
+
+/*
+ * Resize the log buffer for a Trend Log. The current contents are purged.
+ * Returns false if the instance is unknown or the storage could not be set
+ * up, in which case the previous size is kept (but still purged).
+ */
+bool Trend_Log_Buffer_Size_Set(
+    uint32_t object_instance,
+    uint32_t buffer_size)
+{
+    unsigned index;
+    uint32_t ulOldSize;
+
+    index = Trend_Log_Instance_To_Index(object_instance);
+    if ((index >= MAX_TREND_LOGS) || (buffer_size == 0)) {
+        return false;
+    }
+    ulOldSize = LogInfo[index].ulBufferSize;
+    if (TL_Storage_Open(index, buffer_size, false)) {
+        return true;
+    }
+    TL_Storage_Open(index, ulOldSize, false);
+
+    return false;
+}
+
+uint32_t Trend_Log_Buffer_Size(
+    uint32_t object_instance)
+{
+    unsigned index;
+
+    index = Trend_Log_Instance_To_Index(object_instance);
+    if (index >= MAX_TREND_LOGS) {
+        return 0;
+    }
+
+    return LogInfo[index].ulBufferSize;
+}
+
+/*
+ * Things to do when starting up the stack for Trend Logs.
+ * Should be called whenever we reset the device or power it up
+ */
+void Trend_Log_Init(
+    void)
+{
+    static bool initialized = false;
+    int iLog;
+    uint32_t ulEntry;
+    TL_DATA_REC TempRec;
+    struct tm TempTime;
+    time_t tClock;
+
+    if (!initialized) {
+        initialized = true;
+
+        /* initialize all the values */
+
+        for (iLog = 0; iLog < MAX_TREND_LOGS; iLog++) {
+            LogInfo[iLog].bAlignIntervals = true;
+            LogInfo[iLog].bEnable = true;
+            LogInfo[iLog].bStopWhenFull = false;
+            LogInfo[iLog].bTrigger = false;
+            LogInfo[iLog].LoggingType = LOGGING_TYPE_POLLED;
+            LogInfo[iLog].Source.arrayIndex = 0;
+            LogInfo[iLog].ucTimeFlags = 0;
+            LogInfo[iLog].ulIntervalOffset = 0;
+            LogInfo[iLog].ulLogInterval = 900;
+            LogInfo[iLog].ulCOVResubscriptionInterval = 3600;
+            LogInfo[iLog].bCOVSubscribed = false;
+            LogInfo[iLog].tCOVSubscribeTime = 0;
+            LogInfo[iLog].ucInvokeID = 0;
+            LogInfo[iLog].ucRequest = TL_REQ_NONE;
+
+            LogInfo[iLog].Source.deviceIdentifier.instance =
+                Device_Object_Instance_Number();
+            LogInfo[iLog].Source.deviceIdentifier.type = OBJECT_DEVICE;
+            LogInfo[iLog].Source.objectIdentifier.instance = iLog;
+            LogInfo[iLog].Source.objectIdentifier.type = OBJECT_ANALOG_INPUT;
+            LogInfo[iLog].Source.arrayIndex = BACNET_ARRAY_ALL;
+            LogInfo[iLog].Source.propertyIdentifier = PROP_PRESENT_VALUE;
+
+            datetime_set_values(&LogInfo[iLog].StartTime, 2009, 1, 1, 0, 0, 0,
+                0);
+            LogInfo[iLog].tStartTime =
+                TL_BAC_Time_To_Local(&LogInfo[iLog].StartTime);
+            datetime_set_values(&LogInfo[iLog].StopTime, 2020, 12, 22, 23, 59,
+                59, 99);
+            LogInfo[iLog].tStopTime =
+                TL_BAC_Time_To_Local(&LogInfo[iLog].StopTime);
+
+            /* Pick up the buffer left by a previous run if there is one */
+            if (!TL_Storage_Open(iLog, TL_MAX_ENTRIES, true)) {
+                continue;
+            }
+            if (LogInfo[iLog].ulRecordCount != 0) {
+                /* We were logging before the reset or power down so we
+                 * have probably missed some readings - say so in the log.
+                 */
+                LogInfo[iLog].tLastDataTime = time(NULL);
+                TL_Insert_Status_Rec(iLog, LOG_STATUS_LOG_INTERRUPTED, true);
+                continue;
+            }
+            if (Storage_Path[0] != 0) {
+                /* A log that is kept on disk only holds real readings */
+                continue;
+            }
+
+            /* We will just fill new logs with some entries for testing
+             * purposes.
+             */
+            TempTime.tm_year = 109;
+            TempTime.tm_mon = iLog + 1; /* Different month for each log */
+            TempTime.tm_mday = 1;
+            TempTime.tm_hour = 0;
+            TempTime.tm_min = 0;
+            TempTime.tm_sec = 0;
+            tClock = mktime(&TempTime);
+
+            /* Arrange to finish up with 10000 records ever logged */
+            LogInfo[iLog].ulTotalRecordCount =
+                10000 - LogInfo[iLog].ulBufferSize;
+            for (ulEntry = 0; ulEntry < LogInfo[iLog].ulBufferSize;
+                ulEntry++) {
+                memset(&TempRec, 0, sizeof(TL_DATA_REC));
+                TempRec.tTimeStamp = tClock;
+                TempRec.ucRecType = TL_TYPE_REAL;
+                TempRec.Datum.fReal =
+                    (float) (ulEntry + (iLog * LogInfo[iLog].ulBufferSize));
+                /* Put status flags with every second log */
+                if ((iLog & 1) == 0)
+                    TempRec.ucStatus = 128;
+                else
+                    TempRec.ucStatus = 0;
+                TL_Insert_Rec(iLog, &TempRec);
+                tClock += 900;  /* advance 15 minutes */
+            }
+
+            LogInfo[iLog].tLastDataTime = tClock - 900;
+        }
+    }
+
+    return;
+}
+
+
+/*
+ * Note: we use the instance number here and build the name based
+ * on the assumption that there is a 1 to 1 correspondance. If there
+ * is not we need to convert to index before proceeding.
+ */
+bool Trend_Log_Object_Name(
+    uint32_t object_instance,
+    BACNET_CHARACTER_STRING * object_name)
+{
+    static BACNET_THREAD_LOCAL char text_string[32] = "";
+    bool status = false;
+
+    if (object_instance < MAX_TREND_LOGS) {
+        sprintf(text_string, "Trend Log %u", object_instance);
+        status = characterstring_init_ansi(object_name, text_string);
+    }
+
+    return status;
+}
+
+
+/* return the length of the apdu encoded or BACNET_STATUS_ERROR for error or
+   BACNET_STATUS_ABORT for abort message */
+int Trend_Log_Read_Property(
+    BACNET_READ_PROPERTY_DATA * rpdata)
+{
+    int apdu_len = 0;   /* return value */
+    int len = 0;        /* apdu len intermediate value */
+    BACNET_BIT_STRING bit_string;
+    BACNET_CHARACTER_STRING char_string;
+    TL_LOG_INFO *CurrentLog;
+    uint8_t *apdu = NULL;
+
+    if ((rpdata == NULL) || (rpdata->application_data == NULL) ||
+        (rpdata->application_data_len == 0)) {
+        return 0;
+    }
+    apdu = rpdata->application_data;
+    CurrentLog = &LogInfo[Trend_Log_Instance_To_Index(rpdata->object_instance)];        /* Pin down which log to look at */
+    switch (rpdata->object_property) {
+        case PROP_OBJECT_IDENTIFIER:
+            apdu_len =
+                encode_application_object_id(&apdu[0], OBJECT_TRENDLOG,
+                rpdata->object_instance);
+            break;
+
+        case PROP_DESCRIPTION:
+        case PROP_OBJECT_NAME:
+            Trend_Log_Object_Name(rpdata->object_instance, &char_string);
+            apdu_len =
+                encode_application_character_string(&apdu[0], &char_string);
+            break;
+
+        case PROP_OBJECT_TYPE:
+            apdu_len =
+                encode_application_enumerated(&apdu[0], OBJECT_TRENDLOG);
+            break;
+
+        case PROP_ENABLE:
+            apdu_len =
+                encode_application_boolean(&apdu[0], CurrentLog->bEnable);
+            break;
+
+        case PROP_STOP_WHEN_FULL:
+            apdu_len =
+                encode_application_boolean(&apdu[0],
+                CurrentLog->bStopWhenFull);
+            break;
+
+        case PROP_BUFFER_SIZE:
+            apdu_len =
+                encode_application_unsigned(&apdu[0],
+                CurrentLog->ulBufferSize);
+            break;
+
+        case PROP_LOG_BUFFER:
+            /* You can only read the buffer via the ReadRange service */
+            rpdata->error_class = ERROR_CLASS_PROPERTY;
+            rpdata->error_code = ERROR_CODE_READ_ACCESS_DENIED;
+            apdu_len = BACNET_STATUS_ERROR;
+            break;
+
+        case PROP_RECORD_COUNT:
+            apdu_len +=
+                encode_application_unsigned(&apdu[0],
+                CurrentLog->ulRecordCount);
+            break;
+
+        case PROP_TOTAL_RECORD_COUNT:
+            apdu_len +=
+                encode_application_unsigned(&apdu[0],
+                CurrentLog->ulTotalRecordCount);
+            break;
+
+        case PROP_EVENT_STATE:
+            /* note: see the details in the standard on how to use this */
+            apdu_len =
+                encode_application_enumerated(&apdu[0], EVENT_STATE_NORMAL);
+            break;
+
+        case PROP_LOGGING_TYPE:
+            apdu_len =
+                encode_application_enumerated(&apdu[0],
+                CurrentLog->LoggingType);
+            break;
+
+        case PROP_STATUS_FLAGS:
+            /* note: see the details in the standard on how to use these */
+            bitstring_init(&bit_string);
+            bitstring_set_bit(&bit_string, STATUS_FLAG_IN_ALARM, false);
+            bitstring_set_bit(&bit_string, STATUS_FLAG_FAULT, false);
+            bitstring_set_bit(&bit_string, STATUS_FLAG_OVERRIDDEN, false);
+            bitstring_set_bit(&bit_string, STATUS_FLAG_OUT_OF_SERVICE, false);
+            apdu_len = encode_application_bitstring(&apdu[0], &bit_string);
+            break;
+
+        case PROP_START_TIME:
+            len =
+                encode_application_date(&apdu[0], &CurrentLog->StartTime.date);
+            apdu_len = len;
+            len =
+                encode_application_time(&apdu[apdu_len],
+                &CurrentLog->StartTime.time);
+            apdu_len += len;
+            break;
+
+        case PROP_STOP_TIME:
+            len =
+                encode_application_date(&apdu[0], &CurrentLog->StopTime.date);
+            apdu_len = len;
+            len =
+                encode_application_time(&apdu[apdu_len],
+                &CurrentLog->StopTime.time);
+            apdu_len += len;
+            break;
+
+        case PROP_LOG_DEVICE_OBJECT_PROPERTY:
+            /*
+             * BACnetDeviceObjectPropertyReference ::= SEQUENCE {
+             *     objectIdentifier   [0] BACnetObjectIdentifier,
+             *     propertyIdentifier [1] BACnetPropertyIdentifier,
+             *     propertyArrayIndex [2] Unsigned OPTIONAL, -- used only with array datatype
+             *                                               -- if omitted with an array then
+             *                                               -- the entire array is referenced
+             *     deviceIdentifier   [3] BACnetObjectIdentifier OPTIONAL
+             * }
+             */
+            apdu_len +=
+                bacapp_encode_device_obj_property_ref(&apdu[0],
+                &CurrentLog->Source);
+            break;
+
+        case PROP_LOG_INTERVAL:
+            /* We only log to 1 sec accuracy so must multiply by 100 before passing it on */
+            apdu_len +=
+                encode_application_unsigned(&apdu[0],
+                CurrentLog->ulLogInterval * 100);
+            break;
+
+        case PROP_COV_RESUBSCRIPTION_INTERVAL:
+            apdu_len =
+                encode_application_unsigned(&apdu[0],
+                CurrentLog->ulCOVResubscriptionInterval);
+            break;
+
+        case PROP_CLIENT_COV_INCREMENT:
+            /* We use SubscribeCOV so the source's own COV increment applies */
+            apdu_len = encode_application_null(&apdu[0]);
+            break;
+
+        case PROP_ALIGN_INTERVALS:
+            apdu_len =
+                encode_application_boolean(&apdu[0],
+                CurrentLog->bAlignIntervals);
+            break;
+
+        case PROP_INTERVAL_OFFSET:
+            /* We only log to 1 sec accuracy so must multiply by 100 before passing it on */
+            apdu_len +=
+                encode_application_unsigned(&apdu[0],
+                CurrentLog->ulIntervalOffset * 100);
+            break;
+
+        case PROP_TRIGGER:
+            apdu_len =
+                encode_application_boolean(&apdu[0], CurrentLog->bTrigger);
             break;
 
         default:
@@ -488,7 +1377,7 @@ bool Trend_Log_Write_Property(
                 /* Section 12.25.5 can't enable a full log with stop when full set */
                 if ((CurrentLog->bEnable == false) &&
                     (CurrentLog->bStopWhenFull == true) &&
-                    (CurrentLog->ulRecordCount == TL_MAX_ENTRIES) &&
+                    TL_Is_Full(log_index) &&
                     (value.type.Boolean == true)) {
                     status = false;
                     wp_data->error_class = ERROR_CLASS_OBJECT;
@@ -531,7 +1420,7 @@ bool Trend_Log_Write_Property(
                     CurrentLog->bStopWhenFull = value.type.Boolean;
 
                     if ((value.type.Boolean == true) &&
-                        (CurrentLog->ulRecordCount == TL_MAX_ENTRIES) &&
+                        TL_Is_Full(log_index) &&
                         (CurrentLog->bEnable == true)) {
 
                         /* When full log is switched from normal to stop when full
@@ -546,12 +1435,32 @@ bool Trend_Log_Write_Property(
             break;
 
         case PROP_BUFFER_SIZE:
-            /* Fixed size buffer so deny write. If buffer size was writable
-             * we would probably erase the current log, resize, re-initalise
-             * and carry on - however write is not allowed if enable is true.
+            /* Buffer size can only be changed whilst the log is disabled.
+             * The log is erased and re-initalised at the new size.
              */
-            wp_data->error_class = ERROR_CLASS_PROPERTY;
-            wp_data->error_code = ERROR_CODE_WRITE_ACCESS_DENIED;
+            status =
+                WPValidateArgType(&value, BACNET_APPLICATION_TAG_UNSIGNED_INT,
+                &wp_data->error_class, &wp_data->error_code);
+            if (status) {
+                if (CurrentLog->bEnable == true) {
+                    status = false;
+                    wp_data->error_class = ERROR_CLASS_PROPERTY;
+                    wp_data->error_code = ERROR_CODE_WRITE_ACCESS_DENIED;
+                } else if (value.type.Unsigned_Int == 0) {
+                    status = false;
+                    wp_data->error_class = ERROR_CLASS_PROPERTY;
+                    wp_data->error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
+                } else if (value.type.Unsigned_Int != CurrentLog->ulBufferSize) {
+                    if (!Trend_Log_Buffer_Size_Set(wp_data->object_instance,
+                            value.type.Unsigned_Int)) {
+                        status = false;
+                        wp_data->error_class = ERROR_CLASS_RESOURCES;
+                        wp_data->error_code = ERROR_CODE_NO_SPACE_FOR_OBJECT;
+                    }
+                    TL_Insert_Status_Rec(log_index, LOG_STATUS_BUFFER_PURGED,
+                        true);
+                }
+            }
             break;
 
         case PROP_RECORD_COUNT:
@@ -561,8 +1470,7 @@ bool Trend_Log_Write_Property(
             if (status) {
                 if (value.type.Unsigned_Int == 0) {
                     /* Time to clear down the log */
-                    CurrentLog->ulRecordCount = 0;
-                    CurrentLog->iIndex = 0;
+                    TL_Storage_Purge(log_index);
                     TL_Insert_Status_Rec(log_index, LOG_STATUS_BUFFER_PURGED,
                         true);
                 }
@@ -570,31 +1478,26 @@ bool Trend_Log_Write_Property(
             break;
 
         case PROP_LOGGING_TYPE:
-            /* logic
-             * triggered and polled options.
-             */
             status =
                 WPValidateArgType(&value, BACNET_APPLICATION_TAG_ENUMERATED,
                 &wp_data->error_class, &wp_data->error_code);
             if (status) {
-                if (value.type.Enumerated != LOGGING_TYPE_COV) {
-                    CurrentLog->LoggingType = value.type.Enumerated;
-                    if (value.type.Enumerated == LOGGING_TYPE_POLLED) {
-                        /* As per 12.25.27 pick a suitable default if interval is 0 */
-                        if (CurrentLog->ulLogInterval == 0) {
-                            CurrentLog->ulLogInterval = 900;
-                        }
-                    }
-                    if (value.type.Enumerated == LOGGING_TYPE_TRIGGERED) {
-                        /* As per 12.25.27 0 the interval if triggered logging selected */
-                        CurrentLog->ulLogInterval = 0;
-                    }
-                } else {
-                    /* We don't currently support COV */
+                if (value.type.Enumerated > LOGGING_TYPE_TRIGGERED) {
                     status = false;
                     wp_data->error_class = ERROR_CLASS_PROPERTY;
-                    wp_data->error_code =
-                        ERROR_CODE_OPTIONAL_FUNCTIONALITY_NOT_SUPPORTED;
+                    wp_data->error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
+                    break;
+                }
+                CurrentLog->LoggingType = value.type.Enumerated;
+                if (value.type.Enumerated == LOGGING_TYPE_POLLED) {
+                    /* As per 12.25.27 pick a suitable default if interval is 0 */
+                    if (CurrentLog->ulLogInterval == 0) {
+                        CurrentLog->ulLogInterval = 900;
+                    }
+                } else {
+                    /* As per 12.25.27 0 the interval if triggered or COV
+                     * logging selected */
+                    CurrentLog->ulLogInterval = 0;
                 }
             }
             break;
@@ -704,28 +1607,27 @@ bool Trend_Log_Write_Property(
             break;
 
         case PROP_LOG_DEVICE_OBJECT_PROPERTY:
-	        len = bacapp_decode_device_obj_property_ref(wp_data->application_data, &TempSource);
-            if((len < 0) || (len > wp_data->application_data_len)) // Hmm, that didn't go as planned...
-                {
+            len =
+                bacapp_decode_device_obj_property_ref(wp_data->
+                application_data, &TempSource);
+            if ((len < 0) || (len > wp_data->application_data_len)) {
+                /* Hmm, that didn't go as planned... */
                 wp_data->error_class = ERROR_CLASS_PROPERTY;
                 wp_data->error_code = ERROR_CODE_OTHER;
                 break;
-                }
-
-            // We only support references to objects in ourself for now
-            if((TempSource.deviceIdentifier.type == OBJECT_DEVICE) && (TempSource.deviceIdentifier.instance != Device_Object_Instance_Number()))
-                	{
-                    wp_data->error_class = ERROR_CLASS_PROPERTY;
-                    wp_data->error_code = ERROR_CODE_OPTIONAL_FUNCTIONALITY_NOT_SUPPORTED;
-                    break;
-                    }
+            }
 
             /* Quick comparison if structures are packed ... */
             if (memcmp(&TempSource, &CurrentLog->Source,
                     sizeof(BACNET_DEVICE_OBJECT_PROPERTY_REFERENCE)) != 0) {
+                /* Let go of the old source before we forget it */
+                if (CurrentLog->bCOVSubscribed) {
+                    TL_COV_Subscribe(log_index, true);
+                } else {
+                    TL_Forget_Request(log_index);
+                }
                 /* Clear buffer if property being logged is changed */
-                CurrentLog->ulRecordCount = 0;
-                CurrentLog->iIndex = 0;
+                TL_Storage_Purge(log_index);
                 TL_Insert_Status_Rec(log_index, LOG_STATUS_BUFFER_PURGED,
                     true);
             }
@@ -744,23 +1646,31 @@ bool Trend_Log_Write_Property(
                 WPValidateArgType(&value, BACNET_APPLICATION_TAG_UNSIGNED_INT,
                 &wp_data->error_class, &wp_data->error_code);
             if (status) {
-                if ((CurrentLog->LoggingType == LOGGING_TYPE_POLLED) &&
-                    (value.type.Unsigned_Int == 0)) {
-                    /* We don't support COV at the moment so don't allow switching
-                     * to it by clearing interval whilst in polling mode */
-                    wp_data->error_class = ERROR_CLASS_PROPERTY;
-                    wp_data->error_code =
-                        ERROR_CODE_OPTIONAL_FUNCTIONALITY_NOT_SUPPORTED;
-                    status = false;
+                if (value.type.Unsigned_Int == 0) {
+                    /* Clearing the interval switches to COV logging */
+                    CurrentLog->LoggingType = LOGGING_TYPE_COV;
+                    CurrentLog->ulLogInterval = 0;
                 } else {
+                    /* and setting one switches back to polling */
+                    CurrentLog->LoggingType = LOGGING_TYPE_POLLED;
                     /* We only log to 1 sec accuracy so must divide by 100 before passing it on */
                     CurrentLog->ulLogInterval = value.type.Unsigned_Int / 100;
-					if(0 == CurrentLog->ulLogInterval)
-						CurrentLog->ulLogInterval = 1; /* Interval of 0 is not a good idea */
+                    if (0 == CurrentLog->ulLogInterval)
+                        CurrentLog->ulLogInterval = 1;  /* Interval of 0 is not a good idea */
                 }
             }
             break;
 
+        case PROP_COV_RESUBSCRIPTION_INTERVAL:
+            status =
+                WPValidateArgType(&value, BACNET_APPLICATION_TAG_UNSIGNED_INT,
+                &wp_data->error_class, &wp_data->error_code);
+            if (status) {
+                CurrentLog->ulCOVResubscriptionInterval =
+                    value.type.Unsigned_Int;
+            }
+            break;
+
         case PROP_ALIGN_INTERVALS:
             status =
                 WPValidateArgType(&value, BACNET_APPLICATION_TAG_BOOLEAN,
@@ -844,11 +1754,9 @@ void TL_Insert_Status_Rec(
     BACNET_LOG_STATUS eStatus,
     bool bState)
 {
-    TL_LOG_INFO *CurrentLog;
     TL_DATA_REC TempRec;
 
-    CurrentLog = &LogInfo[iLog];
-
+    memset(&TempRec, 0, sizeof(TempRec));       /* no stray bytes in the file */
     TempRec.tTimeStamp = time(NULL);
     TempRec.ucRecType = TL_TYPE_STATUS;
     TempRec.ucStatus = 0;
@@ -871,14 +1779,7 @@ void TL_Insert_Status_Rec(
             break;
     }
 
-    Logs[iLog][CurrentLog->iIndex++] = TempRec;
-    if (CurrentLog->iIndex >= TL_MAX_ENTRIES)
-        CurrentLog->iIndex = 0;
-
-    CurrentLog->ulTotalRecordCount++;
-
-    if (CurrentLog->ulRecordCount < TL_MAX_ENTRIES)
-        CurrentLog->ulRecordCount++;
+    TL_Insert_Rec(iLog, &TempRec);
 }
 
 /*****************************************************************************
@@ -1309,6 +2210,7 @@ int TL_encode_by_time(
     uint32_t uiRemaining = 0;   /* Amount of unused space in packet */
     uint32_t uiFirstSeq = 0;    /* Sequence number for 1st record in log */
     time_t tRefTime = 0;        /* The time from the request in local format */
+    TL_DATA_REC TempRec;
 
     /* See how much space we have */
     uiRemaining = MAX_APDU - pRequest->Overhead;
@@ -1316,11 +2218,6 @@ int TL_encode_by_time(
     CurrentLog = &LogInfo[log_index];
 
     tRefTime = TL_BAC_Time_To_Local(&pRequest->Range.RefTime);
-    /* Find correct position for oldest entry in log */
-    if (CurrentLog->ulRecordCount < TL_MAX_ENTRIES)
-        uiIndex = 0;
-    else
-        uiIndex = CurrentLog->iIndex;
 
     if (pRequest->Count < 0) {
         /* Start at end of log and look for record which has
@@ -1330,8 +2227,8 @@ int TL_encode_by_time(
         /* Start out with the sequence number for the last record */
         uiFirstSeq = CurrentLog->ulTotalRecordCount;
         for (;;) {
-            if (Logs[pRequest->object_instance][(uiIndex +
-                        iCount) % TL_MAX_ENTRIES].tTimeStamp < tRefTime)
+            TL_Fetch_Record(log_index, iCount, &TempRec);
+            if (TempRec.tTimeStamp < tRefTime)
                 break;
 
             uiFirstSeq--;
@@ -1368,8 +2265,8 @@ int TL_encode_by_time(
         uiFirstSeq =
             CurrentLog->ulTotalRecordCount - (CurrentLog->ulRecordCount - 1);
         for (;;) {
-            if (Logs[pRequest->object_instance][(uiIndex +
-                        iCount) % TL_MAX_ENTRIES].tTimeStamp > tRefTime)
+            TL_Fetch_Record(log_index, iCount, &TempRec);
+            if (TempRec.tTimeStamp > tRefTime)
                 break;
 
             uiFirstSeq++;
@@ -1428,19 +2325,14 @@ int TL_encode_entry(
     int iEntry)
 {
     int iLen = 0;
-    TL_DATA_REC *pSource = NULL;
+    TL_DATA_REC Source;
+    TL_DATA_REC *pSource = &Source;
     BACNET_BIT_STRING TempBits;
     uint8_t ucCount = 0;
     BACNET_DATE_TIME TempTime;
 
-    /* Convert from BACnet 1 based to 0 based array index and then
-     * handle wrap around of the circular buffer */
-
-    if (LogInfo[iLog].ulRecordCount < TL_MAX_ENTRIES)
-        pSource = &Logs[iLog][(iEntry - 1) % TL_MAX_ENTRIES];
-    else
-        pSource =
-            &Logs[iLog][(LogInfo[iLog].iIndex + iEntry - 1) % TL_MAX_ENTRIES];
+    /* Convert from BACnet 1 based to 0 based index and unpack it */
+    TL_Fetch_Record(iLog, iEntry - 1, pSource);
 
     iLen = 0;
     /* First stick the time stamp in with tag [0] */
@@ -1587,7 +2479,136 @@ static int local_read_property(
         }
     }
 
-    return (len);
+    return (len);
+}
+
+/****************************************************************************
+ * Store a decoded value (plus optional status flags) in the Trend Log      *
+ ****************************************************************************/
+
+static void TL_Insert_Value_Rec(
+    int iLog,
+    time_t tStamp,
+    BACNET_APPLICATION_DATA_VALUE * value,
+    BACNET_BIT_STRING * status)
+{
+    TL_DATA_REC TempRec;
+    uint8_t ucCount;
+
+    memset(&TempRec, 0, sizeof(TempRec));       /* no stray bytes in the file */
+    TempRec.tTimeStamp = tStamp;
+    switch (value->tag) {
+        case BACNET_APPLICATION_TAG_NULL:
+            TempRec.ucRecType = TL_TYPE_NULL;
+            break;
+#if defined (BACAPP_BOOLEAN)
+        case BACNET_APPLICATION_TAG_BOOLEAN:
+            TempRec.ucRecType = TL_TYPE_BOOL;
+            TempRec.Datum.ucBoolean = value->type.Boolean;
+            break;
+#endif
+#if defined (BACAPP_UNSIGNED)
+        case BACNET_APPLICATION_TAG_UNSIGNED_INT:
+            TempRec.ucRecType = TL_TYPE_UNSIGN;
+            TempRec.Datum.ulUValue = value->type.Unsigned_Int;
+            break;
+#endif
+#if defined (BACAPP_SIGNED)
+        case BACNET_APPLICATION_TAG_SIGNED_INT:
+            TempRec.ucRecType = TL_TYPE_SIGN;
+            TempRec.Datum.lSValue = value->type.Signed_Int;
+            break;
+#endif
+#if defined (BACAPP_REAL)
+        case BACNET_APPLICATION_TAG_REAL:
+            TempRec.ucRecType = TL_TYPE_REAL;
+            TempRec.Datum.fReal = value->type.Real;
+            break;
+#endif
+#if defined (BACAPP_BIT_STRING)
+        case BACNET_APPLICATION_TAG_BIT_STRING:
+            TempRec.ucRecType = TL_TYPE_BITS;
+            /* We truncate any bitstrings at 32 bits to conserve space */
+            if (bitstring_bits_used(&value->type.Bit_String) < 32) {
+                /* Store the bytes used and the bits free in the last byte */
+                TempRec.Datum.Bits.ucLen =
+                    bitstring_bytes_used(&value->type.Bit_String) << 4;
+                TempRec.Datum.Bits.ucLen |=
+                    (8 - (bitstring_bits_used(&value->type.Bit_String) % 8)) & 7;
+                /* Fetch the octets with the bits directly */
+                for (ucCount = 0;
+                    ucCount < bitstring_bytes_used(&value->type.Bit_String);
+                    ucCount++)
+                    TempRec.Datum.Bits.ucStore[ucCount] =
+                        bitstring_octet(&value->type.Bit_String, ucCount);
+            } else {
+                /* We will only use the first 4 octets to save space */
+                TempRec.Datum.Bits.ucLen = 4 << 4;
+                for (ucCount = 0; ucCount < 4; ucCount++)
+                    TempRec.Datum.Bits.ucStore[ucCount] =
+                        bitstring_octet(&value->type.Bit_String, ucCount);
+            }
+            break;
+#endif
+#if defined (BACAPP_ENUMERATED)
+        case BACNET_APPLICATION_TAG_ENUMERATED:
+            TempRec.ucRecType = TL_TYPE_ENUM;
+            TempRec.Datum.ulEnum = value->type.Enumerated;
+            break;
+#endif
+        default:
+            /* Fake an error response for any types we cannot handle */
+            TempRec.Datum.Error.usClass = ERROR_CLASS_PROPERTY;
+            TempRec.Datum.Error.usCode = ERROR_CODE_DATATYPE_NOT_SUPPORTED;
+            TempRec.ucRecType = TL_TYPE_ERROR;
+            break;
+    }
+    /* Finally insert the status flags into the record */
+    if (status != NULL) {
+        TempRec.ucStatus = 128 | bitstring_octet(status, 0);
+    }
+
+    TL_Insert_Rec(iLog, &TempRec);
+}
+
+static void TL_Insert_Error_Rec(
+    int iLog,
+    time_t tStamp,
+    BACNET_ERROR_CLASS error_class,
+    BACNET_ERROR_CODE error_code)
+{
+    TL_DATA_REC TempRec;
+
+    memset(&TempRec, 0, sizeof(TempRec));       /* no stray bytes in the file */
+    TempRec.tTimeStamp = tStamp;
+    TempRec.ucRecType = TL_TYPE_ERROR;
+    TempRec.Datum.Error.usClass = error_class;
+    TempRec.Datum.Error.usCode = error_code;
+
+    TL_Insert_Rec(iLog, &TempRec);
+}
+
+/****************************************************************************
+ * Work out where the logged property lives                                 *
+ ****************************************************************************/
+
+static bool TL_Source_Is_Local(
+    TL_LOG_INFO * CurrentLog)
+{
+    /* A missing device identifier means "this device" */
+    return ((CurrentLog->Source.deviceIdentifier.type != OBJECT_DEVICE) ||
+        (CurrentLog->Source.deviceIdentifier.instance ==
+            Device_Object_Instance_Number()));
+}
+
+static uint32_t TL_Source_Device(
+    TL_LOG_INFO * CurrentLog)
+{
+    if (CurrentLog->Source.deviceIdentifier.type != OBJECT_DEVICE) {
+        return Device_Object_Instance_Number();
+    }
+
+    return CurrentLog->Source.deviceIdentifier.instance;
 }
 
 /****************************************************************************
@@ -1601,116 +2622,331 @@ static void TL_fetch_property(
     uint8_t StatusBuf[3];       /* Should be tag, bits unused in last octet and 1 byte of data */
     BACNET_ERROR_CLASS error_class = ERROR_CLASS_SERVICES;
     BACNET_ERROR_CODE error_code = ERROR_CODE_OTHER;
+    BACNET_APPLICATION_DATA_VALUE value;
+    BACNET_APPLICATION_DATA_VALUE status;
+    BACNET_ADDRESS dest;
+    unsigned max_apdu = 0;
+    uint32_t device_id;
     int iLen;
-    uint8_t ucCount;
     TL_LOG_INFO *CurrentLog;
-    TL_DATA_REC TempRec;
-    uint8_t tag_number = 0;
-    uint32_t len_value_type = 0;
-    BACNET_BIT_STRING TempBits;
 
     CurrentLog = &LogInfo[iLog];
 
-    /* Record the current time in the log entry and also in the info block
-     * for the log so we can figure out when the next reading is due */
-    TempRec.tTimeStamp = time(NULL);
-    CurrentLog->tLastDataTime = TempRec.tTimeStamp;
-    TempRec.ucStatus = 0;
+    /* Record the current time in the info block for the log so we can
+     * figure out when the next reading is due */
+    CurrentLog->tLastDataTime = time(NULL);
+
+    if (!TL_Source_Is_Local(CurrentLog)) {
+        /* Remote source - ask for it and log the answer when it arrives.
+         * Skip this period if the last request is still outstanding. */
+        if (CurrentLog->ucInvokeID != 0) {
+            return;
+        }
+        device_id = TL_Source_Device(CurrentLog);
+        if (!address_bind_request(device_id, &max_apdu, &dest)) {
+            /* Not bound yet - go looking and try again next period */
+            Send_WhoIs(device_id, device_id);
+            TL_Insert_Error_Rec(iLog, CurrentLog->tLastDataTime,
+                ERROR_CLASS_COMMUNICATION, ERROR_CODE_OTHER);
+            return;
+        }
+        CurrentLog->ucInvokeID =
+            Send_Read_Property_Request_Address(&dest, (uint16_t) max_apdu,
+            CurrentLog->Source.objectIdentifier.type,
+            CurrentLog->Source.objectIdentifier.instance,
+            CurrentLog->Source.propertyIdentifier,
+            CurrentLog->Source.arrayIndex);
+        if (CurrentLog->ucInvokeID != 0) {
+            CurrentLog->ucRequest = TL_REQ_READ;
+            tsm_set_completion(CurrentLog->ucInvokeID, TL_Read_Complete,
+                CurrentLog);
+        } else {
+            TL_Insert_Error_Rec(iLog, CurrentLog->tLastDataTime,
+                ERROR_CLASS_RESOURCES, ERROR_CODE_OTHER);
+        }
+        return;
+    }
 
     iLen =
-        local_read_property(ValueBuf, StatusBuf, &LogInfo[iLog].Source,
+        local_read_property(ValueBuf, StatusBuf, &CurrentLog->Source,
         &error_class, &error_code);
     if (iLen < 0) {
         /* Insert error code into log */
-        TempRec.Datum.Error.usClass = error_class;
-        TempRec.Datum.Error.usCode = error_code;
-        TempRec.ucRecType = TL_TYPE_ERROR;
+        TL_Insert_Error_Rec(iLog, CurrentLog->tLastDataTime, error_class,
+            error_code);
     } else {
         /* Decode data returned and see if we can fit it into the log */
-        iLen =
-            decode_tag_number_and_value(ValueBuf, &tag_number,
-            &len_value_type);
-        switch (tag_number) {
-            case BACNET_APPLICATION_TAG_NULL:
-                TempRec.ucRecType = TL_TYPE_NULL;
-                break;
+        memset(&value, 0, sizeof(value));
+        memset(&status, 0, sizeof(status));
+        if (bacapp_decode_application_data(ValueBuf, sizeof(ValueBuf),
+                &value) <= 0) {
+            value.tag = MAX_BACNET_APPLICATION_TAG;
+        }
+        bacapp_decode_application_data(StatusBuf, sizeof(StatusBuf),
+            &status);
+        TL_Insert_Value_Rec(iLog, CurrentLog->tLastDataTime, &value,
+            &status.type.Bit_String);
+    }
+}
 
-            case BACNET_APPLICATION_TAG_BOOLEAN:
-                TempRec.ucRecType = TL_TYPE_BOOL;
-                TempRec.Datum.ucBoolean = decode_boolean(len_value_type);
-                break;
+/****************************************************************************
+ * Stop waiting for an outstanding request to a remote source. The invoke   *
+ * ID goes back to the TSM so that it is not held until it times out, and a *
+ * late answer no longer matches the log.                                   *
+ ****************************************************************************/
 
-            case BACNET_APPLICATION_TAG_UNSIGNED_INT:
-                TempRec.ucRecType = TL_TYPE_UNSIGN;
-                decode_unsigned(&ValueBuf[iLen], len_value_type,
-                    &TempRec.Datum.ulUValue);
-                break;
+static void TL_Forget_Request(
+    int iLog)
+{
+    TL_LOG_INFO *CurrentLog = &LogInfo[iLog];
 
-            case BACNET_APPLICATION_TAG_SIGNED_INT:
-                TempRec.ucRecType = TL_TYPE_SIGN;
-                decode_signed(&ValueBuf[iLen], len_value_type,
-                    &TempRec.Datum.lSValue);
-                break;
+    if (CurrentLog->ucInvokeID != 0) {
+        tsm_free_invoke_id(CurrentLog->ucInvokeID);
+    }
+    CurrentLog->ucInvokeID = 0;
+    CurrentLog->ucRequest = TL_REQ_NONE;
+}
 
-            case BACNET_APPLICATION_TAG_REAL:
-                TempRec.ucRecType = TL_TYPE_REAL;
-                decode_real_safe(&ValueBuf[iLen], len_value_type,
-                    &TempRec.Datum.fReal);
-                break;
+/****************************************************************************
+ * A request to a remote source did not get the answer we wanted            *
+ ****************************************************************************/
 
-            case BACNET_APPLICATION_TAG_BIT_STRING:
-                TempRec.ucRecType = TL_TYPE_BITS;
-                decode_bitstring(&ValueBuf[iLen], len_value_type, &TempBits);
-                /* We truncate any bitstrings at 32 bits to conserve space */
-                if (bitstring_bits_used(&TempBits) < 32) {
-                    /* Store the bytes used and the bits free in the last byte */
-                    TempRec.Datum.Bits.ucLen =
-                        bitstring_bytes_used(&TempBits) << 4;
-                    TempRec.Datum.Bits.ucLen |=
-                        (8 - (bitstring_bits_used(&TempBits) % 8)) & 7;
-                    /* Fetch the octets with the bits directly */
-                    for (ucCount = 0;
-                        ucCount < bitstring_bytes_used(&TempBits); ucCount++)
-                        TempRec.Datum.Bits.ucStore[ucCount] =
-                            bitstring_octet(&TempBits, ucCount);
-                } else {
-                    /* We will only use the first 4 octets to save space */
-                    TempRec.Datum.Bits.ucLen = 4 << 4;
-                    for (ucCount = 0; ucCount < 4; ucCount++)
-                        TempRec.Datum.Bits.ucStore[ucCount] =
-                            bitstring_octet(&TempBits, ucCount);
-                }
-                break;
+static void TL_Request_Failed(
+    int iLog,
+    BACNET_ERROR_CLASS error_class,
+    BACNET_ERROR_CODE error_code)
+{
+    TL_LOG_INFO *CurrentLog = &LogInfo[iLog];
 
-            case BACNET_APPLICATION_TAG_ENUMERATED:
-                TempRec.ucRecType = TL_TYPE_ENUM;
-                decode_enumerated(&ValueBuf[iLen], len_value_type,
-                    &TempRec.Datum.ulEnum);
-                break;
+    switch (CurrentLog->ucRequest) {
+        case TL_REQ_READ:
+            TL_Insert_Error_Rec(iLog, CurrentLog->tLastDataTime, error_class,
+                error_code);
+            break;
+        case TL_REQ_SUBSCRIBE:
+            CurrentLog->bCOVSubscribed = false;
+            TL_Insert_Error_Rec(iLog, time(NULL), error_class, error_code);
+            break;
+        default:
+            /* Nothing useful to do about a failed cancellation */
+            break;
+    }
+    CurrentLog->ucInvokeID = 0;
+    CurrentLog->ucRequest = TL_REQ_NONE;
+}
 
-            default:
-                /* Fake an error response for any types we cannot handle */
-                TempRec.Datum.Error.usClass = ERROR_CLASS_PROPERTY;
-                TempRec.Datum.Error.usCode = ERROR_CODE_DATATYPE_NOT_SUPPORTED;
-                TempRec.ucRecType = TL_TYPE_ERROR;
-                break;
+/****************************************************************************
+ * Log a reply from the TSM that was not the answer we wanted               *
+ ****************************************************************************/
+
+static void TL_Reply_Failed(
+    int iLog,
+    BACNET_TSM_REPLY * reply)
+{
+    switch (reply->result) {
+        case TSM_RESULT_ERROR:
+            TL_Request_Failed(iLog, reply->error_class, reply->error_code);
+            break;
+        case TSM_RESULT_REJECT:
+            TL_Request_Failed(iLog, ERROR_CLASS_COMMUNICATION,
+                ERROR_CODE_REJECT_OTHER);
+            break;
+        case TSM_RESULT_TIMEOUT:
+            TL_Request_Failed(iLog, ERROR_CLASS_COMMUNICATION,
+                ERROR_CODE_TIMEOUT);
+            break;
+        default:
+            TL_Request_Failed(iLog, ERROR_CLASS_COMMUNICATION,
+                ERROR_CODE_ABORT_OTHER);
+            break;
+    }
+}
+
+/****************************************************************************
+ * The TSM passes the outcome of a ReadProperty request here, and the value *
+ * in an ACK is logged with the time the request was made. Worker threads   *
+ * may be reading the logs, so they are locked while the reply is logged.  *
+ ****************************************************************************/
+
+static void TL_Read_Complete(
+    BACNET_TSM_REPLY * reply,
+    void *context)
+{
+    TL_LOG_INFO *CurrentLog = (TL_LOG_INFO *) context;
+    int iLog = (int) (CurrentLog - LogInfo);
+    BACNET_READ_PROPERTY_DATA rp_data;
+    BACNET_APPLICATION_DATA_VALUE value;
+    int len;
+
+    if (!Device_Objects_Lock(OBJECT_TRENDLOG, true)) {
+        return;
+    }
+    if ((CurrentLog->ucInvokeID != reply->invoke_id) ||
+        (CurrentLog->ucRequest != TL_REQ_READ)) {
+        /* A request we have since given up on */
+    } else if (reply->result != TSM_RESULT_ACK) {
+        TL_Reply_Failed(iLog, reply);
+    } else {
+        CurrentLog->ucInvokeID = 0;
+        CurrentLog->ucRequest = TL_REQ_NONE;
+        len =
+            rp_ack_decode_service_request(reply->service_data,
+            reply->service_data_len, &rp_data);
+        memset(&value, 0, sizeof(value));
+        if ((len <= 0) ||
+            (bacapp_decode_application_data(rp_data.application_data,
+                    (unsigned) rp_data.application_data_len, &value) <= 0)) {
+            value.tag = MAX_BACNET_APPLICATION_TAG;
         }
-        /* Finally insert the status flags into the record */
-        iLen =
-            decode_tag_number_and_value(StatusBuf, &tag_number,
-            &len_value_type);
-        decode_bitstring(&StatusBuf[iLen], len_value_type, &TempBits);
-        TempRec.ucStatus = 128 | bitstring_octet(&TempBits, 0);
+        /* Remote reads don't fetch the status flags */
+        TL_Insert_Value_Rec(iLog, CurrentLog->tLastDataTime, &value, NULL);
+    }
+    Device_Objects_Unlock(OBJECT_TRENDLOG);
+}
+
+/****************************************************************************
+ * The TSM passes the outcome of a SubscribeCOV request here, so a Simple   *
+ * ACK is told apart from an Error, Reject, Abort or timeout.               *
+ ****************************************************************************/
+
+static void TL_COV_Complete(
+    BACNET_TSM_REPLY * reply,
+    void *context)
+{
+    TL_LOG_INFO *CurrentLog = (TL_LOG_INFO *) context;
+    int iLog = (int) (CurrentLog - LogInfo);
+
+    if (!Device_Objects_Lock(OBJECT_TRENDLOG, true)) {
+        return;
+    }
+    if ((CurrentLog->ucInvokeID != reply->invoke_id) ||
+        ((CurrentLog->ucRequest != TL_REQ_SUBSCRIBE) &&
+            (CurrentLog->ucRequest != TL_REQ_CANCEL))) {
+        /* A request we have since given up on */
+    } else if (reply->result == TSM_RESULT_SIMPLE_ACK) {
+        CurrentLog->ucInvokeID = 0;
+        CurrentLog->ucRequest = TL_REQ_NONE;
+    } else {
+        TL_Reply_Failed(iLog, reply);
     }
+    Device_Objects_Unlock(OBJECT_TRENDLOG);
+}
 
-    Logs[iLog][CurrentLog->iIndex++] = TempRec;
-    if (CurrentLog->iIndex >= TL_MAX_ENTRIES)
-        CurrentLog->iIndex = 0;
+/****************************************************************************
+ * Subscribe to (or cancel) COV notifications from the logged object        *
+ ****************************************************************************/
 
-    CurrentLog->ulTotalRecordCount++;
+static void TL_COV_Subscribe(
+    int iLog,
+    bool bCancel)
+{
+    BACNET_SUBSCRIBE_COV_DATA cov_data;
+    TL_LOG_INFO *CurrentLog;
+    uint8_t invoke_id;
+
+    CurrentLog = &LogInfo[iLog];
+    memset(&cov_data, 0, sizeof(cov_data));
+    cov_data.subscriberProcessIdentifier = TL_COV_PROCESS_ID_BASE + iLog;
+    cov_data.monitoredObjectIdentifier = CurrentLog->Source.objectIdentifier;
+    cov_data.cancellationRequest = bCancel;
+    cov_data.issueConfirmedNotifications = false;
+    /* Allow for a late resubscription; 0 asks for an indefinite one */
+    if (CurrentLog->ulCOVResubscriptionInterval != 0) {
+        cov_data.lifetime =
+            CurrentLog->ulCOVResubscriptionInterval + TL_COV_LIFETIME_GRACE;
+    }
+    CurrentLog->tCOVSubscribeTime = time(NULL);
+    CurrentLog->bCOVSubscribed = !bCancel;
+
+    if (TL_Source_Is_Local(CurrentLog)) {
+        if (!handler_cov_subscribe_local(&cov_data) && !bCancel) {
+            CurrentLog->bCOVSubscribed = false;
+            TL_Insert_Error_Rec(iLog, CurrentLog->tCOVSubscribeTime,
+                cov_data.error_class, cov_data.error_code);
+        }
+        return;
+    }
+
+    /* Forget whatever we were waiting for, this takes precedence */
+    TL_Forget_Request(iLog);
+    invoke_id =
+        Send_COV_Subscribe(TL_Source_Device(CurrentLog), &cov_data);
+    if (invoke_id != 0) {
+        CurrentLog->ucInvokeID = invoke_id;
+        CurrentLog->ucRequest = bCancel ? TL_REQ_CANCEL : TL_REQ_SUBSCRIBE;
+        tsm_set_completion(invoke_id, TL_COV_Complete, CurrentLog);
+    } else {
+        CurrentLog->ucRequest = TL_REQ_NONE;
+        if (!bCancel) {
+            /* Probably not bound yet, Send_COV_Subscribe will have asked */
+            CurrentLog->bCOVSubscribed = false;
+        }
+    }
+}
+
+/****************************************************************************
+ * Log the value in a COV notification from the source of a COV Trend Log   *
+ ****************************************************************************/
+
+static void TL_COV_Notification(
+    BACNET_COV_DATA * cov_data)
+{
+    BACNET_PROPERTY_VALUE *pValue;
+    BACNET_PROPERTY_VALUE *pLogged;
+    BACNET_BIT_STRING *pStatus;
+    TL_LOG_INFO *CurrentLog;
+    uint32_t iLog;
+
+    iLog = cov_data->subscriberProcessIdentifier - TL_COV_PROCESS_ID_BASE;
+    if (iLog >= MAX_TREND_LOGS) {
+        return;
+    }
+    CurrentLog = &LogInfo[iLog];
+    if ((CurrentLog->LoggingType != LOGGING_TYPE_COV) ||
+        (!CurrentLog->bCOVSubscribed) || (!TL_Is_Enabled(iLog)) ||
+        (cov_data->initiatingDeviceIdentifier !=
+            TL_Source_Device(CurrentLog)) ||
+        (cov_data->monitoredObjectIdentifier.type !=
+            CurrentLog->Source.objectIdentifier.type) ||
+        (cov_data->monitoredObjectIdentifier.instance !=
+            CurrentLog->Source.objectIdentifier.instance)) {
+        return;
+    }
+    /* Pick out the logged property and the status flags */
+    pLogged = NULL;
+    pStatus = NULL;
+    for (pValue = cov_data->listOfValues; pValue != NULL;
+        pValue = pValue->next) {
+        if ((pValue->propertyIdentifier == CurrentLog->Source.propertyIdentifier)
+            && (pValue->propertyArrayIndex == CurrentLog->Source.arrayIndex)) {
+            pLogged = pValue;
+        } else if ((pValue->propertyIdentifier == PROP_STATUS_FLAGS) &&
+            (pValue->value.tag == BACNET_APPLICATION_TAG_BIT_STRING)) {
+            pStatus = &pValue->value.type.Bit_String;
+        }
+    }
+    if (pLogged != NULL) {
+        CurrentLog->tLastDataTime = time(NULL);
+        TL_Insert_Value_Rec(iLog, CurrentLog->tLastDataTime,
+            &pLogged->value, pStatus);
+    }
+}
+
+/****************************************************************************
+ * The COV notification handlers pass each notification here, whether it   *
+ * came from another device or from one of our own objects. Worker threads  *
+ * may be reading the logs, so they are locked while it is logged.          *
+ ****************************************************************************/
 
-    if (CurrentLog->ulRecordCount < TL_MAX_ENTRIES)
-        CurrentLog->ulRecordCount++;
+void trend_log_cov_notification(
+    BACNET_ADDRESS * src,
+    BACNET_COV_DATA * cov_data)
+{
+    (void) src;
+    if (Device_Objects_Lock(OBJECT_TRENDLOG, true)) {
+        TL_COV_Notification(cov_data);
+        Device_Objects_Unlock(OBJECT_TRENDLOG);
+    }
 }
 
 /****************************************************************************
@@ -1730,6 +2966,12 @@ void trend_log_timer(
     tNow = time(NULL);
     for (iCount = 0; iCount < MAX_TREND_LOGS; iCount++) {
         CurrentLog = &LogInfo[iCount];
+        if (CurrentLog->bCOVSubscribed &&
+            ((!TL_Is_Enabled(iCount)) ||
+                (CurrentLog->LoggingType != LOGGING_TYPE_COV))) {
+            /* No longer interested in changes */
+            TL_COV_Subscribe(iCount, true);
+        }
         if (TL_Is_Enabled(iCount)) {
             if (CurrentLog->LoggingType == LOGGING_TYPE_POLLED) {
                 /* For polled logs we first need to see if they are clock
@@ -1778,7 +3020,621 @@ void trend_log_timer(
                     TL_fetch_property(iCount);
                     CurrentLog->bTrigger = false;
                 }
+            } else if (CurrentLog->LoggingType == LOGGING_TYPE_COV) {
+                /* COV logs record whatever the source sends us, so all we
+                 * need do here is keep the subscription alive */
+                if (!CurrentLog->bCOVSubscribed) {
+                    if ((CurrentLog->tCOVSubscribeTime == 0) ||
+                        ((tNow - CurrentLog->tCOVSubscribeTime) >=
+                            TL_COV_RETRY_SECONDS)) {
+                        TL_COV_Subscribe(iCount, false);
+                    }
+                } else if ((CurrentLog->ulCOVResubscriptionInterval != 0) &&
+                    ((tNow - CurrentLog->tCOVSubscribeTime) >=
+                        (time_t) CurrentLog->ulCOVResubscriptionInterval)) {
+                    TL_COV_Subscribe(iCount, false);
+                }
+                /* A trigger still takes a reading on demand */
+                if (CurrentLog->bTrigger == true) {
+                    TL_fetch_property(iCount);
+                    CurrentLog->bTrigger = false;
+                }
             }
         }
     }
 }
+
+#ifdef TEST
+#include <assert.h>
+#include <math.h>
+#include "ctest.h"
+
+uint32_t Device_Object_Instance_Number(
+    void)
+{
+    return 1234;
+}
+
+int Device_Read_Property(
+    BACNET_READ_PROPERTY_DATA * rpdata)
+{
+    rpdata->error_class = ERROR_CLASS_OBJECT;
+    rpdata->error_code = ERROR_CODE_UNKNOWN_OBJECT;
+
+    return BACNET_STATUS_ERROR;
+}
+
+bool Device_Objects_Lock(
+    BACNET_OBJECT_TYPE object_type,
+    bool write)
+{
+    (void) object_type;
+    (void) write;
+
+    return true;
+}
+
+void Device_Objects_Unlock(
+    BACNET_OBJECT_TYPE object_type)
+{
+    (void) object_type;
+}
+
+/* whether address_bind_request() finds the remote source */
+static bool Test_Bound;
+/* what the TSM stubs saw of the last request */
+static uint8_t Test_Invoke_ID;
+static uint8_t Test_Freed_Invoke_ID;
+static tsm_completion_function Test_Completion;
+static void *Test_Context;
+
+uint8_t Send_COV_Subscribe(
+    uint32_t device_id,
+    BACNET_SUBSCRIBE_COV_DATA * cov_data)
+{
+    (void) device_id;
+    (void) cov_data;
+
+    return ++Test_Invoke_ID;
+}
+
+uint8_t Send_Read_Property_Request_Address(
+    BACNET_ADDRESS * dest,
+    uint16_t max_apdu,
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    uint32_t array_index)
+{
+    (void) dest;
+    (void) max_apdu;
+    (void) object_type;
+    (void) object_instance;
+    (void) object_property;
+    (void) array_index;
+
+    return ++Test_Invoke_ID;
+}
+
+void Send_WhoIs(
+    int32_t low_limit,
+    int32_t high_limit)
+{
+    (void) low_limit;
+    (void) high_limit;
+}
+
+bool address_bind_request(
+    uint32_t device_id,
+    unsigned *max_apdu,
+    BACNET_ADDRESS * src)
+{
+    (void) device_id;
+    *max_apdu = MAX_APDU;
+    memset(src, 0, sizeof(BACNET_ADDRESS));
+
+    return Test_Bound;
+}
+
+bool handler_cov_subscribe_local(
+    BACNET_SUBSCRIBE_COV_DATA * cov_data)
+{
+    (void) cov_data;
+
+    return false;
+}
+
+void tsm_free_invoke_id(
+    uint8_t invokeID)
+{
+    Test_Freed_Invoke_ID = invokeID;
+}
+
+bool tsm_set_completion(
+    uint8_t invokeID,
+    tsm_completion_function pFunction,
+    void *context)
+{
+    (void) invokeID;
+    Test_Completion = pFunction;
+    Test_Context = context;
+
+    return true;
+}
+
+bool WPValidateArgType(
+    BACNET_APPLICATION_DATA_VALUE * pValue,
+    uint8_t ucExpectedTag,
+    BACNET_ERROR_CLASS * pErrorClass,
+    BACNET_ERROR_CODE * pErrorCode)
+{
+    bool bResult = true;
+
+    if (pValue->tag != ucExpectedTag) {
+        bResult = false;
+        *pErrorClass = ERROR_CLASS_PROPERTY;
+        *pErrorCode = ERROR_CODE_INVALID_DATA_TYPE;
+    }
+
+    return (bResult);
+}
+
+static void testPackRecord(
+    Test * pTest,
+    const TL_DATA_REC * pRec,
+    time_t tPrev,
+    uint32_t ulInterval)
+{
+    uint8_t Packed[TL_PACKED_RECORD_MAX + 4];
+    TL_DATA_REC Unpacked;
+    int iLen;
+
+    memset(Packed, 0xAA, sizeof(Packed));
+    iLen = TL_Pack_Record(Packed, pRec, tPrev, ulInterval);
+    ct_test(pTest, iLen > 0);
+    ct_test(pTest, iLen <= TL_PACKED_RECORD_MAX);
+    ct_test(pTest, Packed[TL_PACKED_RECORD_MAX] == 0xAA);
+    ct_test(pTest, TL_Unpack_Record(Packed, &Unpacked, tPrev,
+            ulInterval) == iLen);
+    ct_test(pTest, Unpacked.tTimeStamp == pRec->tTimeStamp);
+    ct_test(pTest, Unpacked.ucRecType == pRec->ucRecType);
+    ct_test(pTest, Unpacked.ucStatus == pRec->ucStatus);
+    switch (pRec->ucRecType) {
+        case TL_TYPE_STATUS:
+            ct_test(pTest,
+                Unpacked.Datum.ucLogStatus == pRec->Datum.ucLogStatus);
+            break;
+        case TL_TYPE_BOOL:
+            ct_test(pTest, Unpacked.Datum.ucBoolean == pRec->Datum.ucBoolean);
+            break;
+        case TL_TYPE_REAL:
+            ct_test(pTest, Unpacked.Datum.fReal == pRec->Datum.fReal);
+            break;
+        case TL_TYPE_DELTA:
+            ct_test(pTest, Unpacked.Datum.fTime == pRec->Datum.fTime);
+            break;
+        case TL_TYPE_ENUM:
+            ct_test(pTest, Unpacked.Datum.ulEnum == pRec->Datum.ulEnum);
+            break;
+        case TL_TYPE_UNSIGN:
+            ct_test(pTest, Unpacked.Datum.ulUValue == pRec->Datum.ulUValue);
+            break;
+        case TL_TYPE_SIGN:
+            ct_test(pTest, Unpacked.Datum.lSValue == pRec->Datum.lSValue);
+            break;
+        case TL_TYPE_BITS:
+            ct_test(pTest,
+                Unpacked.Datum.Bits.ucLen == pRec->Datum.Bits.ucLen);
+            ct_test(pTest, memcmp(Unpacked.Datum.Bits.ucStore,
+                    pRec->Datum.Bits.ucStore,
+                    (pRec->Datum.Bits.ucLen >> 4) & 0x0F) == 0);
+            break;
+        case TL_TYPE_ERROR:
+            ct_test(pTest,
+                Unpacked.Datum.Error.usClass == pRec->Datum.Error.usClass);
+            ct_test(pTest,
+                Unpacked.Datum.Error.usCode == pRec->Datum.Error.usCode);
+            break;
+        default:
+            break;
+    }
+}
+
+void testTrendLogPacking(
+    Test * pTest)
+{
+    TL_DATA_REC Rec;
+    time_t tPrev = 1000000;
+    uint8_t Packed[TL_PACKED_RECORD_MAX];
+    uint8_t ucType;
+
+    for (ucType = TL_TYPE_STATUS; ucType <= TL_TYPE_DELTA; ucType++) {
+        /* on time, and then as far from it as a record can be */
+        memset(&Rec, 0, sizeof(Rec));
+        Rec.ucRecType = ucType;
+        Rec.tTimeStamp = tPrev + 900;
+        testPackRecord(pTest, &Rec, tPrev, 900);
+        Rec.ucStatus = 128 | 5;
+        Rec.tTimeStamp = tPrev + 900 + TL_MAX_TIME_DELTA;
+        switch (ucType) {
+            case TL_TYPE_STATUS:
+                Rec.Datum.ucLogStatus = 7;
+                break;
+            case TL_TYPE_BOOL:
+                Rec.Datum.ucBoolean = 1;
+                break;
+            case TL_TYPE_REAL:
+                Rec.Datum.fReal = -3.25f;
+                break;
+            case TL_TYPE_DELTA:
+                Rec.Datum.fTime = 12.5f;
+                break;
+            case TL_TYPE_ENUM:
+                Rec.Datum.ulEnum = 0xFFFFFFFF;
+                break;
+            case TL_TYPE_UNSIGN:
+                Rec.Datum.ulUValue = 0xFFFFFFFF;
+                break;
+            case TL_TYPE_SIGN:
+                Rec.Datum.lSValue = INT32_MIN;
+                break;
+            case TL_TYPE_BITS:
+                Rec.Datum.Bits.ucLen = (4 << 4) | 3;
+                Rec.Datum.Bits.ucStore[0] = 0x12;
+                Rec.Datum.Bits.ucStore[3] = 0x34;
+                break;
+            case TL_TYPE_ERROR:
+                Rec.Datum.Error.usClass = 0xFFFF;
+                Rec.Datum.Error.usCode = 0xFFFF;
+                break;
+            default:
+                break;
+        }
+        testPackRecord(pTest, &Rec, tPrev, 900);
+        Rec.tTimeStamp = tPrev + 900 - TL_MAX_TIME_DELTA;
+        testPackRecord(pTest, &Rec, tPrev, 900);
+        /* too far off to pack against this block */
+        Rec.tTimeStamp = tPrev + 900 + TL_MAX_TIME_DELTA + 1;
+        ct_test(pTest, TL_Pack_Record(Packed, &Rec, tPrev, 900) == 0);
+    }
+}
+
+void testTrendLogWrap(
+    Test * pTest)
+{
+    TL_DATA_REC Rec;
+    uint32_t ulEntry;
+    uint32_t ulTotal;
+    time_t tClock = 1000000;
+
+    Trend_Log_Init();
+    ct_test(pTest, Trend_Log_Buffer_Size_Set(0, 50));
+    ct_test(pTest, Trend_Log_Buffer_Size(0) == 50);
+    ct_test(pTest, LogInfo[0].ulRecordCount == 0);
+    ulTotal = LogInfo[0].ulTotalRecordCount;
+    LogInfo[0].ulLogInterval = 60;
+    for (ulEntry = 0; ulEntry < 200; ulEntry++) {
+        memset(&Rec, 0, sizeof(Rec));
+        Rec.tTimeStamp = tClock;
+        Rec.ucRecType = TL_TYPE_REAL;
+        Rec.Datum.fReal = (float) ulEntry;
+        TL_Insert_Rec(0, &Rec);
+        tClock += 60;
+        ct_test(pTest, LogInfo[0].ulRecordCount ==
+            ((ulEntry < 50) ? (ulEntry + 1) : 50));
+    }
+    ct_test(pTest, LogInfo[0].ulTotalRecordCount == ulTotal + 200);
+    ct_test(pTest, TL_Fetch_Record(0, 0, &Rec));
+    ct_test(pTest, Rec.Datum.fReal == 150.0f);
+    ct_test(pTest, TL_Fetch_Record(0, 49, &Rec));
+    ct_test(pTest, Rec.Datum.fReal == 199.0f);
+    ct_test(pTest, Rec.tTimeStamp == tClock - 60);
+    ct_test(pTest, !TL_Fetch_Record(0, 50, &Rec));
+    for (ulEntry = 0; ulEntry < 50; ulEntry++) {
+        ct_test(pTest, TL_Fetch_Record(0, ulEntry, &Rec));
+        ct_test(pTest, Rec.Datum.fReal == (float) (150 + ulEntry));
+    }
+
+    /* Records that pack as badly as they can still fill the log to
+     * Buffer_Size before a block has to be recycled */
+    ct_test(pTest, Trend_Log_Buffer_Size_Set(0, 50));
+    for (ulEntry = 0; ulEntry < 200; ulEntry++) {
+        memset(&Rec, 0, sizeof(Rec));
+        Rec.tTimeStamp = tClock + ((ulEntry & 1) ? TL_MAX_TIME_DELTA : 0);
+        Rec.ucStatus = 128;
+        Rec.ucRecType = TL_TYPE_ERROR;
+        Rec.Datum.Error.usClass = 0xFFFF;
+        Rec.Datum.Error.usCode = (uint16_t) (0xFF00 + ulEntry);
+        TL_Insert_Rec(0, &Rec);
+        tClock += 60;
+        ct_test(pTest, LogInfo[0].ulRecordCount ==
+            ((ulEntry < 50) ? (ulEntry + 1) : 50));
+    }
+    ct_test(pTest, TL_Fetch_Record(0, 0, &Rec));
+    ct_test(pTest, Rec.Datum.Error.usCode == 0xFF00 + 150);
+    ct_test(pTest, TL_Fetch_Record(0, 49, &Rec));
+    ct_test(pTest, Rec.Datum.Error.usCode == 0xFF00 + 199);
+}
+
+static bool testWriteBoolean(
+    BACNET_WRITE_PROPERTY_DATA * wp_data,
+    BACNET_PROPERTY_ID object_property,
+    bool value)
+{
+    memset(wp_data, 0, sizeof(BACNET_WRITE_PROPERTY_DATA));
+    wp_data->object_type = OBJECT_TRENDLOG;
+    wp_data->object_instance = 0;
+    wp_data->object_property = object_property;
+    wp_data->array_index = BACNET_ARRAY_ALL;
+    wp_data->priority = BACNET_NO_PRIORITY;
+    wp_data->application_data_len =
+        encode_application_boolean(&wp_data->application_data[0], value);
+
+    return Trend_Log_Write_Property(wp_data);
+}
+
+void testTrendLogStopWhenFull(
+    Test * pTest)
+{
+    BACNET_WRITE_PROPERTY_DATA wp_data;
+    TL_DATA_REC Rec;
+    uint32_t ulEntry;
+    time_t tClock = 1000000;
+
+    Trend_Log_Init();
+    ct_test(pTest, Trend_Log_Buffer_Size_Set(0, 20));
+    LogInfo[0].ulLogInterval = 60;
+    LogInfo[0].bEnable = true;
+    LogInfo[0].bStopWhenFull = false;
+    for (ulEntry = 0; ulEntry < 19; ulEntry++) {
+        memset(&Rec, 0, sizeof(Rec));
+        Rec.tTimeStamp = tClock;
+        Rec.ucRecType = TL_TYPE_UNSIGN;
+        Rec.Datum.ulUValue = ulEntry;
+        TL_Insert_Rec(0, &Rec);
+        tClock += 60;
+    }
+    ct_test(pTest, !TL_Is_Full(0));
+    /* not full yet, so stop when full leaves the log running */
+    ct_test(pTest, testWriteBoolean(&wp_data, PROP_STOP_WHEN_FULL, true));
+    ct_test(pTest, LogInfo[0].bEnable == true);
+    ct_test(pTest, testWriteBoolean(&wp_data, PROP_STOP_WHEN_FULL, false));
+    TL_Insert_Rec(0, &Rec);
+    ct_test(pTest, LogInfo[0].ulRecordCount == 20);
+    ct_test(pTest, TL_Is_Full(0));
+    /* switching stop when full on for a full log disables it */
+    ct_test(pTest, testWriteBoolean(&wp_data, PROP_STOP_WHEN_FULL, true));
+    ct_test(pTest, LogInfo[0].bStopWhenFull == true);
+    ct_test(pTest, LogInfo[0].bEnable == false);
+    /* and it can't be enabled again until it is purged */
+    ct_test(pTest, !testWriteBoolean(&wp_data, PROP_ENABLE, true));
+    ct_test(pTest, wp_data.error_class == ERROR_CLASS_OBJECT);
+    ct_test(pTest, wp_data.error_code == ERROR_CODE_LOG_BUFFER_FULL);
+    ct_test(pTest, LogInfo[0].bEnable == false);
+
+    /* An interval change on every record starts a block each time, so the
+     * ring runs out of blocks well before Buffer_Size records are held */
+    ct_test(pTest, Trend_Log_Buffer_Size_Set(0, 20));
+    ct_test(pTest, !TL_Is_Full(0));
+    ct_test(pTest, testWriteBoolean(&wp_data, PROP_ENABLE, true));
+    ct_test(pTest, LogInfo[0].bEnable == true);
+    ct_test(pTest, testWriteBoolean(&wp_data, PROP_STOP_WHEN_FULL, false));
+    for (ulEntry = 0; ulEntry < Log_Store[0].ulBlockCount; ulEntry++) {
+        ct_test(pTest, !TL_Is_Full(0));
+        LogInfo[0].ulLogInterval = 60 + ulEntry;
+        memset(&Rec, 0, sizeof(Rec));
+        Rec.tTimeStamp = tClock;
+        Rec.ucRecType = TL_TYPE_BOOL;
+        TL_Insert_Rec(0, &Rec);
+        tClock += 60;
+    }
+    ct_test(pTest, LogInfo[0].ulRecordCount == Log_Store[0].ulBlockCount);
+    ct_test(pTest, LogInfo[0].ulRecordCount < LogInfo[0].ulBufferSize);
+    /* the tail block still has room at the same interval... */
+    ct_test(pTest, !TL_Is_Full(0));
+    /* ...but the next interval change would push out the head block */
+    LogInfo[0].ulLogInterval = 30;
+    ct_test(pTest, TL_Is_Full(0));
+    ct_test(pTest, testWriteBoolean(&wp_data, PROP_STOP_WHEN_FULL, true));
+    ct_test(pTest, LogInfo[0].bEnable == false);
+    ct_test(pTest, TL_Fetch_Record(0, LogInfo[0].ulRecordCount - 1, &Rec));
+    ct_test(pTest, Rec.ucRecType == TL_TYPE_STATUS);
+}
+
+static void testCOVComplete(
+    BACNET_TSM_RESULT result)
+{
+    BACNET_TSM_REPLY reply;
+
+    memset(&reply, 0, sizeof(reply));
+    reply.result = result;
+    reply.invoke_id = Test_Invoke_ID;
+    reply.service_choice = SERVICE_CONFIRMED_SUBSCRIBE_COV;
+    Test_Completion(&reply, Test_Context);
+}
+
+void testTrendLogCOVSubscribe(
+    Test * pTest)
+{
+    TL_DATA_REC Rec;
+    uint32_t ulCount;
+
+    Trend_Log_Init();
+    ct_test(pTest, Trend_Log_Buffer_Size_Set(0, 20));
+    LogInfo[0].LoggingType = LOGGING_TYPE_COV;
+    LogInfo[0].Source.deviceIdentifier.type = OBJECT_DEVICE;
+    LogInfo[0].Source.deviceIdentifier.instance = 4321;
+
+    /* a Simple ACK is a subscription */
+    TL_COV_Subscribe(0, false);
+    ct_test(pTest, LogInfo[0].ucInvokeID == Test_Invoke_ID);
+    ct_test(pTest, LogInfo[0].ucRequest == TL_REQ_SUBSCRIBE);
+    ct_test(pTest, Test_Context == &LogInfo[0]);
+    testCOVComplete(TSM_RESULT_SIMPLE_ACK);
+    ct_test(pTest, LogInfo[0].ucInvokeID == 0);
+    ct_test(pTest, LogInfo[0].bCOVSubscribed);
+    ct_test(pTest, LogInfo[0].ulRecordCount == 0);
+
+    /* a new request gives the pending invoke ID back to the TSM */
+    TL_COV_Subscribe(0, false);
+    Test_Freed_Invoke_ID = 0;
+    TL_COV_Subscribe(0, false);
+    ct_test(pTest, Test_Freed_Invoke_ID == (uint8_t) (Test_Invoke_ID - 1));
+    ct_test(pTest, LogInfo[0].ucInvokeID == Test_Invoke_ID);
+
+    /* an Abort or a Reject is a failure, logged as one */
+    ulCount = LogInfo[0].ulRecordCount;
+    testCOVComplete(TSM_RESULT_ABORT);
+    ct_test(pTest, LogInfo[0].ucInvokeID == 0);
+    ct_test(pTest, !LogInfo[0].bCOVSubscribed);
+    ct_test(pTest, LogInfo[0].ulRecordCount == ulCount + 1);
+    ct_test(pTest, TL_Fetch_Record(0, ulCount, &Rec));
+    ct_test(pTest, Rec.ucRecType == TL_TYPE_ERROR);
+    ct_test(pTest, Rec.Datum.Error.usCode == ERROR_CODE_ABORT_OTHER);
+    TL_COV_Subscribe(0, false);
+    testCOVComplete(TSM_RESULT_REJECT);
+    ct_test(pTest, !LogInfo[0].bCOVSubscribed);
+    ct_test(pTest, TL_Fetch_Record(0, ulCount + 1, &Rec));
+    ct_test(pTest, Rec.Datum.Error.usCode == ERROR_CODE_REJECT_OTHER);
+
+    /* the answer to a request we gave up on is ignored */
+    TL_COV_Subscribe(0, false);
+    Test_Invoke_ID--;
+    testCOVComplete(TSM_RESULT_ABORT);
+    Test_Invoke_ID++;
+    ct_test(pTest, LogInfo[0].ucInvokeID == Test_Invoke_ID);
+    ct_test(pTest, LogInfo[0].bCOVSubscribed);
+    ct_test(pTest, LogInfo[0].ulRecordCount == ulCount + 2);
+
+    LogInfo[0].LoggingType = LOGGING_TYPE_POLLED;
+    LogInfo[0].Source.deviceIdentifier.instance =
+        Device_Object_Instance_Number();
+    TL_Forget_Request(0);
+}
+
+static void testReadComplete(
+    BACNET_TSM_RESULT result,
+    float fValue)
+{
+    BACNET_TSM_REPLY reply;
+    BACNET_READ_PROPERTY_DATA rp_data;
+    BACNET_APPLICATION_DATA_VALUE value;
+    uint8_t apdu[MAX_APDU];
+    uint8_t data[16];
+    int len;
+
+    memset(&reply, 0, sizeof(reply));
+    reply.result = result;
+    reply.invoke_id = Test_Invoke_ID;
+    reply.service_choice = SERVICE_CONFIRMED_READ_PROPERTY;
+    if (result == TSM_RESULT_ACK) {
+        memset(&value, 0, sizeof(value));
+        value.tag = BACNET_APPLICATION_TAG_REAL;
+        value.type.Real = fValue;
+        rp_data.object_type = OBJECT_ANALOG_INPUT;
+        rp_data.object_instance = 1;
+        rp_data.object_property = PROP_PRESENT_VALUE;
+        rp_data.array_index = BACNET_ARRAY_ALL;
+        rp_data.application_data = data;
+        rp_data.application_data_len =
+            bacapp_encode_application_data(data, &value);
+        len = rp_ack_encode_apdu(apdu, Test_Invoke_ID, &rp_data);
+        /* the service data follows the complex ACK header */
+        reply.service_data = &apdu[3];
+        reply.service_data_len = (uint16_t) (len - 3);
+    } else if (result == TSM_RESULT_ERROR) {
+        reply.error_class = ERROR_CLASS_PROPERTY;
+        reply.error_code = ERROR_CODE_UNKNOWN_PROPERTY;
+    }
+    Test_Completion(&reply, Test_Context);
+}
+
+void testTrendLogRemoteRead(
+    Test * pTest)
+{
+    TL_DATA_REC Rec;
+    uint32_t ulCount;
+
+    Trend_Log_Init();
+    ct_test(pTest, Trend_Log_Buffer_Size_Set(0, 20));
+    LogInfo[0].Source.deviceIdentifier.type = OBJECT_DEVICE;
+    LogInfo[0].Source.deviceIdentifier.instance = 4321;
+    Test_Bound = true;
+
+    /* the value in an ACK is logged */
+    ulCount = LogInfo[0].ulRecordCount;
+    TL_fetch_property(0);
+    ct_test(pTest, LogInfo[0].ucInvokeID == Test_Invoke_ID);
+    ct_test(pTest, LogInfo[0].ucRequest == TL_REQ_READ);
+    ct_test(pTest, Test_Completion == TL_Read_Complete);
+    ct_test(pTest, Test_Context == &LogInfo[0]);
+    ct_test(pTest, LogInfo[0].ulRecordCount == ulCount);
+    testReadComplete(TSM_RESULT_ACK, 12.5f);
+    ct_test(pTest, LogInfo[0].ucInvokeID == 0);
+    ct_test(pTest, LogInfo[0].ucRequest == TL_REQ_NONE);
+    ct_test(pTest, LogInfo[0].ulRecordCount == ulCount + 1);
+    ct_test(pTest, TL_Fetch_Record(0, ulCount, &Rec));
+    ct_test(pTest, Rec.ucRecType == TL_TYPE_REAL);
+    ct_test(pTest, Rec.Datum.fReal == 12.5f);
+
+    /* an Error, a Reject or a timeout is logged as an error */
+    TL_fetch_property(0);
+    testReadComplete(TSM_RESULT_ERROR, 0.0f);
+    ct_test(pTest, LogInfo[0].ucInvokeID == 0);
+    ct_test(pTest, TL_Fetch_Record(0, ulCount + 1, &Rec));
+    ct_test(pTest, Rec.ucRecType == TL_TYPE_ERROR);
+    ct_test(pTest, Rec.Datum.Error.usCode == ERROR_CODE_UNKNOWN_PROPERTY);
+    TL_fetch_property(0);
+    testReadComplete(TSM_RESULT_REJECT, 0.0f);
+    ct_test(pTest, TL_Fetch_Record(0, ulCount + 2, &Rec));
+    ct_test(pTest, Rec.Datum.Error.usCode == ERROR_CODE_REJECT_OTHER);
+    TL_fetch_property(0);
+    testReadComplete(TSM_RESULT_TIMEOUT, 0.0f);
+    ct_test(pTest, TL_Fetch_Record(0, ulCount + 3, &Rec));
+    ct_test(pTest, Rec.Datum.Error.usCode == ERROR_CODE_TIMEOUT);
+
+    /* a period with a request still outstanding is skipped */
+    TL_fetch_property(0);
+    TL_fetch_property(0);
+    ct_test(pTest, LogInfo[0].ucInvokeID == Test_Invoke_ID);
+    ct_test(pTest, LogInfo[0].ulRecordCount == ulCount + 4);
+
+    /* the answer to a request we gave up on is ignored */
+    TL_Forget_Request(0);
+    testReadComplete(TSM_RESULT_ACK, 1.0f);
+    ct_test(pTest, LogInfo[0].ulRecordCount == ulCount + 4);
+
+    Test_Bound = false;
+    LogInfo[0].Source.deviceIdentifier.instance =
+        Device_Object_Instance_Number();
+}
+
+#ifdef TEST_TREND_LOG
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet Trend Log", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testTrendLogPacking);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testTrendLogWrap);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testTrendLogStopWhenFull);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testTrendLogCOVSubscribe);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testTrendLogRemoteRead);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_TREND_LOG */
+#endif /* TEST */
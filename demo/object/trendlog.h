@@ -29,6 +29,7 @@
 #include <stdint.h>
 #include <time.h>       /* for time_t */
 #include "bacdef.h"
+#include "apdu.h"
 #include "cov.h"
 #include "rp.h"
 #include "wp.h"
@@ -50,7 +51,8 @@ extern "C" {
         uint8_t ucStore[4];
     } TL_BITS;
 
-/* Storage structure for Trend Log data
+/* Storage structure for Trend Log data. The buffer itself holds these
+ * packed (see trendlog.c) and this is the form they are unpacked to.
  *
  * Note. I've tried to minimise the storage requirements here
  * as the memory requirements for logging in embedded
@@ -80,7 +82,7 @@ extern "C" {
 #define TL_T_START_WILD 1       /* Start time is wild carded */
 #define TL_T_STOP_WILD  2       /* Stop Time is wild carded */
 
-#define TL_MAX_ENTRIES 1000     /* Entries per datalog */
+#define TL_MAX_ENTRIES 1000     /* Default entries per datalog */
 
 /* Structure containing config and status info for a Trend Log */
 
@@ -94,14 +96,19 @@ extern "C" {
         BACNET_DEVICE_OBJECT_PROPERTY_REFERENCE Source; /* Where the data comes from */
         uint32_t ulLogInterval; /* Time between entries in seconds */
         bool bStopWhenFull;     /* Log halts when full if true */
+        uint32_t ulBufferSize;  /* Number of records the log can hold */
         uint32_t ulRecordCount; /* Count of items currently in the buffer */
         uint32_t ulTotalRecordCount;    /* Count of all items that have ever been inserted into the buffer */
         BACNET_LOGGING_TYPE LoggingType;        /* Polled/cov/triggered */
         bool bAlignIntervals;   /* If true align to the clock */
         uint32_t ulIntervalOffset;      /* Offset from start of period for taking reading in seconds */
         bool bTrigger;  /* Set to 1 to cause a reading to be taken */
-        int iIndex;     /* Current insertion point */
         time_t tLastDataTime;
+        uint32_t ulCOVResubscriptionInterval;   /* Seconds between COV resubscriptions */
+        bool bCOVSubscribed;    /* A COV subscription to the source is active */
+        time_t tCOVSubscribeTime;       /* When we last (tried to) subscribe */
+        uint8_t ucInvokeID;     /* Outstanding request to a remote source or 0 */
+        uint8_t ucRequest;      /* Type of the outstanding request */
     } TL_LOG_INFO;
 
 /*
@@ -151,6 +158,14 @@ extern "C" {
     void Trend_Log_Init(
         void);
 
+    void Trend_Log_Storage_Path_Set(
+        const char *path);
+    bool Trend_Log_Buffer_Size_Set(
+        uint32_t object_instance,
+        uint32_t buffer_size);
+    uint32_t Trend_Log_Buffer_Size(
+        uint32_t object_instance);
+
     void TL_Insert_Status_Rec(
         int iLog,
         BACNET_LOG_STATUS eStatus,
@@ -194,6 +209,24 @@ extern "C" {
     void trend_log_timer(
         uint16_t uSeconds);
 
+    void trend_log_cov_notification(
+        BACNET_ADDRESS * src,
+        BACNET_COV_DATA * cov_data);
+
+#ifdef TEST
+#include "ctest.h"
+    void testTrendLogPacking(
+        Test * pTest);
+    void testTrendLogWrap(
+        Test * pTest);
+    void testTrendLogStopWhenFull(
+        Test * pTest);
+    void testTrendLogCOVSubscribe(
+        Test * pTest);
+    void testTrendLogRemoteRead(
+        Test * pTest);
+#endif
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -50,6 +50,7 @@
 #include "client.h"
 #include "txbuf.h"
 #include "dlenv.h"
+#include "filexfer.h"
 
 /* buffer used for receive */
 static uint8_t Rx_Buf[MAX_MPDU] = { 0 };
@@ -59,116 +60,16 @@ static uint32_t Target_File_Object_Instance = BACNET_MAX_INSTANCE;
 static uint32_t Target_Device_Object_Instance = BACNET_MAX_INSTANCE;
 static BACNET_ADDRESS Target_Address;
 static char *Local_File_Name = NULL;
-static int Target_File_Start_Position;
-static unsigned int Target_File_Requested_Octet_Count;
-static bool End_Of_File_Detected = false;
-static bool Error_Detected = false;
-static uint8_t Request_Invoke_ID = 0;
 
-static void Atomic_Read_File_Error_Handler(
-    BACNET_ADDRESS * src,
-    uint8_t invoke_id,
-    BACNET_ERROR_CLASS error_class,
-    BACNET_ERROR_CODE error_code)
+static void File_Transfer_Progress(
+    uint32_t octets_done,
+    uint32_t octets_total,
+    void *context)
 {
-    if (address_match(&Target_Address, src) &&
-        (invoke_id == Request_Invoke_ID)) {
-        printf("BACnet Error: %s: %s\n",
-            bactext_error_class_name((int) error_class),
-            bactext_error_code_name((int) error_code));
-        Error_Detected = true;
-    }
-}
-
-void MyAbortHandler(
-    BACNET_ADDRESS * src,
-    uint8_t invoke_id,
-    uint8_t abort_reason,
-    bool server)
-{
-    (void) server;
-    if (address_match(&Target_Address, src) &&
-        (invoke_id == Request_Invoke_ID)) {
-        printf("BACnet Abort: %s\n",
-            bactext_abort_reason_name((int) abort_reason));
-        Error_Detected = true;
-    }
-}
-
-void MyRejectHandler(
-    BACNET_ADDRESS * src,
-    uint8_t invoke_id,
-    uint8_t reject_reason)
-{
-    if (address_match(&Target_Address, src) &&
-        (invoke_id == Request_Invoke_ID)) {
-        printf("BACnet Reject: %s\n",
-            bactext_reject_reason_name((int) reject_reason));
-        Error_Detected = true;
-    }
-}
-
-static void AtomicReadFileAckHandler(
-    uint8_t * service_request,
-    uint16_t service_len,
-    BACNET_ADDRESS * src,
-    BACNET_CONFIRMED_SERVICE_ACK_DATA * service_data)
-{
-    int len = 0;
-    int result = 0;
-    BACNET_ATOMIC_READ_FILE_DATA data;
-    FILE *pFile = NULL; /* stream pointer */
-    size_t octets_written = 0;
-
-    if (address_match(&Target_Address, src) &&
-        (service_data->invoke_id == Request_Invoke_ID)) {
-        len = arf_ack_decode_service_request(service_request, service_len, &data);
-        if ((len > 0) && (data.access == FILE_STREAM_ACCESS)) {
-            if (data.type.stream.fileStartPosition == 0) {
-                pFile = fopen(Local_File_Name, "wb");
-            } else {
-                pFile = fopen(Local_File_Name, "rb+");
-            }
-            if (pFile) {
-                result = fseek(pFile, data.type.stream.fileStartPosition,
-                    SEEK_SET);
-                if (result == 0) {
-                    /* unit to write in bytes -
-                       in our case, an octet is one byte */
-                    octets_written = fwrite(
-                        octetstring_value(&data.fileData[0]), 1,
-                        octetstring_length(&data.fileData[0]), pFile);
-                    if (octets_written !=
-                        octetstring_length(&data.fileData[0])) {
-                        fprintf(stderr,
-                            "Unable to write data to file \"%s\".\n",
-                            Local_File_Name);
-                    } else if (octets_written == 0) {
-                        fprintf(stderr, "Received 0 byte octet string!.\n");
-                    } else {
-                        Target_File_Start_Position =
-                            data.type.stream.fileStartPosition +
-                            octets_written;
-                        printf("\r%d bytes", (int)Target_File_Start_Position);
-                    }
-                    fflush(pFile);
-                } else {
-                    fprintf(stderr, "Unable to seek to %d!\n",
-                        data.type.stream.fileStartPosition);
-                }
-                fclose(pFile);
-            }
-            if (data.endOfFile) {
-                End_Of_File_Detected = true;
-                printf("\n");
-            }
-        } else {
-            fprintf(stderr, "Decode error! %d bytes decoded.\n", len);
-        }
-    } else {
-        fprintf(stderr, "Address & Invoke ID mismatch! Invoke ID=%d\n",
-            Request_Invoke_ID);
-    }
+    (void) octets_total;
+    (void) context;
+    printf("\r%lu bytes", (unsigned long) octets_done);
+    fflush(stdout);
 }
 
 static void LocalIAmHandler(
@@ -211,14 +112,9 @@ static void Init_Service_Handlers(
     /* we must implement read property - it's required! */
     apdu_set_confirmed_handler(SERVICE_CONFIRMED_READ_PROPERTY,
         handler_read_property);
-    /* handle the data coming back from confirmed requests */
-    apdu_set_confirmed_ack_handler(SERVICE_CONFIRMED_ATOMIC_READ_FILE,
-        AtomicReadFileAckHandler);
-    /* handle any errors coming back */
-    apdu_set_error_handler(SERVICE_CONFIRMED_ATOMIC_READ_FILE,
-        Atomic_Read_File_Error_Handler);
-    apdu_set_abort_handler(MyAbortHandler);
-    apdu_set_reject_handler(MyRejectHandler);
+    /* the replies to the file requests come back by way of the TSM */
+    File_Transfer_Init();
+    File_Transfer_Progress_Set(File_Transfer_Progress, NULL);
 }
 
 static void print_usage(char *filename)
@@ -248,8 +144,11 @@ static void print_help(char *filename)
         "Example:\n"
         "If you want read File 2 from Device 123 and save it to temp.txt,\n"
         "use the following command:\n"
-        "%s 123 2 temp.txt\n",
-        filename);
+        "%s 123 2 temp.txt\n"
+        "\n"
+        "Set BACNET_FILE_WINDOW to the number of requests to keep in\n"
+        "flight at once (default %u, maximum %u).\n",
+        filename, FILE_TRANSFER_WINDOW_DEFAULT, FILE_TRANSFER_WINDOW_MAX);
 }
 
 int main(
@@ -266,11 +165,15 @@ int main(
     time_t last_seconds = 0;
     time_t current_seconds = 0;
     time_t timeout_seconds = 0;
-    uint8_t invoke_id = 0;
     bool found = false;
-    uint16_t my_max_apdu = 0;
+    bool started = false;
+    bool error_detected = false;
+    unsigned window = 0;
+    FILE_TRANSFER_STATUS status = FILE_TRANSFER_IDLE;
+    FILE *pFile = NULL;
     int argi = 0;
     char *filename = NULL;
+    char *pEnv = NULL;
 
     /* print help if requested */
     filename = filename_remove_path(argv[0]);
@@ -307,6 +210,10 @@ int main(
             Target_File_Object_Instance, BACNET_MAX_INSTANCE + 1);
         return 1;
     }
+    pEnv = getenv("BACNET_FILE_WINDOW");
+    if (pEnv) {
+        window = strtol(pEnv, NULL, 0);
+    }
     /* setup my info */
     Device_Set_Object_Instance_Number(BACNET_MAX_INSTANCE);
     address_init();
@@ -347,44 +254,30 @@ int main(
                 &Target_Address);
         }
         if (found) {
-            /* calculate the smaller of our APDU size or theirs
-               and remove the overhead of the APDU (about 16 octets max).
-               note: we could fail if there is a bottle neck (router)
-               and smaller MPDU in betweeen. */
-            if (max_apdu < MAX_APDU) {
-                my_max_apdu = max_apdu;
-            } else {
-                my_max_apdu = MAX_APDU;
-            }
-            /* Typical sizes are 50, 128, 206, 480, 1024, and 1476 octets */
-            if (my_max_apdu <= 50) {
-                Target_File_Requested_Octet_Count = my_max_apdu - 20;
-            } else if (my_max_apdu <= 480) {
-                Target_File_Requested_Octet_Count = my_max_apdu - 32;
-            } else if (my_max_apdu <= 1476) {
-                Target_File_Requested_Octet_Count = my_max_apdu - 64;
-            } else {
-                Target_File_Requested_Octet_Count = my_max_apdu / 2;
-            }
-            /* has the previous invoke id expired or returned?
-               note: invoke ID = 0 is invalid, so it will be idle */
-            if ((invoke_id == 0) || tsm_invoke_id_free(invoke_id)) {
-                if (End_Of_File_Detected || Error_Detected) {
+            if (!started) {
+                started = true;
+                pFile = fopen(Local_File_Name, "wb");
+                if (!pFile) {
+                    fprintf(stderr, "Unable to open \"%s\" for writing.\n",
+                        Local_File_Name);
+                    error_detected = true;
+                    break;
+                }
+                /* chunks are sized to the peer's max APDU
+                   to keep the transfer unsegmented */
+                if (!File_Transfer_Read_Start(Target_Device_Object_Instance,
+                        Target_File_Object_Instance, pFile, window)) {
+                    fprintf(stderr, "Unable to start the transfer!\n");
+                    error_detected = true;
                     break;
                 }
-                /* the ACK will increment the start position if OK */
-                /* we'll read the file in chunks
-                   less than max_apdu to keep unsegmented */
-                invoke_id =
-                    Send_Atomic_Read_File_Stream(Target_Device_Object_Instance,
-                    Target_File_Object_Instance, Target_File_Start_Position,
-                    Target_File_Requested_Octet_Count);
-                Request_Invoke_ID = invoke_id;
-            } else if (tsm_invoke_id_failed(invoke_id)) {
-                fprintf(stderr, "\rError: TSM Timeout!\n");
-                tsm_free_invoke_id(invoke_id);
-                /* try again or abort? */
-                Error_Detected = true;
+            }
+            status = File_Transfer_Task();
+            if (status == FILE_TRANSFER_DONE) {
+                printf("\n");
+                break;
+            } else if (status == FILE_TRANSFER_FAILED) {
+                error_detected = true;
                 break;
             }
         } else {
@@ -392,7 +285,7 @@ int main(
             elapsed_seconds += (current_seconds - last_seconds);
             if (elapsed_seconds > timeout_seconds) {
                 fprintf(stderr, "\rError: APDU Timeout!\n");
-                Error_Detected = true;
+                error_detected = true;
                 break;
             }
         }
@@ -400,7 +293,10 @@ int main(
         last_seconds = current_seconds;
     }
 
-    if (Error_Detected) {
+    if (pFile) {
+        fclose(pFile);
+    }
+    if (error_detected) {
         return 1;
     }
 
@@ -61,6 +61,8 @@ static uint8_t Rx_Buf[MAX_MPDU] = { 0 };
 /* global variables used in this file */
 static uint32_t Target_Device_Object_Instance = BACNET_MAX_INSTANCE;
 static BACNET_READ_ACCESS_DATA *Read_Access_Data;
+/* decoded ACK data, kept until the ACK has been printed */
+static ARENA Rpm_Arena;
 /* needed to filter incoming messages */
 static uint8_t Request_Invoke_ID = 0;
 static BACNET_ADDRESS Target_Address;
@@ -114,7 +116,7 @@ void MyRejectHandler(
 /** Handler for a ReadPropertyMultiple ACK.
  * @ingroup DSRPM
  * For each read property, print out the ACK'd data,
- * and free the request data items from linked property list.
+ * then release the decoded data back to the arena.
  *
  * @param service_request [in] The contents of the service request.
  * @param service_len [in] The length of the service_request.
@@ -129,60 +131,22 @@ void My_Read_Property_Multiple_Ack_Handler(
     BACNET_CONFIRMED_SERVICE_ACK_DATA * service_data)
 {
     int len = 0;
-    BACNET_READ_ACCESS_DATA *rpm_data;
-    BACNET_READ_ACCESS_DATA *old_rpm_data;
-    BACNET_PROPERTY_REFERENCE *rpm_property;
-    BACNET_PROPERTY_REFERENCE *old_rpm_property;
-    BACNET_APPLICATION_DATA_VALUE *value;
-    BACNET_APPLICATION_DATA_VALUE *old_value;
+    BACNET_READ_ACCESS_VIEW *rpm_data = NULL;
 
     if (address_match(&Target_Address, src) &&
         (service_data->invoke_id == Request_Invoke_ID)) {
-        rpm_data = calloc(1, sizeof(BACNET_READ_ACCESS_DATA));
-        if (rpm_data) {
-            len =
-                rpm_ack_decode_service_request(service_request, service_len,
-                rpm_data);
-        }
+        len =
+            rpm_ack_decode_service_request_view(service_request, service_len,
+            &Rpm_Arena, &rpm_data);
         if (len > 0) {
             while (rpm_data) {
-                rpm_ack_print_data(rpm_data);
-                rpm_property = rpm_data->listOfProperties;
-                while (rpm_property) {
-                    value = rpm_property->value;
-                    while (value) {
-                        old_value = value;
-                        value = value->next;
-                        free(old_value);
-                    }
-                    old_rpm_property = rpm_property;
-                    rpm_property = rpm_property->next;
-                    free(old_rpm_property);
-                }
-                old_rpm_data = rpm_data;
+                rpm_ack_print_view(rpm_data);
                 rpm_data = rpm_data->next;
-                free(old_rpm_data);
             }
         } else {
-            fprintf(stderr, "RPM Ack Malformed! Freeing memory...\n");
-            while (rpm_data) {
-                rpm_property = rpm_data->listOfProperties;
-                while (rpm_property) {
-                    value = rpm_property->value;
-                    while (value) {
-                        old_value = value;
-                        value = value->next;
-                        free(old_value);
-                    }
-                    old_rpm_property = rpm_property;
-                    rpm_property = rpm_property->next;
-                    free(old_rpm_property);
-                }
-                old_rpm_data = rpm_data;
-                rpm_data = rpm_data->next;
-                free(old_rpm_data);
-            }
+            fprintf(stderr, "RPM Ack Malformed!\n");
         }
+        Arena_Reset(&Rpm_Arena);
     }
 }
 
@@ -232,6 +196,7 @@ void cleanup(
         rpm_object = rpm_object->next;
         free(old_rpm_object);
     }
+    Arena_Free(&Rpm_Arena);
 }
 
 static void print_usage(char *filename)
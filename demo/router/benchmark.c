@@ -0,0 +1,626 @@
+/**
+* @file
+* @brief Router throughput benchmark over loopback ports
+*
+* @section LICENSE
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "bacenum.h"
+#include "benchmark.h"
+#include "loopmodule.h"
+#include "network_layer.h"
+
+/* The benchmark injects packets into the loopback ports as fast as
+   the port pools let it, and the packets that the router sends out
+   come back to bench_receive().  Application packets carry the time
+   they were injected, so each delivery gives the latency of one
+   router hop; a Who-Is-Router-To-Network is timed until the
+   I-Am-Router-To-Network comes back from the main thread. */
+
+typedef enum {
+    BENCH_UNICAST,
+    BENCH_BROADCAST,
+    BENCH_NETWORK,
+    BENCH_KINDS
+} BENCH_KIND;
+
+static const char *Bench_Kind_Name[BENCH_KINDS] = {
+    "unicast",
+    "broadcast",
+    "network"
+};
+
+/* latency buckets: 0 is under 1us, N is under 2^N us */
+#define BENCH_BUCKETS 24
+
+typedef struct {
+    unsigned long sent;
+    unsigned long delivered;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    unsigned long hist[BENCH_BUCKETS];
+} BENCH_STATS;
+
+typedef struct {
+    ROUTER_PORT *port;
+    pthread_mutex_t lock;
+    /* times that the Who-Is-Router-To-Network replies are waited for */
+    uint64_t pending[MSG_POOL_SIZE];
+    unsigned pending_head;
+    unsigned pending_count;
+} BENCH_PORT;
+
+static BENCH_STATS Bench_Stats[BENCH_KINDS];
+static BENCH_PORT Bench_Port[BENCH_MAX_NETWORKS];
+static unsigned Bench_Count;
+static unsigned Bench_Seconds;
+static unsigned long Bench_Refused;
+static bool Bench_Done;
+static bool Bench_Stop;
+static bool Bench_Running;
+static pthread_t Bench_Thread;
+
+/* APDU of the test packets: an UnconfirmedPrivateTransfer header,
+   the kind of packet and the time it was injected */
+#define BENCH_APDU_LEN 11
+
+static uint64_t bench_now(
+    )
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void bench_record(
+    BENCH_KIND kind,
+    uint64_t ns)
+{
+    BENCH_STATS *stats = &Bench_Stats[kind];
+    uint64_t us = ns / 1000;
+    uint64_t max;
+    unsigned bucket = 0;
+
+    while (us && (bucket < BENCH_BUCKETS - 1)) {
+        us >>= 1;
+        bucket++;
+    }
+    /* several port threads deliver at once */
+    __atomic_add_fetch(&stats->delivered, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats->total_ns, ns, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats->hist[bucket], 1, __ATOMIC_RELAXED);
+    max = __atomic_load_n(&stats->max_ns, __ATOMIC_RELAXED);
+    while ((ns > max) &&
+        !__atomic_compare_exchange_n(&stats->max_ns, &max, ns, false,
+            __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+static BENCH_PORT *bench_port(
+    ROUTER_PORT * port)
+{
+    /* the loopback networks are numbered from 1 */
+    unsigned index = port->route_info.net - 1;
+
+    if ((index < Bench_Count) && (Bench_Port[index].port == port))
+        return &Bench_Port[index];
+    return NULL;
+}
+
+/* sink of the loopback ports: runs in the port threads */
+static void bench_receive(
+    ROUTER_PORT * port,
+    BACNET_ADDRESS * dest,
+    uint8_t * pdu,
+    uint16_t pdu_len)
+{
+    BACNET_ADDRESS npdu_dest, npdu_src;
+    BACNET_NPDU_DATA npdu_data;
+    BENCH_PORT *bench;
+    uint64_t now = bench_now();
+    uint64_t stamp = 0;
+    uint8_t *apdu;
+    int offset;
+
+    (void) dest;
+    offset = npdu_decode(pdu, &npdu_dest, &npdu_src, &npdu_data);
+    if ((offset <= 0) || (offset > pdu_len))
+        return;
+    if (npdu_data.network_layer_message) {
+        if (npdu_data.network_message_type !=
+            NETWORK_MESSAGE_I_AM_ROUTER_TO_NETWORK)
+            return;
+        bench = bench_port(port);
+        if (!bench)
+            return;
+        pthread_mutex_lock(&bench->lock);
+        if (bench->pending_count) {
+            stamp = bench->pending[bench->pending_head];
+            bench->pending_head = (bench->pending_head + 1) % MSG_POOL_SIZE;
+            bench->pending_count--;
+        }
+        pthread_mutex_unlock(&bench->lock);
+        /* the I-Am-Router-To-Network of the router start up has none */
+        if (stamp)
+            bench_record(BENCH_NETWORK, now - stamp);
+        return;
+    }
+    if (pdu_len - offset < BENCH_APDU_LEN)
+        return;
+    apdu = &pdu[offset];
+    if ((apdu[0] != PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST) ||
+        (apdu[1] != SERVICE_UNCONFIRMED_PRIVATE_TRANSFER) ||
+        (apdu[2] >= BENCH_NETWORK))
+        return;
+    memcpy(&stamp, &apdu[3], sizeof(stamp));
+    bench_record((BENCH_KIND) apdu[2], now - stamp);
+}
+
+static bool bench_send(
+    BENCH_PORT * bench,
+    BENCH_KIND kind,
+    ROUTER_PORT * dest_port)
+{
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_ADDRESS src = { 0 };
+    BACNET_NPDU_DATA npdu_data;
+    uint8_t pdu[MAX_NPDU + BENCH_APDU_LEN];
+    uint64_t stamp = bench_now();
+    int len = 0;
+    bool status;
+
+    /* sent by device 1 of the network */
+    src.mac_len = bench->port->route_info.mac_len;
+    src.mac[src.mac_len - 1] = 1;
+    if (kind == BENCH_NETWORK) {
+        init_npdu(&npdu_data, NETWORK_MESSAGE_WHO_IS_ROUTER_TO_NETWORK,
+            false);
+        len = npdu_encode_pdu(pdu, NULL, NULL, &npdu_data);
+        pthread_mutex_lock(&bench->lock);
+        if (bench->pending_count == MSG_POOL_SIZE) {
+            pthread_mutex_unlock(&bench->lock);
+            return false;
+        }
+        bench->pending[(bench->pending_head +
+                bench->pending_count) % MSG_POOL_SIZE] = stamp;
+        bench->pending_count++;
+        pthread_mutex_unlock(&bench->lock);
+    } else {
+        if (kind == BENCH_BROADCAST) {
+            dest.net = BACNET_BROADCAST_NETWORK;
+        } else {
+            /* to device 2 of the next network */
+            dest.net = dest_port->route_info.net;
+            dest.len = dest_port->route_info.mac_len;
+            dest.adr[dest.len - 1] = 2;
+        }
+        npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+        len = npdu_encode_pdu(pdu, &dest, NULL, &npdu_data);
+        pdu[len++] = PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST;
+        pdu[len++] = SERVICE_UNCONFIRMED_PRIVATE_TRANSFER;
+        pdu[len++] = (uint8_t) kind;
+        memcpy(&pdu[len], &stamp, sizeof(stamp));
+        len += sizeof(stamp);
+    }
+
+    status = dl_loop_inject(bench->port, &src, pdu, (uint16_t) len);
+    if (!status && (kind == BENCH_NETWORK)) {
+        /* no reply will come */
+        pthread_mutex_lock(&bench->lock);
+        bench->pending_count--;
+        pthread_mutex_unlock(&bench->lock);
+    }
+
+    return status;
+}
+
+static bool bench_stopped(
+    )
+{
+    return __atomic_load_n(&Bench_Stop, __ATOMIC_ACQUIRE);
+}
+
+static unsigned long bench_delivered(
+    )
+{
+    unsigned long delivered = 0;
+    int kind;
+
+    for (kind = 0; kind < BENCH_KINDS; kind++) {
+        delivered +=
+            __atomic_load_n(&Bench_Stats[kind].delivered, __ATOMIC_RELAXED);
+    }
+    return delivered;
+}
+
+/* upper end of the bucket that holds the given fraction of deliveries */
+static unsigned long bench_percentile(
+    unsigned long *hist,
+    unsigned long count,
+    double fraction)
+{
+    unsigned long sum = 0;
+    unsigned bucket;
+
+    for (bucket = 0; bucket < BENCH_BUCKETS; bucket++) {
+        sum += hist[bucket];
+        if (sum >= fraction * count)
+            break;
+    }
+    return 1UL << bucket;
+}
+
+static double bench_cpu_us(
+    struct rusage *start,
+    struct rusage *end)
+{
+    return (end->ru_utime.tv_sec - start->ru_utime.tv_sec) * 1e6 +
+        (end->ru_utime.tv_usec - start->ru_utime.tv_usec) +
+        (end->ru_stime.tv_sec - start->ru_stime.tv_sec) * 1e6 +
+        (end->ru_stime.tv_usec - start->ru_stime.tv_usec);
+}
+
+/* a late delivery may still be recorded while the results are read */
+static void bench_snapshot(
+    BENCH_STATS * snapshot)
+{
+    unsigned bucket;
+    int kind;
+
+    for (kind = 0; kind < BENCH_KINDS; kind++) {
+        snapshot[kind].sent = Bench_Stats[kind].sent;
+        snapshot[kind].delivered =
+            __atomic_load_n(&Bench_Stats[kind].delivered, __ATOMIC_RELAXED);
+        snapshot[kind].total_ns =
+            __atomic_load_n(&Bench_Stats[kind].total_ns, __ATOMIC_RELAXED);
+        snapshot[kind].max_ns =
+            __atomic_load_n(&Bench_Stats[kind].max_ns, __ATOMIC_RELAXED);
+        for (bucket = 0; bucket < BENCH_BUCKETS; bucket++) {
+            snapshot[kind].hist[bucket] =
+                __atomic_load_n(&Bench_Stats[kind].hist[bucket],
+                __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void bench_report(
+    double seconds,
+    double cpu_us)
+{
+    BENCH_STATS snapshot[BENCH_KINDS];
+    BENCH_STATS total = { 0 };
+    BENCH_STATS *stats;
+    unsigned bucket;
+    int kind;
+
+    bench_snapshot(snapshot);
+
+    printf("\nRouter benchmark: %u networks, %.2f seconds\n", Bench_Count,
+        seconds);
+    printf("%-10s %10s %10s %10s %8s %8s %8s %8s\n", "traffic", "sent",
+        "delivered", "pkts/s", "mean us", "p50 us", "p99 us", "max us");
+    for (kind = 0; kind <= BENCH_KINDS; kind++) {
+        if (kind < BENCH_KINDS) {
+            stats = &snapshot[kind];
+            total.sent += stats->sent;
+            total.delivered += stats->delivered;
+            total.total_ns += stats->total_ns;
+            if (stats->max_ns > total.max_ns)
+                total.max_ns = stats->max_ns;
+            for (bucket = 0; bucket < BENCH_BUCKETS; bucket++)
+                total.hist[bucket] += stats->hist[bucket];
+        } else {
+            stats = &total;
+        }
+        printf("%-10s %10lu %10lu %10.0f %8.1f %8lu %8lu %8.1f\n",
+            (kind < BENCH_KINDS) ? Bench_Kind_Name[kind] : "total",
+            stats->sent, stats->delivered, stats->delivered / seconds,
+            stats->delivered ? stats->total_ns / 1000.0 /
+            stats->delivered : 0.0, bench_percentile(stats->hist,
+                stats->delivered, 0.5), bench_percentile(stats->hist,
+                stats->delivered, 0.99), stats->max_ns / 1000.0);
+    }
+    printf("refused by full port pools: %lu\n", Bench_Refused);
+    if (total.delivered) {
+        /* the benchmark's own threads are included */
+        printf("CPU per packet: %.2f us (%.0f%% of one CPU)\n",
+            cpu_us / total.delivered, cpu_us / (seconds * 1e4));
+    }
+    printf("per hop latency:\n");
+    for (bucket = 0; bucket < BENCH_BUCKETS; bucket++) {
+        if (total.hist[bucket]) {
+            printf("  < %8lu us %10lu %6.2f%%\n", 1UL << bucket,
+                total.hist[bucket], 100.0 * total.hist[bucket] /
+                total.delivered);
+        }
+    }
+    fflush(stdout);
+}
+
+static void *bench_thread(
+    void *pArgs)
+{
+    struct rusage usage_start, usage_end;
+    uint64_t start, end, now;
+    unsigned long count = 0;
+    unsigned long delivered;
+    unsigned i, j;
+    BENCH_KIND kind;
+
+    (void) pArgs;
+    /* let the I-Am-Router-To-Network of the router start up pass */
+    sleep(1);
+    if (bench_stopped())
+        return NULL;
+
+    PRINT(INFO, "Benchmark: %u networks for %u seconds\n", Bench_Count,
+        Bench_Seconds);
+    getrusage(RUSAGE_SELF, &usage_start);
+    start = bench_now();
+    end = start + Bench_Seconds * 1000000000ULL;
+    do {
+        for (i = 0; i < Bench_Count; i++, count++) {
+            if ((count % BENCH_NETWORK_EVERY) == 0) {
+                kind = BENCH_NETWORK;
+            } else if ((count % BENCH_BROADCAST_EVERY) ==
+                (BENCH_BROADCAST_EVERY / 2)) {
+                kind = BENCH_BROADCAST;
+            } else {
+                kind = BENCH_UNICAST;
+            }
+            j = (i + 1) % Bench_Count;
+            if (bench_send(&Bench_Port[i], kind, Bench_Port[j].port)) {
+                Bench_Stats[kind].sent++;
+            } else {
+                /* the port has no free buffers: let the router work */
+                Bench_Refused++;
+                sched_yield();
+            }
+        }
+        now = bench_now();
+    } while ((now < end) && !bench_stopped());
+
+    /* wait for the router to empty its queues */
+    do {
+        delivered = bench_delivered();
+        usleep(100000);
+    } while ((delivered != bench_delivered()) && !bench_stopped());
+    now = bench_now();
+    getrusage(RUSAGE_SELF, &usage_end);
+
+    bench_report((now - start) / 1e9, bench_cpu_us(&usage_start,
+            &usage_end));
+    __atomic_store_n(&Bench_Done, true, __ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+/**
+ * Sets up the benchmark for the loopback ports.  This is done before
+ * the port threads start, since they call the sink from then on.
+ *
+ * @param port_list - loopback ports of NETs 1 to N
+ * @param seconds - how long to send traffic
+ * @return true if the ports can be benchmarked
+ */
+bool bench_init(
+    ROUTER_PORT * port_list,
+    unsigned seconds)
+{
+    ROUTER_PORT *port = port_list;
+
+    Bench_Count = 0;
+    while (port != NULL) {
+        if ((port->type != LOOP) || (Bench_Count >= BENCH_MAX_NETWORKS) ||
+            (port->route_info.net != Bench_Count + 1)) {
+            PRINT(ERROR, "Error: benchmark needs loopback NETs 1 to %u\n",
+                BENCH_MAX_NETWORKS);
+            return false;
+        }
+        Bench_Port[Bench_Count].port = port;
+        Bench_Port[Bench_Count].pending_head = 0;
+        Bench_Port[Bench_Count].pending_count = 0;
+        pthread_mutex_init(&Bench_Port[Bench_Count].lock, NULL);
+        Bench_Count++;
+        port = port->next;
+    }
+    if (Bench_Count < 2) {
+        PRINT(ERROR, "Error: benchmark needs at least 2 networks\n");
+        return false;
+    }
+    memset(Bench_Stats, 0, sizeof(Bench_Stats));
+    Bench_Refused = 0;
+    Bench_Seconds = seconds;
+    Bench_Done = false;
+    Bench_Stop = false;
+    dl_loop_set_sink(bench_receive);
+
+    return true;
+}
+
+bool bench_start(
+    )
+{
+    if (Bench_Running || (Bench_Count < 2))
+        return false;
+    if (pthread_create(&Bench_Thread, NULL, bench_thread, NULL) != 0)
+        return false;
+    Bench_Running = true;
+
+    return true;
+}
+
+void bench_stop(
+    )
+{
+    if (!Bench_Running)
+        return;
+    __atomic_store_n(&Bench_Stop, true, __ATOMIC_RELEASE);
+    pthread_join(Bench_Thread, NULL);
+    Bench_Running = false;
+    dl_loop_set_sink(NULL);
+}
+
+bool bench_finished(
+    )
+{
+    return __atomic_load_n(&Bench_Done, __ATOMIC_ACQUIRE);
+}
+
+#ifdef TEST
+#include <assert.h>
+#include "ctest.h"
+
+/* the router of main.c, with loopback ports and no configuration */
+ROUTER_PORT *head = NULL;
+int port_count;
+
+#define TEST_NETWORKS 3
+
+static void testBenchPorts(
+    Test * pTest,
+    ROUTER_PORT * ports,
+    MSGBOX_ID main_id)
+{
+    ROUTER_PORT *port;
+    pthread_t thread;
+    int i;
+
+    head = &ports[0];
+    port_count = TEST_NETWORKS;
+    for (i = 0; i < TEST_NETWORKS; i++) {
+        port = &ports[i];
+        port->type = LOOP;
+        port->iface = "loop";
+        port->route_info.net = (uint16_t) (i + 1);
+        port->params.loop_params.mac_len = (i % 2) ? 1 : 6;
+        port->main_id = main_id;
+        port->next = (i + 1 < TEST_NETWORKS) ? &ports[i + 1] : NULL;
+        ct_test(pTest, dl_loop_init(port));
+        ct_test(pTest, msg_pool_init(&port->pool, MSG_POOL_SIZE));
+        ct_test(pTest, add_port_net(port));
+    }
+    /* the sink is set before the port threads start */
+    ct_test(pTest, bench_init(head, 1));
+    for (port = head; port != NULL; port = port->next) {
+        port->state = INIT;
+        ct_test(pTest, pthread_create(&thread, NULL, dl_loop_thread,
+                port) == 0);
+        pthread_detach(thread);
+    }
+    for (port = head; port != NULL; port = port->next) {
+        while (get_port_state(port) == INIT) {
+            sched_yield();
+        }
+        ct_test(pTest, get_port_state(port) == RUNNING);
+    }
+}
+
+void testBenchmark(
+    Test * pTest)
+{
+    ROUTER_PORT ports[TEST_NETWORKS];
+    ROUTER_PORT *port;
+    BACMSG msg_storage, *bacmsg;
+    MSGBOX_ID main_id;
+    time_t start;
+    int kind;
+
+    memset(ports, 0, sizeof(ports));
+    main_id = create_msgbox();
+    ct_test(pTest, main_id != INVALID_MSGBOX_ID);
+    ct_test(pTest, msg_pool_init(&msg_pool, MSG_POOL_SIZE));
+    testBenchPorts(pTest, ports, main_id);
+
+    /* the main thread answers the Who-Is-Router-To-Network */
+    ct_test(pTest, bench_start());
+    ct_test(pTest, !bench_start());
+    start = time(NULL);
+    while (!bench_finished() && (time(NULL) - start < 30)) {
+        bacmsg = recv_from_msgbox(main_id, &msg_storage);
+        if (bacmsg && (bacmsg->type == DATA)) {
+            route_main_msg(bacmsg);
+        } else {
+            sched_yield();
+        }
+    }
+    ct_test(pTest, bench_finished());
+    for (kind = 0; kind < BENCH_KINDS; kind++) {
+        ct_test(pTest, Bench_Stats[kind].sent > 0);
+        ct_test(pTest, Bench_Stats[kind].delivered > 0);
+    }
+    bench_stop();
+
+    /* shut the ports down, as cleanup() does */
+    msg_storage.origin = main_id;
+    msg_storage.type = SERVICE;
+    msg_storage.subtype = SHUTDOWN;
+    for (port = head; port != NULL; port = port->next) {
+        ct_test(pTest, send_to_msgbox(port->port_id, &msg_storage));
+    }
+    for (port = head; port != NULL; port = port->next) {
+        while (get_port_state(port) == RUNNING) {
+            sched_yield();
+        }
+        ct_test(pTest, get_port_state(port) == FINISHED);
+    }
+    del_msgbox(main_id);
+    for (port = head; port != NULL; port = port->next) {
+        dl_loop_cleanup(port);
+        ct_test(pTest, port->params.loop_params.data == NULL);
+        cleanup_dnets(port->route_info.dnets);
+        msg_pool_cleanup(&port->pool);
+    }
+    msg_pool_cleanup(&msg_pool);
+    head = NULL;
+}
+
+#ifdef TEST_BENCHMARK
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet Router Benchmark", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testBenchmark);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif
+#endif
@@ -0,0 +1,71 @@
+/**
+* @file
+* @brief Router throughput benchmark over loopback ports
+*
+* @section LICENSE
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdbool.h>
+#include "portthread.h"
+
+/* most loopback networks in a benchmark */
+#ifndef BENCH_MAX_NETWORKS
+#define BENCH_MAX_NETWORKS 128
+#endif
+/* every Nth injected packet is a global broadcast */
+#ifndef BENCH_BROADCAST_EVERY
+#define BENCH_BROADCAST_EVERY 8
+#endif
+/* every Nth injected packet is a Who-Is-Router-To-Network */
+#ifndef BENCH_NETWORK_EVERY
+#define BENCH_NETWORK_EVERY 16
+#endif
+
+/* set up the benchmark of the loopback ports; before the port
+   threads are started */
+bool bench_init(
+    ROUTER_PORT * port_list,
+    unsigned seconds);
+
+/* start sending traffic between the loopback ports of the router for
+   the given number of seconds, then print the results */
+bool bench_start(
+    );
+
+/* stop sending traffic and wait for the benchmark to end */
+void bench_stop(
+    );
+
+/* true once the results have been printed */
+bool bench_finished(
+    );
+
+#ifdef TEST
+#include "ctest.h"
+void testBenchmark(
+    Test * pTest);
+#endif
+
+#endif /* end of BENCHMARK_H */
@@ -29,6 +29,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/uio.h>
 #include "ipmodule.h"
 #include "bacint.h"
 
@@ -58,28 +59,23 @@ void *dl_ip_thread(
 
     /* initialize router port */
     if (!dl_ip_init(port, &ip_data)) {
-        port->state = INIT_FAILED;
+        set_port_state(port, INIT_FAILED);
         return NULL;
     }
 
-    /* allocate buffer */
-    ip_data.max_buff = MAX_BIP_MPDU;
-    ip_data.buff = (uint8_t *) malloc(ip_data.max_buff);
-
-    if (ip_data.buff == NULL) {
-        port->state = INIT_FAILED;
-        return NULL;
-    }
+    /* packets are received straight into the port's message buffers */
+    ip_data.pool = &port->pool;
+    ip_data.rx_data = NULL;
 
     msgboxid = create_msgbox();
     if (msgboxid == INVALID_MSGBOX_ID) {
         PRINT(ERROR, "Error: Failed to create message box");
-        port->state = INIT_FAILED;
+        set_port_state(port, INIT_FAILED);
         return NULL;
     }
 
     port->port_id = msgboxid;
-    port->state = RUNNING;
+    set_port_state(port, RUNNING);
 
     while (!shutdown) {
 
@@ -127,7 +123,10 @@ void *dl_ip_thread(
                 msg_storage.type = DATA;
                 msg_storage.data = msg_data;
 
-                if (!send_to_msgbox(port->main_id, &msg_storage)) {
+                /* route it here if possible, so that the ports forward
+                   in parallel; the rest goes to the main thread */
+                if (!forward_msg(port, msg_data) &&
+                    !send_to_msgbox(port->main_id, &msg_storage)) {
                     free_data(msg_data);
                 }
             }
@@ -136,7 +135,7 @@ void *dl_ip_thread(
 
     /* cleanup procedure */
     dl_ip_cleanup(&ip_data);
-    port->state = FINISHED;
+    set_port_state(port, FINISHED);
     return NULL;
 }
 
@@ -226,39 +225,43 @@ int dl_ip_send(
     unsigned pdu_len)
 {
     struct sockaddr_in bip_dest = { 0 };
-    int buff_len = 0;
+    uint8_t header[4];
+    struct iovec iov[2];
+    struct msghdr msg = { 0 };
     int bytes_sent = 0;
 
     if (data->socket < 0)
         return -1;
 
-    data->buff[0] = BVLL_TYPE_BACNET_IP;
+    header[0] = BVLL_TYPE_BACNET_IP;
     bip_dest.sin_family = AF_INET;
     if (dest->net == BACNET_BROADCAST_NETWORK) {
         /* broadcast */
         bip_dest.sin_addr.s_addr = data->broadcast_addr.s_addr;
         bip_dest.sin_port = data->port;
-        data->buff[1] = BVLC_ORIGINAL_BROADCAST_NPDU;
+        header[1] = BVLC_ORIGINAL_BROADCAST_NPDU;
     } else if (dest->mac_len == 6) {
         memcpy(&bip_dest.sin_addr.s_addr, &dest->mac[0], 4);
         memcpy(&bip_dest.sin_port, &dest->mac[4], 2);
-        data->buff[1] = BVLC_ORIGINAL_UNICAST_NPDU;
+        header[1] = BVLC_ORIGINAL_UNICAST_NPDU;
     } else {
         /* invalid address */
         return -1;
     }
 
-    buff_len = 2;
-    buff_len +=
-        encode_unsigned16(&data->buff[buff_len],
-        (uint16_t) (pdu_len + 4 /*inclusive */ ));
-    memcpy(&data->buff[buff_len], pdu, pdu_len);
-    buff_len += pdu_len;
+    encode_unsigned16(&header[2], (uint16_t) (pdu_len + 4 /*inclusive */ ));
 
-    /* send the packet */
-    bytes_sent =
-        sendto(data->socket, (char *) data->buff, buff_len, 0,
-        (struct sockaddr *) &bip_dest, sizeof(struct sockaddr));
+    /* send the BVLC header and the PDU without copying them together;
+       a broadcast PDU is shared with the other router ports */
+    iov[0].iov_base = header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = pdu;
+    iov[1].iov_len = pdu_len;
+    msg.msg_name = &bip_dest;
+    msg.msg_namelen = sizeof(bip_dest);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    bytes_sent = sendmsg(data->socket, &msg, 0);
 
     PRINT(DEBUG, "send to %s\n", inet_ntoa(bip_dest.sin_addr));
 
@@ -277,11 +280,26 @@ int dl_ip_recv(
     struct timeval select_timeout;
     struct sockaddr_in sin = { 0 };
     socklen_t sin_len = sizeof(sin);
+    MSG_DATA *rx_data;
+    uint8_t *buff;
+    uint16_t max_buff = MSG_LINK_HEADER + MSG_MAX_PDU;
 
     /* make sure the socket is open */
     if (data->socket < 0)
         return 0;
 
+    if (!data->rx_data) {
+        data->rx_data = alloc_data(data->pool);
+        if (!data->rx_data) {
+            /* every buffer is in use: leave the packet in the socket
+               until the other ports have sent some */
+            return 0;
+        }
+    }
+    rx_data = data->rx_data;
+    /* the BVLC header goes into the headroom, in front of the PDU */
+    buff = &rx_data->buff[MSG_HEADROOM];
+
     if (timeout >= 1000) {
         select_timeout.tv_sec = timeout / 1000;
         select_timeout.tv_usec =
@@ -296,7 +314,7 @@ int dl_ip_recv(
 
 #ifdef TEST_PACKET
     received_bytes = sizeof(test_packet);
-    memmove(data->buff, &test_packet, received_bytes);
+    memmove(buff, &test_packet, received_bytes);
     sin.sin_addr.s_addr = 0x7E1D40A;
     sin.sin_port = 0xC0BA;
 #else
@@ -304,7 +322,7 @@ int dl_ip_recv(
     /* see if there is a packet for us */
     if (ret > 0)
         received_bytes =
-            recvfrom(data->socket, (char *) &data->buff[0], data->max_buff, 0,
+            recvfrom(data->socket, (char *) buff, max_buff, 0,
             (struct sockaddr *) &sin, &sin_len);
     else
         return 0;
@@ -317,10 +335,10 @@ int dl_ip_recv(
     }
 
     /* the signature of a BACnet/IP packet */
-    if (data->buff[0] != BVLL_TYPE_BACNET_IP)
+    if (buff[0] != BVLL_TYPE_BACNET_IP)
         return 0;
 
-    switch (data->buff[1]) {
+    switch (buff[1]) {
         case BVLC_ORIGINAL_UNICAST_NPDU:
         case BVLC_ORIGINAL_BROADCAST_NPDU:{
                 if ((sin.sin_addr.s_addr == data->local_addr.s_addr) &&
@@ -334,20 +352,16 @@ int dl_ip_recv(
                     memcpy(&src->mac[0], &sin.sin_addr.s_addr, 4);
                     memcpy(&src->mac[4], &sin.sin_port, 2);
 
-                    (void) decode_unsigned16(&data->buff[2], &buff_len);
+                    (void) decode_unsigned16(&buff[2], &buff_len);
                     /* subtract off the BVLC header */
                     buff_len -= 4;
-                    if (buff_len < data->max_buff) {
-                        /* allocate data message stucture */
-                        (*msg_data) = (MSG_DATA *) malloc(sizeof(MSG_DATA));
-                        (*msg_data)->pdu_len = buff_len;
-                        (*msg_data)->pdu =
-                            (uint8_t *) malloc((*msg_data)->pdu_len);
-                        /* fill up data message structure */
-                        memmove(&(*msg_data)->pdu[0], &data->buff[4],
-                            (*msg_data)->pdu_len);
-                        memmove(&(*msg_data)->src, src,
-                            sizeof(BACNET_ADDRESS));
+                    if ((buff_len > 0) && (buff_len + 4 <= received_bytes)) {
+                        /* the PDU stays where it was received */
+                        rx_data->pdu_len = buff_len;
+                        rx_data->pdu = &buff[4];
+                        memmove(&rx_data->src, src, sizeof(BACNET_ADDRESS));
+                        (*msg_data) = rx_data;
+                        data->rx_data = NULL;
                     }
                     /* ignore packets that are too large */
                     else {
@@ -361,8 +375,8 @@ int dl_ip_recv(
             break;
 
         case BVLC_FORWARDED_NPDU:{
-                memcpy(&sin.sin_addr.s_addr, &data->buff[4], 4);
-                memcpy(&sin.sin_port, &data->buff[8], 2);
+                memcpy(&sin.sin_addr.s_addr, &buff[4], 4);
+                memcpy(&sin.sin_port, &buff[8], 2);
                 if ((sin.sin_addr.s_addr == data->local_addr.s_addr) &&
                     (sin.sin_port == data->port)) {
                     buff_len = 0;
@@ -371,20 +385,16 @@ int dl_ip_recv(
                     memcpy(&src->mac[0], &sin.sin_addr.s_addr, 4);
                     memcpy(&src->mac[4], &sin.sin_port, 2);
 
-                    (void) decode_unsigned16(&data->buff[2], &buff_len);
+                    (void) decode_unsigned16(&buff[2], &buff_len);
                     /* subtract off the BVLC header */
                     buff_len -= 10;
-                    if (buff_len < data->max_buff) {
-                        /* allocate data message stucture */
-                        (*msg_data) = (MSG_DATA *) malloc(sizeof(MSG_DATA));
-                        (*msg_data)->pdu_len = buff_len;
-                        (*msg_data)->pdu =
-                            (uint8_t *) malloc((*msg_data)->pdu_len);
-                        /* fill up data message structure */
-                        memmove(&(*msg_data)->pdu[0], &data->buff[4 + 6],
-                            (*msg_data)->pdu_len);
-                        memmove(&(*msg_data)->src, src,
-                            sizeof(BACNET_ADDRESS));
+                    if ((buff_len > 0) && (buff_len + 10 <= received_bytes)) {
+                        /* the PDU stays where it was received */
+                        rx_data->pdu_len = buff_len;
+                        rx_data->pdu = &buff[4 + 6];
+                        memmove(&rx_data->src, src, sizeof(BACNET_ADDRESS));
+                        (*msg_data) = rx_data;
+                        data->rx_data = NULL;
                     } else {
                         /* ignore packets that are too large */
                         buff_len = 0;
@@ -404,9 +414,11 @@ int dl_ip_recv(
 void dl_ip_cleanup(
     IP_DATA * ip_data)
 {
-    /* free buffer */
-    if (ip_data->buff)
-        free(ip_data->buff);
+    /* return the unused receive buffer */
+    if (ip_data->rx_data) {
+        free_data(ip_data->rx_data);
+        ip_data->rx_data = NULL;
+    }
     /* close socket */
     if (ip_data->socket > 0)
         close(ip_data->socket);
@@ -48,8 +48,8 @@ typedef struct ip_data {
     uint16_t port;
     struct in_addr local_addr;
     struct in_addr broadcast_addr;
-    uint8_t *buff;
-    uint16_t max_buff;
+    MSG_POOL *pool;     /* receive buffers of the port */
+    MSG_DATA *rx_data;  /* next buffer to receive into */
 } IP_DATA;
 
 
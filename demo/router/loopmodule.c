@@ -0,0 +1,258 @@
+/**
+* @file
+* @brief In-memory datalink module, used to benchmark the router
+*
+* @section LICENSE
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "loopmodule.h"
+
+/* where the PDUs sent on loopback ports go; none are kept */
+static LOOP_SINK Loop_Sink = NULL;
+
+void *dl_loop_thread(
+    void *pArgs)
+{
+    MSGBOX_ID msgboxid;
+    BACMSG msg_storage, *bacmsg = NULL;
+    MSG_DATA *msg_data;
+    ROUTER_PORT *port = (ROUTER_PORT *) pArgs;
+    LOOP_DATA *loop_data = port->params.loop_params.data;
+    BACNET_ADDRESS address = { 0 };
+    LOOP_SINK sink;
+    uint8_t shutdown = 0;
+
+    /* the port data is allocated with the port, see dl_loop_init() */
+    if (!loop_data) {
+        set_port_state(port, INIT_FAILED);
+        return NULL;
+    }
+
+    msgboxid = create_msgbox();
+    if (msgboxid == INVALID_MSGBOX_ID) {
+        PRINT(ERROR, "Error: Failed to create message box");
+        set_port_state(port, INIT_FAILED);
+        return NULL;
+    }
+
+    port->port_id = msgboxid;
+    set_port_state(port, RUNNING);
+
+    while (!shutdown) {
+
+        /* check for incoming messages */
+        bacmsg = recv_from_msgbox(port->port_id, &msg_storage);
+
+        if (bacmsg) {
+            switch (bacmsg->type) {
+                case DATA:{
+                        msg_data = (MSG_DATA *) bacmsg->data;
+                        memmove(&address.net, &msg_data->dest.net, 2);
+                        memmove(&address.mac_len, &msg_data->dest.len, 1);
+                        memmove(&address.mac[0], &msg_data->dest.adr[0],
+                            MAX_MAC_LEN);
+
+                        sink = __atomic_load_n(&Loop_Sink, __ATOMIC_ACQUIRE);
+                        if (sink) {
+                            sink(port, &address, msg_data->pdu,
+                                msg_data->pdu_len);
+                        }
+
+                        check_data(msg_data);
+
+                        break;
+                    }
+
+                case SERVICE:{
+                        switch (bacmsg->subtype) {
+                            case SHUTDOWN:
+                                del_msgbox(port->port_id);
+                                shutdown = 1;
+                                break;
+                            default:
+                                break;
+                        }
+                        break;
+                    }
+
+                default:
+                    break;
+            }
+        } else if (dl_loop_recv(loop_data, &msg_data) > 0) {
+            msg_storage.origin = port->port_id;
+            msg_storage.type = DATA;
+            msg_storage.data = msg_data;
+
+            if (!forward_msg(port, msg_data) &&
+                !send_to_msgbox(port->main_id, &msg_storage)) {
+                free_data(msg_data);
+            }
+        } else {
+            /* nothing to do: let the other ports run */
+            sched_yield();
+        }
+    }
+
+    /* the queue is emptied by dl_loop_cleanup() */
+    set_port_state(port, FINISHED);
+    return NULL;
+}
+
+/**
+ * Allocates the receive queue of a loopback port and makes up its
+ * address.  This is done with the port, before its thread starts, so
+ * the queue outlives the thread and anyone may inject into it.
+ *
+ * @param port - loopback port
+ * @return true if the queue was allocated
+ */
+bool dl_loop_init(
+    ROUTER_PORT * port)
+{
+    LOOP_DATA *data;
+
+    data = (LOOP_DATA *) calloc(1, sizeof(LOOP_DATA));
+    if (!data)
+        return false;
+    if (pthread_mutex_init(&data->lock, NULL) != 0) {
+        free(data);
+        return false;
+    }
+    data->rx_head = 0;
+    data->rx_count = 0;
+    port->params.loop_params.data = data;
+
+    /* a made up address: 127.0.x.y:47808, where x.y is the network
+       number, or MS/TP station 127 */
+    memset(&port->route_info.mac[0], 0, MAX_MAC_LEN);
+    if (port->params.loop_params.mac_len == 6) {
+        port->route_info.mac[0] = 127;
+        port->route_info.mac[2] = (uint8_t) (port->route_info.net >> 8);
+        port->route_info.mac[3] = (uint8_t) port->route_info.net;
+        port->route_info.mac[4] = 0xBA;
+        port->route_info.mac[5] = 0xC0;
+        port->route_info.mac_len = 6;
+    } else {
+        port->route_info.mac[0] = 127;
+        port->route_info.mac_len = 1;
+    }
+
+    PRINT(INFO, "Loopback port: NET %hu, MAC length %u\n",
+        port->route_info.net, port->route_info.mac_len);
+
+    return true;
+}
+
+/**
+ * Receives a PDU on a loopback port.  The PDU is copied into a buffer
+ * of the port's pool, so a sender that is faster than the router is
+ * held back by the pool running empty, just like a real port.
+ *
+ * @param port - loopback port that receives the PDU
+ * @param src - datalink address of the sender
+ * @param pdu - the NPDU and APDU
+ * @param pdu_len - number of octets in the PDU
+ * @return true if the PDU was queued for the port thread
+ */
+bool dl_loop_inject(
+    ROUTER_PORT * port,
+    BACNET_ADDRESS * src,
+    uint8_t * pdu,
+    uint16_t pdu_len)
+{
+    LOOP_DATA *data;
+    MSG_DATA *msg_data;
+
+    if ((port->type != LOOP) || (get_port_state(port) != RUNNING) ||
+        (pdu_len == 0) || (pdu_len > MSG_MAX_PDU))
+        return false;
+    data = port->params.loop_params.data;
+    if (!data)
+        return false;
+    msg_data = alloc_data(&port->pool);
+    if (!msg_data)
+        return false;
+
+    msg_data->pdu = &msg_data->buff[MSG_HEADROOM + MSG_LINK_HEADER];
+    memcpy(msg_data->pdu, pdu, pdu_len);
+    msg_data->pdu_len = pdu_len;
+    memset(&msg_data->src, 0, sizeof(BACNET_ADDRESS));
+    msg_data->src.len = src->mac_len;
+    memcpy(&msg_data->src.adr[0], &src->mac[0], MAX_MAC_LEN);
+
+    pthread_mutex_lock(&data->lock);
+    data->rx_queue[(data->rx_head + data->rx_count) % MSG_POOL_SIZE] =
+        msg_data;
+    data->rx_count++;
+    pthread_mutex_unlock(&data->lock);
+
+    return true;
+}
+
+int dl_loop_recv(
+    LOOP_DATA * data,
+    MSG_DATA ** msg)
+{
+    MSG_DATA *msg_data = NULL;
+
+    pthread_mutex_lock(&data->lock);
+    if (data->rx_count) {
+        msg_data = data->rx_queue[data->rx_head];
+        data->rx_head = (data->rx_head + 1) % MSG_POOL_SIZE;
+        data->rx_count--;
+    }
+    pthread_mutex_unlock(&data->lock);
+
+    if (!msg_data)
+        return 0;
+    *msg = msg_data;
+
+    return msg_data->pdu_len;
+}
+
+void dl_loop_set_sink(
+    LOOP_SINK sink)
+{
+    __atomic_store_n(&Loop_Sink, sink, __ATOMIC_RELEASE);
+}
+
+/* once the port thread has finished: returns the queued buffers to
+   their pools and frees the queue */
+void dl_loop_cleanup(
+    ROUTER_PORT * port)
+{
+    LOOP_DATA *data = port->params.loop_params.data;
+    MSG_DATA *msg_data;
+
+    if (!data)
+        return;
+    port->params.loop_params.data = NULL;
+    while (dl_loop_recv(data, &msg_data) > 0) {
+        free_data(msg_data);
+    }
+    pthread_mutex_destroy(&data->lock);
+    free(data);
+}
@@ -0,0 +1,77 @@
+/**
+* @file
+* @brief In-memory datalink module, used to benchmark the router
+*
+* @section LICENSE
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef LOOPMODULE_H
+#define LOOPMODULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "portthread.h"
+
+/* called with every PDU that the router sends on a loopback port */
+typedef void (
+    *LOOP_SINK) (
+    ROUTER_PORT * port,
+    BACNET_ADDRESS * dest,
+    uint8_t * pdu,
+    uint16_t pdu_len);
+
+/* received messages waiting for the port thread; the buffers come
+   from the port's pool, so the queue never holds more than the pool */
+typedef struct loop_data {
+    pthread_mutex_t lock;
+    MSG_DATA *rx_queue[MSG_POOL_SIZE];
+    unsigned rx_head;
+    unsigned rx_count;
+} LOOP_DATA;
+
+void *dl_loop_thread(
+    void *pArgs);
+
+/* allocate the port data; before the port thread is started */
+bool dl_loop_init(
+    ROUTER_PORT * port);
+
+/* receive a PDU on a loopback port, as if it came from src */
+bool dl_loop_inject(
+    ROUTER_PORT * port,
+    BACNET_ADDRESS * src,
+    uint8_t * pdu,
+    uint16_t pdu_len);
+
+int dl_loop_recv(
+    LOOP_DATA * data,
+    MSG_DATA ** msg);
+
+void dl_loop_set_sink(
+    LOOP_SINK sink);
+
+/* free the port data; after the port thread has finished */
+void dl_loop_cleanup(
+    ROUTER_PORT * port);
+
+#endif /* end of LOOPMODULE_H */
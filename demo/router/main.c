@@ -46,12 +46,15 @@
 #include <sys/ioctl.h>
 #include <net/if.h>
 #include <pthread.h>
+#include <sched.h>
 #include <termios.h>
 #include "msgqueue.h"
 #include "portthread.h"
 #include "network_layer.h"
 #include "ipmodule.h"
 #include "mstpmodule.h"
+#include "loopmodule.h"
+#include "benchmark.h"
 
 #define KEY_ESC 27
 
@@ -59,6 +62,8 @@ ROUTER_PORT *head = NULL;       /* pointer to list of router ports */
 
 int port_count;
 
+unsigned bench_seconds = 0;     /* run the benchmark if not zero */
+
 void print_help(
     );
 
@@ -69,6 +74,9 @@ bool parse_cmd(
     int argc,
     char *argv[]);
 
+bool init_bench_ports(
+    int networks);
+
 void init_port_threads(
     ROUTER_PORT * port_list);
 
@@ -78,34 +86,22 @@ bool init_router(
 void cleanup(
     );
 
-void print_msg(
-    BACMSG * msg);
-
-uint16_t process_msg(
-    BACMSG * msg,
-    MSG_DATA * data,
-    uint8_t ** buff);
-
 uint16_t get_next_free_dnet(
     );
 
 int kbhit(
     );
 
-inline bool is_network_msg(
-    BACMSG * msg);
-
 int main(
     int argc,
     char *argv[])
 {
     printf("I am router\n");
 
-    ROUTER_PORT *port;
     BACMSG msg_storage, *bacmsg = NULL;
     MSG_DATA *msg_data = NULL;
-    uint8_t *buff = NULL;
-    int16_t buff_len = 0;
+    time_t last_seconds = 0;
+    time_t current_seconds = 0;
 
     atexit(cleanup);
 
@@ -114,6 +110,12 @@ int main(
         return -1;
     }
 
+    /* the port threads call the benchmark as soon as they start */
+    if (bench_seconds && !bench_init(head, bench_seconds)) {
+        printf("bench_init failed\r\n");
+        return -1;
+    }
+
     if (!init_router()) {
         printf("init_router failed\r\n");
         return -1;
@@ -121,9 +123,20 @@ int main(
 
 
     send_network_message(NETWORK_MESSAGE_I_AM_ROUTER_TO_NETWORK, msg_data,
-        &buff, NULL);
+        NULL);
+
+    if (bench_seconds && !bench_start()) {
+        printf("bench_start failed\r\n");
+        return -1;
+    }
 
+    last_seconds = time(NULL);
     while (true) {
+        current_seconds = time(NULL);
+        if (current_seconds != last_seconds) {
+            age_dnets((uint16_t) (current_seconds - last_seconds));
+            last_seconds = current_seconds;
+        }
         if (kbhit()) {
             char ch = getchar();
             if (ch == KEY_ESC) {
@@ -131,86 +144,15 @@ int main(
                 break;
             }
         }
+        if (bench_seconds && bench_finished()) {
+            break;
+        }
 
         bacmsg = recv_from_msgbox(head->main_id, &msg_storage);
         if (bacmsg) {
             switch (bacmsg->type) {
                 case DATA:
-                    {
-                        MSGBOX_ID msg_src = bacmsg->origin;
-
-                        /* allocate message structure */
-                        msg_data = malloc(sizeof(MSG_DATA));
-                        if (!msg_data) {
-                            PRINT(ERROR, "Error: Could not allocate memory\n");
-                            break;
-                        }
-
-                        print_msg(bacmsg);
-
-                        if (is_network_msg(bacmsg)) {
-                            buff_len =
-                                process_network_message(bacmsg, msg_data,
-                                &buff);
-                            if (buff_len == 0) {
-                                free_data(bacmsg->data);
-                                break;
-                            }
-                        } else {
-                            buff_len = process_msg(bacmsg, msg_data, &buff);
-                        }
-
-                        /* if buff_len */
-                        /* >0 - form new message and send */
-                        /* =-1 - try to find next router */
-                        /* other value - discard message */
-
-                        if (buff_len > 0) {
-                            /* form new message */
-                            msg_data->pdu = buff;
-                            msg_data->pdu_len = buff_len;
-                            msg_storage.origin = head->main_id;
-                            msg_storage.type = DATA;
-                            msg_storage.data = msg_data;
-
-                            print_msg(bacmsg);
-
-                            if (is_network_msg(bacmsg)) {
-                                msg_data->ref_count = 1;
-                                send_to_msgbox(msg_src, &msg_storage);
-                            } else if (msg_data->dest.net !=
-                                BACNET_BROADCAST_NETWORK) {
-                                msg_data->ref_count = 1;
-                                port =
-                                    find_dnet(msg_data->dest.net,
-                                    &msg_data->dest);
-                                send_to_msgbox(port->port_id, &msg_storage);
-                            } else {
-                                port = head;
-                                msg_data->ref_count = port_count - 1;
-                                while (port != NULL) {
-                                    if (port->port_id == msg_src ||
-                                        port->state == FINISHED) {
-                                        port = port->next;
-                                        continue;
-                                    }
-                                    send_to_msgbox(port->port_id,
-                                        &msg_storage);
-                                    port = port->next;
-                                }
-                            }
-                        } else if (buff_len == -1) {
-                            uint16_t net = msg_data->dest.net;  /* NET to find */
-                            PRINT(INFO, "Searching NET...\n");
-                            send_network_message
-                                (NETWORK_MESSAGE_WHO_IS_ROUTER_TO_NETWORK,
-                                msg_data, &buff, &net);
-                        } else {
-                            /* if invalid message send Reject-Message-To-Network */
-                            PRINT(ERROR, "Error: Invalid message\n");
-                            free_data(msg_data);
-                        }
-                    }
+                    route_main_msg(bacmsg);
                     break;
                 case SERVICE:
                 default:
@@ -229,6 +171,7 @@ void print_help(
     printf("Usage: router <init_method> [init_parameters]\n" "\ninit_method:\n"
         "-c, --config <filepath>\n\tinitialize router with a configuration file (.cfg) located at <filepath>\n"
         "-D, --device <dev_type> <iface> [params]\n\tinitialize a <dev_type> device using an <iface> interface specified with\n\t[params]\n"
+        "-B, --bench <networks> [seconds]\n\tmeasure routing between <networks> in-memory networks for [seconds]\n\t(default 10)\n"
         "\ninit_parameters:\n"
         "-n, --network <net>\n\tspecify device network number\n"
         "-P, --port <port>\n\tspecify udp port for BIP device\n"
@@ -443,12 +386,13 @@ bool parse_cmd(
     int argc,
     char *argv[])
 {
-    const char *optString = "hc:D:";
+    const char *optString = "hc:D:B:";
     const char *bipString = "p:n:D:";
     const char *mstpString = "m:b:p:d:s:n:D:";
     const struct option Options[] = {
         {"config", required_argument, NULL, 'c'},
         {"device", required_argument, NULL, 'D'},
+        {"bench", required_argument, NULL, 'B'},
         {"network", required_argument, NULL, 'n'},
         {"port", required_argument, NULL, 'P'},
         {"mac", required_argument, NULL, 'm'},
@@ -481,6 +425,15 @@ bool parse_cmd(
             case 'c':
                 return read_config(optarg);
                 break;
+            case 'B':
+                bench_seconds = 10;
+                if (optind < argc && argv[optind][0] != '-') {
+                    result = atoi(argv[optind]);
+                    if (result > 0)
+                        bench_seconds = (unsigned) result;
+                }
+                return init_bench_ports(atoi(optarg));
+                break;
             case 'D':
 
                 /* create new list node to store port information */
@@ -671,6 +624,51 @@ bool parse_cmd(
     return true;
 }
 
+/* loopback ports for NETs 1 to networks; the odd ones look like
+   BACnet/IP and the even ones like MS/TP */
+bool init_bench_ports(
+    int networks)
+{
+    ROUTER_PORT *current = NULL;
+    ROUTER_PORT *port;
+    int i;
+
+    if (head != NULL || networks < 2 || networks > BENCH_MAX_NETWORKS) {
+        PRINT(ERROR, "Error: benchmark needs 2 to %d networks\n",
+            BENCH_MAX_NETWORKS);
+        return false;
+    }
+
+    for (i = 1; i <= networks; i++) {
+        port = (ROUTER_PORT *) calloc(1, sizeof(ROUTER_PORT));
+        if (!port)
+            return false;
+        port->iface = (char *) malloc(16);
+        if (!port->iface) {
+            free(port);
+            return false;
+        }
+        snprintf(port->iface, 16, "loop%d", i);
+        port->type = LOOP;
+        port->route_info.net = (uint16_t) i;
+        port->params.loop_params.mac_len = (i % 2) ? 6 : 1;
+        if (!dl_loop_init(port)) {
+            free(port->iface);
+            free(port);
+            return false;
+        }
+        if (current == NULL) {
+            head = port;
+        } else {
+            current->next = port;
+        }
+        current = port;
+        port_count++;
+    }
+
+    return true;
+}
+
 void init_port_threads(
     ROUTER_PORT * port_list)
 {
@@ -685,6 +683,9 @@ void init_port_threads(
             case MSTP:
                 port->func = &dl_mstp_thread;
                 break;
+            case LOOP:
+                port->func = &dl_loop_thread;
+                break;
         }
 
         port->state = INIT;
@@ -707,10 +708,20 @@ bool init_router(
     if (msgboxid == INVALID_MSGBOX_ID)
         return false;
 
+    /* all message buffers are allocated here, none while routing */
+    if (!msg_pool_init(&msg_pool, MSG_POOL_SIZE))
+        return false;
     port = head;
-    /* add main message box id to all ports */
+    /* add main message box id and message buffers to all ports */
     while (port != NULL) {
         port->main_id = msgboxid;
+        if (!msg_pool_init(&port->pool, MSG_POOL_SIZE))
+            return false;
+        if (!add_port_net(port)) {
+            PRINT(ERROR, "Error: NET %hu is not unique\n",
+                port->route_info.net);
+            return false;
+        }
         port = port->next;
     }
 
@@ -719,10 +730,11 @@ bool init_router(
     /* wait for port initialization */
     port = head;
     while (port != NULL) {
-        if (port->state == RUNNING) {
+        PORT_STATE state = get_port_state(port);
+        if (state == RUNNING) {
             port = port->next;
             continue;
-        } else if (port->state == INIT_FAILED) {
+        } else if (state == INIT_FAILED) {
             PRINT(ERROR, "Error: Failed to initialize %s\n", port->iface);
             return false;
         } else {
@@ -744,6 +756,9 @@ void cleanup(
     if (head == NULL)
         return;
 
+    /* the benchmark injects into the ports */
+    bench_stop();
+
     msg.origin = head->main_id;
     msg.type = SERVICE;
     msg.subtype = SHUTDOWN;
@@ -753,98 +768,35 @@ void cleanup(
     /* send shutdown message to all router ports */
     port = head;
     while (port != NULL) {
-        if (port->state == RUNNING)
+        if (get_port_state(port) == RUNNING)
             send_to_msgbox(port->port_id, &msg);
         port = port->next;
     }
 
+    /* wait for every port, since a port may still hold message
+       buffers from the pool of another port */
     port = head;
     while (port != NULL) {
-        if (port->state == FINISHED) {
-            cleanup_dnets(port->route_info.dnets);
-            port = port->next;
-            free(head->iface);
-            free(head);
-            head = port;
-        }
-    }
-
-    pthread_mutex_destroy(&msg_lock);
-}
-
-void print_msg(
-    BACMSG * msg)
-{
-    if (msg->type == DATA) {
-        int i;
-        MSG_DATA *data = (MSG_DATA *) msg->data;
-
-        if (data->pdu_len) {
-            PRINT(DEBUG, "Message PDU: ");
-            for (i = 0; i < data->pdu_len; i++)
-                PRINT(DEBUG, "%02X ", data->pdu[i]);
-            PRINT(DEBUG, "\n");
+        if (get_port_state(port) == RUNNING) {
+            sched_yield();
+            continue;
         }
+        port = port->next;
     }
-}
-
-uint16_t process_msg(
-    BACMSG * msg,
-    MSG_DATA * data,
-    uint8_t ** buff)
-{
 
-    BACNET_ADDRESS addr;
-    BACNET_NPDU_DATA npdu_data;
-    ROUTER_PORT *srcport;
-    ROUTER_PORT *destport;
-    uint8_t npdu[MAX_NPDU];
-    int16_t buff_len = 0;
-    int apdu_offset;
-    int apdu_len;
-    int npdu_len;
-
-    memmove(data, msg->data, sizeof(MSG_DATA));
-
-    apdu_offset = npdu_decode(data->pdu, &data->dest, &addr, &npdu_data);
-    apdu_len = data->pdu_len - apdu_offset;
-
-    srcport = find_snet(msg->origin);
-    destport = find_dnet(data->dest.net, NULL);
-    assert(srcport);
-
-    if (srcport && destport) {
-        data->src.net = srcport->route_info.net;
-
-        /* if received from another router save real source address (not other router source address) */
-        if (addr.net > 0 && addr.net < BACNET_BROADCAST_NETWORK &&
-            data->src.net != addr.net)
-            memmove(&data->src, &addr, sizeof(BACNET_ADDRESS));
-
-        /* encode both source and destination for broadcast and router-to-router communication */
-        if (data->dest.net == BACNET_BROADCAST_NETWORK ||
-            destport->route_info.net != data->dest.net) {
-            npdu_len =
-                npdu_encode_pdu(npdu, &data->dest, &data->src, &npdu_data);
-        } else {
-            npdu_len = npdu_encode_pdu(npdu, NULL, &data->src, &npdu_data);
-        }
-
-        buff_len = npdu_len + data->pdu_len - apdu_offset;
-
-        *buff = (uint8_t *) malloc(buff_len);
-        memmove(*buff, npdu, npdu_len); /* copy newly formed NPDU */
-        memmove(*buff + npdu_len, &data->pdu[apdu_offset], apdu_len);   /* copy APDU */
-
-    } else {
-        /* request net search */
-        return -1;
+    port = head;
+    while (port != NULL) {
+        if (port->type == LOOP)
+            dl_loop_cleanup(port);
+        cleanup_dnets(port->route_info.dnets);
+        msg_pool_cleanup(&port->pool);
+        port = port->next;
+        free(head->iface);
+        free(head);
+        head = port;
     }
 
-    /* delete received message */
-    free_data((MSG_DATA *) msg->data);
-
-    return buff_len;
+    msg_pool_cleanup(&msg_pool);
 }
 
 int kbhit(
@@ -868,18 +820,6 @@ int kbhit(
     return bytesWaiting;
 }
 
-bool is_network_msg(
-    BACMSG * msg)
-{
-
-    uint8_t control_byte;       /* NPDU control byte */
-    MSG_DATA *data = (MSG_DATA *) msg->data;
-
-    control_byte = data->pdu[1];
-
-    return control_byte & 0x80; /* check 7th bit */
-}
-
 uint16_t get_next_free_dnet(
     )
 {
@@ -33,7 +33,7 @@
 #include <pthread.h>
 #include "msgqueue.h"
 
-pthread_mutex_t msg_lock = PTHREAD_MUTEX_INITIALIZER;
+MSG_POOL msg_pool;
 
 MSGBOX_ID create_msgbox(
     )
@@ -55,7 +55,9 @@ bool send_to_msgbox(
 
     int err;
 
-    err = msgsnd(dest, msg, sizeof(BACMSG)-sizeof(MSGTYPE), 0);
+    /* msgsnd() needs a positive type; the rest is the message text */
+    msg->mtype = 1;
+    err = msgsnd(dest, msg, sizeof(BACMSG) - sizeof(long), 0);
     if (err) {
         return false;
     }
@@ -69,7 +71,8 @@ BACMSG *recv_from_msgbox(
 
     int recv_bytes;
 
-    recv_bytes = msgrcv(src, msg, sizeof(BACMSG)-sizeof(MSGTYPE), 0, IPC_NOWAIT);
+    recv_bytes =
+        msgrcv(src, msg, sizeof(BACMSG) - sizeof(long), 0, IPC_NOWAIT);
     if (recv_bytes > 0) {
         return msg;
     } else {
@@ -87,28 +90,201 @@ void del_msgbox(
         msgctl(msgboxid, IPC_RMID, NULL);
 }
 
+/**
+ * Allocates the buffers of a pool.  This is the only allocation made
+ * for messages: after it, buffers only move between the pool and the
+ * message boxes.
+ *
+ * @param pool - pool to initialize
+ * @param count - number of message buffers
+ * @return true if the buffers were allocated
+ */
+bool msg_pool_init(
+    MSG_POOL * pool,
+    unsigned count)
+{
+    unsigned i;
+
+    pool->block = (MSG_DATA *) calloc(count, sizeof(MSG_DATA));
+    if (!pool->block) {
+        pool->free_list = NULL;
+        pool->count = 0;
+        return false;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pool->free_list = NULL;
+    for (i = 0; i < count; i++) {
+        pool->block[i].pool = pool;
+        pool->block[i].next = pool->free_list;
+        pool->free_list = &pool->block[i];
+    }
+    pool->count = count;
+
+    return true;
+}
+
+void msg_pool_cleanup(
+    MSG_POOL * pool)
+{
+    if (pool->block) {
+        free(pool->block);
+        pool->block = NULL;
+        pool->free_list = NULL;
+        pool->count = 0;
+        pthread_mutex_destroy(&pool->lock);
+    }
+}
+
+/**
+ * Takes a buffer from a pool.  The PDU starts after the headroom.
+ *
+ * @param pool - pool of the thread that fills the buffer
+ * @return message data structure, or NULL if the pool is empty
+ */
+MSG_DATA *alloc_data(
+    MSG_POOL * pool)
+{
+    MSG_DATA *data;
+
+    pthread_mutex_lock(&pool->lock);
+    data = pool->free_list;
+    if (data) {
+        pool->free_list = data->next;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    if (data) {
+        data->next = NULL;
+        data->pdu = &data->buff[MSG_HEADROOM];
+        data->pdu_len = 0;
+        data->ref_count = 0;
+    }
+
+    return data;
+}
+
 void free_data(
     MSG_DATA * data)
 {
+    MSG_POOL *pool;
 
-    if (data->pdu) {
-        free(data->pdu);
-        data->pdu = NULL;
-    }
     if (data) {
-        free(data);
-        data = NULL;
+        pool = data->pool;
+        pthread_mutex_lock(&pool->lock);
+        data->next = pool->free_list;
+        pool->free_list = data;
+        pthread_mutex_unlock(&pool->lock);
     }
 }
 
 void check_data(
     MSG_DATA * data)
 {
-
-    /* lock and decrement messages reference count */
-    pthread_mutex_lock(&msg_lock);
-    if (--data->ref_count == 0) {
+    /* decrement messages reference count; the last port frees it */
+    if (__atomic_sub_fetch(&data->ref_count, 1, __ATOMIC_ACQ_REL) == 0) {
         free_data(data);
     }
-    pthread_mutex_unlock(&msg_lock);
 }
+
+#ifdef TEST
+#include <assert.h>
+#include "ctest.h"
+
+#define TEST_POOL_SIZE 3
+
+void testMsgPool(
+    Test * pTest)
+{
+    MSG_POOL pool;
+    MSG_DATA *data[TEST_POOL_SIZE];
+    MSG_DATA *extra;
+    unsigned i;
+
+    ct_test(pTest, msg_pool_init(&pool, TEST_POOL_SIZE));
+    ct_test(pTest, pool.count == TEST_POOL_SIZE);
+    for (i = 0; i < TEST_POOL_SIZE; i++) {
+        data[i] = alloc_data(&pool);
+        ct_test(pTest, data[i] != NULL);
+        ct_test(pTest, data[i]->pool == &pool);
+        ct_test(pTest, data[i]->pdu == &data[i]->buff[MSG_HEADROOM]);
+        ct_test(pTest, data[i]->pdu_len == 0);
+        ct_test(pTest, data[i]->ref_count == 0);
+    }
+    /* the pool does not grow */
+    ct_test(pTest, alloc_data(&pool) == NULL);
+    /* a freed buffer is the next one out, reset for use */
+    data[1]->pdu = &data[1]->buff[0];
+    data[1]->pdu_len = 10;
+    free_data(data[1]);
+    extra = alloc_data(&pool);
+    ct_test(pTest, extra == data[1]);
+    ct_test(pTest, extra->pdu == &extra->buff[MSG_HEADROOM]);
+    ct_test(pTest, extra->pdu_len == 0);
+    ct_test(pTest, alloc_data(&pool) == NULL);
+    /* a buffer shared by ports goes back with the last reference */
+    data[0]->ref_count = 3;
+    check_data(data[0]);
+    check_data(data[0]);
+    ct_test(pTest, data[0]->ref_count == 1);
+    ct_test(pTest, alloc_data(&pool) == NULL);
+    check_data(data[0]);
+    ct_test(pTest, alloc_data(&pool) == data[0]);
+    free_data(NULL);
+    msg_pool_cleanup(&pool);
+    ct_test(pTest, pool.block == NULL);
+    ct_test(pTest, pool.count == 0);
+}
+
+void testMsgBox(
+    Test * pTest)
+{
+    MSGBOX_ID box;
+    BACMSG msg, received;
+    int value = 42;
+
+    box = create_msgbox();
+    ct_test(pTest, box != INVALID_MSGBOX_ID);
+    ct_test(pTest, recv_from_msgbox(box, &received) == NULL);
+    memset(&msg, 0, sizeof(msg));
+    msg.type = DATA;
+    msg.origin = 7;
+    msg.data = &value;
+    ct_test(pTest, send_to_msgbox(box, &msg));
+    msg.type = SERVICE;
+    msg.subtype = SHUTDOWN;
+    msg.data = NULL;
+    ct_test(pTest, send_to_msgbox(box, &msg));
+    /* messages come out in the order they went in */
+    ct_test(pTest, recv_from_msgbox(box, &received) == &received);
+    ct_test(pTest, received.type == DATA);
+    ct_test(pTest, received.origin == 7);
+    ct_test(pTest, received.data == &value);
+    ct_test(pTest, recv_from_msgbox(box, &received) == &received);
+    ct_test(pTest, received.type == SERVICE);
+    ct_test(pTest, received.subtype == SHUTDOWN);
+    ct_test(pTest, recv_from_msgbox(box, &received) == NULL);
+    del_msgbox(box);
+}
+
+#ifdef TEST_MSGQUEUE
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet Router Message Queue", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testMsgPool);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testMsgBox);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif
+#endif
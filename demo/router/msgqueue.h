@@ -31,16 +31,29 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/msg.h>
 #include "bacdef.h"
 #include "npdu.h"
 
-extern pthread_mutex_t msg_lock;
-
 #define INVALID_MSGBOX_ID -1
 
+/* room kept in front of a received NPDU, so that routing can write
+   a longer NPDU header in place */
+#define MSG_HEADROOM MAX_NPDU
+/* datalink header that is received along with the NPDU */
+#define MSG_LINK_HEADER 10
+/* largest NPDU that a router port can receive */
+#define MSG_MAX_PDU (MAX_NPDU + 1476)
+#define MSG_BUFF_SIZE (MSG_HEADROOM + MSG_LINK_HEADER + MSG_MAX_PDU)
+
+/* message buffers in each pool */
+#ifndef MSG_POOL_SIZE
+#define MSG_POOL_SIZE 64
+#endif
+
 typedef int MSGBOX_ID;
 
 typedef enum {
@@ -55,6 +68,7 @@ typedef enum {
 } MSGSUBTYPE;
 
 typedef struct _message {
+    long mtype; /* message type of msgsnd(), set by send_to_msgbox() */
     MSGTYPE type;
     MSGBOX_ID origin;
     MSGSUBTYPE subtype;
@@ -62,15 +76,31 @@ typedef struct _message {
     /* add timestamp */
 } BACMSG;
 
+struct _msg_data;
+
+/* fixed number of message buffers, allocated once at startup */
+typedef struct _msg_pool {
+    pthread_mutex_t lock;
+    struct _msg_data *free_list;
+    struct _msg_data *block;
+    unsigned count;
+} MSG_POOL;
+
 /* specific message type data structures */
 typedef struct _msg_data {
     BACNET_ADDRESS dest;
     BACNET_ADDRESS src;
-    uint8_t *pdu;
+    uint8_t *pdu;       /* points into buff */
     uint16_t pdu_len;
-    uint8_t ref_count;
+    uint8_t ref_count;  /* changed atomically */
+    MSG_POOL *pool;     /* pool that the buffer returns to */
+    struct _msg_data *next;     /* next free buffer in the pool */
+    uint8_t buff[MSG_BUFF_SIZE];
 } MSG_DATA;
 
+/* buffers for messages that the router creates itself */
+extern MSG_POOL msg_pool;
+
 MSGBOX_ID create_msgbox(
     );
 
@@ -87,7 +117,18 @@ BACMSG *recv_from_msgbox(
 void del_msgbox(
     MSGBOX_ID msgboxid);
 
-/* free message data structure */
+bool msg_pool_init(
+    MSG_POOL * pool,
+    unsigned count);
+
+void msg_pool_cleanup(
+    MSG_POOL * pool);
+
+/* get a message data structure from the pool, or NULL if none is free */
+MSG_DATA *alloc_data(
+    MSG_POOL * pool);
+
+/* return message data structure to its pool */
 void free_data(
     MSG_DATA * data);
 
@@ -95,4 +136,12 @@ void free_data(
 void check_data(
     MSG_DATA * data);
 
+#ifdef TEST
+#include "ctest.h"
+void testMsgPool(
+    Test * pTest);
+void testMsgBox(
+    Test * pTest);
+#endif
+
 #endif /* end of MSGQUEUE_H */
@@ -98,11 +98,11 @@ void *dl_mstp_thread(
 
     port->port_id = create_msgbox();
     if (port->port_id == INVALID_MSGBOX_ID) {
-        port->state = INIT_FAILED;
+        set_port_state(port, INIT_FAILED);
         return NULL;
     }
 
-    port->state = RUNNING;
+    set_port_state(port, RUNNING);
 
     while (!shutdown) {
         /* message loop */
@@ -147,13 +147,16 @@ void *dl_mstp_thread(
             pdu_len = dlmstp_receive(&mstp_port, NULL, NULL, 0, 5);
 
             if (pdu_len > 0) {
-                msg_data = (MSG_DATA *) malloc(sizeof(MSG_DATA));
+                msg_data = alloc_data(&port->pool);
+                if (!msg_data) {
+                    /* every buffer is in use: drop the frame */
+                    continue;
+                }
                 memmove(&(msg_data->src),
                     (const void *) &(shared_port_data.Receive_Packet.address),
                     sizeof(shared_port_data.Receive_Packet.address));
                 msg_data->src.adr[0] = msg_data->src.mac[0];
                 msg_data->src.len = 1;
-                msg_data->pdu = (uint8_t *) malloc(pdu_len);
                 memmove(msg_data->pdu,
                     (const void *) &(shared_port_data.Receive_Packet.pdu),
                     pdu_len);
@@ -164,7 +167,10 @@ void *dl_mstp_thread(
                 msg_storage.origin = port->port_id;
                 msg_storage.data = msg_data;
 
-                if (!send_to_msgbox(port->main_id, &msg_storage)) {
+                /* route it here if possible, so that the ports forward
+                   in parallel; the rest goes to the main thread */
+                if (!forward_msg(port, msg_data) &&
+                    !send_to_msgbox(port->main_id, &msg_storage)) {
                     free_data(msg_data);
                 }
             }
@@ -172,7 +178,7 @@ void *dl_mstp_thread(
     }
 
     dlmstp_cleanup(&mstp_port);
-    port->state = FINISHED;
+    set_port_state(port, FINISHED);
 
     return NULL;
 
@@ -34,8 +34,7 @@
 
 uint16_t process_network_message(
     BACMSG * msg,
-    MSG_DATA * data,
-    uint8_t ** buff)
+    MSG_DATA * data)
 {
 
     BACNET_NPDU_DATA npdu_data;
@@ -47,8 +46,6 @@ uint16_t process_network_message(
     int apdu_offset;
     int apdu_len;
 
-    memmove(data, msg->data, sizeof(MSG_DATA));
-
     apdu_offset = npdu_decode(data->pdu, &data->dest, NULL, &npdu_data);
     apdu_len = data->pdu_len - apdu_offset;
 
@@ -73,8 +70,7 @@ uint16_t process_network_message(
                     PRINT(INFO, "Sending I-Am-Router-To-Network message\n");
                     buff_len =
                         create_network_message
-                        (NETWORK_MESSAGE_I_AM_ROUTER_TO_NETWORK, data, buff,
-                        &net);
+                        (NETWORK_MESSAGE_I_AM_ROUTER_TO_NETWORK, data, &net);
                 } else {
                     data->dest.net = net;       /* NET to look for */
                     return -1;  /* else initiate NET search procedure */
@@ -84,7 +80,7 @@ uint16_t process_network_message(
                 PRINT(INFO, "Sending I-Am-Router-To-Network message\n");
                 buff_len =
                     create_network_message
-                    (NETWORK_MESSAGE_I_AM_ROUTER_TO_NETWORK, data, buff, NULL);
+                    (NETWORK_MESSAGE_I_AM_ROUTER_TO_NETWORK, data, NULL);
             }
 
             break;
@@ -96,7 +92,7 @@ uint16_t process_network_message(
                 int i;
                 for (i = 0; i < net_count; i++) {
                     decode_unsigned16(&data->pdu[apdu_offset + 2 * i], &net);   /* decode received NET values */
-                    add_dnet(&srcport->route_info, net, data->src);     /* and update routing table */
+                    add_dnet(srcport, net, data->src);  /* and update routing table */
                 }
                 break;
             }
@@ -128,44 +124,59 @@ uint16_t process_network_message(
             PRINT(INFO, "Recieved Initialize-Routing-Table message\n");
             if (data->pdu[apdu_offset] > 0) {
                 int net_count = data->pdu[apdu_offset];
-                while (net_count--) {
-                    int i = 1;
+                int i = 1;
+                while (net_count-- && (i + 4 <= apdu_len)) {
                     decode_unsigned16(&data->pdu[apdu_offset + i], &net);       /* decode received NET values */
-                    add_dnet(&srcport->route_info, net, data->src);     /* and update routing table */
-                    if (data->pdu[apdu_offset + i + 3] > 0)     /* find next NET value */
-                        i = data->pdu[apdu_offset + i + 3] + 4;
-                    else
-                        i = i + 4;
+                    add_dnet(srcport, net, data->src);  /* and update routing table */
+                    /* find next NET value, after the port info */
+                    i += 4 + data->pdu[apdu_offset + i + 3];
                 }
                 buff_len =
                     create_network_message(NETWORK_MESSAGE_INIT_RT_TABLE_ACK,
-                    data, buff, NULL);
+                    data, NULL);
             } else
                 buff_len =
                     create_network_message(NETWORK_MESSAGE_INIT_RT_TABLE_ACK,
-                    data, buff, &buff);
+                    data, &port_count);
             break;
 
         case NETWORK_MESSAGE_INIT_RT_TABLE_ACK:
             PRINT(INFO, "Recieved Initialize-Routing-Table-Ack message\n");
             if (data->pdu[apdu_offset] > 0) {
                 int net_count = data->pdu[apdu_offset];
-                while (net_count--) {
-                    int i = 1;
+                int i = 1;
+                while (net_count-- && (i + 4 <= apdu_len)) {
                     decode_unsigned16(&data->pdu[apdu_offset + i], &net);       /* decode received NET values */
-                    add_dnet(&srcport->route_info, net, data->src);     /* and update routing table */
-                    if (data->pdu[apdu_offset + i + 3] > 0)     /* find next NET value */
-                        i = data->pdu[apdu_offset + i + 3] + 4;
-                    else
-                        i = i + 4;
+                    add_dnet(srcport, net, data->src);  /* and update routing table */
+                    /* find next NET value, after the port info */
+                    i += 4 + data->pdu[apdu_offset + i + 3];
                 }
             }
             break;
 
-        case NETWORK_MESSAGE_INVALID:
-        case NETWORK_MESSAGE_I_COULD_BE_ROUTER_TO_NETWORK:
         case NETWORK_MESSAGE_ROUTER_BUSY_TO_NETWORK:
         case NETWORK_MESSAGE_ROUTER_AVAILABLE_TO_NETWORK:
+            {
+                bool busy = (npdu_data.network_message_type ==
+                    NETWORK_MESSAGE_ROUTER_BUSY_TO_NETWORK);
+                int net_count = apdu_len / 2;
+                int i;
+
+                PRINT(INFO, "Recieved Router-%s-To-Network message\n",
+                    busy ? "Busy" : "Available");
+                if (net_count == 0) {
+                    /* every network served by the router */
+                    set_dnet_busy(srcport, BACNET_BROADCAST_NETWORK,
+                        &data->src, busy);
+                }
+                for (i = 0; i < net_count; i++) {
+                    decode_unsigned16(&data->pdu[apdu_offset + 2 * i], &net);
+                    set_dnet_busy(srcport, net, &data->src, busy);
+                }
+                break;
+            }
+        case NETWORK_MESSAGE_INVALID:
+        case NETWORK_MESSAGE_I_COULD_BE_ROUTER_TO_NETWORK:
         case NETWORK_MESSAGE_ESTABLISH_CONNECTION_TO_NETWORK:
         case NETWORK_MESSAGE_DISCONNECT_CONNECTION_TO_NETWORK:
             /* hell if I know what to do with these messages */
@@ -184,7 +195,7 @@ uint16_t process_network_message(
         case NETWORK_MESSAGE_WHAT_IS_NETWORK_NUMBER:
             buff_len =
                 create_network_message(NETWORK_MESSAGE_NETWORK_NUMBER_IS,
-                data, buff, &buff);
+                data, &port_count);
             break;
 
 
@@ -199,10 +210,10 @@ uint16_t process_network_message(
 uint16_t create_network_message(
     BACNET_NETWORK_MESSAGE_TYPE network_message_type,
     MSG_DATA * data,
-    uint8_t ** buff,
     void *val)
 {
 
+    uint8_t *buff = &data->buff[0];
     int16_t buff_len;
     bool data_expecting_reply = false;
     BACNET_NPDU_DATA npdu_data;
@@ -211,11 +222,9 @@ uint16_t create_network_message(
         data_expecting_reply = true;
     init_npdu(&npdu_data, network_message_type, data_expecting_reply);
 
-    *buff = (uint8_t *) malloc(128);    /* resolve different length */
-
     /* manual destination setup for Init-RT-Table-Ack message */
     data->dest.net = BACNET_BROADCAST_NETWORK;
-    buff_len = npdu_encode_pdu(*buff, &data->dest, NULL, &npdu_data);
+    buff_len = npdu_encode_pdu(buff, &data->dest, NULL, &npdu_data);
 
     switch (network_message_type) {
 
@@ -223,7 +232,7 @@ uint16_t create_network_message(
             if (val != NULL) {
                 uint8_t *valptr = (uint8_t *) val;
                 uint16_t val16 = (valptr[0]) + (valptr[1] << 8);
-                buff_len += encode_unsigned16(*buff + buff_len, val16);
+                buff_len += encode_unsigned16(buff + buff_len, val16);
             }
             break;
 
@@ -231,19 +240,19 @@ uint16_t create_network_message(
             if (val != NULL) {
                 uint8_t *valptr = (uint8_t *) val;
                 uint16_t val16 = (valptr[0]) + (valptr[1] << 8);
-                buff_len += encode_unsigned16(*buff + buff_len, val16);
+                buff_len += encode_unsigned16(buff + buff_len, val16);
             } else {
                 ROUTER_PORT *port = head;
                 DNET *dnet;
                 while (port != NULL) {
                     if (port->route_info.net != data->src.net) {
                         buff_len +=
-                            encode_unsigned16(*buff + buff_len,
+                            encode_unsigned16(buff + buff_len,
                             port->route_info.net);
                         dnet = port->route_info.dnets;
                         while (dnet != NULL) {
                             buff_len +=
-                                encode_unsigned16(*buff + buff_len, dnet->net);
+                                encode_unsigned16(buff + buff_len, dnet->net);
                             dnet = dnet->next;
                         }
                         port = port->next;
@@ -251,7 +260,7 @@ uint16_t create_network_message(
                         dnet = port->route_info.dnets;
                         while (dnet != NULL) {
                             buff_len +=
-                                encode_unsigned16(*buff + buff_len, dnet->net);
+                                encode_unsigned16(buff + buff_len, dnet->net);
                             dnet = dnet->next;
                         }
                         port = port->next;
@@ -264,13 +273,13 @@ uint16_t create_network_message(
             {
                 uint8_t *valptr = (uint8_t *) val;
                 uint16_t val16 = (valptr[0]) + (valptr[1] << 8);
-                buff_len += encode_unsigned16(*buff + buff_len, val16);
+                buff_len += encode_unsigned16(buff + buff_len, val16);
                 break;
             }
         case NETWORK_MESSAGE_INIT_RT_TABLE:
         case NETWORK_MESSAGE_INIT_RT_TABLE_ACK:
             if ((uint8_t *) val) {
-                (*buff)[buff_len++] = (uint8_t) port_count;
+                buff[buff_len++] = (uint8_t) port_count;
 
                 if (port_count > 0) {
                     ROUTER_PORT *port = head;
@@ -278,15 +287,15 @@ uint16_t create_network_message(
 
                     while (port != NULL) {
                         buff_len +=
-                            encode_unsigned16(*buff + buff_len,
+                            encode_unsigned16(buff + buff_len,
                             port->route_info.net);
-                        (*buff)[buff_len++] = portID++;
-                        (*buff)[buff_len++] = 0;
+                        buff[buff_len++] = portID++;
+                        buff[buff_len++] = 0;
                         port = port->next;
                     }
                 }
             } else
-                (*buff)[buff_len++] = (uint8_t) 0;
+                buff[buff_len++] = (uint8_t) 0;
             break;
 
         case NETWORK_MESSAGE_INVALID:
@@ -313,6 +322,8 @@ uint16_t create_network_message(
         default:
             break;
     }
+    data->pdu = buff;
+    data->pdu_len = buff_len;
 
     return buff_len;
 }
@@ -320,36 +331,50 @@ uint16_t create_network_message(
 void send_network_message(
     BACNET_NETWORK_MESSAGE_TYPE network_message_type,
     MSG_DATA * data,
-    uint8_t ** buff,
     void *val)
 {
 
     BACMSG msg;
     ROUTER_PORT *port = head;
-    int16_t buff_len;
+    uint8_t ref_count = 0;
 
     if (!data) {
-        data = (MSG_DATA *) malloc(sizeof(MSG_DATA));
+        data = alloc_data(&msg_pool);
+        if (!data) {
+            PRINT(ERROR, "Error: No free message buffer\n");
+            return;
+        }
         data->dest.net = BACNET_BROADCAST_NETWORK;
         data->dest.len = 0;
     }
 
-    buff_len = create_network_message(network_message_type, data, buff, val);
+    create_network_message(network_message_type, data, val);
 
     /* form network message */
-    data->pdu = *buff;
-    data->pdu_len = buff_len;
     msg.origin = head->main_id;
     msg.type = DATA;
     msg.data = data;
 
-    data->ref_count = port_count;
+    /* count the receivers first: the first one may be done with the
+       message before it has been sent to the last one */
     while (port != NULL) {
-        if (port->state == FINISHED) {
-            port = port->next;
-            continue;
+        if (get_port_state(port) != FINISHED) {
+            ref_count++;
+        }
+        port = port->next;
+    }
+    if (ref_count == 0) {
+        free_data(data);
+        return;
+    }
+    data->ref_count = ref_count;
+    port = head;
+    while (port != NULL) {
+        if (get_port_state(port) != FINISHED) {
+            if (!send_to_msgbox(port->port_id, &msg)) {
+                check_data(data);
+            }
         }
-        send_to_msgbox(port->port_id, &msg);
         port = port->next;
     }
 }
@@ -370,3 +395,93 @@ void init_npdu(
         npdu_data->hop_count = HOP_COUNT_DEFAULT;
     }
 }
+
+/**
+ * Handles a message that a port thread passed to the main thread:
+ * a network layer message, or one that the port could not route
+ * alone.
+ *
+ * @param bacmsg - message received on the main message box
+ */
+void route_main_msg(
+    BACMSG * bacmsg)
+{
+    BACMSG msg;
+    MSGBOX_ID msg_src = bacmsg->origin;
+    /* the received buffer is routed in place */
+    MSG_DATA *msg_data = (MSG_DATA *) bacmsg->data;
+    int16_t buff_len = 0;
+
+    print_msg(bacmsg);
+
+    if (is_network_msg(bacmsg)) {
+        buff_len = process_network_message(bacmsg, msg_data);
+        if (buff_len == 0) {
+            free_data(msg_data);
+            return;
+        }
+    } else {
+        /* the port could not route it alone */
+        buff_len = route_msg(find_snet(msg_src), msg_data, true);
+    }
+
+    /* if buff_len */
+    /* >0 - form new message and send */
+    /* =-1 - try to find next router */
+    /* other value - discard message */
+
+    if (buff_len > 0) {
+        /* form new message */
+        msg.origin = head->main_id;
+        msg.type = DATA;
+        msg.data = msg_data;
+
+        print_msg(bacmsg);
+
+        if (is_network_msg(bacmsg)) {
+            msg_data->ref_count = 1;
+            if (!send_to_msgbox(msg_src, &msg)) {
+                free_data(msg_data);
+            }
+        } else {
+            send_routed_msg(find_snet(msg_src), msg_data);
+        }
+    } else if (buff_len == -1) {
+        uint16_t net = msg_data->dest.net;      /* NET to find */
+        PRINT(INFO, "Searching NET...\n");
+        send_network_message(NETWORK_MESSAGE_WHO_IS_ROUTER_TO_NETWORK,
+            msg_data, &net);
+    } else {
+        /* if invalid message send Reject-Message-To-Network */
+        PRINT(ERROR, "Error: Invalid message\n");
+        free_data(msg_data);
+    }
+}
+
+void print_msg(
+    BACMSG * msg)
+{
+    if (msg->type == DATA) {
+        int i;
+        MSG_DATA *data = (MSG_DATA *) msg->data;
+
+        if (data->pdu_len) {
+            PRINT(DEBUG, "Message PDU: ");
+            for (i = 0; i < data->pdu_len; i++)
+                PRINT(DEBUG, "%02X ", data->pdu[i]);
+            PRINT(DEBUG, "\n");
+        }
+    }
+}
+
+bool is_network_msg(
+    BACMSG * msg)
+{
+
+    uint8_t control_byte;       /* NPDU control byte */
+    MSG_DATA *data = (MSG_DATA *) msg->data;
+
+    control_byte = data->pdu[1];
+
+    return control_byte & 0x80; /* check 7th bit */
+}
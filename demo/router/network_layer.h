@@ -40,21 +40,19 @@
 #include "net.h"
 #include "portthread.h"
 
+/* the reply, if any, is written over the received message */
 uint16_t process_network_message(
     BACMSG * msg,
-    MSG_DATA * data,
-    uint8_t ** buff);
+    MSG_DATA * data);
 
 uint16_t create_network_message(
     BACNET_NETWORK_MESSAGE_TYPE network_message_type,
     MSG_DATA * data,
-    uint8_t ** buff,
     void *val);
 
 void send_network_message(
     BACNET_NETWORK_MESSAGE_TYPE network_message_type,
     MSG_DATA * data,
-    uint8_t ** buff,
     void *val);
 
 void init_npdu(
@@ -62,4 +60,14 @@ void init_npdu(
     BACNET_NETWORK_MESSAGE_TYPE network_message_type,
     bool data_expecting_reply);
 
+/* handle a message received on the main message box */
+void route_main_msg(
+    BACMSG * bacmsg);
+
+void print_msg(
+    BACMSG * msg);
+
+bool is_network_msg(
+    BACMSG * msg);
+
 #endif /* end of NETWORK_LAYER_H */
@@ -46,77 +46,212 @@ ROUTER_PORT *find_snet(
     return NULL;
 }
 
+/* routing table, indexed by network number */
+typedef struct _route {
+    ROUTER_PORT *port;  /* NULL if the network is unknown */
+    DNET *dnet; /* NULL if the network is directly connected */
+} ROUTE;
+
+static ROUTE Route_Table[BACNET_BROADCAST_NETWORK];
+/* every port thread reads the table; only the main thread changes it */
+static pthread_rwlock_t Route_Lock = PTHREAD_RWLOCK_INITIALIZER;
+
+static void dnet_link(
+    ROUTER_PORT * port,
+    DNET * dnet)
+{
+    dnet->port = port;
+    dnet->prev = NULL;
+    dnet->next = port->route_info.dnets;
+    if (dnet->next)
+        dnet->next->prev = dnet;
+    port->route_info.dnets = dnet;
+}
+
+static void dnet_unlink(
+    DNET * dnet)
+{
+    if (dnet->prev)
+        dnet->prev->next = dnet->next;
+    else
+        dnet->port->route_info.dnets = dnet->next;
+    if (dnet->next)
+        dnet->next->prev = dnet->prev;
+    dnet->next = NULL;
+    dnet->prev = NULL;
+}
+
 ROUTER_PORT *find_dnet(
     uint16_t net,
     BACNET_ADDRESS * addr)
 {
 
-    ROUTER_PORT *port = head;
     DNET *dnet;
+    ROUTER_PORT *port;
 
     /* for broadcast messages no search is needed */
     if (net == BACNET_BROADCAST_NETWORK)
-        return port;
+        return head;
 
-    while (port != NULL) {
+    pthread_rwlock_rdlock(&Route_Lock);
+    dnet = Route_Table[net].dnet;
+    if (dnet && addr) {
+        memmove(&addr->len, &dnet->mac_len, 1);
+        memmove(&addr->adr[0], &dnet->mac[0], MAX_MAC_LEN);
+    }
+    port = Route_Table[net].port;
+    pthread_rwlock_unlock(&Route_Lock);
 
-        /* check if DNET is directly connected to the router */
-        if (net == port->route_info.net)
-            return port;
+    return port;
+}
 
-        /* else search router ports DNET list */
-        else if (port->route_info.dnets) {
-            dnet = port->route_info.dnets;
-            while (dnet != NULL) {
-                if (net == dnet->net) {
-                    if (addr) {
-                        memmove(&addr->len, &dnet->mac_len, 1);
-                        memmove(&addr->adr[0], &dnet->mac[0], MAX_MAC_LEN);
-                    }
-                    return port;
-                }
-                dnet = dnet->next;
-            }
-        }
-        port = port->next;
+bool add_port_net(
+    ROUTER_PORT * port)
+{
+    uint16_t net = port->route_info.net;
+    bool status = false;
+
+    if ((net == 0) || (net == BACNET_BROADCAST_NETWORK))
+        return false;
+    pthread_rwlock_wrlock(&Route_Lock);
+    /* two ports on one network are refused */
+    if (Route_Table[net].port == NULL) {
+        Route_Table[net].port = port;
+        Route_Table[net].dnet = NULL;
+        status = true;
     }
+    pthread_rwlock_unlock(&Route_Lock);
 
-    return NULL;
+    return status;
 }
 
 void add_dnet(
-    RT_ENTRY * route_info,
+    ROUTER_PORT * port,
     uint16_t net,
     BACNET_ADDRESS addr)
 {
 
-    DNET *dnet = route_info->dnets;
-    DNET *tmp;
+    ROUTE *route;
+    DNET *dnet;
 
+    if ((net == 0) || (net == BACNET_BROADCAST_NETWORK))
+        return;
+    pthread_rwlock_wrlock(&Route_Lock);
+    route = &Route_Table[net];
+    if (route->port && !route->dnet) {
+        /* directly connected */
+        pthread_rwlock_unlock(&Route_Lock);
+        return;
+    }
+
+    dnet = route->dnet;
     if (dnet == NULL) {
-        route_info->dnets = (DNET *) malloc(sizeof(DNET));
-        memmove(&route_info->dnets->mac_len, &addr.len, 1);
-        memmove(&route_info->dnets->mac[0], &addr.adr[0], MAX_MAC_LEN);
-        route_info->dnets->net = net;
-        route_info->dnets->state = true;
-        route_info->dnets->next = NULL;
-    } else {
+        dnet = (DNET *) malloc(sizeof(DNET));
+        if (dnet == NULL) {
+            pthread_rwlock_unlock(&Route_Lock);
+            return;
+        }
+        dnet->net = net;
+        dnet->state = true;
+        dnet->busy_time = 0;
+        dnet_link(port, dnet);
+        route->dnet = dnet;
+        route->port = port;
+    } else if (dnet->port != port) {
+        /* the network moved to another port */
+        dnet_unlink(dnet);
+        dnet_link(port, dnet);
+        route->port = port;
+    }
+    memmove(&dnet->mac_len, &addr.len, 1);
+    memmove(&dnet->mac[0], &addr.adr[0], MAX_MAC_LEN);
+    dnet->age = 0;
+    pthread_rwlock_unlock(&Route_Lock);
+}
 
+static void dnet_set_busy(
+    DNET * dnet,
+    bool busy)
+{
+    dnet->state = !busy;
+    dnet->busy_time = 0;
+}
+
+void set_dnet_busy(
+    ROUTER_PORT * port,
+    uint16_t net,
+    BACNET_ADDRESS * addr,
+    bool busy)
+{
+    DNET *dnet;
+
+    pthread_rwlock_wrlock(&Route_Lock);
+    if (net == BACNET_BROADCAST_NETWORK) {
+        /* every network behind the router */
+        dnet = port->route_info.dnets;
         while (dnet != NULL) {
-            if (dnet->net == net)       /* make sure NETs are not repeated */
-                return;
-            tmp = dnet;
+            if (!addr || ((dnet->mac_len == addr->len) &&
+                    (memcmp(dnet->mac, addr->adr, dnet->mac_len) == 0)))
+                dnet_set_busy(dnet, busy);
             dnet = dnet->next;
         }
+    } else {
+        dnet = Route_Table[net].dnet;
+        if (dnet && (dnet->port == port))
+            dnet_set_busy(dnet, busy);
+    }
+    pthread_rwlock_unlock(&Route_Lock);
+}
 
-        dnet = (DNET *) malloc(sizeof(DNET));
-        memmove(&dnet->mac_len, &addr.len, 1);
-        memmove(&dnet->mac[0], &addr.adr[0], MAX_MAC_LEN);
-        dnet->net = net;
-        dnet->state = true;
-        dnet->next = NULL;
-        tmp->next = dnet;
+bool is_dnet_busy(
+    uint16_t net)
+{
+    DNET *dnet;
+    bool busy;
+
+    if (net == BACNET_BROADCAST_NETWORK)
+        return false;
+    pthread_rwlock_rdlock(&Route_Lock);
+    dnet = Route_Table[net].dnet;
+    busy = (dnet && !dnet->state);
+    pthread_rwlock_unlock(&Route_Lock);
+
+    return busy;
+}
+
+void age_dnets(
+    uint16_t seconds)
+{
+    ROUTER_PORT *port = head;
+    DNET *dnet;
+    DNET *next;
+
+    pthread_rwlock_wrlock(&Route_Lock);
+    while (port != NULL) {
+        dnet = port->route_info.dnets;
+        while (dnet != NULL) {
+            next = dnet->next;
+            if (!dnet->state) {
+                /* no Router-Available-To-Network came in time */
+                if (dnet->busy_time + seconds >= DNET_BUSY_TIMEOUT)
+                    dnet_set_busy(dnet, false);
+                else
+                    dnet->busy_time += seconds;
+            }
+            if (dnet->age + seconds >= DNET_MAX_AGE) {
+                PRINT(INFO, "Route to NET %hu aged out\n", dnet->net);
+                dnet_unlink(dnet);
+                Route_Table[dnet->net].port = NULL;
+                Route_Table[dnet->net].dnet = NULL;
+                free(dnet);
+            } else {
+                dnet->age += seconds;
+            }
+            dnet = next;
+        }
+        port = port->next;
     }
+    pthread_rwlock_unlock(&Route_Lock);
 }
 
 void cleanup_dnets(
@@ -124,9 +259,474 @@ void cleanup_dnets(
 {
 
     DNET *dnet = dnets;
+
+    pthread_rwlock_wrlock(&Route_Lock);
     while (dnet != NULL) {
         dnet = dnet->next;
+        Route_Table[dnets->net].port = NULL;
+        Route_Table[dnets->net].dnet = NULL;
         free(dnets);
         dnets = dnet;
     }
+    pthread_rwlock_unlock(&Route_Lock);
+}
+
+int16_t route_msg(
+    ROUTER_PORT * srcport,
+    MSG_DATA * data,
+    bool learn)
+{
+
+    BACNET_ADDRESS addr;
+    BACNET_NPDU_DATA npdu_data;
+    ROUTER_PORT *destport = NULL;
+    DNET *dnet;
+    uint8_t npdu[MAX_NPDU];
+    bool known = true;
+    bool busy = false;
+    int apdu_offset;
+    int apdu_len;
+    int npdu_len;
+
+    if (!srcport)
+        return -2;
+    apdu_offset = npdu_decode(data->pdu, &data->dest, &addr, &npdu_data);
+    if ((apdu_offset <= 0) || (apdu_offset > data->pdu_len))
+        return -2;
+    apdu_len = data->pdu_len - apdu_offset;
+
+    /* one look at the table for both networks */
+    pthread_rwlock_rdlock(&Route_Lock);
+    if (addr.net > 0 && addr.net < BACNET_BROADCAST_NETWORK &&
+        addr.net != srcport->route_info.net) {
+        /* the way back to the source network of a routed message */
+        dnet = Route_Table[addr.net].dnet;
+        if (dnet && (dnet->port == srcport) &&
+            (dnet->mac_len == data->src.len) &&
+            (memcmp(dnet->mac, data->src.adr, dnet->mac_len) == 0)) {
+            __atomic_store_n(&dnet->age, 0, __ATOMIC_RELAXED);
+        } else {
+            known = false;
+        }
+    }
+    if (data->dest.net == BACNET_BROADCAST_NETWORK) {
+        destport = head;
+    } else {
+        destport = Route_Table[data->dest.net].port;
+        dnet = Route_Table[data->dest.net].dnet;
+        busy = (dnet && !dnet->state);
+    }
+    pthread_rwlock_unlock(&Route_Lock);
+
+    if (!known) {
+        /* only the main thread changes the routing table */
+        if (!learn)
+            return -1;
+        add_dnet(srcport, addr.net, data->src);
+    }
+    if (!destport) {
+        /* request net search */
+        return -1;
+    }
+    if (busy) {
+        PRINT(INFO, "Message discarded: NET %hu is busy\n", data->dest.net);
+        return -2;
+    }
+
+    data->src.net = srcport->route_info.net;
+
+    /* if received from another router save real source address (not other router source address) */
+    if (addr.net > 0 && addr.net < BACNET_BROADCAST_NETWORK &&
+        data->src.net != addr.net)
+        memmove(&data->src, &addr, sizeof(BACNET_ADDRESS));
+
+    /* encode both source and destination for broadcast and router-to-router communication */
+    if (data->dest.net == BACNET_BROADCAST_NETWORK ||
+        destport->route_info.net != data->dest.net) {
+        npdu_len = npdu_encode_pdu(npdu, &data->dest, &data->src, &npdu_data);
+    } else {
+        npdu_len = npdu_encode_pdu(npdu, NULL, &data->src, &npdu_data);
+    }
+    if (npdu_len > (&data->pdu[apdu_offset] - &data->buff[0]))
+        return -2;
+
+    /* replace the NPDU header in front of the APDU, using the
+       headroom when the new header is longer */
+    data->pdu = &data->pdu[apdu_offset - npdu_len];
+    memmove(data->pdu, npdu, npdu_len);
+    data->pdu_len = npdu_len + apdu_len;
+
+    return data->pdu_len;
+}
+
+void send_routed_msg(
+    ROUTER_PORT * srcport,
+    MSG_DATA * data)
+{
+    BACMSG msg;
+    ROUTER_PORT *port;
+    uint8_t ref_count = 0;
+
+    msg.origin = srcport ? srcport->port_id : INVALID_MSGBOX_ID;
+    msg.type = DATA;
+    msg.subtype = (MSGSUBTYPE) 0;
+    msg.data = data;
+
+    if (data->dest.net != BACNET_BROADCAST_NETWORK) {
+        data->ref_count = 1;
+        port = find_dnet(data->dest.net, &data->dest);
+        if (!port || !send_to_msgbox(port->port_id, &msg)) {
+            free_data(data);
+        }
+        return;
+    }
+    /* every port shares the one buffer, so count them before the
+       first send */
+    port = head;
+    while (port != NULL) {
+        if (port != srcport && get_port_state(port) != FINISHED) {
+            ref_count++;
+        }
+        port = port->next;
+    }
+    if (ref_count == 0) {
+        free_data(data);
+        return;
+    }
+    data->ref_count = ref_count;
+    port = head;
+    while (port != NULL) {
+        if (port != srcport && get_port_state(port) != FINISHED) {
+            if (!send_to_msgbox(port->port_id, &msg)) {
+                check_data(data);
+            }
+        }
+        port = port->next;
+    }
+}
+
+bool forward_msg(
+    ROUTER_PORT * port,
+    MSG_DATA * data)
+{
+    int16_t buff_len;
+
+    /* network layer messages go to the main thread */
+    if ((data->pdu_len < 2) || (data->pdu[1] & 0x80))
+        return false;
+    buff_len = route_msg(port, data, false);
+    if (buff_len == -1) {
+        /* the main thread learns the route, or searches for it */
+        return false;
+    }
+    if (buff_len > 0) {
+        send_routed_msg(port, data);
+    } else {
+        free_data(data);
+    }
+
+    return true;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include "ctest.h"
+
+/* the routing table is kept between tests, so each uses its own
+   network numbers starting at 'net' */
+static void testRoutePorts(
+    ROUTER_PORT * ports,
+    int count,
+    uint16_t net)
+{
+    int i;
+
+    memset(ports, 0, sizeof(ROUTER_PORT) * count);
+    for (i = 0; i < count; i++) {
+        ports[i].type = BIP;
+        ports[i].port_id = i + 1;
+        ports[i].route_info.net = (uint16_t) (net + i);
+        ports[i].next = (i + 1 < count) ? &ports[i + 1] : NULL;
+    }
+    head = &ports[0];
+    port_count = count;
+}
+
+static void testRouteAddress(
+    BACNET_ADDRESS * addr,
+    uint8_t mac)
+{
+    memset(addr, 0, sizeof(BACNET_ADDRESS));
+    addr->len = 1;
+    addr->adr[0] = mac;
+}
+
+void testRouteTable(
+    Test * pTest)
+{
+    ROUTER_PORT ports[2];
+    BACNET_ADDRESS addr, router;
+    uint16_t net;
+
+    testRoutePorts(ports, 2, 1);
+    ct_test(pTest, add_port_net(&ports[0]));
+    ct_test(pTest, add_port_net(&ports[1]));
+    /* one port per network, and no wildcard networks */
+    ct_test(pTest, !add_port_net(&ports[1]));
+    net = ports[1].route_info.net;
+    ports[1].route_info.net = 0;
+    ct_test(pTest, !add_port_net(&ports[1]));
+    ports[1].route_info.net = BACNET_BROADCAST_NETWORK;
+    ct_test(pTest, !add_port_net(&ports[1]));
+    ports[1].route_info.net = net;
+    ct_test(pTest, find_snet(2) == &ports[1]);
+    ct_test(pTest, find_snet(3) == NULL);
+
+    /* directly connected networks leave the address alone */
+    memset(&addr, 0, sizeof(addr));
+    ct_test(pTest, find_dnet(1, &addr) == &ports[0]);
+    ct_test(pTest, find_dnet(2, &addr) == &ports[1]);
+    ct_test(pTest, addr.len == 0);
+    ct_test(pTest, find_dnet(BACNET_BROADCAST_NETWORK, NULL) == head);
+    ct_test(pTest, find_dnet(3, NULL) == NULL);
+
+    /* a network behind another router */
+    testRouteAddress(&router, 5);
+    add_dnet(&ports[1], 3, router);
+    ct_test(pTest, find_dnet(3, &addr) == &ports[1]);
+    ct_test(pTest, addr.len == 1);
+    ct_test(pTest, addr.adr[0] == 5);
+    ct_test(pTest, ports[1].route_info.dnets != NULL);
+    ct_test(pTest, ports[1].route_info.dnets->net == 3);
+    /* a directly connected network is never learned */
+    add_dnet(&ports[0], 2, router);
+    ct_test(pTest, find_dnet(2, NULL) == &ports[1]);
+    ct_test(pTest, ports[0].route_info.dnets == NULL);
+    add_dnet(&ports[0], 0, router);
+    add_dnet(&ports[0], BACNET_BROADCAST_NETWORK, router);
+    ct_test(pTest, ports[0].route_info.dnets == NULL);
+    /* the network moves when another port hears of it */
+    testRouteAddress(&router, 9);
+    add_dnet(&ports[0], 3, router);
+    ct_test(pTest, find_dnet(3, &addr) == &ports[0]);
+    ct_test(pTest, addr.adr[0] == 9);
+    ct_test(pTest, ports[1].route_info.dnets == NULL);
+    ct_test(pTest, ports[0].route_info.dnets->net == 3);
+
+    /* busy networks, by number or by the router in front of them */
+    ct_test(pTest, !is_dnet_busy(3));
+    set_dnet_busy(&ports[1], 3, NULL, true);
+    ct_test(pTest, !is_dnet_busy(3));
+    set_dnet_busy(&ports[0], 3, NULL, true);
+    ct_test(pTest, is_dnet_busy(3));
+    set_dnet_busy(&ports[0], 3, NULL, false);
+    ct_test(pTest, !is_dnet_busy(3));
+    testRouteAddress(&addr, 5);
+    set_dnet_busy(&ports[0], BACNET_BROADCAST_NETWORK, &addr, true);
+    ct_test(pTest, !is_dnet_busy(3));
+    set_dnet_busy(&ports[0], BACNET_BROADCAST_NETWORK, &router, true);
+    ct_test(pTest, is_dnet_busy(3));
+    ct_test(pTest, !is_dnet_busy(BACNET_BROADCAST_NETWORK));
+    /* and available again without Router-Available-To-Network */
+    age_dnets(DNET_BUSY_TIMEOUT - 1);
+    ct_test(pTest, is_dnet_busy(3));
+    age_dnets(1);
+    ct_test(pTest, !is_dnet_busy(3));
+
+    /* a route not heard from is forgotten */
+    add_dnet(&ports[0], 3, router);
+    age_dnets(DNET_MAX_AGE - 1);
+    ct_test(pTest, find_dnet(3, NULL) == &ports[0]);
+    add_dnet(&ports[0], 3, router);
+    age_dnets(DNET_MAX_AGE - 1);
+    ct_test(pTest, find_dnet(3, NULL) == &ports[0]);
+    age_dnets(1);
+    ct_test(pTest, find_dnet(3, NULL) == NULL);
+    ct_test(pTest, ports[0].route_info.dnets == NULL);
+
+    /* cleanup forgets every learned route of a port */
+    add_dnet(&ports[0], 4, router);
+    add_dnet(&ports[0], 5, router);
+    ct_test(pTest, find_dnet(4, NULL) == &ports[0]);
+    ct_test(pTest, find_dnet(5, NULL) == &ports[0]);
+    cleanup_dnets(ports[0].route_info.dnets);
+    ports[0].route_info.dnets = NULL;
+    ct_test(pTest, find_dnet(4, NULL) == NULL);
+    ct_test(pTest, find_dnet(5, NULL) == NULL);
+    ct_test(pTest, find_dnet(1, NULL) == &ports[0]);
+}
+
+/* a message received on a port, with a Who-Is for an APDU */
+static MSG_DATA *testRouteData(
+    ROUTER_PORT * port,
+    BACNET_ADDRESS * dest,
+    BACNET_ADDRESS * src,
+    uint8_t mac)
+{
+    BACNET_NPDU_DATA npdu_data;
+    MSG_DATA *data;
+    int len;
+
+    data = alloc_data(&port->pool);
+    if (!data)
+        return NULL;
+    npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+    len = npdu_encode_pdu(data->pdu, dest, src, &npdu_data);
+    data->pdu[len++] = PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST;
+    data->pdu[len++] = SERVICE_UNCONFIRMED_WHO_IS;
+    data->pdu_len = (uint16_t) len;
+    testRouteAddress(&data->src, mac);
+
+    return data;
+}
+
+static unsigned testRoutePoolFree(
+    MSG_POOL * pool)
+{
+    MSG_DATA *data;
+    unsigned count = 0;
+
+    for (data = pool->free_list; data != NULL; data = data->next)
+        count++;
+
+    return count;
+}
+
+void testRouteMessage(
+    Test * pTest)
+{
+    ROUTER_PORT ports[3];
+    BACNET_ADDRESS dest, src, addr;
+    BACNET_NPDU_DATA npdu_data;
+    BACMSG msg;
+    MSG_DATA *data;
+    int apdu_offset;
+    int i;
+
+    testRoutePorts(ports, 3, 11);
+    for (i = 0; i < 3; i++) {
+        ports[i].port_id = create_msgbox();
+        ct_test(pTest, ports[i].port_id != INVALID_MSGBOX_ID);
+        ct_test(pTest, add_port_net(&ports[i]));
+    }
+    ct_test(pTest, msg_pool_init(&ports[0].pool, 4));
+    ct_test(pTest, msg_pool_init(&ports[1].pool, 4));
+
+    /* to a device on a directly connected network */
+    testRouteAddress(&dest, 7);
+    dest.net = 12;
+    data = testRouteData(&ports[0], &dest, NULL, 0x21);
+    ct_test(pTest, forward_msg(&ports[0], data));
+    ct_test(pTest, recv_from_msgbox(ports[1].port_id, &msg) == &msg);
+    ct_test(pTest, msg.type == DATA);
+    ct_test(pTest, msg.origin == ports[0].port_id);
+    ct_test(pTest, msg.data == data);
+    ct_test(pTest, recv_from_msgbox(ports[2].port_id, &msg) == NULL);
+    /* the router adds where it came from, and drops the DNET */
+    apdu_offset = npdu_decode(data->pdu, &addr, &src, &npdu_data);
+    ct_test(pTest, apdu_offset > 0);
+    ct_test(pTest, addr.net == 0);
+    ct_test(pTest, src.net == 11);
+    ct_test(pTest, src.len == 1);
+    ct_test(pTest, src.adr[0] == 0x21);
+    ct_test(pTest, data->pdu_len == apdu_offset + 2);
+    ct_test(pTest, data->pdu[apdu_offset + 1] == SERVICE_UNCONFIRMED_WHO_IS);
+    ct_test(pTest, data->pdu >= &data->buff[0]);
+    free_data(data);
+
+    /* unknown networks and network layer messages go to the main thread */
+    dest.net = 20;
+    data = testRouteData(&ports[0], &dest, NULL, 0x21);
+    ct_test(pTest, !forward_msg(&ports[0], data));
+    data->pdu[1] |= 0x80;
+    ct_test(pTest, !forward_msg(&ports[0], data));
+    free_data(data);
+
+    /* from behind another router: the main thread learns the way back */
+    testRouteAddress(&dest, 0x21);
+    dest.net = 11;
+    testRouteAddress(&src, 0x44);
+    src.net = 14;
+    data = testRouteData(&ports[1], &dest, &src, 0x31);
+    ct_test(pTest, !forward_msg(&ports[1], data));
+    ct_test(pTest, route_msg(&ports[1], data, true) > 0);
+    ct_test(pTest, find_dnet(14, &addr) == &ports[1]);
+    ct_test(pTest, addr.len == 1);
+    ct_test(pTest, addr.adr[0] == 0x31);
+    /* and the original source is kept */
+    apdu_offset = npdu_decode(data->pdu, &addr, &src, &npdu_data);
+    ct_test(pTest, apdu_offset > 0);
+    ct_test(pTest, src.net == 14);
+    ct_test(pTest, src.adr[0] == 0x44);
+    free_data(data);
+    /* now the port thread routes it on its own */
+    testRouteAddress(&src, 0x44);
+    src.net = 14;
+    data = testRouteData(&ports[1], &dest, &src, 0x31);
+    ct_test(pTest, forward_msg(&ports[1], data));
+    ct_test(pTest, recv_from_msgbox(ports[0].port_id, &msg) == &msg);
+    ct_test(pTest, msg.data == data);
+    free_data(data);
+
+    /* messages to a busy network are dropped */
+    set_dnet_busy(&ports[1], 14, NULL, true);
+    testRouteAddress(&dest, 0x44);
+    dest.net = 14;
+    data = testRouteData(&ports[0], &dest, NULL, 0x21);
+    ct_test(pTest, forward_msg(&ports[0], data));
+    ct_test(pTest, recv_from_msgbox(ports[1].port_id, &msg) == NULL);
+    ct_test(pTest, testRoutePoolFree(&ports[0].pool) == 4);
+    set_dnet_busy(&ports[1], 14, NULL, false);
+
+    /* a global broadcast shares one buffer between the other ports */
+    testRouteAddress(&dest, 0);
+    dest.len = 0;
+    dest.net = BACNET_BROADCAST_NETWORK;
+    data = testRouteData(&ports[0], &dest, NULL, 0x21);
+    ct_test(pTest, forward_msg(&ports[0], data));
+    ct_test(pTest, data->ref_count == 2);
+    ct_test(pTest, recv_from_msgbox(ports[0].port_id, &msg) == NULL);
+    ct_test(pTest, recv_from_msgbox(ports[1].port_id, &msg) == &msg);
+    ct_test(pTest, msg.data == data);
+    check_data(data);
+    ct_test(pTest, testRoutePoolFree(&ports[0].pool) == 3);
+    ct_test(pTest, recv_from_msgbox(ports[2].port_id, &msg) == &msg);
+    ct_test(pTest, msg.data == data);
+    check_data(data);
+    ct_test(pTest, testRoutePoolFree(&ports[0].pool) == 4);
+
+    for (i = 0; i < 3; i++) {
+        del_msgbox(ports[i].port_id);
+        cleanup_dnets(ports[i].route_info.dnets);
+        msg_pool_cleanup(&ports[i].pool);
+    }
+    head = NULL;
+}
+
+#ifdef TEST_PORT_THREAD
+/* the router of main.c */
+ROUTER_PORT *head = NULL;
+int port_count;
+
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet Router Port Thread", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testRouteTable);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testRouteMessage);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
 }
+#endif
+#endif
@@ -49,7 +49,8 @@
 
 typedef enum {
     BIP = 1,
-    MSTP = 2
+    MSTP = 2,
+    LOOP = 3    /* in-memory port, for benchmarks */
 } DL_TYPE;
 
 typedef enum {
@@ -83,15 +84,35 @@ typedef union _port_params {
         uint8_t max_master;
         uint8_t max_frames;
     } mstp_params;
+    struct {
+        uint8_t mac_len;        /* 6 to look like BIP, 1 like MSTP */
+        struct loop_data *data; /* set by the port thread */
+    } loop_params;
 } PORT_PARAMS;
 
-/* list node for reacheble networks */
+/* seconds that a learned route is kept without being heard again */
+#ifndef DNET_MAX_AGE
+#define DNET_MAX_AGE 3600
+#endif
+/* seconds that a network stays busy without Router-Available-To-Network */
+#ifndef DNET_BUSY_TIMEOUT
+#define DNET_BUSY_TIMEOUT 30
+#endif
+
+struct _port;
+
+/* routing table entry for a network that is reached through another
+   router; the entries of each port are also kept in a list */
 typedef struct _dnet {
-    uint8_t mac[MAX_MAC_LEN];
+    uint8_t mac[MAX_MAC_LEN];   /* address of the next router */
     uint8_t mac_len;
     uint16_t net;
-    bool state; /* enabled or disabled */
+    bool state; /* enabled or disabled (busy) */
+    uint16_t age;       /* seconds since the route was last heard */
+    uint16_t busy_time; /* seconds since the network became busy */
+    struct _port *port; /* router port that reaches the network */
     struct _dnet *next;
+    struct _dnet *prev;
 } DNET;
 
 /* information for routing table */
@@ -111,9 +132,17 @@ typedef struct _port {
     PORT_FUNC func;
     RT_ENTRY route_info;
     PORT_PARAMS params;
+    MSG_POOL pool;      /* buffers for messages received on this port */
     struct _port *next; /* pointer to next list node */
 } ROUTER_PORT;
 
+/* the state is written by the port thread and read by the others, so
+   whatever the port set up before it is visible with the state */
+#define get_port_state(port) \
+    __atomic_load_n(&(port)->state, __ATOMIC_ACQUIRE)
+#define set_port_state(port, value) \
+    __atomic_store_n(&(port)->state, (value), __ATOMIC_RELEASE)
+
 extern ROUTER_PORT *head;
 extern int port_count;
 
@@ -126,13 +155,59 @@ ROUTER_PORT *find_dnet(
     uint16_t net,
     BACNET_ADDRESS * addr);
 
+/* add directly connected network of a router port */
+bool add_port_net(
+    ROUTER_PORT * port);
+
 /* add reacheble network for specified router port */
 void add_dnet(
-    RT_ENTRY * route_info,
+    ROUTER_PORT * port,
     uint16_t net,
     BACNET_ADDRESS addr);
 
+/* mark networks behind a router as busy or available */
+void set_dnet_busy(
+    ROUTER_PORT * port,
+    uint16_t net,
+    BACNET_ADDRESS * addr,
+    bool busy);
+
+bool is_dnet_busy(
+    uint16_t net);
+
+/* age learned routes, and forget the ones not heard from */
+void age_dnets(
+    uint16_t seconds);
+
 void cleanup_dnets(
     DNET * dnets);
 
+/* rewrite the NPDU of a received message for its destination network;
+   returns the new PDU length, -1 if the route is not known
+   (or, unless learn is set, the source network is not),
+   or -2 if the message is discarded */
+int16_t route_msg(
+    ROUTER_PORT * srcport,
+    MSG_DATA * data,
+    bool learn);
+
+/* queue a routed message to the destination router port(s) */
+void send_routed_msg(
+    ROUTER_PORT * srcport,
+    MSG_DATA * data);
+
+/* route a received message in the port thread; false if it has to
+   go to the main thread */
+bool forward_msg(
+    ROUTER_PORT * port,
+    MSG_DATA * data);
+
+#ifdef TEST
+#include "ctest.h"
+void testRouteTable(
+    Test * pTest);
+void testRouteMessage(
+    Test * pTest);
+#endif
+
 #endif /* end of PORTTHREAD_H */
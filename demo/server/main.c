@@ -51,6 +51,7 @@
 #include "txbuf.h"
 #include "lc.h"
 #include "version.h"
+#include "timer.h"
 /* include the device object */
 #include "device.h"
 #include "trendlog.h"
@@ -63,6 +64,15 @@
 #if defined(BAC_UCI)
 #include "ucix.h"
 #endif /* defined(BAC_UCI) */
+#if defined(BACNET_EVENT_LOOP)
+#include "evloop.h"
+#endif /* defined(BACNET_EVENT_LOOP) */
+/* the worker threads send their replies themselves, which only the
+   BACnet/IP datalink is ready for */
+#if defined(BACNET_WORKER_POOL) && defined(BACDL_BIP)
+#define SERVER_WORKER_POOL 1
+#include "workpool.h"
+#endif
 
 
 /** @file server/main.c  Example server application using the BACnet Stack. */
@@ -132,6 +142,16 @@ static void Init_Service_Handlers(
         handler_cov_subscribe);
     apdu_set_unconfirmed_handler(SERVICE_UNCONFIRMED_COV_NOTIFICATION,
         handler_ucov_notification);
+    apdu_set_confirmed_handler(SERVICE_CONFIRMED_COV_NOTIFICATION,
+        handler_ccov_notification);
+#if defined(BACNET_TRENDLOG_BIND)
+    /* Trend Logs with a source in another device bind to it from its I-Am,
+       which means this device executes I-Am (see oi00107 above). Without
+       this a remote source needs a static binding in address_cache. */
+    apdu_set_unconfirmed_handler(SERVICE_UNCONFIRMED_I_AM, handler_i_am_bind);
+#endif
+    handler_ucov_notification_set(trend_log_cov_notification);
+    handler_ccov_notification_set(trend_log_cov_notification);
     /* handle communication so we can shutup when asked */
     apdu_set_confirmed_handler(SERVICE_CONFIRMED_DEVICE_COMMUNICATION_CONTROL,
         handler_device_communication_control);
@@ -172,6 +192,394 @@ static void print_help(const char *filename)
         "%s 123 Fred\n", filename);
 }
 
+/** Pace the I-Ams that answer Who-Is when BACNET_IAM_RATE is set,
+ * see bin/readme.txt.
+ */
+static void Init_I_Am_Pacing(
+    void)
+{
+    char *pEnv = NULL;
+    unsigned rate = 0;
+    unsigned jitter = 0;
+    unsigned window = 1000;
+
+    pEnv = getenv("BACNET_IAM_RATE");
+    if (pEnv) {
+        rate = (unsigned) strtol(pEnv, NULL, 0);
+    }
+    if (rate == 0) {
+        return;
+    }
+    pEnv = getenv("BACNET_IAM_JITTER");
+    if (pEnv) {
+        jitter = (unsigned) strtol(pEnv, NULL, 0);
+    }
+    pEnv = getenv("BACNET_IAM_WINDOW");
+    if (pEnv) {
+        window = (unsigned) strtol(pEnv, NULL, 0);
+    }
+    /* one Device, and a few requesters at a time */
+    if (Send_I_Am_Pace_Init(rate, jitter, window, 16)) {
+        printf("Sending at most %u I-Am per second.\n", rate);
+        atexit(Send_I_Am_Pace_Cleanup);
+    }
+}
+
+#if defined(SERVER_WORKER_POOL)
+/** Determine whether a received PDU may be handled by a worker thread:
+ * an unsegmented ReadProperty or ReadPropertyMultiple request for this
+ * device.  These only read the objects, so several can run at once.
+ * Everything else is handled by the main thread, in order.
+ *
+ * @param pdu [in] The received NPDU.
+ * @param pdu_len [in] Number of octets in the NPDU.
+ * @return true if a worker may handle the PDU
+ */
+static bool Server_Worker_Request(
+    uint8_t * pdu,
+    uint16_t pdu_len)
+{
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    int apdu_offset = 0;
+    uint8_t *apdu = NULL;
+
+    if ((pdu_len < 1) || (pdu[0] != BACNET_PROTOCOL_VERSION)) {
+        return false;
+    }
+    apdu_offset = npdu_decode(&pdu[0], &dest, NULL, &npdu_data);
+    if (npdu_data.network_layer_message || (apdu_offset <= 0) ||
+        ((apdu_offset + 4) > pdu_len)) {
+        return false;
+    }
+    if ((dest.net != 0) && (dest.net != BACNET_BROADCAST_NETWORK)) {
+        return false;
+    }
+    apdu = &pdu[apdu_offset];
+    if (((apdu[0] & 0xF0) != PDU_TYPE_CONFIRMED_SERVICE_REQUEST) ||
+        (apdu[0] & BIT3)) {
+        return false;
+    }
+
+    return ((apdu[3] == SERVICE_CONFIRMED_READ_PROPERTY) ||
+        (apdu[3] == SERVICE_CONFIRMED_READ_PROP_MULTIPLE));
+}
+#endif
+
+/** Handle a received PDU, or hand it to a worker thread when
+ * the worker pool is running and the request allows it.
+ */
+static void Server_Dispatch(
+    BACNET_ADDRESS * src,
+    uint8_t * pdu,
+    uint16_t pdu_len)
+{
+#if defined(SERVER_WORKER_POOL)
+    if (workpool_threads() && Server_Worker_Request(pdu, pdu_len) &&
+        workpool_submit(src, pdu, pdu_len)) {
+        return;
+    }
+#endif
+    npdu_handler(src, pdu, pdu_len);
+}
+
+/** The timers of the objects.  Worker threads may be reading the
+ * objects meanwhile, so each timer runs with its objects locked.
+ *
+ * @param elapsed_seconds [in] seconds since the last call
+ */
+static void Server_Object_Timers(
+    uint32_t elapsed_seconds)
+{
+    if (Device_Objects_Lock(OBJECT_LOAD_CONTROL, true)) {
+        Load_Control_State_Machine_Handler();
+        Device_Objects_Unlock(OBJECT_LOAD_CONTROL);
+    }
+    /* the Device object reports the COV subscriptions */
+    if (Device_Objects_Lock(OBJECT_DEVICE, true)) {
+        handler_cov_timer_seconds(elapsed_seconds);
+        Device_Objects_Unlock(OBJECT_DEVICE);
+    }
+    if (Device_Objects_Lock(OBJECT_TRENDLOG, true)) {
+        trend_log_timer(elapsed_seconds);
+        Device_Objects_Unlock(OBJECT_TRENDLOG);
+    }
+}
+
+/** One step of the COV state machine, with the Device object locked.
+ *
+ * @return true when the state machine is idle
+ */
+static bool Server_COV_Step(
+    void)
+{
+    bool idle = true;
+
+    if (Device_Objects_Lock(OBJECT_DEVICE, true)) {
+        idle = handler_cov_fsm();
+        Device_Objects_Unlock(OBJECT_DEVICE);
+    }
+
+    return idle;
+}
+
+#if defined(BACNET_EVENT_LOOP)
+/* most PDUs handled per wakeup before the timers get a turn */
+#define SERVER_RECEIVE_BATCH 16
+/* least milliseconds between passes over the COV subscriptions */
+#ifndef SERVER_COV_INTERVAL
+#define SERVER_COV_INTERVAL 100
+#endif
+
+static EVLOOP_TIMER Seconds_Timer;
+static uint64_t Seconds_Last;
+static uint32_t Address_Binding_Tmr;
+#if defined(INTRINSIC_REPORTING)
+static uint32_t Recipient_Scan_Tmr;
+#endif
+static EVLOOP_TIMER TSM_Timer;
+static uint64_t TSM_Last;
+static bool TSM_Running;
+static EVLOOP_TIMER Pace_Timer;
+static uint64_t Pace_Last;
+static EVLOOP_TIMER COV_Timer;
+static uint64_t COV_Last;
+
+/** Bring the TSM timers up to date, and set the TSM timer to expire
+ * at the next retry or timeout, so that APDU retries happen on time
+ * and an idle TSM costs nothing.
+ */
+static void Server_TSM_Schedule(
+    void)
+{
+    uint64_t now = evloop_milliseconds();
+    uint64_t elapsed = 0;
+    uint16_t next = 0;
+
+    if (TSM_Running) {
+        elapsed = now - TSM_Last;
+        while (elapsed) {
+            if (elapsed > UINT16_MAX) {
+                tsm_timer_milliseconds(UINT16_MAX);
+                elapsed -= UINT16_MAX;
+            } else {
+                tsm_timer_milliseconds((uint16_t) elapsed);
+                elapsed = 0;
+            }
+        }
+    }
+    TSM_Last = now;
+    next = tsm_timer_next();
+    if (next) {
+        evloop_timer_start(&TSM_Timer, next, 0);
+        TSM_Running = true;
+    } else {
+        evloop_timer_stop(&TSM_Timer);
+        TSM_Running = false;
+    }
+}
+
+static void Server_TSM_Timer(
+    void *context)
+{
+    (void) context;
+    Server_TSM_Schedule();
+}
+
+/** Send the paced I-Ams that are due, and set the pacing timer to
+ * expire when the next one is.
+ */
+static void Server_Pace_Schedule(
+    void)
+{
+    uint64_t now = evloop_milliseconds();
+    uint64_t elapsed = now - Pace_Last;
+    uint16_t next = 0;
+
+    Pace_Last = now;
+    while (elapsed) {
+        if (elapsed > UINT16_MAX) {
+            Send_I_Am_Pace_Timer(UINT16_MAX);
+            elapsed -= UINT16_MAX;
+        } else {
+            Send_I_Am_Pace_Timer((uint16_t) elapsed);
+            elapsed = 0;
+        }
+    }
+    next = Send_I_Am_Pace_Next();
+    if (next) {
+        evloop_timer_start(&Pace_Timer, next, 0);
+    } else {
+        evloop_timer_stop(&Pace_Timer);
+    }
+}
+
+static void Server_Pace_Timer(
+    void *context)
+{
+    (void) context;
+    Server_Pace_Schedule();
+}
+
+/** One complete pass of the COV state machine, which steps through
+ * each subscription once per state.
+ */
+static void Server_COV_Pass(
+    void)
+{
+    COV_Last = evloop_milliseconds();
+    while (!Server_COV_Step()) {
+        /* keep stepping */
+    }
+}
+
+static void Server_COV_Timer(
+    void *context)
+{
+    (void) context;
+    Server_COV_Pass();
+    /* confirmed notifications start transactions */
+    Server_TSM_Schedule();
+}
+
+/** Have the COV subscriptions looked at for changed values, at most
+ * once every SERVER_COV_INTERVAL milliseconds however many requests
+ * come in, so a busy server is not walking the subscriptions after
+ * every batch of them.
+ */
+static void Server_COV_Schedule(
+    void)
+{
+    uint64_t elapsed = evloop_milliseconds() - COV_Last;
+
+    if (evloop_timer_active(&COV_Timer)) {
+        /* a pass is due already */
+    } else if (elapsed >= SERVER_COV_INTERVAL) {
+        Server_COV_Pass();
+    } else {
+        evloop_timer_start(&COV_Timer,
+            (uint32_t) (SERVER_COV_INTERVAL - elapsed), 0);
+    }
+}
+
+/** Work that follows anything which may have changed a value or
+ * started a transaction: the COV subscriptions, the local event
+ * reporting, and the TSM timer.
+ */
+static void Server_Work(
+    void *context)
+{
+    (void) context;
+    Server_COV_Schedule();
+#if defined(INTRINSIC_REPORTING)
+    Device_local_reporting();
+#endif
+    Server_TSM_Schedule();
+    Server_Pace_Schedule();
+}
+
+static void Server_Receive(
+    int fd,
+    void *context)
+{
+    BACNET_ADDRESS src = {
+        0
+    };  /* address where message came from */
+    uint16_t pdu_len = 0;
+    unsigned count = 0;
+
+    (void) fd;
+    (void) context;
+    /* the descriptor is level triggered, so anything left over
+       wakes the loop again after the timers have had a turn */
+    for (count = 0; count < SERVER_RECEIVE_BATCH; count++) {
+        pdu_len = datalink_receive(&src, &Rx_Buf[0], MAX_MPDU, 0);
+        if (pdu_len == 0) {
+            break;
+        }
+        Server_Dispatch(&src, &Rx_Buf[0], pdu_len);
+    }
+    evloop_defer(Server_Work, NULL);
+}
+
+static void Server_Seconds_Timer(
+    void *context)
+{
+    uint32_t elapsed_seconds = 0;
+#if defined(BACNET_TIME_MASTER)
+    BACNET_DATE_TIME bdatetime;
+#endif
+
+    (void) context;
+    elapsed_seconds =
+        (uint32_t) ((evloop_milliseconds() - Seconds_Last) / 1000);
+    if (elapsed_seconds == 0) {
+        return;
+    }
+    Seconds_Last += (uint64_t) elapsed_seconds * 1000;
+    dcc_timer_seconds(elapsed_seconds);
+#if defined(BACDL_BIP) && BBMD_ENABLED
+    bvlc_maintenance_timer(elapsed_seconds);
+#endif
+#if defined(BACDL_BIP6) && BBMD6_ENABLED
+    bvlc6_maintenance_timer(elapsed_seconds);
+#endif
+    dlenv_maintenance_timer(elapsed_seconds);
+    Server_Object_Timers(elapsed_seconds);
+#if defined(INTRINSIC_REPORTING)
+    Device_Reporting_Timer(elapsed_seconds);
+#endif
+#if defined(BACNET_TIME_MASTER)
+    Device_getCurrentDateTime(&bdatetime);
+    handler_timesync_task(&bdatetime);
+#endif
+    /* scan cache address */
+    Address_Binding_Tmr += elapsed_seconds;
+    if (Address_Binding_Tmr >= 60) {
+        address_cache_timer(Address_Binding_Tmr);
+        Address_Binding_Tmr = 0;
+    }
+#if defined(INTRINSIC_REPORTING)
+    /* try to find addresses of recipients */
+    Recipient_Scan_Tmr += elapsed_seconds;
+    if (Recipient_Scan_Tmr >= NC_RESCAN_RECIPIENTS_SECS) {
+        Notification_Class_find_recipient();
+        Recipient_Scan_Tmr = 0;
+    }
+#endif
+    evloop_defer(Server_Work, NULL);
+}
+
+/** Run the server from the event loop: it sleeps until the datalink
+ * has received something or a timer is due, instead of polling.
+ *
+ * @return false if the event loop could not be started.
+ */
+static bool Server_Event_Loop(
+    void)
+{
+    if (!evloop_init()) {
+        return false;
+    }
+    if (!evloop_fd_add(datalink_receive_fd(), Server_Receive, NULL)) {
+        evloop_cleanup();
+        return false;
+    }
+    Seconds_Last = evloop_milliseconds();
+    evloop_timer_init(&Seconds_Timer, Server_Seconds_Timer, NULL);
+    evloop_timer_start(&Seconds_Timer, 1000, 1000);
+    evloop_timer_init(&TSM_Timer, Server_TSM_Timer, NULL);
+    Pace_Last = evloop_milliseconds();
+    evloop_timer_init(&Pace_Timer, Server_Pace_Timer, NULL);
+    evloop_timer_init(&COV_Timer, Server_COV_Timer, NULL);
+    evloop_defer(Server_Work, NULL);
+    evloop_run();
+    evloop_cleanup();
+
+    return true;
+}
+#endif /* defined(BACNET_EVENT_LOOP) */
+
 /** Main function of server demo.
  *
  * @see Device_Set_Object_Instance_Number, dlenv_init, Send_I_Am,
@@ -197,6 +605,8 @@ int main(
     time_t current_seconds = 0;
     uint32_t elapsed_seconds = 0;
     uint32_t elapsed_milliseconds = 0;
+    uint32_t last_milliseconds = 0;
+    uint32_t current_milliseconds = 0;
     uint32_t address_binding_tmr = 0;
     uint32_t recipient_scan_tmr = 0;
 #if defined(BACNET_TIME_MASTER)
@@ -208,6 +618,9 @@ int main(
 #endif
     int argi = 0;
     const char *filename = NULL;
+#if defined(SERVER_WORKER_POOL)
+    char *pEnv = NULL;
+#endif
 
     filename = filename_remove_path(argv[0]);
     for (argi = 1; argi < argc; argi++) {
@@ -253,6 +666,8 @@ int main(
     /* load any static address bindings to show up
        in our device bindings list */
     address_init();
+    /* keep the trend log buffers on disk if asked to */
+    Trend_Log_Storage_Path_Set(getenv("BACNET_TRENDLOG_PATH"));
     Init_Service_Handlers();
     dlenv_init();
     atexit(datalink_cleanup);
@@ -260,6 +675,24 @@ int main(
     last_seconds = time(NULL);
     /* broadcast an I-Am on startup */
     Send_I_Am(&Handler_Transmit_Buffer[0]);
+    Init_I_Am_Pacing();
+    last_milliseconds = timeGetTime();
+#if defined(SERVER_WORKER_POOL)
+    pEnv = getenv("BACNET_WORKERS");
+    if (pEnv && (strtol(pEnv, NULL, 0) > 0)) {
+        if (workpool_init((unsigned) strtol(pEnv, NULL, 0), npdu_handler)) {
+            printf("Handling ReadProperty in %u worker threads.\n",
+                workpool_threads());
+            atexit(workpool_cleanup);
+        }
+    }
+#endif
+#if defined(BACNET_EVENT_LOOP)
+    if (Server_Event_Loop()) {
+        return 0;
+    }
+    fprintf(stderr, "Event loop failed to start; polling instead.\n");
+#endif
     /* loop forever */
     for (;;) {
         /* input */
@@ -270,7 +703,17 @@ int main(
 
         /* process */
         if (pdu_len) {
-            npdu_handler(&src, &Rx_Buf[0], pdu_len);
+            Server_Dispatch(&src, &Rx_Buf[0], pdu_len);
+        }
+        /* paced I-Am responses */
+        current_milliseconds = timeGetTime();
+        elapsed_milliseconds = current_milliseconds - last_milliseconds;
+        if (elapsed_milliseconds) {
+            last_milliseconds = current_milliseconds;
+            if (elapsed_milliseconds > UINT16_MAX) {
+                elapsed_milliseconds = UINT16_MAX;
+            }
+            Send_I_Am_Pace_Timer((uint16_t) elapsed_milliseconds);
         }
         /* at least one second has passed */
         elapsed_seconds = (uint32_t) (current_seconds - last_seconds);
@@ -279,22 +722,26 @@ int main(
             dcc_timer_seconds(elapsed_seconds);
 #if defined(BACDL_BIP) && BBMD_ENABLED
             bvlc_maintenance_timer(elapsed_seconds);
+#endif
+#if defined(BACDL_BIP6) && BBMD6_ENABLED
+            bvlc6_maintenance_timer(elapsed_seconds);
 #endif
             dlenv_maintenance_timer(elapsed_seconds);
-            Load_Control_State_Machine_Handler();
+            Server_Object_Timers(elapsed_seconds);
             elapsed_milliseconds = elapsed_seconds * 1000;
-            handler_cov_timer_seconds(elapsed_seconds);
             tsm_timer_milliseconds(elapsed_milliseconds);
-            trend_log_timer(elapsed_seconds);
 #if defined(INTRINSIC_REPORTING)
-            Device_local_reporting();
+            Device_Reporting_Timer(elapsed_seconds);
 #endif
 #if defined(BACNET_TIME_MASTER)
             Device_getCurrentDateTime(&bdatetime);
             handler_timesync_task(&bdatetime);
 #endif
         }
-        handler_cov_task();
+        Server_COV_Step();
+#if defined(INTRINSIC_REPORTING)
+        Device_local_reporting();
+#endif
         /* scan cache address */
         address_binding_tmr += elapsed_seconds;
         if (address_binding_tmr >= 60) {
@@ -49,6 +49,7 @@
 #include "client.h"
 #include "txbuf.h"
 #include "dlenv.h"
+#include "filexfer.h"
 
 /* buffer used for receive */
 static uint8_t Rx_Buf[MAX_MPDU] = { 0 };
@@ -56,55 +57,18 @@ static uint8_t Rx_Buf[MAX_MPDU] = { 0 };
 /* global variables used in this file */
 static uint32_t Target_File_Object_Instance = 4194303;
 static uint32_t Target_Device_Object_Instance = 4194303;
-static uint32_t Target_File_Requested_Octet_Count;
-static uint8_t Target_File_Requested_Octet_Pad_Byte;
 static BACNET_ADDRESS Target_Address;
 static char *Local_File_Name = NULL;
-static bool End_Of_File_Detected = false;
-static bool Error_Detected = false;
-static uint8_t Current_Invoke_ID = 0;
 
-static void Atomic_Write_File_Error_Handler(
-    BACNET_ADDRESS * src,
-    uint8_t invoke_id,
-    BACNET_ERROR_CLASS error_class,
-    BACNET_ERROR_CODE error_code)
+static void File_Transfer_Progress(
+    uint32_t octets_done,
+    uint32_t octets_total,
+    void *context)
 {
-    if (address_match(&Target_Address, src) &&
-        (invoke_id == Current_Invoke_ID)) {
-        printf("\r\nBACnet Error!\r\n");
-        printf("Error Class: %s\r\n", bactext_error_class_name(error_class));
-        printf("Error Code: %s\r\n", bactext_error_code_name(error_code));
-        Error_Detected = true;
-    }
-}
-
-void MyAbortHandler(
-    BACNET_ADDRESS * src,
-    uint8_t invoke_id,
-    uint8_t abort_reason,
-    bool server)
-{
-    (void) server;
-    if (address_match(&Target_Address, src) &&
-        (invoke_id == Current_Invoke_ID)) {
-        printf("BACnet Abort: %s\r\n",
-            bactext_abort_reason_name((int) abort_reason));
-        Error_Detected = true;
-    }
-}
-
-void MyRejectHandler(
-    BACNET_ADDRESS * src,
-    uint8_t invoke_id,
-    uint8_t reject_reason)
-{
-    if (address_match(&Target_Address, src) &&
-        (invoke_id == Current_Invoke_ID)) {
-        printf("BACnet Reject: %s\r\n",
-            bactext_reject_reason_name((int) reject_reason));
-        Error_Detected = true;
-    }
+    (void) context;
+    printf("\rSending %lu of %lu bytes", (unsigned long) octets_done,
+        (unsigned long) octets_total);
+    fflush(stdout);
 }
 
 static void LocalIAmHandler(
@@ -147,11 +111,9 @@ static void Init_Service_Handlers(
     /* we must implement read property - it's required! */
     apdu_set_confirmed_handler(SERVICE_CONFIRMED_READ_PROPERTY,
         handler_read_property);
-    /* handle any errors coming back */
-    apdu_set_error_handler(SERVICE_CONFIRMED_ATOMIC_WRITE_FILE,
-        Atomic_Write_File_Error_Handler);
-    apdu_set_abort_handler(MyAbortHandler);
-    apdu_set_reject_handler(MyRejectHandler);
+    /* the replies to the file requests come back by way of the TSM */
+    File_Transfer_Init();
+    File_Transfer_Progress_Set(File_Transfer_Progress, NULL);
 }
 
 int main(
@@ -168,15 +130,13 @@ int main(
     time_t last_seconds = 0;
     time_t current_seconds = 0;
     time_t timeout_seconds = 0;
-    int fileStartPosition = 0;
-    unsigned requestedOctetCount = 0;
-    uint8_t invoke_id = 0;
     bool found = false;
-    uint16_t my_max_apdu = 0;
+    bool started = false;
+    bool error_detected = false;
+    unsigned window = 0;
+    FILE_TRANSFER_STATUS status = FILE_TRANSFER_IDLE;
     FILE *pFile = NULL;
-    static BACNET_OCTET_STRING fileData;
-    size_t len = 0;
-    bool pad_byte = false;
+    char *pEnv = NULL;
 
     if (argc < 4) {
         /* FIXME: what about access method - record or stream? */
@@ -200,11 +160,14 @@ int main(
         return 1;
     }
     if (argc > 4) {
-        Target_File_Requested_Octet_Count = strtol(argv[4], NULL, 0);
+        File_Transfer_Chunk_Size_Set(strtol(argv[4], NULL, 0));
     }
     if (argc > 5) {
-        Target_File_Requested_Octet_Pad_Byte = strtol(argv[5], NULL, 0);
-        pad_byte = true;
+        File_Transfer_Pad_Set(true, (uint8_t) strtol(argv[5], NULL, 0));
+    }
+    pEnv = getenv("BACNET_FILE_WINDOW");
+    if (pEnv) {
+        window = strtol(pEnv, NULL, 0);
     }
     /* setup my info */
     Device_Set_Object_Instance_Number(BACNET_MAX_INSTANCE);
@@ -246,72 +209,30 @@ int main(
                 &Target_Address);
         }
         if (found) {
-            if (Target_File_Requested_Octet_Count) {
-                requestedOctetCount = Target_File_Requested_Octet_Count;
-            } else {
-                /* calculate the smaller of our APDU size or theirs
-                   and remove the overhead of the APDU (varies depending on size).
-                   note: we could fail if there is a bottle neck (router)
-                   and smaller MPDU in betweeen. */
-                if (max_apdu < MAX_APDU) {
-                    my_max_apdu = max_apdu;
-                } else {
-                    my_max_apdu = MAX_APDU;
-                }
-                /* Typical sizes are 50, 128, 206, 480, 1024, and 1476 octets */
-                if (my_max_apdu <= 50) {
-                    requestedOctetCount = my_max_apdu - 19;
-                } else if (my_max_apdu <= 480) {
-                    requestedOctetCount = my_max_apdu - 32;
-                } else if (my_max_apdu <= 1476) {
-                    requestedOctetCount = my_max_apdu - 64;
-                } else {
-                    requestedOctetCount = my_max_apdu / 2;
-                }
-            }
-            /* has the previous invoke id expired or returned?
-               note: invoke ID = 0 is invalid, so it will be idle */
-            if ((invoke_id == 0) || tsm_invoke_id_free(invoke_id)) {
-                if (End_Of_File_Detected || Error_Detected) {
-                    printf("\r\n");
+            if (!started) {
+                started = true;
+                pFile = fopen(Local_File_Name, "rb");
+                if (!pFile) {
+                    fprintf(stderr, "Unable to open \"%s\" for reading.\r\n",
+                        Local_File_Name);
+                    error_detected = true;
                     break;
                 }
-                if (invoke_id != 0) {
-                    fileStartPosition += requestedOctetCount;
-                }
-                /* we'll read the file in chunks
-                   less than max_apdu to keep unsegmented */
-                pFile = fopen(Local_File_Name, "rb");
-                if (pFile) {
-                    (void) fseek(pFile, fileStartPosition, SEEK_SET);
-                    len =
-                        fread(octetstring_value(&fileData), 1,
-                        requestedOctetCount, pFile);
-                    if (len < requestedOctetCount) {
-                        End_Of_File_Detected = true;
-                        if (pad_byte) {
-                            memset(octetstring_value(&fileData) + len + 1,
-                                (int) Target_File_Requested_Octet_Pad_Byte,
-                                requestedOctetCount - len);
-                            len = requestedOctetCount;
-                        }
-                    }
-                    octetstring_truncate(&fileData, len);
-                    fclose(pFile);
-                } else {
-                    End_Of_File_Detected = true;
+                /* chunks are sized to the peer's max APDU
+                   to keep the transfer unsegmented */
+                if (!File_Transfer_Write_Start(Target_Device_Object_Instance,
+                        Target_File_Object_Instance, pFile, window)) {
+                    fprintf(stderr, "Unable to start the transfer!\r\n");
+                    error_detected = true;
+                    break;
                 }
-                printf("\rSending %d bytes", (int)(fileStartPosition + len));
-                invoke_id =
-                    Send_Atomic_Write_File_Stream
-                    (Target_Device_Object_Instance,
-                    Target_File_Object_Instance, fileStartPosition, &fileData);
-                Current_Invoke_ID = invoke_id;
-            } else if (tsm_invoke_id_failed(invoke_id)) {
-                fprintf(stderr, "\rError: TSM Timeout!\r\n");
-                tsm_free_invoke_id(invoke_id);
-                Error_Detected = true;
-                /* try again or abort? */
+            }
+            status = File_Transfer_Task();
+            if (status == FILE_TRANSFER_DONE) {
+                printf("\r\n");
+                break;
+            } else if (status == FILE_TRANSFER_FAILED) {
+                error_detected = true;
                 break;
             }
         } else {
@@ -319,7 +240,7 @@ int main(
             elapsed_seconds += (current_seconds - last_seconds);
             if (elapsed_seconds > timeout_seconds) {
                 fprintf(stderr, "\rError: APDU Timeout!\r\n");
-                Error_Detected = true;
+                error_detected = true;
                 break;
             }
         }
@@ -327,7 +248,10 @@ int main(
         last_seconds = current_seconds;
     }
 
-    if (Error_Detected) {
+    if (pFile) {
+        fclose(pFile);
+    }
+    if (error_detected) {
         return 1;
     }
     return 0;
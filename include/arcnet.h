@@ -40,6 +40,8 @@ extern "C" {
 
     bool arcnet_valid(
         void);
+    int arcnet_socket(
+        void);
     void arcnet_cleanup(
         void);
     bool arcnet_init(
@@ -0,0 +1,78 @@
+/**
+* @file
+* @author Steve Karg
+* @date 2026
+*
+* Arena (bump pointer) allocator for data that lives and dies together,
+* such as the decoded contents of one received message.
+* See the unit tests for usage examples.
+*/
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* size of each block taken from the heap, unless a single
+   allocation needs more than that */
+#ifndef ARENA_BLOCK_SIZE_DEFAULT
+#define ARENA_BLOCK_SIZE_DEFAULT 4096
+#endif
+
+/**
+* arena data structures
+*
+* @{
+*/
+struct arena_block_t {
+    /** next block in the list */
+    struct arena_block_t *next;
+    /** usable bytes in this block */
+    size_t size;
+    /** bytes handed out from this block */
+    size_t used;
+};
+
+struct arena_t {
+    /** blocks in use; the first one is the one being filled */
+    struct arena_block_t *head;
+    /** blocks kept by Arena_Reset() for reuse */
+    struct arena_block_t *spare;
+    /** size of new blocks, 0 means ARENA_BLOCK_SIZE_DEFAULT */
+    size_t block_size;
+};
+typedef struct arena_t ARENA;
+/** @} */
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    void Arena_Init(
+        ARENA * arena,
+        size_t block_size);
+
+    void *Arena_Alloc(
+        ARENA * arena,
+        size_t size);
+
+    size_t Arena_Used(
+        ARENA const *arena);
+
+    void Arena_Reset(
+        ARENA * arena);
+
+    void Arena_Free(
+        ARENA * arena);
+
+#ifdef TEST
+#include "ctest.h"
+    void testArena(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -93,6 +93,38 @@ typedef struct BACnet_Application_Data_Value {
     struct BACnet_Application_Data_Value *next;
 } BACNET_APPLICATION_DATA_VALUE;
 
+/* A decoded value that refers back into the buffer it was decoded from
+   instead of copying strings into it.  String, octet string and bit string
+   contents, and the contents of a constructed or unknown context value,
+   are described by data and data_len.  The buffer must outlive the view. */
+struct BACnet_Application_Data_View;
+typedef struct BACnet_Application_Data_View {
+    bool context_specific;      /* true if context specific data */
+    uint8_t context_tag;        /* only used for context specific data */
+    uint8_t tag;        /* application tag data type, or
+                           MAX_BACNET_APPLICATION_TAG if not known */
+    union {
+        bool Boolean;
+        uint32_t Unsigned_Int;
+        int32_t Signed_Int;
+        float Real;
+        double Double;
+        uint32_t Enumerated;
+        BACNET_DATE Date;
+        BACNET_TIME Time;
+        BACNET_OBJECT_ID Object_Id;
+        uint8_t Encoding;       /* character string */
+        uint8_t Unused_Bits;    /* bit string */
+    } type;
+    uint8_t *data;
+    uint32_t data_len;
+    /* the complete encoding, including the tags */
+    uint8_t *apdu;
+    uint32_t apdu_len;
+    /* simple linked list if needed */
+    struct BACnet_Application_Data_View *next;
+} BACNET_APPLICATION_DATA_VIEW;
+
 struct BACnet_Access_Error;
 typedef struct BACnet_Access_Error {
     BACNET_ERROR_CLASS error_class;
@@ -111,6 +143,18 @@ typedef struct BACnet_Property_Reference {
     struct BACnet_Property_Reference *next;
 } BACNET_PROPERTY_REFERENCE;
 
+struct BACnet_Property_View;
+typedef struct BACnet_Property_View {
+    BACNET_PROPERTY_ID propertyIdentifier;
+    uint32_t propertyArrayIndex;        /* optional */
+    /* either value or error, but not both.
+       Use NULL value to indicate error */
+    BACNET_APPLICATION_DATA_VIEW *value;
+    BACNET_ACCESS_ERROR error;
+    /* simple linked list */
+    struct BACnet_Property_View *next;
+} BACNET_PROPERTY_VIEW;
+
 struct BACnet_Property_Value;
 typedef struct BACnet_Property_Value {
     BACNET_PROPERTY_ID propertyIdentifier;
@@ -161,6 +205,7 @@ extern "C" {
         uint32_t new_apdu_len,
         BACNET_APPLICATION_DATA_VALUE * value);
 
+    /* apdu may be NULL to compute the encoded length only */
     int bacapp_encode_application_data(
         uint8_t * apdu,
         BACNET_APPLICATION_DATA_VALUE * value);
@@ -181,6 +226,17 @@ extern "C" {
         uint8_t context_tag_number,
         BACNET_APPLICATION_DATA_VALUE * value);
 
+    int bacapp_decode_data_view(
+        uint8_t * apdu,
+        unsigned max_apdu_len,
+        BACNET_PROPERTY_ID property,
+        BACNET_APPLICATION_DATA_VIEW * value);
+
+    bool bacapp_view_to_value(
+        BACNET_APPLICATION_DATA_VIEW * view,
+        BACNET_PROPERTY_ID property,
+        BACNET_APPLICATION_DATA_VALUE * value);
+
     BACNET_APPLICATION_TAG bacapp_context_tag_type(
         BACNET_PROPERTY_ID property,
         uint8_t tag_number);
@@ -248,6 +304,8 @@ extern "C" {
         Test * pTest);
     void testBACnetApplicationData(
         Test * pTest);
+    void testBACnetApplicationDataView(
+        Test * pTest);
 #endif
 
 #ifdef __cplusplus
@@ -34,12 +34,25 @@
 #include "bacreal.h"
 #include "bits.h"
 
+/* one tag header, from clause 20.2.1 */
+typedef struct BACnet_Tag_Header {
+    uint8_t number;
+    bool context;
+    bool opening;
+    bool closing;
+    /* length, or the value of an application tagged Boolean */
+    uint32_t len_value_type;
+} BACNET_TAG_HEADER;
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
 
 /* from clause 20.2.1 General Rules for Encoding BACnet Tags */
 /* returns the number of apdu bytes consumed */
+/* The encode_ functions accept a NULL apdu, in which case nothing is
+   written and the number of bytes that would be encoded is returned.
+   Use this to check that a value fits before encoding it in place. */
     int encode_tag(
         uint8_t * apdu,
         uint8_t tag_number,
@@ -70,6 +83,29 @@ extern "C" {
         uint32_t apdu_len_remaining,
         uint8_t * tag_number,
         uint32_t * value);
+    int decode_tag_header(
+        uint8_t * apdu,
+        uint32_t apdu_len_remaining,
+        BACNET_TAG_HEADER * tag);
+/* expect a context tag and decode its value in one pass: returns 0
+   if the next tag is not tag_number, or BACNET_STATUS_ERROR if the
+   value is truncated or malformed */
+    int decode_context_unsigned_safe(
+        uint8_t * apdu,
+        uint32_t apdu_len_remaining,
+        uint8_t tag_number,
+        uint32_t * value);
+    int decode_context_enumerated_safe(
+        uint8_t * apdu,
+        uint32_t apdu_len_remaining,
+        uint8_t tag_number,
+        uint32_t * value);
+    int decode_context_object_id_safe(
+        uint8_t * apdu,
+        uint32_t apdu_len_remaining,
+        uint8_t tag_number,
+        uint16_t * object_type,
+        uint32_t * instance);
 /* returns true if the tag is an opening tag and matches */
     bool decode_is_opening_tag_number(
         uint8_t * apdu,
@@ -55,6 +55,8 @@ extern "C" {
     /* functions that are custom per port */
     void bip6_set_interface(
         char *ifname);
+    int bip6_socket(
+        void);
 
     bool bip6_address_match_self(
         BACNET_IP6_ADDRESS *addr);
@@ -161,6 +161,14 @@ typedef struct BACnet_IP6_Foreign_Device_Table_Entry {
 extern "C" {
 
 #endif /* __cplusplus */
+
+#if defined(BBMD6_ENABLED) && BBMD6_ENABLED
+    void bvlc6_maintenance_timer(
+        time_t seconds);
+#else
+#define bvlc6_maintenance_timer(x)
+#endif
+
     int bvlc6_encode_address(
         uint8_t * pdu,
         uint16_t pdu_size,
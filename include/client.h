@@ -66,6 +66,22 @@ extern "C" {
         BACNET_ADDRESS * src,
         BACNET_ADDRESS * dest,
         BACNET_NPDU_DATA * npdu_data);
+    bool Send_I_Am_Pace_Init(
+        unsigned rate,
+        unsigned jitter,
+        unsigned window,
+        unsigned queue_size);
+    void Send_I_Am_Pace_Cleanup(
+        void);
+    void Send_I_Am_Paced(
+        uint32_t device_id,
+        BACNET_ADDRESS * dest);
+    void Send_I_Am_Pace_Timer(
+        uint16_t milliseconds);
+    uint16_t Send_I_Am_Pace_Next(
+        void);
+    unsigned Send_I_Am_Pace_Queued(
+        void);
 
     void Send_WhoIs(
         int32_t low_limit,
@@ -301,6 +317,12 @@ extern "C" {
         BACNET_ERROR_CLASS error_class,
         BACNET_ERROR_CODE error_code);
 
+#ifdef TEST
+#include "ctest.h"
+    void testIAmPace(
+        Test * pTest);
+#endif
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -125,6 +125,17 @@
 #define MAX_ADDRESS_CACHE 255
 #endif
 
+/* Buffers marked BACNET_THREAD_LOCAL get one copy per thread when the
+   server handles requests in a pool of worker threads (see workpool.h).
+   Define BACNET_WORKER_POOL to enable the pool. */
+#if !defined(BACNET_THREAD_LOCAL)
+#if defined(BACNET_WORKER_POOL)
+#define BACNET_THREAD_LOCAL __thread
+#else
+#define BACNET_THREAD_LOCAL
+#endif
+#endif
+
 /* some modules have debugging enabled using PRINT_ENABLED */
 #if !defined(PRINT_ENABLED)
 #define PRINT_ENABLED 0
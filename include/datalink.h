@@ -34,6 +34,7 @@
 #define datalink_send_pdu ethernet_send_pdu
 #define datalink_receive ethernet_receive
 #define datalink_cleanup ethernet_cleanup
+#define datalink_receive_fd ethernet_socket
 #define datalink_get_broadcast_address ethernet_get_broadcast_address
 #define datalink_get_my_address ethernet_get_my_address
 
@@ -44,6 +45,7 @@
 #define datalink_send_pdu arcnet_send_pdu
 #define datalink_receive arcnet_receive
 #define datalink_cleanup arcnet_cleanup
+#define datalink_receive_fd arcnet_socket
 #define datalink_get_broadcast_address arcnet_get_broadcast_address
 #define datalink_get_my_address arcnet_get_my_address
 
@@ -54,6 +56,7 @@
 #define datalink_send_pdu dlmstp_send_pdu
 #define datalink_receive dlmstp_receive
 #define datalink_cleanup dlmstp_cleanup
+#define datalink_receive_fd dlmstp_receive_fd
 #define datalink_get_broadcast_address dlmstp_get_broadcast_address
 #define datalink_get_my_address dlmstp_get_my_address
 
@@ -70,6 +73,7 @@
 #define datalink_receive bip_receive
 #endif
 #define datalink_cleanup bip_cleanup
+#define datalink_receive_fd bip_socket
 #define datalink_get_broadcast_address bip_get_broadcast_address
 #ifdef BAC_ROUTING
 extern void routed_get_my_address(
@@ -86,6 +90,7 @@ extern void routed_get_my_address(
 #define datalink_send_pdu bip6_send_pdu
 #define datalink_receive bip6_receive
 #define datalink_cleanup bip6_cleanup
+#define datalink_receive_fd bip6_socket
 #define datalink_get_broadcast_address bip6_get_broadcast_address
 #define datalink_get_my_address bip6_get_my_address
 
@@ -111,6 +116,8 @@ extern "C" {
         unsigned timeout);
     extern void datalink_cleanup(
         void);
+    extern int datalink_receive_fd(
+        void);
     extern void datalink_get_broadcast_address(
         BACNET_ADDRESS * dest);
     extern void datalink_get_my_address(
@@ -53,6 +53,9 @@ extern "C" {
         void);
     void dlmstp_cleanup(
         void);
+    /* readable while a received PDU is waiting; not on every port */
+    int dlmstp_receive_fd(
+        void);
 
     /* returns number of bytes sent on success, negative on failure */
     int dlmstp_send_pdu(
@@ -0,0 +1,108 @@
+/**
+* @file
+* @author Steve Karg
+* @date 2026
+*
+* Event loop that waits on file descriptors, monotonic millisecond
+* timers and deferred tasks, so that an application sleeps until there
+* is real work to do.  The loop is single threaded: every callback runs
+* from evloop_run() or evloop_run_once().
+*/
+#ifndef EVLOOP_H
+#define EVLOOP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* number of file descriptors that can be watched at once */
+#ifndef EVLOOP_FD_MAX
+#define EVLOOP_FD_MAX 8
+#endif
+/* number of tasks that can be waiting to run at once */
+#ifndef EVLOOP_DEFER_MAX
+#define EVLOOP_DEFER_MAX 16
+#endif
+
+typedef void (
+    *evloop_function) (
+    void *context);
+
+typedef void (
+    *evloop_fd_function) (
+    int fd,
+    void *context);
+
+/**
+* timer data structure, owned by the caller and linked into the loop
+* while it is running
+*
+* @{
+*/
+struct evloop_timer_t {
+    /** function called when the timer expires */
+    evloop_function callback;
+    void *context;
+    /** milliseconds between expirations, 0 for a one-shot timer */
+    uint32_t interval;
+    /** monotonic time of the next expiration */
+    uint64_t due;
+    bool active;
+    struct evloop_timer_t *next;
+};
+typedef struct evloop_timer_t EVLOOP_TIMER;
+/** @} */
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    bool evloop_init(
+        void);
+    void evloop_cleanup(
+        void);
+
+    bool evloop_fd_add(
+        int fd,
+        evloop_fd_function callback,
+        void *context);
+    bool evloop_fd_remove(
+        int fd);
+
+    void evloop_timer_init(
+        EVLOOP_TIMER * timer,
+        evloop_function callback,
+        void *context);
+    void evloop_timer_start(
+        EVLOOP_TIMER * timer,
+        uint32_t milliseconds,
+        uint32_t interval);
+    void evloop_timer_stop(
+        EVLOOP_TIMER * timer);
+    bool evloop_timer_active(
+        EVLOOP_TIMER const *timer);
+
+    bool evloop_defer(
+        evloop_function callback,
+        void *context);
+
+    uint64_t evloop_milliseconds(
+        void);
+
+    bool evloop_run_once(
+        int timeout);
+    void evloop_run(
+        void);
+    void evloop_stop(
+        void);
+
+#ifdef TEST
+#include "ctest.h"
+    void testEvloop(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -0,0 +1,110 @@
+/**************************************************************************
+*
+* Copyright (C) 2026 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#ifndef FILEXFER_H
+#define FILEXFER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "bacdef.h"
+#include "bacenum.h"
+#include "apdu.h"
+
+/* number of AtomicReadFile/AtomicWriteFile requests kept in flight */
+#ifndef FILE_TRANSFER_WINDOW_DEFAULT
+#define FILE_TRANSFER_WINDOW_DEFAULT 4
+#endif
+#ifndef FILE_TRANSFER_WINDOW_MAX
+#define FILE_TRANSFER_WINDOW_MAX 16
+#endif
+/* times a chunk is sent again after the TSM gives up on it */
+#ifndef FILE_TRANSFER_RETRIES
+#define FILE_TRANSFER_RETRIES 3
+#endif
+
+typedef enum {
+    FILE_TRANSFER_IDLE = 0,
+    FILE_TRANSFER_BUSY = 1,
+    FILE_TRANSFER_DONE = 2,
+    FILE_TRANSFER_FAILED = 3
+} FILE_TRANSFER_STATUS;
+
+/* called each time a chunk completes.  octets_total is zero
+   while reading, until the end of the remote file is known. */
+typedef void (
+    *file_transfer_progress_function) (
+    uint32_t octets_done,
+    uint32_t octets_total,
+    void *context);
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    void File_Transfer_Init(
+        void);
+    bool File_Transfer_Read_Start(
+        uint32_t device_id,
+        uint32_t file_instance,
+        FILE * pFile,
+        unsigned window);
+    bool File_Transfer_Write_Start(
+        uint32_t device_id,
+        uint32_t file_instance,
+        FILE * pFile,
+        unsigned window);
+    FILE_TRANSFER_STATUS File_Transfer_Task(
+        void);
+    FILE_TRANSFER_STATUS File_Transfer_Status(
+        void);
+
+    /* Simple setters and getter. */
+    void File_Transfer_Progress_Set(
+        file_transfer_progress_function pFunction,
+        void *context);
+    void File_Transfer_Chunk_Size_Set(
+        unsigned octets);
+    void File_Transfer_Pad_Set(
+        bool enable,
+        uint8_t value);
+    uint32_t File_Transfer_Octets(
+        void);
+
+#ifdef TEST
+#include "ctest.h"
+    void testFileTransferReadWindow(
+        Test * pTest);
+    void testFileTransferRetries(
+        Test * pTest);
+    void testFileTransferReject(
+        Test * pTest);
+    void testFileTransferWrite(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
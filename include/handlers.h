@@ -41,7 +41,21 @@
 #include "getevent.h"
 #include "get_alarm_sum.h"
 #include "alarm_ack.h"
-
+#include "cov.h"
+#include "arena.h"
+
+/* called with each COV notification that was received and decoded */
+typedef void (
+    *cov_notification_function) (
+    BACNET_ADDRESS * src,
+    BACNET_COV_DATA * cov_data);
+
+/* sends, or queues, the I-Am of a Device that a Who-Is asked for;
+   dest is NULL for a broadcast I-Am */
+typedef void (
+    *who_is_responder) (
+    uint32_t device_id,
+    BACNET_ADDRESS * dest);
 
 #ifdef __cplusplus
 extern "C" {
@@ -83,6 +97,9 @@ extern "C" {
         uint8_t * pdu,
         uint16_t pdu_len);
 
+    void handler_who_is_set_responder(
+        who_is_responder responder);
+
     void handler_who_is(
         uint8_t * service_request,
         uint16_t service_len,
@@ -242,6 +259,13 @@ extern "C" {
         uint8_t * apdu,
         int apdu_len,
         BACNET_READ_ACCESS_DATA * read_access_data);
+    /* Same, with the lists taken from an arena and the values
+       referring back into apdu instead of being copied. */
+    int rpm_ack_decode_service_request_view(
+        uint8_t * apdu,
+        int apdu_len,
+        ARENA * arena,
+        BACNET_READ_ACCESS_VIEW ** read_access_view);
     /* print the RP Ack data to stdout */
     void rp_ack_print_data(
         BACNET_READ_PROPERTY_DATA * data);
@@ -250,12 +274,16 @@ extern "C" {
     /* print the RPM Ack data to stdout */
     void rpm_ack_print_data(
         BACNET_READ_ACCESS_DATA * rpm_data);
+    void rpm_ack_print_view(
+        BACNET_READ_ACCESS_VIEW * rpm_data);
 
     void handler_cov_subscribe(
         uint8_t * service_request,
         uint16_t service_len,
         BACNET_ADDRESS * src,
         BACNET_CONFIRMED_SERVICE_DATA * service_data);
+    bool handler_cov_subscribe_local(
+        BACNET_SUBSCRIBE_COV_DATA * cov_data);
     bool handler_cov_fsm(
         void);
     void handler_cov_task(
@@ -272,11 +300,18 @@ extern "C" {
         uint8_t * service_request,
         uint16_t service_len,
         BACNET_ADDRESS * src);
+    void handler_ucov_notification_set(
+        cov_notification_function pFunction);
+    bool handler_ucov_notification_local(
+        BACNET_ADDRESS * src,
+        BACNET_COV_DATA * cov_data);
     void handler_ccov_notification(
         uint8_t * service_request,
         uint16_t service_len,
         BACNET_ADDRESS * src,
         BACNET_CONFIRMED_SERVICE_DATA * service_data);
+    void handler_ccov_notification_set(
+        cov_notification_function pFunction);
 
     void handler_lso(
         uint8_t * service_request,
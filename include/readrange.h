@@ -26,6 +26,7 @@
 
 #include "bacstr.h"
 #include "datetime.h"
+#include "bacapp.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -151,6 +152,27 @@ extern "C" {
         int apdu_len,   /* total length of the apdu */
         BACNET_READ_RANGE_DATA * rrdata);
 
+/** Callbacks made by rr_ack_decode_visit() while it walks a ReadRange-ACK.
+ * on_value() is called for each element of the itemData: a constructed
+ * element, such as the timestamp or logDatum of a BACnetLogRecord, comes
+ * as one view over its contents.  The views are only valid during the
+ * call.  Either callback may be NULL; return false to stop the walk. */
+    typedef struct BACnet_Read_Range_Ack_Visitor {
+        bool(*on_header) (
+            void *context,
+            BACNET_READ_RANGE_DATA * rrdata);
+        bool(*on_value) (
+            void *context,
+            BACNET_APPLICATION_DATA_VIEW * value);
+        void *context;
+    } BACNET_READ_RANGE_ACK_VISITOR;
+
+    int rr_ack_decode_visit(
+        uint8_t * apdu,
+        unsigned apdu_len,
+        BACNET_READ_RANGE_ACK_VISITOR * visitor,
+        BACNET_READ_RANGE_DATA * rrdata);
+
     uint8_t Send_ReadRange_Request(
         uint32_t device_id,     /* destination device */
         BACNET_READ_RANGE_DATA * read_access_data);
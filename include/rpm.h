@@ -53,6 +53,39 @@ typedef struct BACnet_Read_Access_Data {
     struct BACnet_Read_Access_Data *next;
 } BACNET_READ_ACCESS_DATA;
 
+/* decoded RPM-ACK whose values refer back into the received buffer */
+struct BACnet_Read_Access_View;
+typedef struct BACnet_Read_Access_View {
+    BACNET_OBJECT_TYPE object_type;
+    uint32_t object_instance;
+    /* simple linked list of values */
+    BACNET_PROPERTY_VIEW *listOfProperties;
+    struct BACnet_Read_Access_View *next;
+} BACNET_READ_ACCESS_VIEW;
+
+/* Callbacks made by rpm_ack_decode_visit() while it walks an RPM-ACK.
+   Each value is a view into the APDU that is only valid during the call.
+   A property is followed by its values (none for an empty list) or by
+   one error.  Any callback may be NULL; return false to stop the walk. */
+typedef struct BACnet_RPM_Ack_Visitor {
+    bool(*on_object) (
+        void *context,
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t object_instance);
+    bool(*on_property) (
+        void *context,
+        BACNET_PROPERTY_ID object_property,
+        uint32_t array_index);
+    bool(*on_value) (
+        void *context,
+        BACNET_APPLICATION_DATA_VIEW * value);
+    bool(*on_error) (
+        void *context,
+        BACNET_ERROR_CLASS error_class,
+        BACNET_ERROR_CODE error_code);
+    void *context;
+} BACNET_RPM_ACK_VISITOR;
+
 /** Fetches the lists of properties (array of BACNET_PROPERTY_ID's) for this
  *  object type, grouped by Required, Optional, and Proprietary.
  * A function template; @see device.c for assignment to object types.
@@ -130,6 +163,8 @@ extern "C" {
         uint8_t * apdu,
         uint8_t invoke_id);
 
+    /* the rpm_ack_encode_apdu_object functions return the length
+       only when apdu is NULL */
     int rpm_ack_encode_apdu_object_begin(
         uint8_t * apdu,
         BACNET_RPM_DATA * rpmdata);
@@ -166,6 +201,11 @@ extern "C" {
         unsigned apdu_len,
         BACNET_PROPERTY_ID * object_property,
         uint32_t * array_index);
+/* walk the whole RPM-ACK service request once, without copying */
+    int rpm_ack_decode_visit(
+        uint8_t * apdu,
+        unsigned apdu_len,
+        BACNET_RPM_ACK_VISITOR * visitor);
 #ifdef TEST
 #include "ctest.h"
     int rpm_decode_apdu(
@@ -186,6 +226,8 @@ extern "C" {
         Test * pTest);
     void testReadPropertyMultipleAck(
         Test * pTest);
+    void testReadPropertyMultipleAckVisitor(
+        Test * pTest);
 #endif
 
 #ifdef __cplusplus
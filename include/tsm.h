@@ -28,12 +28,51 @@
 #include <stdint.h>
 #include <stddef.h>
 #include "bacdef.h"
+#include "bacenum.h"
 #include "npdu.h"
+#include "apdu.h"
+
+/* how a confirmed request ended */
+typedef enum {
+    TSM_RESULT_ACK,
+    TSM_RESULT_SIMPLE_ACK,
+    TSM_RESULT_ERROR,
+    TSM_RESULT_REJECT,
+    TSM_RESULT_ABORT,
+    TSM_RESULT_TIMEOUT
+} BACNET_TSM_RESULT;
+
+/* the reply to a confirmed request, given to its completion function.
+   For a complex ACK, decode service_data with the ACK decoder of the
+   service, such as rp_ack_decode_service_request(). */
+typedef struct BACnet_TSM_Reply {
+    BACNET_TSM_RESULT result;
+    uint8_t invoke_id;
+    uint8_t service_choice;
+    /* who replied, or NULL for a timeout */
+    BACNET_ADDRESS *src;
+    /* complex ACK */
+    uint8_t *service_data;
+    uint16_t service_data_len;
+    BACNET_CONFIRMED_SERVICE_ACK_DATA *ack_data;
+    /* error */
+    BACNET_ERROR_CLASS error_class;
+    BACNET_ERROR_CODE error_code;
+    /* reject or abort */
+    uint8_t reason;
+    bool server;
+} BACNET_TSM_REPLY;
+
+typedef void (
+    *tsm_completion_function) (
+    BACNET_TSM_REPLY * reply,
+    void *context);
 
 /* note: TSM functionality is optional - only needed if we are
    doing client requests */
 #if (!MAX_TSM_TRANSACTIONS)
 #define tsm_free_invoke_id(x) (void)x;
+#define tsm_complete(x, r) (false)
 #else
 typedef enum {
     TSM_STATE_IDLE,
@@ -78,6 +117,9 @@ typedef struct BACnet_TSM_Data {
     /* copy of the APDU, should we need to send it again */
     uint8_t apdu[MAX_PDU];
     unsigned apdu_len;
+    /* called with the reply instead of the global handlers */
+    tsm_completion_function Completion;
+    void *Context;
 } BACNET_TSM_DATA;
 
 typedef void (
@@ -98,6 +140,8 @@ extern "C" {
         void);
     void tsm_timer_milliseconds(
         uint16_t milliseconds);
+    uint16_t tsm_timer_next(
+        void);
 /* free the invoke ID when the reply comes back */
     void tsm_free_invoke_id(
         uint8_t invokeID);
@@ -126,6 +170,21 @@ extern "C" {
     bool tsm_invoke_id_failed(
         uint8_t invokeID);
 
+/* route the reply to this request to a completion function */
+    bool tsm_set_completion(
+        uint8_t invokeID,
+        tsm_completion_function pFunction,
+        void *context);
+    bool tsm_complete(
+        uint8_t invokeID,
+        BACNET_TSM_REPLY * reply);
+
+#ifdef TEST
+#include "ctest.h"
+    void testTSM(
+        Test * pTest);
+#endif
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
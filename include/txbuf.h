@@ -30,6 +30,6 @@
 #include "config.h"
 #include "datalink.h"
 
-extern uint8_t Handler_Transmit_Buffer[MAX_PDU];
+extern BACNET_THREAD_LOCAL uint8_t Handler_Transmit_Buffer[MAX_PDU];
 
 #endif
@@ -0,0 +1,60 @@
+/**
+* @file
+* @author Steve Karg
+* @date 2026
+*
+* Pool of worker threads that handle received PDUs, so that a server
+* can answer several requests at once.  The receiving thread submits a
+* copy of each PDU it wants handled in parallel, and one of the workers
+* passes it to the handler function.
+*/
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "bacdef.h"
+
+/* most worker threads in a pool */
+#ifndef WORKPOOL_THREADS_MAX
+#define WORKPOOL_THREADS_MAX 64
+#endif
+/* PDUs that can be waiting for a worker; more are refused */
+#ifndef WORKPOOL_QUEUE_SIZE
+#define WORKPOOL_QUEUE_SIZE 64
+#endif
+
+typedef void (
+    *workpool_function) (
+    BACNET_ADDRESS * src,
+    uint8_t * pdu,
+    uint16_t pdu_len);
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    bool workpool_init(
+        unsigned threads,
+        workpool_function handler);
+    void workpool_cleanup(
+        void);
+    unsigned workpool_threads(
+        void);
+
+    bool workpool_submit(
+        BACNET_ADDRESS * src,
+        uint8_t * pdu,
+        uint16_t pdu_len);
+
+#ifdef TEST
+#include "ctest.h"
+    void testWorkpool(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -88,6 +88,13 @@ bool arcnet_valid(
     return (ARCNET_Sock_FD >= 0);
 }
 
+/* the ARCNET socket, so that an event loop can wait on it */
+int arcnet_socket(
+    void)
+{
+    return ARCNET_Sock_FD;
+}
+
 void arcnet_cleanup(
     void)
 {
@@ -347,6 +347,18 @@ uint16_t bip6_receive(
     return npdu_len;
 }
 
+/** Getter for the BACnet/IPv6 socket handle, so that an event loop
+ * can wait for it to become readable.
+ * @ingroup DLBIP6
+ *
+ * @return The handle to the BACnet/IPv6 socket, or -1 if it is closed.
+ */
+int bip6_socket(
+    void)
+{
+    return BIP6_Socket;
+}
+
 /** Cleanup and close out the BACnet/IP services by closing the socket.
  * @ingroup DLBIP6
   */
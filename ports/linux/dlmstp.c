@@ -30,6 +30,8 @@
 #include <string.h>
 #include <stdio.h>
 #include <sys/time.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 #include "bacdef.h"
 #include "bacaddr.h"
 #include "mstp.h"
@@ -56,6 +58,8 @@ static RT_MUTEX Receive_Packet_Mutex;
 */
 static pthread_cond_t Receive_Packet_Flag;
 static pthread_mutex_t Receive_Packet_Mutex;
+/* readable while Receive_Packet is ready, for an event loop */
+static int Receive_Packet_Event = -1;
 /* mechanism to wait for a frame in state machine */
 /*
 static RT_COND Received_Frame_Flag;
@@ -195,6 +199,18 @@ void dlmstp_cleanup(
     pthread_mutex_destroy(&Received_Frame_Mutex);
     pthread_mutex_destroy(&Receive_Packet_Mutex);
     pthread_mutex_destroy(&Master_Done_Mutex);
+    if (Receive_Packet_Event >= 0) {
+        close(Receive_Packet_Event);
+        Receive_Packet_Event = -1;
+    }
+}
+
+/* a descriptor that is readable while a received PDU is waiting
+   for dlmstp_receive(), or -1 if there is none */
+int dlmstp_receive_fd(
+    void)
+{
+    return Receive_Packet_Event;
 }
 
 /* returns number of bytes sent on success, zero on failure */
@@ -259,6 +275,13 @@ uint16_t dlmstp_receive(
             pdu_len = Receive_Packet.pdu_len;
         }
         Receive_Packet.ready = false;
+        if (Receive_Packet_Event >= 0) {
+            uint64_t count = 0;
+
+            if (read(Receive_Packet_Event, &count, sizeof(count)) < 0) {
+                /* nothing was signaled */
+            }
+        }
     }
     pthread_mutex_unlock(&Receive_Packet_Mutex);
 
@@ -364,6 +387,13 @@ uint16_t MSTP_Put_Receive(
         Receive_Packet.pdu_len = mstp_port->DataLength;
         Receive_Packet.ready = true;
         pthread_cond_signal(&Receive_Packet_Flag);
+        if (Receive_Packet_Event >= 0) {
+            uint64_t count = 1;
+
+            if (write(Receive_Packet_Event, &count, sizeof(count)) < 0) {
+                debug_printf("MS/TP: Receive event not signaled.\n");
+            }
+        }
     }
     pthread_mutex_unlock(&Receive_Packet_Mutex);
 
@@ -745,6 +775,7 @@ bool dlmstp_init(
             "MS/TP Interface: %s\n cannot allocate PThread Mutex.\n", ifname);
         exit(1);
     }
+    Receive_Packet_Event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
     /* initialize hardware */
     if (ifname) {
         RS485_Set_Interface(ifname);
@@ -36,11 +36,32 @@
 #include <stdbool.h>    /* for the standard bool type. */
 
 #include "net.h"
+#include <poll.h>
+#include <sys/mman.h>
+#include <linux/filter.h>
 #include "bacdef.h"
 #include "ethernet.h"
 #include "bacint.h"
 
-/** @file linux/ethernet.c  Provides Linux-specific functions for BACnet/Ethernet. */
+/** @file linux/ethernet.c  Provides Linux-specific functions for BACnet/Ethernet.
+ *
+ * Frames are normally read from the 802.2 socket one at a time.  When
+ * BACNET_ETHERNET_RING is set, the frames are received into a ring of
+ * blocks shared with the kernel (PACKET_RX_RING, TPACKET_V3) instead.
+ * A filter in the kernel passes only BACnet frames for this station,
+ * the kernel fills a block with as many frames as arrive, and
+ * ethernet_receive() takes them from the ring one by one without a
+ * system call until the block is used up.
+ */
+
+/* bytes in each block of the receive ring */
+#ifndef ETHERNET_RING_BLOCK_SIZE
+#define ETHERNET_RING_BLOCK_SIZE (1 << 16)
+#endif
+/* milliseconds before the kernel hands over a block that isn't full */
+#ifndef ETHERNET_RING_TIMEOUT
+#define ETHERNET_RING_TIMEOUT 1
+#endif
 
 /* commonly used comparison address for ethernet */
 uint8_t Ethernet_Broadcast[MAX_MAC_LEN] =
@@ -54,18 +75,39 @@ uint8_t Ethernet_MAC_Address[MAX_MAC_LEN] = { 0 };
 static int eth802_sockfd = -1;  /* 802.2 file handle */
 static struct sockaddr eth_addr = { 0 };        /* used for binding 802.2 */
 
+/* the receive ring, or NULL when frames are read from the socket */
+static uint8_t *Ring;
+static size_t Ring_Size;
+static unsigned Ring_Block_Count;
+/* block being read, and the next frame in it, or NULL for none */
+static unsigned Ring_Block;
+static struct tpacket3_hdr *Ring_Frame;
+static uint32_t Ring_Frames_Left;
+
 bool ethernet_valid(
     void)
 {
     return (eth802_sockfd >= 0);
 }
 
+/* the 802.2 socket, so that an event loop can wait on it */
+int ethernet_socket(
+    void)
+{
+    return eth802_sockfd;
+}
+
 void ethernet_cleanup(
     void)
 {
     if (ethernet_valid())
         close(eth802_sockfd);
     eth802_sockfd = -1;
+    if (Ring) {
+        munmap(Ring, Ring_Size);
+        Ring = NULL;
+    }
+    Ring_Frame = NULL;
 
     return;
 }
@@ -168,6 +210,131 @@ static int ethernet_bind(
     return sock_fd;
 }
 
+/* Passes only BACnet LLC frames sent to this station or broadcast,
+   so that the ring holds nothing else */
+static int ethernet_ring_filter(
+    int sock_fd)
+{
+    uint32_t mac_low = 0;
+    uint32_t mac_high = 0;
+    struct sock_filter code[] = {
+        /* DSAP and SSAP */
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 14),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x8282, 0, 11),
+        /* LLC Control */
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 16),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x03, 0, 9),
+        /* destination is this station */
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 2),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 2),
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 0),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 4, 0),
+        /* or broadcast */
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 2),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0xFFFFFFFF, 0, 3),
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 0),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0xFFFF, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, 0xFFFF),
+        BPF_STMT(BPF_RET | BPF_K, 0)
+    };
+    struct sock_fprog program;
+
+    mac_high =
+        ((uint32_t) Ethernet_MAC_Address[0] << 8) | Ethernet_MAC_Address[1];
+    mac_low =
+        ((uint32_t) Ethernet_MAC_Address[2] << 24) |
+        ((uint32_t) Ethernet_MAC_Address[3] << 16) |
+        ((uint32_t) Ethernet_MAC_Address[4] << 8) | Ethernet_MAC_Address[5];
+    code[5].k = mac_low;
+    code[7].k = mac_high;
+    program.len = sizeof(code) / sizeof(code[0]);
+    program.filter = code;
+
+    return setsockopt(sock_fd, SOL_SOCKET, SO_ATTACH_FILTER, &program,
+        sizeof(program));
+}
+
+/* opens an 802.2 packet socket that receives into a ring of
+   blocks shared with the kernel; returns -1 if that isn't possible,
+   so that the caller can use an ordinary socket instead */
+static int ethernet_ring_bind(
+    char *interface_name,
+    unsigned kilobytes)
+{
+    int sock_fd = -1;
+    int version = TPACKET_V3;
+    struct tpacket_req3 req;
+    struct sockaddr_ll ll_addr;
+    void *ring = NULL;
+
+    if (getuid() != 0) {
+        fprintf(stderr,
+            "ethernet: Unable to open an 802.2 socket.  "
+            "Try running with root priveleges.\n");
+        return -1;
+    }
+    /* no protocol until it is bound, so that nothing arrives
+       before the filter is in place */
+    sock_fd = socket(PF_PACKET, SOCK_RAW, 0);
+    if (sock_fd < 0) {
+        fprintf(stderr, "ethernet: Error opening packet socket: %s\n",
+            strerror(errno));
+        return -1;
+    }
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = ETHERNET_RING_BLOCK_SIZE;
+    /* at least two, so the kernel fills one while we read the other */
+    req.tp_block_nr = (kilobytes * 1024) / ETHERNET_RING_BLOCK_SIZE;
+    if (req.tp_block_nr < 2) {
+        req.tp_block_nr = 2;
+    }
+    req.tp_frame_size = TPACKET_ALIGN(TPACKET3_HDRLEN + MAX_MPDU);
+    req.tp_frame_nr =
+        (req.tp_block_size / req.tp_frame_size) * req.tp_block_nr;
+    req.tp_retire_blk_tov = ETHERNET_RING_TIMEOUT;
+    if ((ethernet_ring_filter(sock_fd) != 0) ||
+        (setsockopt(sock_fd, SOL_PACKET, PACKET_VERSION, &version,
+                sizeof(version)) != 0) ||
+        (setsockopt(sock_fd, SOL_PACKET, PACKET_RX_RING, &req,
+                sizeof(req)) != 0)) {
+        fprintf(stderr, "ethernet: Unable to set up the receive ring: %s\n",
+            strerror(errno));
+        close(sock_fd);
+        return -1;
+    }
+    ring =
+        mmap(NULL, (size_t) req.tp_block_size * req.tp_block_nr,
+        PROT_READ | PROT_WRITE, MAP_SHARED, sock_fd, 0);
+    if (ring == MAP_FAILED) {
+        fprintf(stderr, "ethernet: Unable to map the receive ring: %s\n",
+            strerror(errno));
+        close(sock_fd);
+        return -1;
+    }
+    memset(&ll_addr, 0, sizeof(ll_addr));
+    ll_addr.sll_family = AF_PACKET;
+    ll_addr.sll_protocol = htons(ETH_P_802_2);
+    ll_addr.sll_ifindex = (int) if_nametoindex(interface_name);
+    if ((ll_addr.sll_ifindex == 0) ||
+        (bind(sock_fd, (struct sockaddr *) &ll_addr, sizeof(ll_addr)) != 0)) {
+        fprintf(stderr, "ethernet: Unable to bind packet socket : %s\n",
+            strerror(errno));
+        munmap(ring, (size_t) req.tp_block_size * req.tp_block_nr);
+        close(sock_fd);
+        return -1;
+    }
+    Ring = ring;
+    Ring_Size = (size_t) req.tp_block_size * req.tp_block_nr;
+    Ring_Block_Count = req.tp_block_nr;
+    Ring_Block = 0;
+    Ring_Frame = NULL;
+    fprintf(stderr, "ethernet: receiving into a %u KiB ring on \"%s\"\n",
+        (unsigned) (Ring_Size / 1024), interface_name);
+    atexit(ethernet_cleanup);
+
+    return sock_fd;
+}
+
 /* function to find the local ethernet MAC address */
 static int get_local_hwaddr(
     const char *ifname,
@@ -194,17 +361,37 @@ static int get_local_hwaddr(
 bool ethernet_init(
     char *interface_name)
 {
-    if (interface_name) {
-        get_local_hwaddr(interface_name, Ethernet_MAC_Address);
+    char *pEnv = getenv("BACNET_ETHERNET_RING");
+
+    if (!interface_name) {
+        interface_name = "eth0";
+    }
+    get_local_hwaddr(interface_name, Ethernet_MAC_Address);
+    if (pEnv && (strtol(pEnv, NULL, 0) > 0)) {
+        eth802_sockfd =
+            ethernet_ring_bind(interface_name, (unsigned) strtol(pEnv, NULL,
+                0));
+    }
+    if (eth802_sockfd < 0) {
         eth802_sockfd = ethernet_bind(&eth_addr, interface_name);
-    } else {
-        get_local_hwaddr("eth0", Ethernet_MAC_Address);
-        eth802_sockfd = ethernet_bind(&eth_addr, "eth0");
     }
 
     return ethernet_valid();
 }
 
+/* the bound packet socket of the ring knows where frames go */
+static int ethernet_write(
+    uint8_t * mtu,
+    int mtu_len)
+{
+    if (Ring) {
+        return send(eth802_sockfd, mtu, mtu_len, 0);
+    }
+
+    return sendto(eth802_sockfd, mtu, mtu_len, 0,
+        (struct sockaddr *) &eth_addr, sizeof(struct sockaddr));
+}
+
 int ethernet_send(
     uint8_t * mtu,
     int mtu_len)
@@ -212,9 +399,7 @@ int ethernet_send(
     int bytes = 0;
 
     /* Send the packet */
-    bytes =
-        sendto(eth802_sockfd, &mtu, mtu_len, 0, (struct sockaddr *) &eth_addr,
-        sizeof(struct sockaddr));
+    bytes = ethernet_write(mtu, mtu_len);
     /* did it get sent? */
     if (bytes < 0)
         fprintf(stderr, "ethernet: Error sending packet: %s\n",
@@ -284,9 +469,7 @@ int ethernet_send_pdu(
     encode_unsigned16(&mtu[12], 3 + pdu_len);
 
     /* Send the packet */
-    bytes =
-        sendto(eth802_sockfd, &mtu, mtu_len, 0, (struct sockaddr *) &eth_addr,
-        sizeof(struct sockaddr));
+    bytes = ethernet_write(&mtu[0], mtu_len);
     /* did it get sent? */
     if (bytes < 0)
         fprintf(stderr, "ethernet: Error sending packet: %s\n",
@@ -295,6 +478,121 @@ int ethernet_send_pdu(
     return bytes;
 }
 
+/* takes the PDU out of a received 802.2 frame */
+/* returns the number of octets in the PDU, or zero if it isn't for us */
+static uint16_t ethernet_frame_pdu(
+    uint8_t * buf,
+    int received_bytes,
+    BACNET_ADDRESS * src,
+    uint8_t * pdu,
+    uint16_t max_pdu)
+{
+    uint16_t pdu_len = 0;       /* return value */
+
+    if (received_bytes < 17)
+        return 0;
+
+    /* the signature of an 802.2 BACnet packet */
+    if ((buf[14] != 0x82) && (buf[15] != 0x82)) {
+        /*fprintf(stderr,"ethernet: Non-BACnet packet\n"); */
+        return 0;
+    }
+    /* copy the source address */
+    src->mac_len = 6;
+    memmove(src->mac, &buf[6], 6);
+
+    /* check destination address for when */
+    /* the Ethernet card is in promiscious mode */
+    if ((memcmp(&buf[0], Ethernet_MAC_Address, 6) != 0)
+        && (memcmp(&buf[0], Ethernet_Broadcast, 6) != 0)) {
+        /*fprintf(stderr, "ethernet: This packet isn't for us\n"); */
+        return 0;
+    }
+
+    (void) decode_unsigned16(&buf[12], &pdu_len);
+    pdu_len -= 3 /* DSAP, SSAP, LLC Control */ ;
+    /* copy the buffer into the PDU */
+    if ((pdu_len < max_pdu) && ((17 + pdu_len) <= received_bytes))
+        memmove(&pdu[0], &buf[17], pdu_len);
+    /* ignore packets that are too large */
+    else
+        pdu_len = 0;
+
+    return pdu_len;
+}
+
+/* gives the current block back to the kernel and moves to the next */
+static void ethernet_ring_release(
+    void)
+{
+    struct tpacket_block_desc *block = (struct tpacket_block_desc *)
+        (Ring + (size_t) Ring_Block * ETHERNET_RING_BLOCK_SIZE);
+
+    /* done with the frames before the kernel may reuse them */
+    __sync_synchronize();
+    block->hdr.bh1.block_status = TP_STATUS_KERNEL;
+    Ring_Block = (Ring_Block + 1) % Ring_Block_Count;
+    Ring_Frame = NULL;
+}
+
+/* receives the next frame from the ring */
+static uint16_t ethernet_ring_receive(
+    BACNET_ADDRESS * src,
+    uint8_t * pdu,
+    uint16_t max_pdu,
+    unsigned timeout)
+{
+    struct tpacket_block_desc *block = NULL;
+    struct tpacket3_hdr *frame = NULL;
+    struct pollfd poll_fd;
+    bool waited = false;
+    uint16_t pdu_len = 0;
+
+    for (;;) {
+        if (!Ring_Frame) {
+            block = (struct tpacket_block_desc *)
+                (Ring + (size_t) Ring_Block * ETHERNET_RING_BLOCK_SIZE);
+            if ((block->hdr.bh1.block_status & TP_STATUS_USER) == 0) {
+                /* the kernel is still filling it */
+                if (waited || (timeout == 0)) {
+                    return 0;
+                }
+                poll_fd.fd = eth802_sockfd;
+                poll_fd.events = POLLIN | POLLERR;
+                poll_fd.revents = 0;
+                if (poll(&poll_fd, 1, (int) timeout) <= 0) {
+                    return 0;
+                }
+                waited = true;
+                continue;
+            }
+            /* read the frames only after seeing the status */
+            __sync_synchronize();
+            Ring_Frames_Left = block->hdr.bh1.num_pkts;
+            if (Ring_Frames_Left == 0) {
+                ethernet_ring_release();
+                continue;
+            }
+            Ring_Frame = (struct tpacket3_hdr *)
+                ((uint8_t *) block + block->hdr.bh1.offset_to_first_pkt);
+        }
+        frame = Ring_Frame;
+        pdu_len =
+            ethernet_frame_pdu((uint8_t *) frame + frame->tp_mac,
+            (int) frame->tp_snaplen, src, pdu, max_pdu);
+        Ring_Frames_Left--;
+        if (Ring_Frames_Left) {
+            Ring_Frame = (struct tpacket3_hdr *)
+                ((uint8_t *) frame + frame->tp_next_offset);
+        } else {
+            ethernet_ring_release();
+        }
+        if (pdu_len) {
+            return pdu_len;
+        }
+    }
+}
+
 /* receives an 802.2 framed packet */
 /* returns the number of octets in the PDU, or zero on failure */
 uint16_t ethernet_receive(
@@ -305,7 +603,6 @@ uint16_t ethernet_receive(
 {       /* number of milliseconds to wait for a packet */
     int received_bytes;
     uint8_t buf[MAX_MPDU] = { 0 };      /* data */
-    uint16_t pdu_len = 0;       /* return value */
     fd_set read_fds;
     int max;
     struct timeval select_timeout;
@@ -314,6 +611,9 @@ uint16_t ethernet_receive(
     if (eth802_sockfd <= 0)
         return 0;
 
+    if (Ring)
+        return ethernet_ring_receive(src, pdu, max_pdu, timeout);
+
     /* we could just use a non-blocking socket, but that consumes all
        the CPU time.  We can use a timeout; it is only supported as
        a select. */
@@ -348,34 +648,7 @@ uint16_t ethernet_receive(
     if (received_bytes == 0)
         return 0;
 
-    /* the signature of an 802.2 BACnet packet */
-    if ((buf[14] != 0x82) && (buf[15] != 0x82)) {
-        /*fprintf(stderr,"ethernet: Non-BACnet packet\n"); */
-        return 0;
-    }
-    /* copy the source address */
-    src->mac_len = 6;
-    memmove(src->mac, &buf[6], 6);
-
-    /* check destination address for when */
-    /* the Ethernet card is in promiscious mode */
-    if ((memcmp(&buf[0], Ethernet_MAC_Address, 6) != 0)
-        && (memcmp(&buf[0], Ethernet_Broadcast, 6) != 0)) {
-        /*fprintf(stderr, "ethernet: This packet isn't for us\n"); */
-        return 0;
-    }
-
-    (void) decode_unsigned16(&buf[12], &pdu_len);
-    pdu_len -= 3 /* DSAP, SSAP, LLC Control */ ;
-    /* copy the buffer into the PDU */
-    if (pdu_len < max_pdu)
-        memmove(&pdu[0], &buf[17], pdu_len);
-    /* ignore packets that are too large */
-    else
-        pdu_len = 0;
-
-
-    return pdu_len;
+    return ethernet_frame_pdu(&buf[0], received_bytes, src, pdu, max_pdu);
 }
 
 void ethernet_set_my_address(
@@ -0,0 +1,631 @@
+/**
+* @file
+* @author Steve Karg
+* @date 2026
+* @brief Event loop for Linux using epoll and timerfd.
+*
+* @section LICENSE
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to:
+* The Free Software Foundation, Inc.
+* 59 Temple Place - Suite 330
+* Boston, MA  02111-1307
+* USA.
+*
+* As a special exception, if other files instantiate templates or
+* use macros or inline functions from this file, or you compile
+* this file and link it with other works to produce a work based
+* on this file, this file does not by itself cause the resulting
+* work to be covered by the GNU General Public License. However
+* the source code for this file must still be made available in
+* accordance with section (3) of the GNU General Public License.
+*
+* This exception does not invalidate any other reasons why a work
+* based on this file might be covered by the GNU General Public
+* License.
+*
+* @section DESCRIPTION
+*
+* The loop waits in epoll_wait() on the watched file descriptors and
+* on one timerfd that is armed for the earliest running timer.  After
+* the ready descriptors and expired timers have been handled, the
+* deferred tasks run, and the loop goes back to sleep.
+*
+* Watch a datalink and start a periodic one second timer:
+* {@code
+* evloop_init();
+* evloop_fd_add(datalink_receive_fd(), my_receive, NULL);
+* evloop_timer_init(&timer, my_seconds, NULL);
+* evloop_timer_start(&timer, 1000, 1000);
+* evloop_run();
+* }
+*/
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include "evloop.h"
+
+struct evloop_watch_t {
+    int fd;
+    evloop_fd_function callback;
+    void *context;
+};
+
+struct evloop_task_t {
+    evloop_function callback;
+    void *context;
+};
+
+static int Epoll_FD = -1;
+static int Timer_FD = -1;
+static struct evloop_watch_t Watch_List[EVLOOP_FD_MAX];
+/* running timers sorted by due time */
+static EVLOOP_TIMER *Timer_List;
+static struct evloop_task_t Task_List[EVLOOP_DEFER_MAX];
+static unsigned Task_Count;
+static bool Running;
+
+/**
+* Monotonic clock in milliseconds, unaffected by changes to the time
+* of day.
+*
+* @return milliseconds since an arbitrary starting point
+*/
+uint64_t evloop_milliseconds(
+    void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t) now.tv_sec * 1000) + (now.tv_nsec / 1000000);
+}
+
+/* arm the timerfd for the first timer in the list, or disarm it */
+static void evloop_timer_arm(
+    void)
+{
+    struct itimerspec spec;
+
+    if (Timer_FD < 0) {
+        return;
+    }
+    memset(&spec, 0, sizeof(spec));
+    if (Timer_List) {
+        spec.it_value.tv_sec = (time_t) (Timer_List->due / 1000);
+        spec.it_value.tv_nsec = (long) (Timer_List->due % 1000) * 1000000;
+        if ((spec.it_value.tv_sec == 0) && (spec.it_value.tv_nsec == 0)) {
+            /* zero would disarm the timer */
+            spec.it_value.tv_nsec = 1;
+        }
+    }
+    timerfd_settime(Timer_FD, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+static void evloop_timer_unlink(
+    EVLOOP_TIMER * timer)
+{
+    EVLOOP_TIMER **link = &Timer_List;
+
+    while (*link) {
+        if (*link == timer) {
+            *link = timer->next;
+            break;
+        }
+        link = &(*link)->next;
+    }
+    timer->next = NULL;
+}
+
+static void evloop_timer_link(
+    EVLOOP_TIMER * timer)
+{
+    EVLOOP_TIMER **link = &Timer_List;
+
+    while (*link && ((*link)->due <= timer->due)) {
+        link = &(*link)->next;
+    }
+    timer->next = *link;
+    *link = timer;
+}
+
+/**
+* Prepares a timer for use.  The timer memory belongs to the caller
+* and must stay valid while the timer is running.
+*
+* @param timer - pointer to EVLOOP_TIMER structure
+* @param callback - function called each time the timer expires
+* @param context - passed to the callback
+*/
+void evloop_timer_init(
+    EVLOOP_TIMER * timer,
+    evloop_function callback,
+    void *context)
+{
+    if (timer) {
+        memset(timer, 0, sizeof(*timer));
+        timer->callback = callback;
+        timer->context = context;
+    }
+}
+
+/**
+* Starts, or restarts, a timer.
+*
+* @param timer - pointer to an initialized EVLOOP_TIMER
+* @param milliseconds - time until the first expiration
+* @param interval - time between later expirations, or 0 to expire once
+*/
+void evloop_timer_start(
+    EVLOOP_TIMER * timer,
+    uint32_t milliseconds,
+    uint32_t interval)
+{
+    EVLOOP_TIMER *first = Timer_List;
+
+    if (!timer) {
+        return;
+    }
+    if (timer->active) {
+        evloop_timer_unlink(timer);
+    }
+    timer->interval = interval;
+    timer->due = evloop_milliseconds() + milliseconds;
+    timer->active = true;
+    evloop_timer_link(timer);
+    if ((Timer_List == timer) || (first == timer)) {
+        evloop_timer_arm();
+    }
+}
+
+/**
+* Stops a timer.  Stopping a timer that is not running does nothing.
+*
+* @param timer - pointer to EVLOOP_TIMER structure
+*/
+void evloop_timer_stop(
+    EVLOOP_TIMER * timer)
+{
+    bool first = false;
+
+    if (timer && timer->active) {
+        first = (Timer_List == timer);
+        evloop_timer_unlink(timer);
+        timer->active = false;
+        if (first) {
+            evloop_timer_arm();
+        }
+    }
+}
+
+bool evloop_timer_active(
+    EVLOOP_TIMER const *timer)
+{
+    return (timer && timer->active);
+}
+
+/* run the callbacks of every timer that is due */
+static void evloop_timer_expire(
+    void)
+{
+    EVLOOP_TIMER *timer = NULL;
+    uint64_t now = evloop_milliseconds();
+
+    while (Timer_List && (Timer_List->due <= now)) {
+        timer = Timer_List;
+        Timer_List = timer->next;
+        timer->next = NULL;
+        if (timer->interval) {
+            /* keep the period even if this expiration ran late */
+            timer->due += timer->interval;
+            if (timer->due <= now) {
+                timer->due = now + timer->interval;
+            }
+            evloop_timer_link(timer);
+        } else {
+            timer->active = false;
+        }
+        if (timer->callback) {
+            timer->callback(timer->context);
+        }
+    }
+    evloop_timer_arm();
+}
+
+/**
+* Runs a function once, after the current ready descriptors and timers
+* have been handled and before the loop sleeps again.  Deferring the
+* same function and context twice before it runs queues it only once.
+*
+* @param callback - function to run
+* @param context - passed to the callback
+* @return true if the task is queued
+*/
+bool evloop_defer(
+    evloop_function callback,
+    void *context)
+{
+    unsigned i = 0;
+
+    if (!callback) {
+        return false;
+    }
+    for (i = 0; i < Task_Count; i++) {
+        if ((Task_List[i].callback == callback) &&
+            (Task_List[i].context == context)) {
+            return true;
+        }
+    }
+    if (Task_Count >= EVLOOP_DEFER_MAX) {
+        return false;
+    }
+    Task_List[Task_Count].callback = callback;
+    Task_List[Task_Count].context = context;
+    Task_Count++;
+
+    return true;
+}
+
+static void evloop_defer_run(
+    void)
+{
+    struct evloop_task_t task_list[EVLOOP_DEFER_MAX];
+    unsigned count = Task_Count;
+    unsigned i = 0;
+
+    /* tasks deferred by these tasks run on the next pass */
+    memcpy(task_list, Task_List, count * sizeof(task_list[0]));
+    Task_Count = 0;
+    for (i = 0; i < count; i++) {
+        task_list[i].callback(task_list[i].context);
+    }
+}
+
+/**
+* Watches a file descriptor, and calls the callback each time it is
+* readable.  The descriptor is level triggered, so the callback does
+* not have to read everything that is waiting.
+*
+* @param fd - file descriptor to watch
+* @param callback - function called when fd is readable
+* @param context - passed to the callback
+* @return true if the descriptor is being watched
+*/
+bool evloop_fd_add(
+    int fd,
+    evloop_fd_function callback,
+    void *context)
+{
+    struct epoll_event event;
+    unsigned i = 0;
+
+    if ((Epoll_FD < 0) || (fd < 0) || !callback) {
+        return false;
+    }
+    for (i = 0; i < EVLOOP_FD_MAX; i++) {
+        if (Watch_List[i].callback == NULL) {
+            memset(&event, 0, sizeof(event));
+            event.events = EPOLLIN;
+            event.data.ptr = &Watch_List[i];
+            if (epoll_ctl(Epoll_FD, EPOLL_CTL_ADD, fd, &event) != 0) {
+                return false;
+            }
+            Watch_List[i].fd = fd;
+            Watch_List[i].callback = callback;
+            Watch_List[i].context = context;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+* Stops watching a file descriptor.  Call this before closing it.
+*
+* @param fd - file descriptor given to evloop_fd_add()
+* @return true if the descriptor was being watched
+*/
+bool evloop_fd_remove(
+    int fd)
+{
+    unsigned i = 0;
+
+    for (i = 0; i < EVLOOP_FD_MAX; i++) {
+        if (Watch_List[i].callback && (Watch_List[i].fd == fd)) {
+            epoll_ctl(Epoll_FD, EPOLL_CTL_DEL, fd, NULL);
+            Watch_List[i].callback = NULL;
+            Watch_List[i].context = NULL;
+            Watch_List[i].fd = -1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+* Waits once for work, and handles all of the work that is ready.
+*
+* @param timeout - milliseconds to wait when there is nothing to do,
+*   or -1 to wait until something happens
+* @return true if anything was handled
+*/
+bool evloop_run_once(
+    int timeout)
+{
+    struct epoll_event events[EVLOOP_FD_MAX + 1];
+    struct evloop_watch_t *watch = NULL;
+    uint64_t expirations = 0;
+    bool timers = false;
+    int count = 0;
+    int i = 0;
+
+    if (Epoll_FD < 0) {
+        return false;
+    }
+    if (Task_Count) {
+        timeout = 0;
+    }
+    count = epoll_wait(Epoll_FD, events, EVLOOP_FD_MAX + 1, timeout);
+    if ((count < 0) && (errno != EINTR)) {
+        return false;
+    }
+    for (i = 0; i < count; i++) {
+        watch = (struct evloop_watch_t *) events[i].data.ptr;
+        if (watch == NULL) {
+            /* the timerfd */
+            if (read(Timer_FD, &expirations, sizeof(expirations)) < 0) {
+                /* another pass already handled it */
+            }
+            timers = true;
+        } else if (watch->callback) {
+            watch->callback(watch->fd, watch->context);
+        }
+    }
+    if (timers) {
+        evloop_timer_expire();
+    }
+    if (Task_Count) {
+        evloop_defer_run();
+        count++;
+    }
+
+    return (count > 0);
+}
+
+/**
+* Runs the loop until evloop_stop() is called from a callback.
+*/
+void evloop_run(
+    void)
+{
+    Running = true;
+    while (Running && (Epoll_FD >= 0)) {
+        evloop_run_once(-1);
+    }
+}
+
+void evloop_stop(
+    void)
+{
+    Running = false;
+}
+
+/**
+* Creates the epoll and timerfd descriptors.
+*
+* @return true if the event loop is ready to use
+*/
+bool evloop_init(
+    void)
+{
+    struct epoll_event event;
+    unsigned i = 0;
+
+    if (Epoll_FD >= 0) {
+        return true;
+    }
+    for (i = 0; i < EVLOOP_FD_MAX; i++) {
+        Watch_List[i].fd = -1;
+        Watch_List[i].callback = NULL;
+        Watch_List[i].context = NULL;
+    }
+    Timer_List = NULL;
+    Task_Count = 0;
+    Epoll_FD = epoll_create1(EPOLL_CLOEXEC);
+    if (Epoll_FD < 0) {
+        return false;
+    }
+    Timer_FD = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (Timer_FD < 0) {
+        evloop_cleanup();
+        return false;
+    }
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    if (epoll_ctl(Epoll_FD, EPOLL_CTL_ADD, Timer_FD, &event) != 0) {
+        evloop_cleanup();
+        return false;
+    }
+
+    return true;
+}
+
+void evloop_cleanup(
+    void)
+{
+    EVLOOP_TIMER *timer = NULL;
+
+    while (Timer_List) {
+        timer = Timer_List;
+        Timer_List = timer->next;
+        timer->next = NULL;
+        timer->active = false;
+    }
+    Task_Count = 0;
+    if (Timer_FD >= 0) {
+        close(Timer_FD);
+        Timer_FD = -1;
+    }
+    if (Epoll_FD >= 0) {
+        close(Epoll_FD);
+        Epoll_FD = -1;
+    }
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include "ctest.h"
+
+static unsigned Test_Order[8];
+static unsigned Test_Order_Count;
+
+static void test_timer_callback(
+    void *context)
+{
+    if (Test_Order_Count < 8) {
+        Test_Order[Test_Order_Count++] = *(unsigned *) context;
+    }
+}
+
+static void test_fd_callback(
+    int fd,
+    void *context)
+{
+    char data[8];
+
+    if (read(fd, data, sizeof(data)) > 0) {
+        (*(unsigned *) context)++;
+    }
+}
+
+static void test_defer_callback(
+    void *context)
+{
+    (*(unsigned *) context)++;
+}
+
+/**
+* Unit Test for the event loop
+*
+* @param pTest - test tracking pointer
+*/
+void testEvloop(
+    Test * pTest)
+{
+    EVLOOP_TIMER timer[3];
+    unsigned id[3] = { 0, 1, 2 };
+    unsigned reads = 0;
+    unsigned runs = 0;
+    uint64_t start = 0;
+    int pipe_fd[2] = { -1, -1 };
+    unsigned i = 0;
+
+    ct_test(pTest, evloop_init());
+    /* timers expire in due order, not start order */
+    evloop_timer_init(&timer[0], test_timer_callback, &id[0]);
+    evloop_timer_init(&timer[1], test_timer_callback, &id[1]);
+    evloop_timer_init(&timer[2], test_timer_callback, &id[2]);
+    start = evloop_milliseconds();
+    evloop_timer_start(&timer[0], 30, 0);
+    evloop_timer_start(&timer[1], 10, 0);
+    evloop_timer_start(&timer[2], 20, 0);
+    ct_test(pTest, evloop_timer_active(&timer[0]));
+    while ((Test_Order_Count < 3) && ((evloop_milliseconds() - start) < 1000)) {
+        evloop_run_once(-1);
+    }
+    ct_test(pTest, Test_Order_Count == 3);
+    ct_test(pTest, Test_Order[0] == 1);
+    ct_test(pTest, Test_Order[1] == 2);
+    ct_test(pTest, Test_Order[2] == 0);
+    ct_test(pTest, (evloop_milliseconds() - start) >= 30);
+    ct_test(pTest, !evloop_timer_active(&timer[0]));
+    /* periodic timer keeps running until stopped */
+    Test_Order_Count = 0;
+    evloop_timer_start(&timer[0], 5, 5);
+    evloop_timer_start(&timer[1], 1000, 0);
+    evloop_timer_stop(&timer[1]);
+    start = evloop_milliseconds();
+    while ((Test_Order_Count < 3) && ((evloop_milliseconds() - start) < 1000)) {
+        evloop_run_once(-1);
+    }
+    ct_test(pTest, Test_Order_Count == 3);
+    for (i = 0; i < 3; i++) {
+        ct_test(pTest, Test_Order[i] == 0);
+    }
+    ct_test(pTest, evloop_timer_active(&timer[0]));
+    evloop_timer_stop(&timer[0]);
+    ct_test(pTest, !evloop_timer_active(&timer[0]));
+    ct_test(pTest, !evloop_run_once(10));
+    /* readable descriptors call back */
+    ct_test(pTest, pipe(pipe_fd) == 0);
+    ct_test(pTest, evloop_fd_add(pipe_fd[0], test_fd_callback, &reads));
+    ct_test(pTest, write(pipe_fd[1], "x", 1) == 1);
+    ct_test(pTest, evloop_run_once(100));
+    ct_test(pTest, reads == 1);
+    ct_test(pTest, evloop_fd_remove(pipe_fd[0]));
+    ct_test(pTest, !evloop_fd_remove(pipe_fd[0]));
+    ct_test(pTest, write(pipe_fd[1], "x", 1) == 1);
+    ct_test(pTest, !evloop_run_once(10));
+    ct_test(pTest, reads == 1);
+    close(pipe_fd[0]);
+    close(pipe_fd[1]);
+    /* deferred tasks run once, even if deferred twice */
+    ct_test(pTest, evloop_defer(test_defer_callback, &runs));
+    ct_test(pTest, evloop_defer(test_defer_callback, &runs));
+    ct_test(pTest, evloop_run_once(-1));
+    ct_test(pTest, runs == 1);
+    ct_test(pTest, !evloop_defer(NULL, NULL));
+    evloop_cleanup();
+
+    return;
+}
+
+#ifdef TEST_EVLOOP
+/**
+* Main program entry for Unit Test
+*
+* @return  returns 0 on success, and non-zero on fail.
+*/
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("Event Loop", NULL);
+
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testEvloop);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif
+#endif
@@ -0,0 +1,307 @@
+/**
+* @file
+* @author Steve Karg
+* @date 2026
+* @brief Worker thread pool for Linux using pthreads.
+*
+* @section LICENSE
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to:
+* The Free Software Foundation, Inc.
+* 59 Temple Place - Suite 330
+* Boston, MA  02111-1307
+* USA.
+*
+* As a special exception, if other files instantiate templates or
+* use macros or inline functions from this file, or you compile
+* this file and link it with other works to produce a work based
+* on this file, this file does not by itself cause the resulting
+* work to be covered by the GNU General Public License. However
+* the source code for this file must still be made available in
+* accordance with section (3) of the GNU General Public License.
+*
+* This exception does not invalidate any other reasons why a work
+* based on this file might be covered by the GNU General Public
+* License.
+*
+* @section DESCRIPTION
+*
+* Each submitted PDU is copied into a free slot, and the slot number is
+* queued for the workers.  A worker handles the PDU in place and then
+* returns the slot to the free list, so a PDU is copied only once.
+* When every slot is in use, workpool_submit() refuses the PDU and the
+* caller handles it itself, which slows the receiver down to the speed
+* of the workers instead of dropping requests.
+*
+* The handler runs on several threads at once: any data it shares must
+* be locked, and each thread needs its own transmit buffer (see
+* BACNET_THREAD_LOCAL in config.h).
+*/
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "config.h"
+#include "datalink.h"
+#include "workpool.h"
+
+struct workpool_slot_t {
+    BACNET_ADDRESS src;
+    uint16_t pdu_len;
+    uint8_t pdu[MAX_MPDU];
+};
+
+static struct workpool_slot_t Slot_List[WORKPOOL_QUEUE_SIZE];
+/* slot numbers waiting for a worker, oldest first */
+static unsigned Ready_List[WORKPOOL_QUEUE_SIZE];
+static unsigned Ready_Head;
+static unsigned Ready_Count;
+/* slot numbers that are not in use */
+static unsigned Free_List[WORKPOOL_QUEUE_SIZE];
+static unsigned Free_Count;
+
+static pthread_mutex_t Pool_Mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t Pool_Ready = PTHREAD_COND_INITIALIZER;
+static pthread_t Thread_List[WORKPOOL_THREADS_MAX];
+static unsigned Thread_Count;
+static workpool_function Pool_Handler;
+static bool Pool_Stop;
+
+static void *workpool_thread(
+    void *arg)
+{
+    struct workpool_slot_t *slot = NULL;
+    unsigned index = 0;
+
+    (void) arg;
+    pthread_mutex_lock(&Pool_Mutex);
+    for (;;) {
+        while ((Ready_Count == 0) && !Pool_Stop) {
+            pthread_cond_wait(&Pool_Ready, &Pool_Mutex);
+        }
+        if (Ready_Count == 0) {
+            /* stopping, and nothing is left to do */
+            break;
+        }
+        index = Ready_List[Ready_Head];
+        Ready_Head = (Ready_Head + 1) % WORKPOOL_QUEUE_SIZE;
+        Ready_Count--;
+        pthread_mutex_unlock(&Pool_Mutex);
+        slot = &Slot_List[index];
+        Pool_Handler(&slot->src, &slot->pdu[0], slot->pdu_len);
+        pthread_mutex_lock(&Pool_Mutex);
+        Free_List[Free_Count++] = index;
+    }
+    pthread_mutex_unlock(&Pool_Mutex);
+
+    return NULL;
+}
+
+/**
+* Hands a received PDU to the next free worker.
+*
+* @param src - source address of the PDU
+* @param pdu - the PDU, which is copied
+* @param pdu_len - number of octets in the PDU
+* @return true if a worker will handle the PDU, false if the caller
+*   must handle it because the pool is not running or is full
+*/
+bool workpool_submit(
+    BACNET_ADDRESS * src,
+    uint8_t * pdu,
+    uint16_t pdu_len)
+{
+    struct workpool_slot_t *slot = NULL;
+    unsigned index = 0;
+
+    if ((Thread_Count == 0) || !src || !pdu || (pdu_len > MAX_MPDU)) {
+        return false;
+    }
+    pthread_mutex_lock(&Pool_Mutex);
+    if (Free_Count == 0) {
+        pthread_mutex_unlock(&Pool_Mutex);
+        return false;
+    }
+    index = Free_List[--Free_Count];
+    pthread_mutex_unlock(&Pool_Mutex);
+    /* the slot belongs to us until it is queued */
+    slot = &Slot_List[index];
+    memcpy(&slot->src, src, sizeof(slot->src));
+    memcpy(&slot->pdu[0], pdu, pdu_len);
+    slot->pdu_len = pdu_len;
+    pthread_mutex_lock(&Pool_Mutex);
+    Ready_List[(Ready_Head + Ready_Count) % WORKPOOL_QUEUE_SIZE] = index;
+    Ready_Count++;
+    pthread_cond_signal(&Pool_Ready);
+    pthread_mutex_unlock(&Pool_Mutex);
+
+    return true;
+}
+
+unsigned workpool_threads(
+    void)
+{
+    return Thread_Count;
+}
+
+/**
+* Starts the worker threads.
+*
+* @param threads - number of workers, 1 to WORKPOOL_THREADS_MAX
+* @param handler - function that handles each submitted PDU
+* @return true if at least one worker is running
+*/
+bool workpool_init(
+    unsigned threads,
+    workpool_function handler)
+{
+    unsigned i = 0;
+
+    if ((Thread_Count > 0) || !handler) {
+        return false;
+    }
+    if (threads > WORKPOOL_THREADS_MAX) {
+        threads = WORKPOOL_THREADS_MAX;
+    }
+    Pool_Handler = handler;
+    Pool_Stop = false;
+    Ready_Head = 0;
+    Ready_Count = 0;
+    for (i = 0; i < WORKPOOL_QUEUE_SIZE; i++) {
+        Free_List[i] = i;
+    }
+    Free_Count = WORKPOOL_QUEUE_SIZE;
+    for (i = 0; i < threads; i++) {
+        if (pthread_create(&Thread_List[Thread_Count], NULL,
+                workpool_thread, NULL) != 0) {
+            break;
+        }
+        Thread_Count++;
+    }
+
+    return (Thread_Count > 0);
+}
+
+/**
+* Lets the workers finish the PDUs already submitted, then stops them.
+*/
+void workpool_cleanup(
+    void)
+{
+    unsigned i = 0;
+
+    pthread_mutex_lock(&Pool_Mutex);
+    Pool_Stop = true;
+    pthread_cond_broadcast(&Pool_Ready);
+    pthread_mutex_unlock(&Pool_Mutex);
+    for (i = 0; i < Thread_Count; i++) {
+        pthread_join(Thread_List[i], NULL);
+    }
+    Thread_Count = 0;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include "ctest.h"
+
+static pthread_mutex_t Test_Mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned Test_Count;
+static unsigned long Test_Sum;
+
+static void test_handler(
+    BACNET_ADDRESS * src,
+    uint8_t * pdu,
+    uint16_t pdu_len)
+{
+    pthread_mutex_lock(&Test_Mutex);
+    if ((pdu_len == 2) && (src->mac_len == 1) && (src->mac[0] == pdu[0])) {
+        Test_Count++;
+        Test_Sum += pdu[1];
+    }
+    pthread_mutex_unlock(&Test_Mutex);
+}
+
+/**
+* Unit Test for the worker pool
+*
+* @param pTest - test tracking pointer
+*/
+void testWorkpool(
+    Test * pTest)
+{
+    BACNET_ADDRESS src = { 0 };
+    uint8_t pdu[2] = { 0 };
+    unsigned submitted = 0;
+    unsigned long sum = 0;
+    unsigned i = 0;
+
+    ct_test(pTest, !workpool_submit(&src, pdu, sizeof(pdu)));
+    ct_test(pTest, !workpool_init(4, NULL));
+    ct_test(pTest, workpool_init(4, test_handler));
+    ct_test(pTest, workpool_threads() == 4);
+    ct_test(pTest, !workpool_init(4, test_handler));
+    for (i = 0; i < 1000; i++) {
+        src.mac_len = 1;
+        src.mac[0] = (uint8_t) i;
+        pdu[0] = (uint8_t) i;
+        pdu[1] = (uint8_t) (i % 7);
+        /* a full pool refuses the PDU; handle it like a caller would */
+        if (workpool_submit(&src, pdu, sizeof(pdu))) {
+            submitted++;
+        } else {
+            test_handler(&src, pdu, sizeof(pdu));
+        }
+        sum += (i % 7);
+    }
+    ct_test(pTest, submitted > 0);
+    ct_test(pTest, !workpool_submit(&src, pdu, MAX_MPDU + 1));
+    workpool_cleanup();
+    ct_test(pTest, workpool_threads() == 0);
+    ct_test(pTest, Test_Count == 1000);
+    ct_test(pTest, Test_Sum == sum);
+    ct_test(pTest, !workpool_submit(&src, pdu, sizeof(pdu)));
+
+    return;
+}
+
+#ifdef TEST_WORKPOOL
+/**
+* Main program entry for Unit Test
+*
+* @return  returns 0 on success, and non-zero on fail.
+*/
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("Worker Pool", NULL);
+
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testWorkpool);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif
+#endif
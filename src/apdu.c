@@ -34,6 +34,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 #include "bits.h"
 #include "apdu.h"
 #include "bacdef.h"
@@ -430,6 +431,21 @@ static bool apdu_unconfirmed_dcc_disabled(
     return status;
 }
 
+/* fill in the reply to a confirmed request for tsm_complete() */
+static void apdu_tsm_reply_init(
+    BACNET_TSM_REPLY * reply,
+    BACNET_TSM_RESULT result,
+    BACNET_ADDRESS * src,
+    uint8_t invoke_id,
+    uint8_t service_choice)
+{
+    memset(reply, 0, sizeof(BACNET_TSM_REPLY));
+    reply->result = result;
+    reply->src = src;
+    reply->invoke_id = invoke_id;
+    reply->service_choice = service_choice;
+}
+
 /** Process the APDU header and invoke the appropriate service handler
  * to manage the received request.
  * Almost all requests and ACKs invoke this function.
@@ -457,6 +473,7 @@ void apdu_handler(
     uint32_t error_class = 0;
     uint8_t reason = 0;
     bool server = false;
+    BACNET_TSM_REPLY reply;
 
     if (apdu) {
         /* PDU Type */
@@ -500,6 +517,11 @@ void apdu_handler(
             case PDU_TYPE_SIMPLE_ACK:
                 invoke_id = apdu[1];
                 service_choice = apdu[2];
+                apdu_tsm_reply_init(&reply, TSM_RESULT_SIMPLE_ACK, src,
+                    invoke_id, service_choice);
+                if (tsm_complete(invoke_id, &reply)) {
+                    break;
+                }
                 switch (service_choice) {
                     case SERVICE_CONFIRMED_ACKNOWLEDGE_ALARM:
                     case SERVICE_CONFIRMED_COV_NOTIFICATION:
@@ -546,6 +568,14 @@ void apdu_handler(
                 service_choice = apdu[len++];
                 service_request = &apdu[len];
                 service_request_len = apdu_len - (uint16_t) len;
+                apdu_tsm_reply_init(&reply, TSM_RESULT_ACK, src, invoke_id,
+                    service_choice);
+                reply.service_data = service_request;
+                reply.service_data_len = service_request_len;
+                reply.ack_data = &service_ack_data;
+                if (tsm_complete(invoke_id, &reply)) {
+                    break;
+                }
                 switch (service_choice) {
                     case SERVICE_CONFIRMED_GET_ALARM_SUMMARY:
                     case SERVICE_CONFIRMED_GET_ENROLLMENT_SUMMARY:
@@ -612,6 +642,13 @@ void apdu_handler(
                         len++;  /* a tag number of 0 is not extended so only one octet */
                     }
                 }
+                apdu_tsm_reply_init(&reply, TSM_RESULT_ERROR, src, invoke_id,
+                    service_choice);
+                reply.error_class = (BACNET_ERROR_CLASS) error_class;
+                reply.error_code = (BACNET_ERROR_CODE) error_code;
+                if (tsm_complete(invoke_id, &reply)) {
+                    break;
+                }
                 if (service_choice < MAX_BACNET_CONFIRMED_SERVICE) {
                     if (Error_Function[service_choice])
                         Error_Function[service_choice] (src, invoke_id,
@@ -623,6 +660,12 @@ void apdu_handler(
             case PDU_TYPE_REJECT:
                 invoke_id = apdu[1];
                 reason = apdu[2];
+                apdu_tsm_reply_init(&reply, TSM_RESULT_REJECT, src,
+                    invoke_id, 0);
+                reply.reason = reason;
+                if (tsm_complete(invoke_id, &reply)) {
+                    break;
+                }
                 if (Reject_Function)
                     Reject_Function(src, invoke_id, reason);
                 tsm_free_invoke_id(invoke_id);
@@ -631,6 +674,14 @@ void apdu_handler(
                 server = apdu[0] & 0x01;
                 invoke_id = apdu[1];
                 reason = apdu[2];
+                apdu_tsm_reply_init(&reply, TSM_RESULT_ABORT, src, invoke_id,
+                    0);
+                reply.reason = reason;
+                reply.server = server;
+                /* only an abort from a server is about our request */
+                if (server && tsm_complete(invoke_id, &reply)) {
+                    break;
+                }
                 if (Abort_Function)
                     Abort_Function(src, invoke_id, reason, server);
                 tsm_free_invoke_id(invoke_id);
@@ -0,0 +1,310 @@
+/**
+* @file
+* @author Steve Karg
+* @date 2026
+* @brief Arena (bump pointer) allocator.
+*
+* @section LICENSE
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to:
+* The Free Software Foundation, Inc.
+* 59 Temple Place - Suite 330
+* Boston, MA  02111-1307
+* USA.
+*
+* As a special exception, if other files instantiate templates or
+* use macros or inline functions from this file, or you compile
+* this file and link it with other works to produce a work based
+* on this file, this file does not by itself cause the resulting
+* work to be covered by the GNU General Public License. However
+* the source code for this file must still be made available in
+* accordance with section (3) of the GNU General Public License.
+*
+* This exception does not invalidate any other reasons why a work
+* based on this file might be covered by the GNU General Public
+* License.
+*
+* @section DESCRIPTION
+*
+* An arena hands out zeroed, 8 byte aligned memory from large blocks
+* and releases all of it at once.  It replaces a calloc()/free() pair
+* per node for structures that are built and thrown away together,
+* such as the linked lists decoded from one ReadPropertyMultiple-ACK.
+*
+* Declare the arena, optionally choosing the block size:
+* {@code
+* static ARENA arena;
+* Arena_Init(&arena, 4096);
+* }
+*
+* Allocate as many nodes as needed while decoding:
+* {@code
+* node = Arena_Alloc(&arena, sizeof(*node));
+* }
+*
+* When the data is no longer needed, Arena_Reset() makes all of the
+* memory available again without returning it to the heap, and
+* Arena_Free() returns it to the heap.
+*
+*/
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+/* all allocations are rounded up to this alignment */
+#define ARENA_ALIGN(n) (((n) + 7) & ~((size_t) 7))
+/* the block header is followed by the data */
+#define ARENA_HEADER_SIZE ARENA_ALIGN(sizeof(struct arena_block_t))
+#define ARENA_BLOCK_DATA(b) ((uint8_t *) (b) + ARENA_HEADER_SIZE)
+
+/**
+* Initializes the arena.  A zeroed ARENA is also valid and uses
+* the default block size.
+*
+* @param arena - pointer to ARENA structure
+* @param block_size - size of each block taken from the heap,
+*   or 0 for ARENA_BLOCK_SIZE_DEFAULT
+*/
+void Arena_Init(
+    ARENA * arena,
+    size_t block_size)
+{
+    if (arena) {
+        arena->head = NULL;
+        arena->spare = NULL;
+        arena->block_size = block_size;
+    }
+}
+
+/**
+* Returns zeroed memory from the arena.
+*
+* @param arena - pointer to ARENA structure
+* @param size - number of bytes needed
+*
+* @return pointer to the memory, or NULL if the heap is exhausted
+*/
+void *Arena_Alloc(
+    ARENA * arena,
+    size_t size)
+{
+    struct arena_block_t *block = NULL;
+    struct arena_block_t **link = NULL;
+    size_t block_size = 0;
+    uint8_t *data = NULL;
+
+    if (!arena) {
+        return NULL;
+    }
+    size = ARENA_ALIGN(size ? size : 1);
+    block = arena->head;
+    if (!block || ((block->size - block->used) < size)) {
+        /* look for a spare block that is big enough */
+        link = &arena->spare;
+        while (*link && ((*link)->size < size)) {
+            link = &(*link)->next;
+        }
+        block = *link;
+        if (block) {
+            *link = block->next;
+        } else {
+            block_size = arena->block_size;
+            if (block_size == 0) {
+                block_size = ARENA_BLOCK_SIZE_DEFAULT;
+            }
+            block_size = ARENA_ALIGN(block_size);
+            if (block_size < size) {
+                block_size = size;
+            }
+            block = malloc(ARENA_HEADER_SIZE + block_size);
+            if (!block) {
+                return NULL;
+            }
+            block->size = block_size;
+        }
+        block->used = 0;
+        block->next = arena->head;
+        arena->head = block;
+    }
+    data = ARENA_BLOCK_DATA(block) + block->used;
+    block->used += size;
+    memset(data, 0, size);
+
+    return data;
+}
+
+/**
+* Returns the number of bytes handed out since the last reset
+*
+* @param arena - pointer to ARENA structure
+*
+* @return number of bytes, including alignment padding
+*/
+size_t Arena_Used(
+    ARENA const *arena)
+{
+    struct arena_block_t *block = NULL;
+    size_t used = 0;
+
+    if (arena) {
+        block = arena->head;
+        while (block) {
+            used += block->used;
+            block = block->next;
+        }
+    }
+
+    return used;
+}
+
+/**
+* Releases everything allocated from the arena, keeping the
+* blocks for the next round of allocations.
+*
+* @param arena - pointer to ARENA structure
+*/
+void Arena_Reset(
+    ARENA * arena)
+{
+    struct arena_block_t *block = NULL;
+
+    if (arena) {
+        while (arena->head) {
+            block = arena->head;
+            arena->head = block->next;
+            block->used = 0;
+            block->next = arena->spare;
+            arena->spare = block;
+        }
+    }
+}
+
+/**
+* Returns all of the arena blocks to the heap.
+*
+* @param arena - pointer to ARENA structure
+*/
+void Arena_Free(
+    ARENA * arena)
+{
+    struct arena_block_t *block = NULL;
+
+    if (arena) {
+        Arena_Reset(arena);
+        while (arena->spare) {
+            block = arena->spare;
+            arena->spare = block->next;
+            free(block);
+        }
+    }
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include "ctest.h"
+
+/**
+* Unit Test for the arena allocator
+*
+* @param pTest - test tracking pointer
+*/
+void testArena(
+    Test * pTest)
+{
+    ARENA arena = { 0 };
+    uint8_t *data[64] = { NULL };
+    uint8_t *big = NULL;
+    unsigned index = 0;
+    unsigned i = 0;
+
+    Arena_Init(&arena, 256);
+    ct_test(pTest, Arena_Used(&arena) == 0);
+    for (index = 0; index < 64; index++) {
+        data[index] = Arena_Alloc(&arena, 1 + index);
+        ct_test(pTest, data[index] != NULL);
+        ct_test(pTest, (((size_t) data[index]) & 7) == 0);
+        for (i = 0; i < (1 + index); i++) {
+            ct_test(pTest, data[index][i] == 0);
+        }
+        memset(data[index], (int) index, 1 + index);
+    }
+    /* nothing got clobbered by a later allocation */
+    for (index = 0; index < 64; index++) {
+        for (i = 0; i < (1 + index); i++) {
+            ct_test(pTest, data[index][i] == index);
+        }
+    }
+    ct_test(pTest, Arena_Used(&arena) >= (64 * 65 / 2));
+    /* larger than a block */
+    big = Arena_Alloc(&arena, 1000);
+    ct_test(pTest, big != NULL);
+    memset(big, 0xAA, 1000);
+    /* reset reuses the same memory, zeroed */
+    Arena_Reset(&arena);
+    ct_test(pTest, Arena_Used(&arena) == 0);
+    ct_test(pTest, arena.head == NULL);
+    data[0] = Arena_Alloc(&arena, 8);
+    ct_test(pTest, data[0] != NULL);
+    ct_test(pTest, data[0][0] == 0);
+    big = Arena_Alloc(&arena, 1000);
+    ct_test(pTest, big != NULL);
+    for (i = 0; i < 1000; i++) {
+        ct_test(pTest, big[i] == 0);
+    }
+    Arena_Free(&arena);
+    ct_test(pTest, arena.head == NULL);
+    ct_test(pTest, arena.spare == NULL);
+    /* zeroed arena works with the default block size */
+    memset(&arena, 0, sizeof(arena));
+    data[0] = Arena_Alloc(&arena, 16);
+    ct_test(pTest, data[0] != NULL);
+    ct_test(pTest, arena.head->size == ARENA_BLOCK_SIZE_DEFAULT);
+    Arena_Free(&arena);
+    ct_test(pTest, Arena_Alloc(NULL, 16) == NULL);
+
+    return;
+}
+
+#ifdef TEST_ARENA
+/**
+* Main program entry for Unit Test
+*
+* @return  returns 0 on success, and non-zero on fail.
+*/
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("Arena", NULL);
+
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testArena);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif
+#endif
@@ -60,89 +60,91 @@ int bacapp_encode_application_data(
 {
     int apdu_len = 0;   /* total length of the apdu, return value */
 
-    if (value && apdu) {
+    if (value) {
         switch (value->tag) {
 #if defined (BACAPP_NULL)
             case BACNET_APPLICATION_TAG_NULL:
-                apdu[0] = value->tag;
+                if (apdu) {
+                    apdu[0] = value->tag;
+                }
                 apdu_len++;
                 break;
 #endif
 #if defined (BACAPP_BOOLEAN)
             case BACNET_APPLICATION_TAG_BOOLEAN:
                 apdu_len =
-                    encode_application_boolean(&apdu[0], value->type.Boolean);
+                    encode_application_boolean(apdu, value->type.Boolean);
                 break;
 #endif
 #if defined (BACAPP_UNSIGNED)
             case BACNET_APPLICATION_TAG_UNSIGNED_INT:
                 apdu_len =
-                    encode_application_unsigned(&apdu[0],
+                    encode_application_unsigned(apdu,
                     value->type.Unsigned_Int);
                 break;
 #endif
 #if defined (BACAPP_SIGNED)
             case BACNET_APPLICATION_TAG_SIGNED_INT:
                 apdu_len =
-                    encode_application_signed(&apdu[0],
+                    encode_application_signed(apdu,
                     value->type.Signed_Int);
                 break;
 #endif
 #if defined (BACAPP_REAL)
             case BACNET_APPLICATION_TAG_REAL:
-                apdu_len = encode_application_real(&apdu[0], value->type.Real);
+                apdu_len = encode_application_real(apdu, value->type.Real);
                 break;
 #endif
 #if defined (BACAPP_DOUBLE)
             case BACNET_APPLICATION_TAG_DOUBLE:
                 apdu_len =
-                    encode_application_double(&apdu[0], value->type.Double);
+                    encode_application_double(apdu, value->type.Double);
                 break;
 #endif
 #if defined (BACAPP_OCTET_STRING)
             case BACNET_APPLICATION_TAG_OCTET_STRING:
                 apdu_len =
-                    encode_application_octet_string(&apdu[0],
+                    encode_application_octet_string(apdu,
                     &value->type.Octet_String);
                 break;
 #endif
 #if defined (BACAPP_CHARACTER_STRING)
             case BACNET_APPLICATION_TAG_CHARACTER_STRING:
                 apdu_len =
-                    encode_application_character_string(&apdu[0],
+                    encode_application_character_string(apdu,
                     &value->type.Character_String);
                 break;
 #endif
 #if defined (BACAPP_BIT_STRING)
             case BACNET_APPLICATION_TAG_BIT_STRING:
                 apdu_len =
-                    encode_application_bitstring(&apdu[0],
+                    encode_application_bitstring(apdu,
                     &value->type.Bit_String);
                 break;
 #endif
 #if defined (BACAPP_ENUMERATED)
             case BACNET_APPLICATION_TAG_ENUMERATED:
                 apdu_len =
-                    encode_application_enumerated(&apdu[0],
+                    encode_application_enumerated(apdu,
                     value->type.Enumerated);
                 break;
 #endif
 #if defined (BACAPP_DATE)
             case BACNET_APPLICATION_TAG_DATE:
                 apdu_len =
-                    encode_application_date(&apdu[0], &value->type.Date);
+                    encode_application_date(apdu, &value->type.Date);
                 break;
 #endif
 #if defined (BACAPP_TIME)
             case BACNET_APPLICATION_TAG_TIME:
                 apdu_len =
-                    encode_application_time(&apdu[0], &value->type.Time);
+                    encode_application_time(apdu, &value->type.Time);
                 break;
 #endif
 #if defined (BACAPP_OBJECT_ID)
             case BACNET_APPLICATION_TAG_OBJECT_ID:
                 apdu_len =
-                    encode_application_object_id(&apdu[0],
+                    encode_application_object_id(apdu,
                     (int) value->type.Object_Id.type,
                     value->type.Object_Id.instance);
                 break;
@@ -150,7 +152,7 @@ int bacapp_encode_application_data(
 #if defined (BACAPP_LIGHTING_COMMAND)
             case BACNET_APPLICATION_TAG_LIGHTING_COMMAND:
                 apdu_len =
-                    lighting_command_encode(&apdu[0],
+                    lighting_command_encode(apdu,
                     &value->type.Lighting_Command);
                 break;
 #endif
@@ -158,7 +160,7 @@ int bacapp_encode_application_data(
             case BACNET_APPLICATION_TAG_DEVICE_OBJECT_PROPERTY_REFERENCE:
                 /* BACnetDeviceObjectPropertyReference */
                 apdu_len =
-                    bacapp_encode_device_obj_property_ref(&apdu[0],
+                    bacapp_encode_device_obj_property_ref(apdu,
                     &value->type.Device_Object_Property_Reference);
                 break;
 #endif
@@ -822,6 +824,171 @@ int bacapp_decode_context_data_len(
     return apdu_len;
 }
 
+/* Decode one application or context tagged value, or one constructed
+   value between an opening and closing tag, into a view that refers
+   back into apdu for string contents.  Nothing is copied or allocated.
+   Returns the number of octets consumed, 0 at a closing tag,
+   or BACNET_STATUS_ERROR if the value does not fit in max_apdu_len. */
+int bacapp_decode_data_view(
+    uint8_t * apdu,
+    unsigned max_apdu_len,
+    BACNET_PROPERTY_ID property,
+    BACNET_APPLICATION_DATA_VIEW * value)
+{
+    int len = 0;
+    int tag_len = 0;
+    int data_len = 0;
+    uint8_t tag_number = 0;
+    uint32_t len_value_type = 0;
+    uint32_t content_len = 0;
+    uint8_t *content = NULL;
+    uint16_t object_type = 0;
+
+    if (!apdu || !value || (max_apdu_len == 0)) {
+        return BACNET_STATUS_ERROR;
+    }
+    if (IS_CLOSING_TAG(apdu[0])) {
+        return 0;
+    }
+    tag_len =
+        decode_tag_number_and_value_safe(&apdu[0], max_apdu_len, &tag_number,
+        &len_value_type);
+    if (tag_len <= 0) {
+        return BACNET_STATUS_ERROR;
+    }
+    value->context_specific = IS_CONTEXT_SPECIFIC(apdu[0]);
+    value->context_tag = 0;
+    value->tag = MAX_BACNET_APPLICATION_TAG;
+    memset(&value->type, 0, sizeof(value->type));
+    value->apdu = &apdu[0];
+    value->next = NULL;
+    if (IS_OPENING_TAG(apdu[0])) {
+        /* constructed data: keep the contents as raw octets */
+        data_len = bacapp_data_len(&apdu[0], max_apdu_len, property);
+        if (data_len < 0) {
+            return BACNET_STATUS_ERROR;
+        }
+        /* the closing tag is encoded in as many octets as the opening tag */
+        len = tag_len + data_len + tag_len;
+        if ((unsigned) len > max_apdu_len) {
+            return BACNET_STATUS_ERROR;
+        }
+        value->context_tag = tag_number;
+        value->data = &apdu[tag_len];
+        value->data_len = data_len;
+        value->apdu_len = len;
+        return len;
+    }
+    content = &apdu[tag_len];
+    if (value->context_specific) {
+        value->context_tag = tag_number;
+        value->tag = bacapp_context_tag_type(property, tag_number);
+        content_len = len_value_type;
+    } else {
+        value->tag = tag_number;
+        if (tag_number == BACNET_APPLICATION_TAG_BOOLEAN) {
+            /* the value is in the tag */
+            content_len = 0;
+        } else {
+            content_len = len_value_type;
+        }
+    }
+    if (content_len > (max_apdu_len - tag_len)) {
+        return BACNET_STATUS_ERROR;
+    }
+    value->data = content;
+    value->data_len = content_len;
+    switch (value->tag) {
+        case BACNET_APPLICATION_TAG_NULL:
+            break;
+        case BACNET_APPLICATION_TAG_BOOLEAN:
+            if (value->context_specific) {
+                value->type.Boolean = (content_len && content[0]);
+            } else {
+                value->type.Boolean = decode_boolean(len_value_type);
+            }
+            break;
+        case BACNET_APPLICATION_TAG_UNSIGNED_INT:
+            decode_unsigned(content, content_len, &value->type.Unsigned_Int);
+            break;
+        case BACNET_APPLICATION_TAG_SIGNED_INT:
+            decode_signed(content, content_len, &value->type.Signed_Int);
+            break;
+        case BACNET_APPLICATION_TAG_REAL:
+            decode_real_safe(content, content_len, &value->type.Real);
+            break;
+        case BACNET_APPLICATION_TAG_DOUBLE:
+            decode_double_safe(content, content_len, &value->type.Double);
+            break;
+        case BACNET_APPLICATION_TAG_OCTET_STRING:
+            break;
+        case BACNET_APPLICATION_TAG_CHARACTER_STRING:
+            if (content_len) {
+                value->type.Encoding = content[0];
+                value->data = &content[1];
+                value->data_len = content_len - 1;
+            }
+            break;
+        case BACNET_APPLICATION_TAG_BIT_STRING:
+            if (content_len) {
+                value->type.Unused_Bits = content[0];
+                value->data = &content[1];
+                value->data_len = content_len - 1;
+            }
+            break;
+        case BACNET_APPLICATION_TAG_ENUMERATED:
+            decode_enumerated(content, content_len, &value->type.Enumerated);
+            break;
+        case BACNET_APPLICATION_TAG_DATE:
+            decode_date_safe(content, content_len, &value->type.Date);
+            break;
+        case BACNET_APPLICATION_TAG_TIME:
+            decode_bacnet_time_safe(content, content_len, &value->type.Time);
+            break;
+        case BACNET_APPLICATION_TAG_OBJECT_ID:
+            decode_object_id_safe(content, content_len, &object_type,
+                &value->type.Object_Id.instance);
+            value->type.Object_Id.type = object_type;
+            break;
+        default:
+            /* unknown context data, or a tag we do not decode:
+               data and data_len describe the raw contents */
+            value->tag = MAX_BACNET_APPLICATION_TAG;
+            break;
+    }
+    len = tag_len + content_len;
+    value->apdu_len = len;
+
+    return len;
+}
+
+/* Copy a view into a full value, decoding the strings into the value.
+   Returns false for constructed data and unknown context values,
+   which have no representation in BACNET_APPLICATION_DATA_VALUE. */
+bool bacapp_view_to_value(
+    BACNET_APPLICATION_DATA_VIEW * view,
+    BACNET_PROPERTY_ID property,
+    BACNET_APPLICATION_DATA_VALUE * value)
+{
+    int len = 0;
+
+    if (!view || !value || !view->apdu || (view->apdu_len == 0) ||
+        (view->tag >= MAX_BACNET_APPLICATION_TAG)) {
+        return false;
+    }
+    if (view->context_specific) {
+        len =
+            bacapp_decode_context_data(view->apdu, view->apdu_len, value,
+            property);
+    } else {
+        len =
+            bacapp_decode_application_data(view->apdu, view->apdu_len,
+            value);
+    }
+
+    return ((len > 0) && (value->tag < MAX_BACNET_APPLICATION_TAG));
+}
+
 int bacapp_encode_data(
     uint8_t * apdu,
     BACNET_APPLICATION_DATA_VALUE * value)
@@ -2028,6 +2195,10 @@ static bool testBACnetApplicationDataValue(
     BACNET_APPLICATION_DATA_VALUE test_value;
 
     apdu_len = bacapp_encode_application_data(&apdu[0], value);
+    /* sizing without a buffer agrees with the encoding */
+    if (bacapp_encode_application_data(NULL, value) != apdu_len) {
+        return false;
+    }
     bacapp_decode_application_data(&apdu[0], apdu_len, &test_value);
 
     return bacapp_same_value(value, &test_value);
@@ -2268,6 +2439,108 @@ void testBACnetApplicationData(
     return;
 }
 
+void testBACnetApplicationDataView(
+    Test * pTest)
+{
+    uint8_t apdu[MAX_APDU] = { 0 };
+    BACNET_APPLICATION_DATA_VIEW view = { 0 };
+    BACNET_APPLICATION_DATA_VALUE value = { 0 };
+    BACNET_APPLICATION_DATA_VALUE test_value = { 0 };
+    BACNET_CHARACTER_STRING char_string;
+    int apdu_len = 0;
+    int len = 0;
+    int offset = 0;
+    int constructed_len = 0;
+    unsigned count = 0;
+
+    /* a mix of application tagged values */
+    apdu_len += encode_application_null(&apdu[apdu_len]);
+    apdu_len += encode_application_boolean(&apdu[apdu_len], true);
+    apdu_len += encode_application_unsigned(&apdu[apdu_len], 0x12345678);
+    apdu_len += encode_application_signed(&apdu[apdu_len], -1234);
+    apdu_len += encode_application_real(&apdu[apdu_len], 3.25);
+    apdu_len += encode_application_enumerated(&apdu[apdu_len], 42);
+    characterstring_init_ansi(&char_string, "Hello World");
+    apdu_len +=
+        encode_application_character_string(&apdu[apdu_len], &char_string);
+    apdu_len += encode_application_object_id(&apdu[apdu_len], 8, 1234);
+    while (offset < apdu_len) {
+        len =
+            bacapp_decode_data_view(&apdu[offset], apdu_len - offset,
+            PROP_PRESENT_VALUE, &view);
+        ct_test(pTest, len > 0);
+        if (len <= 0) {
+            break;
+        }
+        ct_test(pTest, view.apdu == &apdu[offset]);
+        ct_test(pTest, view.apdu_len == (uint32_t) len);
+        ct_test(pTest, !view.context_specific);
+        /* the view agrees with the copying decoder */
+        ct_test(pTest, bacapp_view_to_value(&view, PROP_PRESENT_VALUE,
+                &value));
+        bacapp_decode_application_data(&apdu[offset], apdu_len - offset,
+            &test_value);
+        ct_test(pTest, bacapp_same_value(&value, &test_value));
+        ct_test(pTest, view.tag == test_value.tag);
+        if (view.tag == BACNET_APPLICATION_TAG_CHARACTER_STRING) {
+            /* the string is referenced, not copied */
+            ct_test(pTest, view.data_len == 11);
+            ct_test(pTest, view.data > view.apdu);
+            ct_test(pTest, memcmp(view.data, "Hello World", 11) == 0);
+            ct_test(pTest, view.type.Encoding == CHARACTER_ANSI_X34);
+        } else if (view.tag == BACNET_APPLICATION_TAG_UNSIGNED_INT) {
+            ct_test(pTest, view.type.Unsigned_Int == 0x12345678);
+        } else if (view.tag == BACNET_APPLICATION_TAG_SIGNED_INT) {
+            ct_test(pTest, view.type.Signed_Int == -1234);
+        } else if (view.tag == BACNET_APPLICATION_TAG_OBJECT_ID) {
+            ct_test(pTest, view.type.Object_Id.type == 8);
+            ct_test(pTest, view.type.Object_Id.instance == 1234);
+        }
+        offset += len;
+        count++;
+    }
+    ct_test(pTest, count == 8);
+    ct_test(pTest, offset == apdu_len);
+
+    /* constructed data is spanned as raw octets */
+    apdu_len = 0;
+    apdu_len += encode_opening_tag(&apdu[apdu_len], 3);
+    apdu_len += encode_context_unsigned(&apdu[apdu_len], 0, 5);
+    apdu_len += encode_opening_tag(&apdu[apdu_len], 3);
+    apdu_len += encode_context_unsigned(&apdu[apdu_len], 1, 6);
+    apdu_len += encode_closing_tag(&apdu[apdu_len], 3);
+    constructed_len = apdu_len - 1;
+    apdu_len += encode_closing_tag(&apdu[apdu_len], 3);
+    len =
+        bacapp_decode_data_view(&apdu[0], apdu_len, PROP_PRESENT_VALUE,
+        &view);
+    ct_test(pTest, len == apdu_len);
+    ct_test(pTest, view.context_specific);
+    ct_test(pTest, view.context_tag == 3);
+    ct_test(pTest, view.tag == MAX_BACNET_APPLICATION_TAG);
+    ct_test(pTest, view.data == &apdu[1]);
+    ct_test(pTest, view.data_len == (uint32_t) constructed_len);
+    ct_test(pTest, !bacapp_view_to_value(&view, PROP_PRESENT_VALUE, &value));
+    /* a closing tag ends the list */
+    len =
+        bacapp_decode_data_view(&apdu[apdu_len - 1], 1, PROP_PRESENT_VALUE,
+        &view);
+    ct_test(pTest, len == 0);
+
+    /* values that do not fit are rejected */
+    apdu_len =
+        encode_application_character_string(&apdu[0], &char_string);
+    len =
+        bacapp_decode_data_view(&apdu[0], apdu_len - 1, PROP_PRESENT_VALUE,
+        &view);
+    ct_test(pTest, len == BACNET_STATUS_ERROR);
+    len =
+        bacapp_decode_data_view(&apdu[0], 0, PROP_PRESENT_VALUE, &view);
+    ct_test(pTest, len == BACNET_STATUS_ERROR);
+
+    return;
+}
+
 
 #ifdef TEST_BACNET_APPLICATION_DATA
 int main(
@@ -2284,6 +2557,8 @@ int main(
     assert(rc);
     rc = ct_addTestFunction(pTest, testBACnetApplicationData_Safe);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testBACnetApplicationDataView);
+    assert(rc);
 
     ct_setStream(pTest, stdout);
     ct_run(pTest);
@@ -210,7 +210,9 @@ int decode_max_apdu(
 }
 
 /* from clause 20.2.1 General Rules for Encoding BACnet Tags */
-/* returns the number of apdu bytes consumed */
+/* returns the number of apdu bytes consumed.
+   Like all of the encode functions in this module, a NULL apdu
+   only computes the number of bytes that would be encoded. */
 int encode_tag(
     uint8_t * apdu,
     uint8_t tag_number,
@@ -218,37 +220,51 @@ int encode_tag(
     uint32_t len_value_type)
 {
     int len = 1;        /* return value */
+    uint8_t octet = 0;
 
-    apdu[0] = 0;
     if (context_specific)
-        apdu[0] = BIT3;
+        octet = BIT3;
 
     /* additional tag byte after this byte */
     /* for extended tag byte */
     if (tag_number <= 14) {
-        apdu[0] |= (tag_number << 4);
+        octet |= (tag_number << 4);
     } else {
-        apdu[0] |= 0xF0;
-        apdu[1] = tag_number;
+        octet |= 0xF0;
+        if (apdu) {
+            apdu[1] = tag_number;
+        }
         len++;
     }
 
     /* NOTE: additional len byte(s) after extended tag byte */
     /* if larger than 4 */
     if (len_value_type <= 4) {
-        apdu[0] |= len_value_type;
+        octet |= len_value_type;
     } else {
-        apdu[0] |= 5;
+        octet |= 5;
         if (len_value_type <= 253) {
-            apdu[len++] = (uint8_t) len_value_type;
+            if (apdu) {
+                apdu[len] = (uint8_t) len_value_type;
+            }
+            len++;
         } else if (len_value_type <= 65535) {
-            apdu[len++] = 254;
-            len += encode_unsigned16(&apdu[len], (uint16_t) len_value_type);
+            if (apdu) {
+                apdu[len] = 254;
+                encode_unsigned16(&apdu[len + 1], (uint16_t) len_value_type);
+            }
+            len += 3;
         } else {
-            apdu[len++] = 255;
-            len += encode_unsigned32(&apdu[len], len_value_type);
+            if (apdu) {
+                apdu[len] = 255;
+                encode_unsigned32(&apdu[len + 1], len_value_type);
+            }
+            len += 5;
         }
     }
+    if (apdu) {
+        apdu[0] = octet;
+    }
 
     return len;
 }
@@ -260,19 +276,25 @@ int encode_opening_tag(
     uint8_t tag_number)
 {
     int len = 1;
+    uint8_t octet;
 
     /* set class field to context specific */
-    apdu[0] = BIT3;
+    octet = BIT3;
     /* additional tag byte after this byte for extended tag byte */
     if (tag_number <= 14) {
-        apdu[0] |= (tag_number << 4);
+        octet |= (tag_number << 4);
     } else {
-        apdu[0] |= 0xF0;
-        apdu[1] = tag_number;
+        octet |= 0xF0;
+        if (apdu) {
+            apdu[1] = tag_number;
+        }
         len++;
     }
     /* set type field to opening tag */
-    apdu[0] |= 6;
+    octet |= 6;
+    if (apdu) {
+        apdu[0] = octet;
+    }
 
     return len;
 }
@@ -284,25 +306,139 @@ int encode_closing_tag(
     uint8_t tag_number)
 {
     int len = 1;
+    uint8_t octet;
 
     /* set class field to context specific */
-    apdu[0] = BIT3;
+    octet = BIT3;
     /* additional tag byte after this byte for extended tag byte */
     if (tag_number <= 14) {
-        apdu[0] |= (tag_number << 4);
+        octet |= (tag_number << 4);
     } else {
-        apdu[0] |= 0xF0;
-        apdu[1] = tag_number;
+        octet |= 0xF0;
+        if (apdu) {
+            apdu[1] = tag_number;
+        }
         len++;
     }
     /* set type field to closing tag */
-    apdu[0] |= 7;
+    octet |= 7;
+    if (apdu) {
+        apdu[0] = octet;
+    }
 
     return len;
 }
 
 
 
+/* What the initial octet of a tag says about the rest of the tag,
+   from clause 20.2.1, so that a tag is decoded with one table lookup
+   instead of a chain of tests on the octet. */
+#define TAG_HEADER_CONTEXT      0x01
+#define TAG_HEADER_EXT_NUMBER   0x02
+#define TAG_HEADER_EXT_LENGTH   0x04
+#define TAG_HEADER_OPENING      0x08
+#define TAG_HEADER_CLOSING      0x10
+#define TAG_HEADER_SMALL_LENGTH 0x20
+
+#define TAG_HEADER_FLAGS(x) \
+    (uint8_t) ((((x) & 0x08) ? TAG_HEADER_CONTEXT : 0) | \
+    ((((x) & 0xF0) == 0xF0) ? TAG_HEADER_EXT_NUMBER : 0) | \
+    ((((x) & 0x07) == 5) ? TAG_HEADER_EXT_LENGTH : 0) | \
+    ((((x) & 0x07) == 6) ? TAG_HEADER_OPENING : 0) | \
+    ((((x) & 0x07) == 7) ? TAG_HEADER_CLOSING : 0) | \
+    ((((x) & 0x07) < 5) ? TAG_HEADER_SMALL_LENGTH : 0))
+#define TAG_HEADER_FLAGS4(x) \
+    TAG_HEADER_FLAGS(x), TAG_HEADER_FLAGS((x) + 1), \
+    TAG_HEADER_FLAGS((x) + 2), TAG_HEADER_FLAGS((x) + 3)
+#define TAG_HEADER_FLAGS16(x) \
+    TAG_HEADER_FLAGS4(x), TAG_HEADER_FLAGS4((x) + 4), \
+    TAG_HEADER_FLAGS4((x) + 8), TAG_HEADER_FLAGS4((x) + 12)
+#define TAG_HEADER_FLAGS64(x) \
+    TAG_HEADER_FLAGS16(x), TAG_HEADER_FLAGS16((x) + 16), \
+    TAG_HEADER_FLAGS16((x) + 32), TAG_HEADER_FLAGS16((x) + 48)
+
+static const uint8_t Tag_Header_Flags[256] = {
+    TAG_HEADER_FLAGS64(0), TAG_HEADER_FLAGS64(64),
+    TAG_HEADER_FLAGS64(128), TAG_HEADER_FLAGS64(192)
+};
+
+/* Decode a tag header.  If apdu_len_remaining is 0 no bounds are checked,
+   as in the original decode_tag_number_and_value().
+   Returns the length of the header, or 0 if it is truncated. */
+static int tag_header_decode(
+    uint8_t * apdu,
+    uint32_t apdu_len_remaining,
+    BACNET_TAG_HEADER * tag)
+{
+    uint8_t flags = Tag_Header_Flags[apdu[0]];
+    uint32_t len = 1;
+    uint32_t need = 1;
+
+    if (flags & TAG_HEADER_EXT_NUMBER) {
+        need++;
+    }
+    if (flags & TAG_HEADER_EXT_LENGTH) {
+        need++;
+    }
+    if (apdu_len_remaining && (need > apdu_len_remaining)) {
+        return 0;
+    }
+    if (flags & TAG_HEADER_EXT_NUMBER) {
+        tag->number = apdu[len++];
+    } else {
+        tag->number = (uint8_t) (apdu[0] >> 4);
+    }
+    tag->context = (flags & TAG_HEADER_CONTEXT) ? true : false;
+    tag->opening = (flags & TAG_HEADER_OPENING) ? true : false;
+    tag->closing = (flags & TAG_HEADER_CLOSING) ? true : false;
+    if (flags & TAG_HEADER_SMALL_LENGTH) {
+        tag->len_value_type = apdu[0] & 0x07;
+    } else if (flags & TAG_HEADER_EXT_LENGTH) {
+        if (apdu[len] == 255) {
+            /* tagged as uint32_t */
+            if (apdu_len_remaining && ((len + 5) > apdu_len_remaining)) {
+                return 0;
+            }
+            len++;
+            len += decode_unsigned32(&apdu[len], &tag->len_value_type);
+        } else if (apdu[len] == 254) {
+            /* tagged as uint16_t */
+            uint16_t value16 = 0;
+            if (apdu_len_remaining && ((len + 3) > apdu_len_remaining)) {
+                return 0;
+            }
+            len++;
+            len += decode_unsigned16(&apdu[len], &value16);
+            tag->len_value_type = value16;
+        } else {
+            /* no tag - must be uint8_t */
+            tag->len_value_type = apdu[len];
+            len++;
+        }
+    } else {
+        /* opening or closing tag */
+        tag->len_value_type = 0;
+    }
+
+    return (int) len;
+}
+
+/* Decode a complete tag header in one pass, checking that it
+   fits in apdu_len_remaining.
+   Returns the length of the header, or 0 if it is truncated. */
+int decode_tag_header(
+    uint8_t * apdu,
+    uint32_t apdu_len_remaining,
+    BACNET_TAG_HEADER * tag)
+{
+    if (!apdu || !tag || (apdu_len_remaining == 0)) {
+        return 0;
+    }
+
+    return tag_header_decode(apdu, apdu_len_remaining, tag);
+}
+
 int decode_tag_number(
     uint8_t * apdu,
     uint8_t * tag_number)
@@ -310,7 +446,7 @@ int decode_tag_number(
     int len = 1;        /* return value */
 
     /* decode the tag number first */
-    if (IS_EXTENDED_TAG_NUMBER(apdu[0])) {
+    if (Tag_Header_Flags[apdu[0]] & TAG_HEADER_EXT_NUMBER) {
         /* extended tag */
         if (tag_number) {
             *tag_number = apdu[1];
@@ -335,7 +471,8 @@ int decode_tag_number_safe(
 
     /* decode the tag number first */
     if (apdu_len_remaining >= 1) {
-        if (IS_EXTENDED_TAG_NUMBER(apdu[0]) && apdu_len_remaining >= 2) {
+        if ((Tag_Header_Flags[apdu[0]] & TAG_HEADER_EXT_NUMBER) &&
+            apdu_len_remaining >= 2) {
             /* extended tag */
             if (tag_number) {
                 *tag_number = apdu[1];
@@ -354,7 +491,7 @@ int decode_tag_number_safe(
 bool decode_is_opening_tag(
     uint8_t * apdu)
 {
-    return (bool) ((apdu[0] & 0x07) == 6);
+    return (bool) ((Tag_Header_Flags[apdu[0]] & TAG_HEADER_OPENING) != 0);
 }
 
 /* from clause 20.2.1.3.2 Constructed Data */
@@ -362,7 +499,7 @@ bool decode_is_opening_tag(
 bool decode_is_closing_tag(
     uint8_t * apdu)
 {
-    return (bool) ((apdu[0] & 0x07) == 7);
+    return (bool) ((Tag_Header_Flags[apdu[0]] & TAG_HEADER_CLOSING) != 0);
 }
 
 /* from clause 20.2.1.3.2 Constructed Data */
@@ -372,43 +509,15 @@ int decode_tag_number_and_value(
     uint8_t * tag_number,
     uint32_t * value)
 {
-    int len = 1;
-    uint16_t value16;
-    uint32_t value32;
+    BACNET_TAG_HEADER tag;
+    int len = 0;
 
-    len = decode_tag_number(&apdu[0], tag_number);
-    if (IS_EXTENDED_VALUE(apdu[0])) {
-        /* tagged as uint32_t */
-        if (apdu[len] == 255) {
-            len++;
-            len += decode_unsigned32(&apdu[len], &value32);
-            if (value) {
-                *value = value32;
-            }
-        }
-        /* tagged as uint16_t */
-        else if (apdu[len] == 254) {
-            len++;
-            len += decode_unsigned16(&apdu[len], &value16);
-            if (value) {
-                *value = value16;
-            }
-        }
-        /* no tag - must be uint8_t */
-        else {
-            if (value) {
-                *value = apdu[len];
-            }
-            len++;
-        }
-    } else if (IS_OPENING_TAG(apdu[0]) && value) {
-        *value = 0;
-    } else if (IS_CLOSING_TAG(apdu[0]) && value) {
-        /* closing tag */
-        *value = 0;
-    } else if (value) {
-        /* small value */
-        *value = apdu[0] & 0x07;
+    len = tag_header_decode(apdu, 0, &tag);
+    if (tag_number) {
+        *tag_number = tag.number;
+    }
+    if (value) {
+        *value = tag.len_value_type;
     }
 
     return len;
@@ -421,51 +530,19 @@ int decode_tag_number_and_value_safe(
     uint8_t * tag_number,
     uint32_t * value)
 {
+    BACNET_TAG_HEADER tag;
     int len = 0;
 
-    len = decode_tag_number_safe(&apdu[0], apdu_len_remaining, tag_number);
-
+    len = decode_tag_header(apdu, apdu_len_remaining, &tag);
     if (len > 0) {
-        apdu_len_remaining -= len;
-        if (IS_EXTENDED_VALUE(apdu[0])) {
-            /* tagged as uint32_t */
-            if (apdu[len] == 255 && apdu_len_remaining >= 5) {
-                uint32_t value32;
-                len++;
-                len += decode_unsigned32(&apdu[len], &value32);
-                if (value) {
-                    *value = value32;
-                }
-            }
-            /* tagged as uint16_t */
-            else if (apdu[len] == 254 && apdu_len_remaining >= 3) {
-                uint16_t value16;
-                len++;
-                len += decode_unsigned16(&apdu[len], &value16);
-                if (value) {
-                    *value = value16;
-                }
-            }
-            /* no tag - must be uint8_t */
-            else if (apdu[len] < 254 && apdu_len_remaining >= 1) {
-                if (value) {
-                    *value = apdu[len];
-                }
-                len++;
-            } else {
-                /* packet is truncated */
-                len = 0;
-            }
-        } else if (IS_OPENING_TAG(apdu[0]) && value) {
-            *value = 0;
-        } else if (IS_CLOSING_TAG(apdu[0]) && value) {
-            /* closing tag */
-            *value = 0;
-        } else if (value) {
-            /* small value */
-            *value = apdu[0] & 0x07;
+        if (tag_number) {
+            *tag_number = tag.number;
+        }
+        if (value) {
+            *value = tag.len_value_type;
         }
     }
+
     return len;
 }
 
@@ -477,9 +554,11 @@ bool decode_is_context_tag(
 {
     uint8_t my_tag_number = 0;
 
+    if (!(Tag_Header_Flags[apdu[0]] & TAG_HEADER_CONTEXT)) {
+        return false;
+    }
     decode_tag_number(apdu, &my_tag_number);
-    return (bool) (IS_CONTEXT_SPECIFIC(*apdu) &&
-        (my_tag_number == tag_number));
+    return (bool) (my_tag_number == tag_number);
 }
 
 bool decode_is_context_tag_with_length(
@@ -491,10 +570,108 @@ bool decode_is_context_tag_with_length(
 
     *tag_length = decode_tag_number(apdu, &my_tag_number);
 
-    return (bool) (IS_CONTEXT_SPECIFIC(*apdu) &&
+    return (bool) ((Tag_Header_Flags[apdu[0]] & TAG_HEADER_CONTEXT) &&
         (my_tag_number == tag_number));
 }
 
+/* Decode the header of a primitive context tag that is expected to be
+   tag_number, and check that its contents fit.
+   Returns the header length, 0 if the next tag is something else,
+   or BACNET_STATUS_ERROR if the tag is truncated or too long. */
+static int context_tag_expect(
+    uint8_t * apdu,
+    uint32_t apdu_len_remaining,
+    uint8_t tag_number,
+    uint32_t max_len_value,
+    uint32_t * len_value)
+{
+    BACNET_TAG_HEADER tag;
+    int len = 0;
+
+    len = decode_tag_header(apdu, apdu_len_remaining, &tag);
+    if (len <= 0) {
+        return BACNET_STATUS_ERROR;
+    }
+    if (!tag.context || tag.opening || tag.closing ||
+        (tag.number != tag_number)) {
+        return 0;
+    }
+    if ((tag.len_value_type > max_len_value) ||
+        (tag.len_value_type > (apdu_len_remaining - len))) {
+        return BACNET_STATUS_ERROR;
+    }
+    *len_value = tag.len_value_type;
+
+    return len;
+}
+
+/* Expect context tag tag_number and decode its Unsigned contents.
+   Returns the number of octets consumed, 0 if the next tag is not
+   tag_number (so optional parameters can be probed), or
+   BACNET_STATUS_ERROR if it is truncated or malformed. */
+int decode_context_unsigned_safe(
+    uint8_t * apdu,
+    uint32_t apdu_len_remaining,
+    uint8_t tag_number,
+    uint32_t * value)
+{
+    uint32_t len_value = 0;
+    int len = 0;
+
+    len =
+        context_tag_expect(apdu, apdu_len_remaining, tag_number, 4,
+        &len_value);
+    if (len > 0) {
+        len += decode_unsigned(&apdu[len], len_value, value);
+    }
+
+    return len;
+}
+
+/* Same as above for an Enumerated value. */
+int decode_context_enumerated_safe(
+    uint8_t * apdu,
+    uint32_t apdu_len_remaining,
+    uint8_t tag_number,
+    uint32_t * value)
+{
+    uint32_t len_value = 0;
+    int len = 0;
+
+    len =
+        context_tag_expect(apdu, apdu_len_remaining, tag_number, 4,
+        &len_value);
+    if (len > 0) {
+        len += decode_enumerated(&apdu[len], len_value, value);
+    }
+
+    return len;
+}
+
+/* Same as above for a BACnetObjectIdentifier. */
+int decode_context_object_id_safe(
+    uint8_t * apdu,
+    uint32_t apdu_len_remaining,
+    uint8_t tag_number,
+    uint16_t * object_type,
+    uint32_t * instance)
+{
+    uint32_t len_value = 0;
+    int len = 0;
+
+    len =
+        context_tag_expect(apdu, apdu_len_remaining, tag_number, 4,
+        &len_value);
+    if (len > 0) {
+        if (len_value != 4) {
+            return BACNET_STATUS_ERROR;
+        }
+        len += decode_object_id(&apdu[len], object_type, instance);
+    }
+
+    return len;
+}
+
 /* from clause 20.2.1.3.2 Constructed Data */
 /* returns the true if the tag matches */
 bool decode_is_opening_tag_number(
@@ -503,8 +680,11 @@ bool decode_is_opening_tag_number(
 {
     uint8_t my_tag_number = 0;
 
+    if (!(Tag_Header_Flags[apdu[0]] & TAG_HEADER_OPENING)) {
+        return false;
+    }
     decode_tag_number(apdu, &my_tag_number);
-    return (bool) (IS_OPENING_TAG(apdu[0]) && (my_tag_number == tag_number));
+    return (bool) (my_tag_number == tag_number);
 }
 
 /* from clause 20.2.1.3.2 Constructed Data */
@@ -515,8 +695,11 @@ bool decode_is_closing_tag_number(
 {
     uint8_t my_tag_number = 0;
 
+    if (!(Tag_Header_Flags[apdu[0]] & TAG_HEADER_CLOSING)) {
+        return false;
+    }
     decode_tag_number(apdu, &my_tag_number);
-    return (bool) (IS_CLOSING_TAG(apdu[0]) && (my_tag_number == tag_number));
+    return (bool) (my_tag_number == tag_number);
 }
 
 /* from clause 20.2.3 Encoding of a Boolean Value */
@@ -533,7 +716,7 @@ int encode_application_boolean(
         len_value = 1;
     }
     len =
-        encode_tag(&apdu[0], BACNET_APPLICATION_TAG_BOOLEAN, false, len_value);
+        encode_tag(apdu, BACNET_APPLICATION_TAG_BOOLEAN, false, len_value);
 
     return len;
 }
@@ -546,8 +729,10 @@ int encode_context_boolean(
 {
     int len = 0;        /* return value */
 
-    len = encode_tag(&apdu[0], (uint8_t) tag_number, true, 1);
-    apdu[len] = (bool) (boolean_value ? 1 : 0);
+    len = encode_tag(apdu, (uint8_t) tag_number, true, 1);
+    if (apdu) {
+        apdu[len] = (bool) (boolean_value ? 1 : 0);
+    }
     len++;
 
     return len;
@@ -605,14 +790,14 @@ bool decode_boolean(
 int encode_application_null(
     uint8_t * apdu)
 {
-    return encode_tag(&apdu[0], BACNET_APPLICATION_TAG_NULL, false, 0);
+    return encode_tag(apdu, BACNET_APPLICATION_TAG_NULL, false, 0);
 }
 
 int encode_context_null(
     uint8_t * apdu,
     uint8_t tag_number)
 {
-    return encode_tag(&apdu[0], tag_number, true, 0);
+    return encode_tag(apdu, tag_number, true, 0);
 }
 
 static uint8_t byte_reverse_bits(
@@ -713,9 +898,15 @@ int encode_bitstring(
 
     /* if the bit string is empty, then the first octet shall be zero */
     if (bitstring_bits_used(bit_string) == 0) {
-        apdu[len++] = 0;
+        if (apdu) {
+            apdu[len] = 0;
+        }
+        len++;
     } else {
         used_bytes = bitstring_bytes_used(bit_string);
+        if (!apdu) {
+            return 1 + used_bytes;
+        }
         remaining_used_bits =
             (uint8_t) (bitstring_bits_used(bit_string) - ((used_bytes -
                     1) * 8));
@@ -739,9 +930,9 @@ int encode_application_bitstring(
     /* bit string may use more than 1 octet for the tag, so find out how many */
     bit_string_encoded_length += bitstring_bytes_used(bit_string);
     len =
-        encode_tag(&apdu[0], BACNET_APPLICATION_TAG_BIT_STRING, false,
+        encode_tag(apdu, BACNET_APPLICATION_TAG_BIT_STRING, false,
         bit_string_encoded_length);
-    len += encode_bitstring(&apdu[len], bit_string);
+    len += encode_bitstring(apdu ? &apdu[len] : NULL, bit_string);
 
     return len;
 }
@@ -756,8 +947,8 @@ int encode_context_bitstring(
 
     /* bit string may use more than 1 octet for the tag, so find out how many */
     bit_string_encoded_length += bitstring_bytes_used(bit_string);
-    len = encode_tag(&apdu[0], tag_number, true, bit_string_encoded_length);
-    len += encode_bitstring(&apdu[len], bit_string);
+    len = encode_tag(apdu, tag_number, true, bit_string_encoded_length);
+    len += encode_bitstring(apdu ? &apdu[len] : NULL, bit_string);
 
     return len;
 }
@@ -843,8 +1034,10 @@ int encode_context_object_id(
 
     /* length of object id is 4 octets, as per 20.2.14 */
 
-    len = encode_tag(&apdu[0], tag_number, true, 4);
-    len += encode_bacnet_object_id(&apdu[len], object_type, instance);
+    len = encode_tag(apdu, tag_number, true, 4);
+    len +=
+        encode_bacnet_object_id(apdu ? &apdu[len] : NULL, object_type,
+        instance);
 
     return len;
 }
@@ -860,9 +1053,11 @@ int encode_application_object_id(
     int len = 0;
 
     /* assumes that the tag only consumes 1 octet */
-    len = encode_bacnet_object_id(&apdu[1], object_type, instance);
+    len =
+        encode_bacnet_object_id(apdu ? &apdu[1] : NULL, object_type,
+        instance);
     len +=
-        encode_tag(&apdu[0], BACNET_APPLICATION_TAG_OBJECT_ID, false,
+        encode_tag(apdu, BACNET_APPLICATION_TAG_OBJECT_ID, false,
         (uint32_t) len);
 
     return len;
@@ -885,7 +1080,7 @@ int encode_octet_string(
            to bounds check since it might not be the only data chunk */
         len = (int) octetstring_length(octet_string);
         value = octetstring_value(octet_string);
-        if (value) {
+        if (apdu && value) {
             for (i = 0; i < len; i++) {
                 apdu[i] = value[i];
             }
@@ -906,12 +1101,14 @@ int encode_application_octet_string(
 
     if (octet_string) {
         apdu_len =
-            encode_tag(&apdu[0], BACNET_APPLICATION_TAG_OCTET_STRING, false,
+            encode_tag(apdu, BACNET_APPLICATION_TAG_OCTET_STRING, false,
             octetstring_length(octet_string));
         /* FIXME: probably need to pass in the length of the APDU
            to bounds check since it might not be the only data chunk */
         if ((apdu_len + octetstring_length(octet_string)) < MAX_APDU) {
-            apdu_len += encode_octet_string(&apdu[apdu_len], octet_string);
+            apdu_len +=
+                encode_octet_string(apdu ? &apdu[apdu_len] : NULL,
+                octet_string);
         } else {
             apdu_len = 0;
         }
@@ -930,12 +1127,14 @@ int encode_context_octet_string(
 {
     int apdu_len = 0;
 
-    if (apdu && octet_string) {
+    if (octet_string) {
         apdu_len =
-            encode_tag(&apdu[0], tag_number, true,
+            encode_tag(apdu, tag_number, true,
             octetstring_length(octet_string));
         if ((apdu_len + octetstring_length(octet_string)) < MAX_APDU) {
-            apdu_len += encode_octet_string(&apdu[apdu_len], octet_string);
+            apdu_len +=
+                encode_octet_string(apdu ? &apdu[apdu_len] : NULL,
+                octet_string);
         } else {
             apdu_len = 0;
         }
@@ -1003,13 +1202,13 @@ uint32_t encode_bacnet_character_string_safe(
     uint32_t i;
 
     apdu_len += length;
-    if (apdu && (apdu_len <= max_apdu)) {
+    if (apdu_len > max_apdu) {
+        apdu_len = 0;
+    } else if (apdu) {
         apdu[0] = encoding;
         for (i = 0; i < length; i++) {
             apdu[1 + i] = (uint8_t) pString[i];
         }
-    } else {
-        apdu_len = 0;
     }
 
     return apdu_len;
@@ -1038,10 +1237,12 @@ int encode_application_character_string(
     string_len =
         (int) characterstring_length(char_string) + 1 /* for encoding */ ;
     len =
-        encode_tag(&apdu[0], BACNET_APPLICATION_TAG_CHARACTER_STRING, false,
+        encode_tag(apdu, BACNET_APPLICATION_TAG_CHARACTER_STRING, false,
         (uint32_t) string_len);
     if ((len + string_len) < MAX_APDU) {
-        len += encode_bacnet_character_string(&apdu[len], char_string);
+        len +=
+            encode_bacnet_character_string(apdu ? &apdu[len] : NULL,
+            char_string);
     } else {
         len = 0;
     }
@@ -1059,9 +1260,11 @@ int encode_context_character_string(
 
     string_len =
         (int) characterstring_length(char_string) + 1 /* for encoding */ ;
-    len += encode_tag(&apdu[0], tag_number, true, (uint32_t) string_len);
+    len += encode_tag(apdu, tag_number, true, (uint32_t) string_len);
     if ((len + string_len) < MAX_APDU) {
-        len += encode_bacnet_character_string(&apdu[len], char_string);
+        len +=
+            encode_bacnet_character_string(apdu ? &apdu[len] : NULL,
+            char_string);
     } else {
         len = 0;
     }
@@ -1156,14 +1359,12 @@ int decode_context_unsigned(
     uint8_t tag_number,
     uint32_t * value)
 {
-    uint32_t len_value;
+    BACNET_TAG_HEADER tag;
     int len = 0;
 
-    if (decode_is_context_tag(&apdu[len], tag_number) &&
-        !decode_is_closing_tag(&apdu[len])) {
-        len +=
-            decode_tag_number_and_value(&apdu[len], &tag_number, &len_value);
-        len += decode_unsigned(&apdu[len], len_value, value);
+    len = tag_header_decode(&apdu[0], 0, &tag);
+    if (tag.context && !tag.closing && (tag.number == tag_number)) {
+        len += decode_unsigned(&apdu[len], tag.len_value_type, value);
     } else {
         len = BACNET_STATUS_ERROR;
     }
@@ -1181,14 +1382,16 @@ int encode_bacnet_unsigned(
     int len = 0;        /* return value */
 
     if (value < 0x100) {
-        apdu[0] = (uint8_t) value;
+        if (apdu) {
+            apdu[0] = (uint8_t) value;
+        }
         len = 1;
     } else if (value < 0x10000) {
-        len = encode_unsigned16(&apdu[0], (uint16_t) value);
+        len = encode_unsigned16(apdu, (uint16_t) value);
     } else if (value < 0x1000000) {
-        len = encode_unsigned24(&apdu[0], value);
+        len = encode_unsigned24(apdu, value);
     } else {
-        len = encode_unsigned32(&apdu[0], value);
+        len = encode_unsigned32(apdu, value);
     }
 
     return len;
@@ -1215,8 +1418,8 @@ int encode_context_unsigned(
         len = 4;
     }
 
-    len = encode_tag(&apdu[0], tag_number, true, (uint32_t) len);
-    len += encode_bacnet_unsigned(&apdu[len], value);
+    len = encode_tag(apdu, tag_number, true, (uint32_t) len);
+    len += encode_bacnet_unsigned(apdu ? &apdu[len] : NULL, value);
 
     return len;
 }
@@ -1230,9 +1433,9 @@ int encode_application_unsigned(
 {
     int len = 0;
 
-    len = encode_bacnet_unsigned(&apdu[1], value);
+    len = encode_bacnet_unsigned(apdu ? &apdu[1] : NULL, value);
     len +=
-        encode_tag(&apdu[0], BACNET_APPLICATION_TAG_UNSIGNED_INT, false,
+        encode_tag(apdu, BACNET_APPLICATION_TAG_UNSIGNED_INT, false,
         (uint32_t) len);
 
     return len;
@@ -1262,15 +1465,12 @@ int decode_context_enumerated(
     uint8_t tag_value,
     uint32_t * value)
 {
+    BACNET_TAG_HEADER tag;
     int len = 0;
-    uint8_t tag_number;
-    uint32_t len_value;
 
-    if (decode_is_context_tag(&apdu[len], tag_value) &&
-        !decode_is_closing_tag(&apdu[len])) {
-        len +=
-            decode_tag_number_and_value(&apdu[len], &tag_number, &len_value);
-        len += decode_enumerated(&apdu[len], len_value, value);
+    len = tag_header_decode(&apdu[0], 0, &tag);
+    if (tag.context && !tag.closing && (tag.number == tag_value)) {
+        len += decode_enumerated(&apdu[len], tag.len_value_type, value);
     } else {
         len = BACNET_STATUS_ERROR;
     }
@@ -1297,9 +1497,9 @@ int encode_application_enumerated(
     int len = 0;        /* return value */
 
     /* assumes that the tag only consumes 1 octet */
-    len = encode_bacnet_enumerated(&apdu[1], value);
+    len = encode_bacnet_enumerated(apdu ? &apdu[1] : NULL, value);
     len +=
-        encode_tag(&apdu[0], BACNET_APPLICATION_TAG_ENUMERATED, false,
+        encode_tag(apdu, BACNET_APPLICATION_TAG_ENUMERATED, false,
         (uint32_t) len);
 
     return len;
@@ -1326,8 +1526,8 @@ int encode_context_enumerated(
         len = 4;
     }
 
-    len = encode_tag(&apdu[0], tag_number, true, (uint32_t) len);
-    len += encode_bacnet_enumerated(&apdu[len], value);
+    len = encode_tag(apdu, tag_number, true, (uint32_t) len);
+    len += encode_bacnet_enumerated(apdu ? &apdu[len] : NULL, value);
 
     return len;
 }
@@ -1398,13 +1598,13 @@ int encode_bacnet_signed(
        octet is 0, and the first octet shall not be X'FF' if the most
        significant bit of the second octet is 1. */
     if ((value >= -128) && (value < 128)) {
-        len = encode_signed8(&apdu[0], (int8_t) value);
+        len = encode_signed8(apdu, (int8_t) value);
     } else if ((value >= -32768) && (value < 32768)) {
-        len = encode_signed16(&apdu[0], (int16_t) value);
+        len = encode_signed16(apdu, (int16_t) value);
     } else if ((value > -8388608) && (value < 8388608)) {
-        len = encode_signed24(&apdu[0], value);
+        len = encode_signed24(apdu, value);
     } else {
-        len = encode_signed32(&apdu[0], value);
+        len = encode_signed32(apdu, value);
     }
 
     return len;
@@ -1420,9 +1620,9 @@ int encode_application_signed(
     int len = 0;        /* return value */
 
     /* assumes that the tag only consumes 1 octet */
-    len = encode_bacnet_signed(&apdu[1], value);
+    len = encode_bacnet_signed(apdu ? &apdu[1] : NULL, value);
     len +=
-        encode_tag(&apdu[0], BACNET_APPLICATION_TAG_SIGNED_INT, false,
+        encode_tag(apdu, BACNET_APPLICATION_TAG_SIGNED_INT, false,
         (uint32_t) len);
 
     return len;
@@ -1449,8 +1649,8 @@ int encode_context_signed(
         len = 4;
     }
 
-    len = encode_tag(&apdu[0], tag_number, true, (uint32_t) len);
-    len += encode_bacnet_signed(&apdu[len], value);
+    len = encode_tag(apdu, tag_number, true, (uint32_t) len);
+    len += encode_bacnet_signed(apdu ? &apdu[len] : NULL, value);
 
     return len;
 }
@@ -1466,9 +1666,9 @@ int encode_application_real(
     int len = 0;
 
     /* assumes that the tag only consumes 1 octet */
-    len = encode_bacnet_real(value, &apdu[1]);
+    len = encode_bacnet_real(value, apdu ? &apdu[1] : NULL);
     len +=
-        encode_tag(&apdu[0], BACNET_APPLICATION_TAG_REAL, false,
+        encode_tag(apdu, BACNET_APPLICATION_TAG_REAL, false,
         (uint32_t) len);
 
     return len;
@@ -1482,8 +1682,8 @@ int encode_context_real(
     int len = 0;
 
     /* length of double is 4 octets, as per 20.2.6 */
-    len = encode_tag(&apdu[0], tag_number, true, 4);
-    len += encode_bacnet_real(value, &apdu[len]);
+    len = encode_tag(apdu, tag_number, true, 4);
+    len += encode_bacnet_real(value, apdu ? &apdu[len] : NULL);
     return len;
 }
 
@@ -1498,10 +1698,10 @@ int encode_application_double(
     int len = 0;
 
     /* assumes that the tag only consumes 2 octet */
-    len = encode_bacnet_double(value, &apdu[2]);
+    len = encode_bacnet_double(value, apdu ? &apdu[2] : NULL);
 
     len +=
-        encode_tag(&apdu[0], BACNET_APPLICATION_TAG_DOUBLE, false,
+        encode_tag(apdu, BACNET_APPLICATION_TAG_DOUBLE, false,
         (uint32_t) len);
 
     return len;
@@ -1515,8 +1715,8 @@ int encode_context_double(
     int len = 0;
 
     /* length of double is 8 octets, as per 20.2.7 */
-    len = encode_tag(&apdu[0], tag_number, true, 8);
-    len += encode_bacnet_double(value, &apdu[len]);
+    len = encode_tag(apdu, tag_number, true, 8);
+    len += encode_bacnet_double(value, apdu ? &apdu[len] : NULL);
 
     return len;
 }
@@ -1529,10 +1729,12 @@ int encode_bacnet_time(
     uint8_t * apdu,
     BACNET_TIME * btime)
 {
-    apdu[0] = btime->hour;
-    apdu[1] = btime->min;
-    apdu[2] = btime->sec;
-    apdu[3] = btime->hundredths;
+    if (apdu) {
+        apdu[0] = btime->hour;
+        apdu[1] = btime->min;
+        apdu[2] = btime->sec;
+        apdu[3] = btime->hundredths;
+    }
 
     return 4;
 }
@@ -1547,9 +1749,9 @@ int encode_application_time(
     int len = 0;
 
     /* assumes that the tag only consumes 1 octet */
-    len = encode_bacnet_time(&apdu[1], btime);
+    len = encode_bacnet_time(apdu ? &apdu[1] : NULL, btime);
     len +=
-        encode_tag(&apdu[0], BACNET_APPLICATION_TAG_TIME, false,
+        encode_tag(apdu, BACNET_APPLICATION_TAG_TIME, false,
         (uint32_t) len);
 
     return len;
@@ -1563,8 +1765,8 @@ int encode_context_time(
     int len = 0;        /* return value */
 
     /* length of time is 4 octets, as per 20.2.13 */
-    len = encode_tag(&apdu[0], tag_number, true, 4);
-    len += encode_bacnet_time(&apdu[len], btime);
+    len = encode_tag(apdu, tag_number, true, 4);
+    len += encode_bacnet_time(apdu ? &apdu[len] : NULL, btime);
 
     return len;
 }
@@ -1649,21 +1851,26 @@ int encode_bacnet_date(
     uint8_t * apdu,
     BACNET_DATE * bdate)
 {
+    uint8_t year;
+
     if (bdate->year >= 1900) {
         /* normal encoding, including wildcard */
-        apdu[0] = (uint8_t) (bdate->year - 1900);
+        year = (uint8_t) (bdate->year - 1900);
     } else if (bdate->year < 0x100) {
         /* allow 2 digit years */
-        apdu[0] = (uint8_t) bdate->year;
+        year = (uint8_t) bdate->year;
     } else {
         /*
          ** Don't try and guess what the user meant here. Just fail
          */
         return BACNET_STATUS_ERROR;
     }
-    apdu[1] = bdate->month;
-    apdu[2] = bdate->day;
-    apdu[3] = bdate->wday;
+    if (apdu) {
+        apdu[0] = year;
+        apdu[1] = bdate->month;
+        apdu[2] = bdate->day;
+        apdu[3] = bdate->wday;
+    }
 
     return 4;
 }
@@ -1679,9 +1886,9 @@ int encode_application_date(
     int len = 0;
 
     /* assumes that the tag only consumes 1 octet */
-    len = encode_bacnet_date(&apdu[1], bdate);
+    len = encode_bacnet_date(apdu ? &apdu[1] : NULL, bdate);
     len +=
-        encode_tag(&apdu[0], BACNET_APPLICATION_TAG_DATE, false,
+        encode_tag(apdu, BACNET_APPLICATION_TAG_DATE, false,
         (uint32_t) len);
 
     return len;
@@ -1696,8 +1903,8 @@ int encode_context_date(
     int len = 0;        /* return value */
 
     /* length of date is 4 octets, as per 20.2.12 */
-    len = encode_tag(&apdu[0], tag_number, true, 4);
-    len += encode_bacnet_date(&apdu[len], bdate);
+    len = encode_tag(apdu, tag_number, true, 4);
+    len += encode_bacnet_date(apdu ? &apdu[len] : NULL, bdate);
 
     return len;
 }
@@ -1790,13 +1997,17 @@ int encode_bacnet_address(
     int apdu_len = 0;
     BACNET_OCTET_STRING mac_addr;
     /* network number */
-    apdu_len += encode_application_unsigned(&apdu[apdu_len], destination->net);
+    apdu_len +=
+        encode_application_unsigned(apdu ? &apdu[apdu_len] : NULL,
+        destination->net);
     /* encode mac address as an octet-string */
     if (destination->len != 0)
         octetstring_init(&mac_addr, destination->adr, destination->len);
     else
         octetstring_init(&mac_addr, destination->mac, destination->mac_len);
-    apdu_len += encode_application_octet_string(&apdu[apdu_len], &mac_addr);
+    apdu_len +=
+        encode_application_octet_string(apdu ? &apdu[apdu_len] : NULL,
+        &mac_addr);
     return apdu_len;
 }
 
@@ -1850,9 +2061,12 @@ int encode_context_bacnet_address(
     BACNET_ADDRESS * destination)
 {
     int apdu_len = 0;
-    apdu_len += encode_opening_tag(&apdu[apdu_len], tag_number);
-    apdu_len += encode_bacnet_address(&apdu[apdu_len], destination);
-    apdu_len += encode_closing_tag(&apdu[apdu_len], tag_number);
+    apdu_len +=
+        encode_opening_tag(apdu ? &apdu[apdu_len] : NULL, tag_number);
+    apdu_len +=
+        encode_bacnet_address(apdu ? &apdu[apdu_len] : NULL, destination);
+    apdu_len +=
+        encode_closing_tag(apdu ? &apdu[apdu_len] : NULL, tag_number);
     return apdu_len;
 }
 
@@ -1993,7 +2207,7 @@ static void testBACDCodeTags(
         ct_test(pTest, IS_CLOSING_TAG(apdu[0]) == true);
         /* test the len-value-type portion */
         for (value = 1;; value = value << 1) {
-            len = encode_tag(&apdu[0], tag_number, false, value);
+            len = encode_tag(apdu, tag_number, false, value);
             len =
                 decode_tag_number_and_value(&apdu[0], &test_tag_number,
                 &test_value);
@@ -2015,6 +2229,190 @@ static void testBACDCodeTags(
     return;
 }
 
+static void testBACDCodeTagHeader(
+    Test * pTest)
+{
+    uint8_t apdu[MAX_APDU] = { 0 };
+    BACNET_TAG_HEADER tag = { 0 };
+    uint8_t tag_number = 0;
+    uint32_t value = 0;
+    uint32_t test_value = 0;
+    uint16_t object_type = 0;
+    uint32_t instance = 0;
+    int len = 0, test_len = 0;
+    unsigned i = 0;
+
+    /* agrees with the byte by byte decoder, and every
+       shorter buffer is reported as truncated */
+    for (i = 0; i < 32; i++) {
+        tag_number = (uint8_t) (i * 9);
+        value = (i < 8) ? i : (1UL << i) - 1;
+        len = encode_tag(apdu, tag_number, (i & 1), value);
+        test_len = decode_tag_header(&apdu[0], len, &tag);
+        ct_test(pTest, test_len == len);
+        ct_test(pTest, tag.number == tag_number);
+        ct_test(pTest, tag.context == (bool) (i & 1));
+        ct_test(pTest, tag.len_value_type == value);
+        ct_test(pTest, !tag.opening && !tag.closing);
+        test_len = decode_tag_number_and_value_safe(&apdu[0], len, NULL,
+            &test_value);
+        ct_test(pTest, test_len == len);
+        ct_test(pTest, test_value == value);
+        for (test_len = 0; test_len < len; test_len++) {
+            ct_test(pTest, decode_tag_header(&apdu[0], test_len, &tag) == 0);
+        }
+    }
+    len = encode_opening_tag(&apdu[0], 200);
+    ct_test(pTest, decode_tag_header(&apdu[0], len, &tag) == len);
+    ct_test(pTest, tag.opening && tag.context && (tag.number == 200));
+    ct_test(pTest, decode_is_opening_tag_number(&apdu[0], 200));
+    ct_test(pTest, !decode_is_closing_tag_number(&apdu[0], 200));
+
+    /* fused context decoders */
+    len = encode_context_unsigned(&apdu[0], 3, 0x123456);
+    ct_test(pTest, decode_context_unsigned_safe(&apdu[0], len, 3,
+            &value) == len);
+    ct_test(pTest, value == 0x123456);
+    /* another tag is not an error, so optional tags can be probed */
+    ct_test(pTest, decode_context_unsigned_safe(&apdu[0], len, 4,
+            &value) == 0);
+    ct_test(pTest, decode_context_unsigned_safe(&apdu[0], len - 1, 3,
+            &value) == BACNET_STATUS_ERROR);
+    len = encode_application_unsigned(&apdu[0], 3);
+    ct_test(pTest, decode_context_unsigned_safe(&apdu[0], len, 2,
+            &value) == 0);
+    len = encode_context_enumerated(&apdu[0], 1, PROP_PRESENT_VALUE);
+    ct_test(pTest, decode_context_enumerated_safe(&apdu[0], len, 1,
+            &value) == len);
+    ct_test(pTest, value == PROP_PRESENT_VALUE);
+    len = encode_context_object_id(&apdu[0], 0, OBJECT_ANALOG_INPUT, 77);
+    ct_test(pTest, decode_context_object_id_safe(&apdu[0], len, 0,
+            &object_type, &instance) == len);
+    ct_test(pTest, object_type == OBJECT_ANALOG_INPUT);
+    ct_test(pTest, instance == 77);
+    ct_test(pTest, decode_context_object_id_safe(&apdu[0], len - 1, 0,
+            &object_type, &instance) == BACNET_STATUS_ERROR);
+    /* an unsigned that is too long for 32 bits */
+    len = encode_tag(apdu, 3, true, 5);
+    ct_test(pTest, decode_context_unsigned_safe(&apdu[0], len + 5, 3,
+            &value) == BACNET_STATUS_ERROR);
+}
+
+/* a NULL buffer returns the same length as a real encoding */
+static void testBACDCodeSizeOnly(
+    Test * pTest)
+{
+    uint8_t apdu[MAX_APDU] = { 0 };
+    BACNET_BIT_STRING bit_string;
+    BACNET_OCTET_STRING octet_string;
+    BACNET_CHARACTER_STRING char_string;
+    BACNET_DATE bdate = { 2016, 10, 19, 3 };
+    BACNET_TIME btime = { 23, 59, 59, 99 };
+    BACNET_ADDRESS address = { 0 };
+    char text[MAX_APDU] = "";
+    uint32_t value = 0;
+    int len = 0;
+    unsigned i = 0;
+
+    for (i = 0; i < 32; i++) {
+        value = (1UL << i) - 1;
+        len = encode_tag(apdu, (uint8_t) (i * 9), (i & 1), value);
+        ct_test(pTest, encode_tag(NULL, (uint8_t) (i * 9), (i & 1),
+                value) == len);
+        len = encode_application_unsigned(apdu, value);
+        ct_test(pTest, encode_application_unsigned(NULL, value) == len);
+        len = encode_context_unsigned(apdu, (uint8_t) i, value);
+        ct_test(pTest, encode_context_unsigned(NULL, (uint8_t) i,
+                value) == len);
+        len = encode_application_enumerated(apdu, value);
+        ct_test(pTest, encode_application_enumerated(NULL, value) == len);
+        len = encode_context_enumerated(apdu, 20, value);
+        ct_test(pTest, encode_context_enumerated(NULL, 20, value) == len);
+#if BACNET_USE_SIGNED
+        len = encode_application_signed(apdu, -(int32_t) value);
+        ct_test(pTest, encode_application_signed(NULL,
+                -(int32_t) value) == len);
+        len = encode_context_signed(apdu, 2, (int32_t) value);
+        ct_test(pTest, encode_context_signed(NULL, 2,
+                (int32_t) value) == len);
+#endif
+    }
+    ct_test(pTest, encode_opening_tag(NULL, 3) == encode_opening_tag(apdu,
+            3));
+    ct_test(pTest, encode_closing_tag(NULL, 30) == encode_closing_tag(apdu,
+            30));
+    len = encode_application_null(apdu);
+    ct_test(pTest, encode_application_null(NULL) == len);
+    len = encode_context_null(apdu, 1);
+    ct_test(pTest, encode_context_null(NULL, 1) == len);
+    len = encode_application_boolean(apdu, true);
+    ct_test(pTest, encode_application_boolean(NULL, true) == len);
+    len = encode_context_boolean(apdu, 2, true);
+    ct_test(pTest, encode_context_boolean(NULL, 2, true) == len);
+    len = encode_application_real(apdu, 3.14159F);
+    ct_test(pTest, encode_application_real(NULL, 3.14159F) == len);
+    len = encode_context_real(apdu, 4, 3.14159F);
+    ct_test(pTest, encode_context_real(NULL, 4, 3.14159F) == len);
+#if BACNET_USE_DOUBLE
+    len = encode_application_double(apdu, 3.14159);
+    ct_test(pTest, encode_application_double(NULL, 3.14159) == len);
+    len = encode_context_double(apdu, 4, 3.14159);
+    ct_test(pTest, encode_context_double(NULL, 4, 3.14159) == len);
+#endif
+    len = encode_application_object_id(apdu, OBJECT_DEVICE, 1234);
+    ct_test(pTest, encode_application_object_id(NULL, OBJECT_DEVICE,
+            1234) == len);
+    len = encode_context_object_id(apdu, 5, OBJECT_DEVICE, 1234);
+    ct_test(pTest, encode_context_object_id(NULL, 5, OBJECT_DEVICE,
+            1234) == len);
+    len = encode_application_date(apdu, &bdate);
+    ct_test(pTest, encode_application_date(NULL, &bdate) == len);
+    len = encode_context_date(apdu, 6, &bdate);
+    ct_test(pTest, encode_context_date(NULL, 6, &bdate) == len);
+    len = encode_application_time(apdu, &btime);
+    ct_test(pTest, encode_application_time(NULL, &btime) == len);
+    len = encode_context_time(apdu, 7, &btime);
+    ct_test(pTest, encode_context_time(NULL, 7, &btime) == len);
+
+    bitstring_init(&bit_string);
+    len = encode_application_bitstring(apdu, &bit_string);
+    ct_test(pTest, encode_application_bitstring(NULL, &bit_string) == len);
+    for (i = 0; i < 20; i++) {
+        bitstring_set_bit(&bit_string, (uint8_t) i, (i & 1));
+    }
+    len = encode_application_bitstring(apdu, &bit_string);
+    ct_test(pTest, encode_application_bitstring(NULL, &bit_string) == len);
+    len = encode_context_bitstring(apdu, 8, &bit_string);
+    ct_test(pTest, encode_context_bitstring(NULL, 8, &bit_string) == len);
+
+    for (i = 0; i < (MAX_APDU - 8); i += 10) {
+        memset(text, 'A', i);
+        text[i] = 0;
+        characterstring_init_ansi(&char_string, text);
+        len = encode_application_character_string(apdu, &char_string);
+        ct_test(pTest, len > 0);
+        ct_test(pTest, encode_application_character_string(NULL,
+                &char_string) == len);
+        len = encode_context_character_string(apdu, 9, &char_string);
+        ct_test(pTest, encode_context_character_string(NULL, 9,
+                &char_string) == len);
+#if BACNET_USE_OCTETSTRING
+        octetstring_init(&octet_string, (uint8_t *) text, i);
+        len = encode_application_octet_string(apdu, &octet_string);
+        ct_test(pTest, encode_application_octet_string(NULL,
+                &octet_string) == len);
+        len = encode_context_octet_string(apdu, 10, &octet_string);
+        ct_test(pTest, encode_context_octet_string(NULL, 10,
+                &octet_string) == len);
+#endif
+    }
+
+    address.net = 1234;
+    address.len = 6;
+    len = encode_context_bacnet_address(apdu, 1, &address);
+    ct_test(pTest, encode_context_bacnet_address(NULL, 1, &address) == len);
+}
+
 static void testBACDCodeEnumerated(
     Test * pTest)
 {
@@ -3126,6 +3524,10 @@ void test_BACDCode(
     /* add individual tests */
     rc = ct_addTestFunction(pTest, testBACDCodeTags);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testBACDCodeTagHeader);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testBACDCodeSizeOnly);
+    assert(rc);
     rc = ct_addTestFunction(pTest, testBACDCodeReal);
     assert(rc);
     rc = ct_addTestFunction(pTest, testBACDCodeUnsigned);
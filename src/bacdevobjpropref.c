@@ -79,18 +79,20 @@ int bacapp_encode_device_obj_property_ref(
 
     /* object-identifier       [0] BACnetObjectIdentifier */
     len =
-        encode_context_object_id(&apdu[apdu_len], 0,
+        encode_context_object_id(apdu ? &apdu[apdu_len] : NULL, 0,
         (int) value->objectIdentifier.type, value->objectIdentifier.instance);
     apdu_len += len;
     /* property-identifier     [1] BACnetPropertyIdentifier */
     len =
-        encode_context_enumerated(&apdu[apdu_len], 1,
+        encode_context_enumerated(apdu ? &apdu[apdu_len] : NULL, 1,
         value->propertyIdentifier);
     apdu_len += len;
     /* property-array-index    [2] Unsigned OPTIONAL */
     /* Check if needed before inserting */
     if (value->arrayIndex != BACNET_ARRAY_ALL) {
-        len = encode_context_unsigned(&apdu[apdu_len], 2, value->arrayIndex);
+        len =
+            encode_context_unsigned(apdu ? &apdu[apdu_len] : NULL, 2,
+            value->arrayIndex);
         apdu_len += len;
     }
     /* device-identifier       [3] BACnetObjectIdentifier OPTIONAL */
@@ -99,7 +101,7 @@ int bacapp_encode_device_obj_property_ref(
 	 * omit */
     if (value->deviceIdentifier.type == OBJECT_DEVICE) {
         len =
-            encode_context_object_id(&apdu[apdu_len], 3,
+            encode_context_object_id(apdu ? &apdu[apdu_len] : NULL, 3,
             (int) value->deviceIdentifier.type,
             value->deviceIdentifier.instance);
         apdu_len += len;
@@ -45,8 +45,10 @@ int encode_unsigned16(
     uint8_t * apdu,
     uint16_t value)
 {
-    apdu[0] = (uint8_t) ((value & 0xff00) >> 8);
-    apdu[1] = (uint8_t) (value & 0x00ff);
+    if (apdu) {
+        apdu[0] = (uint8_t) ((value & 0xff00) >> 8);
+        apdu[1] = (uint8_t) (value & 0x00ff);
+    }
 
     return 2;
 }
@@ -67,9 +69,11 @@ int encode_unsigned24(
     uint8_t * apdu,
     uint32_t value)
 {
-    apdu[0] = (uint8_t) ((value & 0xff0000) >> 16);
-    apdu[1] = (uint8_t) ((value & 0x00ff00) >> 8);
-    apdu[2] = (uint8_t) (value & 0x0000ff);
+    if (apdu) {
+        apdu[0] = (uint8_t) ((value & 0xff0000) >> 16);
+        apdu[1] = (uint8_t) ((value & 0x00ff00) >> 8);
+        apdu[2] = (uint8_t) (value & 0x0000ff);
+    }
 
     return 3;
 }
@@ -91,10 +95,12 @@ int encode_unsigned32(
     uint8_t * apdu,
     uint32_t value)
 {
-    apdu[0] = (uint8_t) ((value & 0xff000000) >> 24);
-    apdu[1] = (uint8_t) ((value & 0x00ff0000) >> 16);
-    apdu[2] = (uint8_t) ((value & 0x0000ff00) >> 8);
-    apdu[3] = (uint8_t) (value & 0x000000ff);
+    if (apdu) {
+        apdu[0] = (uint8_t) ((value & 0xff000000) >> 24);
+        apdu[1] = (uint8_t) ((value & 0x00ff0000) >> 16);
+        apdu[2] = (uint8_t) ((value & 0x0000ff00) >> 8);
+        apdu[3] = (uint8_t) (value & 0x000000ff);
+    }
 
     return 4;
 }
@@ -124,14 +130,16 @@ int encode_unsigned64(
     uint8_t * buffer,
     uint64_t value)
 {
-    buffer[0] = (uint8_t) ((value & 0xff00000000000000) >> 56);
-    buffer[1] = (uint8_t) ((value & 0x00ff000000000000) >> 48);
-    buffer[2] = (uint8_t) ((value & 0x0000ff0000000000) >> 40);
-    buffer[3] = (uint8_t) ((value & 0x000000ff00000000) >> 32);
-    buffer[4] = (uint8_t) ((value & 0x00000000ff000000) >> 24);
-    buffer[5] = (uint8_t) ((value & 0x0000000000ff0000) >> 16);
-    buffer[6] = (uint8_t) ((value & 0x000000000000ff00) >> 8);
-    buffer[7] = (uint8_t)  (value & 0x00000000000000ff);
+    if (buffer) {
+        buffer[0] = (uint8_t) ((value & 0xff00000000000000) >> 56);
+        buffer[1] = (uint8_t) ((value & 0x00ff000000000000) >> 48);
+        buffer[2] = (uint8_t) ((value & 0x0000ff0000000000) >> 40);
+        buffer[3] = (uint8_t) ((value & 0x000000ff00000000) >> 32);
+        buffer[4] = (uint8_t) ((value & 0x00000000ff000000) >> 24);
+        buffer[5] = (uint8_t) ((value & 0x0000000000ff0000) >> 16);
+        buffer[6] = (uint8_t) ((value & 0x000000000000ff00) >> 8);
+        buffer[7] = (uint8_t)  (value & 0x00000000000000ff);
+    }
 
     return 8;
 }
@@ -166,7 +174,9 @@ int encode_signed8(
     uint8_t * apdu,
     int8_t value)
 {
-    apdu[0] = (uint8_t) value;
+    if (apdu) {
+        apdu[0] = (uint8_t) value;
+    }
 
     return 1;
 }
@@ -191,8 +201,10 @@ int encode_signed16(
     uint8_t * apdu,
     int16_t value)
 {
-    apdu[0] = (uint8_t) ((value & 0xff00) >> 8);
-    apdu[1] = (uint8_t) (value & 0x00ff);
+    if (apdu) {
+        apdu[0] = (uint8_t) ((value & 0xff00) >> 8);
+        apdu[1] = (uint8_t) (value & 0x00ff);
+    }
 
     return 2;
 }
@@ -218,9 +230,11 @@ int encode_signed24(
     uint8_t * apdu,
     int32_t value)
 {
-    apdu[0] = (uint8_t) ((value & 0xff0000) >> 16);
-    apdu[1] = (uint8_t) ((value & 0x00ff00) >> 8);
-    apdu[2] = (uint8_t) (value & 0x0000ff);
+    if (apdu) {
+        apdu[0] = (uint8_t) ((value & 0xff0000) >> 16);
+        apdu[1] = (uint8_t) ((value & 0x00ff00) >> 8);
+        apdu[2] = (uint8_t) (value & 0x0000ff);
+    }
 
     return 3;
 }
@@ -247,10 +261,12 @@ int encode_signed32(
     uint8_t * apdu,
     int32_t value)
 {
-    apdu[0] = (uint8_t) ((value & 0xff000000) >> 24);
-    apdu[1] = (uint8_t) ((value & 0x00ff0000) >> 16);
-    apdu[2] = (uint8_t) ((value & 0x0000ff00) >> 8);
-    apdu[3] = (uint8_t) (value & 0x000000ff);
+    if (apdu) {
+        apdu[0] = (uint8_t) ((value & 0xff000000) >> 24);
+        apdu[1] = (uint8_t) ((value & 0x00ff0000) >> 16);
+        apdu[2] = (uint8_t) ((value & 0x0000ff00) >> 8);
+        apdu[3] = (uint8_t) (value & 0x000000ff);
+    }
 
     return 4;
 }
@@ -121,6 +121,9 @@ int encode_bacnet_real(
         float real_value;
     } my_data;
 
+    if (!apdu) {
+        return 4;
+    }
     /* NOTE: assumes the compiler stores float as IEEE-754 float */
     my_data.real_value = value;
 #if BIG_ENDIAN
@@ -201,6 +204,9 @@ int encode_bacnet_double(
         double double_value;
     } my_data;
 
+    if (!apdu) {
+        return 8;
+    }
     /* NOTE: assumes the compiler stores float as IEEE-754 float */
     my_data.double_value = value;
 #if BIG_ENDIAN
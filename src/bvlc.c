@@ -32,8 +32,12 @@
  -------------------------------------------
 ####COPYRIGHTEND####*/
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     /* for sendmmsg() */
+#endif
 #include <stdint.h>     /* for standard integer types uint8_t etc. */
 #include <stdbool.h>    /* for the standard bool type. */
+#include <stdlib.h>     /* for realloc */
 #include <time.h>
 #include "bacenum.h"
 #include "bacdcode.h"
@@ -96,14 +100,61 @@ typedef struct {
     uint16_t dest_port;
     /* seconds for valid entry lifetime */
     uint16_t time_to_live;
-    /* our counter */
-    time_t seconds_remaining;   /* includes 30 second grace period */
+    /* FD_Clock second at which the entry is purged */
+    uint32_t expires;   /* includes 30 second grace period */
+    /* next entry in the same hash bucket, or in the free list */
+    int hash_next;
+    /* neighbours in the same timer wheel slot */
+    int wheel_next;
+    int wheel_prev;
 } FD_TABLE_ENTRY;
 
 #ifndef MAX_FD_ENTRIES
 #define MAX_FD_ENTRIES 128
 #endif
-static FD_TABLE_ENTRY FD_Table[MAX_FD_ENTRIES];
+/* The FDT starts with room for this many foreign devices, and doubles
+   in size as more of them register, up to MAX_FD_ENTRIES. */
+#ifndef FD_TABLE_INITIAL_SIZE
+#define FD_TABLE_INITIAL_SIZE 16
+#endif
+/* slots in the timer wheel that purges the FDT - a power of two */
+#ifndef FD_WHEEL_SLOTS
+#define FD_WHEEL_SLOTS 64
+#endif
+static FD_TABLE_ENTRY *FD_Table;
+static unsigned FD_Table_Size;
+static unsigned FD_Count;
+/* entries not in use, linked by hash_next */
+static int FD_Free = -1;
+/* first entry of each hash bucket, hashed by address and port */
+static int *FD_Hash;
+static unsigned FD_Hash_Mask;
+/* entries, by the second at which they expire modulo FD_WHEEL_SLOTS */
+static int FD_Wheel[FD_WHEEL_SLOTS];
+/* seconds counted by bvlc_maintenance_timer() */
+static uint32_t FD_Clock;
+
+/* The destinations of a Forwarded-NPDU do not depend on the message,
+   so they are worked out when the BDT, the FDT, or our own address
+   changes, rather than for every broadcast. */
+static struct sockaddr_in BDT_Fanout[MAX_BBMD_ENTRIES];
+static unsigned BDT_Fanout_Count;
+static bool BDT_Fanout_Valid;
+static struct sockaddr_in *FDT_Fanout;
+static unsigned FDT_Fanout_Size;
+static unsigned FDT_Fanout_Count;
+static bool FDT_Fanout_Valid;
+/* BDT members with a unicast mask, other than us, hashed like the FDT */
+#define BDT_HASH_SIZE 64
+static int BDT_Unicast_Hash[BDT_HASH_SIZE];
+static int BDT_Unicast_Next[MAX_BBMD_ENTRIES];
+/* our own addresses when the destinations were worked out */
+static struct {
+    uint32_t addr;
+    uint32_t broadcast_addr;
+    uint16_t port;
+    uint32_t nat_addr;
+} Fanout_Self;
 
 
 /* Define BBMD_BACKUP_FILE if the contents of the BDT
@@ -158,9 +209,11 @@ void bvlc_bdt_restore_local(
         size_t entries = 0;
         
         entries = fread(BBMD_Table_tmp, sizeof(BBMD_TABLE_ENTRY), MAX_BBMD_ENTRIES, bdt_file_ptr); 
-        if (entries == MAX_BBMD_ENTRIES)
+        if (entries == MAX_BBMD_ENTRIES) {
             /* success reading the BDT table. */
             memcpy(BBMD_Table, BBMD_Table_tmp, sizeof(BBMD_TABLE_ENTRY) * MAX_BBMD_ENTRIES);
+            BDT_Fanout_Valid = false;
+        }
     }
 }
 #else
@@ -172,28 +225,327 @@ void bvlc_bdt_restore_local(void) {}
 
 
 
+/** Hash a B/IP address for the FDT and BDT lookups.
+ *
+ * @param addr - IP address in network order
+ * @param port - UDP port in network order
+ *
+ * @return hash value, to be masked down to the table size
+ */
+static unsigned bvlc_hash_bip_address(
+    uint32_t addr,
+    uint16_t port)
+{
+    uint32_t hash = addr ^ ((uint32_t) port << 16) ^ port;
+
+    hash ^= hash >> 16;
+    hash *= 0x45D9F3BUL;
+    hash ^= hash >> 16;
+
+    return (unsigned) hash;
+}
+
+/** Makes room for more foreign devices, up to MAX_FD_ENTRIES.
+ *
+ * @return true if the free list has entries again
+ */
+static bool bvlc_fdt_grow(
+    void)
+{
+    FD_TABLE_ENTRY *table = NULL;
+    int *hash = NULL;
+    unsigned size = 0;
+    unsigned hash_size = 1;
+    unsigned bucket = 0;
+    unsigned i = 0;
+
+    if (FD_Table_Size >= MAX_FD_ENTRIES) {
+        return false;
+    }
+    if (FD_Table_Size == 0) {
+        size = FD_TABLE_INITIAL_SIZE;
+        for (i = 0; i < FD_WHEEL_SLOTS; i++) {
+            FD_Wheel[i] = -1;
+        }
+    } else {
+        size = FD_Table_Size * 2;
+    }
+    if (size > MAX_FD_ENTRIES) {
+        size = MAX_FD_ENTRIES;
+    }
+    while (hash_size < size) {
+        hash_size <<= 1;
+    }
+    table = realloc(FD_Table, size * sizeof(FD_TABLE_ENTRY));
+    if (!table) {
+        return false;
+    }
+    FD_Table = table;
+    hash = realloc(FD_Hash, hash_size * sizeof(int));
+    if (!hash) {
+        return false;
+    }
+    FD_Hash = hash;
+    FD_Hash_Mask = hash_size - 1;
+    /* the new entries go on the free list, lowest index first */
+    for (i = size; i > FD_Table_Size; i--) {
+        FD_Table[i - 1].valid = false;
+        FD_Table[i - 1].hash_next = FD_Free;
+        FD_Free = (int) (i - 1);
+    }
+    FD_Table_Size = size;
+    /* rehash the entries in use into the larger bucket list */
+    for (i = 0; i < hash_size; i++) {
+        FD_Hash[i] = -1;
+    }
+    for (i = 0; i < size; i++) {
+        if (FD_Table[i].valid) {
+            bucket =
+                bvlc_hash_bip_address(FD_Table[i].dest_address.s_addr,
+                FD_Table[i].dest_port) & FD_Hash_Mask;
+            FD_Table[i].hash_next = FD_Hash[bucket];
+            FD_Hash[bucket] = (int) i;
+        }
+    }
+
+    return true;
+}
+
+/** Finds a foreign device in the FDT.
+ *
+ * @param addr - IP address in network order
+ * @param port - UDP port in network order
+ *
+ * @return index of the entry, or -1 if not found
+ */
+static int bvlc_fdt_find(
+    uint32_t addr,
+    uint16_t port)
+{
+    int index = -1;
+
+    if (FD_Hash) {
+        index = FD_Hash[bvlc_hash_bip_address(addr, port) & FD_Hash_Mask];
+        while (index >= 0) {
+            if ((FD_Table[index].dest_address.s_addr == addr) &&
+                (FD_Table[index].dest_port == port)) {
+                break;
+            }
+            index = FD_Table[index].hash_next;
+        }
+    }
+
+    return index;
+}
+
+static void bvlc_fdt_wheel_insert(
+    int index)
+{
+    int *slot = &FD_Wheel[FD_Table[index].expires % FD_WHEEL_SLOTS];
+
+    FD_Table[index].wheel_prev = -1;
+    FD_Table[index].wheel_next = *slot;
+    if (*slot >= 0) {
+        FD_Table[*slot].wheel_prev = index;
+    }
+    *slot = index;
+}
+
+static void bvlc_fdt_wheel_remove(
+    int index)
+{
+    FD_TABLE_ENTRY *entry = &FD_Table[index];
+
+    if (entry->wheel_prev >= 0) {
+        FD_Table[entry->wheel_prev].wheel_next = entry->wheel_next;
+    } else {
+        FD_Wheel[entry->expires % FD_WHEEL_SLOTS] = entry->wheel_next;
+    }
+    if (entry->wheel_next >= 0) {
+        FD_Table[entry->wheel_next].wheel_prev = entry->wheel_prev;
+    }
+}
+
+/** Removes a foreign device from the FDT.
+ *
+ * @param index - index of the entry, which must be in use
+ */
+static void bvlc_fdt_remove(
+    int index)
+{
+    int *link = NULL;
+
+    bvlc_fdt_wheel_remove(index);
+    link =
+        &FD_Hash[bvlc_hash_bip_address(FD_Table[index].dest_address.s_addr,
+            FD_Table[index].dest_port) & FD_Hash_Mask];
+    while (*link != index) {
+        link = &FD_Table[*link].hash_next;
+    }
+    *link = FD_Table[index].hash_next;
+    FD_Table[index].valid = false;
+    FD_Table[index].hash_next = FD_Free;
+    FD_Free = index;
+    FD_Count--;
+    FDT_Fanout_Valid = false;
+}
+
 /** A timer function that is called about once a second.
+ *
+ * Each call only looks at the timer wheel slots for the seconds that
+ * have passed, so the cost does not grow with the size of the FDT.
  *
  * @param seconds - number of elapsed seconds since the last call
  */
 void bvlc_maintenance_timer(
     time_t seconds)
 {
+    int index = 0;
+    int next = 0;
+
+    if (seconds <= 0) {
+        return;
+    }
+    if (FD_Table_Size == 0) {
+        FD_Clock += (uint32_t) seconds;
+        return;
+    }
+    /* one turn of the wheel visits every slot */
+    if (seconds > FD_WHEEL_SLOTS) {
+        FD_Clock += (uint32_t) (seconds - FD_WHEEL_SLOTS);
+        seconds = FD_WHEEL_SLOTS;
+    }
+    while (seconds > 0) {
+        FD_Clock++;
+        seconds--;
+        index = FD_Wheel[FD_Clock % FD_WHEEL_SLOTS];
+        while (index >= 0) {
+            next = FD_Table[index].wheel_next;
+            /* entries due on a later turn of the wheel stay put */
+            if (FD_Table[index].expires <= FD_Clock) {
+                bvlc_fdt_remove(index);
+            }
+            index = next;
+        }
+    }
+}
+
+/** Works out the Forwarded-NPDU destinations again, if the BDT, the FDT,
+ * or our own address changed since they were last worked out.
+ */
+static void bvlc_fanout_update(
+    void)
+{
+    struct sockaddr_in *dest = NULL;
+    uint32_t nat_addr = 0;
+    unsigned bucket = 0;
     unsigned i = 0;
 
-    for (i = 0; i < MAX_FD_ENTRIES; i++) {
-        if (FD_Table[i].valid) {
-            if (FD_Table[i].seconds_remaining) {
-                if (FD_Table[i].seconds_remaining < seconds) {
-                    FD_Table[i].seconds_remaining = 0;
-                } else {
-                    FD_Table[i].seconds_remaining -= seconds;
-                }
-                if (FD_Table[i].seconds_remaining == 0) {
-                    FD_Table[i].valid = false;
-                }
+    if (BVLC_NAT_Handling) {
+        nat_addr = BVLC_Global_Address.s_addr;
+    }
+    if ((Fanout_Self.addr != bip_get_addr()) ||
+        (Fanout_Self.broadcast_addr != bip_get_broadcast_addr()) ||
+        (Fanout_Self.port != bip_get_port()) ||
+        (Fanout_Self.nat_addr != nat_addr)) {
+        Fanout_Self.addr = bip_get_addr();
+        Fanout_Self.broadcast_addr = bip_get_broadcast_addr();
+        Fanout_Self.port = bip_get_port();
+        Fanout_Self.nat_addr = nat_addr;
+        BDT_Fanout_Valid = false;
+        FDT_Fanout_Valid = false;
+    }
+    if (!BDT_Fanout_Valid) {
+        BDT_Fanout_Count = 0;
+        for (i = 0; i < BDT_HASH_SIZE; i++) {
+            BDT_Unicast_Hash[i] = -1;
+        }
+        for (i = 0; i < MAX_BBMD_ENTRIES; i++) {
+            if (!BBMD_Table[i].valid) {
+                continue;
+            }
+            if ((BBMD_Table[i].broadcast_mask.s_addr == 0xFFFFFFFFL) &&
+                !((BBMD_Table[i].dest_address.s_addr == Fanout_Self.addr) &&
+                    (BBMD_Table[i].dest_port == Fanout_Self.port))) {
+                bucket =
+                    bvlc_hash_bip_address(BBMD_Table[i].dest_address.s_addr,
+                    BBMD_Table[i].dest_port) % BDT_HASH_SIZE;
+                BDT_Unicast_Next[i] = BDT_Unicast_Hash[bucket];
+                BDT_Unicast_Hash[bucket] = (int) i;
+            }
+            dest = &BDT_Fanout[BDT_Fanout_Count];
+            memset(dest, 0, sizeof(struct sockaddr_in));
+            dest->sin_family = AF_INET;
+            /* The B/IP address to which the Forwarded-NPDU message is
+               sent is formed by inverting the broadcast distribution
+               mask in the BDT entry and logically ORing it with the
+               BBMD address of the same entry. */
+            dest->sin_addr.s_addr =
+                ((~BBMD_Table[i].broadcast_mask.
+                    s_addr) | BBMD_Table[i].dest_address.s_addr);
+            dest->sin_port = BBMD_Table[i].dest_port;
+            /* don't send to my broadcast address and same port */
+            if ((dest->sin_addr.s_addr == Fanout_Self.broadcast_addr) &&
+                (dest->sin_port == Fanout_Self.port)) {
+                continue;
+            }
+            /* don't send to my ip address and same port */
+            if ((dest->sin_addr.s_addr == Fanout_Self.addr) &&
+                (dest->sin_port == Fanout_Self.port)) {
+                continue;
             }
+            /* NAT router port forwards BACnet packets from global IP to us.
+             * Packets sent to that global IP by us would end up back,
+             * creating a loop.
+             */
+            if (BVLC_NAT_Handling &&
+                (dest->sin_addr.s_addr == Fanout_Self.nat_addr) &&
+                (dest->sin_port == Fanout_Self.port)) {
+                continue;
+            }
+            BDT_Fanout_Count++;
         }
+        BDT_Fanout_Valid = true;
+    }
+    if (!FDT_Fanout_Valid) {
+        FDT_Fanout_Count = 0;
+        if (FDT_Fanout_Size < FD_Table_Size) {
+            dest =
+                realloc(FDT_Fanout,
+                FD_Table_Size * sizeof(struct sockaddr_in));
+            if (!dest) {
+                /* try again next time */
+                return;
+            }
+            FDT_Fanout = dest;
+            FDT_Fanout_Size = FD_Table_Size;
+        }
+        for (i = 0; i < FD_Table_Size; i++) {
+            if (!FD_Table[i].valid) {
+                continue;
+            }
+            dest = &FDT_Fanout[FDT_Fanout_Count];
+            memset(dest, 0, sizeof(struct sockaddr_in));
+            dest->sin_family = AF_INET;
+            dest->sin_addr.s_addr = FD_Table[i].dest_address.s_addr;
+            dest->sin_port = FD_Table[i].dest_port;
+            /* don't send to my ip address and same port */
+            if ((dest->sin_addr.s_addr == Fanout_Self.addr) &&
+                (dest->sin_port == Fanout_Self.port)) {
+                continue;
+            }
+            /* NAT router port forwards BACnet packets from global IP to us.
+             * Packets sent to that global IP by us would end up back,
+             * creating a loop.
+             */
+            if (BVLC_NAT_Handling &&
+                (dest->sin_addr.s_addr == Fanout_Self.nat_addr) &&
+                (dest->sin_port == Fanout_Self.port)) {
+                continue;
+            }
+            FDT_Fanout_Count++;
+        }
+        FDT_Fanout_Valid = true;
     }
 }
 
@@ -480,45 +832,34 @@ static int bvlc_encode_read_bdt_ack(
     return pdu_len;
 }
 
-/** Encode a Forwarded NPDU message
+/** Encode the BVLC header of a Forwarded NPDU message, which is
+ * followed by the NPDU itself.
  *
- * @param pdu - buffer to store the encoding
+ * @param pdu - buffer to store the encoding, at least 10 bytes
  * @param sin - source address in network order
- * @param npdu - NPDU to forward
- * @param max_npdu - amount of space available in the NPDU
  * @param npdu_length - size of the NPDU to forward
  *
  * @return number of bytes encoded
  */
-static int bvlc_encode_forwarded_npdu(
+static int bvlc_encode_forwarded_npdu_header(
     uint8_t * pdu,
-    uint16_t max_pdu,
     struct sockaddr_in *sin,
-    uint8_t * npdu,
     unsigned npdu_length)
 {
     int len = 0;
 
-    unsigned i; /* for loop counter */
-
-    if (pdu && sin && npdu) {
-        if ((npdu_length + 4 + 6) <= max_pdu) {
-            pdu[0] = BVLL_TYPE_BACNET_IP;
-            pdu[1] = BVLC_FORWARDED_NPDU;
-            /* The 2-octet BVLC Length field is the length, in octets,
-               of the entire BVLL message, including the two octets of the
-               length field itself, most significant octet first. */
-            encode_unsigned16(&pdu[2], (uint16_t) (4 + 6 + npdu_length));
-            len = 4;
-            /* 6-octet address encoding */
-            len +=
-                bvlc_encode_bip_address(&pdu[len], &sin->sin_addr,
-                sin->sin_port);
-            for (i = 0; i < npdu_length; i++) {
-                pdu[len] = npdu[i];
-                len++;
-            }
-        }
+    if (pdu && sin) {
+        pdu[0] = BVLL_TYPE_BACNET_IP;
+        pdu[1] = BVLC_FORWARDED_NPDU;
+        /* The 2-octet BVLC Length field is the length, in octets,
+           of the entire BVLL message, including the two octets of the
+           length field itself, most significant octet first. */
+        encode_unsigned16(&pdu[2], (uint16_t) (4 + 6 + npdu_length));
+        len = 4;
+        /* 6-octet address encoding */
+        len +=
+            bvlc_encode_bip_address(&pdu[len], &sin->sin_addr,
+            sin->sin_port);
     }
 
     return len;
@@ -594,18 +935,12 @@ static int bvlc_encode_read_fdt_ack(
 {
     int pdu_len = 0;    /* return value */
     int len = 0;
-    unsigned count = 0;
     unsigned i;
-    uint16_t seconds_remaining = 0;
+    uint32_t seconds_remaining = 0;
 
-    for (i = 0; i < MAX_FD_ENTRIES; i++) {
-        if (FD_Table[i].valid) {
-            count++;
-        }
-    }
-    len = bvlc_encode_read_fdt_ack_init(&pdu[0], count);
+    len = bvlc_encode_read_fdt_ack_init(&pdu[0], FD_Count);
     pdu_len += len;
-    for (i = 0; i < MAX_FD_ENTRIES; i++) {
+    for (i = 0; i < FD_Table_Size; i++) {
         if (FD_Table[i].valid) {
             /* too much to send */
             if ((pdu_len + 10) > max_pdu) {
@@ -618,8 +953,13 @@ static int bvlc_encode_read_fdt_ack(
             pdu_len += len;
             len = encode_unsigned16(&pdu[pdu_len], FD_Table[i].time_to_live);
             pdu_len += len;
-            seconds_remaining = (uint16_t) FD_Table[i].seconds_remaining;
-            len = encode_unsigned16(&pdu[pdu_len], seconds_remaining);
+            seconds_remaining = FD_Table[i].expires - FD_Clock;
+            if (seconds_remaining > 0xFFFF) {
+                seconds_remaining = 0xFFFF;
+            }
+            len =
+                encode_unsigned16(&pdu[pdu_len],
+                (uint16_t) seconds_remaining);
             pdu_len += len;
         }
     }
@@ -769,6 +1109,7 @@ static bool bvlc_create_bdt(
         }
     }
     /* BDT changed! Save backup to file */
+    BDT_Fanout_Valid = false;
     bvlc_bdt_backup_local();
 
     /* did they all fit? */
@@ -790,41 +1131,39 @@ static bool bvlc_register_foreign_device(
     struct sockaddr_in *sin,
     uint16_t time_to_live)
 {
-    unsigned i = 0;
-    bool status = false;
+    int index = 0;
+    int *bucket = NULL;
 
     /* am I here already?  If so, update my time to live... */
-    for (i = 0; i < MAX_FD_ENTRIES; i++) {
-        if (FD_Table[i].valid) {
-            if ((FD_Table[i].dest_address.s_addr == sin->sin_addr.s_addr) &&
-                (FD_Table[i].dest_port == sin->sin_port)) {
-                status = true;
-                FD_Table[i].time_to_live = time_to_live;
-                /*  Upon receipt of a BVLL Register-Foreign-Device message,
-                   a BBMD shall start a timer with a value equal to the
-                   Time-to-Live parameter supplied plus a fixed grace
-                   period of 30 seconds. */
-                FD_Table[i].seconds_remaining = time_to_live + 30;
-                break;
-            }
-        }
-    }
-    if (!status) {
-        for (i = 0; i < MAX_FD_ENTRIES; i++) {
-            if (!FD_Table[i].valid) {
-                FD_Table[i].dest_address.s_addr = sin->sin_addr.s_addr;
-                FD_Table[i].dest_port = sin->sin_port;
-                FD_Table[i].time_to_live = time_to_live;
-                FD_Table[i].seconds_remaining = time_to_live + 30;
-                FD_Table[i].valid = true;
-                status = true;
-                break;
-            }
+    index = bvlc_fdt_find(sin->sin_addr.s_addr, sin->sin_port);
+    if (index >= 0) {
+        bvlc_fdt_wheel_remove(index);
+    } else {
+        if ((FD_Free < 0) && !bvlc_fdt_grow()) {
+            return false;
         }
+        index = FD_Free;
+        FD_Free = FD_Table[index].hash_next;
+        FD_Table[index].dest_address.s_addr = sin->sin_addr.s_addr;
+        FD_Table[index].dest_port = sin->sin_port;
+        FD_Table[index].valid = true;
+        bucket =
+            &FD_Hash[bvlc_hash_bip_address(sin->sin_addr.s_addr,
+                sin->sin_port) & FD_Hash_Mask];
+        FD_Table[index].hash_next = *bucket;
+        *bucket = index;
+        FD_Count++;
+        FDT_Fanout_Valid = false;
     }
+    FD_Table[index].time_to_live = time_to_live;
+    /*  Upon receipt of a BVLL Register-Foreign-Device message,
+       a BBMD shall start a timer with a value equal to the
+       Time-to-Live parameter supplied plus a fixed grace
+       period of 30 seconds. */
+    FD_Table[index].expires = FD_Clock + time_to_live + 30;
+    bvlc_fdt_wheel_insert(index);
 
-
-    return status;
+    return true;
 }
 
 /** Delete a Foreign Device from the Foreign Device Table
@@ -839,22 +1178,16 @@ static bool bvlc_delete_foreign_device(
 {
     struct sockaddr_in sin = { 0 };     /* the ip address */
     bool status = false;        /* return value */
-    unsigned i = 0;
+    int index = 0;
 
     if (pdu_len < 6) {
         return status;
     }
     bvlc_decode_bip_address(pdu, &sin.sin_addr, &sin.sin_port);
-    for (i = 0; i < MAX_FD_ENTRIES; i++) {
-        if (FD_Table[i].valid) {
-            if ((FD_Table[i].dest_address.s_addr == sin.sin_addr.s_addr) &&
-                (FD_Table[i].dest_port == sin.sin_port)) {
-                FD_Table[i].valid = false;
-                FD_Table[i].seconds_remaining = 0;
-                status = true;
-                break;
-            }
-        }
+    index = bvlc_fdt_find(sin.sin_addr.s_addr, sin.sin_port);
+    if (index >= 0) {
+        bvlc_fdt_remove(index);
+        status = true;
     }
     return status;
 }
@@ -894,176 +1227,191 @@ int bvlc_send_mpdu(
 }
 
 #if defined(BBMD_ENABLED) && BBMD_ENABLED
-/** Sends all Broadcast Devices a Forwarded NPDU
+/* messages handed to the kernel in one sendmmsg() call */
+#ifndef BVLC_SEND_BATCH
+#define BVLC_SEND_BATCH 64
+#endif
+
+/* where bvlc_forward_npdu() sends a Forwarded-NPDU */
+#define BVLC_FORWARD_LOCAL 0x01 /* our local B/IP broadcast address */
+#define BVLC_FORWARD_BDT 0x02   /* each peer BBMD in the BDT */
+#define BVLC_FORWARD_FDT 0x04   /* each foreign device in the FDT */
+
+/* One Forwarded-NPDU on its way to several destinations.  The BVLC
+   header is encoded once and the NPDU is sent from where it was
+   received: on Linux each message points at both with an iovec, and
+   the messages go to the kernel in batches with sendmmsg().  Other
+   ports copy the frame once and send it with sendto(). */
+typedef struct {
+#if defined(__linux__)
+    struct iovec iov[2];
+    struct mmsghdr msgs[BVLC_SEND_BATCH];
+    unsigned count;
+#else
+    uint8_t mtu[MAX_MPDU];
+    uint16_t mtu_len;
+#endif
+} BVLC_FORWARD;
+
+static void bvlc_forward_init(
+    BVLC_FORWARD * forward,
+    uint8_t * header,
+    uint16_t header_len,
+    uint8_t * npdu,
+    uint16_t npdu_length)
+{
+#if defined(__linux__)
+    forward->iov[0].iov_base = header;
+    forward->iov[0].iov_len = header_len;
+    forward->iov[1].iov_base = npdu;
+    forward->iov[1].iov_len = npdu_length;
+    forward->count = 0;
+#else
+    memcpy(&forward->mtu[0], header, header_len);
+    memcpy(&forward->mtu[header_len], npdu, npdu_length);
+    forward->mtu_len = header_len + npdu_length;
+#endif
+}
+
+/** Sends the messages that are waiting in the batch.
  *
- * @param sin - source address in network order
- * @param npdu - the NPDU
- * @param max_npdu - amount of space available in the NPDU
- * @param npdu_length - length of the NPDU
- * @param original - was the message an original (not forwarded)
+ * @param forward - the Forwarded-NPDU
  */
-static void bvlc_bdt_forward_npdu(
-    struct sockaddr_in *sin,
-    uint8_t * npdu,
-    uint16_t npdu_length,
-    bool original)
+static void bvlc_forward_flush(
+    BVLC_FORWARD * forward)
 {
-    uint8_t mtu[MAX_MPDU] = { 0 };
-    uint16_t mtu_len = 0;
-    unsigned i = 0;     /* loop counter */
-    struct sockaddr_in bip_dest = { 0 };
+#if defined(__linux__)
+    unsigned i = 0;
+    int sent = 0;
 
-    /* If we are forwarding an original broadcast message and the NAT
-     * handling is enabled, change the source address to NAT routers
-     * global IP address so the recipient can reply (local IP address
-     * is not accesible from internet side).
-     *
-     * If we are forwarding a message from peer BBMD or foreign device
-     * or the NAT handling is disabled, leave the source address as is.
-     */
-    if(BVLC_NAT_Handling && original) {
-        struct sockaddr_in nat_addr = *sin;
-        nat_addr.sin_addr = BVLC_Global_Address;
-        mtu_len = (uint16_t) bvlc_encode_forwarded_npdu(&mtu[0],
-            (uint16_t)sizeof(mtu), &nat_addr, npdu, npdu_length);
-    }
-    else {
-        mtu_len = (uint16_t) bvlc_encode_forwarded_npdu(&mtu[0],
-            (uint16_t)sizeof(mtu), sin, npdu, npdu_length);
-    }
-    /* loop through the BDT and send one to each entry, except us */
-    for (i = 0; i < MAX_BBMD_ENTRIES; i++) {
-        if (BBMD_Table[i].valid) {
-            /* The B/IP address to which the Forwarded-NPDU message is
-               sent is formed by inverting the broadcast distribution
-               mask in the BDT entry and logically ORing it with the
-               BBMD address of the same entry. */
-            bip_dest.sin_addr.s_addr =
-                ((~BBMD_Table[i].broadcast_mask.
-                    s_addr) | BBMD_Table[i].dest_address.s_addr);
-            bip_dest.sin_port = BBMD_Table[i].dest_port;
-            /* don't send to my broadcast address and same port */
-            if ((bip_dest.sin_addr.s_addr == bip_get_broadcast_addr())
-                && (bip_dest.sin_port == bip_get_port())) {
-                continue;
-            }
-            /* don't send to my ip address and same port */
-            if ((bip_dest.sin_addr.s_addr == bip_get_addr()) &&
-                (bip_dest.sin_port == bip_get_port())) {
-                continue;
-            }
-            /* NAT router port forwards BACnet packets from global IP to us.
-             * Packets sent to that global IP by us would end up back, creating
-             * a loop.
-             */
-            if (BVLC_NAT_Handling &&
-                (bip_dest.sin_addr.s_addr == BVLC_Global_Address.s_addr) &&
-                (bip_dest.sin_port == bip_get_port())) {
-                continue;
+    /* assumes that the driver has already been initialized */
+    if (bip_socket() >= 0) {
+        for (i = 0; i < forward->count; i += (unsigned) sent) {
+            sent =
+                sendmmsg(bip_socket(), &forward->msgs[i], forward->count - i,
+                0);
+            if (sent < 1) {
+                /* drop the message that failed, as sendto() would */
+                sent = 1;
             }
-            bvlc_send_mpdu(&bip_dest, mtu, mtu_len);
-            debug_printf("BVLC: BDT Sent Forwarded-NPDU to %s:%04X\n",
-                inet_ntoa(bip_dest.sin_addr), ntohs(bip_dest.sin_port));
         }
     }
-
-    return;
+    forward->count = 0;
+#else
+    (void) forward;
+#endif
 }
 
-/** Send a BVLL Forwarded-NPDU message on its local IP subnet using
- * the local B/IP broadcast address as the destination address.
+/** Adds a destination for the Forwarded-NPDU.
  *
- * @param sin - source address in network order
- * @param npdu - the NPDU
- * @param max_npdu - amount of space available in the NPDU
- * @param npdu_length - reported length of the NPDU
+ * @param forward - the Forwarded-NPDU
+ * @param dest - destination, with family, address and port in network
+ *  byte order, which must stay valid until bvlc_forward_flush()
  */
-static void bvlc_forward_npdu(
-    struct sockaddr_in *sin,
-    uint8_t * npdu,
-    uint16_t npdu_length)
+static void bvlc_forward_add(
+    BVLC_FORWARD * forward,
+    struct sockaddr_in *dest)
 {
-    uint8_t mtu[MAX_MPDU] = { 0 };
-    uint16_t mtu_len = 0;
-    struct sockaddr_in bip_dest = { 0 };
-
-    mtu_len =
-        (uint16_t) bvlc_encode_forwarded_npdu(&mtu[0],
-        (uint16_t)sizeof(mtu), sin, npdu, npdu_length);
-    bip_dest.sin_addr.s_addr = bip_get_broadcast_addr();
-    bip_dest.sin_port = bip_get_port();
-    bvlc_send_mpdu(&bip_dest, mtu, mtu_len);
-    debug_printf("BVLC: Sent Forwarded-NPDU as local broadcast.\n");
+#if defined(__linux__)
+    struct msghdr *msg = &forward->msgs[forward->count].msg_hdr;
+
+    memset(msg, 0, sizeof(struct msghdr));
+    msg->msg_name = dest;
+    msg->msg_namelen = sizeof(struct sockaddr_in);
+    msg->msg_iov = forward->iov;
+    msg->msg_iovlen = 2;
+    forward->msgs[forward->count].msg_len = 0;
+    forward->count++;
+    if (forward->count == BVLC_SEND_BATCH) {
+        bvlc_forward_flush(forward);
+    }
+#else
+    bvlc_send_mpdu(dest, &forward->mtu[0], forward->mtu_len);
+#endif
 }
 
-/** Sends all Foreign Devices a Forwarded NPDU
+/** Sends a Forwarded NPDU to the local broadcast address, the peer BBMDs
+ * in the BDT, and the Foreign Devices, as asked for.
  *
  * @param sin - source address in network order
- * @param npdu - returns the NPDU
- * @param max_npdu - amount of space available in the NPDU
- * @param npdu_length - reported length of the NPDU
+ * @param npdu - the NPDU
+ * @param npdu_length - length of the NPDU
  * @param original - was the message an original (not forwarded)
+ * @param destinations - BVLC_FORWARD_LOCAL, BVLC_FORWARD_BDT and
+ *  BVLC_FORWARD_FDT, or'ed together
  */
-static void bvlc_fdt_forward_npdu(
+static void bvlc_forward_npdu(
     struct sockaddr_in *sin,
     uint8_t * npdu,
     uint16_t npdu_length,
-    bool original)
+    bool original,
+    unsigned destinations)
 {
-    uint8_t mtu[MAX_MPDU] = { 0 };
-    uint16_t mtu_len = 0;
-    unsigned i = 0;     /* loop counter */
-    struct sockaddr_in bip_dest = { 0 };
+    BVLC_FORWARD forward;
+    uint8_t header[4 + 6];
+    uint16_t header_len = 0;
+    struct sockaddr_in nat_addr = { 0 };
+    struct sockaddr_in local = { 0 };
+    unsigned i = 0;
 
+    bvlc_fanout_update();
+    if (BDT_Fanout_Count == 0) {
+        destinations &= ~BVLC_FORWARD_BDT;
+    }
+    if (FDT_Fanout_Count == 0) {
+        destinations &= ~BVLC_FORWARD_FDT;
+    }
+    if (destinations == 0) {
+        return;
+    }
     /* If we are forwarding an original broadcast message and the NAT
      * handling is enabled, change the source address to NAT routers
      * global IP address so the recipient can reply (local IP address
-     * is not accesible from internet side.
+     * is not accesible from internet side).
      *
      * If we are forwarding a message from peer BBMD or foreign device
      * or the NAT handling is disabled, leave the source address as is.
      */
-    if(BVLC_NAT_Handling && original) {
-        struct sockaddr_in nat_addr = *sin;
+    if (BVLC_NAT_Handling && original) {
+        nat_addr = *sin;
         nat_addr.sin_addr = BVLC_Global_Address;
-        mtu_len = (uint16_t)bvlc_encode_forwarded_npdu(&mtu[0],
-            (uint16_t)sizeof(mtu), &nat_addr, npdu, npdu_length);
+        header_len =
+            (uint16_t) bvlc_encode_forwarded_npdu_header(&header[0],
+            &nat_addr, npdu_length);
     } else {
-        mtu_len = (uint16_t)bvlc_encode_forwarded_npdu(&mtu[0],
-            (uint16_t)sizeof(mtu), sin, npdu, npdu_length);
+        header_len =
+            (uint16_t) bvlc_encode_forwarded_npdu_header(&header[0], sin,
+            npdu_length);
     }
-
-    /* loop through the FDT and send one to each entry */
-    for (i = 0; i < MAX_FD_ENTRIES; i++) {
-        if (FD_Table[i].valid && FD_Table[i].seconds_remaining) {
-            bip_dest.sin_addr.s_addr = FD_Table[i].dest_address.s_addr;
-            bip_dest.sin_port = FD_Table[i].dest_port;
-            /* don't send to my ip address and same port */
-            if ((bip_dest.sin_addr.s_addr == bip_get_addr()) &&
-                (bip_dest.sin_port == bip_get_port())) {
-                continue;
-            }
-            /* don't send to src ip address and same port */
-            if ((bip_dest.sin_addr.s_addr == sin->sin_addr.s_addr) &&
-                (bip_dest.sin_port == sin->sin_port)) {
-                continue;
-            }
-            /* NAT router port forwards BACnet packets from global IP to us.
-             * Packets sent to that global IP by us would end up back, creating
-             * a loop.
-             */
-            if (BVLC_NAT_Handling &&
-                (bip_dest.sin_addr.s_addr == BVLC_Global_Address.s_addr) &&
-                (bip_dest.sin_port == bip_get_port())) {
+    bvlc_forward_init(&forward, &header[0], header_len, npdu, npdu_length);
+    if (destinations & BVLC_FORWARD_LOCAL) {
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = bip_get_broadcast_addr();
+        local.sin_port = bip_get_port();
+        bvlc_forward_add(&forward, &local);
+        debug_printf("BVLC: Sent Forwarded-NPDU as local broadcast.\n");
+    }
+    if (destinations & BVLC_FORWARD_BDT) {
+        /* one to each entry of the BDT, except us */
+        for (i = 0; i < BDT_Fanout_Count; i++) {
+            bvlc_forward_add(&forward, &BDT_Fanout[i]);
+        }
+        debug_printf("BVLC: BDT Sent Forwarded-NPDU to %u peers.\n",
+            BDT_Fanout_Count);
+    }
+    if (destinations & BVLC_FORWARD_FDT) {
+        /* one to each entry of the FDT, except the source */
+        for (i = 0; i < FDT_Fanout_Count; i++) {
+            if ((FDT_Fanout[i].sin_addr.s_addr == sin->sin_addr.s_addr) &&
+                (FDT_Fanout[i].sin_port == sin->sin_port)) {
                 continue;
             }
-            bvlc_send_mpdu(&bip_dest, mtu, mtu_len);
-            debug_printf("BVLC: FDT Sent Forwarded-NPDU to %s:%04X\n",
-                inet_ntoa(bip_dest.sin_addr), ntohs(bip_dest.sin_port));
+            bvlc_forward_add(&forward, &FDT_Fanout[i]);
         }
+        debug_printf("BVLC: FDT Sent Forwarded-NPDU to %u devices.\n",
+            FDT_Fanout_Count);
     }
-
-    return;
+    bvlc_forward_flush(&forward);
 }
 #endif
 
@@ -1141,27 +1489,20 @@ static bool bvlc_bdt_member_mask_is_unicast(
     struct sockaddr_in *sin)
 {
     bool unicast = false;
-    unsigned i = 0;     /* loop counter */
-
-    for (i = 0; i < MAX_BBMD_ENTRIES; i++) {
-        if (BBMD_Table[i].valid) {
-
-            /* Skip ourself*/
-            if ((BBMD_Table[i].dest_address.s_addr == bip_get_addr()) &&
-                (BBMD_Table[i].dest_port == bip_get_port())) {
-                continue;
-            }
-
-            /* find the source address in the table */
-            if ((BBMD_Table[i].dest_address.s_addr == sin->sin_addr.s_addr) &&
-                (BBMD_Table[i].dest_port == sin->sin_port)) {
-                /* unicast mask? */
-                if (BBMD_Table[i].broadcast_mask.s_addr == 0xFFFFFFFFL) {
-                    unicast = true;
-                    break;
-                }
-            }
+    int index = 0;
+
+    bvlc_fanout_update();
+    index =
+        BDT_Unicast_Hash[bvlc_hash_bip_address(sin->sin_addr.s_addr,
+            sin->sin_port) % BDT_HASH_SIZE];
+    while (index >= 0) {
+        /* find the source address in the table */
+        if ((BBMD_Table[index].dest_address.s_addr == sin->sin_addr.s_addr)
+            && (BBMD_Table[index].dest_port == sin->sin_port)) {
+            unicast = true;
+            break;
         }
+        index = BDT_Unicast_Next[index];
     }
 
     return unicast;
@@ -1195,6 +1536,7 @@ uint16_t bvlc_receive(
     uint16_t i = 0;
     bool status = false;
     uint16_t time_to_live = 0;
+    unsigned forward = 0;
 
     /* Make sure the socket is open */
     if (bip_socket() < 0) {
@@ -1330,17 +1672,16 @@ uint16_t bvlc_receive(
                 inet_ntoa(original_sin.sin_addr), ntohs(original_sin.sin_port));
             npdu_len -= 6;
             /*  Broadcast locally if received via unicast from a BDT member */
+            forward = BVLC_FORWARD_FDT;
             if (bvlc_bdt_member_mask_is_unicast(&sin)) {
-                dest.sin_addr.s_addr = bip_get_broadcast_addr();
-                dest.sin_port = bip_get_port();
-				debug_printf("BVLC: Received unicast from BDT member, re-broadcasting locally to %s:%04X.\n",
-					inet_ntoa(dest.sin_addr), ntohs(dest.sin_port));
-                bvlc_send_mpdu(&dest, &npdu[0], npdu_len+4+6);
+                debug_printf("BVLC: Received unicast from BDT member, "
+                    "re-broadcasting locally.\n");
+                forward |= BVLC_FORWARD_LOCAL;
             }
             /* use the original addr from the BVLC for src */
             dest.sin_addr.s_addr = original_sin.sin_addr.s_addr;
             dest.sin_port = original_sin.sin_port;
-            bvlc_fdt_forward_npdu(&dest, &npdu[4 + 6], npdu_len, false);
+            bvlc_forward_npdu(&dest, &npdu[4 + 6], npdu_len, false, forward);
             debug_printf("BVLC: Received Forwarded-NPDU from %s:%04X.\n",
                 inet_ntoa(dest.sin_addr), ntohs(dest.sin_port));
             bvlc_internet_to_bacnet_address(src, &dest);
@@ -1437,9 +1778,8 @@ uint16_t bvlc_receive(
                it shall return a BVLC-Result message to the foreign device
                with a result code of X'0060' indicating that the forwarding
                attempt was unsuccessful */
-            bvlc_forward_npdu(&sin, &npdu[4], npdu_len);
-            bvlc_bdt_forward_npdu(&sin, &npdu[4], npdu_len, false);
-            bvlc_fdt_forward_npdu(&sin, &npdu[4], npdu_len, false);
+            bvlc_forward_npdu(&sin, &npdu[4], npdu_len, false,
+                BVLC_FORWARD_LOCAL | BVLC_FORWARD_BDT | BVLC_FORWARD_FDT);
             /* not an NPDU */
             npdu_len = 0;
             break;
@@ -1491,8 +1831,8 @@ uint16_t bvlc_receive(
                     npdu[i] = npdu[4 + i];
                 }
                 /* if BDT or FDT entries exist, Forward the NPDU */
-                bvlc_bdt_forward_npdu(&sin, &npdu[0], npdu_len, true);
-                bvlc_fdt_forward_npdu(&sin, &npdu[0], npdu_len, true);
+                bvlc_forward_npdu(&sin, &npdu[0], npdu_len, true,
+                    BVLC_FORWARD_BDT | BVLC_FORWARD_FDT);
             } else {
                 /* ignore packets that are too large */
                 npdu_len = 0;
@@ -1777,6 +2117,7 @@ void bvlc_clear_bdt_local(
         BBMD_Table[i].broadcast_mask.s_addr = 0;
     }
     /* BDT changed! Save backup to file */
+    BDT_Fanout_Valid = false;
     bvlc_bdt_backup_local();
 }
 
@@ -1817,6 +2158,7 @@ bool bvlc_add_bdt_entry_local(
     debug_printf("BVLC: BBMD Table entry added.\n");
 
     /* BDT changed! Save backup to file */
+    BDT_Fanout_Valid = false;
     bvlc_bdt_backup_local();
 
     return true;
@@ -1898,6 +2240,204 @@ void testInternetAddress(
     ct_test(pTest, sin.sin_addr.s_addr == test_sin.sin_addr.s_addr);
 }
 
+#if defined(BBMD_ENABLED) && BBMD_ENABLED
+static void testFDTClear(
+    void)
+{
+    unsigned i = 0;
+
+    for (i = 0; i < FD_Table_Size; i++) {
+        if (FD_Table[i].valid) {
+            bvlc_fdt_remove((int) i);
+        }
+    }
+}
+
+void testForeignDeviceTable(
+    Test * pTest)
+{
+    struct sockaddr_in sin = { 0 };
+    uint8_t pdu[MAX_MPDU] = { 0 };
+    unsigned i = 0;
+    int len = 0;
+
+    testFDTClear();
+    for (i = 0; i < MAX_FD_ENTRIES; i++) {
+        sin.sin_addr.s_addr = htonl(0x0A000000UL + (i * 7));
+        sin.sin_port = htons(0xBAC0 + (i % 3));
+        ct_test(pTest, bvlc_register_foreign_device(&sin, 60));
+    }
+    ct_test(pTest, FD_Count == MAX_FD_ENTRIES);
+    sin.sin_addr.s_addr = htonl(0x0B000000UL);
+    ct_test(pTest, !bvlc_register_foreign_device(&sin, 60));
+    /* registering again only restarts the timer */
+    sin.sin_addr.s_addr = htonl(0x0A000000UL + 7);
+    sin.sin_port = htons(0xBAC0 + 1);
+    ct_test(pTest, bvlc_register_foreign_device(&sin, 600));
+    ct_test(pTest, FD_Count == MAX_FD_ENTRIES);
+    for (i = 0; i < MAX_FD_ENTRIES; i++) {
+        ct_test(pTest, bvlc_fdt_find(htonl(0x0A000000UL + (i * 7)),
+                htons(0xBAC0 + (i % 3))) >= 0);
+    }
+    ct_test(pTest, bvlc_fdt_find(htonl(0x0A000000UL + 7), htons(0xBAC0)) < 0);
+    len = bvlc_encode_read_fdt_ack(pdu, sizeof(pdu));
+    ct_test(pTest, len == (4 + (10 * MAX_FD_ENTRIES)));
+    /* delete every other one, then fill the table again */
+    for (i = 0; i < MAX_FD_ENTRIES; i += 2) {
+        sin.sin_addr.s_addr = htonl(0x0A000000UL + (i * 7));
+        sin.sin_port = htons(0xBAC0 + (i % 3));
+        len = bvlc_encode_bip_address(pdu, &sin.sin_addr, sin.sin_port);
+        ct_test(pTest, bvlc_delete_foreign_device(pdu, (uint16_t) len));
+        ct_test(pTest, !bvlc_delete_foreign_device(pdu, (uint16_t) len));
+    }
+    ct_test(pTest, FD_Count == (MAX_FD_ENTRIES / 2));
+    for (i = 0; i < MAX_FD_ENTRIES; i += 2) {
+        sin.sin_addr.s_addr = htonl(0x0C000000UL + i);
+        ct_test(pTest, bvlc_register_foreign_device(&sin, 60));
+    }
+    ct_test(pTest, FD_Count == MAX_FD_ENTRIES);
+    /* the 30 second grace period is added to the time-to-live */
+    testFDTClear();
+    ct_test(pTest, FD_Count == 0);
+    sin.sin_addr.s_addr = htonl(0x0A000001UL);
+    ct_test(pTest, bvlc_register_foreign_device(&sin, 10));
+    sin.sin_addr.s_addr = htonl(0x0A000002UL);
+    ct_test(pTest, bvlc_register_foreign_device(&sin, 100));
+    bvlc_maintenance_timer(39);
+    ct_test(pTest, FD_Count == 2);
+    bvlc_maintenance_timer(1);
+    ct_test(pTest, FD_Count == 1);
+    ct_test(pTest, bvlc_fdt_find(htonl(0x0A000002UL), sin.sin_port) >= 0);
+    bvlc_maintenance_timer(89);
+    ct_test(pTest, FD_Count == 1);
+    bvlc_maintenance_timer(1);
+    ct_test(pTest, FD_Count == 0);
+    /* more than one turn of the wheel at once */
+    ct_test(pTest, bvlc_register_foreign_device(&sin, 1000));
+    bvlc_maintenance_timer(FD_WHEEL_SLOTS * 3);
+    ct_test(pTest, FD_Count == 1);
+    bvlc_maintenance_timer(5000);
+    ct_test(pTest, FD_Count == 0);
+}
+
+static int testBindSocket(
+    struct sockaddr_in *sin)
+{
+    socklen_t sin_len = sizeof(struct sockaddr_in);
+    int sock = 0;
+
+    sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    memset(sin, 0, sizeof(struct sockaddr_in));
+    sin->sin_family = AF_INET;
+    sin->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sin->sin_port = 0;
+    if (sock >= 0) {
+        bind(sock, (struct sockaddr *) sin, sizeof(struct sockaddr_in));
+        getsockname(sock, (struct sockaddr *) sin, &sin_len);
+    }
+
+    return sock;
+}
+
+void testForwardedNPDU(
+    Test * pTest)
+{
+    struct sockaddr_in self = { 0 };
+    struct sockaddr_in peer[3];
+    int sock[3] = { -1, -1, -1 };
+    int bip_sock = -1;
+    uint8_t npdu[4] = { 0x01, 0x20, 0xFF, 0xFF };
+    uint8_t mtu[MAX_MPDU] = { 0 };
+    unsigned i = 0;
+    int len = 0;
+
+    testFDTClear();
+    bip_sock = testBindSocket(&self);
+    ct_test(pTest, bip_sock >= 0);
+    bip_set_socket(bip_sock);
+    bip_set_addr(self.sin_addr.s_addr);
+    bip_set_port(self.sin_port);
+    /* the local broadcast comes back to us */
+    bip_set_broadcast_addr(self.sin_addr.s_addr);
+    for (i = 0; i < 3; i++) {
+        sock[i] = testBindSocket(&peer[i]);
+        ct_test(pTest, sock[i] >= 0);
+        ct_test(pTest, bvlc_register_foreign_device(&peer[i], 60));
+    }
+    /* we never forward to ourself */
+    ct_test(pTest, bvlc_register_foreign_device(&self, 60));
+    bvlc_fanout_update();
+    ct_test(pTest, FDT_Fanout_Count == 3);
+    /* nor back to the source */
+    bvlc_forward_npdu(&peer[0], npdu, sizeof(npdu), false, BVLC_FORWARD_FDT);
+    len = recv(sock[0], mtu, sizeof(mtu), MSG_DONTWAIT);
+    ct_test(pTest, len < 0);
+    for (i = 1; i < 3; i++) {
+        len = recv(sock[i], mtu, sizeof(mtu), MSG_DONTWAIT);
+        ct_test(pTest, len == (4 + 6 + sizeof(npdu)));
+        ct_test(pTest, mtu[1] == BVLC_FORWARDED_NPDU);
+        ct_test(pTest, memcmp(&mtu[4], &peer[0].sin_addr.s_addr, 4) == 0);
+        ct_test(pTest, memcmp(&mtu[10], npdu, sizeof(npdu)) == 0);
+    }
+    len = recv(bip_sock, mtu, sizeof(mtu), MSG_DONTWAIT);
+    ct_test(pTest, len < 0);
+    /* the same frame goes to the local broadcast address too */
+    bvlc_forward_npdu(&peer[2], npdu, sizeof(npdu), false,
+        BVLC_FORWARD_LOCAL | BVLC_FORWARD_BDT | BVLC_FORWARD_FDT);
+    len = recv(bip_sock, mtu, sizeof(mtu), MSG_DONTWAIT);
+    ct_test(pTest, len == (4 + 6 + sizeof(npdu)));
+    ct_test(pTest, memcmp(&mtu[4], &peer[2].sin_addr.s_addr, 4) == 0);
+    ct_test(pTest, memcmp(&mtu[8], &peer[2].sin_port, 2) == 0);
+    for (i = 0; i < 3; i++) {
+        len = recv(sock[i], mtu, sizeof(mtu), MSG_DONTWAIT);
+        if (i == 2) {
+            ct_test(pTest, len < 0);
+        } else {
+            ct_test(pTest, len == (4 + 6 + sizeof(npdu)));
+            ct_test(pTest, memcmp(&mtu[10], npdu, sizeof(npdu)) == 0);
+        }
+    }
+    /* the destinations follow the table */
+    bvlc_maintenance_timer(1000);
+    bvlc_fanout_update();
+    ct_test(pTest, FDT_Fanout_Count == 0);
+    /* BDT: ourself, a peer with a unicast mask, a directed broadcast */
+    memset(BBMD_Table, 0, sizeof(BBMD_Table));
+    BBMD_Table[0].valid = true;
+    BBMD_Table[0].dest_address = self.sin_addr;
+    BBMD_Table[0].dest_port = self.sin_port;
+    BBMD_Table[0].broadcast_mask.s_addr = 0xFFFFFFFFL;
+    BBMD_Table[1].valid = true;
+    BBMD_Table[1].dest_address = peer[1].sin_addr;
+    BBMD_Table[1].dest_port = peer[1].sin_port;
+    BBMD_Table[1].broadcast_mask.s_addr = 0xFFFFFFFFL;
+    BBMD_Table[2].valid = true;
+    BBMD_Table[2].dest_address.s_addr = htonl(0x0A010203UL);
+    BBMD_Table[2].dest_port = htons(0xBAC0);
+    BBMD_Table[2].broadcast_mask.s_addr = htonl(0xFFFFFF00UL);
+    BDT_Fanout_Valid = false;
+    bvlc_fanout_update();
+    ct_test(pTest, BDT_Fanout_Count == 2);
+    ct_test(pTest, BDT_Fanout[0].sin_port == peer[1].sin_port);
+    ct_test(pTest, BDT_Fanout[1].sin_addr.s_addr == htonl(0x0A0102FFUL));
+    ct_test(pTest, bvlc_bdt_member_mask_is_unicast(&peer[1]));
+    ct_test(pTest, !bvlc_bdt_member_mask_is_unicast(&peer[2]));
+    ct_test(pTest, !bvlc_bdt_member_mask_is_unicast(&self));
+    /* a change of our own address is noticed */
+    bip_set_addr(peer[1].sin_addr.s_addr);
+    bip_set_port(peer[1].sin_port);
+    ct_test(pTest, !bvlc_bdt_member_mask_is_unicast(&peer[1]));
+    ct_test(pTest, BDT_Fanout_Count == 2);
+    memset(BBMD_Table, 0, sizeof(BBMD_Table));
+    BDT_Fanout_Valid = false;
+    for (i = 0; i < 3; i++) {
+        close(sock[i]);
+    }
+    close(bip_sock);
+    bip_set_socket(-1);
+}
+#endif
+
 #ifdef TEST_BVLC
 int main(
     void)
@@ -1911,6 +2451,12 @@ int main(
     assert(rc);
     rc = ct_addTestFunction(pTest, testInternetAddress);
     assert(rc);
+#if defined(BBMD_ENABLED) && BBMD_ENABLED
+    rc = ct_addTestFunction(pTest, testForeignDeviceTable);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testForwardedNPDU);
+    assert(rc);
+#endif
     /* configure output */
     ct_setStream(pTest, stdout);
     ct_run(pTest);
@@ -144,6 +144,32 @@ void datalink_set(
         datalink_get_my_address = dlmstp_get_my_address;
     }
 }
+
+/** Function template to get the descriptor that becomes readable when
+ * the DataLink has received something, for use with an event loop.
+ * @ingroup DLTemplates
+ *
+ * @return file descriptor, or -1 if the DataLink does not have one.
+ */
+int datalink_receive_fd(
+    void)
+{
+    if ((datalink_receive == bip_receive) ||
+        (datalink_receive == bvlc_receive)) {
+        return bip_socket();
+    } else if ((datalink_receive == bip6_receive) ||
+        (datalink_receive == bvlc6_receive)) {
+        return bip6_socket();
+    } else if (datalink_receive == ethernet_receive) {
+        return ethernet_socket();
+    } else if (datalink_receive == arcnet_receive) {
+        return arcnet_socket();
+    } else if (datalink_receive == dlmstp_receive) {
+        return dlmstp_receive_fd();
+    }
+
+    return -1;
+}
 #endif
 
 #if defined(BACDL_NONE)
@@ -170,6 +196,12 @@ void datalink_cleanup(
 {
 }
 
+int datalink_receive_fd(
+    void)
+{
+    return -1;
+}
+
 void datalink_get_broadcast_address(
     BACNET_ADDRESS * dest)
 {
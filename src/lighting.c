@@ -46,7 +46,7 @@
 /**
  * Encodes into bytes from the lighting-command structure
  *
- * @param apdu - buffer to hold the bytes
+ * @param apdu - buffer to hold the bytes, or NULL to only compute the length
  * @param value - lighting command value to encode
  *
  * @return  number of bytes encoded, or 0 if unable to encode.
@@ -58,37 +58,37 @@ int lighting_command_encode(
     int apdu_len = 0;   /* total length of the apdu, return value */
     int len = 0;        /* total length of the apdu, return value */
 
-    if (apdu) {
-        len = encode_context_enumerated(&apdu[apdu_len], 0,
+    if (data) {
+        len = encode_context_enumerated(apdu, 0,
             data->operation);
         apdu_len += len;
         /* optional target-level */
         if (data->use_target_level) {
-            len = encode_context_real(&apdu[apdu_len], 1,
+            len = encode_context_real(apdu ? &apdu[apdu_len] : NULL, 1,
                 data->target_level);
             apdu_len += len;
         }
         /* optional ramp-rate */
         if (data->use_ramp_rate) {
-            len = encode_context_real(&apdu[apdu_len], 2,
+            len = encode_context_real(apdu ? &apdu[apdu_len] : NULL, 2,
                 data->ramp_rate);
             apdu_len += len;
         }
         /* optional step increment */
         if (data->use_step_increment) {
-            len = encode_context_real(&apdu[apdu_len], 3,
+            len = encode_context_real(apdu ? &apdu[apdu_len] : NULL, 3,
                 data->step_increment);
             apdu_len += len;
         }
         /* optional fade time */
         if (data->use_fade_time) {
-            len = encode_context_unsigned(&apdu[apdu_len], 4,
+            len = encode_context_unsigned(apdu ? &apdu[apdu_len] : NULL, 4,
                 data->fade_time);
             apdu_len += len;
         }
         /* optional priority */
         if (data->use_priority) {
-            len = encode_context_unsigned(&apdu[apdu_len], 5,
+            len = encode_context_unsigned(apdu ? &apdu[apdu_len] : NULL, 5,
                 data->priority);
             apdu_len += len;
         }
@@ -573,6 +573,8 @@ void testNPDU1(
 }
 
 #ifdef TEST_NPDU
+#include "tsm.h"
+
 /* dummy stub for testing */
 void tsm_free_invoke_id(
     uint8_t invokeID)
@@ -580,6 +582,16 @@ void tsm_free_invoke_id(
     (void) invokeID;
 }
 
+bool tsm_complete(
+    uint8_t invokeID,
+    BACNET_TSM_REPLY * reply)
+{
+    (void) invokeID;
+    (void) reply;
+
+    return false;
+}
+
 void iam_handler(
     uint8_t * service_request,
     uint16_t service_len,
@@ -35,6 +35,7 @@
 #include "bacenum.h"
 #include "bacdcode.h"
 #include "bacdef.h"
+#include "bacapp.h"
 #include "readrange.h"
 
 /** @file readrange.c  Encode/Decode ReadRange requests */
@@ -354,61 +355,80 @@ int rr_ack_encode_apdu(
  * Decode the received ReadRange response                                    *
  *****************************************************************************/
 
-int rr_ack_decode_service_request(
+/* decode the part of the ReadRange response before the itemData */
+static int rr_ack_decode_header(
     uint8_t * apdu,
-    int apdu_len,       /* total length of the apdu */
+    unsigned apdu_len,
     BACNET_READ_RANGE_DATA * rrdata)
 {
-    uint8_t tag_number = 0;
-    uint32_t len_value_type = 0;
-    int tag_len = 0;    /* length of tag decode */
-    int len = 0;        /* total length of decodes */
-    int start_len;
+    BACNET_TAG_HEADER tag;
+    int decode_len = 0; /* length of each decode */
+    unsigned len = 0;   /* total length of decodes */
     uint16_t object = 0;        /* object type */
     uint32_t property = 0;      /* for decoding */
     uint32_t array_value = 0;   /* for decoding */
 
-    /* FIXME: check apdu_len against the len during decode   */
     /* Tag 0: Object ID */
-    if (!decode_is_context_tag(&apdu[0], 0))
+    decode_len =
+        decode_context_object_id_safe(&apdu[len], apdu_len - len, 0, &object,
+        &rrdata->object_instance);
+    if (decode_len <= 0)
         return -1;
-    len = 1;
-    len += decode_object_id(&apdu[len], &object, &rrdata->object_instance);
+    len += decode_len;
     rrdata->object_type = (BACNET_OBJECT_TYPE) object;
-
     /* Tag 1: Property ID */
-    len +=
-        decode_tag_number_and_value(&apdu[len], &tag_number, &len_value_type);
-    if (tag_number != 1)
+    decode_len =
+        decode_context_enumerated_safe(&apdu[len], apdu_len - len, 1,
+        &property);
+    if (decode_len <= 0)
         return -1;
-    len += decode_enumerated(&apdu[len], len_value_type, &property);
+    len += decode_len;
     rrdata->object_property = (BACNET_PROPERTY_ID) property;
-
     /* Tag 2: Optional Array Index */
-    tag_len =
-        decode_tag_number_and_value(&apdu[len], &tag_number, &len_value_type);
-    if (tag_number == 2) {
-        len += tag_len;
-        len += decode_unsigned(&apdu[len], len_value_type, &array_value);
+    decode_len =
+        decode_context_unsigned_safe(&apdu[len], apdu_len - len, 2,
+        &array_value);
+    if (decode_len < 0)
+        return -1;
+    if (decode_len > 0) {
+        len += decode_len;
         rrdata->array_index = array_value;
     } else
         rrdata->array_index = BACNET_ARRAY_ALL;
-
     /* Tag 3: Result Flags */
+    decode_len = decode_tag_header(&apdu[len], apdu_len - len, &tag);
+    if ((decode_len <= 0) || !tag.context || (tag.number != 3) ||
+        (tag.len_value_type > (apdu_len - len - decode_len)))
+        return -1;
+    len += decode_len;
     len +=
-        decode_tag_number_and_value(&apdu[len], &tag_number, &len_value_type);
-    if (tag_number != 3)
+        decode_bitstring(&apdu[len], tag.len_value_type, &rrdata->ResultFlags);
+    /* Tag 4: Item count */
+    decode_len =
+        decode_context_unsigned_safe(&apdu[len], apdu_len - len, 4,
+        &rrdata->ItemCount);
+    if (decode_len <= 0)
         return -1;
+    len += decode_len;
 
-    len += decode_bitstring(&apdu[len], len_value_type, &rrdata->ResultFlags);
+    return (int) len;
+}
 
-    /* Tag 4: Item count */
-    len +=
-        decode_tag_number_and_value(&apdu[len], &tag_number, &len_value_type);
-    if (tag_number != 4)
-        return -1;
+int rr_ack_decode_service_request(
+    uint8_t * apdu,
+    int apdu_len,       /* total length of the apdu */
+    BACNET_READ_RANGE_DATA * rrdata)
+{
+    uint8_t tag_number = 0;
+    uint32_t len_value_type = 0;
+    int len = 0;        /* total length of decodes */
+    int start_len;
 
-    len += decode_unsigned(&apdu[len], len_value_type, &rrdata->ItemCount);
+    if (apdu_len <= 0)
+        return -1;
+    len = rr_ack_decode_header(apdu, (unsigned) apdu_len, rrdata);
+    if ((len < 0) || (len >= apdu_len))
+        return -1;
 
     if (decode_is_opening_tag_number(&apdu[len], 5)) {
         len++;  /* a tag number of 5 is not extended so only one octet */
@@ -452,4 +472,87 @@ int rr_ack_decode_service_request(
     return len;
 }
 
+/** Walk a ReadRange response once, handing each element of the itemData
+ * to the visitor as a view into apdu.  rrdata is filled in as for
+ * rr_ack_decode_service_request(); on_header() sees everything except
+ * the firstSequenceNumber, which follows the itemData.
+ *
+ * @param apdu [in] The ReadRange-ACK service request.
+ * @param apdu_len [in] Length of the service request.
+ * @param visitor [in] The callbacks and their context.
+ * @param rrdata [out] The decoded header.
+ * @return The number of octets decoded, BACNET_STATUS_ERROR if the
+ *   response is malformed, or BACNET_STATUS_ABORT if a callback stopped
+ *   the walk.
+ */
+int rr_ack_decode_visit(
+    uint8_t * apdu,
+    unsigned apdu_len,
+    BACNET_READ_RANGE_ACK_VISITOR * visitor,
+    BACNET_READ_RANGE_DATA * rrdata)
+{
+    uint8_t tag_number = 0;
+    uint32_t len_value_type = 0;
+    int tag_len = 0;
+    int len = 0;
+    unsigned offset = 0;
+    BACNET_APPLICATION_DATA_VIEW value;
+
+    if (!apdu || !visitor || !rrdata || (apdu_len == 0)) {
+        return BACNET_STATUS_ERROR;
+    }
+    len = rr_ack_decode_header(apdu, apdu_len, rrdata);
+    if ((len < 0) || ((unsigned) len >= apdu_len)) {
+        return BACNET_STATUS_ERROR;
+    }
+    offset = len;
+    if (!decode_is_opening_tag_number(&apdu[offset], 5)) {
+        return BACNET_STATUS_ERROR;
+    }
+    offset++;
+    rrdata->application_data = &apdu[offset];
+    rrdata->application_data_len = 0;
+    rrdata->FirstSequence = 0;
+    if (visitor->on_header && !visitor->on_header(visitor->context, rrdata)) {
+        return BACNET_STATUS_ABORT;
+    }
+    for (;;) {
+        if (offset >= apdu_len) {
+            return BACNET_STATUS_ERROR;
+        }
+        if (decode_is_closing_tag_number(&apdu[offset], 5)) {
+            rrdata->application_data_len =
+                (int) (&apdu[offset] - rrdata->application_data);
+            offset++;
+            break;
+        }
+        len =
+            bacapp_decode_data_view(&apdu[offset], apdu_len - offset,
+            rrdata->object_property, &value);
+        if (len <= 0) {
+            return BACNET_STATUS_ERROR;
+        }
+        offset += len;
+        if (visitor->on_value && !visitor->on_value(visitor->context, &value)) {
+            return BACNET_STATUS_ABORT;
+        }
+    }
+    if (offset < apdu_len) {
+        /* Tag 6: firstSequenceNumber */
+        tag_len =
+            decode_tag_number_and_value_safe(&apdu[offset], apdu_len - offset,
+            &tag_number, &len_value_type);
+        if ((tag_len <= 0) || (tag_number != 6) ||
+            (len_value_type > (apdu_len - offset - tag_len))) {
+            return BACNET_STATUS_ERROR;
+        }
+        offset += tag_len;
+        offset +=
+            decode_unsigned(&apdu[offset], len_value_type,
+            &rrdata->FirstSequence);
+    }
+
+    return (int) offset;
+}
+
 /* FIXME: Currently does not have test framework */
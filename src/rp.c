@@ -91,8 +91,7 @@ int rp_decode_service_request(
     BACNET_READ_PROPERTY_DATA * rpdata)
 {
     unsigned len = 0;
-    uint8_t tag_number = 0;
-    uint32_t len_value_type = 0;
+    int decode_len = 0;
     uint16_t type = 0;  /* for decoding */
     uint32_t property = 0;      /* for decoding */
     uint32_t array_value = 0;   /* for decoding */
@@ -107,35 +106,36 @@ int rp_decode_service_request(
         }
 
         /* Tag 0: Object ID          */
-        if (!decode_is_context_tag(&apdu[len++], 0)) {
+        decode_len =
+            decode_context_object_id_safe(&apdu[len], apdu_len - len, 0,
+            &type, &rpdata->object_instance);
+        if (decode_len <= 0) {
             rpdata->error_code = ERROR_CODE_REJECT_INVALID_TAG;
             return BACNET_STATUS_REJECT;
         }
-        len += decode_object_id(&apdu[len], &type, &rpdata->object_instance);
+        len += decode_len;
         rpdata->object_type = (BACNET_OBJECT_TYPE) type;
         /* Tag 1: Property ID */
-        len +=
-            decode_tag_number_and_value(&apdu[len], &tag_number,
-            &len_value_type);
-        if (tag_number != 1) {
+        decode_len =
+            decode_context_enumerated_safe(&apdu[len], apdu_len - len, 1,
+            &property);
+        if (decode_len <= 0) {
             rpdata->error_code = ERROR_CODE_REJECT_INVALID_TAG;
             return BACNET_STATUS_REJECT;
         }
-        len += decode_enumerated(&apdu[len], len_value_type, &property);
+        len += decode_len;
         rpdata->object_property = (BACNET_PROPERTY_ID) property;
         /* Tag 2: Optional Array Index */
         if (len < apdu_len) {
-            len +=
-                decode_tag_number_and_value(&apdu[len], &tag_number,
-                &len_value_type);
-            if ((tag_number == 2) && (len < apdu_len)) {
-                len +=
-                    decode_unsigned(&apdu[len], len_value_type, &array_value);
-                rpdata->array_index = array_value;
-            } else {
+            decode_len =
+                decode_context_unsigned_safe(&apdu[len], apdu_len - len, 2,
+                &array_value);
+            if (decode_len <= 0) {
                 rpdata->error_code = ERROR_CODE_REJECT_INVALID_TAG;
                 return BACNET_STATUS_REJECT;
             }
+            len += decode_len;
+            rpdata->array_index = array_value;
         } else
             rpdata->array_index = BACNET_ARRAY_ALL;
     }
@@ -195,9 +195,8 @@ int rp_ack_encode_apdu_object_property_end(
 {
     int apdu_len = 0;   /* total length of the apdu, return value */
 
-    if (apdu) {
-        apdu_len = encode_closing_tag(&apdu[0], 3);
-    }
+    /* a NULL apdu returns the length only */
+    apdu_len = encode_closing_tag(apdu, 3);
 
     return apdu_len;
 }
@@ -241,39 +240,41 @@ int rp_ack_decode_service_request(
     int apdu_len,       /* total length of the apdu */
     BACNET_READ_PROPERTY_DATA * rpdata)
 {
-    uint8_t tag_number = 0;
-    uint32_t len_value_type = 0;
-    int tag_len = 0;    /* length of tag decode */
+    int decode_len = 0; /* length of each decode */
     int len = 0;        /* total length of decodes */
     uint16_t object = 0;        /* object type */
     uint32_t property = 0;      /* for decoding */
     uint32_t array_value = 0;   /* for decoding */
 
-    /* FIXME: check apdu_len against the len during decode   */
     /* Tag 0: Object ID */
-    if (!decode_is_context_tag(&apdu[0], 0))
+    decode_len =
+        decode_context_object_id_safe(&apdu[0], apdu_len, 0, &object,
+        &rpdata->object_instance);
+    if (decode_len <= 0)
         return -1;
-    len = 1;
-    len += decode_object_id(&apdu[len], &object, &rpdata->object_instance);
+    len = decode_len;
     rpdata->object_type = (BACNET_OBJECT_TYPE) object;
     /* Tag 1: Property ID */
-    len +=
-        decode_tag_number_and_value(&apdu[len], &tag_number, &len_value_type);
-    if (tag_number != 1)
+    decode_len =
+        decode_context_enumerated_safe(&apdu[len], apdu_len - len, 1,
+        &property);
+    if (decode_len <= 0)
         return -1;
-    len += decode_enumerated(&apdu[len], len_value_type, &property);
+    len += decode_len;
     rpdata->object_property = (BACNET_PROPERTY_ID) property;
     /* Tag 2: Optional Array Index */
-    tag_len =
-        decode_tag_number_and_value(&apdu[len], &tag_number, &len_value_type);
-    if (tag_number == 2) {
-        len += tag_len;
-        len += decode_unsigned(&apdu[len], len_value_type, &array_value);
+    decode_len =
+        decode_context_unsigned_safe(&apdu[len], apdu_len - len, 2,
+        &array_value);
+    if (decode_len < 0)
+        return -1;
+    if (decode_len > 0) {
+        len += decode_len;
         rpdata->array_index = array_value;
     } else
         rpdata->array_index = BACNET_ARRAY_ALL;
     /* Tag 3: opening context tag */
-    if (decode_is_opening_tag_number(&apdu[len], 3)) {
+    if ((len < apdu_len) && decode_is_opening_tag_number(&apdu[len], 3)) {
         /* a tag number of 3 is not extended so only one octet */
         len++;
         /* don't decode the application tag number or its data here */
@@ -211,6 +211,7 @@ int rpm_decode_object_id(
     BACNET_RPM_DATA * rpmdata)
 {
     unsigned len = 0;
+    int decode_len = 0;
     uint16_t type = 0;  /* for decoding */
 
     /* check for value pointers */
@@ -220,14 +221,18 @@ int rpm_decode_object_id(
             return BACNET_STATUS_REJECT;
         }
         /* Tag 0: Object ID */
-        if (!decode_is_context_tag(&apdu[len++], 0)) {
+        decode_len =
+            decode_context_object_id_safe(&apdu[len], apdu_len - len, 0,
+            &type, &rpmdata->object_instance);
+        if (decode_len <= 0) {
             rpmdata->error_code = ERROR_CODE_REJECT_INVALID_TAG;
             return BACNET_STATUS_REJECT;
         }
-        len += decode_object_id(&apdu[len], &type, &rpmdata->object_instance);
+        len += decode_len;
         rpmdata->object_type = (BACNET_OBJECT_TYPE) type;
         /* Tag 1: sequence of ReadAccessSpecification */
-        if (!decode_is_opening_tag_number(&apdu[len], 1)) {
+        if ((len >= apdu_len) ||
+            !decode_is_opening_tag_number(&apdu[len], 1)) {
             rpmdata->error_code = ERROR_CODE_REJECT_INVALID_TAG;
             return BACNET_STATUS_REJECT;
         }
@@ -265,53 +270,42 @@ int rpm_decode_object_property(
     BACNET_RPM_DATA * rpmdata)
 {
     unsigned len = 0;
-    unsigned option_len = 0;
-    uint8_t tag_number = 0;
-    uint32_t len_value_type = 0;
+    int decode_len = 0;
     uint32_t property = 0;      /* for decoding */
     uint32_t array_value = 0;   /* for decoding */
 
     /* check for valid pointers */
     if (apdu && apdu_len && rpmdata) {
         /* Tag 0: propertyIdentifier */
-        if (!IS_CONTEXT_SPECIFIC(apdu[len])) {
-            rpmdata->error_code = ERROR_CODE_REJECT_INVALID_TAG;
-            return BACNET_STATUS_REJECT;
-        }
-
-        len +=
-            decode_tag_number_and_value(&apdu[len], &tag_number,
-            &len_value_type);
-        if (tag_number != 0) {
+        decode_len =
+            decode_context_enumerated_safe(&apdu[len], apdu_len - len, 0,
+            &property);
+        if (decode_len == 0) {
             rpmdata->error_code = ERROR_CODE_REJECT_INVALID_TAG;
             return BACNET_STATUS_REJECT;
         }
+        len += decode_len;
         /* Should be at least the unsigned value + 1 tag left */
-        if ((len + len_value_type) >= apdu_len) {
+        if ((decode_len < 0) || (len >= apdu_len)) {
             rpmdata->error_code = ERROR_CODE_REJECT_MISSING_REQUIRED_PARAMETER;
             return BACNET_STATUS_REJECT;
         }
-        len += decode_enumerated(&apdu[len], len_value_type, &property);
         rpmdata->object_property = (BACNET_PROPERTY_ID) property;
         /* Assume most probable outcome */
         rpmdata->array_index = BACNET_ARRAY_ALL;
         /* Tag 1: Optional propertyArrayIndex */
-        if (IS_CONTEXT_SPECIFIC(apdu[len]) && !IS_CLOSING_TAG(apdu[len])) {
-            option_len =
-                (unsigned) decode_tag_number_and_value(&apdu[len], &tag_number,
-                &len_value_type);
-            if (tag_number == 1) {
-                len += option_len;
-                /* Should be at least the unsigned array index + 1 tag left */
-                if ((len + len_value_type) >= apdu_len) {
-                    rpmdata->error_code =
-                        ERROR_CODE_REJECT_MISSING_REQUIRED_PARAMETER;
-                    return BACNET_STATUS_REJECT;
-                }
-                len +=
-                    decode_unsigned(&apdu[len], len_value_type, &array_value);
-                rpmdata->array_index = array_value;
+        decode_len =
+            decode_context_unsigned_safe(&apdu[len], apdu_len - len, 1,
+            &array_value);
+        if (decode_len != 0) {
+            len += decode_len;
+            /* Should be at least the unsigned array index + 1 tag left */
+            if ((decode_len < 0) || (len >= apdu_len)) {
+                rpmdata->error_code =
+                    ERROR_CODE_REJECT_MISSING_REQUIRED_PARAMETER;
+                return BACNET_STATUS_REJECT;
             }
+            rpmdata->array_index = array_value;
         }
     }
 
@@ -340,14 +334,12 @@ int rpm_ack_encode_apdu_object_begin(
 {
     int apdu_len = 0;   /* total length of the apdu, return value */
 
-    if (apdu) {
-        /* Tag 0: objectIdentifier */
-        apdu_len =
-            encode_context_object_id(&apdu[0], 0, rpmdata->object_type,
-            rpmdata->object_instance);
-        /* Tag 1: listOfResults */
-        apdu_len += encode_opening_tag(&apdu[apdu_len], 1);
-    }
+    /* Tag 0: objectIdentifier */
+    apdu_len =
+        encode_context_object_id(apdu, 0, rpmdata->object_type,
+        rpmdata->object_instance);
+    /* Tag 1: listOfResults */
+    apdu_len += encode_opening_tag(apdu ? &apdu[apdu_len] : NULL, 1);
 
     return apdu_len;
 }
@@ -359,14 +351,13 @@ int rpm_ack_encode_apdu_object_property(
 {
     int apdu_len = 0;   /* total length of the apdu, return value */
 
-    if (apdu) {
-        /* Tag 2: propertyIdentifier */
-        apdu_len = encode_context_enumerated(&apdu[0], 2, object_property);
-        /* Tag 3: optional propertyArrayIndex */
-        if (array_index != BACNET_ARRAY_ALL)
-            apdu_len +=
-                encode_context_unsigned(&apdu[apdu_len], 3, array_index);
-    }
+    /* Tag 2: propertyIdentifier */
+    apdu_len = encode_context_enumerated(apdu, 2, object_property);
+    /* Tag 3: optional propertyArrayIndex */
+    if (array_index != BACNET_ARRAY_ALL)
+        apdu_len +=
+            encode_context_unsigned(apdu ? &apdu[apdu_len] : NULL, 3,
+            array_index);
 
     return apdu_len;
 }
@@ -379,7 +370,11 @@ int rpm_ack_encode_apdu_object_property_value(
     int apdu_len = 0;   /* total length of the apdu, return value */
     unsigned len = 0;
 
-    if (apdu) {
+    if (!apdu) {
+        /* length only */
+        apdu_len = encode_opening_tag(NULL, 4) + (int) application_data_len;
+        apdu_len += encode_closing_tag(NULL, 4);
+    } else {
         /* Tag 4: propertyValue */
         apdu_len += encode_opening_tag(&apdu[apdu_len], 4);
         if (application_data == &apdu[apdu_len]) {      /* Is Data already in place? */
@@ -402,14 +397,15 @@ int rpm_ack_encode_apdu_object_property_error(
 {
     int apdu_len = 0;   /* total length of the apdu, return value */
 
-    if (apdu) {
-        /* Tag 5: propertyAccessError */
-        apdu_len += encode_opening_tag(&apdu[apdu_len], 5);
-        apdu_len +=
-            encode_application_enumerated(&apdu[apdu_len], error_class);
-        apdu_len += encode_application_enumerated(&apdu[apdu_len], error_code);
-        apdu_len += encode_closing_tag(&apdu[apdu_len], 5);
-    }
+    /* Tag 5: propertyAccessError */
+    apdu_len += encode_opening_tag(apdu, 5);
+    apdu_len +=
+        encode_application_enumerated(apdu ? &apdu[apdu_len] : NULL,
+        error_class);
+    apdu_len +=
+        encode_application_enumerated(apdu ? &apdu[apdu_len] : NULL,
+        error_code);
+    apdu_len += encode_closing_tag(apdu ? &apdu[apdu_len] : NULL, 5);
 
     return apdu_len;
 }
@@ -419,9 +415,7 @@ int rpm_ack_encode_apdu_object_end(
 {
     int apdu_len = 0;   /* total length of the apdu, return value */
 
-    if (apdu) {
-        apdu_len = encode_closing_tag(&apdu[0], 1);
-    }
+    apdu_len = encode_closing_tag(apdu, 1);
 
     return apdu_len;
 }
@@ -436,18 +430,21 @@ int rpm_ack_decode_object_id(
     uint32_t * object_instance)
 {
     unsigned len = 0;
+    int decode_len = 0;
     uint16_t type = 0;  /* for decoding */
 
     /* check for value pointers */
     if (apdu && apdu_len && object_type && object_instance) {
         /* Tag 0: objectIdentifier */
-        if (!decode_is_context_tag(&apdu[len++], 0))
+        decode_len =
+            decode_context_object_id_safe(&apdu[len], apdu_len - len, 0,
+            &type, object_instance);
+        if (decode_len <= 0)
             return -1;
-        len += decode_object_id(&apdu[len], &type, object_instance);
-        if (object_type)
-            *object_type = (BACNET_OBJECT_TYPE) type;
+        len += decode_len;
+        *object_type = (BACNET_OBJECT_TYPE) type;
         /* Tag 1: listOfResults */
-        if (!decode_is_opening_tag_number(&apdu[len], 1))
+        if ((len >= apdu_len) || !decode_is_opening_tag_number(&apdu[len], 1))
             return -1;
         len++;  /* opening tag is only one octet */
     }
@@ -477,47 +474,195 @@ int rpm_ack_decode_object_property(
     uint32_t * array_index)
 {
     unsigned len = 0;
-    unsigned tag_len = 0;
-    uint8_t tag_number = 0;
-    uint32_t len_value_type = 0;
+    int decode_len = 0;
     uint32_t property = 0;      /* for decoding */
     uint32_t array_value = 0;   /* for decoding */
 
     /* check for valid pointers */
     if (apdu && apdu_len && object_property && array_index) {
         /* Tag 2: propertyIdentifier */
-        if (!IS_CONTEXT_SPECIFIC(apdu[len]))
-            return -1;
-        len +=
-            decode_tag_number_and_value(&apdu[len], &tag_number,
-            &len_value_type);
-        if (tag_number != 2)
+        decode_len =
+            decode_context_enumerated_safe(&apdu[len], apdu_len - len, 2,
+            &property);
+        if (decode_len <= 0)
             return -1;
-        len += decode_enumerated(&apdu[len], len_value_type, &property);
-        if (object_property)
-            *object_property = (BACNET_PROPERTY_ID) property;
+        len += decode_len;
+        *object_property = (BACNET_PROPERTY_ID) property;
         /* Tag 3: Optional propertyArrayIndex */
-        if ((len < apdu_len) && IS_CONTEXT_SPECIFIC(apdu[len]) &&
-            (!IS_CLOSING_TAG(apdu[len]))) {
-            tag_len =
-                (unsigned) decode_tag_number_and_value(&apdu[len], &tag_number,
-                &len_value_type);
-            if (tag_number == 3) {
-                len += tag_len;
-                len +=
-                    decode_unsigned(&apdu[len], len_value_type, &array_value);
+        *array_index = BACNET_ARRAY_ALL;
+        if (len < apdu_len) {
+            decode_len =
+                decode_context_unsigned_safe(&apdu[len], apdu_len - len, 3,
+                &array_value);
+            if (decode_len < 0)
+                return -1;
+            if (decode_len > 0) {
+                len += decode_len;
                 *array_index = array_value;
-            } else {
-                *array_index = BACNET_ARRAY_ALL;
             }
+        }
+    }
+
+    return (int) len;
+}
+
+/* decode the errorClass and errorCode of a propertyAccessError */
+static int rpm_ack_decode_error(
+    uint8_t * apdu,
+    unsigned apdu_len,
+    BACNET_ERROR_CLASS * error_class,
+    BACNET_ERROR_CODE * error_code)
+{
+    unsigned len = 0;
+    int tag_len = 0;
+    uint8_t tag_number = 0;
+    uint32_t len_value_type = 0;
+    uint32_t error_value = 0;
+    unsigned i = 0;
+
+    for (i = 0; i < 2; i++) {
+        tag_len =
+            decode_tag_number_and_value_safe(&apdu[len], apdu_len - len,
+            &tag_number, &len_value_type);
+        if ((tag_len <= 0) || IS_CONTEXT_SPECIFIC(apdu[len]) ||
+            (tag_number != BACNET_APPLICATION_TAG_ENUMERATED) ||
+            (len_value_type > (apdu_len - len - tag_len))) {
+            return BACNET_STATUS_ERROR;
+        }
+        len += tag_len;
+        len += decode_enumerated(&apdu[len], len_value_type, &error_value);
+        if (i == 0) {
+            *error_class = (BACNET_ERROR_CLASS) error_value;
         } else {
-            *array_index = BACNET_ARRAY_ALL;
+            *error_code = (BACNET_ERROR_CODE) error_value;
         }
     }
 
     return (int) len;
 }
 
+/** Walk an RPM-ACK service request once, handing each object, property,
+ * value and error to the visitor as it is decoded.  Nothing is allocated
+ * and nothing is copied: the values are views into apdu.
+ *
+ * @param apdu [in] The RPM-ACK service request.
+ * @param apdu_len [in] Length of the service request.
+ * @param visitor [in] The callbacks and their context.
+ * @return The number of octets decoded, BACNET_STATUS_ERROR if the
+ *   request is malformed, or BACNET_STATUS_ABORT if a callback stopped
+ *   the walk.
+ */
+int rpm_ack_decode_visit(
+    uint8_t * apdu,
+    unsigned apdu_len,
+    BACNET_RPM_ACK_VISITOR * visitor)
+{
+    unsigned offset = 0;
+    int len = 0;
+    BACNET_OBJECT_TYPE object_type = OBJECT_DEVICE;
+    uint32_t object_instance = 0;
+    BACNET_PROPERTY_ID object_property = PROP_ALL;
+    uint32_t array_index = BACNET_ARRAY_ALL;
+    BACNET_ERROR_CLASS error_class = ERROR_CLASS_SERVICES;
+    BACNET_ERROR_CODE error_code = ERROR_CODE_OTHER;
+    BACNET_APPLICATION_DATA_VIEW value;
+
+    if (!apdu || !visitor) {
+        return BACNET_STATUS_ERROR;
+    }
+    while (offset < apdu_len) {
+        /* [0] objectIdentifier and the [1] opening tag take 6 octets */
+        if ((apdu_len - offset) < 6) {
+            return BACNET_STATUS_ERROR;
+        }
+        len =
+            rpm_ack_decode_object_id(&apdu[offset], apdu_len - offset,
+            &object_type, &object_instance);
+        if (len <= 0) {
+            return BACNET_STATUS_ERROR;
+        }
+        offset += len;
+        if (visitor->on_object &&
+            !visitor->on_object(visitor->context, object_type,
+                object_instance)) {
+            return BACNET_STATUS_ABORT;
+        }
+        for (;;) {
+            if (offset >= apdu_len) {
+                /* missing the end of the listOfResults */
+                return BACNET_STATUS_ERROR;
+            }
+            if (decode_is_closing_tag_number(&apdu[offset], 1)) {
+                offset++;
+                break;
+            }
+            len =
+                rpm_ack_decode_object_property(&apdu[offset],
+                apdu_len - offset, &object_property, &array_index);
+            if (len <= 0) {
+                return BACNET_STATUS_ERROR;
+            }
+            offset += len;
+            if (offset >= apdu_len) {
+                return BACNET_STATUS_ERROR;
+            }
+            if (visitor->on_property &&
+                !visitor->on_property(visitor->context, object_property,
+                    array_index)) {
+                return BACNET_STATUS_ABORT;
+            }
+            if (decode_is_opening_tag_number(&apdu[offset], 4)) {
+                /* propertyValue */
+                offset++;
+                for (;;) {
+                    if (offset >= apdu_len) {
+                        return BACNET_STATUS_ERROR;
+                    }
+                    if (decode_is_closing_tag_number(&apdu[offset], 4)) {
+                        offset++;
+                        break;
+                    }
+                    len =
+                        bacapp_decode_data_view(&apdu[offset],
+                        apdu_len - offset, object_property, &value);
+                    if (len <= 0) {
+                        return BACNET_STATUS_ERROR;
+                    }
+                    offset += len;
+                    if (visitor->on_value &&
+                        !visitor->on_value(visitor->context, &value)) {
+                        return BACNET_STATUS_ABORT;
+                    }
+                }
+            } else if (decode_is_opening_tag_number(&apdu[offset], 5)) {
+                /* propertyAccessError */
+                offset++;
+                len =
+                    rpm_ack_decode_error(&apdu[offset], apdu_len - offset,
+                    &error_class, &error_code);
+                if (len <= 0) {
+                    return BACNET_STATUS_ERROR;
+                }
+                offset += len;
+                if ((offset >= apdu_len) ||
+                    !decode_is_closing_tag_number(&apdu[offset], 5)) {
+                    return BACNET_STATUS_ERROR;
+                }
+                offset++;
+                if (visitor->on_error &&
+                    !visitor->on_error(visitor->context, error_class,
+                        error_code)) {
+                    return BACNET_STATUS_ABORT;
+                }
+            } else {
+                return BACNET_STATUS_ERROR;
+            }
+        }
+    }
+
+    return (int) offset;
+}
+
 #endif
 
 #ifdef TEST
@@ -942,6 +1087,170 @@ void testReadPropertyMultipleAck(
     ct_test(pTest, len == service_request_len);
 }
 
+struct rpm_visit_test_context {
+    unsigned objects;
+    unsigned properties;
+    unsigned values;
+    unsigned errors;
+    unsigned stop_after_values;
+    uint32_t last_instance;
+    BACNET_PROPERTY_ID last_property;
+    BACNET_ERROR_CODE last_error_code;
+    float real_value;
+};
+
+static bool rpm_visit_test_object(
+    void *context,
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    struct rpm_visit_test_context *test = context;
+
+    (void) object_type;
+    test->objects++;
+    test->last_instance = object_instance;
+
+    return true;
+}
+
+static bool rpm_visit_test_property(
+    void *context,
+    BACNET_PROPERTY_ID object_property,
+    uint32_t array_index)
+{
+    struct rpm_visit_test_context *test = context;
+
+    (void) array_index;
+    test->properties++;
+    test->last_property = object_property;
+
+    return true;
+}
+
+static bool rpm_visit_test_value(
+    void *context,
+    BACNET_APPLICATION_DATA_VIEW * value)
+{
+    struct rpm_visit_test_context *test = context;
+
+    test->values++;
+    if (value->tag == BACNET_APPLICATION_TAG_REAL) {
+        test->real_value = value->type.Real;
+    }
+
+    return (test->values != test->stop_after_values);
+}
+
+static bool rpm_visit_test_error(
+    void *context,
+    BACNET_ERROR_CLASS error_class,
+    BACNET_ERROR_CODE error_code)
+{
+    struct rpm_visit_test_context *test = context;
+
+    (void) error_class;
+    test->errors++;
+    test->last_error_code = error_code;
+
+    return true;
+}
+
+void testReadPropertyMultipleAckVisitor(
+    Test * pTest)
+{
+    uint8_t apdu[480] = { 0 };
+    uint8_t value_buffer[MAX_APDU] = { 0 };
+    int value_len = 0;
+    int apdu_len = 0;
+    int len = 0;
+    unsigned i = 0;
+    BACNET_RPM_DATA rpmdata;
+    BACNET_RPM_ACK_VISITOR visitor = { 0 };
+    struct rpm_visit_test_context test = { 0 };
+
+    /* service request only - no APDU header */
+    rpmdata.object_type = OBJECT_DEVICE;
+    rpmdata.object_instance = 123;
+    apdu_len += rpm_ack_encode_apdu_object_begin(&apdu[apdu_len], &rpmdata);
+    /* an array of three values */
+    apdu_len +=
+        rpm_ack_encode_apdu_object_property(&apdu[apdu_len], PROP_OBJECT_LIST,
+        BACNET_ARRAY_ALL);
+    value_len = 0;
+    for (i = 0; i < 3; i++) {
+        value_len +=
+            encode_application_object_id(&value_buffer[value_len],
+            OBJECT_ANALOG_INPUT, i);
+    }
+    apdu_len +=
+        rpm_ack_encode_apdu_object_property_value(&apdu[apdu_len],
+        &value_buffer[0], value_len);
+    /* an empty list */
+    apdu_len +=
+        rpm_ack_encode_apdu_object_property(&apdu[apdu_len],
+        PROP_TIME_SYNCHRONIZATION_RECIPIENTS, BACNET_ARRAY_ALL);
+    apdu_len +=
+        rpm_ack_encode_apdu_object_property_value(&apdu[apdu_len],
+        &value_buffer[0], 0);
+    /* an error */
+    apdu_len +=
+        rpm_ack_encode_apdu_object_property(&apdu[apdu_len], PROP_DEADBAND,
+        BACNET_ARRAY_ALL);
+    apdu_len +=
+        rpm_ack_encode_apdu_object_property_error(&apdu[apdu_len],
+        ERROR_CLASS_PROPERTY, ERROR_CODE_UNKNOWN_PROPERTY);
+    apdu_len += rpm_ack_encode_apdu_object_end(&apdu[apdu_len]);
+    rpmdata.object_type = OBJECT_ANALOG_INPUT;
+    rpmdata.object_instance = 33;
+    apdu_len += rpm_ack_encode_apdu_object_begin(&apdu[apdu_len], &rpmdata);
+    apdu_len +=
+        rpm_ack_encode_apdu_object_property(&apdu[apdu_len],
+        PROP_PRESENT_VALUE, BACNET_ARRAY_ALL);
+    value_len = encode_application_real(&value_buffer[0], 42.5);
+    apdu_len +=
+        rpm_ack_encode_apdu_object_property_value(&apdu[apdu_len],
+        &value_buffer[0], value_len);
+    apdu_len += rpm_ack_encode_apdu_object_end(&apdu[apdu_len]);
+
+    visitor.on_object = rpm_visit_test_object;
+    visitor.on_property = rpm_visit_test_property;
+    visitor.on_value = rpm_visit_test_value;
+    visitor.on_error = rpm_visit_test_error;
+    visitor.context = &test;
+    len = rpm_ack_decode_visit(&apdu[0], apdu_len, &visitor);
+    ct_test(pTest, len == apdu_len);
+    ct_test(pTest, test.objects == 2);
+    ct_test(pTest, test.properties == 4);
+    ct_test(pTest, test.values == 4);
+    ct_test(pTest, test.errors == 1);
+    ct_test(pTest, test.last_error_code == ERROR_CODE_UNKNOWN_PROPERTY);
+    ct_test(pTest, test.last_instance == 33);
+    ct_test(pTest, test.last_property == PROP_PRESENT_VALUE);
+    ct_test(pTest, test.real_value == 42.5);
+    /* callbacks are optional */
+    memset(&visitor, 0, sizeof(visitor));
+    len = rpm_ack_decode_visit(&apdu[0], apdu_len, &visitor);
+    ct_test(pTest, len == apdu_len);
+    /* a callback can stop the walk */
+    memset(&test, 0, sizeof(test));
+    test.stop_after_values = 2;
+    visitor.on_value = rpm_visit_test_value;
+    visitor.context = &test;
+    len = rpm_ack_decode_visit(&apdu[0], apdu_len, &visitor);
+    ct_test(pTest, len == BACNET_STATUS_ABORT);
+    ct_test(pTest, test.values == 2);
+    /* truncated requests are malformed, wherever they are cut */
+    visitor.on_value = NULL;
+    for (i = 1; i < (unsigned) apdu_len; i++) {
+        len = rpm_ack_decode_visit(&apdu[0], i, &visitor);
+        if (len != BACNET_STATUS_ERROR) {
+            /* only the ends of the objects are valid places to stop */
+            ct_test(pTest, apdu[i - 1] == 0x1F);
+            ct_test(pTest, len == (int) i);
+        }
+    }
+}
+
 #ifdef TEST_READ_PROPERTY_MULTIPLE
 int main(
     void)
@@ -955,6 +1264,8 @@ int main(
     assert(rc);
     rc = ct_addTestFunction(pTest, testReadPropertyMultipleAck);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testReadPropertyMultipleAckVisitor);
+    assert(rc);
 
     ct_setStream(pTest, stdout);
     ct_run(pTest);
@@ -35,6 +35,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 #include "bits.h"
 #include "apdu.h"
 #include "bacdef.h"
@@ -173,6 +174,8 @@ uint8_t tsm_next_free_invokeID(
                     TSM_List[index].InvokeID = invokeID = Current_Invoke_ID;
                     TSM_List[index].state = TSM_STATE_IDLE;
                     TSM_List[index].RequestTimer = apdu_timeout();
+                    TSM_List[index].Completion = NULL;
+                    TSM_List[index].Context = NULL;
                     /* update for the next call or check */
                     Current_Invoke_ID++;
                     /* skip zero - we treat that internally as invalid or no free */
@@ -264,6 +267,7 @@ void tsm_timer_milliseconds(
     uint16_t milliseconds)
 {
     unsigned i = 0;     /* counter */
+    BACNET_TSM_REPLY reply;
 
     for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
         if (TSM_List[i].state == TSM_STATE_AWAIT_CONFIRMATION) {
@@ -284,7 +288,12 @@ void tsm_timer_milliseconds(
                        and this indicates a failed message:
                        IDLE and a valid invoke id */
                     TSM_List[i].state = TSM_STATE_IDLE;
-                    if (TSM_List[i].InvokeID != 0) {
+                    if (TSM_List[i].Completion) {
+                        memset(&reply, 0, sizeof(reply));
+                        reply.result = TSM_RESULT_TIMEOUT;
+                        reply.service_choice = TSM_List[i].apdu[3];
+                        tsm_complete(TSM_List[i].InvokeID, &reply);
+                    } else if (TSM_List[i].InvokeID != 0) {
                         if (Timeout_Function) {
                             Timeout_Function(TSM_List[i].InvokeID);
                         }
@@ -295,6 +304,30 @@ void tsm_timer_milliseconds(
     }
 }
 
+/* milliseconds until tsm_timer_milliseconds() has a retry or timeout
+   to do, or zero when no transaction is waiting for a reply.
+   Lets an event loop sleep until then instead of polling. */
+uint16_t tsm_timer_next(
+    void)
+{
+    uint16_t milliseconds = 0;
+    unsigned i = 0;     /* counter */
+
+    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
+        if (TSM_List[i].state == TSM_STATE_AWAIT_CONFIRMATION) {
+            if (TSM_List[i].RequestTimer == 0) {
+                return 1;
+            }
+            if ((milliseconds == 0) ||
+                (TSM_List[i].RequestTimer < milliseconds)) {
+                milliseconds = TSM_List[i].RequestTimer;
+            }
+        }
+    }
+
+    return milliseconds;
+}
+
 /* frees the invokeID and sets its state to IDLE */
 void tsm_free_invoke_id(
     uint8_t invokeID)
@@ -305,6 +338,8 @@ void tsm_free_invoke_id(
     if (index < MAX_TSM_TRANSACTIONS) {
         TSM_List[index].state = TSM_STATE_IDLE;
         TSM_List[index].InvokeID = 0;
+        TSM_List[index].Completion = NULL;
+        TSM_List[index].Context = NULL;
     }
 }
 
@@ -348,6 +383,74 @@ bool tsm_invoke_id_failed(
     return status;
 }
 
+/** Have the reply to a confirmed request, or its timeout, passed to
+ * a function of its own instead of the handlers set in apdu.c, so that
+ * an application does not need to match invoke IDs itself.
+ * Call this right after the request was sent.
+ * @param invokeID [in] The invokeID returned by the Send function.
+ * @param pFunction [in] Called once, when the request completes.
+ * @param context [in] Passed to pFunction.
+ * @return True if the request is waiting for its reply.
+ */
+bool tsm_set_completion(
+    uint8_t invokeID,
+    tsm_completion_function pFunction,
+    void *context)
+{
+    uint8_t index;
+
+    if (invokeID == 0) {
+        return false;
+    }
+    index = tsm_find_invokeID_index(invokeID);
+    if ((index < MAX_TSM_TRANSACTIONS) &&
+        (TSM_List[index].state == TSM_STATE_AWAIT_CONFIRMATION)) {
+        TSM_List[index].Completion = pFunction;
+        TSM_List[index].Context = context;
+        return true;
+    }
+
+    return false;
+}
+
+/** Complete a confirmed request that has a completion function.
+ * The invoke ID is freed before the completion function is called,
+ * so that it may send the next request right away.
+ * @param invokeID [in] The invokeID of the reply.
+ * @param reply [in] The reply; a src that does not match the address
+ *   of the request is ignored.
+ * @return True if the reply was given to a completion function, false
+ *   if the request has none and the reply is for the global handlers.
+ */
+bool tsm_complete(
+    uint8_t invokeID,
+    BACNET_TSM_REPLY * reply)
+{
+    tsm_completion_function completion = NULL;
+    void *context = NULL;
+    uint8_t index;
+
+    if (invokeID == 0) {
+        return false;
+    }
+    index = tsm_find_invokeID_index(invokeID);
+    if ((index >= MAX_TSM_TRANSACTIONS) ||
+        (TSM_List[index].Completion == NULL)) {
+        return false;
+    }
+    if (reply->src && !bacnet_address_same(&TSM_List[index].dest,
+            reply->src)) {
+        /* not from the device we asked; drop it */
+        return true;
+    }
+    completion = TSM_List[index].Completion;
+    context = TSM_List[index].Context;
+    reply->invoke_id = invokeID;
+    tsm_free_invoke_id(invokeID);
+    completion(reply, context);
+
+    return true;
+}
 
 #ifdef TEST
 #include <assert.h>
@@ -379,10 +482,136 @@ void datalink_get_broadcast_address(
     (void) dest;
 }
 
+void iam_handler(
+    uint8_t * service_request,
+    uint16_t service_len,
+    BACNET_ADDRESS * src)
+{
+    (void) service_request;
+    (void) service_len;
+    (void) src;
+}
+
+static BACNET_TSM_REPLY Test_Reply;
+static unsigned Test_Count;
+
+static void testCompletion(
+    BACNET_TSM_REPLY * reply,
+    void *context)
+{
+    memcpy(&Test_Reply, reply, sizeof(Test_Reply));
+    Test_Count += *(unsigned *) context;
+}
+
+/* start a ReadProperty request to dest */
+static uint8_t testRequest(
+    BACNET_ADDRESS * dest)
+{
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint8_t apdu[4] = { PDU_TYPE_CONFIRMED_SERVICE_REQUEST, 0x05, 0,
+        SERVICE_CONFIRMED_READ_PROPERTY
+    };
+    uint8_t invoke_id = 0;
+
+    invoke_id = tsm_next_free_invokeID();
+    apdu[2] = invoke_id;
+    tsm_set_confirmed_unsegmented_transaction(invoke_id, dest, &npdu_data,
+        apdu, sizeof(apdu));
+
+    return invoke_id;
+}
+
 void testTSM(
     Test * pTest)
 {
-    /* FIXME: add some unit testing... */
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_ADDRESS other = { 0 };
+    uint8_t apdu[8] = { 0 };
+    uint8_t invoke_id = 0;
+    unsigned context = 1;
+    unsigned i = 0;
+
+    dest.mac_len = 1;
+    dest.mac[0] = 1;
+    other.mac_len = 1;
+    other.mac[0] = 2;
+    /* a complex ACK goes to the completion function */
+    invoke_id = testRequest(&dest);
+    ct_test(pTest, invoke_id != 0);
+    ct_test(pTest, tsm_set_completion(invoke_id, testCompletion, &context));
+    apdu[0] = PDU_TYPE_COMPLEX_ACK;
+    apdu[1] = invoke_id;
+    apdu[2] = SERVICE_CONFIRMED_READ_PROPERTY;
+    apdu[3] = 0x55;
+    /* but not when it comes from another device */
+    apdu_handler(&other, apdu, 4);
+    ct_test(pTest, Test_Count == 0);
+    ct_test(pTest, !tsm_invoke_id_free(invoke_id));
+    apdu_handler(&dest, apdu, 4);
+    ct_test(pTest, Test_Count == 1);
+    ct_test(pTest, Test_Reply.result == TSM_RESULT_ACK);
+    ct_test(pTest, Test_Reply.invoke_id == invoke_id);
+    ct_test(pTest, Test_Reply.service_choice ==
+        SERVICE_CONFIRMED_READ_PROPERTY);
+    ct_test(pTest, Test_Reply.service_data_len == 1);
+    ct_test(pTest, Test_Reply.service_data[0] == 0x55);
+    ct_test(pTest, tsm_invoke_id_free(invoke_id));
+    /* a second reply finds nothing to complete */
+    apdu_handler(&dest, apdu, 4);
+    ct_test(pTest, Test_Count == 1);
+    /* an error is decoded */
+    invoke_id = testRequest(&dest);
+    ct_test(pTest, tsm_set_completion(invoke_id, testCompletion, &context));
+    apdu[0] = PDU_TYPE_ERROR;
+    apdu[1] = invoke_id;
+    apdu[2] = SERVICE_CONFIRMED_READ_PROPERTY;
+    apdu[3] = 0x91;
+    apdu[4] = ERROR_CLASS_PROPERTY;
+    apdu[5] = 0x91;
+    apdu[6] = ERROR_CODE_UNKNOWN_PROPERTY;
+    apdu_handler(&dest, apdu, 7);
+    ct_test(pTest, Test_Count == 2);
+    ct_test(pTest, Test_Reply.result == TSM_RESULT_ERROR);
+    ct_test(pTest, Test_Reply.error_class == ERROR_CLASS_PROPERTY);
+    ct_test(pTest, Test_Reply.error_code == ERROR_CODE_UNKNOWN_PROPERTY);
+    ct_test(pTest, tsm_invoke_id_free(invoke_id));
+    /* reject and abort carry their reason */
+    invoke_id = testRequest(&dest);
+    ct_test(pTest, tsm_set_completion(invoke_id, testCompletion, &context));
+    apdu[0] = PDU_TYPE_REJECT;
+    apdu[1] = invoke_id;
+    apdu[2] = REJECT_REASON_UNRECOGNIZED_SERVICE;
+    apdu_handler(&dest, apdu, 3);
+    ct_test(pTest, Test_Count == 3);
+    ct_test(pTest, Test_Reply.result == TSM_RESULT_REJECT);
+    ct_test(pTest, Test_Reply.reason == REJECT_REASON_UNRECOGNIZED_SERVICE);
+    invoke_id = testRequest(&dest);
+    ct_test(pTest, tsm_set_completion(invoke_id, testCompletion, &context));
+    apdu[0] = PDU_TYPE_ABORT | 1;
+    apdu[1] = invoke_id;
+    apdu[2] = ABORT_REASON_OTHER;
+    apdu_handler(&dest, apdu, 3);
+    ct_test(pTest, Test_Count == 4);
+    ct_test(pTest, Test_Reply.result == TSM_RESULT_ABORT);
+    ct_test(pTest, Test_Reply.server);
+    /* a timeout frees the invoke ID */
+    invoke_id = testRequest(&dest);
+    ct_test(pTest, tsm_set_completion(invoke_id, testCompletion, &context));
+    for (i = 0; i <= apdu_retries(); i++) {
+        ct_test(pTest, Test_Count == 4);
+        tsm_timer_milliseconds(apdu_timeout());
+    }
+    ct_test(pTest, Test_Count == 5);
+    ct_test(pTest, Test_Reply.result == TSM_RESULT_TIMEOUT);
+    ct_test(pTest, Test_Reply.src == NULL);
+    ct_test(pTest, Test_Reply.invoke_id == invoke_id);
+    ct_test(pTest, tsm_invoke_id_free(invoke_id));
+    /* without a completion function the global handlers are used */
+    invoke_id = testRequest(&dest);
+    ct_test(pTest, !tsm_complete(invoke_id, &Test_Reply));
+    ct_test(pTest, !tsm_set_completion(0, testCompletion, &context));
+    tsm_free_invoke_id(invoke_id);
+
     return;
 }
 
@@ -51,6 +51,109 @@
 /* Key List for storing the object data sorted by instance number  */
 static OS_Keylist VMAC_List;
 
+/* Each VMAC is also kept in a hash of its address, so that a received
+   address can be mapped back to its Device ID without walking the list */
+struct vmac_entry {
+    /* first, so that the list data is also a struct vmac_data */
+    struct vmac_data vmac;
+    uint32_t device_id;
+    /* next entry in the same hash bucket */
+    struct vmac_entry *next;
+};
+static struct vmac_entry **VMAC_Hash;
+/* number of hash buckets, a power of two */
+static unsigned int VMAC_Hash_Size;
+#ifndef VMAC_HASH_INITIAL_SIZE
+#define VMAC_HASH_INITIAL_SIZE 64
+#endif
+
+/**
+ * Hashes the address of a VMAC
+ *
+ * @param vmac - VMAC address
+ *
+ * @return hash value, to be masked down to the number of buckets
+ */
+static unsigned int vmac_hash(
+    struct vmac_data *vmac)
+{
+    uint32_t hash = 2166136261UL;
+    unsigned int i = 0;
+
+    for (i = 0; (i < vmac->mac_len) && (i < VMAC_MAC_MAX); i++) {
+        hash ^= vmac->mac[i];
+        hash *= 16777619UL;
+    }
+
+    return (unsigned int)hash;
+}
+
+/**
+ * Adds a VMAC entry to the address hash, doubling the number of buckets
+ * when the hash is as full as it may get.
+ *
+ * @param entry - VMAC entry to add
+ *
+ * @return true if the entry was added
+ */
+static bool vmac_hash_add(
+    struct vmac_entry *entry)
+{
+    struct vmac_entry **hash = NULL;
+    struct vmac_entry *next = NULL;
+    unsigned int size = 0;
+    unsigned int bucket = 0;
+    unsigned int i = 0;
+
+    if ((unsigned int)Keylist_Count(VMAC_List) > VMAC_Hash_Size) {
+        size = VMAC_Hash_Size ? VMAC_Hash_Size * 2 : VMAC_HASH_INITIAL_SIZE;
+        hash = calloc(size, sizeof(struct vmac_entry *));
+        if (hash) {
+            for (i = 0; i < VMAC_Hash_Size; i++) {
+                while (VMAC_Hash[i]) {
+                    next = VMAC_Hash[i]->next;
+                    bucket = vmac_hash(&VMAC_Hash[i]->vmac) & (size - 1);
+                    VMAC_Hash[i]->next = hash[bucket];
+                    hash[bucket] = VMAC_Hash[i];
+                    VMAC_Hash[i] = next;
+                }
+            }
+            free(VMAC_Hash);
+            VMAC_Hash = hash;
+            VMAC_Hash_Size = size;
+        } else if (!VMAC_Hash) {
+            return false;
+        }
+    }
+    bucket = vmac_hash(&entry->vmac) & (VMAC_Hash_Size - 1);
+    entry->next = VMAC_Hash[bucket];
+    VMAC_Hash[bucket] = entry;
+
+    return true;
+}
+
+/**
+ * Removes a VMAC entry from the address hash
+ *
+ * @param entry - VMAC entry to remove
+ */
+static void vmac_hash_remove(
+    struct vmac_entry *entry)
+{
+    struct vmac_entry **link = NULL;
+
+    if (VMAC_Hash) {
+        link = &VMAC_Hash[vmac_hash(&entry->vmac) & (VMAC_Hash_Size - 1)];
+        while (*link) {
+            if (*link == entry) {
+                *link = entry->next;
+                break;
+            }
+            link = &(*link)->next;
+        }
+    }
+}
+
 /**
  * Returns the number of VMAC in the list
  */
@@ -70,27 +173,35 @@ unsigned int VMAC_Count(void)
 bool VMAC_Add(uint32_t device_id, struct vmac_data *src)
 {
     bool status = false;
-    struct vmac_data *pVMAC = NULL;
+    struct vmac_entry *entry = NULL;
     int index = 0;
     size_t i = 0;
 
-    pVMAC = Keylist_Data(VMAC_List, device_id);
-    if (!pVMAC) {
-        pVMAC = calloc(1, sizeof(struct vmac_data));
-        if (pVMAC) {
+    entry = Keylist_Data(VMAC_List, device_id);
+    if (!entry) {
+        entry = calloc(1, sizeof(struct vmac_entry));
+        if (entry) {
             /* copy the MAC into the data store */
-            for (i = 0; i < sizeof(pVMAC->mac); i++) {
+            for (i = 0; i < sizeof(entry->vmac.mac); i++) {
                 if (i < src->mac_len) {
-                    pVMAC->mac[i] = src->mac[i];
+                    entry->vmac.mac[i] = src->mac[i];
                 } else {
                     break;
                 }
             }
-            pVMAC->mac_len = src->mac_len;
-            index = Keylist_Data_Add(VMAC_List, device_id, pVMAC);
+            entry->vmac.mac_len = src->mac_len;
+            entry->device_id = device_id;
+            index = Keylist_Data_Add(VMAC_List, device_id, entry);
             if (index >= 0) {
-                status = true;
-                printf("VMAC %u added.\n", (unsigned int)device_id);
+                if (vmac_hash_add(entry)) {
+                    status = true;
+                    printf("VMAC %u added.\n", (unsigned int)device_id);
+                } else {
+                    Keylist_Data_Delete(VMAC_List, device_id);
+                }
+            }
+            if (!status) {
+                free(entry);
             }
         }
     }
@@ -108,11 +219,12 @@ bool VMAC_Add(uint32_t device_id, struct vmac_data *src)
 bool VMAC_Delete(uint32_t device_id)
 {
     bool status = false;
-    struct vmac_data *pVMAC;
+    struct vmac_entry *entry;
 
-    pVMAC = Keylist_Data_Delete(VMAC_List, device_id);
-    if (pVMAC) {
-        free(pVMAC);
+    entry = Keylist_Data_Delete(VMAC_List, device_id);
+    if (entry) {
+        vmac_hash_remove(entry);
+        free(entry);
         status = true;
     }
 
@@ -128,7 +240,14 @@ bool VMAC_Delete(uint32_t device_id)
  */
 struct vmac_data *VMAC_Find_By_Key(uint32_t device_id)
 {
-    return Keylist_Data(VMAC_List, device_id);
+    struct vmac_entry *entry;
+
+    entry = Keylist_Data(VMAC_List, device_id);
+    if (entry) {
+        return &entry->vmac;
+    }
+
+    return NULL;
 }
 
 /** Compare the VMAC address
@@ -209,24 +328,20 @@ bool VMAC_Match(
 bool VMAC_Find_By_Data(struct vmac_data *vmac, uint32_t *device_id)
 {
     bool status = false;
-    struct vmac_data *list_vmac;
-    int count = 0;
-    int index = 0;
+    struct vmac_entry *entry = NULL;
 
-    count = Keylist_Count(VMAC_List);
-    while (count) {
-        index = count - 1;
-        list_vmac = Keylist_Data_Index(VMAC_List, index);
-        if (list_vmac) {
-            if (VMAC_Match(vmac, list_vmac)) {
+    if (vmac && VMAC_Hash) {
+        entry = VMAC_Hash[vmac_hash(vmac) & (VMAC_Hash_Size - 1)];
+        while (entry) {
+            if (VMAC_Match(vmac, &entry->vmac)) {
                 if (device_id) {
-                    *device_id = Keylist_Key(VMAC_List, index);
+                    *device_id = entry->device_id;
                 }
                 status = true;
                 break;
             }
+            entry = entry->next;
         }
-        count--;
     }
 
     return status;
@@ -237,18 +352,21 @@ bool VMAC_Find_By_Data(struct vmac_data *vmac, uint32_t *device_id)
  */
 void VMAC_Cleanup(void)
 {
-    struct vmac_data *pVMAC;
+    struct vmac_entry *entry;
 
     if (VMAC_List) {
         do {
-            pVMAC = Keylist_Data_Pop(VMAC_List);
-            if (pVMAC) {
-                free(pVMAC);
+            entry = Keylist_Data_Pop(VMAC_List);
+            if (entry) {
+                free(entry);
             }
-        } while (pVMAC);
+        } while (entry);
         Keylist_Delete(VMAC_List);
         VMAC_List = NULL;
     }
+    free(VMAC_Hash);
+    VMAC_Hash = NULL;
+    VMAC_Hash_Size = 0;
 }
 
 /**
@@ -300,6 +418,32 @@ void testVMAC(
     ct_test(pTest, status);
     pVMAC = VMAC_Find_By_Key(device_id);
     ct_test(pTest, pVMAC == NULL);
+    status = VMAC_Find_By_Data(&test_vmac_data, &test_device_id);
+    ct_test(pTest, !status);
+    /* enough entries for the address hash to grow a few times */
+    for (device_id = 0; device_id < 1000; device_id++) {
+        test_vmac_data.mac[0] = (uint8_t)(device_id >> 8);
+        test_vmac_data.mac[1] = (uint8_t)device_id;
+        status = VMAC_Add(device_id, &test_vmac_data);
+        ct_test(pTest, status);
+    }
+    ct_test(pTest, VMAC_Count() == 1000);
+    for (device_id = 0; device_id < 1000; device_id += 2) {
+        status = VMAC_Delete(device_id);
+        ct_test(pTest, status);
+    }
+    for (device_id = 0; device_id < 1000; device_id++) {
+        test_vmac_data.mac[0] = (uint8_t)(device_id >> 8);
+        test_vmac_data.mac[1] = (uint8_t)device_id;
+        test_device_id = 0;
+        status = VMAC_Find_By_Data(&test_vmac_data, &test_device_id);
+        if (device_id % 2) {
+            ct_test(pTest, status);
+            ct_test(pTest, test_device_id == device_id);
+        } else {
+            ct_test(pTest, !status);
+        }
+    }
     VMAC_Cleanup();
 }
 
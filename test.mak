@@ -9,11 +9,12 @@
 
 LOGFILE = test.log
 
-all: abort address arf awf bvlc6 bacapp bacdcode bacerror bacint bacstr \
-	cov crc datetime dcc event filename fifo getevent iam ihave \
+all: abort address arena arf awf bbmd6 bvlc bvlc6 bacapp bacdcode bacerror bacint bacstr \
+	cov crc datetime dcc event evloop filename filexfer fifo getevent iam iam_pace ihave \
 	indtext keylist key memcopy npdu proplist ptransfer \
-	rd reject ringbuf rp rpm sbuf timesync vmac \
-	whohas whois wp objects lighting
+	rd reject ringbuf router_bench router_msgqueue \
+	router_portthread rp rpm sbuf timesync tsm vmac \
+	whohas whois workpool wp objects lighting
 
 clean: logfile
 	rm ${LOGFILE}
@@ -31,6 +32,11 @@ address: logfile test/address.mak
 	( ./test/address >> ${LOGFILE} )
 	$(MAKE) -s -C test -f address.mak clean
 
+arena: logfile test/arena.mak
+	$(MAKE) -s -C test -f arena.mak clean all
+	( ./test/arena >> ${LOGFILE} )
+	$(MAKE) -s -C test -f arena.mak clean
+
 arf: logfile test/arf.mak
 	$(MAKE) -s -C test -f arf.mak clean all
 	( ./test/arf >> ${LOGFILE} )
@@ -66,6 +72,16 @@ bacstr: logfile test/bacstr.mak
 	( ./test/bacstr >> ${LOGFILE} )
 	$(MAKE) -s -C test -f bacstr.mak clean
 
+bbmd6: logfile test/bbmd6.mak
+	$(MAKE) -s -C test -f bbmd6.mak clean all
+	( ./test/bbmd6 >> ${LOGFILE} )
+	$(MAKE) -s -C test -f bbmd6.mak clean
+
+bvlc: logfile test/bvlc.mak
+	$(MAKE) -s -C test -f bvlc.mak clean all
+	( ./test/bvlc >> ${LOGFILE} )
+	$(MAKE) -s -C test -f bvlc.mak clean
+
 bvlc6: logfile test/bvlc6.mak
 	$(MAKE) -s -C test -f bvlc6.mak clean all
 	( ./test/bvlc6 >> ${LOGFILE} )
@@ -96,11 +112,21 @@ event: logfile test/event.mak
 	( ./test/event >> ${LOGFILE} )
 	$(MAKE) -s -C test -f event.mak clean
 
+evloop: logfile test/evloop.mak
+	$(MAKE) -s -C test -f evloop.mak clean all
+	( ./test/evloop >> ${LOGFILE} )
+	$(MAKE) -s -C test -f evloop.mak clean
+
 filename: logfile test/filename.mak
 	$(MAKE) -s -C test -f filename.mak clean all
 	( ./test/filename >> ${LOGFILE} )
 	$(MAKE) -s -C test -f filename.mak clean
 
+filexfer: logfile test/filexfer.mak
+	$(MAKE) -s -C test -f filexfer.mak clean all
+	( ./test/filexfer >> ${LOGFILE} )
+	$(MAKE) -s -C test -f filexfer.mak clean
+
 fifo: logfile test/fifo.mak
 	$(MAKE) -s -C test -f fifo.mak clean all
 	( ./test/fifo >> ${LOGFILE} )
@@ -116,6 +142,11 @@ iam: logfile test/iam.mak
 	( ./test/iam >> ${LOGFILE} )
 	$(MAKE) -s -C test -f iam.mak clean
 
+iam_pace: logfile test/iam_pace.mak
+	$(MAKE) -s -C test -f iam_pace.mak clean all
+	( ./test/iam_pace >> ${LOGFILE} )
+	$(MAKE) -s -C test -f iam_pace.mak clean
+
 ihave: logfile test/ihave.mak
 	$(MAKE) -s -C test -f ihave.mak clean all
 	( ./test/ihave >> ${LOGFILE} )
@@ -176,6 +207,21 @@ ringbuf: logfile test/ringbuf.mak
 	( ./test/ringbuf >> ${LOGFILE} )
 	$(MAKE) -s -C test -f ringbuf.mak clean
 
+router_bench: logfile test/router_bench.mak
+	$(MAKE) -s -C test -f router_bench.mak clean all
+	( ./test/router_bench >> ${LOGFILE} )
+	$(MAKE) -s -C test -f router_bench.mak clean
+
+router_msgqueue: logfile test/router_msgqueue.mak
+	$(MAKE) -s -C test -f router_msgqueue.mak clean all
+	( ./test/router_msgqueue >> ${LOGFILE} )
+	$(MAKE) -s -C test -f router_msgqueue.mak clean
+
+router_portthread: logfile test/router_portthread.mak
+	$(MAKE) -s -C test -f router_portthread.mak clean all
+	( ./test/router_portthread >> ${LOGFILE} )
+	$(MAKE) -s -C test -f router_portthread.mak clean
+
 rp: logfile test/rp.mak
 	$(MAKE) -s -C test -f rp.mak clean all
 	( ./test/rp >> ${LOGFILE} )
@@ -196,6 +242,11 @@ timesync: logfile test/timesync.mak
 	( ./test/timesync >> ${LOGFILE} )
 	$(MAKE) -s -C test -f timesync.mak clean
 
+tsm: logfile test/tsm.mak
+	$(MAKE) -s -C test -f tsm.mak clean all
+	( ./test/tsm >> ${LOGFILE} )
+	$(MAKE) -s -C test -f tsm.mak clean
+
 vmac: logfile test/vmac.mak
 	$(MAKE) -s -C test -f vmac.mak clean all
 	( ./test/vmac >> ${LOGFILE} )
@@ -211,6 +262,11 @@ whois: logfile test/whois.mak
 	( ./test/whois >> ${LOGFILE} )
 	$(MAKE) -s -C test -f whois.mak clean
 
+workpool: logfile test/workpool.mak
+	$(MAKE) -s -C test -f workpool.mak clean all
+	( ./test/workpool >> ${LOGFILE} )
+	$(MAKE) -s -C test -f workpool.mak clean
+
 wp: logfile test/wp.mak
 	$(MAKE) -s -C test -f wp.mak clean all
 	( ./test/wp >> ${LOGFILE} )
@@ -219,7 +275,7 @@ wp: logfile test/wp.mak
 objects: ai ao av bi bo bv csv lc lo lso lsp \
 	mso msv ms-input netport osv piv command \
 	access_credential access_door access_point access_rights \
-	access_user access_zone credential_data_input
+	access_user access_zone credential_data_input gw_device trendlog bacfile
 
 access_credential: logfile demo/object/access_credential.mak
 	$(MAKE) -s -C demo/object -f access_credential.mak clean all
@@ -300,6 +356,11 @@ device: logfile demo/object/device.mak
 	( ./demo/object/device >> ${LOGFILE} )
 	$(MAKE) -s -C demo/object -f device.mak clean
 
+gw_device: logfile demo/object/gw_device.mak
+	$(MAKE) -s -C demo/object -f gw_device.mak clean all
+	( ./demo/object/gw_device >> ${LOGFILE} )
+	$(MAKE) -s -C demo/object -f gw_device.mak clean
+
 lc: logfile demo/object/lc.mak
 	$(MAKE) -s -C demo/object -f lc.mak clean all
 	( ./demo/object/load_control >> ${LOGFILE} )
@@ -354,3 +415,13 @@ schedule: logfile demo/object/schedule.mak
 	$(MAKE) -s -C demo/object -f schedule.mak clean all
 	( ./demo/object/schedule >> ${LOGFILE} )
 	$(MAKE) -s -C demo/object -f schedule.mak clean
+
+trendlog: logfile demo/object/trendlog.mak
+	$(MAKE) -s -C demo/object -f trendlog.mak clean all
+	( ./demo/object/trendlog >> ${LOGFILE} )
+	$(MAKE) -s -C demo/object -f trendlog.mak clean
+
+bacfile: logfile demo/object/bacfile.mak
+	$(MAKE) -s -C demo/object -f bacfile.mak clean all
+	( ./demo/object/bacfile >> ${LOGFILE} )
+	$(MAKE) -s -C demo/object -f bacfile.mak clean
@@ -10,7 +10,10 @@ SRCS = $(SRC_DIR)/bacdcode.c \
 	$(SRC_DIR)/bacint.c \
 	$(SRC_DIR)/bacstr.c \
 	$(SRC_DIR)/bacreal.c \
+	$(SRC_DIR)/bip.c \
 	$(SRC_DIR)/bvlc.c \
+	$(SRC_DIR)/candi_s.c \
+	$(SRC_DIR)/debug.c \
 	ctest.c
 
 OBJS = ${SRCS:.c=.o}
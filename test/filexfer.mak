@@ -0,0 +1,40 @@
+#Makefile to build test case
+CC      = gcc
+SRC_DIR = ../src
+SRC_INC = ../include
+DEMO_DIR = ../demo/handler
+DEMO_INC = ../demo/object
+INCLUDES =  -I. -I$(SRC_INC) -I$(DEMO_INC) -I../ports/linux
+DEFINES = -DBIG_ENDIAN=0 -DTEST -DTEST_FILE_TRANSFER
+
+CFLAGS  = -Wall -Wmissing-prototypes $(INCLUDES) $(DEFINES) -g
+
+SRCS = $(SRC_DIR)/arf.c \
+	$(SRC_DIR)/awf.c \
+	$(SRC_DIR)/bacdcode.c \
+	$(SRC_DIR)/bacint.c \
+	$(SRC_DIR)/bacreal.c \
+	$(SRC_DIR)/bacstr.c \
+	$(DEMO_DIR)/filexfer.c \
+	ctest.c
+
+TARGET = filexfer
+
+all: ${TARGET}
+
+OBJS = ${SRCS:.c=.o}
+
+${TARGET}: ${OBJS}
+	${CC} -o $@ ${OBJS}
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+
+clean:
+	rm -rf ${TARGET} $(OBJS)
+
+include: .depend
@@ -0,0 +1,35 @@
+#Makefile to build test case
+CC      = gcc
+SRC_DIR = ../src
+SRC_INC = ../include
+DEMO_DIR = ../demo/handler
+DEMO_INC = ../demo/object
+INCLUDES =  -I. -I$(SRC_INC) -I$(DEMO_INC) -I../ports/linux
+DEFINES = -DBIG_ENDIAN=0 -DTEST -DTEST_IAM_PACE
+
+CFLAGS  = -Wall -Wmissing-prototypes $(INCLUDES) $(DEFINES) -g
+
+SRCS = $(SRC_DIR)/bacaddr.c \
+	$(DEMO_DIR)/s_iam_pace.c \
+	ctest.c
+
+TARGET = iam_pace
+
+all: ${TARGET}
+
+OBJS = ${SRCS:.c=.o}
+
+${TARGET}: ${OBJS}
+	${CC} -o $@ ${OBJS}
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+
+clean:
+	rm -rf ${TARGET} $(OBJS)
+
+include: .depend
@@ -0,0 +1,43 @@
+#Makefile to build test case
+CC      = gcc
+SRC_DIR = ../src
+SRC_INC = ../include
+ROUTER_DIR = ../demo/router
+INCLUDES =  -I. -I$(SRC_INC) -I$(ROUTER_DIR) -I../ports/linux
+DEFINES = -DBIG_ENDIAN=0 -DTEST -DTEST_BENCHMARK
+
+CFLAGS  = -Wall -Wmissing-prototypes $(INCLUDES) $(DEFINES) -g
+
+SRCS = $(SRC_DIR)/bacaddr.c \
+	$(SRC_DIR)/bacdcode.c \
+	$(SRC_DIR)/bacint.c \
+	$(SRC_DIR)/bacreal.c \
+	$(SRC_DIR)/bacstr.c \
+	$(SRC_DIR)/npdu.c \
+	$(ROUTER_DIR)/benchmark.c \
+	$(ROUTER_DIR)/loopmodule.c \
+	$(ROUTER_DIR)/msgqueue.c \
+	$(ROUTER_DIR)/network_layer.c \
+	$(ROUTER_DIR)/portthread.c \
+	ctest.c
+
+TARGET = router_bench
+
+all: ${TARGET}
+
+OBJS = ${SRCS:.c=.o}
+
+${TARGET}: ${OBJS}
+	${CC} -pthread -o $@ ${OBJS}
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+
+clean:
+	rm -rf ${TARGET} $(OBJS)
+
+include: .depend
@@ -0,0 +1,33 @@
+#Makefile to build test case
+CC      = gcc
+SRC_DIR = ../src
+SRC_INC = ../include
+ROUTER_DIR = ../demo/router
+INCLUDES =  -I. -I$(SRC_INC) -I$(ROUTER_DIR) -I../ports/linux
+DEFINES = -DBIG_ENDIAN=0 -DTEST -DTEST_MSGQUEUE
+
+CFLAGS  = -Wall -Wmissing-prototypes $(INCLUDES) $(DEFINES) -g
+
+SRCS = $(ROUTER_DIR)/msgqueue.c \
+	ctest.c
+
+TARGET = router_msgqueue
+
+all: ${TARGET}
+
+OBJS = ${SRCS:.c=.o}
+
+${TARGET}: ${OBJS}
+	${CC} -pthread -o $@ ${OBJS}
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+
+clean:
+	rm -rf ${TARGET} $(OBJS)
+
+include: .depend
@@ -0,0 +1,40 @@
+#Makefile to build test case
+CC      = gcc
+SRC_DIR = ../src
+SRC_INC = ../include
+ROUTER_DIR = ../demo/router
+INCLUDES =  -I. -I$(SRC_INC) -I$(ROUTER_DIR) -I../ports/linux
+DEFINES = -DBIG_ENDIAN=0 -DTEST -DTEST_PORT_THREAD
+
+CFLAGS  = -Wall -Wmissing-prototypes $(INCLUDES) $(DEFINES) -g
+
+SRCS = $(SRC_DIR)/bacaddr.c \
+	$(SRC_DIR)/bacdcode.c \
+	$(SRC_DIR)/bacint.c \
+	$(SRC_DIR)/bacreal.c \
+	$(SRC_DIR)/bacstr.c \
+	$(SRC_DIR)/npdu.c \
+	$(ROUTER_DIR)/msgqueue.c \
+	$(ROUTER_DIR)/portthread.c \
+	ctest.c
+
+TARGET = router_portthread
+
+all: ${TARGET}
+
+OBJS = ${SRCS:.c=.o}
+
+${TARGET}: ${OBJS}
+	${CC} -pthread -o $@ ${OBJS}
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+
+clean:
+	rm -rf ${TARGET} $(OBJS)
+
+include: .depend
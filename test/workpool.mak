@@ -0,0 +1,32 @@
+#Makefile to build test case
+CC      = gcc
+SRC_DIR = ../ports/linux
+INCLUDES = -I../include -I$(SRC_DIR) -I.
+DEFINES = -DBIG_ENDIAN=0 -DBACDL_BIP=1 -DTEST -DTEST_WORKPOOL
+
+CFLAGS  = -Wall -pthread $(INCLUDES) $(DEFINES) -g
+
+SRCS = $(SRC_DIR)/workpool.c \
+	ctest.c
+
+TARGET = workpool
+
+all: ${TARGET}
+ 
+OBJS = ${SRCS:.c=.o}
+
+${TARGET}: ${OBJS}
+	${CC} -pthread -o $@ ${OBJS} 
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+	
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+	
+clean:
+	rm -rf core ${TARGET} $(OBJS) *.bak *.1 *.ini
+
+include: .depend
+